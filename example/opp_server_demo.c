@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "opp_server_demo.c"
+
+// *****************************************************************************
+/* EXAMPLE_START(opp_server_demo): OPP Server - Receive Objects via Object Push
+ *
+ * @text The OPP Server demo accepts objects like vCards or files pushed by a
+ * remote device and reports the received number of bytes and the throughput.
+ * With ENABLE_GOEP_L2CAP, the service is also available via L2CAP ERTM, which
+ * allows the client to use Single Response Mode (SRM) and stream the object
+ * without waiting for a response per OBEX packet.
+ *
+ * @text Note: To test, please run the example, and then send a file from
+ * your phone via Bluetooth.
+ */
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack.h"
+#include "classic/goep_server.h"
+#include "classic/opp_server.h"
+
+#define OPP_SERVER_RFCOMM_CHANNEL 1
+#define OPP_SERVER_L2CAP_PSM      0x1001
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static uint8_t  opp_service_buffer[150];
+static uint32_t object_bytes_received;
+static uint32_t object_start_ms;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    bd_addr_t event_addr;
+    uint32_t duration_ms;
+
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case HCI_EVENT_USER_CONFIRMATION_REQUEST:
+                    printf("SSP User Confirmation Auto accept\n");
+                    break;
+                case HCI_EVENT_GOEP_META:
+                    switch (hci_event_goep_meta_get_subevent_code(packet)){
+                        case GOEP_SUBEVENT_CONNECTION_OPENED:
+                            goep_subevent_connection_opened_get_bd_addr(packet, event_addr);
+                            printf("OPP connection from %s\n", bd_addr_to_str(event_addr));
+                            break;
+                        case GOEP_SUBEVENT_PUT_REQUEST:
+                            printf("Receive '%.*s', type '%.*s', length %" PRIu32 "\n",
+                                   goep_subevent_put_request_get_name_len(packet), goep_subevent_put_request_get_name(packet),
+                                   goep_subevent_put_request_get_type_len(packet), goep_subevent_put_request_get_type(packet),
+                                   goep_subevent_put_request_get_length(packet));
+                            object_bytes_received = 0;
+                            object_start_ms = btstack_run_loop_get_time_ms();
+                            break;
+                        case GOEP_SUBEVENT_PUT_COMPLETED:
+                            duration_ms = btstack_run_loop_get_time_ms() - object_start_ms;
+                            printf("Object complete, status 0x%02x, %" PRIu32 " bytes in %" PRIu32 " ms", goep_subevent_put_completed_get_status(packet),
+                                   object_bytes_received, duration_ms);
+                            if (duration_ms > 0){
+                                printf(", %" PRIu32 " kB/s", object_bytes_received / duration_ms);
+                            }
+                            printf("\n");
+                            break;
+                        case GOEP_SUBEVENT_CONNECTION_CLOSED:
+                            printf("OPP connection closed\n");
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case GOEP_DATA_PACKET:
+            if (object_bytes_received == 0){
+                printf("SRM %s\n", goep_server_srm_active(channel) ? "active" : "not active");
+            }
+            object_bytes_received += size;
+            break;
+        default:
+            break;
+    }
+}
+
+int btstack_main(int argc, const char * argv[]);
+int btstack_main(int argc, const char * argv[]){
+    (void)argc;
+    (void)argv;
+
+    uint16_t l2cap_psm = 0;
+#ifdef ENABLE_GOEP_L2CAP
+    l2cap_psm = OPP_SERVER_L2CAP_PSM;
+#endif
+
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+
+    l2cap_init();
+    rfcomm_init();
+    goep_server_init();
+    opp_server_init(&packet_handler, OPP_SERVER_RFCOMM_CHANNEL, l2cap_psm, LEVEL_2);
+
+    // init SDP, create record for OPP and register with SDP
+    static const uint8_t supported_formats[] = { OPP_SERVER_FORMAT_VCARD_21, OPP_SERVER_FORMAT_VCARD_30, OPP_SERVER_FORMAT_ANY };
+    sdp_init();
+    memset(opp_service_buffer, 0, sizeof(opp_service_buffer));
+    opp_server_create_sdp_record(opp_service_buffer, 0x10001, OPP_SERVER_RFCOMM_CHANNEL, l2cap_psm, "OPP Server",
+                                 sizeof(supported_formats), supported_formats);
+    sdp_register_service(opp_service_buffer);
+
+    gap_discoverable_control(1);
+    gap_ssp_set_io_capability(SSP_IO_CAPABILITY_DISPLAY_YES_NO);
+    gap_set_local_name("OPP Server 00:00:00:00:00:00");
+
+    // turn on!
+    hci_power_control(HCI_POWER_ON);
+    return 0;
+}
+/* EXAMPLE_END */
@@ -60,6 +60,7 @@
 #include "btstack_event.h"
 #include "classic/goep_client.h"
 #include "classic/pbap_client.h"
+#include "classic/vcard_parser.h"
 
 #ifdef HAVE_BTSTACK_STDIN
 #include "btstack_stdin.h"
@@ -315,11 +316,41 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
 }
 #else
 
+static vcard_parser_t vcard_parser;
+
+// print names and phone numbers while the phonebook is received
+static void vcard_parser_callback(vcard_parser_t * parser, vcard_parser_event_t event, const uint8_t * data, uint16_t len){
+    vcard_property_t property = vcard_parser_get_property(parser);
+    switch (event){
+        case VCARD_PARSER_EVENT_PROPERTY_BEGIN:
+            if (property == VCARD_PROPERTY_FN){
+                printf("[-] Name:   ");
+            }
+            if (property == VCARD_PROPERTY_TEL){
+                printf("[-] Number: ");
+            }
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_VALUE:
+            if ((property == VCARD_PROPERTY_FN) || (property == VCARD_PROPERTY_TEL)){
+                printf("%.*s", len, (const char *) data);
+            }
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_END:
+            if ((property == VCARD_PROPERTY_FN) || (property == VCARD_PROPERTY_TEL)){
+                printf("\n");
+            }
+            if (property == VCARD_PROPERTY_PHOTO){
+                printf("[-] Photo:  %u bytes\n", (unsigned int) vcard_parser_get_value_len(parser));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 // packet handler for emdded system with fixed operation sequence
 static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(channel);
-    UNUSED(size);
-    int i;
     switch (packet_type){
         case HCI_EVENT_PACKET:
             switch (hci_event_packet_get_type(packet)) {
@@ -335,6 +366,7 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
                         case PBAP_SUBEVENT_CONNECTION_OPENED:
                             printf("[+] Connected\n");
                             printf("[+] Pull phonebook\n");
+                            vcard_parser_init(&vcard_parser, &vcard_parser_callback, NULL);
                             pbap_pull_phonebook(pbap_cid, phonebook_path);
                             break;
                         case PBAP_SUBEVENT_CONNECTION_CLOSED:
@@ -354,9 +386,7 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             }
             break;
         case PBAP_DATA_PACKET:
-            for (i=0;i<size;i++){
-                printf("%c", packet[i]);
-            }
+            vcard_parser_process(&vcard_parser, packet, size);
             break;
         default:
             break;
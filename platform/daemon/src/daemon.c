@@ -86,6 +86,7 @@
 #include "classic/sdp_server.h"
 #include "classic/sdp_client.h"
 #include "classic/sdp_client_rfcomm.h"
+#include "daemon_packet_filter.h"
 #include "hci.h"
 #include "hci_cmd.h"
 #include "hci_dump.h"
@@ -166,6 +167,9 @@ typedef struct {
     
     // discoverable
     uint8_t        discoverable;
+
+    // packets broadcast to this client
+    daemon_packet_filter_t packet_filter;
     
 } client_state_t;
 
@@ -964,6 +968,19 @@ static int btstack_command_handler(connection_t *connection, uint8_t *packet, ui
             // merge state
             gap_discoverable_control(clients_require_discoverable());
             break;
+        case BTSTACK_SET_PACKET_FILTER:
+            log_info("BTSTACK_SET_PACKET_FILTER packet types %04x, con handle %04x", little_endian_read_16(packet, 3), little_endian_read_16(packet, 5));
+            client = client_for_connection(connection);
+            if (!client) break;
+            daemon_packet_filter_set_packet_types(&client->packet_filter, little_endian_read_16(packet, 3));
+            daemon_packet_filter_set_con_handle(&client->packet_filter, little_endian_read_16(packet, 5));
+            break;
+        case BTSTACK_SET_EVENT_FILTER:
+            log_info("BTSTACK_SET_EVENT_FILTER event %02x, subevent %02x, subscribe %u", packet[3], packet[4], packet[5]);
+            client = client_for_connection(connection);
+            if (!client) break;
+            daemon_packet_filter_set_event(&client->packet_filter, packet[3], packet[4], packet[5]);
+            break;
         case BTSTACK_SET_BLUETOOTH_ENABLED:
             log_info("BTSTACK_SET_BLUETOOTH_ENABLED: %u\n", packet[3]);
             if (packet[3]) {
@@ -1364,6 +1381,7 @@ static int daemon_client_handler(connection_t *connection, uint16_t packet_type,
                     client->connection   = connection;
                     client->power_mode   = HCI_POWER_OFF;
                     client->discoverable = 0;
+                    daemon_packet_filter_init(&client->packet_filter);
                     btstack_linked_list_add(&clients, (btstack_linked_item_t *) client);
                     break;
                 case DAEMON_EVENT_CONNECTION_CLOSED:
@@ -1489,8 +1507,14 @@ static void daemon_retry_parked(void){
 static void daemon_emit_packet(void * connection, uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     if (connection) {
         socket_connection_send_packet(connection, packet_type, channel, packet, size);
-    } else {
-        socket_connection_send_packet_all(packet_type, channel, packet, size);
+        return;
+    }
+    // only send to clients that subscribed to this packet
+    btstack_linked_item_t *it;
+    for (it = (btstack_linked_item_t *) clients; it ; it = it->next){
+        client_state_t * client_state = (client_state_t *) it;
+        if (!daemon_packet_filter_matches(&client_state->packet_filter, packet_type, packet, size)) continue;
+        socket_connection_send_packet(client_state->connection, packet_type, channel, packet, size);
     }
 }
 
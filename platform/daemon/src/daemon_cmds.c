@@ -97,6 +97,23 @@ const hci_cmd_t btstack_set_bluetooth_enabled = {
     DAEMON_OPCODE_BTSTACK_SET_BLUETOOTH_ENABLED, "1"
 };
 
+/**
+ * @param packet_types bit mask (1 << packet_type) of packets to receive, default: 0xffff
+ * @param con_handle only receive HCI ACL/SCO data for this connection, 0xffff for all
+ */
+const hci_cmd_t btstack_set_packet_filter = {
+    DAEMON_OPCODE_BTSTACK_SET_PACKET_FILTER, "2H"
+};
+
+/**
+ * @param event_code or 0 for all events
+ * @param subevent_code for HCI_EVENT_LE_META or 0 for all subevents
+ * @param subscribe (0 = unsubscribe, 1 = subscribe)
+ */
+const hci_cmd_t btstack_set_event_filter = {
+    DAEMON_OPCODE_BTSTACK_SET_EVENT_FILTER, "111"
+};
+
 /**
  * @param bd_addr (48)
  * @param psm (16)
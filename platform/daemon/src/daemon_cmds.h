@@ -63,6 +63,8 @@ typedef enum {
     DAEMON_OPCODE_BTSTACK_SET_SYSTEM_BLUETOOTH_ENABLED = DAEMON_OPCODE(BTSTACK_SET_SYSTEM_BLUETOOTH_ENABLED),
     DAEMON_OPCODE_BTSTACK_SET_DISCOVERABLE = DAEMON_OPCODE(BTSTACK_SET_DISCOVERABLE),
     DAEMON_OPCODE_BTSTACK_SET_BLUETOOTH_ENABLED = DAEMON_OPCODE(BTSTACK_SET_BLUETOOTH_ENABLED),
+    DAEMON_OPCODE_BTSTACK_SET_PACKET_FILTER = DAEMON_OPCODE(BTSTACK_SET_PACKET_FILTER),
+    DAEMON_OPCODE_BTSTACK_SET_EVENT_FILTER = DAEMON_OPCODE(BTSTACK_SET_EVENT_FILTER),
     DAEMON_OPCODE_L2CAP_CREATE_CHANNEL = DAEMON_OPCODE(L2CAP_CREATE_CHANNEL),
     DAEMON_OPCODE_L2CAP_CREATE_CHANNEL_MTU = DAEMON_OPCODE(L2CAP_CREATE_CHANNEL_MTU),
     DAEMON_OPCODE_L2CAP_DISCONNECT = DAEMON_OPCODE(L2CAP_DISCONNECT),
@@ -125,6 +127,8 @@ extern const hci_cmd_t btstack_get_system_bluetooth_enabled;
 extern const hci_cmd_t btstack_set_system_bluetooth_enabled;
 extern const hci_cmd_t btstack_set_discoverable;
 extern const hci_cmd_t btstack_set_bluetooth_enabled;    // only used by btstack config
+extern const hci_cmd_t btstack_set_packet_filter;
+extern const hci_cmd_t btstack_set_event_filter;
 
 extern const hci_cmd_t l2cap_accept_connection_cmd;
 extern const hci_cmd_t l2cap_create_channel_cmd;
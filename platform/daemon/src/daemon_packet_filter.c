@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "daemon_packet_filter.c"
+
+/*
+ *  daemon_packet_filter.c
+ */
+
+#include <string.h>
+
+#include "daemon_packet_filter.h"
+#include "btstack_defines.h"
+#include "btstack_util.h"
+
+static void daemon_packet_filter_set_bit(uint8_t * bits, uint8_t index, uint8_t value){
+    if (value){
+        bits[index >> 3] |= (uint8_t) (1u << (index & 7u));
+    } else {
+        bits[index >> 3] &= (uint8_t) ~(1u << (index & 7u));
+    }
+}
+
+static int daemon_packet_filter_get_bit(const uint8_t * bits, uint8_t index){
+    return (bits[index >> 3] >> (index & 7u)) & 1u;
+}
+
+void daemon_packet_filter_init(daemon_packet_filter_t * filter){
+    filter->packet_types = 0xffff;
+    memset(filter->events, 0xff, sizeof(filter->events));
+    memset(filter->le_subevents, 0xff, sizeof(filter->le_subevents));
+    filter->con_handle = HCI_CON_HANDLE_INVALID;
+}
+
+void daemon_packet_filter_set_packet_types(daemon_packet_filter_t * filter, uint16_t packet_types){
+    filter->packet_types = packet_types;
+}
+
+void daemon_packet_filter_set_event(daemon_packet_filter_t * filter, uint8_t event_code, uint8_t subevent_code, uint8_t subscribe){
+    uint8_t fill = subscribe ? 0xff : 0x00;
+    if (event_code == 0u){
+        memset(filter->events, fill, sizeof(filter->events));
+        memset(filter->le_subevents, fill, sizeof(filter->le_subevents));
+        return;
+    }
+    if (event_code != HCI_EVENT_LE_META){
+        daemon_packet_filter_set_bit(filter->events, event_code, subscribe);
+        return;
+    }
+    if (subevent_code == 0u){
+        memset(filter->le_subevents, fill, sizeof(filter->le_subevents));
+    } else {
+        daemon_packet_filter_set_bit(filter->le_subevents, subevent_code, subscribe);
+    }
+    // LE Meta event is accepted if any subevent is subscribed
+    uint8_t any_subevent = 0;
+    uint16_t i;
+    for (i = 0; i < sizeof(filter->le_subevents); i++){
+        any_subevent |= filter->le_subevents[i];
+    }
+    daemon_packet_filter_set_bit(filter->events, HCI_EVENT_LE_META, any_subevent != 0u);
+}
+
+void daemon_packet_filter_set_con_handle(daemon_packet_filter_t * filter, hci_con_handle_t con_handle){
+    filter->con_handle = con_handle;
+}
+
+int daemon_packet_filter_matches(const daemon_packet_filter_t * filter, uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    if (packet_type < 16u){
+        if ((filter->packet_types & (1u << packet_type)) == 0u) return 0;
+    }
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (size < 1u) return 1;
+            if (!daemon_packet_filter_get_bit(filter->events, packet[0])) return 0;
+            if ((packet[0] == HCI_EVENT_LE_META) && (size >= 3u)){
+                return daemon_packet_filter_get_bit(filter->le_subevents, packet[2]);
+            }
+            return 1;
+        case HCI_ACL_DATA_PACKET:
+        case HCI_SCO_DATA_PACKET:
+            if (filter->con_handle == HCI_CON_HANDLE_INVALID) return 1;
+            if (size < 2u) return 1;
+            return (little_endian_read_16(packet, 0) & 0x0fffu) == filter->con_handle;
+        default:
+            return 1;
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ *  daemon_packet_filter.h
+ *
+ *  Per-client filter for packets broadcast by the daemon
+ */
+
+#ifndef DAEMON_PACKET_FILTER_H
+#define DAEMON_PACKET_FILTER_H
+
+#include <stdint.h>
+
+#include "bluetooth.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    // bit per packet type < 16
+    uint16_t packet_types;
+    // bit per HCI event code
+    uint8_t  events[32];
+    // bit per LE Meta subevent code
+    uint8_t  le_subevents[32];
+    // HCI ACL/SCO data only for this connection, HCI_CON_HANDLE_INVALID for all
+    hci_con_handle_t con_handle;
+} daemon_packet_filter_t;
+
+/**
+ * @brief Init filter to accept all packets
+ * @param filter
+ */
+void daemon_packet_filter_init(daemon_packet_filter_t * filter);
+
+/**
+ * @brief Set packet types to receive
+ * @param filter
+ * @param packet_types bit mask with bit (1 << packet_type), packet types >= 16 are always accepted
+ */
+void daemon_packet_filter_set_packet_types(daemon_packet_filter_t * filter, uint16_t packet_types);
+
+/**
+ * @brief Subscribe to or unsubscribe from event
+ * @param filter
+ * @param event_code or 0 for all events
+ * @param subevent_code for HCI_EVENT_LE_META or 0 for all LE Meta subevents
+ * @param subscribe
+ */
+void daemon_packet_filter_set_event(daemon_packet_filter_t * filter, uint8_t event_code, uint8_t subevent_code, uint8_t subscribe);
+
+/**
+ * @brief Only accept HCI ACL and SCO data for given connection
+ * @param filter
+ * @param con_handle or HCI_CON_HANDLE_INVALID for all connections
+ */
+void daemon_packet_filter_set_con_handle(daemon_packet_filter_t * filter, hci_con_handle_t con_handle);
+
+/**
+ * @brief Check if packet passes filter
+ * @param filter
+ * @param packet_type
+ * @param packet
+ * @param size
+ * @return 1 if packet should be forwarded
+ */
+int daemon_packet_filter_matches(const daemon_packet_filter_t * filter, uint8_t packet_type, const uint8_t * packet, uint16_t size);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // DAEMON_PACKET_FILTER_H
@@ -70,6 +70,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #endif
  
@@ -100,6 +101,11 @@ struct sockaddr_un {
 
 #define MAX_PENDING_CONNECTIONS 10
 
+// size of output queue for each accepted connection
+#ifndef SOCKET_CONNECTION_OUTPUT_QUEUE_SIZE
+#define SOCKET_CONNECTION_OUTPUT_QUEUE_SIZE (64 * 1024)
+#endif
+
 /** prototypes */
 static void socket_connection_hci_process(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type);
 static int socket_connection_dummy_handler(connection_t *connection, uint16_t packet_type, uint16_t channel, uint8_t *data, uint16_t length);
@@ -124,6 +130,16 @@ typedef struct linked_connection {
     connection_t * connection;
 } linked_connection_t;
 
+#ifndef _WIN32
+/** queue for packets that could not be written without blocking */
+typedef struct output_queue {
+    uint8_t  * storage;
+    uint32_t size;
+    uint32_t read_pos;
+    uint32_t bytes_queued;
+} output_queue_t;
+#endif
+
 struct connection {
     btstack_data_source_t ds;                // used for run loop
     linked_connection_t linked_connection;   // used for connection list
@@ -132,6 +148,13 @@ struct connection {
     uint16_t bytes_read;
     uint16_t bytes_to_read;
     uint8_t  buffer[6+HCI_ACL_BUFFER_SIZE]; // packet_header(6) + max packet: 3-DH5 = header(6) + payload (1021)
+#ifndef _WIN32
+    // non-blocking output for accepted connections
+    output_queue_t output_queue;
+    // packet could not be queued, connection gets closed
+    int output_stalled;
+#endif
+    socket_connection_output_stats_t output_stats;
 };
 
 /** list of socket connections */
@@ -167,6 +190,14 @@ static void socket_connection_free_connection(connection_t *conn){
     if (conn->ds.source.handle){
         WSACloseEvent(conn->ds.source.handle);
     }
+#else
+    close(conn->socket_fd);
+    if (conn->output_queue.storage != NULL){
+        log_info("socket_connection %p closed: packets sent %u, queued %u, dropped %u, max queue depth %u bytes, writev calls %u",
+                 conn, conn->output_stats.packets_sent, conn->output_stats.packets_queued, conn->output_stats.packets_dropped,
+                 conn->output_stats.queue_depth_max, conn->output_stats.writev_calls);
+        free(conn->output_queue.storage);
+    }
 #endif
 
     // destroy
@@ -238,10 +269,153 @@ void static socket_connection_emit_connection_closed(connection_t *connection){
     (*socket_connection_packet_callback)(connection, DAEMON_EVENT_PACKET, 0, (uint8_t *) &event, 1);
 }
 
+#ifndef _WIN32
+
+static int socket_connection_enable_output_queue(connection_t *conn){
+    conn->output_queue.storage = malloc(SOCKET_CONNECTION_OUTPUT_QUEUE_SIZE);
+    if (conn->output_queue.storage == NULL) return -1;
+    conn->output_queue.size = SOCKET_CONNECTION_OUTPUT_QUEUE_SIZE;
+    int flags = fcntl(conn->socket_fd, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(conn->socket_fd, F_SETFL, flags | O_NONBLOCK) < 0)){
+        log_error("socket_connection: failed to set O_NONBLOCK, error: %s", strerror(errno));
+        free(conn->output_queue.storage);
+        conn->output_queue.storage = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// packets that can be dropped for slow clients without breaking protocol state
+static int socket_connection_packet_droppable(uint16_t type, const uint8_t *packet, uint16_t size){
+    switch (type){
+        case HCI_SCO_DATA_PACKET:
+            return 1;
+        case HCI_EVENT_PACKET:
+            if (size < 1) return 0;
+            switch (hci_event_packet_get_type(packet)){
+                case HCI_EVENT_INQUIRY_RESULT:
+                case HCI_EVENT_INQUIRY_RESULT_WITH_RSSI:
+                case HCI_EVENT_EXTENDED_INQUIRY_RESPONSE:
+                case GAP_EVENT_ADVERTISING_REPORT:
+                case GAP_EVENT_INQUIRY_RESULT:
+                    return 1;
+                case HCI_EVENT_LE_META:
+                    if (size < 3) return 0;
+                    return hci_event_le_meta_get_subevent_code(packet) == HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+                default:
+                    return 0;
+            }
+        default:
+            return 0;
+    }
+}
+
+static void socket_connection_output_queue_add(output_queue_t *queue, const uint8_t *data, uint32_t len){
+    uint32_t write_pos = (queue->read_pos + queue->bytes_queued) % queue->size;
+    uint32_t bytes_until_end = queue->size - write_pos;
+    uint32_t bytes_to_copy = btstack_min(len, bytes_until_end);
+    memcpy(&queue->storage[write_pos], data, bytes_to_copy);
+    memcpy(queue->storage, &data[bytes_to_copy], len - bytes_to_copy);
+    queue->bytes_queued += len;
+}
+
+// write as much of queued data as possible with a single writev
+static void socket_connection_flush_output_queue(connection_t *conn){
+    output_queue_t *queue = &conn->output_queue;
+    if (queue->bytes_queued > 0){
+        struct iovec iov[2];
+        int iovcnt = 1;
+        uint32_t bytes_until_end = queue->size - queue->read_pos;
+        iov[0].iov_base = &queue->storage[queue->read_pos];
+        iov[0].iov_len  = btstack_min(queue->bytes_queued, bytes_until_end);
+        if (queue->bytes_queued > bytes_until_end){
+            iov[1].iov_base = queue->storage;
+            iov[1].iov_len  = queue->bytes_queued - bytes_until_end;
+            iovcnt = 2;
+        }
+        conn->output_stats.writev_calls++;
+        ssize_t res = writev(conn->socket_fd, iov, iovcnt);
+        if (res > 0){
+            queue->read_pos = (queue->read_pos + (uint32_t) res) % queue->size;
+            queue->bytes_queued -= (uint32_t) res;
+        }
+        // other errors are detected by read
+    }
+    conn->output_stats.queue_depth = queue->bytes_queued;
+    if (queue->bytes_queued == 0){
+        btstack_run_loop_disable_data_source_callbacks(&conn->ds, DATA_SOURCE_CALLBACK_WRITE);
+    }
+}
+
+static void socket_connection_send_packet_nonblocking(connection_t *conn, uint16_t type, uint8_t *header, uint8_t *packet, uint16_t size){
+    output_queue_t *queue = &conn->output_queue;
+    if (conn->output_stalled){
+        conn->output_stats.packets_dropped++;
+        return;
+    }
+
+    uint32_t packet_len = sizeof(packet_header_t) + size;
+    uint32_t bytes_written = 0;
+    if (queue->bytes_queued == 0){
+        // try to send header and payload directly
+        struct iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len  = sizeof(packet_header_t);
+        iov[1].iov_base = packet;
+        iov[1].iov_len  = size;
+        conn->output_stats.writev_calls++;
+        ssize_t res = writev(conn->socket_fd, iov, 2);
+        if (res < 0){
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)){
+                // connection broken, detected by read
+                return;
+            }
+            res = 0;
+        }
+        bytes_written = (uint32_t) res;
+        if (bytes_written == packet_len){
+            conn->output_stats.packets_sent++;
+            return;
+        }
+    } else if ((queue->size - queue->bytes_queued) < packet_len){
+        if (socket_connection_packet_droppable(type, packet, size)){
+            conn->output_stats.packets_dropped++;
+            return;
+        }
+        // client does not keep up, close connection instead of blocking the run loop
+        log_error("socket_connection %p: output queue full (%u bytes), closing connection", conn, queue->bytes_queued);
+        conn->output_stalled = 1;
+        conn->output_stats.packets_dropped++;
+        shutdown(conn->socket_fd, SHUT_RDWR);
+        return;
+    }
+
+    // queue remaining part of the packet
+    if (bytes_written < sizeof(packet_header_t)){
+        socket_connection_output_queue_add(queue, &header[bytes_written], sizeof(packet_header_t) - bytes_written);
+        socket_connection_output_queue_add(queue, packet, size);
+    } else {
+        socket_connection_output_queue_add(queue, &packet[bytes_written - sizeof(packet_header_t)], packet_len - bytes_written);
+    }
+    conn->output_stats.packets_queued++;
+    conn->output_stats.queue_depth = queue->bytes_queued;
+    conn->output_stats.queue_depth_max = btstack_max(conn->output_stats.queue_depth_max, queue->bytes_queued);
+    btstack_run_loop_enable_data_source_callbacks(&conn->ds, DATA_SOURCE_CALLBACK_WRITE);
+}
+
+#endif
+
 void socket_connection_hci_process(btstack_data_source_t *socket_ds, btstack_data_source_callback_type_t callback_type) {
     UNUSED(callback_type);
     connection_t *conn = (connection_t *) socket_ds;
 
+#ifndef _WIN32
+    if (callback_type == DATA_SOURCE_CALLBACK_WRITE){
+        socket_connection_flush_output_queue(conn);
+        return;
+    }
+#endif
+
     log_debug("socket_connection_hci_process, callback %x", callback_type);
 
     // get socket_fd
@@ -267,6 +441,14 @@ void socket_connection_hci_process(btstack_data_source_t *socket_ds, btstack_dat
 #endif
 
     log_debug("socket_connection_hci_process fd %x, bytes read %d", socket_fd, bytes_read);
+    if (bytes_read < 0){
+        // non-blocking socket: no data yet
+#ifdef _WIN32
+        if (WSAGetLastError() == WSAEWOULDBLOCK) return;
+#else
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) return;
+#endif
+    }
     if (bytes_read <= 0){
         // connection broken (no particular channel, no date yet)
         socket_connection_emit_connection_closed(conn);
@@ -376,6 +558,22 @@ static void socket_connection_accept(btstack_data_source_t *socket_ds, btstack_d
     log_info("socket_connection_accept new connection %u", fd);
     
     connection_t * connection = socket_connection_register_new_connection(fd);
+    if (connection == NULL) {
+#ifndef _WIN32
+        close(fd);
+#endif
+        return;
+    }
+
+#ifndef _WIN32
+    // don't block run loop on slow clients
+    if (socket_connection_enable_output_queue(connection) < 0){
+        log_error("socket_connection_accept: could not set up output queue, closing connection %u", fd);
+        socket_connection_free_connection(connection);
+        return;
+    }
+#endif
+
     socket_connection_emit_connection_opened(connection);
 }
 
@@ -570,12 +768,27 @@ void socket_connection_send_packet(connection_t *conn, uint16_t type, uint16_t c
     res = send(conn->socket_fd, (const char *) header, 6, flags);
     res = send(conn->socket_fd, (const char *) packet, size, flags);
 #else
-    res = write(conn->socket_fd, header, 6);
-    res = write(conn->socket_fd, packet, size);
+    if (conn->output_queue.storage != NULL){
+        socket_connection_send_packet_nonblocking(conn, type, header, packet, size);
+        return;
+    }
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len  = sizeof(header);
+    iov[1].iov_base = packet;
+    iov[1].iov_len  = size;
+    res = writev(conn->socket_fd, iov, 2);
 #endif
     UNUSED(res);
 }
 
+/**
+ * get output statistics for connection
+ */
+void socket_connection_get_output_stats(connection_t *conn, socket_connection_output_stats_t *stats){
+    *stats = conn->output_stats;
+}
+
 /**
  * send HCI packet to all connections 
  */
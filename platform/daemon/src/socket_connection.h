@@ -56,6 +56,16 @@ extern "C" {
 /** opaque connection type */
 typedef struct connection connection_t;
 
+/** output statistics for accepted connections */
+typedef struct {
+    uint32_t packets_sent;      // sent without queueing
+    uint32_t packets_queued;    // (partially) queued as socket was not ready
+    uint32_t packets_dropped;   // dropped as output queue was full
+    uint32_t queue_depth;       // bytes in output queue
+    uint32_t queue_depth_max;   // max bytes in output queue
+    uint32_t writev_calls;
+} socket_connection_output_stats_t;
+
 /**
  * Init socket connection module
  */
@@ -109,9 +119,16 @@ void socket_connection_register_packet_callback( int (*packet_callback)(connecti
 
 /**
  * send HCI packet to single connection
+ * accepted connections don't block: if the socket is not ready, packets are queued. If the queue is full,
+ * advertising reports, inquiry results and SCO packets are dropped, for other packets the connection is closed
  */
 void socket_connection_send_packet(connection_t *connection, uint16_t packet_type, uint16_t channel, uint8_t *data, uint16_t size);
 
+/**
+ * get output statistics for connection, e.g. to monitor queue depth
+ */
+void socket_connection_get_output_stats(connection_t *connection, socket_connection_output_stats_t *stats);
+
 /**
  * send event data to all clients
  */
@@ -237,6 +237,67 @@ static void btstack_tlv_flash_bank_erase_bank(btstack_tlv_flash_bank_t * self, i
 	}
 }
 
+// RAM index
+
+// @returns position of tag or where it should be inserted
+static uint16_t btstack_tlv_flash_bank_index_find(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	uint16_t low  = 0;
+	uint16_t high = self->index_count;
+	while (low < high){
+		uint16_t mid = (low + high) / 2;
+		if (self->index_entries[mid].tag < tag){
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// @returns offset of tag or 0 if not found
+static uint32_t btstack_tlv_flash_bank_index_get(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	uint16_t pos = btstack_tlv_flash_bank_index_find(self, tag);
+	if (pos == self->index_count) return 0;
+	if (self->index_entries[pos].tag != tag) return 0;
+	return self->index_entries[pos].offset;
+}
+
+static void btstack_tlv_flash_bank_index_set(btstack_tlv_flash_bank_t * self, uint32_t tag, uint32_t offset){
+	uint16_t pos = btstack_tlv_flash_bank_index_find(self, tag);
+	if ((pos < self->index_count) && (self->index_entries[pos].tag == tag)){
+		self->index_entries[pos].offset = offset;
+		return;
+	}
+	if (self->index_count == self->index_size){
+		log_info("index full, disable index");
+		self->index_entries = NULL;
+		return;
+	}
+	memmove(&self->index_entries[pos+1], &self->index_entries[pos], (self->index_count - pos) * sizeof(btstack_tlv_flash_bank_index_entry_t));
+	self->index_entries[pos].tag    = tag;
+	self->index_entries[pos].offset = offset;
+	self->index_count++;
+}
+
+static void btstack_tlv_flash_bank_index_remove(btstack_tlv_flash_bank_t * self, uint32_t tag){
+	uint16_t pos = btstack_tlv_flash_bank_index_find(self, tag);
+	if (pos == self->index_count) return;
+	if (self->index_entries[pos].tag != tag) return;
+	self->index_count--;
+	memmove(&self->index_entries[pos], &self->index_entries[pos+1], (self->index_count - pos) * sizeof(btstack_tlv_flash_bank_index_entry_t));
+}
+
+static void btstack_tlv_flash_bank_mark_deleted(btstack_tlv_flash_bank_t * self, uint32_t offset){
+	uint32_t zero_value = 0;
+#ifdef ENABLE_TLV_FLASH_EXPLICIT_DELETE_FIELD
+	// write delete field at offset 8
+	btstack_tlv_flash_bank_write(self, self->current_bank, offset+8, (uint8_t*) &zero_value, sizeof(zero_value));
+#else
+	// overwrite tag with zero value
+	btstack_tlv_flash_bank_write(self, self->current_bank, offset, (uint8_t*) &zero_value, sizeof(zero_value));
+#endif
+}
+
 static void btstack_tlv_flash_bank_migrate(btstack_tlv_flash_bank_t * self){
 
 	int next_bank = 1 - self->current_bank;
@@ -256,6 +317,10 @@ static void btstack_tlv_flash_bank_migrate(btstack_tlv_flash_bank_t * self){
 			log_info("migrate pos %u, tag '%x' len %u -> new pos %u",
                 (unsigned  int)  tag_index, (unsigned int)  it.tag, (unsigned int) tag_len, next_write_pos);
 
+			if (self->index_entries != NULL){
+				btstack_tlv_flash_bank_index_set(self, it.tag, next_write_pos);
+			}
+
 			// copy header
 			uint8_t header_buffer[8];
 			btstack_tlv_flash_bank_read(self, self->current_bank, tag_index,      header_buffer, 8);
@@ -299,15 +364,7 @@ static void btstack_tlv_flash_bank_delete_tag_until_offset(btstack_tlv_flash_ban
 			log_info("Erase tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
 
 			// mark entry as invalid
-			uint32_t zero_value = 0;
-#ifdef ENABLE_TLV_FLASH_EXPLICIT_DELETE_FIELD
-			// write delete field at offset 8
-			btstack_tlv_flash_bank_write(self, self->current_bank, it.offset+8, (uint8_t*) &zero_value, sizeof(zero_value));
-#else
-			// overwrite tag with zero value
-			btstack_tlv_flash_bank_write(self, self->current_bank, it.offset, (uint8_t*) &zero_value, sizeof(zero_value));
-#endif
-
+			btstack_tlv_flash_bank_mark_deleted(self, it.offset);
 		}
 		tlv_iterator_fetch_next(self, &it);
 	}
@@ -327,15 +384,25 @@ static int btstack_tlv_flash_bank_get_tag(void * context, uint32_t tag, uint8_t
 	uint32_t tag_index = 0;
 	uint32_t tag_len   = 0;
 	tlv_iterator_t it;
-	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
-	while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
-		if (it.tag == tag){
-			log_info("Found tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
-			tag_index = it.offset;
-			tag_len   = it.len;
-			break;
+	if (self->index_entries != NULL){
+		tag_index = btstack_tlv_flash_bank_index_get(self, tag);
+		if (tag_index != 0){
+			it.bank   = self->current_bank;
+			it.offset = tag_index;
+			btstack_tlv_flash_bank_iterator_fetch_tag_len(self, &it);
+			tag_len = it.len;
+		}
+	} else {
+		btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+		while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
+			if (it.tag == tag){
+				log_info("Found tag '%x' at position %u", (unsigned int) tag, (unsigned int) it.offset);
+				tag_index = it.offset;
+				tag_len   = it.len;
+				break;
+			}
+			tlv_iterator_fetch_next(self, &it);
 		}
-		tlv_iterator_fetch_next(self, &it);
 	}
 	if (tag_index == 0) return 0;
 	if (!buffer) return tag_len;
@@ -390,7 +457,15 @@ static int btstack_tlv_flash_bank_store_tag(void * context, uint32_t tag, const
 	btstack_tlv_flash_bank_write(self, self->current_bank, self->write_offset, entry, sizeof(entry));
 
 	// overwrite old entries (if exists)
-	btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
+	if (self->index_entries != NULL){
+		uint32_t old_offset = btstack_tlv_flash_bank_index_get(self, tag);
+		if (old_offset != 0){
+			btstack_tlv_flash_bank_mark_deleted(self, old_offset);
+		}
+		btstack_tlv_flash_bank_index_set(self, tag, self->write_offset);
+	} else {
+		btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
+	}
 
 	// done
 	self->write_offset += sizeof(entry) + btstack_tlv_flash_bank_align_size(self, data_size);
@@ -409,6 +484,14 @@ static int btstack_tlv_flash_bank_store_tag(void * context, uint32_t tag, const
  */
 static void btstack_tlv_flash_bank_delete_tag(void * context, uint32_t tag){
 	btstack_tlv_flash_bank_t * self = (btstack_tlv_flash_bank_t *) context;
+	if (self->index_entries != NULL){
+		uint32_t offset = btstack_tlv_flash_bank_index_get(self, tag);
+		if (offset != 0){
+			btstack_tlv_flash_bank_mark_deleted(self, offset);
+			btstack_tlv_flash_bank_index_remove(self, tag);
+		}
+		return;
+	}
 	btstack_tlv_flash_bank_delete_tag_until_offset(self, tag, self->write_offset);
 }
 
@@ -426,6 +509,9 @@ const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_ban
 	self->hal_flash_bank_impl    = hal_flash_bank_impl;
 	self->hal_flash_bank_context = hal_flash_bank_context;
 	self->delete_tag_len = 0;
+	self->index_entries = NULL;
+	self->index_size = 0;
+	self->index_count = 0;
 
 #ifdef ENABLE_TLV_FLASH_EXPLICIT_DELETE_FIELD
 	if (hal_flash_bank_impl->get_alignment(hal_flash_bank_context) > 8){
@@ -488,3 +574,27 @@ const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_ban
 	return &btstack_tlv_flash_bank;
 }
 
+/**
+ * Enable RAM index
+ */
+int btstack_tlv_flash_bank_enable_index(btstack_tlv_flash_bank_t * self, btstack_tlv_flash_bank_index_entry_t * index_entries, uint16_t index_size){
+	self->index_entries = index_entries;
+	self->index_size    = index_size;
+	self->index_count   = 0;
+
+	tlv_iterator_t it;
+	btstack_tlv_flash_bank_iterator_init(self, &it, self->current_bank);
+	while (btstack_tlv_flash_bank_iterator_has_next(self, &it)){
+		// skip deleted entries
+		if (it.tag){
+			btstack_tlv_flash_bank_index_set(self, it.tag, it.offset);
+			if (self->index_entries == NULL){
+				log_error("more than %u tags, index not enabled", index_size);
+				return 1;
+			}
+		}
+		tlv_iterator_fetch_next(self, &it);
+	}
+	log_info("index enabled, %u tags", self->index_count);
+	return 0;
+}
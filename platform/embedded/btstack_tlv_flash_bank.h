@@ -47,12 +47,22 @@
 extern "C" {
 #endif
 
+// entry of optional RAM index: latest offset of tag in current bank
+typedef struct {
+	uint32_t tag;
+	uint32_t offset;
+} btstack_tlv_flash_bank_index_entry_t;
+
 typedef struct {
 	const hal_flash_bank_t * hal_flash_bank_impl;
 	void * hal_flash_bank_context;
 	int current_bank;
 	int write_offset;
 	int delete_tag_len;
+	// optional RAM index sorted by tag, NULL if not used
+	btstack_tlv_flash_bank_index_entry_t * index_entries;
+	uint16_t index_size;
+	uint16_t index_count;
 } btstack_tlv_flash_bank_t;
 
 /**
@@ -63,6 +73,17 @@ typedef struct {
  */
 const btstack_tlv_t * btstack_tlv_flash_bank_init_instance(btstack_tlv_flash_bank_t * context, const hal_flash_bank_t * hal_flash_bank_impl, void * hal_flash_bank_context);
 
+/**
+ * Enable RAM index with the latest offset for each tag
+ * Lookups, stores and deletes don't scan the bank anymore. The index is built by scanning the current bank once and
+ * disabled again if there are more tags than index entries.
+ * @param context btstack_tlv_flash_bank_t
+ * @param index_entries storage for index, one entry per tag
+ * @param index_size number of entries
+ * @returns 0 if index could be built
+ */
+int btstack_tlv_flash_bank_enable_index(btstack_tlv_flash_bank_t * context, btstack_tlv_flash_bank_index_entry_t * index_entries, uint16_t index_size);
+
 #if defined __cplusplus
 }
 #endif
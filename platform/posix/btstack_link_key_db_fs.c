@@ -40,12 +40,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <unistd.h>
 
 #include "tinydir.h"
 
 #include "btstack_config.h"
 #include "btstack_link_key_db_fs.h"
+#include "btstack_record_log_posix.h"
 #include "btstack_debug.h"
 #include "btstack_util.h"
 
@@ -58,14 +58,25 @@
 #endif
 #endif
 
+// all link keys for a local address are stored in a single record log
 #define LINK_KEY_PREFIX "btstack_at_"
-#define LINK_KEY_FOR "_link_key_for_"
-#define LINK_KEY_SUFFIX ".txt"
+#define LINK_KEY_SUFFIX "_link_keys.db"
 #define LINK_KEY_STRING_LEN 17
 
+// record: link key + link key type, key: remote address
+#define LINK_KEY_RECORD_LEN (LINK_KEY_LEN + 1)
+
+// previous format: one text file per link key with hex link key and link key type as decimal digit,
+// imported when the record log for the local address does not exist yet
+#define LEGACY_LINK_KEY_FOR "_link_key_for_"
+#define LEGACY_LINK_KEY_SUFFIX ".txt"
+
 static bd_addr_t local_addr;
-// note: sizeof for string literals works at compile time while strlen only works with some optimizations turned on. sizeof includes the  \0
-static char keypath[sizeof(LINK_KEY_PATH) + sizeof(LINK_KEY_PREFIX) + LINK_KEY_STRING_LEN + sizeof(LINK_KEY_FOR) + LINK_KEY_STRING_LEN + sizeof(LINK_KEY_SUFFIX) + 1];
+// note: sizeof for string literals works at compile time while strlen only works with some optimizations turned on. sizeof includes the  \0
+static char keypath[sizeof(LINK_KEY_PATH) + sizeof(LINK_KEY_PREFIX) + LINK_KEY_STRING_LEN + sizeof(LINK_KEY_SUFFIX) + 1];
+
+static btstack_record_log_posix_t link_key_log;
+static int link_key_log_open;
 
 static char bd_addr_to_dash_str_buffer[6*3];  // 12-45-78-01-34-67\0
 static char * bd_addr_to_dash_str(bd_addr_t addr){
@@ -80,55 +91,91 @@ static char * bd_addr_to_dash_str(bd_addr_t addr){
     return (char *) bd_addr_to_dash_str_buffer;
 }
 
-static char link_key_to_str_buffer[LINK_KEY_STR_LEN+1];  // 11223344556677889900112233445566\0
-static char *link_key_to_str(link_key_t link_key){
-    char * p = link_key_to_str_buffer;
+static void set_path(void){
+    strcpy(keypath, LINK_KEY_PATH);
+    strcat(keypath, LINK_KEY_PREFIX);
+    strcat(keypath, bd_addr_to_dash_str(local_addr));
+    strcat(keypath, LINK_KEY_SUFFIX);
+}
+
+static int read_legacy_link_key(const char * path, link_key_t link_key, link_key_type_t * link_key_type){
+    char buffer[LINK_KEY_STR_LEN + 1];
+    FILE * file = fopen(path, "r");
+    if (file == NULL) return 0;
+    size_t len = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    if (len != sizeof(buffer)) return 0;
     int i;
-    for (i = 0; i < LINK_KEY_LEN ; i++) {
-        *p++ = char_for_nibble((link_key[i] >> 4) & 0x0F);
-        *p++ = char_for_nibble((link_key[i] >> 0) & 0x0F);
+    for (i = 0; i < LINK_KEY_LEN; i++){
+        int high = nibble_for_char(buffer[i * 2]);
+        int low  = nibble_for_char(buffer[i * 2 + 1]);
+        if ((high < 0) || (low < 0)) return 0;
+        link_key[i] = (uint8_t) ((high << 4) | low);
     }
-    *p = 0;
-    return (char *) link_key_to_str_buffer;
+    int type = nibble_for_char(buffer[LINK_KEY_STR_LEN]);
+    if ((type < 0) || (type > 9)) return 0;
+    *link_key_type = (link_key_type_t) type;
+    return 1;
 }
 
-static char link_key_type_to_str_buffer[2];
-static char *link_key_type_to_str(link_key_type_t link_key){
-    snprintf(link_key_type_to_str_buffer, sizeof(link_key_type_to_str_buffer), "%d", link_key);
-    return (char *) link_key_type_to_str_buffer;
+// legacy files are kept, they are not read again once the record log exists
+static void import_legacy_link_keys(btstack_record_log_posix_t * log){
+    char prefix[sizeof(LINK_KEY_PREFIX) + LINK_KEY_STRING_LEN + sizeof(LEGACY_LINK_KEY_FOR)];
+    strcpy(prefix, LINK_KEY_PREFIX);
+    strcat(prefix, bd_addr_to_dash_str(local_addr));
+    strcat(prefix, LEGACY_LINK_KEY_FOR);
+    const size_t prefix_len = strlen(prefix);
+
+    tinydir_dir dir;
+    if (tinydir_open(&dir, LINK_KEY_PATH) != 0) return;
+    unsigned int num_imported = 0;
+    while (dir.has_next){
+        tinydir_file file;
+        tinydir_readfile(&dir, &file);
+        tinydir_next(&dir);
+        if (strlen(file.name) != (prefix_len + LINK_KEY_STRING_LEN + sizeof(LEGACY_LINK_KEY_SUFFIX) - 1)) continue;
+        if (strncmp(prefix, file.name, prefix_len) != 0) continue;
+        if (strcmp(&file.name[prefix_len + LINK_KEY_STRING_LEN], LEGACY_LINK_KEY_SUFFIX) != 0) continue;
+        bd_addr_t bd_addr;
+        link_key_t link_key;
+        link_key_type_t link_key_type;
+        if (sscanf_bd_addr(&file.name[prefix_len], bd_addr) == 0) continue;
+        if (read_legacy_link_key(file.path, link_key, &link_key_type) == 0) continue;
+        uint8_t record[LINK_KEY_RECORD_LEN];
+        memcpy(record, link_key, LINK_KEY_LEN);
+        record[LINK_KEY_LEN] = (uint8_t) link_key_type;
+        if (btstack_record_log_posix_put(log, bd_addr, BD_ADDR_LEN, record, sizeof(record)) == 0){
+            num_imported++;
+        }
+    }
+    tinydir_close(&dir);
+    btstack_record_log_posix_sync(log);
+    if (num_imported > 0u){
+        log_info("imported %u link keys from previous format", num_imported);
+    }
 }
 
-static int sscanf_link_key(char * addr_string, link_key_t link_key){
-    unsigned int buffer[LINK_KEY_LEN];
-
-    // reset result buffer
-    memset(&buffer, 0, sizeof(buffer));
-
-    // parse
-    int result = sscanf( (char *) addr_string, "%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x",
-                                    &buffer[0], &buffer[1], &buffer[2], &buffer[3],
-                                    &buffer[4], &buffer[5], &buffer[6], &buffer[7],
-                                    &buffer[8], &buffer[9], &buffer[10], &buffer[11],
-                                    &buffer[12], &buffer[13], &buffer[14], &buffer[15] );
-
-    if (result != LINK_KEY_LEN) return 0;
-
-    // store
-    int i;
-    uint8_t *p = (uint8_t *) link_key;
-    for (i=0; i<LINK_KEY_LEN; i++ ) {
-        *p++ = (uint8_t) buffer[i];
+// open log for current local address on first use
+static btstack_record_log_posix_t * get_log(void){
+    if (link_key_log_open) return &link_key_log;
+    set_path();
+    int import_legacy = btstack_record_log_posix_exists(keypath) == 0;
+    if (btstack_record_log_posix_open(&link_key_log, keypath, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL) != 0){
+        log_error("failed to open %s", keypath);
+        return NULL;
     }
-    return 1;
+    if (import_legacy){
+        import_legacy_link_keys(&link_key_log);
+    }
+    log_info("link key db %s, %u entries", keypath, (unsigned int) btstack_record_log_posix_count(&link_key_log));
+    link_key_log_open = 1;
+    return &link_key_log;
 }
 
-static void set_path(bd_addr_t bd_addr){
-    strcpy(keypath, LINK_KEY_PATH);
-    strcat(keypath, LINK_KEY_PREFIX);
-    strcat(keypath, bd_addr_to_dash_str(local_addr));
-    strcat(keypath, LINK_KEY_FOR);
-    strcat(keypath, bd_addr_to_dash_str(bd_addr));
-    strcat(keypath, LINK_KEY_SUFFIX);
+static void close_log(void){
+    if (link_key_log_open == 0) return;
+    btstack_record_log_posix_close(&link_key_log);
+    link_key_log_open = 0;
 }
 
 // Device info
@@ -136,110 +183,75 @@ static void db_open(void){
 }
 
 static void db_set_local_bd_addr(bd_addr_t bd_addr){
+    if (memcmp(local_addr, bd_addr, 6) == 0) return;
+    close_log();
     memcpy(local_addr, bd_addr, 6);
 }
 
 static void db_close(void){ 
+    close_log();
 }
 
 static void put_link_key(bd_addr_t bd_addr, link_key_t link_key, link_key_type_t link_key_type){
-    set_path(bd_addr);
-    char * link_key_str = link_key_to_str(link_key);
-    char * link_key_type_str = link_key_type_to_str(link_key_type); 
-
-    FILE * wFile = fopen(keypath,"w+");
-    if (wFile == NULL){
-        log_error("failed to create file");
-        return;
+    btstack_record_log_posix_t * log = get_log();
+    if (log == NULL) return;
+    uint8_t record[LINK_KEY_RECORD_LEN];
+    memcpy(record, link_key, LINK_KEY_LEN);
+    record[LINK_KEY_LEN] = (uint8_t) link_key_type;
+    if (btstack_record_log_posix_put(log, bd_addr, BD_ADDR_LEN, record, sizeof(record)) != 0){
+        log_error("failed to store link key for %s", bd_addr_to_str(bd_addr));
     }
-    fwrite(link_key_str, strlen(link_key_str), 1, wFile);
-    fwrite(link_key_type_str, strlen(link_key_type_str), 1, wFile);
-    fclose(wFile);
 }
 
-static int read_link_key(const char * path, link_key_t link_key, link_key_type_t * link_key_type){
-    if (access(path, R_OK)) return 0;
-    
-    char link_key_str[LINK_KEY_STR_LEN + 1];
-    char link_key_type_str[2];
-
-    FILE * rFile = fopen(path,"r+");
-    if (rFile == NULL) return 0;
-    size_t objects_read = fread(link_key_str, LINK_KEY_STR_LEN, 1, rFile );
-    if (objects_read == 1){
-        link_key_str[LINK_KEY_STR_LEN] = 0;
-        log_info("Found link key %s\n", link_key_str);
-        objects_read = fread(link_key_type_str, 1, 1, rFile );
-    }
-    fclose(rFile);
-    
-    if (objects_read != 1) return 0;
-    link_key_type_str[1] = 0;
-    log_info("Found link key type %s\n", link_key_type_str);
-    
-    int scan_result = sscanf_link_key(link_key_str, link_key);
-    if (scan_result == 0 ) return 0;
-
-    int link_key_type_buffer;
-    scan_result = sscanf( (char *) link_key_type_str, "%d", &link_key_type_buffer);
-    if (scan_result == 0 ) return 0;
-    *link_key_type = (link_key_type_t) link_key_type_buffer;
+static int read_link_key(const uint8_t * record, uint16_t record_len, link_key_t link_key, link_key_type_t * link_key_type){
+    if (record_len != LINK_KEY_RECORD_LEN) return 0;
+    memcpy(link_key, record, LINK_KEY_LEN);
+    *link_key_type = (link_key_type_t) record[LINK_KEY_LEN];
     return 1;
 }
 
 static int get_link_key(bd_addr_t bd_addr, link_key_t link_key, link_key_type_t * link_key_type) {
-    set_path(bd_addr);
-    return read_link_key(keypath, link_key, link_key_type);
+    btstack_record_log_posix_t * log = get_log();
+    if (log == NULL) return 0;
+    const uint8_t * record;
+    uint16_t record_len;
+    if (btstack_record_log_posix_get(log, bd_addr, BD_ADDR_LEN, &record, &record_len) == 0) return 0;
+    return read_link_key(record, record_len, link_key, link_key_type);
 }
 
 static void delete_link_key(bd_addr_t bd_addr){
-    set_path(bd_addr);
-    if (access(keypath, R_OK)) return;
-    if(remove(keypath) != 0){
-        log_error("File %s could not be deleted.\n", keypath);
-    }
+    btstack_record_log_posix_t * log = get_log();
+    if (log == NULL) return;
+    btstack_record_log_posix_delete(log, bd_addr, BD_ADDR_LEN);
 }
 
 static int iterator_init(btstack_link_key_iterator_t * it){
-    tinydir_dir * dir = (tinydir_dir *) malloc(sizeof(tinydir_dir));
-    if (!dir) return 0;
-    it->context = dir;
-    tinydir_open(dir, LINK_KEY_PATH);
+    btstack_record_log_posix_t * log = get_log();
+    if (log == NULL) return 0;
+    btstack_record_log_posix_iterator_t * log_it = (btstack_record_log_posix_iterator_t *) malloc(sizeof(btstack_record_log_posix_iterator_t));
+    if (!log_it) return 0;
+    btstack_record_log_posix_iterator_init(log_it, log);
+    it->context = log_it;
     return 1;
 }
 
 static int  iterator_get_next(btstack_link_key_iterator_t * it, bd_addr_t bd_addr, link_key_t link_key, link_key_type_t * type){
-    (void)bd_addr;
-    (void)link_key;
-    UNUSED(type);
-    tinydir_dir * dir = (tinydir_dir*) it->context;
-
-    // construct prefix
-    strcpy(keypath, LINK_KEY_PREFIX);
-    strcat(keypath, bd_addr_to_dash_str(local_addr));
-    strcat(keypath, LINK_KEY_FOR);
-
-    while (dir->has_next) {
-        tinydir_file file;
-        tinydir_readfile(dir, &file);
-        tinydir_next(dir);
-        // compare 
-        if (strncmp(keypath, file.name, strlen(keypath)) == 0){
-            // parse bd_addr
-            const int addr_offset = sizeof(LINK_KEY_PREFIX) + LINK_KEY_STRING_LEN + sizeof(LINK_KEY_FOR) - 2;   // -1 for each sizeof
-            sscanf_bd_addr(&file.name[addr_offset], bd_addr);
-            // path found, read file
-            strcpy(keypath, LINK_KEY_PATH);
-            strcat(keypath, file.name);
-            read_link_key(keypath, link_key, type);
-            return 1;
-        }
+    btstack_record_log_posix_iterator_t * log_it = (btstack_record_log_posix_iterator_t *) it->context;
+    const uint8_t * key;
+    uint8_t key_len;
+    const uint8_t * record;
+    uint16_t record_len;
+    while (btstack_record_log_posix_iterator_next(log_it, &key, &key_len, &record, &record_len)){
+        if (key_len != BD_ADDR_LEN) continue;
+        if (read_link_key(record, record_len, link_key, type) == 0) continue;
+        memcpy(bd_addr, key, BD_ADDR_LEN);
+        return 1;
     }
     return 0;
 }
 
 static void iterator_done(btstack_link_key_iterator_t * it){
-    tinydir_close((tinydir_dir*)it->context);
+    btstack_record_log_posix_iterator_done((btstack_record_log_posix_iterator_t *) it->context);
     free(it->context);
     it->context = NULL;
 }
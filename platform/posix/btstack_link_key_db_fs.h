@@ -46,6 +46,7 @@ extern "C" {
 
 /*
  * @brief Get basic link key db implementation that stores link keys in /tmp
+ * @note All link keys for a local address are kept in a single binary append-only log file
  */
 const btstack_link_key_db_t * btstack_link_key_db_fs_instance(void);
 
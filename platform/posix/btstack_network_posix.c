@@ -78,11 +78,57 @@
 
 #include "btstack.h"
 
+// number of ethernet frame buffers shared by TAP reads and bridged BNEP channels
+#ifndef BTSTACK_NETWORK_POSIX_NUM_FRAMES
+#define BTSTACK_NETWORK_POSIX_NUM_FRAMES 16
+#endif
+
+// max number of bridged BNEP channels
+#ifndef BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS
+#define BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS 7
+#endif
+
+// number of source addresses learned from bridged BNEP channels
+#ifndef BTSTACK_NETWORK_POSIX_NUM_LEARNED_ADDRESSES
+#define BTSTACK_NETWORK_POSIX_NUM_LEARNED_ADDRESSES 32
+#endif
+
+#define BRIDGE_PORT_NETWORK  0xff
+#define BRIDGE_PORT_UNKNOWN  0xfe
+
+typedef struct {
+    btstack_linked_item_t item;     // free or pending list
+    uint16_t        len;
+    uint8_t         ref_count;      // number of BNEP channels the frame is queued for
+    bnep_tx_frame_t tx[BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS];
+    uint8_t         data[BNEP_MTU_MIN];
+} network_frame_t;
+
+typedef struct {
+    uint16_t  bnep_cid;             // 0 if unused
+    bd_addr_t remote_addr;
+} bridge_channel_t;
+
+typedef struct {
+    bd_addr_t addr;
+    uint8_t   port;                 // bridge channel index
+} bridge_address_t;
+
 static int  tap_fd = -1;
-static uint8_t network_buffer[BNEP_MTU_MIN];
-static size_t  network_buffer_len = 0;
 static char tap_dev_name[16];
 
+static network_frame_t       network_frames[BTSTACK_NETWORK_POSIX_NUM_FRAMES];
+static btstack_linked_list_t network_frames_free;
+static btstack_linked_list_t network_frames_pending;
+static int                   network_frames_initialized;
+static int                   tap_dev_read_enabled;
+
+static bridge_channel_t bridge_channels[BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS];
+static uint8_t          bridge_num_channels;
+static bridge_address_t bridge_addresses[BTSTACK_NETWORK_POSIX_NUM_LEARNED_ADDRESSES];
+static uint8_t          bridge_num_addresses;
+static uint8_t          bridge_next_address;
+
 #if defined(__APPLE__) || defined(__FreeBSD__)
 // tuntaposx provides fixed set of tapX devices
 static const char * tap_dev = "/dev/tap0";
@@ -99,39 +145,190 @@ static btstack_data_source_t tap_dev_ds;
 
 static void (*btstack_network_send_packet_callback)(const uint8_t * packet, uint16_t size);
 
+static void network_frames_init(void){
+    if (network_frames_initialized) return;
+    network_frames_initialized = 1;
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_NUM_FRAMES;i++){
+        btstack_linked_list_add(&network_frames_free, (btstack_linked_item_t *) &network_frames[i]);
+    }
+}
+
+static void network_frame_release(network_frame_t * frame){
+    btstack_linked_list_add(&network_frames_free, (btstack_linked_item_t *) frame);
+    // frame available, resume reading from TAP device
+    if ((tap_fd >= 0) && (tap_dev_read_enabled == 0)){
+        tap_dev_read_enabled = 1;
+        btstack_run_loop_enable_data_source_callbacks(&tap_dev_ds, DATA_SOURCE_CALLBACK_READ);
+    }
+}
+
+static void network_write_frame(const uint8_t * packet, uint16_t size){
+    if (tap_fd < 0) return;
+    // Write out the ethernet frame to the tap device 
+    int rc = write(tap_fd, packet, size);
+    if (rc < 0) {
+        log_error("TAP: Could not write to TAP device: %s", strerror(errno));
+    } else 
+    if (rc != size) {
+        log_error("TAP: Package written only partially %d of %d bytes", rc, size);
+    }
+}
+
+// Bridge
+
+static uint8_t bridge_port_for_addr(const uint8_t * addr){
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if (bridge_channels[i].bnep_cid == 0) continue;
+        if (bd_addr_cmp(addr, bridge_channels[i].remote_addr) == 0) return (uint8_t) i;
+    }
+    for (i=0;i<bridge_num_addresses;i++){
+        if (bd_addr_cmp(addr, bridge_addresses[i].addr) == 0) return bridge_addresses[i].port;
+    }
+    return BRIDGE_PORT_UNKNOWN;
+}
+
+static void bridge_learn_address(const uint8_t * addr, uint8_t port){
+    // ignore multicast addresses and remote addresses of bridged channels
+    if ((addr[0] & 0x01) != 0) return;
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if (bridge_channels[i].bnep_cid == 0) continue;
+        if (bd_addr_cmp(addr, bridge_channels[i].remote_addr) == 0) return;
+    }
+    for (i=0;i<bridge_num_addresses;i++){
+        if (bd_addr_cmp(addr, bridge_addresses[i].addr) == 0){
+            bridge_addresses[i].port = port;
+            return;
+        }
+    }
+    // add or replace oldest entry
+    if (bridge_num_addresses < BTSTACK_NETWORK_POSIX_NUM_LEARNED_ADDRESSES){
+        i = bridge_num_addresses++;
+    } else {
+        i = bridge_next_address;
+        bridge_next_address = (bridge_next_address + 1) % BTSTACK_NETWORK_POSIX_NUM_LEARNED_ADDRESSES;
+    }
+    bd_addr_copy(bridge_addresses[i].addr, (uint8_t *) addr);
+    bridge_addresses[i].port = port;
+}
+
+static void bridge_frame_sent(bnep_tx_frame_t * tx, uint8_t status){
+    UNUSED(status);
+    network_frame_t * frame = (network_frame_t *) tx->context;
+    frame->ref_count--;
+    if (frame->ref_count == 0){
+        network_frame_release(frame);
+    }
+}
+
+// queue frame for all bridged channels in port mask, releases frame if not queued
+static void bridge_send_frame(network_frame_t * frame, uint32_t port_mask){
+    // keep frame while queueing as bnep_send_frame might send it and call bridge_frame_sent right away
+    frame->ref_count = 1;
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if ((port_mask & (1u << i)) == 0u) continue;
+        bnep_tx_frame_t * tx = &frame->tx[i];
+        tx->data     = frame->data;
+        tx->len      = frame->len;
+        tx->callback = &bridge_frame_sent;
+        tx->context  = frame;
+        frame->ref_count++;
+        if (bnep_send_frame(bridge_channels[i].bnep_cid, tx) != ERROR_CODE_SUCCESS){
+            frame->ref_count--;
+        }
+    }
+    frame->ref_count--;
+    if (frame->ref_count == 0){
+        network_frame_release(frame);
+    }
+}
+
+// @returns mask of bridged channels for destination address, excluding source port
+static uint32_t bridge_port_mask_for_destination(const uint8_t * addr_dest, uint8_t source_port, int * to_network){
+    uint32_t all_channels = 0;
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if (bridge_channels[i].bnep_cid == 0) continue;
+        if (i == source_port) continue;
+        all_channels |= 1u << i;
+    }
+    // broadcast/multicast: flood
+    if ((addr_dest[0] & 0x01) != 0){
+        *to_network = source_port != BRIDGE_PORT_NETWORK;
+        return all_channels;
+    }
+    uint8_t port = bridge_port_for_addr(addr_dest);
+    switch (port){
+        case BRIDGE_PORT_UNKNOWN:
+            // frames from network for unknown destination are flooded to all channels, frames from channels go to network
+            *to_network = source_port != BRIDGE_PORT_NETWORK;
+            return (source_port == BRIDGE_PORT_NETWORK) ? all_channels : 0;
+        case BRIDGE_PORT_NETWORK:
+            *to_network = source_port != BRIDGE_PORT_NETWORK;
+            return 0;
+        default:
+            *to_network = 0;
+            if (port == source_port) return 0;
+            return 1u << port;
+    }
+}
+
 /*
  * @text Listing processTapData shows how a packet is received from the TAP network interface
  * and forwarded over the BNEP connection.
  * 
- * After successfully reading a network packet, the call to
- * the *bnep_can_send_packet_now* function checks, if BTstack can forward
- * a network packet now. If that's not possible, the received data stays
- * in the network buffer and the data source elements is removed from the
- * run loop. The *process_tap_dev_data* function will not be called until
- * the data source is registered again. This provides a basic flow control.
+ * Network packets are read into a pool of frame buffers as long as frames are available.
+ * If BNEP channels are bridged, the frame is queued for all channels with matching destination
+ * via *bnep_send_frame* and released after it was sent. Otherwise, it is passed to the
+ * send_packet_callback and released by *btstack_network_packet_sent*. If all frames are in use,
+ * the data source callbacks are disabled until a frame gets released. This provides a basic flow control.
  */
 
+static void network_deliver_pending_frame(void){
+    network_frame_t * frame = (network_frame_t *) network_frames_pending;
+    if (frame == NULL) return;
+    (*btstack_network_send_packet_callback)(frame->data, frame->len);
+}
+
 /* LISTING_START(processTapData): Process incoming network packets */
 static void process_tap_dev_data(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type) 
 {
-    UNUSED(ds);
     UNUSED(callback_type);
 
-    ssize_t len;
-    len = read(ds->source.fd, network_buffer, sizeof(network_buffer));
-    if (len <= 0){
-        fprintf(stderr, "TAP: Error while reading: %s\n", strerror(errno));
-        return;
+    while (network_frames_free != NULL){
+        network_frame_t * frame = (network_frame_t *) network_frames_free;
+        ssize_t len = read(ds->source.fd, frame->data, sizeof(frame->data));
+        if (len <= 0){
+            if ((len < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)){
+                fprintf(stderr, "TAP: Error while reading: %s\n", strerror(errno));
+            }
+            return;
+        }
+        btstack_linked_list_pop(&network_frames_free);
+        frame->len = (uint16_t) len;
+
+        if (bridge_num_channels > 0){
+            int to_network;
+            uint32_t port_mask = bridge_port_mask_for_destination(frame->data, BRIDGE_PORT_NETWORK, &to_network);
+            bridge_send_frame(frame, port_mask);
+        } else {
+            int deliver = network_frames_pending == NULL;
+            btstack_linked_list_add_tail(&network_frames_pending, (btstack_linked_item_t *) frame);
+            // let client know
+            if (deliver){
+                network_deliver_pending_frame();
+            }
+        }
     }
 
-    network_buffer_len = len;
-
-    // disable reading from netif
+    // all frames in use: disable reading from netif
+    tap_dev_read_enabled = 0;
     btstack_run_loop_disable_data_source_callbacks(&tap_dev_ds, DATA_SOURCE_CALLBACK_READ);
-
-    // let client now
-    (*btstack_network_send_packet_callback)(network_buffer, network_buffer_len);
 }
+/* LISTING_END */
 
 /**
  * @brief Initialize network interface
@@ -139,6 +336,7 @@ static void process_tap_dev_data(btstack_data_source_t *ds, btstack_data_source_
  */
 void btstack_network_init(void (*send_packet_callback)(const uint8_t * packet, uint16_t size)){
     btstack_network_send_packet_callback = send_packet_callback;
+    network_frames_init();
 }
 
 /**
@@ -240,6 +438,16 @@ int btstack_network_up(bd_addr_t network_address){
 
     close(fd_socket);
 
+    // read all available frames per data source callback
+    int flags = fcntl(fd_dev, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(fd_dev, F_SETFL, flags | O_NONBLOCK) < 0)){
+        close(fd_dev);
+        fprintf(stderr, "TAP: Error setting non-blocking mode: %s\n", strerror(errno));
+        return -1;
+    }
+
+    network_frames_init();
+
     tap_fd = fd_dev;
     log_info("BNEP device \"%s\" allocated", tap_dev_name);
 
@@ -247,6 +455,7 @@ int btstack_network_up(bd_addr_t network_address){
     btstack_run_loop_set_data_source_fd(&tap_dev_ds, tap_fd);
     btstack_run_loop_set_data_source_handler(&tap_dev_ds, &process_tap_dev_data);
     btstack_run_loop_add_data_source(&tap_dev_ds);
+    tap_dev_read_enabled = 1;
     btstack_run_loop_enable_data_source_callbacks(&tap_dev_ds, DATA_SOURCE_CALLBACK_READ);
 
     return 0;
@@ -273,6 +482,11 @@ int btstack_network_down(void){
         close(tap_fd);
     }
     tap_fd = -1;
+    tap_dev_read_enabled = 0;
+    // drop frames not delivered to client, bridged frames are released by BNEP
+    while (network_frames_pending != NULL){
+        network_frame_release((network_frame_t *) btstack_linked_list_pop(&network_frames_pending));
+    }
     return 0;
 }
 
@@ -282,26 +496,103 @@ int btstack_network_down(void){
  * @param size
  */
 void btstack_network_process_packet(const uint8_t * packet, uint16_t size){
-
-    if (tap_fd < 0) return;
-    // Write out the ethernet frame to the tap device 
-
-    int rc = write(tap_fd, packet, size);
-    if (rc < 0) {
-        log_error("TAP: Could not write to TAP device: %s", strerror(errno));
-    } else 
-    if (rc != size) {
-        log_error("TAP: Package written only partially %d of %d bytes", rc, size);
-    }
+    network_write_frame(packet, size);
 }
 
 /** 
  * @brief Notify network interface that packet from send_packet_callback was sent and the next packet can be delivered.
  */
 void btstack_network_packet_sent(void){
+    network_frame_t * frame = (network_frame_t *) btstack_linked_list_pop(&network_frames_pending);
+    if (frame == NULL) return;
+    network_frame_release(frame);
+    // deliver next frame
+    network_deliver_pending_frame();
+}
+
+/**
+ * @brief Add BNEP channel to bridge
+ * @param bnep_cid
+ * @param remote_addr
+ * @return 0 if ok
+ */
+int btstack_network_bridge_add_channel(uint16_t bnep_cid, bd_addr_t remote_addr){
+    network_frames_init();
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if (bridge_channels[i].bnep_cid != 0) continue;
+        bridge_channels[i].bnep_cid = bnep_cid;
+        bd_addr_copy(bridge_channels[i].remote_addr, remote_addr);
+        bridge_num_channels++;
+        // frames not yet delivered to send_packet_callback are forwarded to bridged channels from now on
+        while (network_frames_pending != NULL){
+            network_frame_t * frame = (network_frame_t *) btstack_linked_list_pop(&network_frames_pending);
+            int to_network;
+            bridge_send_frame(frame, bridge_port_mask_for_destination(frame->data, BRIDGE_PORT_NETWORK, &to_network));
+        }
+        return 0;
+    }
+    return -1;
+}
 
-    network_buffer_len = 0;
+/**
+ * @brief Remove BNEP channel from bridge
+ * @param bnep_cid
+ */
+void btstack_network_bridge_remove_channel(uint16_t bnep_cid){
+    int i;
+    for (i=0;i<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;i++){
+        if (bridge_channels[i].bnep_cid != bnep_cid) continue;
+        bridge_channels[i].bnep_cid = 0;
+        bridge_num_channels--;
+        // forget addresses learned on this channel
+        int j = 0;
+        while (j < bridge_num_addresses){
+            if (bridge_addresses[j].port == i){
+                bridge_num_addresses--;
+                bridge_addresses[j] = bridge_addresses[bridge_num_addresses];
+            } else {
+                j++;
+            }
+        }
+        bridge_next_address = 0;
+        return;
+    }
+}
 
-    // Re-enable the tap device data source
-    btstack_run_loop_enable_data_source_callbacks(&tap_dev_ds, DATA_SOURCE_CALLBACK_READ);
+/**
+ * @brief Forward ethernet frame received on bridged BNEP channel to network interface and/or other bridged channels
+ * @param bnep_cid
+ * @param packet
+ * @param size
+ */
+void btstack_network_bridge_process_packet(uint16_t bnep_cid, const uint8_t * packet, uint16_t size){
+    if (size < 14) return;
+    uint8_t port;
+    for (port=0;port<BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS;port++){
+        if (bridge_channels[port].bnep_cid == bnep_cid) break;
+    }
+    if (port == BTSTACK_NETWORK_POSIX_MAX_BRIDGE_CHANNELS){
+        network_write_frame(packet, size);
+        return;
+    }
+
+    bridge_learn_address(&packet[6], port);
+
+    int to_network;
+    uint32_t port_mask = bridge_port_mask_for_destination(packet, port, &to_network);
+    if (to_network){
+        network_write_frame(packet, size);
+    }
+    if (port_mask == 0u) return;
+
+    // packet buffer is only valid during this call, copy into frame for other channels
+    if ((network_frames_free == NULL) || (size > BNEP_MTU_MIN)){
+        log_info("bridge: no free frame, drop frame for other channels");
+        return;
+    }
+    network_frame_t * frame = (network_frame_t *) btstack_linked_list_pop(&network_frames_free);
+    (void)memcpy(frame->data, packet, size);
+    frame->len = size;
+    bridge_send_frame(frame, port_mask);
 }
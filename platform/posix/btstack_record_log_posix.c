@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY MATTHIAS RINGWALD AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_record_log_posix.c"
+
+// enable POSIX functions (needed for -std=c99)
+#define _POSIX_C_SOURCE 200809
+
+/*
+ *  btstack_record_log_posix.c
+ *
+ *  Key/value records with in-memory hash index, persisted in a binary append-only log file
+ */
+
+#include "btstack_record_log_posix.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+
+#include <stdio.h>        // fileno
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>        // open
+#include <unistd.h>       // fsync, ftruncate, close
+#endif
+
+// Header:
+// - Magic: 'BTrlog' + version 1 + 0
+
+// Records:
+// - Type:      8 bit - put or delete
+// - Key Len:   8 bit
+// - Value Len: 16 bit little endian, 0 for delete
+// - Key
+// - Value
+
+#define RECORD_LOG_HEADER_LEN 8
+#define RECORD_HEADER_LEN     4
+
+#define RECORD_TYPE_PUT       1
+#define RECORD_TYPE_DELETE    2
+
+// initial number of hash buckets, power of two
+#define RECORD_LOG_INITIAL_BUCKETS 64
+
+// compact if log contains more than twice the number of current records plus this
+#define RECORD_LOG_COMPACT_MIN_RECORDS 64
+
+static const uint8_t btstack_record_log_posix_header[RECORD_LOG_HEADER_LEN] = { 'B', 'T', 'r', 'l', 'o', 'g', 1, 0 };
+
+#define DUMMY_SIZE 4
+struct btstack_record_log_posix_entry {
+    btstack_record_log_posix_entry_t * next;
+    uint16_t value_len;
+    uint8_t  key_len;
+    uint8_t  data[DUMMY_SIZE];  // key followed by value
+};
+
+// FNV-1a
+static uint32_t btstack_record_log_posix_hash(const uint8_t * key, uint8_t key_len){
+    uint32_t hash = 2166136261u;
+    uint8_t i;
+    for (i=0;i<key_len;i++){
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static btstack_record_log_posix_entry_t ** btstack_record_log_posix_bucket(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len){
+    return &log->buckets[btstack_record_log_posix_hash(key, key_len) & (log->num_buckets - 1u)];
+}
+
+// @returns pointer to link that points to entry, or NULL
+static btstack_record_log_posix_entry_t ** btstack_record_log_posix_find(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len){
+    if (log->num_buckets == 0u) return NULL;
+    btstack_record_log_posix_entry_t ** link = btstack_record_log_posix_bucket(log, key, key_len);
+    while (*link != NULL){
+        btstack_record_log_posix_entry_t * entry = *link;
+        if ((entry->key_len == key_len) && (memcmp(entry->data, key, key_len) == 0)) return link;
+        link = &entry->next;
+    }
+    return NULL;
+}
+
+static void btstack_record_log_posix_grow(btstack_record_log_posix_t * log){
+    uint32_t num_buckets = log->num_buckets * 2u;
+    btstack_record_log_posix_entry_t ** buckets = (btstack_record_log_posix_entry_t **) calloc(num_buckets, sizeof(btstack_record_log_posix_entry_t *));
+    if (buckets == NULL) return;
+    uint32_t i;
+    for (i=0;i<log->num_buckets;i++){
+        btstack_record_log_posix_entry_t * entry = log->buckets[i];
+        while (entry != NULL){
+            btstack_record_log_posix_entry_t * next = entry->next;
+            uint32_t pos = btstack_record_log_posix_hash(entry->data, entry->key_len) & (num_buckets - 1u);
+            entry->next = buckets[pos];
+            buckets[pos] = entry;
+            entry = next;
+        }
+    }
+    free(log->buckets);
+    log->buckets = buckets;
+    log->num_buckets = num_buckets;
+}
+
+// set next entry of iterator to the one following entry
+static void btstack_record_log_posix_iterator_advance(btstack_record_log_posix_iterator_t * it, btstack_record_log_posix_entry_t * entry){
+    it->next = entry->next;
+    while ((it->next == NULL) && ((it->bucket + 1u) < it->log->num_buckets)){
+        it->bucket++;
+        it->next = it->log->buckets[it->bucket];
+    }
+}
+
+// keep iterators valid if entry gets replaced (new_entry != NULL) or removed
+static void btstack_record_log_posix_iterators_update(btstack_record_log_posix_t * log, btstack_record_log_posix_entry_t * old_entry, btstack_record_log_posix_entry_t * new_entry){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &log->iterators);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        btstack_record_log_posix_iterator_t * log_it = (btstack_record_log_posix_iterator_t *) btstack_linked_list_iterator_next(&it);
+        if (log_it->next != old_entry) continue;
+        if (new_entry != NULL){
+            log_it->next = new_entry;
+        } else {
+            btstack_record_log_posix_iterator_advance(log_it, old_entry);
+        }
+    }
+}
+
+static btstack_record_log_posix_entry_t * btstack_record_log_posix_entry_create(const uint8_t * key, uint8_t key_len, const uint8_t * value, uint16_t value_len){
+    btstack_record_log_posix_entry_t * entry = (btstack_record_log_posix_entry_t *) malloc(sizeof(btstack_record_log_posix_entry_t) - DUMMY_SIZE + key_len + value_len);
+    if (entry == NULL) return NULL;
+    entry->next = NULL;
+    entry->key_len = key_len;
+    entry->value_len = value_len;
+    memcpy(&entry->data[0], key, key_len);
+    memcpy(&entry->data[key_len], value, value_len);
+    return entry;
+}
+
+// add new entry or replace existing entry with same key
+static void btstack_record_log_posix_index_insert(btstack_record_log_posix_t * log, btstack_record_log_posix_entry_t * new_entry){
+    const uint8_t * key = &new_entry->data[0];
+    uint8_t key_len = new_entry->key_len;
+    btstack_record_log_posix_entry_t ** link = btstack_record_log_posix_find(log, key, key_len);
+    if (link != NULL){
+        // replace
+        btstack_record_log_posix_entry_t * old_entry = *link;
+        new_entry->next = old_entry->next;
+        *link = new_entry;
+        btstack_record_log_posix_iterators_update(log, old_entry, new_entry);
+        free(old_entry);
+        return;
+    }
+
+    // rehashing would invalidate bucket positions of active iterators
+    if ((log->num_entries >= log->num_buckets) && btstack_linked_list_empty(&log->iterators)){
+        btstack_record_log_posix_grow(log);
+    }
+    link = btstack_record_log_posix_bucket(log, key, key_len);
+    new_entry->next = *link;
+    *link = new_entry;
+    log->num_entries++;
+}
+
+// @returns 1 if key was found
+static int btstack_record_log_posix_index_remove(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len){
+    btstack_record_log_posix_entry_t ** link = btstack_record_log_posix_find(log, key, key_len);
+    if (link == NULL) return 0;
+    btstack_record_log_posix_entry_t * entry = *link;
+    btstack_record_log_posix_iterators_update(log, entry, NULL);
+    *link = entry->next;
+    free(entry);
+    log->num_entries--;
+    return 1;
+}
+
+static void btstack_record_log_posix_index_free(btstack_record_log_posix_t * log){
+    uint32_t i;
+    for (i=0;i<log->num_buckets;i++){
+        btstack_record_log_posix_entry_t * entry = log->buckets[i];
+        while (entry != NULL){
+            btstack_record_log_posix_entry_t * next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(log->buckets);
+    log->buckets = NULL;
+    log->num_buckets = 0;
+    log->num_entries = 0;
+}
+
+static void btstack_record_log_posix_fsync(FILE * file){
+    fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+// fsync directory that contains path, so that a created or renamed log file survives a power loss
+static void btstack_record_log_posix_fsync_directory(const char * path){
+#ifdef _WIN32
+    UNUSED(path);
+#else
+    const char * separator = strrchr(path, '/');
+    size_t len = 1;
+    if (separator != NULL){
+        // keep '/' for root directory
+        len = (separator == path) ? 1u : (size_t) (separator - path);
+    }
+    char * directory = (char *) malloc(len + 1);
+    if (directory == NULL) return;
+    if (separator == NULL){
+        directory[0] = '.';
+    } else {
+        memcpy(directory, path, len);
+    }
+    directory[len] = 0;
+    int fd = open(directory, O_RDONLY);
+    if (fd >= 0){
+        if (fsync(fd) != 0){
+            log_error("fsync %s failed", directory);
+        }
+        close(fd);
+    }
+    free(directory);
+#endif
+}
+
+// @returns 0 on success
+static int btstack_record_log_posix_write_record(FILE * file, uint8_t type, const uint8_t * key, uint8_t key_len, const uint8_t * value, uint16_t value_len){
+    uint8_t header[RECORD_HEADER_LEN];
+    header[0] = type;
+    header[1] = key_len;
+    little_endian_store_16(header, 2, value_len);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) return 1;
+    if (fwrite(key, 1, key_len, file) != key_len) return 1;
+    if (value_len > 0u){
+        if (fwrite(value, 1, value_len, file) != value_len) return 1;
+    }
+    return 0;
+}
+
+// @returns 0 on success
+static int btstack_record_log_posix_append(btstack_record_log_posix_t * log, uint8_t type, const uint8_t * key, uint8_t key_len, const uint8_t * value, uint16_t value_len){
+    if (log->file == NULL) return 1;
+    int err = btstack_record_log_posix_write_record(log->file, type, key, key_len, value, value_len);
+    // flush to OS for each record, fsync in batches
+    fflush(log->file);
+    if (err != 0){
+        log_error("append to %s failed", log->path);
+        return err;
+    }
+    log->num_records++;
+    log->num_records_unsynced++;
+    if ((log->sync_interval > 0u) && (log->num_records_unsynced >= log->sync_interval)){
+        btstack_record_log_posix_sync(log);
+    }
+    return 0;
+}
+
+static void btstack_record_log_posix_compact_if_needed(btstack_record_log_posix_t * log){
+    if (log->num_records <= ((2u * log->num_entries) + RECORD_LOG_COMPACT_MIN_RECORDS)) return;
+    btstack_record_log_posix_compact(log);
+}
+
+static int btstack_record_log_posix_create(btstack_record_log_posix_t * log){
+    log->file = fopen(log->path, "w+b");
+    if (log->file == NULL){
+        log_error("failed to create %s", log->path);
+        return 1;
+    }
+    fwrite(btstack_record_log_posix_header, 1, sizeof(btstack_record_log_posix_header), log->file);
+    btstack_record_log_posix_fsync(log->file);
+    btstack_record_log_posix_fsync_directory(log->path);
+    log->num_records = 0;
+    log->num_records_unsynced = 0;
+    return 0;
+}
+
+// read all records, @returns offset after last complete record or 0 if header is invalid
+static long btstack_record_log_posix_read(btstack_record_log_posix_t * log){
+    uint8_t header[RECORD_LOG_HEADER_LEN];
+    if (fread(header, 1, sizeof(header), log->file) != sizeof(header)) return 0;
+    if (memcmp(header, btstack_record_log_posix_header, sizeof(header)) != 0) return 0;
+
+    uint8_t * buffer = (uint8_t *) malloc(255 + 65535);
+    if (buffer == NULL) return 0;
+
+    long valid_offset = RECORD_LOG_HEADER_LEN;
+    while (true){
+        uint8_t record_header[RECORD_HEADER_LEN];
+        if (fread(record_header, 1, sizeof(record_header), log->file) != sizeof(record_header)) break;
+        uint8_t  type      = record_header[0];
+        uint8_t  key_len   = record_header[1];
+        uint16_t value_len = little_endian_read_16(record_header, 2);
+        if ((type != RECORD_TYPE_PUT) && (type != RECORD_TYPE_DELETE)) break;
+        uint32_t len = key_len + value_len;
+        if (fread(buffer, 1, len, log->file) != len) break;
+        if (type == RECORD_TYPE_PUT){
+            btstack_record_log_posix_entry_t * entry = btstack_record_log_posix_entry_create(&buffer[0], key_len, &buffer[key_len], value_len);
+            if (entry != NULL){
+                btstack_record_log_posix_index_insert(log, entry);
+            }
+        } else {
+            btstack_record_log_posix_index_remove(log, &buffer[0], key_len);
+        }
+        log->num_records++;
+        valid_offset += (long) (RECORD_HEADER_LEN + len);
+    }
+    free(buffer);
+    return valid_offset;
+}
+
+int btstack_record_log_posix_open(btstack_record_log_posix_t * log, const char * path, uint32_t sync_interval){
+    memset(log, 0, sizeof(btstack_record_log_posix_t));
+    log->sync_interval = sync_interval;
+    log->path = (char *) malloc(strlen(path) + 1);
+    log->num_buckets = RECORD_LOG_INITIAL_BUCKETS;
+    log->buckets = (btstack_record_log_posix_entry_t **) calloc(log->num_buckets, sizeof(btstack_record_log_posix_entry_t *));
+    if ((log->path == NULL) || (log->buckets == NULL)){
+        btstack_record_log_posix_close(log);
+        return 1;
+    }
+    strcpy(log->path, path);
+
+    log->file = fopen(path, "r+b");
+    if (log->file != NULL){
+        long valid_offset = btstack_record_log_posix_read(log);
+        if (valid_offset == 0){
+            log_error("%s is not a valid record log, re-create", path);
+            fclose(log->file);
+            log->file = NULL;
+            btstack_record_log_posix_index_free(log);
+            log->num_buckets = RECORD_LOG_INITIAL_BUCKETS;
+            log->buckets = (btstack_record_log_posix_entry_t **) calloc(log->num_buckets, sizeof(btstack_record_log_posix_entry_t *));
+        } else {
+            // drop incomplete record at the end
+            fseek(log->file, 0, SEEK_END);
+            if (ftell(log->file) != valid_offset){
+                log_info("drop incomplete record at offset %ld", valid_offset);
+                fflush(log->file);
+#ifdef _WIN32
+                _chsize(_fileno(log->file), valid_offset);
+#else
+                if (ftruncate(fileno(log->file), valid_offset) != 0){
+                    log_error("truncate %s failed", path);
+                }
+#endif
+            }
+            fseek(log->file, valid_offset, SEEK_SET);
+            log_info("%s: %u records, %u keys", path, (unsigned int) log->num_records, (unsigned int) log->num_entries);
+        }
+    }
+
+    if (log->file == NULL){
+        if (btstack_record_log_posix_create(log) != 0){
+            btstack_record_log_posix_close(log);
+            return 1;
+        }
+    }
+
+    btstack_record_log_posix_compact_if_needed(log);
+    return 0;
+}
+
+int btstack_record_log_posix_exists(const char * path){
+    FILE * file = fopen(path, "rb");
+    if (file == NULL) return 0;
+    fclose(file);
+    return 1;
+}
+
+void btstack_record_log_posix_close(btstack_record_log_posix_t * log){
+    if (log->file != NULL){
+        btstack_record_log_posix_sync(log);
+        fclose(log->file);
+        log->file = NULL;
+    }
+    btstack_record_log_posix_index_free(log);
+    log->iterators = NULL;
+    free(log->path);
+    log->path = NULL;
+}
+
+int btstack_record_log_posix_get(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len, const uint8_t ** value, uint16_t * value_len){
+    btstack_record_log_posix_entry_t ** link = btstack_record_log_posix_find(log, key, key_len);
+    if (link == NULL) return 0;
+    btstack_record_log_posix_entry_t * entry = *link;
+    if (value != NULL) *value = &entry->data[entry->key_len];
+    if (value_len != NULL) *value_len = entry->value_len;
+    return 1;
+}
+
+int btstack_record_log_posix_put(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len, const uint8_t * value, uint16_t value_len){
+    // skip if unchanged
+    btstack_record_log_posix_entry_t ** link = btstack_record_log_posix_find(log, key, key_len);
+    if (link != NULL){
+        btstack_record_log_posix_entry_t * entry = *link;
+        if ((entry->value_len == value_len) && (memcmp(&entry->data[key_len], value, value_len) == 0)) return 0;
+    }
+    // allocate entry first, so that index and log stay consistent if either fails
+    btstack_record_log_posix_entry_t * entry = btstack_record_log_posix_entry_create(key, key_len, value, value_len);
+    if (entry == NULL) return 1;
+    int err = btstack_record_log_posix_append(log, RECORD_TYPE_PUT, key, key_len, value, value_len);
+    if (err != 0){
+        free(entry);
+        return err;
+    }
+    btstack_record_log_posix_index_insert(log, entry);
+    btstack_record_log_posix_compact_if_needed(log);
+    return 0;
+}
+
+void btstack_record_log_posix_delete(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len){
+    if (btstack_record_log_posix_find(log, key, key_len) == NULL) return;
+    // append before removing from index, key might point into entry
+    btstack_record_log_posix_append(log, RECORD_TYPE_DELETE, key, key_len, NULL, 0);
+    btstack_record_log_posix_index_remove(log, key, key_len);
+    btstack_record_log_posix_compact_if_needed(log);
+}
+
+uint32_t btstack_record_log_posix_count(btstack_record_log_posix_t * log){
+    return log->num_entries;
+}
+
+void btstack_record_log_posix_sync(btstack_record_log_posix_t * log){
+    if (log->file == NULL) return;
+    if (log->num_records_unsynced == 0u) return;
+    btstack_record_log_posix_fsync(log->file);
+    log->num_records_unsynced = 0;
+}
+
+int btstack_record_log_posix_compact(btstack_record_log_posix_t * log){
+    if (log->file == NULL) return 1;
+
+    char * tmp_path = (char *) malloc(strlen(log->path) + 5);
+    if (tmp_path == NULL) return 1;
+    strcpy(tmp_path, log->path);
+    strcat(tmp_path, ".tmp");
+
+    FILE * file = fopen(tmp_path, "w+b");
+    if (file == NULL){
+        log_error("failed to create %s", tmp_path);
+        free(tmp_path);
+        return 1;
+    }
+
+    // write current records
+    int err = 0;
+    if (fwrite(btstack_record_log_posix_header, 1, sizeof(btstack_record_log_posix_header), file) != sizeof(btstack_record_log_posix_header)){
+        err = 1;
+    }
+    uint32_t i;
+    for (i=0;(i<log->num_buckets) && (err == 0);i++){
+        btstack_record_log_posix_entry_t * entry;
+        for (entry = log->buckets[i]; (entry != NULL) && (err == 0); entry = entry->next){
+            err = btstack_record_log_posix_write_record(file, RECORD_TYPE_PUT, &entry->data[0], entry->key_len, &entry->data[entry->key_len], entry->value_len);
+        }
+    }
+    btstack_record_log_posix_fsync(file);
+    if (err != 0){
+        log_error("failed to write %s", tmp_path);
+        fclose(file);
+        remove(tmp_path);
+        free(tmp_path);
+        return err;
+    }
+
+    // replace log file
+    fclose(log->file);
+    log->file = NULL;
+#ifdef _WIN32
+    remove(log->path);
+#endif
+    if (rename(tmp_path, log->path) != 0){
+        log_error("failed to rename %s", tmp_path);
+        fclose(file);
+        free(tmp_path);
+        // continue with old log file
+        log->file = fopen(log->path, "r+b");
+        if (log->file == NULL) return 1;
+        fseek(log->file, 0, SEEK_END);
+        return 1;
+    }
+    free(tmp_path);
+    btstack_record_log_posix_fsync_directory(log->path);
+    log->file = file;
+    fseek(log->file, 0, SEEK_END);
+    log_info("compacted %s: %u -> %u records", log->path, (unsigned int) log->num_records, (unsigned int) log->num_entries);
+    log->num_records = log->num_entries;
+    log->num_records_unsynced = 0;
+    return 0;
+}
+
+void btstack_record_log_posix_iterator_init(btstack_record_log_posix_iterator_t * it, btstack_record_log_posix_t * log){
+    it->log = log;
+    it->next = NULL;
+    for (it->bucket = 0; it->bucket < log->num_buckets; it->bucket++){
+        it->next = log->buckets[it->bucket];
+        if (it->next != NULL) break;
+    }
+    btstack_linked_list_add(&log->iterators, &it->item);
+}
+
+int btstack_record_log_posix_iterator_next(btstack_record_log_posix_iterator_t * it, const uint8_t ** key, uint8_t * key_len, const uint8_t ** value, uint16_t * value_len){
+    btstack_record_log_posix_entry_t * entry = it->next;
+    if (entry == NULL) return 0;
+
+    // find next entry before returning current one, which may get deleted
+    btstack_record_log_posix_iterator_advance(it, entry);
+
+    if (key != NULL) *key = &entry->data[0];
+    if (key_len != NULL) *key_len = entry->key_len;
+    if (value != NULL) *value = &entry->data[entry->key_len];
+    if (value_len != NULL) *value_len = entry->value_len;
+    return 1;
+}
+
+void btstack_record_log_posix_iterator_done(btstack_record_log_posix_iterator_t * it){
+    btstack_linked_list_remove(&it->log->iterators, &it->item);
+}
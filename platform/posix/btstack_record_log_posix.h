@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY MATTHIAS RINGWALD AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ *  btstack_record_log_posix.h
+ *
+ *  Key/value records with in-memory hash index, persisted in a binary append-only log file
+ */
+
+#ifndef BTSTACK_RECORD_LOG_POSIX_H
+#define BTSTACK_RECORD_LOG_POSIX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "btstack_linked_list.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// number of appended records before fsync, 0 = only on btstack_record_log_posix_sync and close
+#ifndef BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL
+#define BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL 16
+#endif
+
+typedef struct btstack_record_log_posix_entry btstack_record_log_posix_entry_t;
+
+typedef struct {
+    char * path;
+    FILE * file;
+    // hash index
+    btstack_record_log_posix_entry_t ** buckets;
+    uint32_t num_buckets;
+    uint32_t num_entries;
+    // records in file, used to trigger compaction
+    uint32_t num_records;
+    // fsync
+    uint32_t sync_interval;
+    uint32_t num_records_unsynced;
+    // active iterators, updated on delete
+    btstack_linked_list_t iterators;
+} btstack_record_log_posix_t;
+
+typedef struct {
+    btstack_linked_item_t item;
+    btstack_record_log_posix_t * log;
+    uint32_t bucket;
+    btstack_record_log_posix_entry_t * next;
+} btstack_record_log_posix_iterator_t;
+
+/**
+ * @brief Open log file and build index, creates file if needed
+ * @note Incomplete record at the end of the file, e.g. after power loss, is dropped
+ * @param log
+ * @param path
+ * @param sync_interval number of appended records before fsync, 0 = only on sync/close
+ * @returns 0 on success
+ */
+int btstack_record_log_posix_open(btstack_record_log_posix_t * log, const char * path, uint32_t sync_interval);
+
+/**
+ * @brief Check if log file exists, e.g. to import data from a previous format before first open
+ * @param path
+ * @returns 1 if file exists
+ */
+int btstack_record_log_posix_exists(const char * path);
+
+/**
+ * @brief Sync and close log file, free index
+ * @param log
+ */
+void btstack_record_log_posix_close(btstack_record_log_posix_t * log);
+
+/**
+ * @brief Get value for key
+ * @param log
+ * @param key
+ * @param key_len
+ * @param value pointer to value, valid until next put/delete
+ * @param value_len
+ * @returns 1 if found
+ */
+int btstack_record_log_posix_get(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len, const uint8_t ** value, uint16_t * value_len);
+
+/**
+ * @brief Store value for key, appends record if value changed
+ * @param log
+ * @param key
+ * @param key_len
+ * @param value
+ * @param value_len
+ * @returns 0 on success
+ */
+int btstack_record_log_posix_put(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len, const uint8_t * value, uint16_t value_len);
+
+/**
+ * @brief Delete key, appends delete record if key exists
+ * @param log
+ * @param key
+ * @param key_len
+ */
+void btstack_record_log_posix_delete(btstack_record_log_posix_t * log, const uint8_t * key, uint8_t key_len);
+
+/**
+ * @brief Number of stored keys
+ * @param log
+ */
+uint32_t btstack_record_log_posix_count(btstack_record_log_posix_t * log);
+
+/**
+ * @brief fsync pending records
+ * @param log
+ */
+void btstack_record_log_posix_sync(btstack_record_log_posix_t * log);
+
+/**
+ * @brief Rewrite log file with current records only
+ * @note called automatically if log file contains more than twice the number of records
+ * @note new file is written and fsync'ed before it replaces the log via rename, followed by fsync of the directory
+ * @param log
+ * @returns 0 on success
+ */
+int btstack_record_log_posix_compact(btstack_record_log_posix_t * log);
+
+/**
+ * @brief Iterate over all records
+ * @note any record can be deleted or updated while iterating, new records might not be returned
+ * @note iterator must be finished with btstack_record_log_posix_iterator_done
+ * @param it
+ * @param log
+ */
+void btstack_record_log_posix_iterator_init(btstack_record_log_posix_iterator_t * it, btstack_record_log_posix_t * log);
+
+/**
+ * @brief Get next record
+ * @param it
+ * @param key
+ * @param key_len
+ * @param value
+ * @param value_len
+ * @returns 1 if record available
+ */
+int btstack_record_log_posix_iterator_next(btstack_record_log_posix_iterator_t * it, const uint8_t ** key, uint8_t * key_len, const uint8_t ** value, uint16_t * value_len);
+
+/**
+ * @brief Finish iteration
+ * @param it
+ */
+void btstack_record_log_posix_iterator_done(btstack_record_log_posix_iterator_t * it);
+
+#if defined __cplusplus
+}
+#endif
+#endif // BTSTACK_RECORD_LOG_POSIX_H
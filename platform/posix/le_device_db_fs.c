@@ -42,6 +42,7 @@
 
 #include "btstack_config.h"
 #include "btstack_debug.h"
+#include "btstack_record_log_posix.h"
 #include "ble/le_device_db.h"
 #include "ble/core.h"
 
@@ -75,7 +76,9 @@ typedef struct le_device_memory_db {
 
 } le_device_memory_db_t;
 
+#ifndef LE_DEVICE_MEMORY_SIZE
 #define LE_DEVICE_MEMORY_SIZE 20
+#endif
 
 #ifndef LE_DEVICE_DB_PATH
 #ifdef _WIN32
@@ -85,18 +88,25 @@ typedef struct le_device_memory_db {
 #endif
 #endif
 
-#define DB_PATH_TEMPLATE (LE_DEVICE_DB_PATH "btstack_at_%s_le_device_db.txt")
+#define DB_PATH_TEMPLATE (LE_DEVICE_DB_PATH "btstack_at_%s_le_device_db.db")
 
-#ifdef ENABLE_LE_SIGNED_WRITE
-const  char * csv_header = "# addr_type, addr, irk, ltk, ediv, rand[8], key_size, authenticated, authorized, remote_csrk, remote_counter, local_csrk, local_counter, secure_connection";
-#else
-const  char * csv_header = "# addr_type, addr, irk, ltk, ediv, rand[8], key_size, authenticated, authorized, secure_connection";
-#endif
+// previous format: hex text file with one line per device, imported when the record log does not exist yet
+#define LEGACY_DB_PATH_TEMPLATE (LE_DEVICE_DB_PATH "btstack_at_%s_le_device_db.txt")
+
+// each device is stored as a record in a binary append-only log, key: 16-bit index
+// record: addr_type(1), addr(6), irk(16), ltk(16), ediv(2), rand(8), key_size(1), authenticated(1),
+//         authorized(1), secure_connection(1), remote_csrk(16), remote_counter(4), local_csrk(16), local_counter(4)
+// multi-byte values are little endian, signed write fields are zero if ENABLE_LE_SIGNED_WRITE is not set
+#define LE_DEVICE_RECORD_LEN 93
 
 static char db_path[sizeof(DB_PATH_TEMPLATE) - 2 + 17 + 1];
+static char legacy_db_path[sizeof(LEGACY_DB_PATH_TEMPLATE) - 2 + 17 + 1];
 
 static le_device_memory_db_t le_devices[LE_DEVICE_MEMORY_SIZE];
 
+static btstack_record_log_posix_t le_device_log;
+static int le_device_log_open;
+
 static char bd_addr_to_dash_str_buffer[6*3];  // 12-45-78-01-34-67\0
 static char * bd_addr_to_dash_str(bd_addr_t addr){
     char * p = bd_addr_to_dash_str_buffer;
@@ -110,149 +120,193 @@ static char * bd_addr_to_dash_str(bd_addr_t addr){
     return (char *) bd_addr_to_dash_str_buffer;
 }
 
-static inline void write_delimiter(FILE * wFile){
-    fwrite(",", 1, 1, wFile);
-}
-static inline void write_hex_byte(FILE * wFile, uint8_t value){
-    char buffer[2];
-    buffer[0] = char_for_nibble(value >>   4);
-    buffer[1] = char_for_nibble(value & 0x0f);
-    fwrite(buffer, 2, 1, wFile);
+static void le_device_db_serialize(const le_device_memory_db_t * device, uint8_t * record){
+    memset(record, 0, LE_DEVICE_RECORD_LEN);
+    record[0] = (uint8_t) device->addr_type;
+    memcpy(&record[1],  device->addr, 6);
+    memcpy(&record[7],  device->irk, 16);
+    memcpy(&record[23], device->ltk, 16);
+    little_endian_store_16(record, 39, device->ediv);
+    memcpy(&record[41], device->rand, 8);
+    record[49] = device->key_size;
+    record[50] = device->authenticated;
+    record[51] = device->authorized;
+    record[52] = device->secure_connection;
+#ifdef ENABLE_LE_SIGNED_WRITE
+    memcpy(&record[53], device->remote_csrk, 16);
+    little_endian_store_32(record, 69, device->remote_counter);
+    memcpy(&record[73], device->local_csrk, 16);
+    little_endian_store_32(record, 89, device->local_counter);
+#endif
 }
 
-static inline void write_str(FILE * wFile, const char * str){
-    fwrite(str, strlen(str), 1, wFile);
-    write_delimiter(wFile);
+static void le_device_db_deserialize(le_device_memory_db_t * device, const uint8_t * record){
+    memset(device, 0, sizeof(le_device_memory_db_t));
+    device->addr_type = record[0];
+    memcpy(device->addr, &record[1],  6);
+    memcpy(device->irk,  &record[7],  16);
+    memcpy(device->ltk,  &record[23], 16);
+    device->ediv = little_endian_read_16(record, 39);
+    memcpy(device->rand, &record[41], 8);
+    device->key_size          = record[49];
+    device->authenticated     = record[50];
+    device->authorized        = record[51];
+    device->secure_connection = record[52];
+#ifdef ENABLE_LE_SIGNED_WRITE
+    memcpy(device->remote_csrk, &record[53], 16);
+    device->remote_counter = little_endian_read_32(record, 69);
+    memcpy(device->local_csrk,  &record[73], 16);
+    device->local_counter  = little_endian_read_32(record, 89);
+#endif
 }
-static void write_hex(FILE * wFile, const uint8_t * value, int len){
-    int i;
-    for (i = 0; i < len; i++){
-        write_hex_byte(wFile, value[i]);
-    }
-    write_delimiter(wFile);
+
+static void le_device_db_close_log(void){
+    if (le_device_log_open == 0) return;
+    btstack_record_log_posix_close(&le_device_log);
+    le_device_log_open = 0;
 }
-static void write_value(FILE * wFile, uint32_t value, int len){
-    switch (len){
-        case 4:
-            write_hex_byte(wFile, value >> 24);
-        case 3:
-            write_hex_byte(wFile, value >> 16);
-        case 2:
-            write_hex_byte(wFile, value >> 8);
-        case 1:
-        default:
-            write_hex_byte(wFile, value);
+
+static int le_device_db_open_log(void){
+    if (btstack_record_log_posix_open(&le_device_log, db_path, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL) != 0){
+        log_error("le_device_db_fs: failed to open %s", db_path);
+        return 1;
     }
-    write_delimiter(wFile);
+    le_device_log_open = 1;
+    return 0;
 }
 
-static void le_device_db_store(void) {
-    int i;
-    // open file
-    FILE * wFile = fopen(db_path,"w+");
-    if (wFile == NULL) return;
-    fwrite(csv_header, strlen(csv_header), 1, wFile);
-    fwrite("\n", 1, 1, wFile);
-    for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
-        if (le_devices[i].addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
-        write_value(wFile, le_devices[i].addr_type, 1);
-        write_str(wFile,   bd_addr_to_str(le_devices[i].addr));
-        write_hex(wFile,   le_devices[i].irk, 16);
-        write_hex(wFile,   le_devices[i].ltk, 16);
-        write_value(wFile, le_devices[i].ediv, 2);
-        write_hex(wFile,   le_devices[i].rand, 8);
-        write_value(wFile, le_devices[i].key_size, 1);
-        write_value(wFile, le_devices[i].authenticated, 1);
-        write_value(wFile, le_devices[i].authorized, 1);
-#ifdef ENABLE_LE_SIGNED_WRITE
-        write_hex(wFile,   le_devices[i].remote_csrk, 16);
-        write_value(wFile, le_devices[i].remote_counter, 2);
-        write_hex(wFile,   le_devices[i].local_csrk, 16);
-        write_value(wFile, le_devices[i].local_counter, 2);
-#endif
-        write_value(wFile, le_devices[i].secure_connection, 1);
-        fwrite("\n", 1, 1, wFile);
+static void le_device_db_store_record(int index){
+    uint8_t key[2];
+    little_endian_store_16(key, 0, (uint16_t) index);
+    if (le_devices[index].addr_type == BD_ADDR_TYPE_UNKNOWN){
+        btstack_record_log_posix_delete(&le_device_log, key, sizeof(key));
+        return;
+    }
+    uint8_t record[LE_DEVICE_RECORD_LEN];
+    le_device_db_serialize(&le_devices[index], record);
+    if (btstack_record_log_posix_put(&le_device_log, key, sizeof(key), record, sizeof(record)) != 0){
+        log_error("le_device_db_fs: failed to store device %u", index);
     }
-    fclose(wFile);
 }
-static void read_delimiter(FILE * wFile){
-    fgetc(wFile);
+
+static void le_device_db_legacy_read_delimiter(FILE * file){
+    fgetc(file);
 }
 
-static uint8_t read_hex_byte(FILE * wFile){
-    int c = fgetc(wFile);
+static uint8_t le_device_db_legacy_read_hex_byte(FILE * file){
+    int c = fgetc(file);
     if (c == ':') {
-        c = fgetc(wFile);
+        c = fgetc(file);
     }
-    int d = fgetc(wFile);
-    return nibble_for_char(c) << 4 | nibble_for_char(d);
+    int d = fgetc(file);
+    return (uint8_t) ((nibble_for_char((char) c) << 4) | nibble_for_char((char) d));
 }
 
-static void read_hex(FILE * wFile, uint8_t * buffer, int len){
+static void le_device_db_legacy_read_hex(FILE * file, uint8_t * buffer, int len){
     int i;
     for (i=0;i<len;i++){
-        buffer[i] = read_hex_byte(wFile);
+        buffer[i] = le_device_db_legacy_read_hex_byte(file);
     }
-    read_delimiter(wFile);
+    le_device_db_legacy_read_delimiter(file);
 }
 
-static uint32_t read_value(FILE * wFile, int len){
+static uint32_t le_device_db_legacy_read_value(FILE * file, int len){
     uint32_t res = 0;
     int i;
     for (i=0;i<len;i++){
-        res = res << 8 | read_hex_byte(wFile);
+        res = (res << 8) | le_device_db_legacy_read_hex_byte(file);
     }
-    read_delimiter(wFile);
+    le_device_db_legacy_read_delimiter(file);
     return res;
 }
 
-static void le_device_db_read(void){
-    // open file
-    FILE * wFile = fopen(db_path,"r");
-    if (wFile == NULL) return;
+// legacy file is kept, it is not read again once the record log exists
+static void le_device_db_import_legacy(void){
+    FILE * file = fopen(legacy_db_path, "r");
+    if (file == NULL) return;
     // skip header
-    while (true) {
-        int c = fgetc(wFile);
-        if (feof(wFile)) goto exit;
-        if (c == '\n') break;
-    }
-    // read entries
+    int c;
+    do {
+        c = fgetc(file);
+    } while ((c != EOF) && (c != '\n'));
     int i;
-    for (i=0 ; i<LE_DEVICE_MEMORY_SIZE ; i++){
-        memset(&le_devices[i], 0, sizeof(le_device_memory_db_t));
-        le_devices[i].addr_type = read_value(wFile, 1);
-        if (feof(wFile)){
-            le_devices[i].addr_type = BD_ADDR_TYPE_UNKNOWN;
+    for (i=0 ; (c != EOF) && (i<LE_DEVICE_MEMORY_SIZE) ; i++){
+        le_device_memory_db_t * device = &le_devices[i];
+        memset(device, 0, sizeof(le_device_memory_db_t));
+        device->addr_type = (int) le_device_db_legacy_read_value(file, 1);
+        if (feof(file)){
+            device->addr_type = BD_ADDR_TYPE_UNKNOWN;
             break;
         }
-        read_hex(wFile,   le_devices[i].addr, 6);
-        read_hex(wFile,   le_devices[i].irk, 16);
-        read_hex(wFile,   le_devices[i].ltk, 16);
-        le_devices[i].ediv = read_value(wFile, 2);
-        read_hex(wFile,   le_devices[i].rand, 8);
-        le_devices[i].key_size      = read_value(wFile, 1);
-        le_devices[i].authenticated = read_value(wFile, 1);
-        le_devices[i].authorized    = read_value(wFile, 1);
+        le_device_db_legacy_read_hex(file, device->addr, 6);
+        le_device_db_legacy_read_hex(file, device->irk, 16);
+        le_device_db_legacy_read_hex(file, device->ltk, 16);
+        device->ediv = (uint16_t) le_device_db_legacy_read_value(file, 2);
+        le_device_db_legacy_read_hex(file, device->rand, 8);
+        device->key_size      = (uint8_t) le_device_db_legacy_read_value(file, 1);
+        device->authenticated = (uint8_t) le_device_db_legacy_read_value(file, 1);
+        device->authorized    = (uint8_t) le_device_db_legacy_read_value(file, 1);
 #ifdef ENABLE_LE_SIGNED_WRITE
-        read_hex(wFile,   le_devices[i].remote_csrk, 16);
-        le_devices[i].remote_counter = read_value(wFile, 2);
-        read_hex(wFile,   le_devices[i].local_csrk, 16);
-        le_devices[i].local_counter = read_value(wFile, 2);
+        le_device_db_legacy_read_hex(file, device->remote_csrk, 16);
+        device->remote_counter = le_device_db_legacy_read_value(file, 2);
+        le_device_db_legacy_read_hex(file, device->local_csrk, 16);
+        device->local_counter  = le_device_db_legacy_read_value(file, 2);
 #endif
-        // read next character and secure connection field if hex nibble follows
-        // (if not, we just read the newline)
-        int c = fgetc(wFile);
-        if (nibble_for_char(c) >= 0){
-            int d = fgetc(wFile);
-            le_devices[i].secure_connection = nibble_for_char(c) << 4 | nibble_for_char(d);
-            // read delimiter
-            read_delimiter(wFile);
-            // read newline
-            fgetc(wFile);
+        // optional secure connection field, otherwise newline has been read
+        c = fgetc(file);
+        if (nibble_for_char((char) c) >= 0){
+            int d = fgetc(file);
+            device->secure_connection = (uint8_t) ((nibble_for_char((char) c) << 4) | nibble_for_char((char) d));
+            le_device_db_legacy_read_delimiter(file);
+            c = fgetc(file);
         }
+        if (feof(file)){
+            // incomplete line
+            device->addr_type = BD_ADDR_TYPE_UNKNOWN;
+            break;
+        }
+        le_device_db_store_record(i);
     }
-exit:
-    fclose(wFile);
+    fclose(file);
+    btstack_record_log_posix_sync(&le_device_log);
+    log_info("le_device_db_fs: imported %u devices from %s", (unsigned int) btstack_record_log_posix_count(&le_device_log), legacy_db_path);
+}
+
+static void le_device_db_read(void){
+    int import_legacy = btstack_record_log_posix_exists(db_path) == 0;
+    if (le_device_db_open_log() != 0) return;
+    if (import_legacy){
+        le_device_db_import_legacy();
+        return;
+    }
+
+    btstack_record_log_posix_iterator_t it;
+    const uint8_t * key;
+    uint8_t key_len;
+    const uint8_t * record;
+    uint16_t record_len;
+    btstack_record_log_posix_iterator_init(&it, &le_device_log);
+    while (btstack_record_log_posix_iterator_next(&it, &key, &key_len, &record, &record_len)){
+        if ((key_len != 2u) || (record_len != LE_DEVICE_RECORD_LEN)) continue;
+        uint16_t index = little_endian_read_16(key, 0);
+        if (index >= LE_DEVICE_MEMORY_SIZE) continue;
+        le_device_db_deserialize(&le_devices[index], record);
+    }
+    btstack_record_log_posix_iterator_done(&it);
+}
+
+// store single device
+static void le_device_db_store(int index) {
+    if (le_device_log_open == 0){
+        // local address not set: open log and replace its content with current devices
+        if (le_device_db_open_log() != 0) return;
+        int i;
+        for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
+            le_device_db_store_record(i);
+        }
+        return;
+    }
+    le_device_db_store_record(index);
 }
 
 void le_device_db_init(void){
@@ -260,11 +314,18 @@ void le_device_db_init(void){
     for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
         le_devices[i].addr_type = BD_ADDR_TYPE_UNKNOWN;
     }
+    le_device_db_close_log();
     sprintf(db_path, DB_PATH_TEMPLATE, "00-00-00-00-00-00");
 }
 
 void le_device_db_set_local_bd_addr(bd_addr_t addr){
+    le_device_db_close_log();
+    int i;
+    for (i=0;i<LE_DEVICE_MEMORY_SIZE;i++){
+        le_devices[i].addr_type = BD_ADDR_TYPE_UNKNOWN;
+    }
     sprintf(db_path, DB_PATH_TEMPLATE, bd_addr_to_dash_str(addr));
+    sprintf(legacy_db_path, LEGACY_DB_PATH_TEMPLATE, bd_addr_to_dash_str(addr));
     log_info("le_device_db_fs: path %s", db_path);
     le_device_db_read();
     le_device_db_dump();
@@ -287,7 +348,7 @@ int le_device_db_max_count(void){
 // free device
 void le_device_db_remove(int index){
     le_devices[index].addr_type = BD_ADDR_TYPE_UNKNOWN;
-    le_device_db_store();
+    le_device_db_store(index);
 }
 
 int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
@@ -313,7 +374,7 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
 #ifdef ENABLE_LE_SIGNED_WRITE
     le_devices[index].remote_counter = 0; 
 #endif
-    le_device_db_store();
+    le_device_db_store(index);
 
     return index;
 }
@@ -338,7 +399,7 @@ void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_k
     device->authorized = authorized;
     device->secure_connection = secure_connection;
 
-    le_device_db_store();
+    le_device_db_store(index);
 }
 
 void le_device_db_encryption_get(int index, uint16_t * ediv, uint8_t rand[8], sm_key_t ltk, int * key_size, int * authenticated, int * authorized, int * secure_connection){
@@ -372,7 +433,7 @@ void le_device_db_remote_csrk_set(int index, sm_key_t csrk){
     }
     if (csrk) memcpy(le_devices[index].remote_csrk, csrk, 16);
 
-    le_device_db_store();
+    le_device_db_store(index);
 }
 
 void le_device_db_local_csrk_get(int index, sm_key_t csrk){
@@ -390,7 +451,7 @@ void le_device_db_local_csrk_set(int index, sm_key_t csrk){
     }
     if (csrk) memcpy(le_devices[index].local_csrk, csrk, 16);
 
-    le_device_db_store();
+    le_device_db_store(index);
 }
 
 // query last used/seen signing counter
@@ -402,7 +463,7 @@ uint32_t le_device_db_remote_counter_get(int index){
 void le_device_db_remote_counter_set(int index, uint32_t counter){
     le_devices[index].remote_counter = counter;
 
-    le_device_db_store();
+    le_device_db_store(index);
 }
 
 // query last used/seen signing counter
@@ -414,7 +475,7 @@ uint32_t le_device_db_local_counter_get(int index){
 void le_device_db_local_counter_set(int index, uint32_t counter){
     le_devices[index].local_counter = counter;
 
-    le_device_db_store();
+    le_device_db_store(index);
 }
 #endif
 
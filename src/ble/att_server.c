@@ -101,6 +101,16 @@ typedef struct {
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 static btstack_packet_handler_t               att_client_packet_handler = NULL;
+
+// hci events handled by att_event_packet_handler
+static const uint8_t att_server_hci_event_codes[] = {
+    HCI_EVENT_ENCRYPTION_CHANGE,
+    HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+    HCI_EVENT_DISCONNECTION_COMPLETE,
+};
+static const uint8_t att_server_hci_le_subevent_codes[] = {
+    HCI_SUBEVENT_LE_CONNECTION_COMPLETE,
+};
 static btstack_linked_list_t                  service_handlers;
 static btstack_context_callback_registration_t att_client_waiting_for_can_send_registration;
 
@@ -1160,7 +1170,8 @@ void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_
 
     // register for HCI Events
     hci_event_callback_registration.callback = &att_event_packet_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+    hci_add_event_handler_for_events(&hci_event_callback_registration, att_server_hci_event_codes, sizeof(att_server_hci_event_codes),
+                                     att_server_hci_le_subevent_codes, sizeof(att_server_hci_le_subevent_codes));
 
     // register for SM events
     sm_event_callback_registration.callback = &att_event_packet_handler;
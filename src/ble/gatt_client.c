@@ -63,6 +63,13 @@ static btstack_linked_list_t gatt_client_value_listeners;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 
+// hci events handled by gatt_client_event_packet_handler, encryption changes trigger gatt_client_run
+static const uint8_t gatt_client_hci_event_codes[] = {
+    HCI_EVENT_DISCONNECTION_COMPLETE,
+    HCI_EVENT_ENCRYPTION_CHANGE,
+    HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+};
+
 // GATT Client Configuration
 static bool                 gatt_client_mtu_exchange_enabled;
 static gap_security_level_t gatt_client_required_security_level;
@@ -84,7 +91,7 @@ void gatt_client_init(void){
 
     // register for HCI Events
     hci_event_callback_registration.callback = &gatt_client_event_packet_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+    hci_add_event_handler_for_events(&hci_event_callback_registration, gatt_client_hci_event_codes, sizeof(gatt_client_hci_event_codes), NULL, 0);
 
     // register for SM Events
     sm_event_callback_registration.callback = &gatt_client_event_packet_handler;
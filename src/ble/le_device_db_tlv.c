@@ -44,10 +44,21 @@
 
 #include <string.h>
 #include "btstack_debug.h"
+#include "btstack_event.h"
+#include "hci.h"
 
 // LE Device DB Implementation storing entries in btstack_tlv
 
-// Local cache is used to keep track of deleted entries in TLV
+// All entries are kept in a RAM mirror, TLV is only read in le_device_db_tlv_configure.
+// Entries are found by address via a small hash table.
+
+// Signing counters are persisted lazily:
+// - the local counter is stored as an upper bound that is NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL ahead,
+//   after a reset, the stored value is used, so a local counter is never used twice
+// - the remote counter is stored after NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL updates or on le_device_db_tlv_flush,
+//   after a reset without flush, the last NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL-1 remote counters could be accepted again
+// - pending counters are flushed on disconnect and when HCI is powered down
+// The default interval of 1 stores every update, larger values trade replay protection across resets for fewer writes
 
 #define INVALID_ENTRY_ADDR_TYPE 0xff
 
@@ -93,10 +104,41 @@ typedef struct le_device_db_entry_t {
 #error "NVM_NUM_DEVICE_DB_ENTRIES must not be 0, please update in btstack_config.h"
 #endif
 
+#if NVM_NUM_DEVICE_DB_ENTRIES > 254
+#error "NVM_NUM_DEVICE_DB_ENTRIES must not be larger than 254"
+#endif
+
+#ifndef NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL
+#define NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL 1
+#endif
+
+#if NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL == 0
+#error "NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL must not be 0, use 1 to store every update"
+#endif
+
+// hash tables with twice the number of entries, so that there's always an empty slot
+#define LE_DEVICE_DB_TLV_HASH_SIZE (2 * NVM_NUM_DEVICE_DB_ENTRIES)
+
 // only stores if entry present
 static uint8_t  entry_map[NVM_NUM_DEVICE_DB_ENTRIES];
 static uint32_t num_valid_entries;
 
+// RAM mirror of stored entries
+static le_device_db_entry_t entries[NVM_NUM_DEVICE_DB_ENTRIES];
+
+#ifdef ENABLE_LE_SIGNED_WRITE
+// signing counters as stored in TLV
+static uint32_t stored_remote_counter[NVM_NUM_DEVICE_DB_ENTRIES];
+static uint32_t stored_local_counter[NVM_NUM_DEVICE_DB_ENTRIES];
+#endif
+
+// index + 1 of entry, 0 for empty slot
+static uint8_t addr_hash_table[LE_DEVICE_DB_TLV_HASH_SIZE];
+
+#ifdef ENABLE_LE_SIGNED_WRITE
+static btstack_packet_callback_registration_t le_device_db_tlv_hci_event_callback_registration;
+#endif
+
 static const btstack_tlv_t * le_device_db_tlv_btstack_tlv_impl;
 static       void *          le_device_db_tlv_btstack_tlv_context;
 
@@ -144,18 +186,82 @@ static bool le_device_db_tlv_delete(int index){
 	return true;
 }
 
+// FNV-1a
+static uint32_t le_device_db_tlv_hash(uint32_t hash, const uint8_t * data, uint16_t size){
+    uint16_t i;
+    for (i=0;i<size;i++){
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t le_device_db_tlv_hash_addr(int addr_type, const uint8_t * addr){
+    uint8_t type = (uint8_t) addr_type;
+    uint32_t hash = le_device_db_tlv_hash(2166136261u, &type, 1);
+    return le_device_db_tlv_hash(hash, addr, 6) % LE_DEVICE_DB_TLV_HASH_SIZE;
+}
+
+static void le_device_db_tlv_hash_insert(uint8_t * table, uint32_t pos, int index){
+    while (table[pos] != 0u){
+        pos = (pos + 1u) % LE_DEVICE_DB_TLV_HASH_SIZE;
+    }
+    table[pos] = (uint8_t) (index + 1);
+}
+
+// entries are only added or removed on pairing, just rebuild the table
+static void le_device_db_tlv_hash_rebuild(void){
+    memset(addr_hash_table, 0, sizeof(addr_hash_table));
+    int i;
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        if (entry_map[i] == 0u) continue;
+        le_device_db_entry_t * entry = &entries[i];
+        le_device_db_tlv_hash_insert(addr_hash_table, le_device_db_tlv_hash_addr(entry->addr_type, entry->addr), i);
+    }
+}
+
+// @returns entry from RAM mirror or NULL if not present
+static le_device_db_entry_t * le_device_db_tlv_get_entry(int index){
+    btstack_assert(index >= 0);
+    btstack_assert(index < NVM_NUM_DEVICE_DB_ENTRIES);
+    if (entry_map[index] == 0u) return NULL;
+    return &entries[index];
+}
+
+// store entry from RAM mirror, local signing counter is stored as reserved upper bound
+static bool le_device_db_tlv_store_cached(int index){
+    le_device_db_entry_t entry;
+    (void)memcpy(&entry, &entries[index], sizeof(le_device_db_entry_t));
+#ifdef ENABLE_LE_SIGNED_WRITE
+    entry.local_counter = stored_local_counter[index];
+#endif
+    bool ok = le_device_db_tlv_store(index, &entry);
+#ifdef ENABLE_LE_SIGNED_WRITE
+    if (ok){
+        stored_remote_counter[index] = entry.remote_counter;
+    }
+#endif
+    return ok;
+}
+
 static void le_device_db_tlv_scan(void){
     int i;
     num_valid_entries = 0;
     memset(entry_map, 0, sizeof(entry_map));
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
         // lookup entry
-        le_device_db_entry_t entry;
-        if (!le_device_db_tlv_fetch(i, &entry)) continue;
+        if (!le_device_db_tlv_fetch(i, &entries[i])) continue;
 
         entry_map[i] = 1;
         num_valid_entries++;
+
+#ifdef ENABLE_LE_SIGNED_WRITE
+        // continue with reserved local counter
+        stored_remote_counter[i] = entries[i].remote_counter;
+        stored_local_counter[i]  = entries[i].local_counter;
+#endif
     }
+    le_device_db_tlv_hash_rebuild();
     log_info("num valid le device entries %u", (unsigned int) num_valid_entries);
 }
 
@@ -194,6 +300,8 @@ void le_device_db_remove(int index){
 
     // keep track
     num_valid_entries--;
+
+    le_device_db_tlv_hash_rebuild();
 }
 
 int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
@@ -201,27 +309,22 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     uint32_t highest_seq_nr = 0;
     uint32_t lowest_seq_nr  = 0xFFFFFFFFU;
     int index_for_lowest_seq_nr = -1;
-    int index_for_addr  = -1;
+    int index_for_addr  = le_device_db_tlv_lookup_by_address(addr_type, addr);
     int index_for_empty = -1;
 
 	// find unused entry in the used list
     int i;
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
          if (entry_map[i]) {
-            le_device_db_entry_t entry;
-            le_device_db_tlv_fetch(i, &entry);
-            // found addr?
-            if ((memcmp(addr, entry.addr, 6) == 0) && (addr_type == entry.addr_type)){
-                index_for_addr = i;
-            }
+            le_device_db_entry_t * entry = &entries[i];
             // update highest seq nr
-            if (entry.seq_nr > highest_seq_nr){
-                highest_seq_nr = entry.seq_nr;
+            if (entry->seq_nr > highest_seq_nr){
+                highest_seq_nr = entry->seq_nr;
             }
             // find entry with lowest seq nr
-            if ((index_for_lowest_seq_nr == -1) || (entry.seq_nr < lowest_seq_nr)){
+            if ((index_for_lowest_seq_nr == -1) || (entry->seq_nr < lowest_seq_nr)){
                 index_for_lowest_seq_nr = i;
-                lowest_seq_nr = entry.seq_nr;
+                lowest_seq_nr = entry->seq_nr;
             }
         } else {
             index_for_empty = i;
@@ -265,14 +368,24 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
         log_error("tag store failed");
         return -1;
     }
-    // set in entry_mape
-    entry_map[index_to_use] = 1;
 
-    // keep track - don't increase if old entry found
-    if (index_for_addr < 0){
+    // update RAM mirror
+    (void)memcpy(&entries[index_to_use], &entry, sizeof(le_device_db_entry_t));
+#ifdef ENABLE_LE_SIGNED_WRITE
+    stored_remote_counter[index_to_use] = 0;
+    stored_local_counter[index_to_use]  = 0;
+#endif
+
+    // keep track - don't increase if old entry found or replaced
+    if (entry_map[index_to_use] == 0u){
         num_valid_entries++;
     }
 
+    // set in entry_mape
+    entry_map[index_to_use] = 1;
+
+    le_device_db_tlv_hash_rebuild();
+
     return index_to_use;
 }
 
@@ -280,42 +393,42 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
 // get device information: addr type and address
 void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk){
 
-	// fetch entry
-    le_device_db_entry_t entry;
-    int ok = le_device_db_tlv_fetch(index, &entry);
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
 
     // set defaults if not found
-    if (!ok) {
-        memset(&entry, 0, sizeof(le_device_db_entry_t));
-        entry.addr_type = BD_ADDR_TYPE_UNKNOWN;
+    if (entry == NULL) {
+        if (addr_type != NULL) *addr_type = BD_ADDR_TYPE_UNKNOWN;
+        if (addr != NULL) memset(addr, 0, 6);
+        if (irk != NULL) memset(irk, 0, 16);
+        return;
     }
 
     // setup return values
-    if (addr_type != NULL) *addr_type = entry.addr_type;
-    if (addr != NULL) (void)memcpy(addr, entry.addr, 6);
-    if (irk != NULL) (void)memcpy(irk, entry.irk, 16);
+    if (addr_type != NULL) *addr_type = entry->addr_type;
+    if (addr != NULL) (void)memcpy(addr, entry->addr, 6);
+    if (irk != NULL) (void)memcpy(irk, entry->irk, 16);
 }
 
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
 	// update
     log_info("LE Device DB set encryption for %u, ediv x%04x, key size %u, authenticated %u, authorized %u, secure connection %u",
         index, ediv, key_size, authenticated, authorized, secure_connection);
-    entry.ediv = ediv;
-    if (rand != 0) (void)memcpy(entry.rand, rand, 8);
-    if (ltk != 0) (void)memcpy(entry.ltk, ltk, 16);
-    entry.key_size = key_size;
-    entry.authenticated = authenticated;
-    entry.authorized = authorized;
-    entry.secure_connection = secure_connection;
+    entry->ediv = ediv;
+    if (rand != 0) (void)memcpy(entry->rand, rand, 8);
+    if (ltk != 0) (void)memcpy(entry->ltk, ltk, 16);
+    entry->key_size = key_size;
+    entry->authenticated = authenticated;
+    entry->authorized = authorized;
+    entry->secure_connection = secure_connection;
 
     // store
-    ok = le_device_db_tlv_store(index, &entry);
+    bool ok = le_device_db_tlv_store_cached(index);
     if (!ok){
         log_error("Set encryption data failed");
     }
@@ -323,21 +436,20 @@ void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_k
 
 void le_device_db_encryption_get(int index, uint16_t * ediv, uint8_t rand[8], sm_key_t ltk, int * key_size, int * authenticated, int * authorized, int * secure_connection){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
 	// update user fields
     log_info("LE Device DB encryption for %u, ediv x%04x, keysize %u, authenticated %u, authorized %u, secure connection %u",
-        index, entry.ediv, entry.key_size, entry.authenticated, entry.authorized, entry.secure_connection);
-    if (ediv != NULL) *ediv = entry.ediv;
-    if (rand != NULL) (void)memcpy(rand, entry.rand, 8);
-    if (ltk != NULL)  (void)memcpy(ltk, entry.ltk, 16);
-    if (key_size != NULL) *key_size = entry.key_size;
-    if (authenticated != NULL) *authenticated = entry.authenticated;
-    if (authorized != NULL) *authorized = entry.authorized;
-    if (secure_connection != NULL) *secure_connection = entry.secure_connection;
+        index, entry->ediv, entry->key_size, entry->authenticated, entry->authorized, entry->secure_connection);
+    if (ediv != NULL) *ediv = entry->ediv;
+    if (rand != NULL) (void)memcpy(rand, entry->rand, 8);
+    if (ltk != NULL)  (void)memcpy(ltk, entry->ltk, 16);
+    if (key_size != NULL) *key_size = entry->key_size;
+    if (authenticated != NULL) *authenticated = entry->authenticated;
+    if (authorized != NULL) *authorized = entry->authorized;
+    if (secure_connection != NULL) *secure_connection = entry->secure_connection;
 }
 
 #ifdef ENABLE_LE_SIGNED_WRITE
@@ -345,126 +457,169 @@ void le_device_db_encryption_get(int index, uint16_t * ediv, uint8_t rand[8], sm
 // get signature key
 void le_device_db_remote_csrk_get(int index, sm_key_t csrk){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
-    if (csrk) (void)memcpy(csrk, entry.remote_csrk, 16);
+    if (csrk) (void)memcpy(csrk, entry->remote_csrk, 16);
 }
 
 void le_device_db_remote_csrk_set(int index, sm_key_t csrk){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
     if (!csrk) return;
 
     // update
-    (void)memcpy(entry.remote_csrk, csrk, 16);
+    (void)memcpy(entry->remote_csrk, csrk, 16);
 
     // store
-    le_device_db_tlv_store(index, &entry);
+    le_device_db_tlv_store_cached(index);
 }
 
 void le_device_db_local_csrk_get(int index, sm_key_t csrk){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
     if (!csrk) return;
 
     // fill
-    (void)memcpy(csrk, entry.local_csrk, 16);
+    (void)memcpy(csrk, entry->local_csrk, 16);
 }
 
 void le_device_db_local_csrk_set(int index, sm_key_t csrk){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
     if (!csrk) return;
 
     // update
-    (void)memcpy(entry.local_csrk, csrk, 16);
+    (void)memcpy(entry->local_csrk, csrk, 16);
 
     // store
-    le_device_db_tlv_store(index, &entry);
+    le_device_db_tlv_store_cached(index);
 }
 
 // query last used/seen signing counter
 uint32_t le_device_db_remote_counter_get(int index){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return 0;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return 0;
 
-    return entry.remote_counter;
+    return entry->remote_counter;
 }
 
 // update signing counter
 void le_device_db_remote_counter_set(int index, uint32_t counter){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
-    entry.remote_counter = counter;
+    entry->remote_counter = counter;
 
-    // store
-    le_device_db_tlv_store(index, &entry);
+    // store every NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL updates, see le_device_db_tlv_flush
+    if ((counter - stored_remote_counter[index]) < NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL) return;
+    le_device_db_tlv_store_cached(index);
 }
 
 // query last used/seen signing counter
 uint32_t le_device_db_local_counter_get(int index){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return 0;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return 0;
 
-    return entry.local_counter;
+    return entry->local_counter;
 }
 
 // update signing counter
 void le_device_db_local_counter_set(int index, uint32_t counter){
 
-	// fetch entry
-	le_device_db_entry_t entry;
-	int ok = le_device_db_tlv_fetch(index, &entry);
-	if (!ok) return;
+	// get entry
+    le_device_db_entry_t * entry = le_device_db_tlv_get_entry(index);
+	if (entry == NULL) return;
 
 	// update
-    entry.local_counter = counter;
+    entry->local_counter = counter;
 
-    // store
-    le_device_db_tlv_store(index, &entry);
+    // counter still below stored upper bound
+    if (counter <= stored_local_counter[index]) return;
+
+    // reserve next NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL values
+    uint32_t previous_local_counter = stored_local_counter[index];
+    stored_local_counter[index] = counter + NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL - 1u;
+    bool ok = le_device_db_tlv_store_cached(index);
+    if (!ok){
+        // try again on next update
+        stored_local_counter[index] = previous_local_counter;
+    }
+}
+
+#endif
+
+void le_device_db_tlv_flush(void){
+#ifdef ENABLE_LE_SIGNED_WRITE
+    int i;
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        if (entry_map[i] == 0u) continue;
+        if (entries[i].remote_counter == stored_remote_counter[i]) continue;
+        le_device_db_tlv_store_cached(i);
+    }
+#endif
 }
 
+#ifdef ENABLE_LE_SIGNED_WRITE
+static void le_device_db_tlv_hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            le_device_db_tlv_flush();
+            break;
+        case BTSTACK_EVENT_STATE:
+            if (btstack_event_state_get_state(packet) == HCI_STATE_HALTING){
+                le_device_db_tlv_flush();
+            }
+            break;
+        default:
+            break;
+    }
+}
 #endif
 
+int le_device_db_tlv_lookup_by_address(int addr_type, const bd_addr_t addr){
+    uint32_t pos = le_device_db_tlv_hash_addr(addr_type, addr);
+    while (addr_hash_table[pos] != 0u){
+        int index = addr_hash_table[pos] - 1;
+        if ((entries[index].addr_type == addr_type) && (memcmp(entries[index].addr, addr, 6) == 0)){
+            return index;
+        }
+        pos = (pos + 1u) % LE_DEVICE_DB_TLV_HASH_SIZE;
+    }
+    return -1;
+}
+
 void le_device_db_dump(void){
     log_info("LE Device DB dump, devices: %d", le_device_db_count());
     uint32_t i;
 
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
         if (!entry_map[i]) continue;
-		// fetch entry
-		le_device_db_entry_t entry;
-		le_device_db_tlv_fetch(i, &entry);
-        log_info("%u: %u %s", (unsigned int) i, entry.addr_type, bd_addr_to_str(entry.addr));
-        log_info_key("irk", entry.irk);
+		le_device_db_entry_t * entry = &entries[i];
+        log_info("%u: %u %s", (unsigned int) i, entry->addr_type, bd_addr_to_str(entry->addr));
+        log_info_key("irk", entry->irk);
 #ifdef ENABLE_LE_SIGNED_WRITE
-        log_info_key("local csrk", entry.local_csrk);
-        log_info_key("remote csrk", entry.remote_csrk);
+        log_info_key("local csrk", entry->local_csrk);
+        log_info_key("remote csrk", entry->remote_csrk);
 #endif
     }
 }
@@ -473,4 +628,9 @@ void le_device_db_tlv_configure(const btstack_tlv_t * btstack_tlv_impl, void * b
 	le_device_db_tlv_btstack_tlv_impl = btstack_tlv_impl;
 	le_device_db_tlv_btstack_tlv_context = btstack_tlv_context;
     le_device_db_tlv_scan();
+#ifdef ENABLE_LE_SIGNED_WRITE
+    // store pending signing counters on disconnect and power down
+    le_device_db_tlv_hci_event_callback_registration.callback = &le_device_db_tlv_hci_event_handler;
+    hci_add_event_handler(&le_device_db_tlv_hci_event_callback_registration);
+#endif
 }
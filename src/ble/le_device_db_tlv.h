@@ -60,6 +60,21 @@ extern "C" {
 
 void le_device_db_tlv_configure(const btstack_tlv_t * btstack_tlv_impl, void * btstack_tlv_context);
 
+/**
+ * @brief store signing counters that have not been stored yet
+ * @note remote signing counters are only stored every NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL updates (default 1).
+ *       Pending counters are stored automatically on disconnect and on HCI power down.
+ */
+void le_device_db_tlv_flush(void);
+
+/**
+ * @brief find entry for identity address
+ * @param addr_type
+ * @param addr
+ * @returns index or -1 if not found
+ */
+int le_device_db_tlv_lookup_by_address(int addr_type, const bd_addr_t addr);
+
 /* API_END */
 
 #if defined __cplusplus
@@ -277,6 +277,21 @@ static uint8_t sm_aes128_ciphertext[16];
 // to receive hci events
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
+// hci events handled by sm_event_packet_handler, command complete/status and packet sent trigger sm_run
+static const uint8_t sm_hci_event_codes[] = {
+    BTSTACK_EVENT_STATE,
+    HCI_EVENT_ENCRYPTION_CHANGE,
+    HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+    HCI_EVENT_DISCONNECTION_COMPLETE,
+    HCI_EVENT_COMMAND_COMPLETE,
+    HCI_EVENT_COMMAND_STATUS,
+    HCI_EVENT_TRANSPORT_PACKET_SENT,
+};
+static const uint8_t sm_hci_le_subevent_codes[] = {
+    HCI_SUBEVENT_LE_CONNECTION_COMPLETE,
+    HCI_SUBEVENT_LE_LONG_TERM_KEY_REQUEST,
+};
+
 /* to dispatch sm event */
 static btstack_linked_list_t sm_event_handlers;
 
@@ -4451,7 +4466,8 @@ void sm_init(void){
 
     // register for HCI Events from HCI
     hci_event_callback_registration.callback = &sm_event_packet_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+    hci_add_event_handler_for_events(&hci_event_callback_registration, sm_hci_event_codes, sizeof(sm_hci_event_codes),
+                                     sm_hci_le_subevent_codes, sizeof(sm_hci_le_subevent_codes));
 
     // 
     btstack_crypto_init();
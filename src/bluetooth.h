@@ -239,6 +239,10 @@ typedef enum {
 #define ERROR_CODE_CONNECTION_FAILED_TO_BE_ESTABLISHED     0x3E
 #define ERROR_CODE_MAC_CONNECTION_FAILED                   0x3F
 #define ERROR_CODE_COARSE_CLOCK_ADJUSTMENT_REJECTED_BUT_WILL_TRY_TO_ADJUST_USING_CLOCK_DRAGGING 0x40
+#define ERROR_CODE_TYPE0_SUBMAP_NOT_DEFINED                0x41
+#define ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER          0x42
+#define ERROR_CODE_LIMIT_REACHED                           0x43
+#define ERROR_CODE_OPERATION_CANCELLED_BY_HOST             0x44
 
 // BTstack defined ERRORS, mapped into BLuetooth status code range
 
@@ -307,6 +311,7 @@ typedef enum {
 #define OBEX_DISCONNECTED                                  0xB2
 #define OBEX_NOT_FOUND                                     0xB3
 #define OBEX_NOT_ACCEPTABLE                                0xB4
+#define OBEX_ABORTED                                       0xB5
 
 #define MESH_ERROR_APPKEY_INDEX_INVALID                    0xD0
 /* ENUM_END */
@@ -361,6 +366,21 @@ typedef enum {
 #define HCI_ACL_3DH5_SIZE         1021
        
 #define LE_ADVERTISING_DATA_SIZE    31
+#define LE_EXTENDED_ADVERTISING_DATA_SIZE 1650
+
+// LE Extended Advertising Event Properties
+#define LE_ADVERTISING_PROPERTIES_CONNECTABLE           0x01
+#define LE_ADVERTISING_PROPERTIES_SCANNABLE             0x02
+#define LE_ADVERTISING_PROPERTIES_DIRECTED              0x04
+#define LE_ADVERTISING_PROPERTIES_HIGH_DUTY_CYCLE       0x08
+#define LE_ADVERTISING_PROPERTIES_LEGACY                0x10
+#define LE_ADVERTISING_PROPERTIES_ANONYMOUS             0x20
+#define LE_ADVERTISING_PROPERTIES_INCLUDE_TX_POWER      0x40
+
+// LE Extended Advertising Report Data Status
+#define LE_ADVERTISING_DATA_STATUS_COMPLETE             0x00
+#define LE_ADVERTISING_DATA_STATUS_INCOMPLETE           0x01
+#define LE_ADVERTISING_DATA_STATUS_TRUNCATED            0x02
 
 // SCO Packet Types
 #define SCO_PACKET_TYPES_NONE  0x0000
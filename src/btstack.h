@@ -114,6 +114,7 @@
 #include "classic/avrcp.h"
 #include "classic/avrcp_browsing.h"
 #include "classic/avrcp_browsing_controller.h"
+#include "classic/avrcp_browsing_cursor.h"
 #include "classic/avrcp_browsing_target.h"
 #include "classic/avrcp_controller.h"
 #include "classic/avrcp_media_item_iterator.h"
@@ -133,6 +133,20 @@ static bool btstack_crypto_wait_for_hci_result;
 static btstack_linked_list_t btstack_crypto_operations;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
+// hci events handled by btstack_crypto_event_handler, command complete/status and packet sent trigger btstack_crypto_run
+static const uint8_t btstack_crypto_hci_event_codes[] = {
+    BTSTACK_EVENT_STATE,
+    HCI_EVENT_COMMAND_COMPLETE,
+    HCI_EVENT_COMMAND_STATUS,
+    HCI_EVENT_TRANSPORT_PACKET_SENT,
+};
+#if defined(ENABLE_ECC_P256) && !defined(USE_SOFTWARE_ECC_P256_IMPLEMENTATION)
+static const uint8_t btstack_crypto_hci_le_subevent_codes[] = {
+    HCI_SUBEVENT_LE_READ_LOCAL_P256_PUBLIC_KEY_COMPLETE,
+    HCI_SUBEVENT_LE_GENERATE_DHKEY_COMPLETE,
+};
+#endif
+
 // state for AES-CMAC
 #ifndef USE_BTSTACK_AES128
 static btstack_crypto_cmac_state_t btstack_crypto_cmac_state;
@@ -1169,7 +1183,12 @@ void btstack_crypto_init(void){
 
 	// register with HCI
     hci_event_callback_registration.callback = &btstack_crypto_event_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+#if defined(ENABLE_ECC_P256) && !defined(USE_SOFTWARE_ECC_P256_IMPLEMENTATION)
+    hci_add_event_handler_for_events(&hci_event_callback_registration, btstack_crypto_hci_event_codes, sizeof(btstack_crypto_hci_event_codes),
+                                     btstack_crypto_hci_le_subevent_codes, sizeof(btstack_crypto_hci_le_subevent_codes));
+#else
+    hci_add_event_handler_for_events(&hci_event_callback_registration, btstack_crypto_hci_event_codes, sizeof(btstack_crypto_hci_event_codes), NULL, 0);
+#endif
 
 #ifdef USE_MBEDTLS_ECC_P256
 	mbedtls_ecp_group_init(&mbedtls_ec_group);
@@ -162,6 +162,12 @@ typedef uint8_t sm_key_t[16];
 // set global Bluetooth state
 #define BTSTACK_SET_BLUETOOTH_ENABLED                      0x08
 
+// set packet filter for this client: param packet types (16), con handle (16)
+#define BTSTACK_SET_PACKET_FILTER                          0x09
+
+// subscribe/unsubscribe event for this client: param event code (8), subevent code (8), subscribe (8)
+#define BTSTACK_SET_EVENT_FILTER                           0x0a
+
 // create l2cap channel: param bd_addr(48), psm (16)
 #define L2CAP_CREATE_CHANNEL                               0x20
 
@@ -656,6 +662,78 @@ typedef uint8_t sm_key_t[16];
 // array of advertisements, not handled by event accessor generator
 #define HCI_SUBEVENT_LE_DIRECT_ADVERTISING_REPORT          0x0B
 
+/**
+ * @format 11H11
+ * @param subevent_code
+ * @param status
+ * @param connection_handle
+ * @param tx_phy
+ * @param rx_phy
+ */
+#define HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE                0x0C
+
+// array of advertisements, not handled by event accessor generator
+#define HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT        0x0D
+
+/**
+ * @format 11H11B121
+ * @param subevent_code
+ * @param status
+ * @param sync_handle
+ * @param advertising_sid
+ * @param advertiser_address_type
+ * @param advertiser_address
+ * @param advertiser_phy
+ * @param periodic_advertising_interval
+ * @param advertiser_clock_accuracy
+ */
+#define HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT 0x0E
+
+/**
+ * @format 1H1111JV
+ * @param subevent_code
+ * @param sync_handle
+ * @param tx_power
+ * @param rssi
+ * @param cte_type
+ * @param data_status
+ * @param data_length
+ * @param data
+ */
+#define HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT        0x0F
+
+/**
+ * @format 1H
+ * @param subevent_code
+ * @param sync_handle
+ */
+#define HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_LOST     0x10
+
+/**
+ * @format 1
+ * @param subevent_code
+ */
+#define HCI_SUBEVENT_LE_SCAN_TIMEOUT                       0x11
+
+/**
+ * @format 111H1
+ * @param subevent_code
+ * @param status
+ * @param advertising_handle
+ * @param connection_handle
+ * @param num_completed_extended_advertising_events
+ */
+#define HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED         0x12
+
+/**
+ * @format 111B
+ * @param subevent_code
+ * @param advertising_handle
+ * @param scanner_address_type
+ * @param scanner_address
+ */
+#define HCI_SUBEVENT_LE_SCAN_REQUEST_RECEIVED              0x13
+
 
 /**
  * @format 1
@@ -1432,6 +1510,52 @@ typedef uint8_t sm_key_t[16];
  */
 #define GAP_EVENT_PAIRING_COMPLETE                               0xE0
 
+/**
+ * @format H1122
+ * @param con_handle
+ * @param tx_phy 1 = 1M, 2 = 2M, 3 = Coded
+ * @param rx_phy 1 = 1M, 2 = 2M, 3 = Coded
+ * @param max_tx_octets
+ * @param max_rx_octets
+ */
+#define GAP_EVENT_LE_DATA_CHANNEL_CHANGED                        0xE1
+
+/**
+ * @format 21B1111121BLV
+ * @param advertising_event_type bit 0 = connectable, 1 = scannable, 2 = directed, 3 = scan response, 4 = legacy, 5-6 = data status: 0 = complete, 1 = incomplete, more events follow, 2 = truncated
+ * @param address_type
+ * @param address
+ * @param primary_phy
+ * @param secondary_phy
+ * @param advertising_sid
+ * @param tx_power
+ * @param rssi
+ * @param periodic_advertising_interval
+ * @param direct_address_type
+ * @param direct_address
+ * @param data_length
+ * @param data
+ */
+#define GAP_EVENT_EXTENDED_ADVERTISING_REPORT                    0xE2
+
+/**
+ * @format H1111LV
+ * @param sync_handle
+ * @param tx_power
+ * @param rssi
+ * @param cte_type
+ * @param data_status 0 = complete, 1 = incomplete, more events follow, 2 = truncated
+ * @param data_length
+ * @param data
+ */
+#define GAP_EVENT_PERIODIC_ADVERTISING_REPORT                    0xE3
+
+/**
+ * @format 1
+ * @param num_reports followed by reports as in HCI LE Advertising Report, use gap_advertising_report_iterator
+ */
+#define GAP_EVENT_ADVERTISING_REPORT_BATCH                       0xE4
+
 // Meta Events, see below for sub events
 #define HCI_EVENT_HSP_META                                       0xE8
 #define HCI_EVENT_HFP_META                                       0xE9
@@ -2909,6 +3033,64 @@ typedef uint8_t sm_key_t[16];
 */
 #define GOEP_SUBEVENT_CAN_SEND_NOW                                         0x03
 
+/**
+ * @format 124JVJV
+ * @param subevent_code
+ * @param goep_cid
+ * @param length of object from Length header, 0 if unknown
+ * @param name_len
+ * @param name in UTF-8
+ * @param type_len
+ * @param type
+ */
+#define GOEP_SUBEVENT_PUT_REQUEST                                          0x04
+
+/**
+ * @format 121
+ * @param subevent_code
+ * @param goep_cid
+ * @param status ERROR_CODE_SUCCESS, OBEX_ABORTED or OBEX_DISCONNECTED
+ */
+#define GOEP_SUBEVENT_PUT_COMPLETED                                        0x05
+
+/**
+ * @format 12JVJV
+ * @param subevent_code
+ * @param goep_cid
+ * @param name_len
+ * @param name in UTF-8
+ * @param type_len
+ * @param type
+ */
+#define GOEP_SUBEVENT_GET_REQUEST                                          0x06
+
+/**
+ * @format 121
+ * @param subevent_code
+ * @param goep_cid
+ * @param status ERROR_CODE_SUCCESS, OBEX_ABORTED or OBEX_DISCONNECTED
+ */
+#define GOEP_SUBEVENT_GET_COMPLETED                                        0x07
+
+/**
+ * @format 12JV
+ * @param subevent_code
+ * @param goep_cid
+ * @param name_len
+ * @param name in UTF-8
+ */
+#define GOEP_SUBEVENT_DELETE_REQUEST                                       0x08
+
+/**
+ * @format 121JV
+ * @param subevent_code
+ * @param goep_cid
+ * @param flags bit 0: backup a level before applying name, bit 1: don't create folder
+ * @param name_len
+ * @param name in UTF-8, empty for root folder or backup only
+ */
+#define GOEP_SUBEVENT_SET_PATH_REQUEST                                     0x09
+
 /**
  * @format 121BH1
  * @param subevent_code
@@ -3527,6 +3527,244 @@ static inline uint8_t gap_event_pairing_complete_get_status(const uint8_t * even
     return event[10];
 }
 
+/**
+ * @brief Get field con_handle from event GAP_EVENT_LE_DATA_CHANNEL_CHANGED
+ * @param event packet
+ * @return con_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t gap_event_le_data_channel_changed_get_con_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field tx_phy from event GAP_EVENT_LE_DATA_CHANNEL_CHANGED
+ * @param event packet
+ * @return tx_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_le_data_channel_changed_get_tx_phy(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field rx_phy from event GAP_EVENT_LE_DATA_CHANNEL_CHANGED
+ * @param event packet
+ * @return rx_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_le_data_channel_changed_get_rx_phy(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field max_tx_octets from event GAP_EVENT_LE_DATA_CHANNEL_CHANGED
+ * @param event packet
+ * @return max_tx_octets
+ * @note: btstack_type 2
+ */
+static inline uint16_t gap_event_le_data_channel_changed_get_max_tx_octets(const uint8_t * event){
+    return little_endian_read_16(event, 6);
+}
+/**
+ * @brief Get field max_rx_octets from event GAP_EVENT_LE_DATA_CHANNEL_CHANGED
+ * @param event packet
+ * @return max_rx_octets
+ * @note: btstack_type 2
+ */
+static inline uint16_t gap_event_le_data_channel_changed_get_max_rx_octets(const uint8_t * event){
+    return little_endian_read_16(event, 8);
+}
+
+/**
+ * @brief Get field advertising_event_type from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return advertising_event_type
+ * @note: btstack_type 2
+ */
+static inline uint16_t gap_event_extended_advertising_report_get_advertising_event_type(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field address_type from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return address_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_address_type(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field address from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @param Pointer to storage for address
+ * @note: btstack_type B
+ */
+static inline void gap_event_extended_advertising_report_get_address(const uint8_t * event, bd_addr_t address){
+    reverse_bytes(&event[5], address, 6);
+}
+/**
+ * @brief Get field primary_phy from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return primary_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_primary_phy(const uint8_t * event){
+    return event[11];
+}
+/**
+ * @brief Get field secondary_phy from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return secondary_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_secondary_phy(const uint8_t * event){
+    return event[12];
+}
+/**
+ * @brief Get field advertising_sid from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return advertising_sid
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_advertising_sid(const uint8_t * event){
+    return event[13];
+}
+/**
+ * @brief Get field tx_power from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return tx_power
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_tx_power(const uint8_t * event){
+    return event[14];
+}
+/**
+ * @brief Get field rssi from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return rssi
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_rssi(const uint8_t * event){
+    return event[15];
+}
+/**
+ * @brief Get field periodic_advertising_interval from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return periodic_advertising_interval
+ * @note: btstack_type 2
+ */
+static inline uint16_t gap_event_extended_advertising_report_get_periodic_advertising_interval(const uint8_t * event){
+    return little_endian_read_16(event, 16);
+}
+/**
+ * @brief Get field direct_address_type from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return direct_address_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_extended_advertising_report_get_direct_address_type(const uint8_t * event){
+    return event[18];
+}
+/**
+ * @brief Get field direct_address from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @param Pointer to storage for direct_address
+ * @note: btstack_type B
+ */
+static inline void gap_event_extended_advertising_report_get_direct_address(const uint8_t * event, bd_addr_t direct_address){
+    reverse_bytes(&event[19], direct_address, 6);
+}
+/**
+ * @brief Get field data_length from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return data_length
+ * @note: btstack_type L
+ */
+static inline uint16_t gap_event_extended_advertising_report_get_data_length(const uint8_t * event){
+    return little_endian_read_16(event, 25);
+}
+/**
+ * @brief Get field data from event GAP_EVENT_EXTENDED_ADVERTISING_REPORT
+ * @param event packet
+ * @return data
+ * @note: btstack_type V
+ */
+static inline const uint8_t * gap_event_extended_advertising_report_get_data(const uint8_t * event){
+    return &event[27];
+}
+
+/**
+ * @brief Get field sync_handle from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return sync_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t gap_event_periodic_advertising_report_get_sync_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field tx_power from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return tx_power
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_periodic_advertising_report_get_tx_power(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field rssi from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return rssi
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_periodic_advertising_report_get_rssi(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field cte_type from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return cte_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_periodic_advertising_report_get_cte_type(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field data_status from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data_status
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_periodic_advertising_report_get_data_status(const uint8_t * event){
+    return event[7];
+}
+/**
+ * @brief Get field data_length from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data_length
+ * @note: btstack_type L
+ */
+static inline uint16_t gap_event_periodic_advertising_report_get_data_length(const uint8_t * event){
+    return little_endian_read_16(event, 8);
+}
+/**
+ * @brief Get field data from event GAP_EVENT_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data
+ * @note: btstack_type V
+ */
+static inline const uint8_t * gap_event_periodic_advertising_report_get_data(const uint8_t * event){
+    return &event[10];
+}
+
+/**
+ * @brief Get field num_reports from event GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param event packet
+ * @return num_reports
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_advertising_report_batch_get_num_reports(const uint8_t * event){
+    return event[2];
+}
+
 /**
  * @brief Get field status from event HCI_SUBEVENT_LE_CONNECTION_COMPLETE
  * @param event packet
@@ -3950,6 +4188,256 @@ static inline uint8_t hci_subevent_le_enhanced_connection_complete_get_master_cl
     return event[32];
 }
 
+/**
+ * @brief Get field status from event HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE
+ * @param event packet
+ * @return status
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_phy_update_complete_get_status(const uint8_t * event){
+    return event[3];
+}
+/**
+ * @brief Get field connection_handle from event HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE
+ * @param event packet
+ * @return connection_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_subevent_le_phy_update_complete_get_connection_handle(const uint8_t * event){
+    return little_endian_read_16(event, 4);
+}
+/**
+ * @brief Get field tx_phy from event HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE
+ * @param event packet
+ * @return tx_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_phy_update_complete_get_tx_phy(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field rx_phy from event HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE
+ * @param event packet
+ * @return rx_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_phy_update_complete_get_rx_phy(const uint8_t * event){
+    return event[7];
+}
+
+/**
+ * @brief Get field status from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return status
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_sync_establishment_get_status(const uint8_t * event){
+    return event[3];
+}
+/**
+ * @brief Get field sync_handle from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return sync_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_subevent_le_periodic_advertising_sync_establishment_get_sync_handle(const uint8_t * event){
+    return little_endian_read_16(event, 4);
+}
+/**
+ * @brief Get field advertising_sid from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return advertising_sid
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_sync_establishment_get_advertising_sid(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field advertiser_address_type from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return advertiser_address_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_sync_establishment_get_advertiser_address_type(const uint8_t * event){
+    return event[7];
+}
+/**
+ * @brief Get field advertiser_address from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @param Pointer to storage for advertiser_address
+ * @note: btstack_type B
+ */
+static inline void hci_subevent_le_periodic_advertising_sync_establishment_get_advertiser_address(const uint8_t * event, bd_addr_t advertiser_address){
+    reverse_bytes(&event[8], advertiser_address, 6);
+}
+/**
+ * @brief Get field advertiser_phy from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return advertiser_phy
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_sync_establishment_get_advertiser_phy(const uint8_t * event){
+    return event[14];
+}
+/**
+ * @brief Get field periodic_advertising_interval from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return periodic_advertising_interval
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_subevent_le_periodic_advertising_sync_establishment_get_periodic_advertising_interval(const uint8_t * event){
+    return little_endian_read_16(event, 15);
+}
+/**
+ * @brief Get field advertiser_clock_accuracy from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT
+ * @param event packet
+ * @return advertiser_clock_accuracy
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_sync_establishment_get_advertiser_clock_accuracy(const uint8_t * event){
+    return event[17];
+}
+
+/**
+ * @brief Get field sync_handle from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return sync_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_subevent_le_periodic_advertising_report_get_sync_handle(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field tx_power from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return tx_power
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_report_get_tx_power(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field rssi from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return rssi
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_report_get_rssi(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field cte_type from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return cte_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_report_get_cte_type(const uint8_t * event){
+    return event[7];
+}
+/**
+ * @brief Get field data_status from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data_status
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_report_get_data_status(const uint8_t * event){
+    return event[8];
+}
+/**
+ * @brief Get field data_length from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data_length
+ * @note: btstack_type J
+ */
+static inline uint8_t hci_subevent_le_periodic_advertising_report_get_data_length(const uint8_t * event){
+    return event[9];
+}
+/**
+ * @brief Get field data from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT
+ * @param event packet
+ * @return data
+ * @note: btstack_type V
+ */
+static inline const uint8_t * hci_subevent_le_periodic_advertising_report_get_data(const uint8_t * event){
+    return &event[10];
+}
+
+/**
+ * @brief Get field sync_handle from event HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_LOST
+ * @param event packet
+ * @return sync_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_subevent_le_periodic_advertising_sync_lost_get_sync_handle(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+
+
+/**
+ * @brief Get field status from event HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED
+ * @param event packet
+ * @return status
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_advertising_set_terminated_get_status(const uint8_t * event){
+    return event[3];
+}
+/**
+ * @brief Get field advertising_handle from event HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED
+ * @param event packet
+ * @return advertising_handle
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_advertising_set_terminated_get_advertising_handle(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field connection_handle from event HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED
+ * @param event packet
+ * @return connection_handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_subevent_le_advertising_set_terminated_get_connection_handle(const uint8_t * event){
+    return little_endian_read_16(event, 5);
+}
+/**
+ * @brief Get field num_completed_extended_advertising_events from event HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED
+ * @param event packet
+ * @return num_completed_extended_advertising_events
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_advertising_set_terminated_get_num_completed_extended_advertising_events(const uint8_t * event){
+    return event[7];
+}
+
+/**
+ * @brief Get field advertising_handle from event HCI_SUBEVENT_LE_SCAN_REQUEST_RECEIVED
+ * @param event packet
+ * @return advertising_handle
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_scan_request_received_get_advertising_handle(const uint8_t * event){
+    return event[3];
+}
+/**
+ * @brief Get field scanner_address_type from event HCI_SUBEVENT_LE_SCAN_REQUEST_RECEIVED
+ * @param event packet
+ * @return scanner_address_type
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_subevent_le_scan_request_received_get_scanner_address_type(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field scanner_address from event HCI_SUBEVENT_LE_SCAN_REQUEST_RECEIVED
+ * @param event packet
+ * @param Pointer to storage for scanner_address
+ * @note: btstack_type B
+ */
+static inline void hci_subevent_le_scan_request_received_get_scanner_address(const uint8_t * event, bd_addr_t scanner_address){
+    reverse_bytes(&event[5], scanner_address, 6);
+}
+
 /**
  * @brief Get field status from event HSP_SUBEVENT_RFCOMM_CONNECTION_COMPLETE
  * @param event packet
@@ -8915,6 +9403,209 @@ static inline uint16_t goep_subevent_connection_closed_get_goep_cid(const uint8_
 static inline uint16_t goep_subevent_can_send_now_get_goep_cid(const uint8_t * event){
     return little_endian_read_16(event, 3);
 }
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_put_request_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field length from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return length
+ * @note: btstack_type 4
+ */
+static inline uint32_t goep_subevent_put_request_get_length(const uint8_t * event){
+    return little_endian_read_32(event, 5);
+}
+/**
+ * @brief Get field name_len from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return name_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_put_request_get_name_len(const uint8_t * event){
+    return event[9];
+}
+/**
+ * @brief Get field name from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return name
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_put_request_get_name(const uint8_t * event){
+    return &event[10];
+}
+/**
+ * @brief Get field type_len from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return type_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_put_request_get_type_len(const uint8_t * event){
+    return event[10u + event[9]];
+}
+/**
+ * @brief Get field type from event GOEP_SUBEVENT_PUT_REQUEST
+ * @param event packet
+ * @return type
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_put_request_get_type(const uint8_t * event){
+    return &event[10u + event[9] + 1u];
+}
+
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_PUT_COMPLETED
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_put_completed_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field status from event GOEP_SUBEVENT_PUT_COMPLETED
+ * @param event packet
+ * @return status
+ * @note: btstack_type 1
+ */
+static inline uint8_t goep_subevent_put_completed_get_status(const uint8_t * event){
+    return event[5];
+}
+
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_GET_REQUEST
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_get_request_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field name_len from event GOEP_SUBEVENT_GET_REQUEST
+ * @param event packet
+ * @return name_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_get_request_get_name_len(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field name from event GOEP_SUBEVENT_GET_REQUEST
+ * @param event packet
+ * @return name
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_get_request_get_name(const uint8_t * event){
+    return &event[6];
+}
+/**
+ * @brief Get field type_len from event GOEP_SUBEVENT_GET_REQUEST
+ * @param event packet
+ * @return type_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_get_request_get_type_len(const uint8_t * event){
+    return event[6u + event[5]];
+}
+/**
+ * @brief Get field type from event GOEP_SUBEVENT_GET_REQUEST
+ * @param event packet
+ * @return type
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_get_request_get_type(const uint8_t * event){
+    return &event[6u + event[5] + 1u];
+}
+
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_GET_COMPLETED
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_get_completed_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field status from event GOEP_SUBEVENT_GET_COMPLETED
+ * @param event packet
+ * @return status
+ * @note: btstack_type 1
+ */
+static inline uint8_t goep_subevent_get_completed_get_status(const uint8_t * event){
+    return event[5];
+}
+
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_DELETE_REQUEST
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_delete_request_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field name_len from event GOEP_SUBEVENT_DELETE_REQUEST
+ * @param event packet
+ * @return name_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_delete_request_get_name_len(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field name from event GOEP_SUBEVENT_DELETE_REQUEST
+ * @param event packet
+ * @return name
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_delete_request_get_name(const uint8_t * event){
+    return &event[6];
+}
+
+/**
+ * @brief Get field goep_cid from event GOEP_SUBEVENT_SET_PATH_REQUEST
+ * @param event packet
+ * @return goep_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t goep_subevent_set_path_request_get_goep_cid(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field flags from event GOEP_SUBEVENT_SET_PATH_REQUEST
+ * @param event packet
+ * @return flags
+ * @note: btstack_type 1
+ */
+static inline uint8_t goep_subevent_set_path_request_get_flags(const uint8_t * event){
+    return event[5];
+}
+/**
+ * @brief Get field name_len from event GOEP_SUBEVENT_SET_PATH_REQUEST
+ * @param event packet
+ * @return name_len
+ * @note: btstack_type J
+ */
+static inline uint8_t goep_subevent_set_path_request_get_name_len(const uint8_t * event){
+    return event[6];
+}
+/**
+ * @brief Get field name from event GOEP_SUBEVENT_SET_PATH_REQUEST
+ * @param event packet
+ * @return name
+ * @note: btstack_type V
+ */
+static inline const uint8_t * goep_subevent_set_path_request_get_name(const uint8_t * event){
+    return &event[7];
+}
 
 /**
  * @brief Get field pbap_cid from event PBAP_SUBEVENT_CONNECTION_OPENED
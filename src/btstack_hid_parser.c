@@ -531,3 +531,341 @@ int btstack_hid_report_id_declared(uint16_t hid_descriptor_len, const uint8_t *
     }
     return 0;
 }
+
+// Compiled HID Report Map
+
+typedef struct {
+    btstack_hid_report_map_t * map;
+    const uint8_t * descriptor;
+    uint16_t        descriptor_len;
+    // second pass stores fields
+    bool            store_fields;
+    bool            capacity_exceeded;
+
+    // global
+    int32_t         logical_minimum;
+    int32_t         logical_maximum;
+    uint16_t        usage_page;
+    uint16_t        report_count;
+    uint16_t        report_size;
+    uint8_t         report_id;
+
+    // usage generator, scans local items since last main item
+    uint16_t        usage_pos;
+    uint16_t        usage_scan_page;
+    uint32_t        usage_minimum;
+    uint32_t        usage_maximum;
+    uint32_t        available_usages;
+    uint32_t        last_usage;
+    bool            have_usage_min;
+    bool            have_usage_max;
+    bool            have_last_usage;
+} btstack_hid_report_map_compiler_t;
+
+static void hid_report_map_reset_usages(btstack_hid_report_map_compiler_t * compiler, uint16_t usage_pos){
+    compiler->usage_pos        = usage_pos;
+    compiler->usage_scan_page  = compiler->usage_page;
+    compiler->available_usages = 0;
+    compiler->have_usage_min   = false;
+    compiler->have_usage_max   = false;
+    compiler->have_last_usage  = false;
+}
+
+// get next usage from local items between last main item and current item, repeat last usage if exhausted
+static bool hid_report_map_next_usage(btstack_hid_report_map_compiler_t * compiler, uint16_t item_pos, uint32_t * usage){
+    while ((compiler->available_usages == 0u) && (compiler->usage_pos < item_pos)){
+        hid_descriptor_item_t usage_item;
+        btstack_hid_parse_descriptor_item(&usage_item, &compiler->descriptor[compiler->usage_pos], compiler->descriptor_len - compiler->usage_pos);
+        if ((usage_item.item_type == Global) && (usage_item.item_tag == UsagePage)){
+            compiler->usage_scan_page = usage_item.item_value;
+        }
+        if (usage_item.item_type == Local){
+            uint32_t usage_value = (usage_item.data_size > 2u) ? (uint32_t) usage_item.item_value : (((uint32_t) compiler->usage_scan_page << 16u) | (uint32_t) usage_item.item_value);
+            switch ((LocalItemTag)usage_item.item_tag){
+                case Usage:
+                    compiler->available_usages = 1;
+                    compiler->usage_minimum = usage_value;
+                    break;
+                case UsageMinimum:
+                    compiler->usage_minimum = usage_value;
+                    compiler->have_usage_min = true;
+                    break;
+                case UsageMaximum:
+                    compiler->usage_maximum = usage_value;
+                    compiler->have_usage_max = true;
+                    break;
+                default:
+                    break;
+            }
+            if (compiler->have_usage_min && compiler->have_usage_max){
+                if (compiler->usage_maximum >= compiler->usage_minimum){
+                    compiler->available_usages = compiler->usage_maximum - compiler->usage_minimum + 1u;
+                }
+                compiler->have_usage_min = false;
+                compiler->have_usage_max = false;
+            }
+        }
+        compiler->usage_pos += usage_item.item_size;
+    }
+    if (compiler->available_usages > 0u){
+        compiler->last_usage = compiler->usage_minimum++;
+        compiler->available_usages--;
+        compiler->have_last_usage = true;
+    }
+    *usage = compiler->last_usage;
+    return compiler->have_last_usage;
+}
+
+static btstack_hid_report_t * hid_report_map_get_report(const btstack_hid_report_map_t * map, uint8_t report_type, uint8_t report_id){
+    uint16_t i;
+    for (i = 0; i < map->num_reports; i++){
+        btstack_hid_report_t * report = &map->reports[i];
+        if ((report->report_type == report_type) && (report->report_id == report_id)){
+            return report;
+        }
+    }
+    return NULL;
+}
+
+static void hid_report_map_add_main_item(btstack_hid_report_map_compiler_t * compiler, uint8_t report_type, const hid_descriptor_item_t * item, uint16_t item_pos){
+    btstack_hid_report_map_t * map = compiler->map;
+    btstack_hid_report_t * report = hid_report_map_get_report(map, report_type, compiler->report_id);
+    if (report == NULL){
+        // reports are only added in first pass
+        if (map->num_reports >= map->max_reports){
+            compiler->capacity_exceeded = true;
+            return;
+        }
+        report = &map->reports[map->num_reports++];
+        memset(report, 0, sizeof(btstack_hid_report_t));
+        report->report_type = report_type;
+        report->report_id   = compiler->report_id;
+    }
+
+    // constant fields used for padding
+    if ((item->item_value & 1) != 0){
+        report->size_in_bits += compiler->report_size * compiler->report_count;
+        return;
+    }
+
+    // values are decoded into 32 bit, skip wider fields like padding
+    if (compiler->report_size > 32u){
+        log_info("HID Report Map: skip %u fields with Report Size %u", compiler->report_count, compiler->report_size);
+        report->size_in_bits += compiler->report_size * compiler->report_count;
+        return;
+    }
+
+    uint8_t flags = 0;
+    if ((item->item_value & 2) != 0){
+        flags |= BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE;
+    }
+    if (compiler->logical_minimum < 0){
+        flags |= BTSTACK_HID_REPORT_FIELD_FLAG_SIGNED;
+    }
+
+    // array fields use usage page of first usage
+    uint32_t usage = (uint32_t) compiler->usage_page << 16;
+    if ((flags & BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE) == 0u){
+        (void) hid_report_map_next_usage(compiler, item_pos, &usage);
+    }
+
+    uint16_t i;
+    for (i = 0; i < compiler->report_count; i++){
+        if ((flags & BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE) != 0u){
+            (void) hid_report_map_next_usage(compiler, item_pos, &usage);
+        }
+        if (compiler->store_fields){
+            btstack_hid_report_field_t * field = &map->fields[report->field_offset + report->num_fields];
+            field->bit_offset      = report->size_in_bits;
+            field->bit_size        = compiler->report_size;
+            field->flags           = flags;
+            field->usage_page      = usage >> 16;
+            field->usage           = usage & 0xffffu;
+            field->logical_minimum = compiler->logical_minimum;
+            field->logical_maximum = compiler->logical_maximum;
+        } else {
+            if (map->num_fields >= map->max_fields){
+                compiler->capacity_exceeded = true;
+                return;
+            }
+            map->num_fields++;
+        }
+        report->num_fields++;
+        report->size_in_bits += compiler->report_size;
+    }
+}
+
+static void hid_report_map_compile_pass(btstack_hid_report_map_compiler_t * compiler){
+    btstack_hid_report_map_t * map = compiler->map;
+    uint16_t pos = 0;
+
+    compiler->logical_minimum = 0;
+    compiler->logical_maximum = 0;
+    compiler->usage_page      = 0;
+    compiler->report_count    = 0;
+    compiler->report_size     = 0;
+    compiler->report_id       = 0;
+    hid_report_map_reset_usages(compiler, 0);
+
+    while ((pos < compiler->descriptor_len) && !compiler->capacity_exceeded){
+        hid_descriptor_item_t item;
+        btstack_hid_parse_descriptor_item(&item, &compiler->descriptor[pos], compiler->descriptor_len - pos);
+        // truncated item
+        if (item.item_size > (compiler->descriptor_len - pos)) break;
+        switch ((TagType)item.item_type){
+            case Main:
+                switch ((MainItemTag)item.item_tag){
+                    case Input:
+                        hid_report_map_add_main_item(compiler, HID_REPORT_TYPE_INPUT, &item, pos);
+                        break;
+                    case Output:
+                        hid_report_map_add_main_item(compiler, HID_REPORT_TYPE_OUTPUT, &item, pos);
+                        break;
+                    case Feature:
+                        hid_report_map_add_main_item(compiler, HID_REPORT_TYPE_FEATURE, &item, pos);
+                        break;
+                    default:
+                        break;
+                }
+                hid_report_map_reset_usages(compiler, pos + item.item_size);
+                break;
+            case Global:
+                switch ((GlobalItemTag)item.item_tag){
+                    case UsagePage:
+                        compiler->usage_page = item.item_value;
+                        break;
+                    case LogicalMinimum:
+                        compiler->logical_minimum = item.item_value;
+                        break;
+                    case LogicalMaximum:
+                        compiler->logical_maximum = item.item_value;
+                        break;
+                    case ReportSize:
+                        compiler->report_size = item.item_value;
+                        break;
+                    case ReportID:
+                        compiler->report_id = item.item_value;
+                        map->report_ids_declared = true;
+                        break;
+                    case ReportCount:
+                        compiler->report_count = item.item_value;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+        pos += item.item_size;
+    }
+}
+
+uint8_t btstack_hid_report_map_compile(btstack_hid_report_map_t * map, btstack_hid_report_t * reports, uint16_t max_reports,
+                                       btstack_hid_report_field_t * fields, uint16_t max_fields,
+                                       const uint8_t * hid_descriptor, uint16_t hid_descriptor_len){
+    memset(map, 0, sizeof(btstack_hid_report_map_t));
+    map->reports     = reports;
+    map->max_reports = max_reports;
+    map->fields      = fields;
+    map->max_fields  = max_fields;
+
+    btstack_hid_report_map_compiler_t compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    compiler.map            = map;
+    compiler.descriptor     = hid_descriptor;
+    compiler.descriptor_len = hid_descriptor_len;
+
+    // first pass: collect reports and count fields
+    hid_report_map_compile_pass(&compiler);
+    if (compiler.capacity_exceeded){
+        map->num_reports = 0;
+        map->num_fields  = 0;
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    // group fields by report
+    uint16_t field_offset = 0;
+    uint16_t i;
+    for (i = 0; i < map->num_reports; i++){
+        btstack_hid_report_t * report = &map->reports[i];
+        report->field_offset = field_offset;
+        field_offset += report->num_fields;
+        report->num_fields   = 0;
+        report->size_in_bits = 0;
+    }
+
+    // second pass: store fields
+    compiler.store_fields = true;
+    hid_report_map_compile_pass(&compiler);
+    return ERROR_CODE_SUCCESS;
+}
+
+const btstack_hid_report_t * btstack_hid_report_map_get_report(const btstack_hid_report_map_t * map, hid_report_type_t report_type, uint8_t report_id){
+    return hid_report_map_get_report(map, (uint8_t) report_type, report_id);
+}
+
+int btstack_hid_report_map_get_report_size(const btstack_hid_report_map_t * map, hid_report_type_t report_type, uint8_t report_id){
+    const btstack_hid_report_t * report = hid_report_map_get_report(map, (uint8_t) report_type, report_id);
+    if (report == NULL) return 0;
+    return (report->size_in_bits + 7) / 8;
+}
+
+void btstack_hid_report_decoder_init(btstack_hid_report_decoder_t * decoder, const btstack_hid_report_map_t * map, hid_report_type_t report_type, const uint8_t * report, uint16_t report_len){
+    memset(decoder, 0, sizeof(btstack_hid_report_decoder_t));
+    uint8_t report_id = 0;
+    if (map->report_ids_declared){
+        if (report_len < 1u) return;
+        report_id = report[0];
+        report++;
+        report_len--;
+    }
+    const btstack_hid_report_t * hid_report = hid_report_map_get_report(map, (uint8_t) report_type, report_id);
+    if (hid_report == NULL) return;
+    decoder->field              = &map->fields[hid_report->field_offset];
+    decoder->fields_end         = decoder->field + hid_report->num_fields;
+    decoder->report             = report;
+    decoder->report_len_in_bits = (uint32_t) report_len * 8u;
+}
+
+bool btstack_hid_report_decoder_has_more(const btstack_hid_report_decoder_t * decoder){
+    if (decoder->field == decoder->fields_end) return false;
+    // fields are sorted by bit offset, stop at end of report
+    return ((uint32_t) decoder->field->bit_offset + decoder->field->bit_size) <= decoder->report_len_in_bits;
+}
+
+const btstack_hid_report_field_t * btstack_hid_report_decoder_get_field_info(const btstack_hid_report_decoder_t * decoder){
+    return decoder->field;
+}
+
+void btstack_hid_report_decoder_get_field(btstack_hid_report_decoder_t * decoder, uint16_t * usage_page, uint16_t * usage, int32_t * value){
+    const btstack_hid_report_field_t * field = decoder->field++;
+    const uint8_t * data = &decoder->report[field->bit_offset >> 3];
+    const uint8_t shift  = field->bit_offset & 0x07u;
+    const uint8_t size   = field->bit_size;
+
+    // read up to 32 bit, bytes_to_read <= 5
+    uint16_t bytes_to_read = (shift + size + 7u) >> 3u;
+    uint64_t multi_byte_value = 0;
+    uint16_t i;
+    for (i = 0; i < bytes_to_read; i++){
+        multi_byte_value |= ((uint64_t) data[i]) << (i * 8u);
+    }
+    uint32_t unsigned_value = (uint32_t) (multi_byte_value >> shift);
+    if (size < 32u){
+        unsigned_value &= (1u << size) - 1u;
+    }
+
+    *usage_page = field->usage_page;
+    if ((field->flags & BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE) != 0u){
+        *usage = field->usage;
+        if (((field->flags & BTSTACK_HID_REPORT_FIELD_FLAG_SIGNED) != 0u) && (size > 0u) && (size < 32u) && ((unsigned_value & (1u << (size - 1u))) != 0u)){
+            *value = (int32_t) (unsigned_value - (1u << size));
+        } else {
+            *value = (int32_t) unsigned_value;
+        }
+    } else {
+        *usage = unsigned_value;
+        *value = 1;
+    }
+}
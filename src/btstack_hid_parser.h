@@ -40,12 +40,16 @@
  *
  * Single-pass HID Report Parser: HID Report is directly parsed without preprocessing HID Descriptor to minimize memory.
  *
+ * Compiled HID Report Map: HID Descriptor is compiled once into a flat table of report fields per Report ID and
+ * report type. Reports can then be decoded without parsing the HID Descriptor again.
+ *
  */
 
 #ifndef BTSTACK_HID_PARSER_H
 #define BTSTACK_HID_PARSER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "btstack_hid.h"
 
 #if defined __cplusplus
@@ -151,6 +155,50 @@ typedef struct {
     uint8_t         global_report_id;
 } btstack_hid_parser_t;
 
+// report field flags
+#define BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE 0x01u
+#define BTSTACK_HID_REPORT_FIELD_FLAG_SIGNED   0x02u
+
+typedef struct {
+    // position in report, not including Report ID
+    uint16_t bit_offset;
+    uint8_t  bit_size;
+    uint8_t  flags;
+    uint16_t usage_page;
+    // usage for variable fields, array fields report usage as value
+    uint16_t usage;
+    int32_t  logical_minimum;
+    int32_t  logical_maximum;
+} btstack_hid_report_field_t;
+
+typedef struct {
+    uint8_t  report_id;
+    uint8_t  report_type;
+    uint16_t field_offset;
+    uint16_t num_fields;
+    // includes constant fields, not including Report ID
+    uint16_t size_in_bits;
+} btstack_hid_report_t;
+
+typedef struct {
+    btstack_hid_report_t       * reports;
+    btstack_hid_report_field_t * fields;
+    uint16_t max_reports;
+    uint16_t max_fields;
+    uint16_t num_reports;
+    uint16_t num_fields;
+    // reports start with Report ID
+    bool     report_ids_declared;
+} btstack_hid_report_map_t;
+
+typedef struct {
+    const btstack_hid_report_field_t * field;
+    const btstack_hid_report_field_t * fields_end;
+    // report data after Report ID
+    const uint8_t * report;
+    uint32_t        report_len_in_bits;
+} btstack_hid_report_decoder_t;
+
 /* API_START */
 
 /**
@@ -210,6 +258,75 @@ hid_report_id_status_t btstack_hid_id_valid(int report_id, uint16_t hid_descript
  * @param hid_descriptor
  */
 int btstack_hid_report_id_declared(uint16_t hid_descriptor_len, const uint8_t * hid_descriptor);
+
+/**
+ * @brief Compile HID Descriptor into report map. Each field of a report gets its own entry in the field table,
+ *        i.e. a Report Count of 8 for 1-bit buttons results in 8 entries. Constant fields and fields with a
+ *        Report Size above 32 bits are not stored.
+ * @note Push/Pop are not supported. If a main item has less usages than its Report Count, the last usage is repeated.
+ * @param map
+ * @param reports storage for reports
+ * @param max_reports
+ * @param fields storage for report fields
+ * @param max_fields
+ * @param hid_descriptor
+ * @param hid_descriptor_len
+ * @returns ERROR_CODE_SUCCESS or ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if storage is too small
+ */
+uint8_t btstack_hid_report_map_compile(btstack_hid_report_map_t * map, btstack_hid_report_t * reports, uint16_t max_reports,
+                                       btstack_hid_report_field_t * fields, uint16_t max_fields,
+                                       const uint8_t * hid_descriptor, uint16_t hid_descriptor_len);
+
+/**
+ * @brief Get report for given report type and Report ID
+ * @param map
+ * @param report_type
+ * @param report_id, use 0 if no Report IDs are declared
+ * @returns report or NULL if not found
+ */
+const btstack_hid_report_t * btstack_hid_report_map_get_report(const btstack_hid_report_map_t * map, hid_report_type_t report_type, uint8_t report_id);
+
+/**
+ * @brief Get report size for given report type and Report ID, same as btstack_hid_get_report_size_for_id
+ * @param map
+ * @param report_type
+ * @param report_id
+ * @returns report size in bytes not including Report ID, or 0 if not found
+ */
+int btstack_hid_report_map_get_report_size(const btstack_hid_report_map_t * map, hid_report_type_t report_type, uint8_t report_id);
+
+/**
+ * @brief Initialize decoder for report. If Report IDs are declared, the first byte of the report is the Report ID.
+ * @param decoder
+ * @param map
+ * @param report_type
+ * @param report
+ * @param report_len
+ */
+void btstack_hid_report_decoder_init(btstack_hid_report_decoder_t * decoder, const btstack_hid_report_map_t * map, hid_report_type_t report_type, const uint8_t * report, uint16_t report_len);
+
+/**
+ * @brief Checks if more fields are available
+ * @param decoder
+ */
+bool btstack_hid_report_decoder_has_more(const btstack_hid_report_decoder_t * decoder);
+
+/**
+ * @brief Get description of next field, e.g. to get logical range
+ * @param decoder
+ * @returns field
+ */
+const btstack_hid_report_field_t * btstack_hid_report_decoder_get_field_info(const btstack_hid_report_decoder_t * decoder);
+
+/**
+ * @brief Get next field, same as btstack_hid_parser_get_field
+ * @param decoder
+ * @param usage_page
+ * @param usage
+ * @param value provided in HID report
+ */
+void btstack_hid_report_decoder_get_field(btstack_hid_report_decoder_t * decoder, uint16_t * usage_page, uint16_t * usage, int32_t * value);
+
 /* API_END */
 
 #if defined __cplusplus
@@ -83,6 +83,30 @@ void btstack_network_process_packet(const uint8_t * packet, uint16_t size);
  */
 void btstack_network_packet_sent(void);
 
+/**
+ * @brief Add BNEP channel to bridge, e.g. for NAP with multiple PANU clients.
+ * @note Frames from network interface are queued for all bridged channels with matching destination address
+ *       using bnep_send_frame instead of being passed to send_packet_callback
+ * @param bnep_cid
+ * @param remote_addr
+ * @return 0 if ok
+ */
+int  btstack_network_bridge_add_channel(uint16_t bnep_cid, bd_addr_t remote_addr);
+
+/**
+ * @brief Remove BNEP channel from bridge
+ * @param bnep_cid
+ */
+void btstack_network_bridge_remove_channel(uint16_t bnep_cid);
+
+/**
+ * @brief Forward packet received on bridged BNEP channel to network interface and/or other bridged channels
+ * @param bnep_cid
+ * @param packet
+ * @param size
+ */
+void btstack_network_bridge_process_packet(uint16_t bnep_cid, const uint8_t * packet, uint16_t size);
+
 /**
  * @brief Get network name after network was activated
  * @note e.g. tapX on Linux, might not be useful on all platforms
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_resample_polyphase.c"
+
+#include <string.h>
+
+#ifdef __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
+
+#include "btstack_resample_polyphase.h"
+
+#define NUM_TAPS   BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS
+#define NUM_PHASES BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES
+
+// input frames that are de-interleaved and filtered at once
+#define CHUNK_FRAMES 64
+
+// cutoff frequency relative to Nyquist frequency of lower sample rate, Q16 (0.9)
+#define CUTOFF_ROLLOFF 58982
+
+// drift compensation: correction relative to nominal step in units of 2^-24 (~0.06 ppm)
+#define DRIFT_CORRECTION_SHIFT 24
+// ~15 ppm per frame of buffer level error
+#define DRIFT_KP               256
+#define DRIFT_KI_SHIFT         1
+// ~0.2 %
+#define DRIFT_MAX_CORRECTION   (1 << 15)
+
+// filter design uses Q30 fixed point, angles are given in turns with 2^32 for a full circle
+#define Q30_ONE       (1 << 30)
+#define Q30_PI        3373259426LL
+#define QUARTER_TURN  0x40000000LL
+#define HALF_TURN     0x80000000LL
+
+// Blackman window coefficients in Q30: 0.42, 0.5, 0.08
+#define WINDOW_A0     450971566LL
+#define WINDOW_A1     536870912LL
+#define WINDOW_A2     85899346LL
+
+// sine for filter design without libm and FPU: range reduction to [-pi/2, pi/2] and Taylor series, result in Q30
+static int64_t btstack_resample_polyphase_sin(uint32_t angle){
+    int64_t turns = (int32_t) angle;
+    if (turns > QUARTER_TURN){
+        turns = HALF_TURN - turns;
+    } else if (turns < -QUARTER_TURN){
+        turns = -HALF_TURN - turns;
+    }
+    int64_t x  = (turns * Q30_PI) >> 31;
+    int64_t x2 = (x * x) >> 30;
+    int64_t t  = Q30_ONE - (x2 / 110);
+    t = Q30_ONE - (((x2 * t) >> 30) / 72);
+    t = Q30_ONE - (((x2 * t) >> 30) / 42);
+    t = Q30_ONE - (((x2 * t) >> 30) / 20);
+    t = Q30_ONE - (((x2 * t) >> 30) / 6);
+    return (x * t) >> 30;
+}
+
+static int64_t btstack_resample_polyphase_cos(uint32_t angle){
+    return btstack_resample_polyphase_sin(angle + (uint32_t) QUARTER_TURN);
+}
+
+// Blackman windowed sinc with cutoff relative to Nyquist frequency in Q16, x in input frames from filter center in Q16
+// returns unnormalized coefficient in Q30
+static int64_t btstack_resample_polyphase_kernel(int32_t x, int32_t cutoff){
+    const int64_t half_length = NUM_TAPS / 2;
+    if ((x <= -(half_length * 65536)) || (x >= (half_length * 65536))) return 0;
+    // pi * x / half_length
+    uint32_t window_angle = (uint32_t) ((((int64_t) x) * 32768) / half_length);
+    int64_t window = WINDOW_A0 + ((WINDOW_A1 * btstack_resample_polyphase_cos(window_angle)) >> 30)
+                               + ((WINDOW_A2 * btstack_resample_polyphase_cos(window_angle * 2u)) >> 30);
+    // sinc(cutoff * x) = sin(pi * cutoff * x) / (pi * cutoff * x)
+    int64_t cutoff_x = ((int64_t) cutoff * x) >> 16;
+    int64_t sinc = Q30_ONE;
+    if (cutoff_x != 0){
+        int64_t arg = (cutoff_x * Q30_PI) >> 16;
+        sinc = (btstack_resample_polyphase_sin((uint32_t) (cutoff_x * 32768)) * Q30_ONE) / arg;
+    }
+    return (((cutoff * sinc) >> 16) * window) >> 30;
+}
+
+// row p contains the coefficients for an output position p / NUM_PHASES frames after the filter center
+static void btstack_resample_polyphase_design_filter(btstack_resample_polyphase_t * context, int32_t cutoff){
+    int phase;
+    for (phase = 0; phase <= NUM_PHASES; phase++){
+        int64_t coefficients[NUM_TAPS];
+        int16_t * row = &context->filter[phase * NUM_TAPS];
+        int32_t offset = ((NUM_TAPS / 2 - 1) << 16) + ((phase << 16) / NUM_PHASES);
+        int64_t sum = 0;
+        int     tap;
+        for (tap = 0; tap < NUM_TAPS; tap++){
+            coefficients[tap] = btstack_resample_polyphase_kernel(offset - (tap * 65536), cutoff);
+            sum += coefficients[tap];
+        }
+        // normalize for unity DC gain and quantize to Q15, put rounding error into the center tap
+        int32_t quantized_sum = 0;
+        int center_tap = NUM_TAPS / 2 - 1 + (phase * 2 >= NUM_PHASES ? 1 : 0);
+        for (tap = 0; tap < NUM_TAPS; tap++){
+            int64_t value = coefficients[tap] * 32768;
+            value = (value >= 0) ? ((value + (sum / 2)) / sum) : ((value - (sum / 2)) / sum);
+            row[tap] = (int16_t) value;
+            quantized_sum += row[tap];
+        }
+        row[center_tap] += (int16_t) (32768 - quantized_sum);
+    }
+}
+
+static void btstack_resample_polyphase_set_steps(btstack_resample_polyphase_t * context, uint32_t step){
+    context->src_step       = step;
+    context->nominal_step   = step;
+    context->drift_integral = 0;
+}
+
+void btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, int num_channels){
+    memset(context, 0, sizeof(btstack_resample_polyphase_t));
+    context->num_channels = num_channels;
+    btstack_resample_polyphase_set_steps(context, 0x10000);
+    btstack_resample_polyphase_design_filter(context, CUTOFF_ROLLOFF);
+}
+
+void btstack_resample_polyphase_set_sample_rates(btstack_resample_polyphase_t * context, uint32_t input_sample_rate, uint32_t output_sample_rate){
+    if ((input_sample_rate == 0) || (output_sample_rate == 0)) return;
+    uint32_t step = (uint32_t) ((((uint64_t) input_sample_rate) << 16) / output_sample_rate);
+    btstack_resample_polyphase_set_steps(context, step);
+    int32_t cutoff = CUTOFF_ROLLOFF;
+    if (output_sample_rate < input_sample_rate){
+        cutoff = (int32_t) ((((uint64_t) cutoff) * output_sample_rate) / input_sample_rate);
+    }
+    btstack_resample_polyphase_design_filter(context, cutoff);
+}
+
+void btstack_resample_polyphase_set_factor(btstack_resample_polyphase_t * context, uint32_t factor){
+    btstack_resample_polyphase_set_steps(context, factor);
+}
+
+uint32_t btstack_resample_polyphase_get_factor(btstack_resample_polyphase_t * context){
+    return context->src_step;
+}
+
+static int32_t btstack_resample_polyphase_clamp(int32_t value, int32_t limit){
+    if (value > limit)  return limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+void btstack_resample_polyphase_track_buffer_level(btstack_resample_polyphase_t * context, uint32_t buffer_level, uint32_t target_level){
+    int32_t error = btstack_resample_polyphase_clamp((int32_t) buffer_level - (int32_t) target_level, DRIFT_MAX_CORRECTION);
+    // integrate with anti-windup
+    const int32_t max_integral = DRIFT_MAX_CORRECTION << DRIFT_KI_SHIFT;
+    context->drift_integral = btstack_resample_polyphase_clamp(context->drift_integral + error, max_integral);
+    int32_t correction = (error * DRIFT_KP) + (context->drift_integral >> DRIFT_KI_SHIFT);
+    correction = btstack_resample_polyphase_clamp(correction, DRIFT_MAX_CORRECTION);
+    context->src_step = (uint32_t) ((int64_t) context->nominal_step + ((((int64_t) context->nominal_step) * correction) >> DRIFT_CORRECTION_SHIFT));
+}
+
+static int32_t btstack_resample_polyphase_dot_product(const int16_t * samples, const int16_t * coefficients){
+    int32_t acc_0 = 0;
+    int32_t acc_1 = 0;
+    int i;
+#ifdef __ARM_FEATURE_SIMD32
+    // dual 16-bit multiply accumulate, two accumulators
+    for (i = 0; i < NUM_TAPS; i += 4){
+        int16x2_t samples_pair[2];
+        int16x2_t coefficients_pair[2];
+        memcpy(samples_pair, &samples[i], sizeof(samples_pair));
+        memcpy(coefficients_pair, &coefficients[i], sizeof(coefficients_pair));
+        acc_0 = __smlad(samples_pair[0], coefficients_pair[0], acc_0);
+        acc_1 = __smlad(samples_pair[1], coefficients_pair[1], acc_1);
+    }
+#else
+    for (i = 0; i < NUM_TAPS; i += 2){
+        acc_0 += (int32_t) samples[i]   * coefficients[i];
+        acc_1 += (int32_t) samples[i+1] * coefficients[i+1];
+    }
+#endif
+    return acc_0 + acc_1;
+}
+
+static int16_t btstack_resample_polyphase_saturate(int64_t value){
+    if (value > 32767)  return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t) value;
+}
+
+uint16_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer){
+    // per channel: history followed by current chunk
+    int16_t  work[BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS][NUM_TAPS - 1 + CHUNK_FRAMES];
+    uint16_t dest_frames = 0;
+    uint16_t dest_samples = 0;
+    uint32_t input_pos = 0;
+    const int num_channels = context->num_channels;
+
+    while (input_pos < num_frames){
+        const uint32_t chunk_frames = ((num_frames - input_pos) < CHUNK_FRAMES) ? (num_frames - input_pos) : CHUNK_FRAMES;
+        const uint32_t work_frames  = NUM_TAPS - 1 + chunk_frames;
+        int channel;
+        uint32_t i;
+
+        // de-interleave
+        for (channel = 0; channel < num_channels; channel++){
+            int16_t * channel_work = work[channel];
+            const int16_t * channel_input = &input_buffer[input_pos * num_channels + channel];
+            memcpy(channel_work, context->history[channel], (NUM_TAPS - 1) * sizeof(int16_t));
+            for (i = 0; i < chunk_frames; i++){
+                channel_work[NUM_TAPS - 1 + i] = channel_input[i * num_channels];
+            }
+        }
+
+        // filter while all taps are available
+        while (((context->src_pos >> 16) + NUM_TAPS) <= work_frames){
+            const uint32_t index     = context->src_pos >> 16;
+            const uint32_t phase_pos = (context->src_pos & 0xffffu) * NUM_PHASES;
+            const int16_t * coefficients = &context->filter[(phase_pos >> 16) * NUM_TAPS];
+            const int64_t  weight    = phase_pos & 0xffffu;
+            for (channel = 0; channel < num_channels; channel++){
+                // interpolate between adjacent phases, Q15 * Q16 -> Q31
+                int32_t d0 = btstack_resample_polyphase_dot_product(&work[channel][index], coefficients);
+                int32_t d1 = btstack_resample_polyphase_dot_product(&work[channel][index], coefficients + NUM_TAPS);
+                int64_t acc = ((int64_t) d0 * (0x10000 - weight)) + ((int64_t) d1 * weight);
+                output_buffer[dest_samples++] = btstack_resample_polyphase_saturate((acc + (1 << 30)) >> 31);
+            }
+            dest_frames++;
+            context->src_pos += context->src_step;
+        }
+
+        // keep last frames as history
+        for (channel = 0; channel < num_channels; channel++){
+            memcpy(context->history[channel], &work[channel][chunk_frames], (NUM_TAPS - 1) * sizeof(int16_t));
+        }
+        context->src_pos -= chunk_frames << 16;
+        input_pos += chunk_frames;
+    }
+    return dest_frames;
+}
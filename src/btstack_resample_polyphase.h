@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title Polyphase Resampling
+ *
+ * Windowed-sinc polyphase resampling for 16-bit audio samples with continuous drift compensation.
+ * Provides the same streaming API as btstack_resample and can be used as a drop-in replacement.
+ *
+ * The linear interpolation in btstack_resample remains the default. Use this resampler only if the
+ * CPU budget allows: with the default 24 taps it needs about 10 to 20 times the CPU time of btstack_resample,
+ * and improves the SNR from 35..55 dB to about 80 dB, e.g. for 44100 -> 48000 Hz.
+ * RAM use is about 1.7 kB per context for the filter bank and history.
+ *
+ * The filter bank is calculated in fixed point for the configured sample rates, no FPU or libm is needed.
+ * For downsampling, the cutoff frequency is lowered to the output Nyquist frequency.
+ * Filtering uses a portable C implementation, or the dual 16-bit MAC (SMLAD) if __ARM_FEATURE_SIMD32 is set.
+ *
+ * Compile-time configuration in btstack_config.h:
+ * - BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS   - filter length in input frames, must be a multiple of 4, default 24
+ * - BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES - number of filter phases, intermediate phases are interpolated, default 32
+ *
+ */
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_H
+#define BTSTACK_RESAMPLE_POLYPHASE_H
+
+#include <stdint.h>
+
+#include "btstack_config.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS 2
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS
+#define BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS 24
+#endif
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES
+#define BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES 32
+#endif
+
+#if (BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS & 3) != 0
+#error "BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS must be a multiple of 4"
+#endif
+
+typedef struct {
+    // position of next output frame relative to oldest frame in history, 16.16 fixed point
+    uint32_t src_pos;
+    // current step and nominal step without drift compensation, 16.16 fixed point
+    uint32_t src_step;
+    uint32_t nominal_step;
+    // drift compensation
+    int32_t  drift_integral;
+    int      num_channels;
+    // filter bank: NUM_PHASES + 1 rows with NUM_TAPS Q15 coefficients each
+    int16_t  filter[(BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES + 1) * BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS];
+    // last NUM_TAPS - 1 input frames per channel
+    int16_t  history[BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS][BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS - 1];
+} btstack_resample_polyphase_t;
+
+/* API_START */
+
+/**
+ * @brief Init resample context with resampling factor 1.0
+ * @param context
+ * @param num_channels
+ */
+void btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, int num_channels);
+
+/**
+ * @brief Configure input and output sample rates, e.g. 44100 -> 48000. Resets drift compensation.
+ * @param context
+ * @param input_sample_rate
+ * @param output_sample_rate
+ */
+void btstack_resample_polyphase_set_sample_rates(btstack_resample_polyphase_t * context, uint32_t input_sample_rate, uint32_t output_sample_rate);
+
+/**
+ * @brief Set resampling factor directly, same as btstack_resample_set_factor. Filter bank is not updated.
+ * @param context
+ * @param factor as fixed point value, identity is 0x10000
+ */
+void btstack_resample_polyphase_set_factor(btstack_resample_polyphase_t * context, uint32_t factor);
+
+/**
+ * @brief Get current resampling factor including drift compensation
+ * @param context
+ * @returns factor as fixed point value, identity is 0x10000
+ */
+uint32_t btstack_resample_polyphase_get_factor(btstack_resample_polyphase_t * context);
+
+/**
+ * @brief Track clock drift between source and sink by keeping a buffer fill level close to its target.
+ * @note Call regularly, e.g. for each received media packet. A fuller buffer increases the factor
+ *       and causes fewer output frames to be generated.
+ * @param context
+ * @param buffer_level in frames
+ * @param target_level in frames
+ */
+void btstack_resample_polyphase_track_buffer_level(btstack_resample_polyphase_t * context, uint32_t buffer_level, uint32_t target_level);
+
+/**
+ * @brief Process block of input samples
+ * @note size of output buffer is not checked, it has to hold at least num_frames * output rate / input rate + 1 frames
+ * @note output is delayed by NUM_TAPS / 2 input frames
+ * @param context
+ * @param input_buffer
+ * @param num_frames
+ * @param output_buffer
+ * @returns number destination frames
+ */
+uint16_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
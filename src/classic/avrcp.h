@@ -494,6 +494,10 @@ typedef struct {
     uint8_t cmd_operands_length;
 
     bool incoming_declined;
+
+    // paged item cache, see avrcp_browsing_cursor.h
+    struct avrcp_browsing_cursor * cursor;
+    bool cursor_request;
 } avrcp_browsing_connection_t;
 
 typedef struct {
@@ -350,6 +350,10 @@ static void avrcp_browsing_packet_handler(uint8_t packet_type, uint16_t channel,
                     if ((connection_controller->browsing_connection == NULL) || (connection_target->browsing_connection == NULL)) {
                         break;
                     }
+                    // let controller abort pending requests
+                    if (avrcp_browsing_controller_packet_handler != NULL){
+                        (*avrcp_browsing_controller_packet_handler)(HCI_EVENT_PACKET, channel, packet, size);
+                    }
                     avrcp_browsing_emit_connection_closed(connection_controller->avrcp_browsing_cid);
                     avrcp_browsing_finalize_connection(connection_controller);
                     avrcp_browsing_finalize_connection(connection_target);
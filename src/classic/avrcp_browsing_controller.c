@@ -42,6 +42,7 @@
 #include <inttypes.h>
 #include "classic/avrcp_browsing.h"
 #include "classic/avrcp_browsing_controller.h"
+#include "classic/avrcp_browsing_cursor.h"
 #include "classic/avrcp_controller.h"
 
 #include "bluetooth_sdp.h"
@@ -273,6 +274,15 @@ static void avrcp_browsing_controller_handle_can_send_now(avrcp_browsing_connect
                 avrcp_browsing_controller_send_search_cmd(connection->l2cap_browsing_cid, connection);
                 break;   
             }
+
+            if ((connection->cursor != NULL) && avrcp_browsing_cursor_get_request(connection->cursor, &connection->start_item, &connection->end_item)){
+                connection->state = AVCTP_W2_RECEIVE_RESPONSE;
+                connection->cursor_request = true;
+                connection->scope = connection->cursor->scope;
+                connection->attr_bitmap = connection->cursor->attr_bitmap;
+                avrcp_browsing_controller_send_get_folder_items_cmd(connection->l2cap_browsing_cid, connection);
+                break;
+            }
             break;
         default:
             return;
@@ -369,8 +379,31 @@ static void avrcp_browsing_parse_and_emit_element_attrs(uint8_t * packet, uint16
     }
 }
 
-static void avrcp_browsing_controller_emit_failed(btstack_packet_handler_t callback, uint16_t browsing_cid, uint8_t browsing_status, uint8_t bluetooth_status){
-    avrcp_browsing_controller_emit_done_with_uid_counter(callback, browsing_cid, 0, browsing_status, bluetooth_status);
+// completes cursor request or reports result of application request
+static void avrcp_browsing_controller_request_done(avrcp_browsing_connection_t * connection, uint16_t browsing_cid, uint16_t uid_counter, uint8_t browsing_status){
+    connection->state = AVCTP_CONNECTION_OPENED;
+    if (connection->cursor_request){
+        // cursor may have been detached while request was pending
+        connection->cursor_request = false;
+        if (connection->cursor != NULL){
+            avrcp_browsing_cursor_handle_response_end(connection->cursor, browsing_status);
+        }
+    } else {
+        avrcp_browsing_controller_emit_done_with_uid_counter(avrcp_controller_context.browsing_avrcp_callback, browsing_cid, uid_counter, browsing_status, ERROR_CODE_SUCCESS);
+    }
+    // cursor may wait for idle connection
+    if ((connection->cursor != NULL) && (connection->state == AVCTP_CONNECTION_OPENED) && !connection->wait_to_send){
+        avrcp_browsing_request_can_send_now(connection, connection->l2cap_browsing_cid);
+    }
+}
+
+static void avrcp_browsing_controller_cursor_request_handler(avrcp_browsing_cursor_t * cursor){
+    avrcp_connection_t * avrcp_connection = avrcp_get_connection_for_browsing_cid_for_role(AVRCP_CONTROLLER, cursor->avrcp_browsing_cid);
+    if (avrcp_connection == NULL) return;
+    avrcp_browsing_connection_t * connection = avrcp_connection->browsing_connection;
+    if ((connection == NULL) || (connection->cursor != cursor)) return;
+    if ((connection->state != AVCTP_CONNECTION_OPENED) || connection->wait_to_send) return;
+    avrcp_browsing_request_can_send_now(connection, connection->l2cap_browsing_cid);
 }
 
 
@@ -397,16 +430,14 @@ static void avrcp_browsing_controller_packet_handler(uint8_t packet_type, uint16
                         browsing_connection->num_packets = packet[pos++];
                     } 
                     if ((pos + 4) > size){
-                        browsing_connection->state = AVCTP_CONNECTION_OPENED;
-                        avrcp_browsing_controller_emit_failed(avrcp_controller_context.browsing_avrcp_callback, channel, AVRCP_BROWSING_ERROR_CODE_INVALID_COMMAND, ERROR_CODE_SUCCESS);
+                        avrcp_browsing_controller_request_done(browsing_connection, channel, 0, AVRCP_BROWSING_ERROR_CODE_INVALID_COMMAND);
                         return;  
                     }
                     browsing_connection->pdu_id = packet[pos++];
                     pos += 2;
                     browsing_connection->browsing_status = packet[pos++]; 
                     if (browsing_connection->browsing_status != AVRCP_BROWSING_ERROR_CODE_SUCCESS){
-                        browsing_connection->state = AVCTP_CONNECTION_OPENED;
-                        avrcp_browsing_controller_emit_failed(avrcp_controller_context.browsing_avrcp_callback, channel, browsing_connection->browsing_status, ERROR_CODE_SUCCESS);
+                        avrcp_browsing_controller_request_done(browsing_connection, channel, 0, browsing_connection->browsing_status);
                         return;        
                     }
                     break;
@@ -448,6 +479,29 @@ static void avrcp_browsing_controller_packet_handler(uint8_t packet_type, uint16
                     break;
 
                 case AVRCP_PDU_ID_GET_FOLDER_ITEMS:{
+                    if (browsing_connection->cursor_request){
+                        // response for detached cursor is dropped
+                        if (browsing_connection->cursor == NULL) break;
+                        // items are parsed by cursor without re-assembly
+                        switch (avctp_packet_type){
+                            case AVRCP_SINGLE_PACKET:
+                            case AVRCP_START_PACKET:
+                                if ((pos + 4) > size){
+                                    avrcp_browsing_controller_request_done(browsing_connection, channel, 0, AVRCP_BROWSING_ERROR_CODE_INVALID_COMMAND);
+                                    return;
+                                }
+                                browsing_connection->uid_counter =  big_endian_read_16(packet, pos);
+                                pos += 2;
+                                browsing_connection->num_items = big_endian_read_16(packet, pos);
+                                pos += 2;
+                                avrcp_browsing_cursor_handle_response_begin(browsing_connection->cursor, browsing_connection->uid_counter, browsing_connection->num_items);
+                                break;
+                            default:
+                                break;
+                        }
+                        avrcp_browsing_cursor_handle_response_data(browsing_connection->cursor, packet+pos, size-pos);
+                        break;
+                    }
                     switch (avctp_packet_type){
                         case AVRCP_SINGLE_PACKET:
                         case AVRCP_START_PACKET:
@@ -490,8 +544,7 @@ static void avrcp_browsing_controller_packet_handler(uint8_t packet_type, uint16
             switch (avctp_packet_type){
                 case AVRCP_SINGLE_PACKET:
                 case AVRCP_END_PACKET:
-                    browsing_connection->state = AVCTP_CONNECTION_OPENED;
-                    avrcp_browsing_controller_emit_done_with_uid_counter(avrcp_controller_context.browsing_avrcp_callback, channel, browsing_connection->uid_counter, browsing_connection->browsing_status, ERROR_CODE_SUCCESS);
+                    avrcp_browsing_controller_request_done(browsing_connection, channel, browsing_connection->uid_counter, browsing_connection->browsing_status);
                     break;
                 default:
                     break;
@@ -504,6 +557,19 @@ static void avrcp_browsing_controller_packet_handler(uint8_t packet_type, uint16
                     browsing_connection = avrcp_get_browsing_connection_for_l2cap_cid_for_role(AVRCP_CONTROLLER,channel);
                     avrcp_browsing_controller_handle_can_send_now(browsing_connection);
                     break;
+                case L2CAP_EVENT_CHANNEL_CLOSED:
+                    browsing_connection = avrcp_get_browsing_connection_for_l2cap_cid_for_role(AVRCP_CONTROLLER, l2cap_event_channel_closed_get_local_cid(packet));
+                    if (browsing_connection == NULL) break;
+                    if (browsing_connection->cursor_request){
+                        browsing_connection->cursor_request = false;
+                        if (browsing_connection->cursor != NULL){
+                            avrcp_browsing_cursor_handle_response_end(browsing_connection->cursor, AVRCP_BROWSING_ERROR_CODE_INTERNAL_ERROR);
+                        }
+                    }
+                    if (browsing_connection->cursor == NULL) break;
+                    browsing_connection->cursor->request_handler = NULL;
+                    browsing_connection->cursor = NULL;
+                    break;
                 default:
                     break;
             }
@@ -715,3 +781,40 @@ uint8_t avrcp_browsing_controller_get_total_nr_items_for_scope(uint16_t avrcp_br
     avrcp_browsing_request_can_send_now(connection, connection->l2cap_browsing_cid);
     return ERROR_CODE_SUCCESS;
 }
+
+uint8_t avrcp_browsing_controller_attach_cursor(uint16_t avrcp_browsing_cid, avrcp_browsing_cursor_t * cursor){
+    avrcp_connection_t * avrcp_connection = avrcp_get_connection_for_browsing_cid_for_role(AVRCP_CONTROLLER, avrcp_browsing_cid);
+    if (!avrcp_connection){
+        log_error("avrcp_browsing_controller_attach_cursor: could not find a connection.");
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+    avrcp_browsing_connection_t * connection = avrcp_connection->browsing_connection;
+    if ((connection == NULL) || (connection->cursor != NULL)){
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+    // items of a previous connection are kept, request of previous connection is dropped
+    avrcp_browsing_cursor_cancel_request(cursor);
+    cursor->avrcp_browsing_cid = avrcp_browsing_cid;
+    cursor->request_handler = &avrcp_browsing_controller_cursor_request_handler;
+    // response to request of a previously attached cursor is dropped, new cursor waits for it
+    connection->cursor = cursor;
+    avrcp_browsing_controller_cursor_request_handler(cursor);
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t avrcp_browsing_controller_detach_cursor(uint16_t avrcp_browsing_cid){
+    avrcp_connection_t * avrcp_connection = avrcp_get_connection_for_browsing_cid_for_role(AVRCP_CONTROLLER, avrcp_browsing_cid);
+    if (!avrcp_connection){
+        log_error("avrcp_browsing_controller_detach_cursor: could not find a connection.");
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+    avrcp_browsing_connection_t * connection = avrcp_connection->browsing_connection;
+    if ((connection == NULL) || (connection->cursor == NULL)){
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+    // cursor_request stays set until response to pending request has been received and dropped
+    avrcp_browsing_cursor_cancel_request(connection->cursor);
+    connection->cursor->request_handler = NULL;
+    connection->cursor = NULL;
+    return ERROR_CODE_SUCCESS;
+}
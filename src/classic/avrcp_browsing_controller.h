@@ -187,6 +187,23 @@ uint8_t avrcp_browsing_controller_get_item_attributes_for_scope(uint16_t avrcp_b
  **/
 uint8_t avrcp_browsing_controller_search(uint16_t avrcp_browsing_cid, uint16_t search_str_len, char * search_str);
 
+/**
+ * @brief Attach browsing cursor. Pages needed for the cursor position are fetched via GetFolderItems
+ * whenever no other browsing command is in progress. Responses to these requests are delivered to the
+ * cursor instead of the packet handler.
+ * @param avrcp_browsing_cid
+ * @param cursor initialized with avrcp_browsing_cursor_init
+ * @return status
+ **/
+uint8_t avrcp_browsing_controller_attach_cursor(uint16_t avrcp_browsing_cid, struct avrcp_browsing_cursor * cursor);
+
+/**
+ * @brief Detach browsing cursor, cached items are kept. Response to a pending GetFolderItems request is dropped
+ * @param avrcp_browsing_cid
+ * @return status
+ **/
+uint8_t avrcp_browsing_controller_detach_cursor(uint16_t avrcp_browsing_cid);
+
 /**
  * @brief De-Init AVRCP Browsing Controller
  */
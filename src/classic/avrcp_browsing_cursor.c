@@ -0,0 +1,545 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "avrcp_browsing_cursor.c"
+
+// *****************************************************************************
+//
+// AVRCP Browsing Cursor
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+#include "classic/avrcp_browsing_cursor.h"
+#include "classic/avrcp_browsing_controller.h"
+
+#include "bluetooth.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+
+#define AVRCP_BROWSING_CURSOR_PAGE_NONE 0xff
+
+// item type and item length
+#define AVRCP_BROWSING_CURSOR_ITEM_HEADER_LEN 3
+// fixed part of items up to and including name length
+#define AVRCP_BROWSING_CURSOR_MEDIA_PLAYER_ITEM_LEN  28
+#define AVRCP_BROWSING_CURSOR_FOLDER_ITEM_LEN        14
+#define AVRCP_BROWSING_CURSOR_MEDIA_ELEMENT_ITEM_LEN 13
+// attribute id, charset and value length
+#define AVRCP_BROWSING_CURSOR_ATTRIBUTE_HEADER_LEN    8
+
+typedef enum {
+    AVRCP_BROWSING_CURSOR_PAGE_FREE = 0,
+    AVRCP_BROWSING_CURSOR_PAGE_LOADING,
+    AVRCP_BROWSING_CURSOR_PAGE_VALID,
+} avrcp_browsing_cursor_page_state_t;
+
+typedef enum {
+    AVRCP_BROWSING_CURSOR_PARSER_ITEM_HEADER = 0,
+    AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED,
+    AVRCP_BROWSING_CURSOR_PARSER_NAME,
+    AVRCP_BROWSING_CURSOR_PARSER_NUM_ATTRIBUTES,
+    AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_HEADER,
+    AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_VALUE,
+    AVRCP_BROWSING_CURSOR_PARSER_SKIP,
+} avrcp_browsing_cursor_parser_state_t;
+
+static void avrcp_browsing_cursor_emit(avrcp_browsing_cursor_t * cursor, avrcp_browsing_cursor_event_t event, uint32_t start_index, uint32_t count){
+    if (cursor->callback == NULL) return;
+    (*cursor->callback)(cursor, event, start_index, count);
+}
+
+static int avrcp_browsing_cursor_find_page(const avrcp_browsing_cursor_t * cursor, uint32_t page){
+    int i;
+    for (i=0;i<cursor->num_pages;i++){
+        if (cursor->pages[i].state == AVRCP_BROWSING_CURSOR_PAGE_FREE) continue;
+        if (cursor->pages[i].page == page) return i;
+    }
+    return -1;
+}
+
+// pages for visible items and prefetch in scroll direction, limited by number of cached pages and total items
+static bool avrcp_browsing_cursor_get_wanted_pages(const avrcp_browsing_cursor_t * cursor, uint32_t * first_page, uint32_t * last_page){
+    uint16_t num_visible = btstack_max(1, cursor->num_visible);
+    uint32_t lo = cursor->first_visible / cursor->page_size;
+    uint32_t hi = (cursor->first_visible + num_visible - 1) / cursor->page_size;
+    if (cursor->forward){
+        hi += cursor->prefetch_pages;
+    } else {
+        lo = (lo > cursor->prefetch_pages) ? (lo - cursor->prefetch_pages) : 0;
+    }
+    if (cursor->total_items != AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN){
+        if (cursor->total_items == 0) return false;
+        uint32_t max_page = (cursor->total_items - 1) / cursor->page_size;
+        if (lo > max_page) return false;
+        hi = btstack_min(hi, max_page);
+    }
+    if ((hi - lo) >= cursor->num_pages){
+        if (cursor->forward){
+            hi = lo + cursor->num_pages - 1;
+        } else {
+            lo = hi - cursor->num_pages + 1;
+        }
+    }
+    *first_page = lo;
+    *last_page  = hi;
+    return true;
+}
+
+// free page or least recently used page that is not wanted
+static int avrcp_browsing_cursor_get_victim(const avrcp_browsing_cursor_t * cursor, uint32_t first_page, uint32_t last_page){
+    int victim = -1;
+    int i;
+    for (i=0;i<cursor->num_pages;i++){
+        const avrcp_browsing_cursor_page_t * page = &cursor->pages[i];
+        switch (page->state){
+            case AVRCP_BROWSING_CURSOR_PAGE_FREE:
+                return i;
+            case AVRCP_BROWSING_CURSOR_PAGE_VALID:
+                if ((page->page >= first_page) && (page->page <= last_page)) break;
+                if ((victim < 0) || (page->last_used < cursor->pages[victim].last_used)){
+                    victim = i;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return victim;
+}
+
+static bool avrcp_browsing_cursor_get_next_page(const avrcp_browsing_cursor_t * cursor, uint32_t * next_page, int * next_slot){
+    if (cursor->paused || cursor->request_pending || (cursor->num_pages == 0)) return false;
+    uint32_t first_page;
+    uint32_t last_page;
+    if (!avrcp_browsing_cursor_get_wanted_pages(cursor, &first_page, &last_page)) return false;
+    uint32_t num_wanted = last_page - first_page + 1;
+    uint32_t i;
+    for (i=0;i<num_wanted;i++){
+        uint32_t page = cursor->forward ? (first_page + i) : (last_page - i);
+        if (avrcp_browsing_cursor_find_page(cursor, page) >= 0) continue;
+        int slot = avrcp_browsing_cursor_get_victim(cursor, first_page, last_page);
+        if (slot < 0) return false;
+        *next_page = page;
+        *next_slot = slot;
+        return true;
+    }
+    return false;
+}
+
+static void avrcp_browsing_cursor_trigger(avrcp_browsing_cursor_t * cursor){
+    if (cursor->request_handler == NULL) return;
+    uint32_t page;
+    int slot;
+    if (!avrcp_browsing_cursor_get_next_page(cursor, &page, &slot)) return;
+    (*cursor->request_handler)(cursor);
+}
+
+static void avrcp_browsing_cursor_touch_page(avrcp_browsing_cursor_t * cursor, int slot){
+    cursor->lru_counter++;
+    cursor->pages[slot].last_used = cursor->lru_counter;
+}
+
+void avrcp_browsing_cursor_init(avrcp_browsing_cursor_t * cursor, avrcp_browsing_scope_t scope, uint32_t attr_bitmap,
+                                avrcp_browsing_cursor_item_t * items, uint16_t num_items, uint16_t page_size,
+                                avrcp_browsing_cursor_callback_t callback){
+    memset(cursor, 0, sizeof(avrcp_browsing_cursor_t));
+    cursor->callback = callback;
+    cursor->scope = scope;
+    cursor->attr_bitmap = attr_bitmap;
+    cursor->items = items;
+    cursor->page_size = btstack_max(1, page_size);
+    cursor->num_pages = (uint8_t) btstack_min(num_items / cursor->page_size, AVRCP_BROWSING_CURSOR_MAX_PAGES);
+    cursor->prefetch_pages = 1;
+    cursor->forward = true;
+    // no position yet
+    cursor->paused = true;
+    cursor->total_items = AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN;
+    cursor->status = AVRCP_BROWSING_ERROR_CODE_SUCCESS;
+    cursor->request_page = AVRCP_BROWSING_CURSOR_PAGE_NONE;
+}
+
+void avrcp_browsing_cursor_set_prefetch_pages(avrcp_browsing_cursor_t * cursor, uint8_t num_pages){
+    cursor->prefetch_pages = num_pages;
+}
+
+void avrcp_browsing_cursor_set_total_items(avrcp_browsing_cursor_t * cursor, uint32_t total_items){
+    cursor->total_items = total_items;
+}
+
+uint32_t avrcp_browsing_cursor_get_total_items(const avrcp_browsing_cursor_t * cursor){
+    return cursor->total_items;
+}
+
+uint8_t avrcp_browsing_cursor_get_status(const avrcp_browsing_cursor_t * cursor){
+    return cursor->status;
+}
+
+void avrcp_browsing_cursor_set_position(avrcp_browsing_cursor_t * cursor, uint32_t first_visible, uint16_t num_visible){
+    if (first_visible != cursor->first_visible){
+        cursor->forward = first_visible > cursor->first_visible;
+    }
+    cursor->first_visible = first_visible;
+    cursor->num_visible = num_visible;
+    cursor->paused = false;
+
+    // keep visible pages
+    uint32_t first_page = first_visible / cursor->page_size;
+    uint32_t last_page = (first_visible + btstack_max(1, num_visible) - 1) / cursor->page_size;
+    uint32_t page;
+    for (page = first_page; page <= last_page; page++){
+        int slot = avrcp_browsing_cursor_find_page(cursor, page);
+        if (slot >= 0){
+            avrcp_browsing_cursor_touch_page(cursor, slot);
+        }
+    }
+    avrcp_browsing_cursor_trigger(cursor);
+}
+
+const avrcp_browsing_cursor_item_t * avrcp_browsing_cursor_get_item(avrcp_browsing_cursor_t * cursor, uint32_t index){
+    int slot = avrcp_browsing_cursor_find_page(cursor, index / cursor->page_size);
+    if (slot < 0) return NULL;
+    avrcp_browsing_cursor_page_t * page = &cursor->pages[slot];
+    if (page->state != AVRCP_BROWSING_CURSOR_PAGE_VALID) return NULL;
+    uint16_t offset = (uint16_t) (index % cursor->page_size);
+    if (offset >= page->num_items) return NULL;
+    avrcp_browsing_cursor_touch_page(cursor, slot);
+    return &cursor->items[(slot * cursor->page_size) + offset];
+}
+
+void avrcp_browsing_cursor_reset(avrcp_browsing_cursor_t * cursor){
+    int i;
+    for (i=0;i<cursor->num_pages;i++){
+        cursor->pages[i].state = AVRCP_BROWSING_CURSOR_PAGE_FREE;
+    }
+    // items of pending response are dropped
+    cursor->request_page = AVRCP_BROWSING_CURSOR_PAGE_NONE;
+    cursor->total_items = AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN;
+    cursor->uid_counter_valid = false;
+    cursor->invalidated = false;
+    avrcp_browsing_cursor_trigger(cursor);
+}
+
+bool avrcp_browsing_cursor_get_request(avrcp_browsing_cursor_t * cursor, uint32_t * start_item, uint32_t * end_item){
+    uint32_t page;
+    int slot;
+    if (!avrcp_browsing_cursor_get_next_page(cursor, &page, &slot)) return false;
+    cursor->pages[slot].page = page;
+    cursor->pages[slot].state = AVRCP_BROWSING_CURSOR_PAGE_LOADING;
+    cursor->pages[slot].num_items = 0;
+    cursor->request_pending = true;
+    cursor->request_page = (uint8_t) slot;
+    cursor->request_start = page * cursor->page_size;
+    cursor->request_end = cursor->request_start + cursor->page_size - 1;
+    if (cursor->total_items != AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN){
+        cursor->request_end = btstack_min(cursor->request_end, cursor->total_items - 1);
+    }
+    cursor->parser_num_items = 0;
+    cursor->parser_items_done = 0;
+    cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_ITEM_HEADER;
+    cursor->parser_pos = 0;
+    *start_item = cursor->request_start;
+    *end_item = cursor->request_end;
+    return true;
+}
+
+void avrcp_browsing_cursor_cancel_request(avrcp_browsing_cursor_t * cursor){
+    if (cursor->request_pending == false) return;
+    cursor->request_pending = false;
+    if (cursor->request_page != AVRCP_BROWSING_CURSOR_PAGE_NONE){
+        cursor->pages[cursor->request_page].state = AVRCP_BROWSING_CURSOR_PAGE_FREE;
+        cursor->request_page = AVRCP_BROWSING_CURSOR_PAGE_NONE;
+    }
+}
+
+void avrcp_browsing_cursor_handle_response_begin(avrcp_browsing_cursor_t * cursor, uint16_t uid_counter, uint16_t num_items){
+    if (cursor->request_pending == false) return;
+    if (cursor->uid_counter_valid && (cursor->uid_counter != uid_counter)){
+        // media database changed, drop all other pages
+        int i;
+        for (i=0;i<cursor->num_pages;i++){
+            if (i == cursor->request_page) continue;
+            cursor->pages[i].state = AVRCP_BROWSING_CURSOR_PAGE_FREE;
+        }
+        cursor->invalidated = true;
+    }
+    cursor->uid_counter = uid_counter;
+    cursor->uid_counter_valid = true;
+    cursor->parser_num_items = num_items;
+    cursor->parser_items_done = 0;
+    cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_ITEM_HEADER;
+    cursor->parser_pos = 0;
+}
+
+static void avrcp_browsing_cursor_parser_enter_field(avrcp_browsing_cursor_t * cursor, avrcp_browsing_cursor_parser_state_t state, uint8_t field_len){
+    cursor->parser_state = state;
+    cursor->parser_field_len = field_len;
+    cursor->parser_pos = 0;
+}
+
+static void avrcp_browsing_cursor_parser_value_complete(avrcp_browsing_cursor_t * cursor);
+
+static void avrcp_browsing_cursor_parser_enter_value(avrcp_browsing_cursor_t * cursor, avrcp_browsing_cursor_parser_state_t state, uint16_t value_len){
+    cursor->parser_state = state;
+    cursor->parser_value_remaining = value_len;
+    if (value_len == 0){
+        avrcp_browsing_cursor_parser_value_complete(cursor);
+    }
+}
+
+static void avrcp_browsing_cursor_parser_value_complete(avrcp_browsing_cursor_t * cursor){
+    switch (cursor->parser_state){
+        case AVRCP_BROWSING_CURSOR_PARSER_NAME:
+            if ((cursor->parser_item != NULL) && (cursor->parser_item->item_type == AVRCP_BROWSING_MEDIA_ELEMENT_ITEM)){
+                avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_NUM_ATTRIBUTES, 1);
+            } else {
+                cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_SKIP;
+            }
+            break;
+        case AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_VALUE:
+            cursor->parser_num_attributes--;
+            if (cursor->parser_num_attributes > 0){
+                avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_HEADER, AVRCP_BROWSING_CURSOR_ATTRIBUTE_HEADER_LEN);
+            } else {
+                cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_SKIP;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void avrcp_browsing_cursor_parser_item_complete(avrcp_browsing_cursor_t * cursor){
+    if (cursor->parser_item != NULL){
+        cursor->pages[cursor->request_page].num_items++;
+    }
+    cursor->parser_items_done++;
+    avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ITEM_HEADER, AVRCP_BROWSING_CURSOR_ITEM_HEADER_LEN);
+}
+
+static void avrcp_browsing_cursor_parser_item_header(avrcp_browsing_cursor_t * cursor){
+    uint8_t item_type = cursor->parser_buffer[0];
+    cursor->parser_item_remaining = big_endian_read_16(cursor->parser_buffer, 1);
+    cursor->parser_item = NULL;
+    if ((cursor->request_page != AVRCP_BROWSING_CURSOR_PAGE_NONE) && (cursor->parser_items_done < cursor->page_size)){
+        cursor->parser_item = &cursor->items[(cursor->request_page * cursor->page_size) + cursor->parser_items_done];
+        memset(cursor->parser_item, 0, sizeof(avrcp_browsing_cursor_item_t));
+        cursor->parser_item->index = cursor->request_start + cursor->parser_items_done;
+        cursor->parser_item->item_type = item_type;
+    }
+    switch (item_type){
+        case AVRCP_BROWSING_MEDIA_PLAYER_ITEM:
+            avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED, AVRCP_BROWSING_CURSOR_MEDIA_PLAYER_ITEM_LEN);
+            break;
+        case AVRCP_BROWSING_FOLDER_ITEM:
+            avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED, AVRCP_BROWSING_CURSOR_FOLDER_ITEM_LEN);
+            break;
+        case AVRCP_BROWSING_MEDIA_ELEMENT_ITEM:
+            avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED, AVRCP_BROWSING_CURSOR_MEDIA_ELEMENT_ITEM_LEN);
+            break;
+        default:
+            cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_SKIP;
+            break;
+    }
+}
+
+static void avrcp_browsing_cursor_parser_field_complete(avrcp_browsing_cursor_t * cursor){
+    const uint8_t * buffer = cursor->parser_buffer;
+    avrcp_browsing_cursor_item_t * item = cursor->parser_item;
+    uint16_t name_len;
+    switch (cursor->parser_state){
+        case AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED:
+            if (item == NULL){
+                // item not stored, e.g. response exceeds page
+                cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_SKIP;
+                break;
+            }
+            switch (item->item_type){
+                case AVRCP_BROWSING_MEDIA_PLAYER_ITEM:
+                    // player id, major player type, player sub type, play status, feature bitmask
+                    (void) memcpy(item->uid, buffer, 2);
+                    item->type = buffer[2];
+                    item->playable = buffer[7];
+                    item->charset = big_endian_read_16(buffer, 24);
+                    break;
+                case AVRCP_BROWSING_FOLDER_ITEM:
+                    // folder uid, folder type, is playable
+                    (void) memcpy(item->uid, buffer, 8);
+                    item->type = buffer[8];
+                    item->playable = buffer[9];
+                    item->charset = big_endian_read_16(buffer, 10);
+                    break;
+                default:
+                    // media element uid, media type
+                    (void) memcpy(item->uid, buffer, 8);
+                    item->type = buffer[8];
+                    item->charset = big_endian_read_16(buffer, 9);
+                    break;
+            }
+            name_len = big_endian_read_16(buffer, cursor->parser_field_len - 2);
+            avrcp_browsing_cursor_parser_enter_value(cursor, AVRCP_BROWSING_CURSOR_PARSER_NAME, name_len);
+            break;
+        case AVRCP_BROWSING_CURSOR_PARSER_NUM_ATTRIBUTES:
+            cursor->parser_num_attributes = buffer[0];
+            if (cursor->parser_num_attributes == 0){
+                cursor->parser_state = AVRCP_BROWSING_CURSOR_PARSER_SKIP;
+            } else {
+                avrcp_browsing_cursor_parser_enter_field(cursor, AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_HEADER, AVRCP_BROWSING_CURSOR_ATTRIBUTE_HEADER_LEN);
+            }
+            break;
+        case AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_HEADER:
+            cursor->parser_attribute_id = big_endian_read_32(buffer, 0);
+            avrcp_browsing_cursor_parser_enter_value(cursor, AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_VALUE, big_endian_read_16(buffer, 6));
+            break;
+        default:
+            break;
+    }
+}
+
+static void avrcp_browsing_cursor_store_value(avrcp_browsing_cursor_t * cursor, const uint8_t * data, uint16_t len){
+    avrcp_browsing_cursor_item_t * item = cursor->parser_item;
+    if (item == NULL) return;
+    char * value;
+    uint8_t * value_len;
+    if (cursor->parser_state == AVRCP_BROWSING_CURSOR_PARSER_NAME){
+        value = item->name;
+        value_len = &item->name_len;
+    } else if (cursor->parser_attribute_id == AVRCP_MEDIA_ATTR_ARTIST){
+        value = item->artist;
+        value_len = &item->artist_len;
+    } else {
+        return;
+    }
+    uint16_t bytes_to_copy = btstack_min(len, AVRCP_BROWSING_CURSOR_MAX_NAME_LEN - *value_len);
+    (void) memcpy(&value[*value_len], data, bytes_to_copy);
+    *value_len += (uint8_t) bytes_to_copy;
+}
+
+void avrcp_browsing_cursor_handle_response_data(avrcp_browsing_cursor_t * cursor, const uint8_t * data, uint16_t len){
+    if (cursor->request_pending == false) return;
+    uint16_t pos = 0;
+    while ((pos < len) && (cursor->parser_items_done < cursor->parser_num_items)){
+        uint16_t bytes_to_process;
+        if (cursor->parser_state == AVRCP_BROWSING_CURSOR_PARSER_ITEM_HEADER){
+            bytes_to_process = btstack_min(AVRCP_BROWSING_CURSOR_ITEM_HEADER_LEN - cursor->parser_pos, len - pos);
+            (void) memcpy(&cursor->parser_buffer[cursor->parser_pos], &data[pos], bytes_to_process);
+            cursor->parser_pos += (uint8_t) bytes_to_process;
+            pos += bytes_to_process;
+            if (cursor->parser_pos < AVRCP_BROWSING_CURSOR_ITEM_HEADER_LEN) continue;
+            avrcp_browsing_cursor_parser_item_header(cursor);
+        } else {
+            bytes_to_process = btstack_min(len - pos, cursor->parser_item_remaining);
+            switch (cursor->parser_state){
+                case AVRCP_BROWSING_CURSOR_PARSER_ITEM_FIXED:
+                case AVRCP_BROWSING_CURSOR_PARSER_NUM_ATTRIBUTES:
+                case AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_HEADER:
+                    bytes_to_process = btstack_min(bytes_to_process, cursor->parser_field_len - cursor->parser_pos);
+                    (void) memcpy(&cursor->parser_buffer[cursor->parser_pos], &data[pos], bytes_to_process);
+                    cursor->parser_pos += (uint8_t) bytes_to_process;
+                    if (cursor->parser_pos == cursor->parser_field_len){
+                        avrcp_browsing_cursor_parser_field_complete(cursor);
+                    }
+                    break;
+                case AVRCP_BROWSING_CURSOR_PARSER_NAME:
+                case AVRCP_BROWSING_CURSOR_PARSER_ATTRIBUTE_VALUE:
+                    bytes_to_process = btstack_min(bytes_to_process, cursor->parser_value_remaining);
+                    avrcp_browsing_cursor_store_value(cursor, &data[pos], bytes_to_process);
+                    cursor->parser_value_remaining -= bytes_to_process;
+                    if (cursor->parser_value_remaining == 0){
+                        avrcp_browsing_cursor_parser_value_complete(cursor);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            pos += bytes_to_process;
+            cursor->parser_item_remaining -= bytes_to_process;
+        }
+        // item length reached, rest of truncated item is ignored
+        if (cursor->parser_item_remaining == 0){
+            avrcp_browsing_cursor_parser_item_complete(cursor);
+        }
+    }
+}
+
+void avrcp_browsing_cursor_handle_response_end(avrcp_browsing_cursor_t * cursor, uint8_t browsing_status){
+    if (cursor->request_pending == false) return;
+    cursor->request_pending = false;
+
+    uint16_t num_items = 0;
+    if (cursor->request_page != AVRCP_BROWSING_CURSOR_PAGE_NONE){
+        avrcp_browsing_cursor_page_t * page = &cursor->pages[cursor->request_page];
+        cursor->request_page = AVRCP_BROWSING_CURSOR_PAGE_NONE;
+        num_items = page->num_items;
+        if ((browsing_status == AVRCP_BROWSING_ERROR_CODE_SUCCESS) && (num_items > 0)){
+            page->state = AVRCP_BROWSING_CURSOR_PAGE_VALID;
+            cursor->lru_counter++;
+            page->last_used = cursor->lru_counter;
+        } else {
+            page->state = AVRCP_BROWSING_CURSOR_PAGE_FREE;
+        }
+        // fewer items than requested: end of list
+        if ((browsing_status == AVRCP_BROWSING_ERROR_CODE_SUCCESS) && (num_items < (cursor->request_end - cursor->request_start + 1))){
+            cursor->total_items = btstack_min(cursor->total_items, cursor->request_start + num_items);
+        }
+    }
+
+    switch (browsing_status){
+        case AVRCP_BROWSING_ERROR_CODE_SUCCESS:
+            break;
+        case AVRCP_BROWSING_ERROR_CODE_RANGE_OUT_OF_BOUNDS:
+            cursor->total_items = btstack_min(cursor->total_items, cursor->request_start);
+            break;
+        default:
+            log_info("avrcp_browsing_cursor: GetFolderItems %u failed, status 0x%02x", (unsigned int) cursor->request_start, browsing_status);
+            cursor->status = browsing_status;
+            cursor->paused = true;
+            avrcp_browsing_cursor_emit(cursor, AVRCP_BROWSING_CURSOR_EVENT_ERROR, cursor->request_start, 0);
+            break;
+    }
+
+    if (cursor->invalidated){
+        cursor->invalidated = false;
+        avrcp_browsing_cursor_emit(cursor, AVRCP_BROWSING_CURSOR_EVENT_INVALIDATED, 0, 0);
+    }
+    if ((browsing_status == AVRCP_BROWSING_ERROR_CODE_SUCCESS) && (num_items > 0)){
+        avrcp_browsing_cursor_emit(cursor, AVRCP_BROWSING_CURSOR_EVENT_ITEMS_AVAILABLE, cursor->request_start, num_items);
+    }
+    avrcp_browsing_cursor_trigger(cursor);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title AVRCP Browsing Cursor
+ *
+ * Cursor over the items of a browsing scope, e.g. the virtual file system or the Now Playing list.
+ *
+ * The cursor caches item metadata in pages of page_size items, the memory for the items is provided by
+ * the application. Based on the current scroll position, the AVRCP Browsing Controller fetches the visible
+ * pages and prefetches pages ahead in scroll direction via GetFolderItems. If all pages are in use, the
+ * least recently used page that is neither visible nor prefetched gets replaced.
+ *
+ * Items are parsed incrementally from the received browsing PDUs without buffering complete items. Name and
+ * Artist attribute are stored up to AVRCP_BROWSING_CURSOR_MAX_NAME_LEN bytes.
+ *
+ */
+
+#ifndef AVRCP_BROWSING_CURSOR_H
+#define AVRCP_BROWSING_CURSOR_H
+
+#include "btstack_config.h"
+#include <stdint.h>
+
+#include "btstack_bool.h"
+#include "classic/avrcp.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// max len of item name and artist, longer values are truncated
+#ifndef AVRCP_BROWSING_CURSOR_MAX_NAME_LEN
+#define AVRCP_BROWSING_CURSOR_MAX_NAME_LEN 32
+#endif
+
+// max number of cached pages per cursor
+#ifndef AVRCP_BROWSING_CURSOR_MAX_PAGES
+#define AVRCP_BROWSING_CURSOR_MAX_PAGES 16
+#endif
+
+#define AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN 0xffffffffu
+
+typedef struct {
+    uint32_t index;
+    // avrcp_browsing_item_type_t
+    uint8_t  item_type;
+    // folder or media element UID, Player Id for media player item
+    uint8_t  uid[8];
+    // folder type, media type or major player type
+    uint8_t  type;
+    // folder: is playable, media player: play status
+    uint8_t  playable;
+    uint16_t charset;
+    uint8_t  name_len;
+    uint8_t  artist_len;
+    char     name[AVRCP_BROWSING_CURSOR_MAX_NAME_LEN + 1];
+    char     artist[AVRCP_BROWSING_CURSOR_MAX_NAME_LEN + 1];
+} avrcp_browsing_cursor_item_t;
+
+typedef enum {
+    // items start_index..start_index+count-1 have been received
+    AVRCP_BROWSING_CURSOR_EVENT_ITEMS_AVAILABLE = 0,
+    // UID Counter changed, all cached items have been dropped
+    AVRCP_BROWSING_CURSOR_EVENT_INVALIDATED,
+    // GetFolderItems for start_index failed, see avrcp_browsing_cursor_get_status. Fetching resumes on next position update
+    AVRCP_BROWSING_CURSOR_EVENT_ERROR,
+} avrcp_browsing_cursor_event_t;
+
+struct avrcp_browsing_cursor;
+
+typedef void (*avrcp_browsing_cursor_callback_t)(struct avrcp_browsing_cursor * cursor, avrcp_browsing_cursor_event_t event, uint32_t start_index, uint32_t count);
+
+typedef struct {
+    uint32_t page;
+    uint32_t last_used;
+    uint16_t num_items;
+    uint8_t  state;
+} avrcp_browsing_cursor_page_t;
+
+typedef struct avrcp_browsing_cursor {
+    avrcp_browsing_cursor_callback_t callback;
+    // set by AVRCP Browsing Controller to get notified about pages to fetch
+    void (*request_handler)(struct avrcp_browsing_cursor * cursor);
+    uint16_t avrcp_browsing_cid;
+
+    avrcp_browsing_scope_t scope;
+    uint32_t attr_bitmap;
+
+    // cache
+    avrcp_browsing_cursor_item_t * items;
+    uint16_t page_size;
+    uint8_t  num_pages;
+    uint8_t  prefetch_pages;
+    avrcp_browsing_cursor_page_t pages[AVRCP_BROWSING_CURSOR_MAX_PAGES];
+    uint32_t lru_counter;
+
+    // scroll position
+    uint32_t first_visible;
+    uint16_t num_visible;
+    bool     forward;
+    bool     paused;
+
+    uint32_t total_items;
+    uint16_t uid_counter;
+    bool     uid_counter_valid;
+    uint8_t  status;
+
+    // GetFolderItems in progress
+    bool     request_pending;
+    uint8_t  request_page;
+    uint32_t request_start;
+    uint32_t request_end;
+    bool     invalidated;
+
+    // item parser
+    uint8_t  parser_state;
+    uint8_t  parser_pos;
+    uint8_t  parser_field_len;
+    uint8_t  parser_buffer[28];
+    uint8_t  parser_num_attributes;
+    uint16_t parser_item_remaining;
+    uint16_t parser_value_remaining;
+    uint32_t parser_attribute_id;
+    uint16_t parser_num_items;
+    uint16_t parser_items_done;
+    avrcp_browsing_cursor_item_t * parser_item;
+} avrcp_browsing_cursor_t;
+
+/* API_START */
+
+/**
+ * @brief Init cursor for browsing scope
+ * @param cursor
+ * @param scope
+ * @param attr_bitmap attributes requested for media elements, see avrcp_browsing_controller_browse_file_system
+ * @param items storage for cached items
+ * @param num_items number of items in storage, up to AVRCP_BROWSING_CURSOR_MAX_PAGES pages of page_size items are used
+ * @param page_size number of items fetched with a single GetFolderItems command
+ * @param callback for cursor events
+ */
+void avrcp_browsing_cursor_init(avrcp_browsing_cursor_t * cursor, avrcp_browsing_scope_t scope, uint32_t attr_bitmap,
+                                avrcp_browsing_cursor_item_t * items, uint16_t num_items, uint16_t page_size,
+                                avrcp_browsing_cursor_callback_t callback);
+
+/**
+ * @brief Set number of pages fetched ahead of the visible items in scroll direction. Default: 1
+ * @param cursor
+ * @param num_pages
+ */
+void avrcp_browsing_cursor_set_prefetch_pages(avrcp_browsing_cursor_t * cursor, uint8_t num_pages);
+
+/**
+ * @brief Set total number of items in scope, e.g. from GetTotalNumberOfItems. If not set, the end of the list
+ * is detected when a GetFolderItems response contains fewer items than requested.
+ * @param cursor
+ * @param total_items
+ */
+void avrcp_browsing_cursor_set_total_items(avrcp_browsing_cursor_t * cursor, uint32_t total_items);
+
+/**
+ * @brief Get total number of items
+ * @param cursor
+ * @return total items or AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN
+ */
+uint32_t avrcp_browsing_cursor_get_total_items(const avrcp_browsing_cursor_t * cursor);
+
+/**
+ * @brief Set scroll position, missing visible and prefetch pages are fetched
+ * @param cursor
+ * @param first_visible index of first visible item
+ * @param num_visible number of visible items
+ */
+void avrcp_browsing_cursor_set_position(avrcp_browsing_cursor_t * cursor, uint32_t first_visible, uint16_t num_visible);
+
+/**
+ * @brief Get cached item
+ * @param cursor
+ * @param index
+ * @return item or NULL if not cached
+ */
+const avrcp_browsing_cursor_item_t * avrcp_browsing_cursor_get_item(avrcp_browsing_cursor_t * cursor, uint32_t index);
+
+/**
+ * @brief Get browsing status of last failed GetFolderItems
+ * @param cursor
+ * @return status
+ */
+uint8_t avrcp_browsing_cursor_get_status(const avrcp_browsing_cursor_t * cursor);
+
+/**
+ * @brief Drop all cached items, e.g. after Change Path
+ * @param cursor
+ */
+void avrcp_browsing_cursor_reset(avrcp_browsing_cursor_t * cursor);
+
+/* API_END */
+
+// used by AVRCP Browsing Controller
+
+/**
+ * @brief Get range for next GetFolderItems command
+ * @param cursor
+ * @param start_item
+ * @param end_item
+ * @return true if page should be fetched
+ */
+bool avrcp_browsing_cursor_get_request(avrcp_browsing_cursor_t * cursor, uint32_t * start_item, uint32_t * end_item);
+
+/**
+ * @brief Abort GetFolderItems without notifying the application, e.g. on disconnect
+ * @param cursor
+ */
+void avrcp_browsing_cursor_cancel_request(avrcp_browsing_cursor_t * cursor);
+
+/**
+ * @brief Start of GetFolderItems response
+ * @param cursor
+ * @param uid_counter
+ * @param num_items
+ */
+void avrcp_browsing_cursor_handle_response_begin(avrcp_browsing_cursor_t * cursor, uint16_t uid_counter, uint16_t num_items);
+
+/**
+ * @brief Item data of GetFolderItems response, can be split at any position
+ * @param cursor
+ * @param data
+ * @param len
+ */
+void avrcp_browsing_cursor_handle_response_data(avrcp_browsing_cursor_t * cursor, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief End of GetFolderItems response
+ * @param cursor
+ * @param browsing_status
+ */
+void avrcp_browsing_cursor_handle_response_end(avrcp_browsing_cursor_t * cursor, uint8_t browsing_status);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // AVRCP_BROWSING_CURSOR_H
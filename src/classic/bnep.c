@@ -477,10 +477,9 @@ static int bnep_filter_multicast(bnep_channel_t *channel, bd_addr_t addr_dest)
 }
 
 
-/* Send BNEP ethernet packet */
-int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
+/* Encode ethernet frame with compressed header if possible directly into l2cap outgoing buffer and send it */
+static int bnep_send_ethernet_frame(bnep_channel_t *channel, const uint8_t *packet, uint16_t len)
 {
-    bnep_channel_t *channel;
     uint8_t        *bnep_out_buffer = NULL;
     uint16_t        pos = 0;
     uint16_t        pos_out = 0;
@@ -493,19 +492,9 @@ int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
     bd_addr_t       addr_source;
     uint16_t        network_protocol_type;
 
-    channel = bnep_channel_for_l2cap_cid(bnep_cid);
-    if (channel == NULL) {
-        log_error("bnep_send cid 0x%02x doesn't exist!", bnep_cid);
-        return 1;
-    }
-        
-    if (channel->state != BNEP_CHANNEL_STATE_CONNECTED) {
-        return BNEP_CHANNEL_NOT_CONNECTED;
-    }
-    
-    /* Check for free ACL buffers */
-    if (!l2cap_can_send_packet_now(channel->l2cap_cid)) {
-        return BTSTACK_ACL_BUFFERS_FULL;
+    if (len < ((2 * sizeof(bd_addr_t)) + sizeof(uint16_t))) {
+        /* Omit invalid packet */
+        return 0;
     }
 
     /* Extract destination and source address from the ethernet packet */
@@ -545,6 +534,12 @@ int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
         }
     }
 
+    /* Check for MTU limits */
+    if (payload_len > channel->max_frame_size) {
+        log_error("bnep_send: Max frame size (%d) exceeded: %d", channel->max_frame_size, payload_len);
+        return BNEP_DATA_LEN_EXCEEDS_MTU;
+    }
+
     /* Reserve l2cap packet buffer */    
     l2cap_reserve_packet_buffer();
     bnep_out_buffer = l2cap_get_outgoing_buffer();
@@ -556,12 +551,6 @@ int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
     has_source = (memcmp(addr_source, channel->local_addr, ETHER_ADDR_LEN) != 0);
     has_dest = (memcmp(addr_dest, channel->remote_addr, ETHER_ADDR_LEN) != 0);
 
-    /* Check for MTU limits */
-    if (payload_len > channel->max_frame_size) {
-        log_error("bnep_send: Max frame size (%d) exceeded: %d", channel->max_frame_size, payload_len);
-        return BNEP_DATA_LEN_EXCEEDS_MTU;
-    }
-    
     /* Fill in the package type depending on the given source and destination address */
     if (has_source && has_dest) {
         bnep_out_buffer[pos_out++] = BNEP_PKT_TYPE_GENERAL_ETHERNET;
@@ -604,6 +593,74 @@ int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
     return err;        
 }
 
+/* Send BNEP ethernet packet */
+int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
+{
+    bnep_channel_t *channel;
+
+    channel = bnep_channel_for_l2cap_cid(bnep_cid);
+    if (channel == NULL) {
+        log_error("bnep_send cid 0x%02x doesn't exist!", bnep_cid);
+        return 1;
+    }
+        
+    if (channel->state != BNEP_CHANNEL_STATE_CONNECTED) {
+        return BNEP_CHANNEL_NOT_CONNECTED;
+    }
+    
+    /* Check for free ACL buffers */
+    if (!l2cap_can_send_packet_now(channel->l2cap_cid)) {
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+
+    return bnep_send_ethernet_frame(channel, packet, len);
+}
+
+/* Send queued ethernet frames as long as ACL buffers are available */
+static void bnep_channel_send_queued_frames(bnep_channel_t *channel)
+{
+    while (channel->tx_queue != NULL) {
+        if (!l2cap_can_send_packet_now(channel->l2cap_cid)) {
+            l2cap_request_can_send_now_event(channel->l2cap_cid);
+            return;
+        }
+        bnep_tx_frame_t * frame = (bnep_tx_frame_t *) btstack_linked_list_pop(&channel->tx_queue);
+        int err = bnep_send_ethernet_frame(channel, frame->data, frame->len);
+        (*frame->callback)(frame, (uint8_t) err);
+    }
+}
+
+static void bnep_channel_drop_queued_frames(bnep_channel_t *channel)
+{
+    while (channel->tx_queue != NULL) {
+        bnep_tx_frame_t * frame = (bnep_tx_frame_t *) btstack_linked_list_pop(&channel->tx_queue);
+        (*frame->callback)(frame, BNEP_CHANNEL_NOT_CONNECTED);
+    }
+}
+
+uint8_t bnep_send_frame(uint16_t bnep_cid, bnep_tx_frame_t * frame)
+{
+    bnep_channel_t *channel = bnep_channel_for_l2cap_cid(bnep_cid);
+    if ((channel == NULL) || (channel->state != BNEP_CHANNEL_STATE_CONNECTED)) {
+        return BNEP_CHANNEL_NOT_CONNECTED;
+    }
+
+    if (frame->len > (channel->max_frame_size + (2 * sizeof(bd_addr_t)) + sizeof(uint16_t))) {
+        return BNEP_DATA_LEN_EXCEEDS_MTU;
+    }
+
+    int was_empty = channel->tx_queue == NULL;
+    btstack_linked_list_add_tail(&channel->tx_queue, (btstack_linked_item_t *) frame);
+
+    /* Pending control packets are sent first */
+    if (was_empty && (channel->state_var == BNEP_CHANNEL_STATE_VAR_NONE)) {
+        bnep_channel_send_queued_frames(channel);
+    } else if (was_empty) {
+        l2cap_request_can_send_now_event(channel->l2cap_cid);
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
 
 /* Set BNEP network protocol type filter */
 int bnep_set_net_type_filter(uint16_t bnep_cid, bnep_net_filter_t *filter, uint16_t len)
@@ -674,7 +731,7 @@ int bnep_set_multicast_filter(uint16_t bnep_cid,  bnep_multi_filter_t *filter, u
 /* BNEP timeout timer helper function */
 static void bnep_channel_timer_handler(btstack_timer_source_t *timer)
 {
-    bnep_channel_t *channel = btstack_run_loop_get_timer_context(timer);
+    bnep_channel_t *channel = (bnep_channel_t *) btstack_run_loop_get_timer_context(timer);
     // retry send setup connection at least one time
     if (channel->state == BNEP_CHANNEL_STATE_WAIT_FOR_CONNECTION_RESPONSE){
         if (channel->retry_count < BNEP_CONNECTION_MAX_RETRIES){
@@ -811,6 +868,9 @@ static void bnep_channel_finalize(bnep_channel_t *channel)
 
     /* Stop any eventually running timer */
     bnep_channel_stop_timer(channel);
+
+    /* Return queued frames to their owner */
+    bnep_channel_drop_queued_frames(channel);
     
     /* Free ressources and then close the l2cap channel */
     bnep_channel_free(channel);
@@ -1559,6 +1619,13 @@ static void bnep_channel_state_machine(bnep_channel_t* channel, bnep_channel_eve
             return;
         }
 
+        /* Send queued frames */
+        if (channel->tx_queue != NULL){
+            bnep_channel_send_queued_frames(channel);
+            if (channel->tx_queue != NULL) return;
+            if (!l2cap_can_send_packet_now(channel->l2cap_cid)) return;
+        }
+
         /* If the event was not yet handled, notify the application layer */
         if (channel->waiting_for_can_send_now){
             channel->waiting_for_can_send_now = 0;            
@@ -1583,6 +1650,12 @@ static void bnep_handle_can_send_now(uint16_t l2cap_cid){
             l2cap_request_can_send_now_event(channel->l2cap_cid);
             return;
         }
+
+        /* Continue with pending control packets or queued frames */
+        if ((channel->state_var != BNEP_CHANNEL_STATE_VAR_NONE) || (channel->tx_queue != NULL)) {
+            l2cap_request_can_send_now_event(channel->l2cap_cid);
+            return;
+        }
     }
 }
 
@@ -101,6 +101,20 @@ typedef struct {
 } bnep_multi_filter_t;
 
 
+/* queued ethernet frame, see bnep_send_frame */
+typedef struct bnep_tx_frame {
+    // linked list - assert: first field
+    btstack_linked_item_t item;
+
+    // ethernet frame: destination address, source address, network protocol type, payload
+    const uint8_t *    data;
+    uint16_t           len;
+
+    // called after frame was sent (status ERROR_CODE_SUCCESS) or dropped
+    void (*callback)(struct bnep_tx_frame * frame, uint8_t status);
+    void *             context;
+} bnep_tx_frame_t;
+
 // info regarding multiplexer
 // note: spec mandates single multplexer per device combination
 typedef struct {
@@ -145,6 +159,9 @@ typedef struct {
 
     uint8_t   waiting_for_can_send_now;
 
+    // queued ethernet frames, see bnep_send_frame
+    btstack_linked_list_t tx_queue;
+
 } bnep_channel_t;
 
 /* Internal BNEP service descriptor */
@@ -185,6 +202,16 @@ void bnep_request_can_send_now_event(uint16_t bnep_cid);
  */
 int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len);
 
+/**
+ * @brief Queue ethernet frame for sending. Queued frames are sent in order as soon as ACL buffers are available,
+ *        without waiting for BNEP_EVENT_CAN_SEND_NOW. Multiple frames are sent per ACL round trip.
+ * @note frame->data must stay valid until frame->callback was called
+ * @param bnep_cid
+ * @param frame with data, len, and callback set
+ * @return status: ERROR_CODE_SUCCESS, BNEP_CHANNEL_NOT_CONNECTED, or BNEP_DATA_LEN_EXCEEDS_MTU
+ */
+uint8_t bnep_send_frame(uint16_t bnep_cid, bnep_tx_frame_t * frame);
+
 /**
  * @brief Set the network protocol filter.
  */
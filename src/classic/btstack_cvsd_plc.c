@@ -50,6 +50,10 @@
 #include <stdio.h>
 #endif
 
+#ifdef __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
+
 #include "btstack_cvsd_plc.h"
 #include "btstack_debug.h"
 
@@ -70,55 +74,58 @@ float btstack_cvsd_plc_rcos(int index){
     return rcos[index];
 }
 
-// taken from http://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
-// Algorithm: Babylonian Method + some manipulations on IEEE 32 bit floating point representation
-static float sqrt3(const float x){
-    union {
-        int i;
-        float x;
-    } u;
-    u.x = x;
-    u.i = (1<<29) + (u.i >> 1) - (1<<22); 
-
-    // Two Babylonian Steps (simplified from:)
-    // u.x = 0.5f * (u.x + x/u.x);
-    // u.x = 0.5f * (u.x + x/u.x);
-    u.x =       u.x + (x/u.x);
-    u.x = (0.25f*u.x) + (x/u.x);
-
-    return u.x;
-}
-
 static float btstack_cvsd_plc_absolute(float x){
      if (x < 0) x = -x;
      return x;
 }
 
-static float btstack_cvsd_plc_cross_correlation(BTSTACK_CVSD_PLC_SAMPLE_FORMAT *x, BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y){
-    float num = 0;
-    float den = 0;
-    float x2 = 0;
-    float y2 = 0;
-    int   m;
-    for (m=0;m<CVSD_M;m++){
-        num+=((float)x[m])*y[m];
-        x2+=((float)x[m])*x[m];
-        y2+=((float)y[m])*y[m];
+// dot product of two sample vectors, len must be even
+static int64_t btstack_cvsd_plc_dot_product(const BTSTACK_CVSD_PLC_SAMPLE_FORMAT *x, const BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y, int len){
+    int64_t acc = 0;
+    int     m;
+#ifdef __ARM_FEATURE_SIMD32
+    // dual 16-bit multiply with 64-bit accumulate
+    for (m=0;m<len;m+=2){
+        int16x2_t x_pair;
+        int16x2_t y_pair;
+        memcpy(&x_pair, &x[m], sizeof(x_pair));
+        memcpy(&y_pair, &y[m], sizeof(y_pair));
+        acc = __smlald(x_pair, y_pair, acc);
     }
-    den = (float)sqrt3(x2*y2);
-    return num/den;
+#else
+    for (m=0;m<len;m++){
+        acc += (int32_t) x[m] * y[m];
+    }
+#endif
+    return acc;
+}
+
+// returns true if num_a/sqrt(energy_a) > num_b/sqrt(energy_b), energies have to be positive
+static bool btstack_cvsd_plc_correlation_greater(int64_t num_a, int64_t energy_a, int64_t num_b, int64_t energy_b){
+    if ((num_a >= 0) != (num_b >= 0)) return num_a >= 0;
+    float lhs = (float) num_a * (float) num_a * (float) energy_b;
+    float rhs = (float) num_b * (float) num_b * (float) energy_a;
+    if (num_a >= 0) return lhs > rhs;
+    return lhs < rhs;
 }
 
+// Find lag with maximal normalized cross correlation between template at the end of the history and the history.
+// The template energy is constant and does not affect the result, the window energy is updated incrementally
 int btstack_cvsd_plc_pattern_match(BTSTACK_CVSD_PLC_SAMPLE_FORMAT *y){
-    float maxCn = -999999.0;  // large negative number
-    int   bestmatch = 0;
-    float Cn;
-    int   n;
-    for (n=0;n<CVSD_N;n++){
-        Cn = btstack_cvsd_plc_cross_correlation(&y[CVSD_LHIST-CVSD_M], &y[n]); 
-        if (Cn>maxCn){
-            bestmatch=n;
-            maxCn = Cn; 
+    const BTSTACK_CVSD_PLC_SAMPLE_FORMAT * x = &y[CVSD_LHIST-CVSD_M];
+    int64_t energy = btstack_cvsd_plc_dot_product(y, y, CVSD_M);
+    int64_t best_num = btstack_cvsd_plc_dot_product(x, y, CVSD_M);
+    int64_t best_energy = energy ? energy : 1;
+    int     bestmatch = 0;
+    int     n;
+    for (n=1;n<CVSD_N;n++){
+        energy += ((int32_t) y[n+CVSD_M-1] * y[n+CVSD_M-1]) - ((int32_t) y[n-1] * y[n-1]);
+        int64_t num = btstack_cvsd_plc_dot_product(x, &y[n], CVSD_M);
+        int64_t window_energy = energy ? energy : 1;
+        if (btstack_cvsd_plc_correlation_greater(num, window_energy, best_num, best_energy)){
+            bestmatch   = n;
+            best_num    = num;
+            best_energy = window_energy;
         }
     }
     return bestmatch;
@@ -50,6 +50,10 @@
 #include <stdio.h>
 #endif
 
+#ifdef __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
+
 #include "btstack_sbc_plc.h"
 #include "btstack_debug.h"
 
@@ -74,55 +78,58 @@ static float rcos[SBC_OLAL] = {
     0.13049554f,0.07489143f,0.03376389f,0.00851345f
 };
 
-// taken from http://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
-// Algorithm: Babylonian Method + some manipulations on IEEE 32 bit floating point representation
-static float sqrt3(const float x){
-    union {
-        int i;
-        float x;
-    } u;
-    u.x = x;
-    u.i = (1<<29) + (u.i >> 1) - (1<<22); 
-
-    // Two Babylonian Steps (simplified from:)
-    // u.x = 0.5f * (u.x + x/u.x);
-    // u.x = 0.5f * (u.x + x/u.x);
-    u.x =       u.x + (x/u.x);
-    u.x = (0.25f*u.x) + (x/u.x);
-
-    return u.x;
-}
-
 static float absolute(float x){
      if (x < 0) x = -x;
      return x;
 }
 
-static float CrossCorrelation(SAMPLE_FORMAT *x, SAMPLE_FORMAT *y){
-    float num = 0;
-    float den = 0;
-    float x2 = 0;
-    float y2 = 0;
-    int   m;
-    for (m=0;m<SBC_M;m++){
-        num+=((float)x[m])*y[m];
-        x2+=((float)x[m])*x[m];
-        y2+=((float)y[m])*y[m];
+// dot product of two sample vectors, len must be even
+static int64_t DotProduct(const SAMPLE_FORMAT *x, const SAMPLE_FORMAT *y, int len){
+    int64_t acc = 0;
+    int     m;
+#ifdef __ARM_FEATURE_SIMD32
+    // dual 16-bit multiply with 64-bit accumulate
+    for (m=0;m<len;m+=2){
+        int16x2_t x_pair;
+        int16x2_t y_pair;
+        memcpy(&x_pair, &x[m], sizeof(x_pair));
+        memcpy(&y_pair, &y[m], sizeof(y_pair));
+        acc = __smlald(x_pair, y_pair, acc);
     }
-    den = (float)sqrt3(x2*y2);
-    return num/den;
+#else
+    for (m=0;m<len;m++){
+        acc += (int32_t) x[m] * y[m];
+    }
+#endif
+    return acc;
+}
+
+// returns true if num_a/sqrt(energy_a) > num_b/sqrt(energy_b), energies have to be positive
+static int CorrelationGreater(int64_t num_a, int64_t energy_a, int64_t num_b, int64_t energy_b){
+    if ((num_a >= 0) != (num_b >= 0)) return num_a >= 0;
+    float lhs = (float) num_a * (float) num_a * (float) energy_b;
+    float rhs = (float) num_b * (float) num_b * (float) energy_a;
+    if (num_a >= 0) return lhs > rhs;
+    return lhs < rhs;
 }
 
-static int PatternMatch(SAMPLE_FORMAT *y){
-    float maxCn = -999999.0;  // large negative number
-    int   bestmatch = 0;
-    float Cn;
-    int   n;
-    for (n=0;n<SBC_N;n++){
-        Cn = CrossCorrelation(&y[SBC_LHIST-SBC_M], &y[n]); 
-        if (Cn>maxCn){
-            bestmatch=n;
-            maxCn = Cn; 
+// Find lag with maximal normalized cross correlation between template at the end of the history and the history.
+// The template energy is constant and does not affect the result, the window energy is updated incrementally
+int btstack_sbc_plc_pattern_match(SAMPLE_FORMAT *y){
+    const SAMPLE_FORMAT * x = &y[SBC_LHIST-SBC_M];
+    int64_t energy = DotProduct(y, y, SBC_M);
+    int64_t best_num = DotProduct(x, y, SBC_M);
+    int64_t best_energy = energy ? energy : 1;
+    int     bestmatch = 0;
+    int     n;
+    for (n=1;n<SBC_N;n++){
+        energy += ((int32_t) y[n+SBC_M-1] * y[n+SBC_M-1]) - ((int32_t) y[n-1] * y[n-1]);
+        int64_t num = DotProduct(x, &y[n], SBC_M);
+        int64_t window_energy = energy ? energy : 1;
+        if (CorrelationGreater(num, window_energy, best_num, best_energy)){
+            bestmatch   = n;
+            best_num    = num;
+            best_energy = window_energy;
         }
     }
     return bestmatch;
@@ -338,7 +345,7 @@ void btstack_sbc_plc_bad_frame(btstack_sbc_plc_state_t *plc_state, SAMPLE_FORMAT
     if (plc_state->nbf==1){
         // printf("first bad frame\n");
         // Perform pattern matching to find where to replicate
-        plc_state->bestlag = PatternMatch(plc_state->hist);
+        plc_state->bestlag = btstack_sbc_plc_pattern_match(plc_state->hist);
     }
 
 #ifdef OCTAVE_OUTPUT
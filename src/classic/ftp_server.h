@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title FTP Server
+ *
+ * File Transfer Profile Server: folder browsing, object push, pull and delete.
+ *
+ * The OBEX Connect needs to target the Folder Browsing service. Requests are reported by the GOEP Server:
+ * - GOEP_SUBEVENT_SET_PATH_REQUEST: change folder
+ * - GOEP_SUBEVENT_GET_REQUEST: pull file, or folder listing for type "x-obex/folder-listing"
+ * - GOEP_SUBEVENT_PUT_REQUEST: push file
+ * - GOEP_SUBEVENT_DELETE_REQUEST: delete file or folder
+ *
+ */
+
+#ifndef FTP_SERVER_H
+#define FTP_SERVER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "btstack_defines.h"
+#include "gap.h"
+
+/* API_START */
+
+/**
+ * @brief Register FTP Server, requires goep_server_init
+ * @param packet_handler for GOEP events and GOEP_DATA_PACKET
+ * @param rfcomm_channel
+ * @param l2cap_psm or 0 if not used, requires ENABLE_GOEP_L2CAP
+ * @param security_level
+ * @return status
+ */
+uint8_t ftp_server_init(btstack_packet_handler_t packet_handler, uint8_t rfcomm_channel, uint16_t l2cap_psm, gap_security_level_t security_level);
+
+/**
+ * @brief Create SDP record for FTP Server
+ * @param service buffer - needs to large enough
+ * @param service_record_handle
+ * @param rfcomm_channel
+ * @param l2cap_psm or 0 if not used
+ * @param name
+ */
+void ftp_server_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint8_t rfcomm_channel, uint16_t l2cap_psm, const char * name);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+#endif // FTP_SERVER_H
@@ -67,6 +67,45 @@
 #endif
 #endif
 
+#ifdef ENABLE_GOEP_L2CAP
+// L2CAP MTU for OBEX packets received via ERTM, limits maximum OBEX packet length
+#ifndef GOEP_CLIENT_ERTM_MTU
+#define GOEP_CLIENT_ERTM_MTU 2048
+#endif
+
+// I-Frame payload (MPS): each received I-Frame fits into a single ACL packet (L2CAP header, control, SDU length, FCS)
+#if (HCI_ACL_PAYLOAD_SIZE - 10) < GOEP_CLIENT_ERTM_MTU
+#define GOEP_CLIENT_ERTM_MPS (HCI_ACL_PAYLOAD_SIZE - 10)
+#else
+#define GOEP_CLIENT_ERTM_MPS GOEP_CLIENT_ERTM_MTU
+#endif
+
+// TX window of the remote covers two OBEX packets of MTU size, which allows it to stream the next one while
+// the current one is reassembled. ERTM allows for max 63 unacknowledged I-Frames
+#define GOEP_CLIENT_ERTM_WINDOW (((2 * GOEP_CLIENT_ERTM_MTU) + GOEP_CLIENT_ERTM_MPS - 1) / GOEP_CLIENT_ERTM_MPS)
+#if GOEP_CLIENT_ERTM_WINDOW > 63
+#define GOEP_CLIENT_ERTM_NUM_RX_BUFFERS 63
+#else
+#define GOEP_CLIENT_ERTM_NUM_RX_BUFFERS GOEP_CLIENT_ERTM_WINDOW
+#endif
+
+// outgoing OBEX requests are small
+#define GOEP_CLIENT_ERTM_NUM_TX_BUFFERS 2
+
+// l2cap_create_ertm_channel: 16-byte alignment, packet states, reassembly buffer, rx and tx buffers of MPS size
+// each of the MAX_NR_GOEP_CLIENT_CONNECTIONS contexts has its own buffer, e.g. about 9 kB with the default
+// GOEP_CLIENT_ERTM_MTU and HCI_ACL_PAYLOAD_SIZE 1021. Lower GOEP_CLIENT_ERTM_MTU to reduce it
+#define GOEP_CLIENT_ERTM_BUFFER_SIZE (16 + \
+    (GOEP_CLIENT_ERTM_NUM_RX_BUFFERS * sizeof(l2cap_ertm_rx_packet_state_t)) + \
+    (GOEP_CLIENT_ERTM_NUM_TX_BUFFERS * sizeof(l2cap_ertm_tx_packet_state_t)) + \
+    GOEP_CLIENT_ERTM_MTU + \
+    ((GOEP_CLIENT_ERTM_NUM_RX_BUFFERS + GOEP_CLIENT_ERTM_NUM_TX_BUFFERS) * GOEP_CLIENT_ERTM_MPS))
+#endif
+
+#ifndef MAX_NR_GOEP_CLIENT_CONNECTIONS
+#define MAX_NR_GOEP_CLIENT_CONNECTIONS 1
+#endif
+
 typedef enum {
     GOEP_INIT,
     GOEP_W4_SDP,
@@ -78,6 +117,7 @@ typedef struct {
     uint16_t         cid;
     goep_state_t     state;
     bd_addr_t        bd_addr;
+    uint16_t         uuid;
     hci_con_handle_t con_handle;
     uint8_t          incoming;
     uint8_t          rfcomm_port;
@@ -91,29 +131,55 @@ typedef struct {
     int              obex_connection_id_set;
 
     btstack_packet_handler_t client_handler;
+
+    btstack_context_callback_registration_t sdp_query_request;
+
+#ifdef ENABLE_GOEP_L2CAP
+    l2cap_ertm_config_t ertm_config;
+    uint8_t          ertm_buffer[GOEP_CLIENT_ERTM_BUFFER_SIZE];
+    uint8_t          l2cap_packet_buffer[100];
+#endif
 } goep_client_t;
 
-static goep_client_t _goep_client;
-static goep_client_t * goep_client = &_goep_client;
+static goep_client_t goep_clients[MAX_NR_GOEP_CLIENT_CONNECTIONS];
+static uint16_t      goep_client_cid_counter;
+
+// SDP queries are serialized by the SDP Client
+static uint16_t      goep_client_sdp_query_cid;
 
 static uint8_t            attribute_value[30];
 static const unsigned int attribute_value_buffer_size = sizeof(attribute_value);
 
-static uint8_t goep_packet_buffer[100];
+static goep_client_t * goep_client_for_cid(uint16_t goep_cid){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_CLIENT_CONNECTIONS;i++){
+        goep_client_t * context = &goep_clients[i];
+        if (context->state == GOEP_INIT) continue;
+        if (context->cid != goep_cid) continue;
+        return context;
+    }
+    return NULL;
+}
 
-#ifdef ENABLE_GOEP_L2CAP
-static uint8_t ertm_buffer[1000];
-static l2cap_ertm_config_t ertm_config = {
-    1,  // ertm mandatory
-    2,  // max transmit, some tests require > 1
-    2000,
-    12000,
-    512,    // l2cap ertm mtu
-    2,
-    2,
-    0,      // No FCS
-};
-#endif
+static goep_client_t * goep_client_for_bearer_cid(uint16_t bearer_cid, bool l2cap_bearer){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_CLIENT_CONNECTIONS;i++){
+        goep_client_t * context = &goep_clients[i];
+        if (context->state < GOEP_W4_CONNECTION) continue;
+        if (context->bearer_cid != bearer_cid) continue;
+        if ((context->l2cap_psm != 0) != l2cap_bearer) continue;
+        return context;
+    }
+    return NULL;
+}
+
+static uint16_t goep_client_get_next_cid(void){
+    goep_client_cid_counter++;
+    if (goep_client_cid_counter == 0){
+        goep_client_cid_counter = 1;
+    }
+    return goep_client_cid_counter;
+}
 
 static inline void goep_client_emit_connected_event(goep_client_t * context, uint8_t status){
     uint8_t event[15];
@@ -178,31 +244,42 @@ static void goep_client_handle_connection_close(goep_client_t * context){
 }
 
 static void goep_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
-    UNUSED(channel);
     UNUSED(size);
-    goep_client_t * context = goep_client;
+    goep_client_t * context;
     switch (packet_type){
         case HCI_EVENT_PACKET:
             switch (hci_event_packet_get_type(packet)) {
 #ifdef ENABLE_GOEP_L2CAP
                 case L2CAP_EVENT_CHANNEL_OPENED:
+                    context = goep_client_for_bearer_cid(l2cap_event_channel_opened_get_local_cid(packet), true);
+                    if (context == NULL) break;
                     goep_client_handle_connection_opened(context, l2cap_event_channel_opened_get_status(packet),
                         btstack_min(l2cap_event_channel_opened_get_remote_mtu(packet), l2cap_event_channel_opened_get_local_mtu(packet)));
                     return;
                 case L2CAP_EVENT_CAN_SEND_NOW:
+                    context = goep_client_for_bearer_cid(l2cap_event_can_send_now_get_local_cid(packet), true);
+                    if (context == NULL) break;
                     goep_client_emit_can_send_now_event(context);
                     break;
                 case L2CAP_EVENT_CHANNEL_CLOSED:
+                    context = goep_client_for_bearer_cid(l2cap_event_channel_closed_get_local_cid(packet), true);
+                    if (context == NULL) break;
                     goep_client_handle_connection_close(context);
                     break;
 #endif
                 case RFCOMM_EVENT_CHANNEL_OPENED:
+                    context = goep_client_for_bearer_cid(rfcomm_event_channel_opened_get_rfcomm_cid(packet), false);
+                    if (context == NULL) break;
                     goep_client_handle_connection_opened(context, rfcomm_event_channel_opened_get_status(packet), rfcomm_event_channel_opened_get_max_frame_size(packet));
                     return;
                 case RFCOMM_EVENT_CAN_SEND_NOW:
+                    context = goep_client_for_bearer_cid(rfcomm_event_can_send_now_get_rfcomm_cid(packet), false);
+                    if (context == NULL) break;
                     goep_client_emit_can_send_now_event(context);
                     break;
                 case RFCOMM_EVENT_CHANNEL_CLOSED:
+                    context = goep_client_for_bearer_cid(rfcomm_event_channel_closed_get_rfcomm_cid(packet), false);
+                    if (context == NULL) break;
                     goep_client_handle_connection_close(context);
                     break;
                 default:
@@ -211,6 +288,8 @@ static void goep_client_packet_handler(uint8_t packet_type, uint16_t channel, ui
             break;
         case L2CAP_DATA_PACKET:
         case RFCOMM_DATA_PACKET:
+            context = goep_client_for_bearer_cid(channel, packet_type == L2CAP_DATA_PACKET);
+            if (context == NULL) break;
             context->client_handler(GOEP_DATA_PACKET, context->cid, packet, size);
             break;
         default:
@@ -218,8 +297,37 @@ static void goep_client_packet_handler(uint8_t packet_type, uint16_t channel, ui
     }
 }
 
+static void goep_client_create_bearer(goep_client_t * context){
+    uint8_t status;
+    context->state = GOEP_W4_CONNECTION;
+#ifdef ENABLE_GOEP_L2CAP
+    if (context->l2cap_psm){
+        log_info("Remote GOEP L2CAP PSM: %u", context->l2cap_psm);
+        context->ertm_config.ertm_mandatory = 1;
+        context->ertm_config.max_transmit = 2;  // some tests require > 1
+        context->ertm_config.retransmission_timeout_ms = 2000;
+        context->ertm_config.monitor_timeout_ms = 12000;
+        context->ertm_config.local_mtu = GOEP_CLIENT_ERTM_MTU;
+        context->ertm_config.num_tx_buffers = GOEP_CLIENT_ERTM_NUM_TX_BUFFERS;
+        context->ertm_config.num_rx_buffers = GOEP_CLIENT_ERTM_NUM_RX_BUFFERS;
+        context->ertm_config.fcs_option = 0;    // No FCS
+        status = l2cap_create_ertm_channel(&goep_client_packet_handler, context->bd_addr, context->l2cap_psm,
+                                           &context->ertm_config, context->ertm_buffer, sizeof(context->ertm_buffer), &context->bearer_cid);
+    } else
+#endif
+    {
+        log_info("Remote GOEP RFCOMM Server Channel: %u", context->rfcomm_port);
+        status = rfcomm_create_channel(&goep_client_packet_handler, context->bd_addr, context->rfcomm_port, &context->bearer_cid);
+    }
+    if (status != ERROR_CODE_SUCCESS){
+        context->state = GOEP_INIT;
+        goep_client_emit_connected_event(context, status);
+    }
+}
+
 static void goep_client_handle_sdp_query_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_client_sdp_query_cid);
+    if ((context == NULL) || (context->state != GOEP_W4_SDP)) return;
 
     UNUSED(packet_type);
     UNUSED(channel);
@@ -320,25 +428,16 @@ static void goep_client_handle_sdp_query_event(uint8_t packet_type, uint16_t cha
             if (status != ERROR_CODE_SUCCESS){
                 log_info("GOEP client, SDP query failed 0x%02x", status);
                 context->state = GOEP_INIT;
-                goep_client_emit_connected_event(goep_client, status);
+                goep_client_emit_connected_event(context, status);
                 break;
             }
             if ((context->rfcomm_port == 0) && (context->l2cap_psm == 0)){
                 log_info("No GOEP RFCOMM or L2CAP server found");
                 context->state = GOEP_INIT;
-                goep_client_emit_connected_event(goep_client, SDP_SERVICE_NOT_FOUND);
+                goep_client_emit_connected_event(context, SDP_SERVICE_NOT_FOUND);
                 break;
             }
-#ifdef ENABLE_GOEP_L2CAP
-            if (context->l2cap_psm){
-                log_info("Remote GOEP L2CAP PSM: %u", context->l2cap_psm);
-                l2cap_create_ertm_channel(&goep_client_packet_handler, context->bd_addr, context->l2cap_psm,
-                                          &ertm_config, ertm_buffer, sizeof(ertm_buffer), &context->bearer_cid);
-                return;
-            }
-#endif
-            log_info("Remote GOEP RFCOMM Server Channel: %u", context->rfcomm_port);
-            rfcomm_create_channel(&goep_client_packet_handler, context->bd_addr, context->rfcomm_port, &context->bearer_cid);
+            goep_client_create_bearer(context);
             break;
 
         default:
@@ -347,24 +446,26 @@ static void goep_client_handle_sdp_query_event(uint8_t packet_type, uint16_t cha
 }
 
 static uint8_t * goep_client_get_outgoing_buffer(goep_client_t * context){
+#ifdef ENABLE_GOEP_L2CAP
     if (context->l2cap_psm){
-        return goep_packet_buffer;
-    } else {
-        return rfcomm_get_outgoing_buffer();
+        return context->l2cap_packet_buffer;
     }
+#else
+    UNUSED(context);
+#endif
+    return rfcomm_get_outgoing_buffer();
 }
 
 static uint16_t goep_client_get_outgoing_buffer_len(goep_client_t * context){
+#ifdef ENABLE_GOEP_L2CAP
     if (context->l2cap_psm){
-        return sizeof(goep_packet_buffer);
-    } else {
-        return rfcomm_get_max_frame_size(context->bearer_cid);
+        return btstack_min(sizeof(context->l2cap_packet_buffer), context->bearer_mtu);
     }
+#endif
+    return rfcomm_get_max_frame_size(context->bearer_cid);
 }
 
-static void goep_client_packet_init(uint16_t goep_cid, uint8_t opcode){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+static void goep_client_packet_init(goep_client_t * context, uint8_t opcode){
     if (context->l2cap_psm){
     } else {
         rfcomm_reserve_packet_buffer();
@@ -373,58 +474,92 @@ static void goep_client_packet_init(uint16_t goep_cid, uint8_t opcode){
     context->obex_opcode = opcode;
 }
 
+static void goep_client_handle_sdp_query_request(void * arg){
+    goep_client_t * context = (goep_client_t *) arg;
+    goep_client_sdp_query_cid = context->cid;
+    uint8_t status = sdp_client_query_uuid16(&goep_client_handle_sdp_query_event, context->bd_addr, context->uuid);
+    if (status != ERROR_CODE_SUCCESS){
+        context->state = GOEP_INIT;
+        goep_client_emit_connected_event(context, status);
+    }
+}
+
 void goep_client_init(void){
-    memset(goep_client, 0, sizeof(goep_client_t));
-    goep_client->state = GOEP_INIT;
-    goep_client->cid = 1;
-    goep_client->obex_connection_id = OBEX_CONNECTION_ID_INVALID;
+    memset(goep_clients, 0, sizeof(goep_clients));
+    goep_client_cid_counter = 0;
+    goep_client_sdp_query_cid = 0;
 }
 
 void goep_client_deinit(void){
+    // drop pending SDP query requests before their registrations are cleared
+    int i;
+    for (i=0;i<MAX_NR_GOEP_CLIENT_CONNECTIONS;i++){
+        sdp_client_unregister_query_callback(&goep_clients[i].sdp_query_request);
+    }
+    memset(goep_clients, 0, sizeof(goep_clients));
+    goep_client_sdp_query_cid = 0;
 }
 
 uint8_t goep_client_create_connection(btstack_packet_handler_t handler, bd_addr_t addr, uint16_t uuid, uint16_t * out_cid){
-    goep_client_t * context = goep_client;
-    if (context->state != GOEP_INIT) return BTSTACK_MEMORY_ALLOC_FAILED;
+    goep_client_t * context = NULL;
+    int i;
+    for (i=0;i<MAX_NR_GOEP_CLIENT_CONNECTIONS;i++){
+        if (goep_clients[i].state != GOEP_INIT) continue;
+        context = &goep_clients[i];
+        break;
+    }
+    if (context == NULL) return BTSTACK_MEMORY_ALLOC_FAILED;
+    memset(context, 0, sizeof(goep_client_t));
+    context->cid = goep_client_get_next_cid();
     context->client_handler = handler;
     context->state = GOEP_W4_SDP;
-    context->l2cap_psm   = 0;
-    context->rfcomm_port = 0;
+    context->uuid = uuid;
+    context->obex_connection_id = OBEX_CONNECTION_ID_INVALID;
     context->pbap_supported_features = PBAP_FEATURES_NOT_PRESENT;
     (void)memcpy(context->bd_addr, addr, 6);
-    sdp_client_query_uuid16(&goep_client_handle_sdp_query_event, context->bd_addr, uuid);
     *out_cid = context->cid;
+    // SDP Client handles one query at a time
+    context->sdp_query_request.callback = &goep_client_handle_sdp_query_request;
+    context->sdp_query_request.context = context;
+    (void) sdp_client_register_query_callback(&context->sdp_query_request);
     return 0;
 }
 
 uint32_t goep_client_get_pbap_supported_features(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return PBAP_FEATURES_NOT_PRESENT;
     return context->pbap_supported_features;
 }
 
 uint8_t goep_client_disconnect(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (context->state != GOEP_CONNECTED) return ERROR_CODE_COMMAND_DISALLOWED;
+#ifdef ENABLE_GOEP_L2CAP
+    if (context->l2cap_psm){
+        l2cap_disconnect(context->bearer_cid, 0);
+        return 0;
+    }
+#endif
     rfcomm_disconnect(context->bearer_cid);
     return 0;
 }
 
 void goep_client_set_connection_id(uint16_t goep_cid, uint32_t connection_id){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
     context->obex_connection_id = connection_id;
 }
 
 uint8_t goep_client_get_request_opcode(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return 0;
     return context->obex_opcode;
 }
 
 void goep_client_request_can_send_now(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
     if (context->l2cap_psm){
         l2cap_request_can_send_now_event(context->bearer_cid);
     } else {
@@ -433,9 +568,9 @@ void goep_client_request_can_send_now(uint16_t goep_cid){
 }
 
 void goep_client_request_create_connect(uint16_t goep_cid, uint8_t obex_version_number, uint8_t flags, uint16_t maximum_obex_packet_length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_CONNECT);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_CONNECT);
 
     // workaround: limit OBEX packet len to L2CAP/RFCOMM MTU to avoid handling of fragemented packets
     maximum_obex_packet_length = btstack_min(maximum_obex_packet_length, context->bearer_mtu);
@@ -446,9 +581,9 @@ void goep_client_request_create_connect(uint16_t goep_cid, uint8_t obex_version_
 }
 
 void goep_client_request_create_get(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK);
 
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
@@ -456,9 +591,9 @@ void goep_client_request_create_get(uint16_t goep_cid){
 }
 
 void goep_client_request_create_put(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_PUT | OBEX_OPCODE_FINAL_BIT_MASK);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_PUT | OBEX_OPCODE_FINAL_BIT_MASK);
 
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
@@ -466,9 +601,9 @@ void goep_client_request_create_put(uint16_t goep_cid){
 }
 
 void goep_client_request_create_set_path(uint16_t goep_cid, uint8_t flags){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_SETPATH);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_SETPATH);
 
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
@@ -476,9 +611,9 @@ void goep_client_request_create_set_path(uint16_t goep_cid, uint8_t flags){
 }
 
 void goep_client_request_create_abort(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_ABORT);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_ABORT);
 
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
@@ -486,9 +621,9 @@ void goep_client_request_create_abort(uint16_t goep_cid){
 }
 
 void goep_client_request_create_disconnect(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    goep_client_packet_init(goep_cid, OBEX_OPCODE_DISCONNECT);
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+    goep_client_packet_init(context, OBEX_OPCODE_DISCONNECT);
 
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
@@ -496,98 +631,98 @@ void goep_client_request_create_disconnect(uint16_t goep_cid){
 }
 
 void goep_client_header_add_byte(uint16_t goep_cid, uint8_t header_type, uint8_t value){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_byte(buffer, buffer_len, header_type, value);
 }
 
 void goep_client_header_add_word(uint16_t goep_cid, uint8_t header_type, uint32_t value){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_word(buffer, buffer_len, header_type, value);
 }
 
 void goep_client_header_add_variable(uint16_t goep_cid, uint8_t header_type, const uint8_t * header_data, uint16_t header_data_length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_variable(buffer, buffer_len, header_type, header_data, header_data_length);
 }
 
 void goep_client_header_add_srm_enable(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_srm_enable(buffer, buffer_len);
 }
 
 void goep_client_header_add_target(uint16_t goep_cid, const uint8_t * target, uint16_t length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_target(buffer, buffer_len, target, length);
 }
 
 void goep_client_header_add_application_parameters(uint16_t goep_cid, const uint8_t * data, uint16_t length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_application_parameters(buffer, buffer_len, data, length);
 }
 
 void goep_client_header_add_challenge_response(uint16_t goep_cid, const uint8_t * data, uint16_t length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_challenge_response(buffer, buffer_len, data, length);
 }
 
 void goep_client_body_add_static(uint16_t goep_cid, const uint8_t * data, uint32_t length){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_body_add_static(buffer, buffer_len, data, length);
 }
 
 void goep_client_header_add_name(uint16_t goep_cid, const char * name){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_name(buffer, buffer_len, name);
 }
 
 void goep_client_header_add_type(uint16_t goep_cid, const char * type){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
-    
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return;
+
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t buffer_len = goep_client_get_outgoing_buffer_len(context);
     obex_message_builder_header_add_type(buffer, buffer_len, type);
 }
 
 int goep_client_execute(uint16_t goep_cid){
-    UNUSED(goep_cid);
-    goep_client_t * context = goep_client;
+    goep_client_t * context = goep_client_for_cid(goep_cid);
+    if (context == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     uint8_t * buffer = goep_client_get_outgoing_buffer(context);
     uint16_t pos = big_endian_read_16(buffer, 1);
     if (context->l2cap_psm){
@@ -66,6 +66,8 @@ void goep_client_init(void);
 
 /*
  * @brief Create GOEP connection to a GEOP server with specified UUID on a remote deivce.
+ * @note With ENABLE_GOEP_L2CAP, each of the MAX_NR_GOEP_CLIENT_CONNECTIONS connections reserves a static ERTM buffer,
+ *       about 9 kB with the default GOEP_CLIENT_ERTM_MTU of 2048 and HCI_ACL_PAYLOAD_SIZE 1021.
  * @param handler 
  * @param addr
  * @param uuid
@@ -0,0 +1,1217 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "goep_server.c"
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bluetooth_sdp.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "classic/goep_server.h"
+#include "classic/obex.h"
+#include "classic/obex_iterator.h"
+#include "classic/obex_message_builder.h"
+#include "classic/rfcomm.h"
+#include "classic/sdp_util.h"
+#include "l2cap.h"
+
+//------------------------------------------------------------------------------------------------------------
+// goep_server.c
+//
+
+#ifdef ENABLE_GOEP_L2CAP
+#ifndef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#error "ENABLE_GOEP_L2CAP requires ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE. Please enable ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE or disable ENABLE_GOEP_L2CAP"
+#endif
+#endif
+
+#ifdef ENABLE_GOEP_L2CAP
+// L2CAP MTU for OBEX packets via ERTM, limits maximum OBEX packet length in both directions
+#ifndef GOEP_SERVER_ERTM_MTU
+#define GOEP_SERVER_ERTM_MTU 2048
+#endif
+
+// I-Frame payload (MPS): each I-Frame fits into a single ACL packet (L2CAP header, control, SDU length, FCS)
+#if (HCI_ACL_PAYLOAD_SIZE - 10) < GOEP_SERVER_ERTM_MTU
+#define GOEP_SERVER_ERTM_MPS (HCI_ACL_PAYLOAD_SIZE - 10)
+#else
+#define GOEP_SERVER_ERTM_MPS GOEP_SERVER_ERTM_MTU
+#endif
+
+// with SRM, the client streams PUT packets and the server streams GET responses. A window of two OBEX packets
+// keeps the link busy while the previous one is processed. ERTM allows for max 63 unacknowledged I-Frames
+#define GOEP_SERVER_ERTM_WINDOW (((2 * GOEP_SERVER_ERTM_MTU) + GOEP_SERVER_ERTM_MPS - 1) / GOEP_SERVER_ERTM_MPS)
+#if GOEP_SERVER_ERTM_WINDOW > 63
+#define GOEP_SERVER_ERTM_NUM_BUFFERS 63
+#else
+#define GOEP_SERVER_ERTM_NUM_BUFFERS GOEP_SERVER_ERTM_WINDOW
+#endif
+
+// l2cap_accept_ertm_connection: 16-byte alignment, packet states, reassembly buffer, rx and tx buffers of MPS size
+#define GOEP_SERVER_ERTM_BUFFER_SIZE (16 + \
+    (GOEP_SERVER_ERTM_NUM_BUFFERS * sizeof(l2cap_ertm_rx_packet_state_t)) + \
+    (GOEP_SERVER_ERTM_NUM_BUFFERS * sizeof(l2cap_ertm_tx_packet_state_t)) + \
+    GOEP_SERVER_ERTM_MTU + \
+    (2 * GOEP_SERVER_ERTM_NUM_BUFFERS * GOEP_SERVER_ERTM_MPS))
+#endif
+
+// OBEX packets can be split across or coalesced into RFCOMM frames and get reassembled in a buffer of this size,
+// limits maximum OBEX packet length received via RFCOMM
+#ifndef GOEP_SERVER_RFCOMM_MAX_PACKET_LEN
+#define GOEP_SERVER_RFCOMM_MAX_PACKET_LEN 1024
+#endif
+
+#if GOEP_SERVER_RFCOMM_MAX_PACKET_LEN < 255
+#error "GOEP_SERVER_RFCOMM_MAX_PACKET_LEN must be at least 255, the minimal OBEX packet length"
+#endif
+
+#ifndef MAX_NR_GOEP_SERVER_SERVICES
+#define MAX_NR_GOEP_SERVER_SERVICES 2
+#endif
+
+#ifndef MAX_NR_GOEP_SERVER_CONNECTIONS
+#define MAX_NR_GOEP_SERVER_CONNECTIONS 1
+#endif
+
+typedef struct {
+    btstack_packet_handler_t packet_handler;
+    uint8_t          rfcomm_channel;
+    uint16_t         l2cap_psm;
+    const uint8_t  * target;
+    uint16_t         target_len;
+    uint8_t          operations;
+} goep_server_service_t;
+
+typedef enum {
+    GOEP_SERVER_IDLE,
+    GOEP_SERVER_W4_CONNECTION,
+    GOEP_SERVER_CONNECTED,
+} goep_server_state_t;
+
+typedef enum {
+    GOEP_SERVER_TRANSFER_IDLE,
+    GOEP_SERVER_TRANSFER_PUT,
+    GOEP_SERVER_TRANSFER_PUT_REJECTED,
+    GOEP_SERVER_TRANSFER_GET_REQUEST,
+    GOEP_SERVER_TRANSFER_GET,
+} goep_server_transfer_t;
+
+typedef struct {
+    uint16_t         cid;
+    goep_server_state_t state;
+    goep_server_service_t * service;
+    bd_addr_t        bd_addr;
+    hci_con_handle_t con_handle;
+    bool             l2cap_bearer;
+    uint16_t         bearer_cid;
+    uint16_t         bearer_mtu;
+
+    // OBEX session
+    uint32_t         obex_connection_id;
+    uint16_t         obex_max_packet_len;
+    bool             obex_connected;
+
+    // current operation
+    goep_server_transfer_t transfer;
+    bool             srm_active;
+    bool             srm_wait;
+
+    // request event
+    bool             in_request_event;
+    uint8_t          request_subevent;
+    uint8_t          reject_code;
+
+    // pending response
+    uint8_t          response_code;
+    bool             response_connect;
+    bool             response_srm_enable;
+    bool             response_get_body;
+
+    // GET
+    uint32_t         get_object_len;
+    uint32_t         get_offset;
+    goep_server_get_callback_t get_callback;
+
+    // OBEX packet reassembly for RFCOMM
+    uint16_t         rfcomm_packet_pos;
+    uint16_t         rfcomm_packet_skip;
+    uint8_t          rfcomm_packet_buffer[GOEP_SERVER_RFCOMM_MAX_PACKET_LEN];
+
+#ifdef ENABLE_GOEP_L2CAP
+    l2cap_ertm_config_t ertm_config;
+    uint8_t          ertm_buffer[GOEP_SERVER_ERTM_BUFFER_SIZE];
+    uint8_t          l2cap_packet_buffer[GOEP_SERVER_ERTM_MTU];
+#endif
+} goep_server_connection_t;
+
+// headers of a single request packet
+typedef struct {
+    const uint8_t  * name;
+    uint16_t         name_len;
+    bool             name_present;
+    const uint8_t  * type;
+    uint16_t         type_len;
+    const uint8_t  * target;
+    uint16_t         target_len;
+    uint32_t         length;
+    bool             body_present;
+    uint8_t          srm;
+    uint8_t          srmp;
+} goep_server_request_t;
+
+static goep_server_service_t    goep_server_services[MAX_NR_GOEP_SERVER_SERVICES];
+static goep_server_connection_t goep_server_connections[MAX_NR_GOEP_SERVER_CONNECTIONS];
+static uint16_t                 goep_server_cid_counter;
+
+static goep_server_service_t * goep_server_service_for_rfcomm_channel(uint8_t rfcomm_channel){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_SERVICES;i++){
+        goep_server_service_t * service = &goep_server_services[i];
+        if (service->packet_handler == NULL) continue;
+        if (service->rfcomm_channel != rfcomm_channel) continue;
+        return service;
+    }
+    return NULL;
+}
+
+#ifdef ENABLE_GOEP_L2CAP
+static goep_server_service_t * goep_server_service_for_l2cap_psm(uint16_t l2cap_psm){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_SERVICES;i++){
+        goep_server_service_t * service = &goep_server_services[i];
+        if (service->packet_handler == NULL) continue;
+        if (service->l2cap_psm != l2cap_psm) continue;
+        return service;
+    }
+    return NULL;
+}
+#endif
+
+static goep_server_connection_t * goep_server_connection_for_cid(uint16_t goep_cid){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_CONNECTIONS;i++){
+        goep_server_connection_t * connection = &goep_server_connections[i];
+        if (connection->state == GOEP_SERVER_IDLE) continue;
+        if (connection->cid != goep_cid) continue;
+        return connection;
+    }
+    return NULL;
+}
+
+static goep_server_connection_t * goep_server_connection_for_bearer_cid(uint16_t bearer_cid, bool l2cap_bearer){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_CONNECTIONS;i++){
+        goep_server_connection_t * connection = &goep_server_connections[i];
+        if (connection->state == GOEP_SERVER_IDLE) continue;
+        if (connection->bearer_cid != bearer_cid) continue;
+        if (connection->l2cap_bearer != l2cap_bearer) continue;
+        return connection;
+    }
+    return NULL;
+}
+
+static uint16_t goep_server_get_next_cid(void){
+    goep_server_cid_counter++;
+    if (goep_server_cid_counter == 0){
+        goep_server_cid_counter = 1;
+    }
+    return goep_server_cid_counter;
+}
+
+static goep_server_connection_t * goep_server_create_connection(goep_server_service_t * service, bool l2cap_bearer, uint16_t bearer_cid,
+                                                                const bd_addr_t bd_addr, hci_con_handle_t con_handle){
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_CONNECTIONS;i++){
+        goep_server_connection_t * connection = &goep_server_connections[i];
+        if (connection->state != GOEP_SERVER_IDLE) continue;
+        memset(connection, 0, sizeof(goep_server_connection_t));
+        connection->cid = goep_server_get_next_cid();
+        connection->state = GOEP_SERVER_W4_CONNECTION;
+        connection->service = service;
+        connection->l2cap_bearer = l2cap_bearer;
+        connection->bearer_cid = bearer_cid;
+        connection->con_handle = con_handle;
+        connection->obex_connection_id = OBEX_CONNECTION_ID_INVALID;
+        (void)memcpy(connection->bd_addr, bd_addr, 6);
+        return connection;
+    }
+    return NULL;
+}
+
+static void goep_server_emit_connected_event(goep_server_connection_t * connection, uint8_t status){
+    uint8_t event[15];
+    int pos = 0;
+    event[pos++] = HCI_EVENT_GOEP_META;
+    pos++;  // skip len
+    event[pos++] = GOEP_SUBEVENT_CONNECTION_OPENED;
+    little_endian_store_16(event,pos,connection->cid);
+    pos+=2;
+    event[pos++] = status;
+    (void)memcpy(&event[pos], connection->bd_addr, 6);
+    pos += 6;
+    little_endian_store_16(event,pos,connection->con_handle);
+    pos += 2;
+    event[pos++] = 1;   // incoming
+    event[1] = pos - 2;
+    (*connection->service->packet_handler)(HCI_EVENT_PACKET, connection->cid, &event[0], pos);
+}
+
+static void goep_server_emit_event(goep_server_connection_t * connection, uint8_t subevent){
+    uint8_t event[5];
+    int pos = 0;
+    event[pos++] = HCI_EVENT_GOEP_META;
+    pos++;  // skip len
+    event[pos++] = subevent;
+    little_endian_store_16(event,pos,connection->cid);
+    pos+=2;
+    event[1] = pos - 2;
+    (*connection->service->packet_handler)(HCI_EVENT_PACKET, connection->cid, &event[0], pos);
+}
+
+static void goep_server_emit_completed_event(goep_server_connection_t * connection, uint8_t subevent, uint8_t status){
+    uint8_t event[6];
+    int pos = 0;
+    event[pos++] = HCI_EVENT_GOEP_META;
+    pos++;  // skip len
+    event[pos++] = subevent;
+    little_endian_store_16(event,pos,connection->cid);
+    pos+=2;
+    event[pos++] = status;
+    event[1] = pos - 2;
+    (*connection->service->packet_handler)(HCI_EVENT_PACKET, connection->cid, &event[0], pos);
+}
+
+// Name header is a null-terminated UTF-16BE string, events use UTF-8. Surrogate pairs are replaced by '?'
+static uint16_t goep_server_store_name(uint8_t * buffer, const uint8_t * name, uint16_t name_len){
+    uint16_t pos = 0;
+    uint16_t i;
+    for (i = 0; (i + 1) < name_len; i += 2){
+        uint16_t c = big_endian_read_16(name, i);
+        if (c == 0) break;
+        if (c < 0x80){
+            if ((pos + 1) > GOEP_SERVER_MAX_NAME_LEN) break;
+            buffer[pos++] = (uint8_t) c;
+        } else if (c < 0x800){
+            if ((pos + 2) > GOEP_SERVER_MAX_NAME_LEN) break;
+            buffer[pos++] = (uint8_t) (0xc0 | (c >> 6));
+            buffer[pos++] = (uint8_t) (0x80 | (c & 0x3f));
+        } else if ((c >= 0xd800) && (c < 0xe000)){
+            if ((pos + 1) > GOEP_SERVER_MAX_NAME_LEN) break;
+            // skip low surrogate
+            if (c < 0xdc00){
+                i += 2;
+            }
+            buffer[pos++] = '?';
+        } else {
+            if ((pos + 3) > GOEP_SERVER_MAX_NAME_LEN) break;
+            buffer[pos++] = (uint8_t) (0xe0 | (c >> 12));
+            buffer[pos++] = (uint8_t) (0x80 | ((c >> 6) & 0x3f));
+            buffer[pos++] = (uint8_t) (0x80 | (c & 0x3f));
+        }
+    }
+    return pos;
+}
+
+// store name as J+V field
+static uint16_t goep_server_event_add_name(uint8_t * event, uint16_t pos, const goep_server_request_t * request){
+    uint16_t len = goep_server_store_name(&event[pos + 1], request->name, request->name_len);
+    event[pos] = (uint8_t) len;
+    return pos + 1 + len;
+}
+
+// store type as J+V field, Type header is a null-terminated ASCII string
+static uint16_t goep_server_event_add_type(uint8_t * event, uint16_t pos, const goep_server_request_t * request){
+    uint16_t len = request->type_len;
+    if ((len > 0) && (request->type[len - 1] == 0)){
+        len--;
+    }
+    len = btstack_min(len, GOEP_SERVER_MAX_TYPE_LEN);
+    event[pos++] = (uint8_t) len;
+    if (len > 0){
+        (void)memcpy(&event[pos], request->type, len);
+    }
+    return pos + len;
+}
+
+// emit request event, returns response code if rejected by the application or 0 if accepted
+static uint8_t goep_server_emit_request_event(goep_server_connection_t * connection, uint8_t * event, uint16_t size){
+    event[1] = size - 2;
+    connection->in_request_event = true;
+    connection->request_subevent = event[2];
+    connection->reject_code = 0;
+    (*connection->service->packet_handler)(HCI_EVENT_PACKET, connection->cid, event, size);
+    connection->in_request_event = false;
+    return connection->reject_code;
+}
+
+static uint16_t goep_server_request_event_init(goep_server_connection_t * connection, uint8_t * event, uint8_t subevent){
+    event[0] = HCI_EVENT_GOEP_META;
+    event[2] = subevent;
+    little_endian_store_16(event, 3, connection->cid);
+    return 5;
+}
+
+static void goep_server_parse_request(goep_server_request_t * request, const uint8_t * packet, uint16_t size){
+    memset(request, 0, sizeof(goep_server_request_t));
+    request->srm  = OBEX_SRM_DISABLE;
+    request->srmp = OBEX_SRMP_NEXT;
+    obex_iterator_t it;
+    for (obex_iterator_init_with_request_packet(&it, packet, size); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+        switch (obex_iterator_get_hi(&it)){
+            case OBEX_HEADER_NAME:
+                request->name = obex_iterator_get_data(&it);
+                request->name_len = (uint16_t) obex_iterator_get_data_len(&it);
+                request->name_present = true;
+                break;
+            case OBEX_HEADER_TYPE:
+                request->type = obex_iterator_get_data(&it);
+                request->type_len = (uint16_t) obex_iterator_get_data_len(&it);
+                break;
+            case OBEX_HEADER_TARGET:
+                request->target = obex_iterator_get_data(&it);
+                request->target_len = (uint16_t) obex_iterator_get_data_len(&it);
+                break;
+            case OBEX_HEADER_LENGTH:
+                request->length = obex_iterator_get_data_32(&it);
+                break;
+            case OBEX_HEADER_BODY:
+            case OBEX_HEADER_END_OF_BODY:
+                request->body_present = true;
+                break;
+            case OBEX_HEADER_SINGLE_RESPONSE_MODE:
+                request->srm = obex_iterator_get_data_8(&it);
+                break;
+            case OBEX_HEADER_SINGLE_RESPONSE_MODE_PARAMETER:
+                request->srmp = obex_iterator_get_data_8(&it);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void goep_server_request_can_send_now(goep_server_connection_t * connection){
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        l2cap_request_can_send_now_event(connection->bearer_cid);
+        return;
+    }
+#endif
+    rfcomm_request_can_send_now_event(connection->bearer_cid);
+}
+
+static void goep_server_respond(goep_server_connection_t * connection, uint8_t response_code){
+    connection->response_code = response_code;
+    goep_server_request_can_send_now(connection);
+}
+
+static void goep_server_finalize_transfer(goep_server_connection_t * connection, uint8_t status){
+    goep_server_transfer_t transfer = connection->transfer;
+    connection->transfer = GOEP_SERVER_TRANSFER_IDLE;
+    connection->srm_active = false;
+    connection->srm_wait = false;
+    connection->response_srm_enable = false;
+    connection->response_get_body = false;
+    switch (transfer){
+        case GOEP_SERVER_TRANSFER_PUT:
+            goep_server_emit_completed_event(connection, GOEP_SUBEVENT_PUT_COMPLETED, status);
+            break;
+        case GOEP_SERVER_TRANSFER_GET_REQUEST:
+        case GOEP_SERVER_TRANSFER_GET:
+            goep_server_emit_completed_event(connection, GOEP_SUBEVENT_GET_COMPLETED, status);
+            break;
+        default:
+            break;
+    }
+}
+
+static void goep_server_handle_connect(goep_server_connection_t * connection, const uint8_t * packet, uint16_t size){
+    if (size < 7){
+        goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+        return;
+    }
+    goep_server_request_t request;
+    goep_server_parse_request(&request, packet, size);
+
+    connection->response_connect = true;
+    goep_server_service_t * service = connection->service;
+    if (service->target != NULL){
+        if ((request.target_len != service->target_len) || (memcmp(request.target, service->target, service->target_len) != 0)){
+            log_info("goep_server: target missing or not supported");
+            goep_server_respond(connection, OBEX_RESP_SERVICE_UNAVAILABLE);
+            return;
+        }
+        // Connection ID identifies the target service
+        connection->obex_connection_id = connection->cid;
+    }
+
+    uint16_t max_packet_len = btstack_min(big_endian_read_16(packet, 5), connection->bearer_mtu);
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        max_packet_len = btstack_min(max_packet_len, sizeof(connection->l2cap_packet_buffer));
+    }
+#endif
+    connection->obex_max_packet_len = max_packet_len;
+    connection->obex_connected = true;
+    log_info("goep_server: OBEX connected, max packet len %u", max_packet_len);
+    goep_server_respond(connection, OBEX_RESP_SUCCESS);
+}
+
+static void goep_server_handle_put(goep_server_connection_t * connection, const uint8_t * packet, uint16_t size){
+    bool final = (packet[0] & OBEX_OPCODE_FINAL_BIT_MASK) != 0;
+    goep_server_request_t request;
+    goep_server_parse_request(&request, packet, size);
+
+    switch (connection->transfer){
+        case GOEP_SERVER_TRANSFER_PUT:
+            break;
+        case GOEP_SERVER_TRANSFER_PUT_REJECTED:
+            // drop remaining packets of rejected PUT, new PUT starts with Name or Type header
+            if ((request.name_present == false) && (request.type == NULL)){
+                if (final){
+                    connection->transfer = GOEP_SERVER_TRANSFER_IDLE;
+                }
+                if (connection->reject_code != 0){
+                    goep_server_respond(connection, connection->reject_code);
+                    connection->reject_code = 0;
+                }
+                return;
+            }
+            connection->transfer = GOEP_SERVER_TRANSFER_IDLE;
+            break;
+        default:
+            goep_server_finalize_transfer(connection, OBEX_ABORTED);
+            break;
+    }
+
+    uint8_t event[5 + 4 + 1 + GOEP_SERVER_MAX_NAME_LEN + 1 + GOEP_SERVER_MAX_TYPE_LEN];
+    uint16_t pos;
+    uint8_t reject_code;
+    if (connection->transfer == GOEP_SERVER_TRANSFER_IDLE){
+        uint8_t operations = connection->service->operations;
+
+        // PUT without body is a Delete request
+        if (final && (request.body_present == false)){
+            if ((operations & GOEP_SERVER_OPERATION_DELETE) == 0){
+                goep_server_respond(connection, OBEX_RESP_NOT_IMPLEMENTED);
+                return;
+            }
+            pos = goep_server_request_event_init(connection, event, GOEP_SUBEVENT_DELETE_REQUEST);
+            pos = goep_server_event_add_name(event, pos, &request);
+            reject_code = goep_server_emit_request_event(connection, event, pos);
+            goep_server_respond(connection, (reject_code != 0) ? reject_code : OBEX_RESP_SUCCESS);
+            return;
+        }
+
+        if ((operations & GOEP_SERVER_OPERATION_PUT) == 0){
+            connection->transfer = final ? GOEP_SERVER_TRANSFER_IDLE : GOEP_SERVER_TRANSFER_PUT_REJECTED;
+            goep_server_respond(connection, OBEX_RESP_NOT_IMPLEMENTED);
+            return;
+        }
+
+        pos = goep_server_request_event_init(connection, event, GOEP_SUBEVENT_PUT_REQUEST);
+        little_endian_store_32(event, pos, request.length);
+        pos += 4;
+        pos = goep_server_event_add_name(event, pos, &request);
+        pos = goep_server_event_add_type(event, pos, &request);
+        reject_code = goep_server_emit_request_event(connection, event, pos);
+        if (reject_code != 0){
+            connection->reject_code = 0;
+            connection->transfer = final ? GOEP_SERVER_TRANSFER_IDLE : GOEP_SERVER_TRANSFER_PUT_REJECTED;
+            goep_server_respond(connection, reject_code);
+            return;
+        }
+
+        connection->transfer = GOEP_SERVER_TRANSFER_PUT;
+        if ((request.srm == OBEX_SRM_ENABLE) && !final){
+            connection->srm_active = true;
+            connection->response_srm_enable = true;
+        }
+    }
+
+    // deliver object data, application might reject PUT while handling data
+    obex_iterator_t it;
+    for (obex_iterator_init_with_request_packet(&it, packet, size); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+        uint8_t hi = obex_iterator_get_hi(&it);
+        if ((hi != OBEX_HEADER_BODY) && (hi != OBEX_HEADER_END_OF_BODY)) continue;
+        uint16_t data_len = (uint16_t) obex_iterator_get_data_len(&it);
+        if (data_len == 0) continue;
+        (*connection->service->packet_handler)(GOEP_DATA_PACKET, connection->cid, (uint8_t *) obex_iterator_get_data(&it), data_len);
+        if (connection->transfer != GOEP_SERVER_TRANSFER_PUT){
+            // rejected without SRM, answer current request
+            if (connection->reject_code != 0){
+                goep_server_respond(connection, connection->reject_code);
+                connection->reject_code = 0;
+            }
+            if (final){
+                connection->transfer = GOEP_SERVER_TRANSFER_IDLE;
+            }
+            return;
+        }
+    }
+
+    if (final){
+        goep_server_finalize_transfer(connection, ERROR_CODE_SUCCESS);
+        goep_server_respond(connection, OBEX_RESP_SUCCESS);
+        return;
+    }
+
+    // with SRM, only the first request gets a response
+    if (connection->srm_active && (connection->response_srm_enable == false)) return;
+    goep_server_respond(connection, OBEX_RESP_CONTINUE);
+}
+
+static void goep_server_handle_get(goep_server_connection_t * connection, const uint8_t * packet, uint16_t size){
+    bool final = (packet[0] & OBEX_OPCODE_FINAL_BIT_MASK) != 0;
+    goep_server_request_t request;
+    goep_server_parse_request(&request, packet, size);
+
+    switch (connection->transfer){
+        case GOEP_SERVER_TRANSFER_GET:
+            // next GET request without SRM or while client requested SRM wait: send one response,
+            // without SRMP Wait, streaming continues
+            connection->srm_wait = request.srmp == OBEX_SRMP_WAIT;
+            if (connection->response_get_body) return;
+            connection->response_get_body = true;
+            goep_server_request_can_send_now(connection);
+            return;
+        case GOEP_SERVER_TRANSFER_GET_REQUEST:
+            if (final){
+                connection->transfer = GOEP_SERVER_TRANSFER_GET;
+                connection->srm_wait = request.srmp == OBEX_SRMP_WAIT;
+                connection->response_get_body = true;
+                goep_server_request_can_send_now(connection);
+            } else {
+                goep_server_respond(connection, OBEX_RESP_CONTINUE);
+            }
+            return;
+        case GOEP_SERVER_TRANSFER_IDLE:
+            break;
+        default:
+            goep_server_finalize_transfer(connection, OBEX_ABORTED);
+            break;
+    }
+
+    if ((connection->service->operations & GOEP_SERVER_OPERATION_GET) == 0){
+        goep_server_respond(connection, OBEX_RESP_NOT_IMPLEMENTED);
+        return;
+    }
+
+    uint8_t event[5 + 1 + GOEP_SERVER_MAX_NAME_LEN + 1 + GOEP_SERVER_MAX_TYPE_LEN];
+    uint16_t pos = goep_server_request_event_init(connection, event, GOEP_SUBEVENT_GET_REQUEST);
+    pos = goep_server_event_add_name(event, pos, &request);
+    pos = goep_server_event_add_type(event, pos, &request);
+    connection->get_callback = NULL;
+    uint8_t reject_code = goep_server_emit_request_event(connection, event, pos);
+    if ((reject_code != 0) || (connection->get_callback == NULL)){
+        goep_server_respond(connection, (reject_code != 0) ? reject_code : OBEX_RESP_NOT_FOUND);
+        return;
+    }
+
+    connection->get_offset = 0;
+    connection->srm_active = request.srm == OBEX_SRM_ENABLE;
+    connection->response_srm_enable = connection->srm_active;
+    if (final){
+        connection->transfer = GOEP_SERVER_TRANSFER_GET;
+        connection->srm_wait = request.srmp == OBEX_SRMP_WAIT;
+        connection->response_get_body = true;
+        goep_server_request_can_send_now(connection);
+    } else {
+        connection->transfer = GOEP_SERVER_TRANSFER_GET_REQUEST;
+        goep_server_respond(connection, OBEX_RESP_CONTINUE);
+    }
+}
+
+static void goep_server_handle_set_path(goep_server_connection_t * connection, const uint8_t * packet, uint16_t size){
+    if (size < 5){
+        goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+        return;
+    }
+    if ((connection->service->operations & GOEP_SERVER_OPERATION_SET_PATH) == 0){
+        goep_server_respond(connection, OBEX_RESP_NOT_IMPLEMENTED);
+        return;
+    }
+    goep_server_request_t request;
+    goep_server_parse_request(&request, packet, size);
+    uint8_t event[5 + 1 + 1 + GOEP_SERVER_MAX_NAME_LEN];
+    uint16_t pos = goep_server_request_event_init(connection, event, GOEP_SUBEVENT_SET_PATH_REQUEST);
+    event[pos++] = packet[3];
+    pos = goep_server_event_add_name(event, pos, &request);
+    uint8_t reject_code = goep_server_emit_request_event(connection, event, pos);
+    goep_server_respond(connection, (reject_code != 0) ? reject_code : OBEX_RESP_SUCCESS);
+}
+
+static void goep_server_handle_request(goep_server_connection_t * connection, const uint8_t * packet, uint16_t size){
+    if (size < OBEX_PACKET_HEADER_SIZE) return;
+    if (big_endian_read_16(packet, OBEX_PACKET_LENGTH_OFFSET) != size){
+        log_info("goep_server: OBEX packet length %u != %u", big_endian_read_16(packet, OBEX_PACKET_LENGTH_OFFSET), size);
+        goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+        return;
+    }
+
+    uint8_t opcode = packet[OBEX_PACKET_OPCODE_OFFSET];
+    if ((opcode != OBEX_OPCODE_CONNECT) && (connection->obex_connected == false)){
+        goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+        return;
+    }
+
+    switch (opcode){
+        case OBEX_OPCODE_CONNECT:
+            goep_server_handle_connect(connection, packet, size);
+            break;
+        case OBEX_OPCODE_DISCONNECT:
+            goep_server_finalize_transfer(connection, OBEX_DISCONNECTED);
+            connection->obex_connected = false;
+            goep_server_respond(connection, OBEX_RESP_SUCCESS);
+            break;
+        case OBEX_OPCODE_PUT:
+        case OBEX_OPCODE_PUT | OBEX_OPCODE_FINAL_BIT_MASK:
+            goep_server_handle_put(connection, packet, size);
+            break;
+        case OBEX_OPCODE_GET:
+        case OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK:
+            goep_server_handle_get(connection, packet, size);
+            break;
+        case OBEX_OPCODE_SETPATH:
+            goep_server_handle_set_path(connection, packet, size);
+            break;
+        case OBEX_OPCODE_ABORT:
+            goep_server_finalize_transfer(connection, OBEX_ABORTED);
+            goep_server_respond(connection, OBEX_RESP_SUCCESS);
+            break;
+        default:
+            goep_server_respond(connection, OBEX_RESP_NOT_IMPLEMENTED);
+            break;
+    }
+}
+
+// RFCOMM provides a byte stream, OBEX packets are handled in place if complete and reassembled otherwise
+static void goep_server_handle_rfcomm_data(goep_server_connection_t * connection, const uint8_t * data, uint16_t size){
+    while (size > 0u){
+        // drop remaining bytes of packet that does not fit into reassembly buffer
+        if (connection->rfcomm_packet_skip > 0u){
+            uint16_t bytes_to_skip = btstack_min(size, connection->rfcomm_packet_skip);
+            connection->rfcomm_packet_skip -= bytes_to_skip;
+            data += bytes_to_skip;
+            size -= bytes_to_skip;
+            if (connection->rfcomm_packet_skip == 0u){
+                goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+            }
+            continue;
+        }
+
+        // complete packet at start of data
+        if ((connection->rfcomm_packet_pos == 0u) && (size >= OBEX_PACKET_HEADER_SIZE)){
+            uint16_t packet_len = big_endian_read_16(data, OBEX_PACKET_LENGTH_OFFSET);
+            if ((packet_len >= OBEX_PACKET_HEADER_SIZE) && (packet_len <= size)){
+                goep_server_handle_request(connection, data, packet_len);
+                data += packet_len;
+                size -= packet_len;
+                continue;
+            }
+        }
+
+        // collect header, then rest of packet
+        uint16_t packet_len = OBEX_PACKET_HEADER_SIZE;
+        if (connection->rfcomm_packet_pos >= OBEX_PACKET_HEADER_SIZE){
+            packet_len = big_endian_read_16(connection->rfcomm_packet_buffer, OBEX_PACKET_LENGTH_OFFSET);
+        }
+        uint16_t bytes_to_copy = btstack_min(size, packet_len - connection->rfcomm_packet_pos);
+        (void)memcpy(&connection->rfcomm_packet_buffer[connection->rfcomm_packet_pos], data, bytes_to_copy);
+        connection->rfcomm_packet_pos += bytes_to_copy;
+        data += bytes_to_copy;
+        size -= bytes_to_copy;
+        if (connection->rfcomm_packet_pos < OBEX_PACKET_HEADER_SIZE) break;
+
+        packet_len = big_endian_read_16(connection->rfcomm_packet_buffer, OBEX_PACKET_LENGTH_OFFSET);
+        if (packet_len < OBEX_PACKET_HEADER_SIZE){
+            // packet boundaries are lost, drop received data
+            log_info("goep_server: invalid OBEX packet length %u", packet_len);
+            connection->rfcomm_packet_pos = 0;
+            goep_server_respond(connection, OBEX_RESP_BAD_REQUEST);
+            break;
+        }
+        if (packet_len > sizeof(connection->rfcomm_packet_buffer)){
+            log_info("goep_server: OBEX packet length %u exceeds buffer", packet_len);
+            connection->rfcomm_packet_skip = packet_len - connection->rfcomm_packet_pos;
+            connection->rfcomm_packet_pos = 0;
+            continue;
+        }
+        if (connection->rfcomm_packet_pos < packet_len) continue;
+
+        connection->rfcomm_packet_pos = 0;
+        goep_server_handle_request(connection, connection->rfcomm_packet_buffer, packet_len);
+    }
+}
+
+static uint16_t goep_server_max_receive_packet_len(goep_server_connection_t * connection){
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        return connection->bearer_mtu;
+    }
+#endif
+    return sizeof(connection->rfcomm_packet_buffer);
+}
+
+static uint8_t * goep_server_get_outgoing_buffer(goep_server_connection_t * connection, uint16_t * out_buffer_len){
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        *out_buffer_len = btstack_min(sizeof(connection->l2cap_packet_buffer), connection->bearer_mtu);
+        return connection->l2cap_packet_buffer;
+    }
+#endif
+    rfcomm_reserve_packet_buffer();
+    *out_buffer_len = connection->bearer_mtu;
+    return rfcomm_get_outgoing_buffer();
+}
+
+static void goep_server_send(goep_server_connection_t * connection, uint16_t len){
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        l2cap_send(connection->bearer_cid, connection->l2cap_packet_buffer, len);
+        return;
+    }
+#endif
+    rfcomm_send_prepared(connection->bearer_cid, len);
+}
+
+static uint16_t goep_server_build_get_response(goep_server_connection_t * connection, uint8_t * buffer, uint16_t buffer_len){
+    buffer_len = btstack_min(buffer_len, connection->obex_max_packet_len);
+    (void) obex_message_builder_response_create_general(buffer, buffer_len, OBEX_RESP_CONTINUE);
+    if (connection->response_srm_enable){
+        connection->response_srm_enable = false;
+        (void) obex_message_builder_header_add_srm_enable(buffer, buffer_len);
+    }
+    if (connection->get_offset == 0){
+        (void) obex_message_builder_header_add_word(buffer, buffer_len, OBEX_HEADER_LENGTH, connection->get_object_len);
+    }
+
+    // BODY header followed by object data provided by callback
+    uint16_t pos = big_endian_read_16(buffer, OBEX_PACKET_LENGTH_OFFSET);
+    uint16_t max_data_len = buffer_len - pos - 3;
+    uint32_t remaining = connection->get_object_len - connection->get_offset;
+    uint16_t data_len = (uint16_t) btstack_min(max_data_len, remaining);
+    uint16_t stored = (*connection->get_callback)(connection->cid, connection->get_offset, &buffer[pos + 3], data_len);
+    stored = btstack_min(stored, data_len);
+    connection->get_offset += stored;
+    bool done = (connection->get_offset >= connection->get_object_len) || (stored < data_len);
+    buffer[pos] = done ? OBEX_HEADER_END_OF_BODY : OBEX_HEADER_BODY;
+    big_endian_store_16(buffer, pos + 1, stored + 3);
+    pos += stored + 3;
+    big_endian_store_16(buffer, OBEX_PACKET_LENGTH_OFFSET, pos);
+    if (done){
+        buffer[OBEX_PACKET_OPCODE_OFFSET] = OBEX_RESP_SUCCESS;
+    }
+    return pos;
+}
+
+static void goep_server_handle_can_send_now(goep_server_connection_t * connection){
+    if ((connection->response_code == 0) && (connection->response_get_body == false)) return;
+
+    uint16_t buffer_len;
+    uint8_t * buffer = goep_server_get_outgoing_buffer(connection, &buffer_len);
+    uint16_t len;
+
+    if (connection->response_code != 0){
+        uint8_t response_code = connection->response_code;
+        connection->response_code = 0;
+        if (connection->response_connect){
+            connection->response_connect = false;
+            uint32_t connection_id = (response_code == OBEX_RESP_SUCCESS) ? connection->obex_connection_id : OBEX_CONNECTION_ID_INVALID;
+            (void) obex_message_builder_response_create_connect(buffer, buffer_len, OBEX_VERSION, 0, goep_server_max_receive_packet_len(connection), connection_id);
+            buffer[OBEX_PACKET_OPCODE_OFFSET] = response_code;
+            if (connection_id != OBEX_CONNECTION_ID_INVALID){
+                (void) obex_message_builder_header_add_variable(buffer, buffer_len, OBEX_HEADER_WHO, connection->service->target, connection->service->target_len);
+            }
+        } else {
+            (void) obex_message_builder_response_create_general(buffer, buffer_len, response_code);
+            if ((response_code == OBEX_RESP_CONTINUE) && connection->response_srm_enable){
+                connection->response_srm_enable = false;
+                (void) obex_message_builder_header_add_srm_enable(buffer, buffer_len);
+            }
+        }
+        len = big_endian_read_16(buffer, OBEX_PACKET_LENGTH_OFFSET);
+        goep_server_send(connection, len);
+    } else {
+        len = goep_server_build_get_response(connection, buffer, buffer_len);
+        bool done = buffer[OBEX_PACKET_OPCODE_OFFSET] == OBEX_RESP_SUCCESS;
+        goep_server_send(connection, len);
+        if (done){
+            goep_server_finalize_transfer(connection, ERROR_CODE_SUCCESS);
+        } else if (connection->srm_active && (connection->srm_wait == false)){
+            // stream next response
+        } else {
+            // wait for next GET request
+            connection->response_get_body = false;
+        }
+    }
+
+    if ((connection->response_code != 0) || connection->response_get_body){
+        goep_server_request_can_send_now(connection);
+    }
+}
+
+static void goep_server_handle_connection_opened(goep_server_connection_t * connection, uint8_t status, uint16_t mtu){
+    if (status != ERROR_CODE_SUCCESS){
+        log_info("goep_server: open failed, status %u", status);
+        connection->state = GOEP_SERVER_IDLE;
+        return;
+    }
+    connection->state = GOEP_SERVER_CONNECTED;
+    connection->bearer_mtu = mtu;
+    log_info("goep_server: connection opened. cid %u, max frame size %u", connection->bearer_cid, connection->bearer_mtu);
+    goep_server_emit_connected_event(connection, ERROR_CODE_SUCCESS);
+}
+
+static void goep_server_handle_connection_closed(goep_server_connection_t * connection){
+    if (connection->state != GOEP_SERVER_CONNECTED){
+        connection->state = GOEP_SERVER_IDLE;
+        return;
+    }
+    goep_server_finalize_transfer(connection, OBEX_DISCONNECTED);
+    connection->state = GOEP_SERVER_IDLE;
+    goep_server_emit_event(connection, GOEP_SUBEVENT_CONNECTION_CLOSED);
+}
+
+static void goep_server_handle_incoming_connection(goep_server_service_t * service, bool l2cap_bearer, uint16_t bearer_cid,
+                                                   const bd_addr_t bd_addr, hci_con_handle_t con_handle){
+    goep_server_connection_t * connection = NULL;
+    if (service != NULL){
+        connection = goep_server_create_connection(service, l2cap_bearer, bearer_cid, bd_addr, con_handle);
+    }
+#ifdef ENABLE_GOEP_L2CAP
+    if (l2cap_bearer){
+        if (connection == NULL){
+            l2cap_decline_connection(bearer_cid);
+            return;
+        }
+        connection->ertm_config.ertm_mandatory = 1;
+        connection->ertm_config.max_transmit = 2;
+        connection->ertm_config.retransmission_timeout_ms = 2000;
+        connection->ertm_config.monitor_timeout_ms = 12000;
+        connection->ertm_config.local_mtu = GOEP_SERVER_ERTM_MTU;
+        connection->ertm_config.num_tx_buffers = GOEP_SERVER_ERTM_NUM_BUFFERS;
+        connection->ertm_config.num_rx_buffers = GOEP_SERVER_ERTM_NUM_BUFFERS;
+        connection->ertm_config.fcs_option = 0;    // No FCS
+        uint8_t status = l2cap_accept_ertm_connection(bearer_cid, &connection->ertm_config, connection->ertm_buffer, sizeof(connection->ertm_buffer));
+        if (status != ERROR_CODE_SUCCESS){
+            log_info("goep_server: accept ERTM connection failed, status 0x%02x", status);
+            connection->state = GOEP_SERVER_IDLE;
+            l2cap_decline_connection(bearer_cid);
+        }
+        return;
+    }
+#endif
+    if (connection == NULL){
+        rfcomm_decline_connection(bearer_cid);
+        return;
+    }
+    rfcomm_accept_connection(bearer_cid);
+}
+
+static void goep_server_handle_hci_event(uint8_t * packet){
+    goep_server_connection_t * connection;
+    bd_addr_t bd_addr;
+    switch (hci_event_packet_get_type(packet)) {
+#ifdef ENABLE_GOEP_L2CAP
+        case L2CAP_EVENT_INCOMING_CONNECTION:
+            l2cap_event_incoming_connection_get_address(packet, bd_addr);
+            goep_server_handle_incoming_connection(goep_server_service_for_l2cap_psm(l2cap_event_incoming_connection_get_psm(packet)),
+                true, l2cap_event_incoming_connection_get_local_cid(packet), bd_addr, l2cap_event_incoming_connection_get_handle(packet));
+            break;
+        case L2CAP_EVENT_CHANNEL_OPENED:
+            connection = goep_server_connection_for_bearer_cid(l2cap_event_channel_opened_get_local_cid(packet), true);
+            if (connection == NULL) break;
+            goep_server_handle_connection_opened(connection, l2cap_event_channel_opened_get_status(packet),
+                btstack_min(l2cap_event_channel_opened_get_remote_mtu(packet), l2cap_event_channel_opened_get_local_mtu(packet)));
+            break;
+        case L2CAP_EVENT_CAN_SEND_NOW:
+            connection = goep_server_connection_for_bearer_cid(l2cap_event_can_send_now_get_local_cid(packet), true);
+            if (connection == NULL) break;
+            goep_server_handle_can_send_now(connection);
+            break;
+        case L2CAP_EVENT_CHANNEL_CLOSED:
+            connection = goep_server_connection_for_bearer_cid(l2cap_event_channel_closed_get_local_cid(packet), true);
+            if (connection == NULL) break;
+            goep_server_handle_connection_closed(connection);
+            break;
+#endif
+        case RFCOMM_EVENT_INCOMING_CONNECTION:
+            rfcomm_event_incoming_connection_get_bd_addr(packet, bd_addr);
+            goep_server_handle_incoming_connection(goep_server_service_for_rfcomm_channel(rfcomm_event_incoming_connection_get_server_channel(packet)),
+                false, rfcomm_event_incoming_connection_get_rfcomm_cid(packet), bd_addr, HCI_CON_HANDLE_INVALID);
+            break;
+        case RFCOMM_EVENT_CHANNEL_OPENED:
+            connection = goep_server_connection_for_bearer_cid(rfcomm_event_channel_opened_get_rfcomm_cid(packet), false);
+            if (connection == NULL) break;
+            connection->con_handle = rfcomm_event_channel_opened_get_con_handle(packet);
+            goep_server_handle_connection_opened(connection, rfcomm_event_channel_opened_get_status(packet),
+                rfcomm_event_channel_opened_get_max_frame_size(packet));
+            break;
+        case RFCOMM_EVENT_CAN_SEND_NOW:
+            connection = goep_server_connection_for_bearer_cid(rfcomm_event_can_send_now_get_rfcomm_cid(packet), false);
+            if (connection == NULL) break;
+            goep_server_handle_can_send_now(connection);
+            break;
+        case RFCOMM_EVENT_CHANNEL_CLOSED:
+            connection = goep_server_connection_for_bearer_cid(rfcomm_event_channel_closed_get_rfcomm_cid(packet), false);
+            if (connection == NULL) break;
+            goep_server_handle_connection_closed(connection);
+            break;
+        default:
+            break;
+    }
+}
+
+static void goep_server_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    goep_server_connection_t * connection;
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            goep_server_handle_hci_event(packet);
+            break;
+        case L2CAP_DATA_PACKET:
+        case RFCOMM_DATA_PACKET:
+            connection = goep_server_connection_for_bearer_cid(channel, packet_type == L2CAP_DATA_PACKET);
+            if (connection == NULL) break;
+            if (connection->state != GOEP_SERVER_CONNECTED) break;
+            if (packet_type == RFCOMM_DATA_PACKET){
+                goep_server_handle_rfcomm_data(connection, packet, size);
+            } else {
+                goep_server_handle_request(connection, packet, size);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void goep_server_init(void){
+    memset(goep_server_services, 0, sizeof(goep_server_services));
+    memset(goep_server_connections, 0, sizeof(goep_server_connections));
+    goep_server_cid_counter = 0;
+}
+
+uint8_t goep_server_register_service(btstack_packet_handler_t packet_handler, uint8_t rfcomm_channel, uint16_t l2cap_psm,
+                                     gap_security_level_t security_level, const uint8_t * target, uint16_t target_len, uint8_t operations){
+#ifndef ENABLE_GOEP_L2CAP
+    if (l2cap_psm != 0) return ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE;
+#endif
+    if ((rfcomm_channel == 0) && (l2cap_psm == 0)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    if ((rfcomm_channel != 0) && (goep_server_service_for_rfcomm_channel(rfcomm_channel) != NULL)) return RFCOMM_CHANNEL_ALREADY_REGISTERED;
+#ifdef ENABLE_GOEP_L2CAP
+    if ((l2cap_psm != 0) && (goep_server_service_for_l2cap_psm(l2cap_psm) != NULL)) return L2CAP_SERVICE_ALREADY_REGISTERED;
+#endif
+
+    goep_server_service_t * service = NULL;
+    int i;
+    for (i=0;i<MAX_NR_GOEP_SERVER_SERVICES;i++){
+        if (goep_server_services[i].packet_handler != NULL) continue;
+        service = &goep_server_services[i];
+        break;
+    }
+    if (service == NULL) return BTSTACK_MEMORY_ALLOC_FAILED;
+
+    uint8_t status;
+    if (rfcomm_channel != 0){
+        status = rfcomm_register_service(&goep_server_packet_handler, rfcomm_channel, 0xffff);
+        if (status != ERROR_CODE_SUCCESS) return status;
+    }
+#ifdef ENABLE_GOEP_L2CAP
+    if (l2cap_psm != 0){
+        status = l2cap_register_service(&goep_server_packet_handler, l2cap_psm, GOEP_SERVER_ERTM_MTU, security_level);
+        if (status != ERROR_CODE_SUCCESS){
+            if (rfcomm_channel != 0){
+                rfcomm_unregister_service(rfcomm_channel);
+            }
+            return status;
+        }
+    }
+#else
+    UNUSED(security_level);
+#endif
+
+    service->packet_handler = packet_handler;
+    service->rfcomm_channel = rfcomm_channel;
+    service->l2cap_psm = l2cap_psm;
+    service->target = target;
+    service->target_len = target_len;
+    service->operations = operations;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t goep_server_reject_request(uint16_t goep_cid, uint8_t response_code){
+    goep_server_connection_t * connection = goep_server_connection_for_cid(goep_cid);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (connection->in_request_event){
+        connection->reject_code = response_code;
+        return ERROR_CODE_SUCCESS;
+    }
+    if (connection->transfer != GOEP_SERVER_TRANSFER_PUT) return ERROR_CODE_COMMAND_DISALLOWED;
+
+    // stop ongoing PUT. With SRM, the response can be sent right away, otherwise it is sent for the next request
+    connection->transfer = GOEP_SERVER_TRANSFER_PUT_REJECTED;
+    if (connection->srm_active){
+        connection->srm_active = false;
+        connection->response_srm_enable = false;
+        connection->reject_code = 0;
+        goep_server_respond(connection, response_code);
+    } else {
+        connection->reject_code = response_code;
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t goep_server_accept_get(uint16_t goep_cid, uint32_t object_len, goep_server_get_callback_t callback){
+    goep_server_connection_t * connection = goep_server_connection_for_cid(goep_cid);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if ((connection->in_request_event == false) || (connection->request_subevent != GOEP_SUBEVENT_GET_REQUEST)) return ERROR_CODE_COMMAND_DISALLOWED;
+    if (callback == NULL) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    connection->get_object_len = object_len;
+    connection->get_callback = callback;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint16_t goep_server_get_max_packet_len(uint16_t goep_cid){
+    goep_server_connection_t * connection = goep_server_connection_for_cid(goep_cid);
+    if (connection == NULL) return 0;
+    if (connection->obex_connected == false) return 0;
+    return connection->obex_max_packet_len;
+}
+
+bool goep_server_srm_active(uint16_t goep_cid){
+    goep_server_connection_t * connection = goep_server_connection_for_cid(goep_cid);
+    if (connection == NULL) return false;
+    return connection->srm_active;
+}
+
+uint8_t goep_server_disconnect(uint16_t goep_cid){
+    goep_server_connection_t * connection = goep_server_connection_for_cid(goep_cid);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (connection->state != GOEP_SERVER_CONNECTED) return ERROR_CODE_COMMAND_DISALLOWED;
+#ifdef ENABLE_GOEP_L2CAP
+    if (connection->l2cap_bearer){
+        l2cap_disconnect(connection->bearer_cid, 0);
+        return ERROR_CODE_SUCCESS;
+    }
+#endif
+    rfcomm_disconnect(connection->bearer_cid);
+    return ERROR_CODE_SUCCESS;
+}
+
+void goep_server_deinit(void){
+    memset(goep_server_services, 0, sizeof(goep_server_services));
+    memset(goep_server_connections, 0, sizeof(goep_server_connections));
+    goep_server_cid_counter = 0;
+}
+
+void goep_server_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint16_t service_class_uuid, uint16_t profile_version,
+                                   uint8_t rfcomm_channel, uint16_t l2cap_psm, const char * name){
+    uint8_t* attribute;
+    de_create_sequence(service);
+
+    // 0x0000 "Service Record Handle"
+    de_add_number(service, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SERVICE_RECORD_HANDLE);
+    de_add_number(service, DE_UINT, DE_SIZE_32, service_record_handle);
+
+    // 0x0001 "Service Class ID List"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SERVICE_CLASS_ID_LIST);
+    attribute = de_push_sequence(service);
+    {
+        de_add_number(attribute,  DE_UUID, DE_SIZE_16, service_class_uuid);
+    }
+    de_pop_sequence(service, attribute);
+
+    // 0x0004 "Protocol Descriptor List"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PROTOCOL_DESCRIPTOR_LIST);
+    attribute = de_push_sequence(service);
+    {
+        uint8_t* l2cpProtocol = de_push_sequence(attribute);
+        {
+            de_add_number(l2cpProtocol,  DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+        }
+        de_pop_sequence(attribute, l2cpProtocol);
+
+        uint8_t* rfcomm = de_push_sequence(attribute);
+        {
+            de_add_number(rfcomm,  DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_RFCOMM);
+            de_add_number(rfcomm,  DE_UINT, DE_SIZE_8,  rfcomm_channel);
+        }
+        de_pop_sequence(attribute, rfcomm);
+
+        uint8_t* obex = de_push_sequence(attribute);
+        {
+            de_add_number(obex,  DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_OBEX);
+        }
+        de_pop_sequence(attribute, obex);
+    }
+    de_pop_sequence(service, attribute);
+
+    // 0x0005 "Public Browse Group"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_BROWSE_GROUP_LIST);
+    attribute = de_push_sequence(service);
+    {
+        de_add_number(attribute,  DE_UUID, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PUBLIC_BROWSE_ROOT );
+    }
+    de_pop_sequence(service, attribute);
+
+    // 0x0009 "Bluetooth Profile Descriptor List"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_BLUETOOTH_PROFILE_DESCRIPTOR_LIST);
+    attribute = de_push_sequence(service);
+    {
+        uint8_t *profile = de_push_sequence(attribute);
+        {
+            de_add_number(profile,  DE_UUID, DE_SIZE_16, service_class_uuid);
+            de_add_number(profile,  DE_UINT, DE_SIZE_16, profile_version);
+        }
+        de_pop_sequence(attribute, profile);
+    }
+    de_pop_sequence(service, attribute);
+
+    // 0x0100 "Service Name"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, 0x0100);
+    de_add_data(service,  DE_STRING, (uint16_t) strlen(name), (uint8_t *) name);
+
+    // 0x0200 "GOEP L2CAP PSM"
+    if (l2cap_psm != 0){
+        de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_GOEP_L2CAP_PSM);
+        de_add_number(service,  DE_UINT, DE_SIZE_16, l2cap_psm);
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title GOEP Server
+ *
+ * Accept incoming OBEX connections over RFCOMM or L2CAP ERTM - General Object Exchange
+ *
+ * The GOEP Server handles OBEX Connect, Disconnect, Put, Get, SetPath and Abort for all registered
+ * services, including Single Response Mode (SRM). Requests are reported as GOEP events to the packet
+ * handler of the service:
+ * - PUT: GOEP_SUBEVENT_PUT_REQUEST, followed by the object data as GOEP_DATA_PACKET and GOEP_SUBEVENT_PUT_COMPLETED
+ * - GET: GOEP_SUBEVENT_GET_REQUEST, accept with goep_server_accept_get, GOEP_SUBEVENT_GET_COMPLETED
+ * - Delete: GOEP_SUBEVENT_DELETE_REQUEST
+ * - SetPath: GOEP_SUBEVENT_SET_PATH_REQUEST
+ *
+ * PUT, Delete and SetPath requests are accepted unless goep_server_reject_request is called while handling the event.
+ * GET requests are answered with Not Found unless goep_server_accept_get is called while handling the event.
+ *
+ */
+
+#ifndef GOEP_SERVER_H
+#define GOEP_SERVER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include <stdint.h>
+
+#include "btstack_bool.h"
+#include "btstack_defines.h"
+#include "gap.h"
+
+// Operations supported by a service
+#define GOEP_SERVER_OPERATION_PUT       0x01
+#define GOEP_SERVER_OPERATION_GET       0x02
+#define GOEP_SERVER_OPERATION_DELETE    0x04
+#define GOEP_SERVER_OPERATION_SET_PATH  0x08
+
+// max len of name reported in GOEP Server events, UTF-8
+#ifndef GOEP_SERVER_MAX_NAME_LEN
+#define GOEP_SERVER_MAX_NAME_LEN 64
+#endif
+
+// max len of type reported in GOEP Server events
+#ifndef GOEP_SERVER_MAX_TYPE_LEN
+#define GOEP_SERVER_MAX_TYPE_LEN 32
+#endif
+
+/**
+ * @brief Provide next chunk of object for GET response
+ * @param goep_cid
+ * @param offset into object
+ * @param buffer to store data
+ * @param buffer_size
+ * @return number of bytes stored in buffer
+ */
+typedef uint16_t (*goep_server_get_callback_t)(uint16_t goep_cid, uint32_t offset, uint8_t * buffer, uint16_t buffer_size);
+
+/* API_START */
+
+/**
+ * @brief Setup GOEP Server
+ */
+void goep_server_init(void);
+
+/**
+ * @brief Register OBEX service on RFCOMM Server Channel and/or L2CAP PSM
+ * @note L2CAP requires ENABLE_GOEP_L2CAP
+ * @param packet_handler for GOEP events and GOEP_DATA_PACKET
+ * @param rfcomm_channel or 0 if not used
+ * @param l2cap_psm or 0 if not used
+ * @param security_level
+ * @param target that needs to be provided by client in OBEX Connect, e.g. Folder Browsing UUID for FTP, NULL if none
+ * @param target_len
+ * @param operations supported, see GOEP_SERVER_OPERATION_*
+ * @return status
+ */
+uint8_t goep_server_register_service(btstack_packet_handler_t packet_handler, uint8_t rfcomm_channel, uint16_t l2cap_psm,
+                                     gap_security_level_t security_level, const uint8_t * target, uint16_t target_len, uint8_t operations);
+
+/**
+ * @brief Reject current request with OBEX response code, e.g. OBEX_RESP_FORBIDDEN
+ * @note Can be called while handling GOEP_SUBEVENT_PUT_REQUEST, GOEP_SUBEVENT_DELETE_REQUEST, GOEP_SUBEVENT_SET_PATH_REQUEST,
+ *       or later to stop an ongoing PUT, e.g. if storage is full
+ * @param goep_cid
+ * @param response_code
+ * @return status
+ */
+uint8_t goep_server_reject_request(uint16_t goep_cid, uint8_t response_code);
+
+/**
+ * @brief Accept GET request while handling GOEP_SUBEVENT_GET_REQUEST
+ * @param goep_cid
+ * @param object_len
+ * @param callback to provide object data
+ * @return status
+ */
+uint8_t goep_server_accept_get(uint16_t goep_cid, uint32_t object_len, goep_server_get_callback_t callback);
+
+/**
+ * @brief Get max OBEX packet length negotiated in OBEX Connect
+ * @param goep_cid
+ * @return max packet len or 0 if not connected
+ */
+uint16_t goep_server_get_max_packet_len(uint16_t goep_cid);
+
+/**
+ * @brief Check if Single Response Mode is active for current operation
+ * @param goep_cid
+ * @return true if active
+ */
+bool goep_server_srm_active(uint16_t goep_cid);
+
+/**
+ * @brief Disconnect GOEP connection
+ * @param goep_cid
+ * @return status
+ */
+uint8_t goep_server_disconnect(uint16_t goep_cid);
+
+/**
+ * @brief Create SDP record for OBEX service with RFCOMM channel and optional GOEP L2CAP PSM, used by OPP and FTP Server
+ * @param service buffer - needs to large enough
+ * @param service_record_handle
+ * @param service_class_uuid, also used as profile uuid
+ * @param profile_version
+ * @param rfcomm_channel
+ * @param l2cap_psm or 0 if not used
+ * @param name
+ */
+void goep_server_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint16_t service_class_uuid, uint16_t profile_version,
+                                   uint8_t rfcomm_channel, uint16_t l2cap_psm, const char * name);
+
+/**
+ * @brief De-Init GOEP Server
+ */
+void goep_server_deinit(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+#endif // GOEP_SERVER_H
@@ -56,6 +56,9 @@
 #define OBEX_RESP_FORBIDDEN                0xC3
 #define OBEX_RESP_NOT_FOUND                0xC4
 #define OBEX_RESP_NOT_ACCEPTABLE           0xC6
+#define OBEX_RESP_INTERNAL_SERVER_ERROR    0xD0
+#define OBEX_RESP_NOT_IMPLEMENTED          0xD1
+#define OBEX_RESP_SERVICE_UNAVAILABLE      0xD3
 
 #define OBEX_HEADER_BODY                           0x48
 #define OBEX_HEADER_END_OF_BODY                    0x49
@@ -142,6 +142,24 @@ uint8_t obex_message_builder_request_create_disconnect(uint8_t * buffer, uint16_
     return obex_message_builder_header_add_connection_id(buffer, buffer_len, obex_connection_id);
 }
 
+uint8_t obex_message_builder_response_create_connect(uint8_t * buffer, uint16_t buffer_len, uint8_t obex_version_number, uint8_t flags, uint16_t maximum_obex_packet_length, uint32_t obex_connection_id){
+    uint8_t status = obex_message_builder_packet_init(buffer, buffer_len, OBEX_RESP_SUCCESS);
+    if (status != ERROR_CODE_SUCCESS) return status;
+
+    uint8_t fields[4];
+    fields[0] = obex_version_number;
+    fields[1] = flags;
+    big_endian_store_16(fields, 2, maximum_obex_packet_length);
+    status = obex_message_builder_packet_append(buffer, buffer_len, &fields[0], sizeof(fields));
+    if (status != ERROR_CODE_SUCCESS) return status;
+    if (obex_connection_id == OBEX_CONNECTION_ID_INVALID) return ERROR_CODE_SUCCESS;
+    return obex_message_builder_header_add_connection_id(buffer, buffer_len, obex_connection_id);
+}
+
+uint8_t obex_message_builder_response_create_general(uint8_t * buffer, uint16_t buffer_len, uint8_t response_code){
+    return obex_message_builder_packet_init(buffer, buffer_len, response_code);
+}
+
 uint8_t obex_message_builder_header_add_srm_enable(uint8_t * buffer, uint16_t buffer_len){
     return obex_message_builder_header_add_byte(buffer, buffer_len, OBEX_HEADER_SINGLE_RESPONSE_MODE, OBEX_SRM_ENABLE);
 }
@@ -118,6 +118,27 @@ uint8_t obex_message_builder_request_create_abort(uint8_t * buffer, uint16_t buf
  */
 uint8_t obex_message_builder_request_create_set_path(uint8_t * buffer, uint16_t buffer_len, uint8_t flags, uint32_t connection_id);
 
+/**
+ * @brief Start Connect response
+ * @param buffer
+ * @param buffer_len
+ * @param obex_version_number
+ * @param flags
+ * @param maximum_obex_packet_length
+ * @param connection_id or OBEX_CONNECTION_ID_INVALID
+ * @return status
+ */
+uint8_t obex_message_builder_response_create_connect(uint8_t * buffer, uint16_t buffer_len, uint8_t obex_version_number, uint8_t flags, uint16_t maximum_obex_packet_length, uint32_t connection_id);
+
+/**
+ * @brief Start response for Disconnect, Put, Get, Set Path and Abort request
+ * @param buffer
+ * @param buffer_len
+ * @param response_code
+ * @return status
+ */
+uint8_t obex_message_builder_response_create_general(uint8_t * buffer, uint16_t buffer_len, uint8_t response_code);
+
 /**
  * @brief Add SRM Enable
  * @param buffer
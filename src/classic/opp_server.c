@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "opp_server.c"
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+
+#include "bluetooth_sdp.h"
+#include "classic/goep_server.h"
+#include "classic/opp_server.h"
+#include "classic/sdp_util.h"
+
+uint8_t opp_server_init(btstack_packet_handler_t packet_handler, uint8_t rfcomm_channel, uint16_t l2cap_psm, gap_security_level_t security_level){
+    // no target, objects are pushed to the Inbox
+    return goep_server_register_service(packet_handler, rfcomm_channel, l2cap_psm, security_level, NULL, 0, GOEP_SERVER_OPERATION_PUT);
+}
+
+void opp_server_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint8_t rfcomm_channel, uint16_t l2cap_psm,
+                                  const char * name, uint8_t num_supported_formats, const uint8_t * supported_formats){
+    goep_server_create_sdp_record(service, service_record_handle, BLUETOOTH_SERVICE_CLASS_OBEX_OBJECT_PUSH, 0x0102,
+                                  rfcomm_channel, l2cap_psm, name);
+
+    // 0x0303 "Supported Formats List"
+    de_add_number(service,  DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SUPPORTED_FORMATS_LIST);
+    uint8_t * attribute = de_push_sequence(service);
+    {
+        uint8_t i;
+        for (i = 0; i < num_supported_formats; i++){
+            de_add_number(attribute,  DE_UINT, DE_SIZE_8, supported_formats[i]);
+        }
+    }
+    de_pop_sequence(service, attribute);
+}
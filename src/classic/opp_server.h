@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title OPP Server
+ *
+ * Object Push Profile Server: receive objects like vCards or files pushed by a remote device.
+ *
+ * Objects are delivered by the GOEP Server as GOEP_SUBEVENT_PUT_REQUEST, followed by GOEP_DATA_PACKET
+ * and GOEP_SUBEVENT_PUT_COMPLETED. With Single Response Mode over L2CAP, the client streams the object
+ * without waiting for a response per packet.
+ *
+ */
+
+#ifndef OPP_SERVER_H
+#define OPP_SERVER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "btstack_defines.h"
+#include "gap.h"
+
+// Supported Formats List
+#define OPP_SERVER_FORMAT_VCARD_21     0x01
+#define OPP_SERVER_FORMAT_VCARD_30     0x02
+#define OPP_SERVER_FORMAT_VCAL_10      0x03
+#define OPP_SERVER_FORMAT_ICAL_20      0x04
+#define OPP_SERVER_FORMAT_VNOTE        0x05
+#define OPP_SERVER_FORMAT_VMESSAGE     0x06
+#define OPP_SERVER_FORMAT_ANY          0xFF
+
+/* API_START */
+
+/**
+ * @brief Register OPP Server, requires goep_server_init
+ * @param packet_handler for GOEP events and GOEP_DATA_PACKET
+ * @param rfcomm_channel
+ * @param l2cap_psm or 0 if not used, requires ENABLE_GOEP_L2CAP
+ * @param security_level
+ * @return status
+ */
+uint8_t opp_server_init(btstack_packet_handler_t packet_handler, uint8_t rfcomm_channel, uint16_t l2cap_psm, gap_security_level_t security_level);
+
+/**
+ * @brief Create SDP record for OPP Server
+ * @param service buffer - needs to large enough
+ * @param service_record_handle
+ * @param rfcomm_channel
+ * @param l2cap_psm or 0 if not used
+ * @param name
+ * @param num_supported_formats
+ * @param supported_formats, see OPP_SERVER_FORMAT_*
+ */
+void opp_server_create_sdp_record(uint8_t * service, uint32_t service_record_handle, uint8_t rfcomm_channel, uint16_t l2cap_psm,
+                                  const char * name, uint8_t num_supported_formats, const uint8_t * supported_formats);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+#endif // OPP_SERVER_H
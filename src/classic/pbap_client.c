@@ -81,6 +81,10 @@ static uint32_t pbap_supported_features = \
     PBAP_SUPPORTED_FEATURES_X_BT_UID_VCARD_PROPERTY |
     PBAP_SUPPORTED_FEATURES_CONTACT_REFERENCING;
 
+#ifndef MAX_NR_PBAP_CLIENT_CONNECTIONS
+#define MAX_NR_PBAP_CLIENT_CONNECTIONS 1
+#endif
+
 typedef enum {
     PBAP_INIT = 0,
     PBAP_W4_GOEP_CONNECTION,
@@ -151,8 +155,30 @@ typedef struct pbap_client {
     uint8_t flow_next_triggered;
 } pbap_client_t;
 
-static pbap_client_t _pbap_client;
-static pbap_client_t * pbap_client = &_pbap_client;
+static pbap_client_t pbap_clients[MAX_NR_PBAP_CLIENT_CONNECTIONS];
+static uint16_t      pbap_client_cid_counter;
+
+static pbap_client_t * pbap_client_for_cid(uint16_t pbap_cid){
+    int i;
+    for (i=0;i<MAX_NR_PBAP_CLIENT_CONNECTIONS;i++){
+        pbap_client_t * pbap_client = &pbap_clients[i];
+        if (pbap_client->state == PBAP_INIT) continue;
+        if (pbap_client->cid != pbap_cid) continue;
+        return pbap_client;
+    }
+    return NULL;
+}
+
+static pbap_client_t * pbap_client_for_goep_cid(uint16_t goep_cid){
+    int i;
+    for (i=0;i<MAX_NR_PBAP_CLIENT_CONNECTIONS;i++){
+        pbap_client_t * pbap_client = &pbap_clients[i];
+        if (pbap_client->state == PBAP_INIT) continue;
+        if (pbap_client->goep_cid != goep_cid) continue;
+        return pbap_client;
+    }
+    return NULL;
+}
 
 static void pbap_client_emit_connected_event(pbap_client_t * context, uint8_t status){
     uint8_t event[15];
@@ -256,7 +282,7 @@ static void pbap_client_emit_card_result_event(pbap_client_t * context, const ch
 
 static const uint8_t collon = (uint8_t) ':';
 
-static void pbap_handle_can_send_now(void){
+static void pbap_handle_can_send_now(pbap_client_t * pbap_client){
     uint8_t  path_element[20];
     uint16_t path_element_start;
     uint16_t path_element_len;
@@ -583,7 +609,7 @@ static void pbap_process_srm_headers(pbap_client_t * context, uint8_t *packet, u
     log_info("SRM state %u", context->srm_state);
 }
 
-static void pbap_client_process_vcard_listing(uint8_t *packet, uint16_t size){
+static void pbap_client_process_vcard_listing(pbap_client_t * pbap_client, uint8_t *packet, uint16_t size){
     obex_iterator_t it;
     for (obex_iterator_init_with_response_packet(&it, goep_client_get_request_opcode(pbap_client->goep_cid), packet, size); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
         uint8_t hi = obex_iterator_get_hi(&it);
@@ -651,7 +677,7 @@ static void pbap_client_process_vcard_listing(uint8_t *packet, uint16_t size){
         }
     }
 }
-static void pbap_packet_handler_hci(uint8_t *packet, uint16_t size){
+static void pbap_packet_handler_hci(pbap_client_t * pbap_client, uint8_t *packet, uint16_t size){
     UNUSED(size);
     uint8_t status;
     switch (hci_event_packet_get_type(packet)) {
@@ -681,7 +707,7 @@ static void pbap_packet_handler_hci(uint8_t *packet, uint16_t size){
                     pbap_client_emit_connection_closed_event(pbap_client);
                     break;
                 case GOEP_SUBEVENT_CAN_SEND_NOW:
-                    pbap_handle_can_send_now();
+                    pbap_handle_can_send_now(pbap_client);
                     break;
                 default:
                     break;
@@ -692,7 +718,7 @@ static void pbap_packet_handler_hci(uint8_t *packet, uint16_t size){
     }
 }
 
-static void pbap_packet_handler_goep(uint8_t *packet, uint16_t size){
+static void pbap_packet_handler_goep(pbap_client_t * pbap_client, uint8_t *packet, uint16_t size){
     obex_iterator_t it;
     int wait_for_user = 0;
 
@@ -825,7 +851,7 @@ static void pbap_packet_handler_goep(uint8_t *packet, uint16_t size){
             switch (packet[0]){
                 case OBEX_RESP_CONTINUE:
                     // process data
-                    pbap_client_process_vcard_listing(packet, size);
+                    pbap_client_process_vcard_listing(pbap_client, packet, size);
                     // handle continue
                     pbap_process_srm_headers(pbap_client, packet, size);
                     if (pbap_client->srm_state ==  SRM_ENABLED) break;
@@ -836,7 +862,7 @@ static void pbap_packet_handler_goep(uint8_t *packet, uint16_t size){
                     break;
                 case OBEX_RESP_SUCCESS:
                     // process data
-                    pbap_client_process_vcard_listing(packet, size);
+                    pbap_client_process_vcard_listing(pbap_client, packet, size);
                     // done
                     pbap_client->state = PBAP_CONNECTED;
                     pbap_client_emit_operation_complete_event(pbap_client, 0);
@@ -892,15 +918,18 @@ static void pbap_packet_handler_goep(uint8_t *packet, uint16_t size){
 }
 
 static void pbap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
-    UNUSED(channel); // ok: there is no channel
     UNUSED(size);    // ok: handling own geop events
 
+    // channel is goep_cid for GOEP events and data
+    pbap_client_t * pbap_client = pbap_client_for_goep_cid(channel);
+    if (pbap_client == NULL) return;
+
     switch (packet_type){
         case HCI_EVENT_PACKET:
-            pbap_packet_handler_hci(packet, size);
+            pbap_packet_handler_hci(pbap_client, packet, size);
             break;
         case GOEP_DATA_PACKET:
-            pbap_packet_handler_goep(packet, size);
+            pbap_packet_handler_goep(pbap_client, packet, size);
             break;
         default:
             break;
@@ -908,30 +937,47 @@ static void pbap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *
 }
 
 void pbap_client_init(void){
-    memset(pbap_client, 0, sizeof(pbap_client_t));
-    pbap_client->state = PBAP_INIT;
-    pbap_client->cid = 1;
+    memset(pbap_clients, 0, sizeof(pbap_clients));
+    pbap_client_cid_counter = 0;
 }
 
 void pbap_client_deinit(void){
+    memset(pbap_clients, 0, sizeof(pbap_clients));
 }
 
 uint8_t pbap_connect(btstack_packet_handler_t handler, bd_addr_t addr, uint16_t * out_cid){
-    if (pbap_client->state != PBAP_INIT) return BTSTACK_MEMORY_ALLOC_FAILED;
+    pbap_client_t * pbap_client = NULL;
+    int i;
+    for (i=0;i<MAX_NR_PBAP_CLIENT_CONNECTIONS;i++){
+        if (pbap_clients[i].state != PBAP_INIT) continue;
+        pbap_client = &pbap_clients[i];
+        break;
+    }
+    if (pbap_client == NULL) return BTSTACK_MEMORY_ALLOC_FAILED;
 
+    memset(pbap_client, 0, sizeof(pbap_client_t));
+    pbap_client_cid_counter++;
+    if (pbap_client_cid_counter == 0){
+        pbap_client_cid_counter = 1;
+    }
+    pbap_client->cid = pbap_client_cid_counter;
     pbap_client->state = PBAP_W4_GOEP_CONNECTION;
     pbap_client->client_handler = handler;
     pbap_client->vcard_selector = 0;
     pbap_client->vcard_selector_operator = PBAP_VCARD_SELECTOR_OPERATOR_OR;
 
     uint8_t err = goep_client_create_connection(&pbap_packet_handler, addr, BLUETOOTH_SERVICE_CLASS_PHONEBOOK_ACCESS_PSE, &pbap_client->goep_cid);
+    if (err) {
+        pbap_client->state = PBAP_INIT;
+        return err;
+    }
     *out_cid = pbap_client->cid;
-    if (err) return err;
     return 0;
 }
 
 uint8_t pbap_disconnect(uint16_t pbap_cid){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_SEND_DISCONNECT_REQUEST;
     goep_client_request_can_send_now(pbap_client->goep_cid);
@@ -939,7 +985,8 @@ uint8_t pbap_disconnect(uint16_t pbap_cid){
 }
 
 uint8_t pbap_get_phonebook_size(uint16_t pbap_cid, const char * path){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_GET_PHONEBOOK_SIZE;
     pbap_client->phonebook_path = path;
@@ -949,7 +996,8 @@ uint8_t pbap_get_phonebook_size(uint16_t pbap_cid, const char * path){
 }
 
 uint8_t pbap_pull_phonebook(uint16_t pbap_cid, const char * path){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_PULL_PHONEBOOK;
     pbap_client->phonebook_path = path;
@@ -959,7 +1007,8 @@ uint8_t pbap_pull_phonebook(uint16_t pbap_cid, const char * path){
 }
 
 uint8_t pbap_set_phonebook(uint16_t pbap_cid, const char * path){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_SET_PATH_ROOT;
     pbap_client->current_folder = path;
@@ -969,7 +1018,8 @@ uint8_t pbap_set_phonebook(uint16_t pbap_cid, const char * path){
 }
 
 uint8_t pbap_authentication_password(uint16_t pbap_cid, const char * password){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_W4_USER_AUTHENTICATION) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_SEND_AUTHENTICATED_CONNECT;
     pbap_client->authentication_password = password;
@@ -978,7 +1028,8 @@ uint8_t pbap_authentication_password(uint16_t pbap_cid, const char * password){
 }
 
 uint8_t pbap_pull_vcard_listing(uint16_t pbap_cid, const char * path){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_GET_CARD_LIST;
     pbap_client->phonebook_path = path;
@@ -989,7 +1040,8 @@ uint8_t pbap_pull_vcard_listing(uint16_t pbap_cid, const char * path){
 }
 
 uint8_t pbap_pull_vcard_entry(uint16_t pbap_cid, const char * path){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_GET_CARD_ENTRY;
     // pbap_client->phonebook_path = NULL;
@@ -1001,7 +1053,8 @@ uint8_t pbap_pull_vcard_entry(uint16_t pbap_cid, const char * path){
 }
 
 uint8_t pbap_lookup_by_number(uint16_t pbap_cid, const char * phone_number){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->state = PBAP_W2_GET_CARD_LIST;
     pbap_client->phonebook_path = pbap_vcard_listing_name;
@@ -1012,7 +1065,8 @@ uint8_t pbap_lookup_by_number(uint16_t pbap_cid, const char * phone_number){
 }
 
 uint8_t pbap_abort(uint16_t pbap_cid){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     log_info("abort current operation, state 0x%02x", pbap_client->state);
     pbap_client->abort_operation = 1;
     return 0;
@@ -1020,7 +1074,8 @@ uint8_t pbap_abort(uint16_t pbap_cid){
 
 uint8_t pbap_next_packet(uint16_t pbap_cid){
     // log_info("pbap_next_packet, state %x", pbap_client->state);
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (!pbap_client->flow_control_enabled) return 0;
     switch (pbap_client->state){
         case PBAP_W2_PULL_PHONEBOOK:
@@ -1036,20 +1091,23 @@ uint8_t pbap_next_packet(uint16_t pbap_cid){
 }
 
 uint8_t pbap_set_flow_control_mode(uint16_t pbap_cid, int enable){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     if (pbap_client->state != PBAP_CONNECTED) return BTSTACK_BUSY;
     pbap_client->flow_control_enabled = enable;
     return 0;
 }
 
 uint8_t pbap_set_vcard_selector(uint16_t pbap_cid, uint32_t vcard_selector){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     pbap_client->vcard_selector = vcard_selector;
     return 0;
 }
 
 uint8_t pbap_set_vcard_selector_operator(uint16_t pbap_cid, int vcard_selector_operator){
-    UNUSED(pbap_cid);
+    pbap_client_t * pbap_client = pbap_client_for_cid(pbap_cid);
+    if (pbap_client == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     pbap_client->vcard_selector_operator = vcard_selector_operator;
     return 0;
 }
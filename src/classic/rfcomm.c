@@ -81,6 +81,33 @@
 
 #define RFCOMM_CREDITS 10
 
+// max number of credits provided automatically to the remote side
+#ifndef RFCOMM_CREDITS_MAX
+#define RFCOMM_CREDITS_MAX 128
+#endif
+
+#if RFCOMM_CREDITS_MAX > 255
+#error "RFCOMM_CREDITS_MAX must not exceed 255 as the credit window is stored in an uint8_t"
+#endif
+
+// automatic credits: min interval for incoming frame rate measurement
+#define RFCOMM_CREDITS_RATE_INTERVAL_MS 20
+
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+// round trip time measurement: repeat interval and timeout for TEST response
+#define RFCOMM_RTT_INTERVAL_MS 1000
+#define RFCOMM_RTT_TIMEOUT_MS  2000
+
+typedef enum {
+    RFCOMM_RTT_IDLE = 0,
+    RFCOMM_RTT_SEND_TEST_CMD,
+    RFCOMM_RTT_W4_TEST_RSP,
+} RFCOMM_RTT_STATE;
+#else
+// automatic credits: round trip time assumed without TEST command probing
+#define RFCOMM_CREDITS_RTT_MS 50
+#endif
+
 // FCS calc 
 #define BT_RFCOMM_CODE_WORD         0xE0 // pol = x8+x2+x1+1
 #define BT_RFCOMM_CRC_CHECK_LEN     3
@@ -386,6 +413,10 @@ static void rfcomm_multiplexer_initialize(rfcomm_multiplexer_t *multiplexer){
     multiplexer->max_frame_size = rfcomm_max_frame_size_for_l2cap_mtu(l2cap_max_mtu());
     multiplexer->test_data_len = 0;
     multiplexer->nsc_command = 0;
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+    multiplexer->rtt_state = RFCOMM_RTT_IDLE;
+    multiplexer->rtt_ms = 0;
+#endif
 }
 
 static rfcomm_multiplexer_t * rfcomm_multiplexer_create_for_addr(bd_addr_t addr){
@@ -473,6 +504,9 @@ static void rfcomm_channel_initialize(rfcomm_channel_t *channel, rfcomm_multiple
     channel->new_credits_incoming  = RFCOMM_CREDITS;
     channel->incoming_flow_control = 0;
 
+    channel->credits_window        = RFCOMM_CREDITS;
+    channel->credits_rate_frames   = 0;
+
     channel->rls_line_status       = RFCOMM_RLS_STATUS_INVALID;
 
     channel->service = service;
@@ -683,16 +717,18 @@ static int rfcomm_send_uih_fc_rsp(rfcomm_multiplexer_t *multiplexer, uint8_t fco
     return rfcomm_send_packet_for_multiplexer(multiplexer, address, BT_RFCOMM_UIH, 0, (uint8_t *) payload, pos);
 }
 
-// static int rfcomm_send_uih_test_cmd(rfcomm_multiplexer_t *multiplexer, uint8_t * data, uint16_t len) {
-//     uint8_t address = (1 << 0) | (multiplexer->outgoing << 1);
-//     uint8_t payload[2+len]; 
-//     uint8_t pos = 0;
-//     payload[pos++] = BT_RFCOMM_TEST_CMD;
-//     payload[pos++] = (len + 1) << 1 | 1;  // len
-//     memcpy(&payload[pos], data, len);
-//     pos += len;
-//     return rfcomm_send_packet_for_multiplexer(multiplexer, address, BT_RFCOMM_UIH, 0, (uint8_t *) payload, pos);
-// }
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+// test command with single byte test pattern, used for round trip time measurement
+static int rfcomm_send_uih_test_cmd(rfcomm_multiplexer_t *multiplexer, uint8_t pattern) {
+    uint8_t address = (1 << 0) | (multiplexer->outgoing << 1);
+    uint8_t payload[3];
+    uint8_t pos = 0;
+    payload[pos++] = BT_RFCOMM_TEST_CMD;
+    payload[pos++] = (1 << 1) | 1;  // len
+    payload[pos++] = pattern;
+    return rfcomm_send_packet_for_multiplexer(multiplexer, address, BT_RFCOMM_UIH, 0, (uint8_t *) payload, pos);
+}
+#endif
 
 static int rfcomm_send_uih_test_rsp(rfcomm_multiplexer_t *multiplexer, uint8_t * data, uint16_t len) {
     uint8_t address = (1 << 0) | (multiplexer->outgoing << 1);
@@ -1191,6 +1227,54 @@ static int rfcomm_hci_event_handler(uint8_t *packet, uint16_t size){
     return 0;
 }
 
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+// round trip time measurement with TEST command
+static void rfcomm_multiplexer_rtt_request(rfcomm_multiplexer_t * multiplexer, uint32_t now){
+    switch (multiplexer->rtt_state){
+        case RFCOMM_RTT_IDLE:
+            if ((multiplexer->rtt_ms > 0) && ((now - multiplexer->rtt_start_ms) < RFCOMM_RTT_INTERVAL_MS)) return;
+            break;
+        case RFCOMM_RTT_W4_TEST_RSP:
+            if ((now - multiplexer->rtt_start_ms) < RFCOMM_RTT_TIMEOUT_MS) return;
+            break;
+        default:
+            return;
+    }
+    multiplexer->rtt_state = RFCOMM_RTT_SEND_TEST_CMD;
+    l2cap_request_can_send_now_event(multiplexer->l2cap_cid);
+}
+
+static void rfcomm_multiplexer_rtt_sample(rfcomm_multiplexer_t * multiplexer){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint32_t sample_ms = now - multiplexer->rtt_start_ms;
+    if (sample_ms == 0){
+        sample_ms = 1;
+    }
+    if (sample_ms > RFCOMM_RTT_TIMEOUT_MS){
+        sample_ms = RFCOMM_RTT_TIMEOUT_MS;
+    }
+    if (multiplexer->rtt_ms == 0){
+        multiplexer->rtt_ms = (uint16_t) sample_ms;
+    } else {
+        multiplexer->rtt_ms = (uint16_t) (((7 * (uint32_t) multiplexer->rtt_ms) + sample_ms) / 8);
+    }
+    multiplexer->rtt_state = RFCOMM_RTT_IDLE;
+    multiplexer->rtt_start_ms = now;
+    log_info("RFCOMM round trip time %u ms, smoothed %u ms", (unsigned int) sample_ms, multiplexer->rtt_ms);
+}
+#endif
+
+static uint16_t rfcomm_multiplexer_rtt_ms(rfcomm_multiplexer_t * multiplexer, uint32_t now){
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+    rfcomm_multiplexer_rtt_request(multiplexer, now);
+    return multiplexer->rtt_ms;
+#else
+    UNUSED(multiplexer);
+    UNUSED(now);
+    return RFCOMM_CREDITS_RTT_MS;
+#endif
+}
+
 static int rfcomm_multiplexer_l2cap_packet_handler(uint16_t channel, uint8_t *packet, uint16_t size){
     // get or create a multiplexer for a certain device
     rfcomm_multiplexer_t *multiplexer = rfcomm_multiplexer_for_l2cap_cid(channel);
@@ -1270,6 +1354,13 @@ static int rfcomm_multiplexer_l2cap_packet_handler(uint16_t channel, uint8_t *pa
                     l2cap_request_can_send_now_event(multiplexer->l2cap_cid);
                     return 1;
 
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+                case BT_RFCOMM_TEST_RSP:
+                    if (multiplexer->rtt_state != RFCOMM_RTT_W4_TEST_RSP) return 1;
+                    rfcomm_multiplexer_rtt_sample(multiplexer);
+                    return 1;
+#endif
+
                 case BT_RFCOMM_TEST_CMD: {
                     if ((payload_offset + 1) >= size) return 0; // (1)
                     log_info("Received test command");
@@ -1310,6 +1401,11 @@ static int rfcomm_multiplexer_ready_to_send(rfcomm_multiplexer_t * multiplexer){
             if (multiplexer->test_data_len) {
                 return 1;
             }
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+            if (multiplexer->rtt_state == RFCOMM_RTT_SEND_TEST_CMD){
+                return 1;
+            }
+#endif
             break;
         default:
             break;
@@ -1379,6 +1475,16 @@ static void rfcomm_multiplexer_state_machine(rfcomm_multiplexer_t * multiplexer,
                 rfcomm_send_uih_test_rsp(multiplexer, multiplexer->test_data, len);
                 return;
             }
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+            // measure round trip time
+            if (multiplexer->rtt_state == RFCOMM_RTT_SEND_TEST_CMD){
+                log_debug("Sending TEST Command for round trip time");
+                multiplexer->rtt_state = RFCOMM_RTT_W4_TEST_RSP;
+                multiplexer->rtt_start_ms = btstack_run_loop_get_time_ms();
+                rfcomm_send_uih_test_cmd(multiplexer, 0x55);
+                return;
+            }
+#endif
             break;
         default:
             break;
@@ -1392,12 +1498,55 @@ static void rfcomm_channel_send_credits(rfcomm_channel_t *channel, uint8_t credi
     rfcomm_send_uih_credits(channel->multiplexer, channel->dlci, credits);
 }
 
+// automatic credits: size window to cover the incoming frames of two round trips
+static void rfcomm_channel_credits_update_window(rfcomm_channel_t *channel){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint16_t rtt_ms = rfcomm_multiplexer_rtt_ms(channel->multiplexer, now);
+
+    uint32_t window = channel->credits_window;
+
+    // remote used all credits before new ones arrived
+    if (channel->credits_incoming == 0){
+        window *= 2;
+    }
+
+    channel->credits_rate_frames++;
+    uint32_t elapsed_ms = now - channel->credits_rate_start_ms;
+    if ((rtt_ms > 0) && (elapsed_ms >= rtt_ms) && (elapsed_ms >= RFCOMM_CREDITS_RATE_INTERVAL_MS)){
+        uint32_t target = (2 * (uint32_t) channel->credits_rate_frames * rtt_ms) / elapsed_ms;
+        if (target >= window){
+            window = target;
+        } else {
+            // decay slowly
+            window = ((7 * window) + target) / 8;
+        }
+        channel->credits_rate_frames   = 0;
+        channel->credits_rate_start_ms = now;
+    }
+
+    if (window < RFCOMM_CREDITS){
+        window = RFCOMM_CREDITS;
+    }
+    if (window > RFCOMM_CREDITS_MAX){
+        window = RFCOMM_CREDITS_MAX;
+    }
+    channel->credits_window = (uint8_t) window;
+}
+
 static int rfcomm_channel_can_send(rfcomm_channel_t * channel){
     if (!channel->credits_outgoing) return 0;
     if ((channel->multiplexer->fcon & 1) == 0) return 0;
     return l2cap_can_send_packet_now(channel->multiplexer->l2cap_cid);
 }
 
+// automatic credits: let client piggyback new credits on data while remote has enough credits left
+static int rfcomm_channel_credits_wait_for_data(rfcomm_channel_t *channel){
+    if (channel->incoming_flow_control) return 0;
+    if (!channel->waiting_for_can_send_now) return 0;
+    if (channel->credits_incoming <= (channel->credits_window / 4)) return 0;
+    return rfcomm_channel_can_send(channel);
+}
+
 static void rfcomm_channel_opened(rfcomm_channel_t *rfChannel){
     
     log_info("rfcomm_channel_opened!");
@@ -1414,6 +1563,9 @@ static void rfcomm_channel_opened(rfcomm_channel_t *rfChannel){
     }
     // hack for problem detecting authentication failure
     multiplexer->at_least_one_connection = 1;
+
+    // start incoming frame rate measurement
+    rfChannel->credits_rate_start_ms = btstack_run_loop_get_time_ms();
     
     // request can send now if channel ready 
     if (rfcomm_channel_ready_to_send(rfChannel)){
@@ -1460,18 +1612,25 @@ static void rfcomm_channel_packet_handler_uih(rfcomm_multiplexer_t *multiplexer,
         if (channel->credits_incoming > 0){
             channel->credits_incoming--;
         }
-        
-        // deliver payload
-        (channel->packet_handler)(RFCOMM_DATA_PACKET, channel->rfcomm_cid,
-                              &packet[payload_offset], size-payload_offset-1);
+
+        if (!channel->incoming_flow_control){
+            rfcomm_channel_credits_update_window(channel);
+        }
     }
     
     // automatically provide new credits to remote device, if no incoming flow control
-    if (!channel->incoming_flow_control && (channel->credits_incoming < 5)){
-        channel->new_credits_incoming = RFCOMM_CREDITS;
+    // note: done before delivering payload to allow client to piggyback credits on response
+    if (!channel->incoming_flow_control && (channel->credits_incoming <= (channel->credits_window / 2))){
+        channel->new_credits_incoming = channel->credits_window - channel->credits_incoming;
         request_can_send_now = 1;
     }    
 
+    if ((size - 1) > payload_offset){
+        // deliver payload
+        (channel->packet_handler)(RFCOMM_DATA_PACKET, channel->rfcomm_cid,
+                              &packet[payload_offset], size-payload_offset-1);
+    }
+
     if (request_can_send_now){
         l2cap_request_can_send_now_event(multiplexer->l2cap_cid);
     }
@@ -1803,6 +1962,10 @@ static int rfcomm_channel_ready_to_send(rfcomm_channel_t * channel){
             return 1;
         case RFCOMM_CHANNEL_OPEN:
             if (channel->new_credits_incoming) { 
+                if (rfcomm_channel_credits_wait_for_data(channel)){
+                    log_debug("ch-ready: channel open & new_credits_incoming, piggyback on data");
+                    break;
+                }
                 log_debug("ch-ready: channel open & new_credits_incoming") ; 
                 return 1;
             }
@@ -2332,6 +2495,38 @@ int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
     return result;
 }
 
+// pending incoming credits can be sent in UIH frame with P/F bit set, which has an additional credits field
+static int rfcomm_channel_can_piggyback_credits(rfcomm_channel_t * channel, uint16_t len){
+    if (channel->state != RFCOMM_CHANNEL_OPEN) return 0;
+    if (!channel->new_credits_incoming) return 0;
+    if (len == 0) return 0;
+    if (len >= channel->multiplexer->max_frame_size) return 0;
+#ifdef RFCOMM_USE_OUTGOING_BUFFER
+    if (len >= rfcomm_max_frame_size_for_l2cap_mtu(sizeof(outgoing_buffer))) return 0;
+#endif
+    return 1;
+}
+
+static int rfcomm_channel_send_with_credits(rfcomm_channel_t * channel, uint8_t *data, uint16_t len){
+    rfcomm_multiplexer_t * multiplexer = channel->multiplexer;
+    uint8_t address = (1 << 0) | (multiplexer->outgoing << 1) | (channel->dlci << 2);
+    uint8_t new_credits = channel->new_credits_incoming;
+
+    // send might cause l2cap to emit new credits, update counters first
+    channel->credits_outgoing--;
+    channel->new_credits_incoming = 0;
+    channel->credits_incoming += new_credits;
+
+    int err = rfcomm_send_packet_for_multiplexer(multiplexer, address, BT_RFCOMM_UIH_PF, new_credits, data, len);
+    if (err != 0){
+        channel->credits_outgoing++;
+        channel->new_credits_incoming = new_credits;
+        channel->credits_incoming -= new_credits;
+        log_error("rfcomm_send_with_credits: error %d", err);
+    }
+    return err;
+}
+
 int rfcomm_send(uint16_t rfcomm_cid, uint8_t *data, uint16_t len){
     rfcomm_channel_t * channel = rfcomm_channel_for_rfcomm_cid(rfcomm_cid);
     if (!channel){
@@ -2346,6 +2541,10 @@ int rfcomm_send(uint16_t rfcomm_cid, uint8_t *data, uint16_t len){
         return BTSTACK_ACL_BUFFERS_FULL;
     }
 
+    if (rfcomm_channel_can_piggyback_credits(channel, len)){
+        return rfcomm_channel_send_with_credits(channel, data, len);
+    }
+
 #ifdef RFCOMM_USE_OUTGOING_BUFFER
 #else
     rfcomm_reserve_packet_buffer();
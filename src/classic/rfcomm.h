@@ -189,6 +189,13 @@ typedef struct {
     uint8_t test_data_len;
     uint8_t test_data[RFCOMM_TEST_DATA_MAX_LEN];
 
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+    // round trip time measured with TEST command, used for automatic credits
+    uint8_t  rtt_state;
+    uint16_t rtt_ms;
+    uint32_t rtt_start_ms;
+#endif
+
 } rfcomm_multiplexer_t;
 
 // info regarding an actual connection
@@ -220,6 +227,13 @@ typedef struct {
 
     // credits for incoming traffic
     uint8_t credits_incoming;
+
+    // automatic credits: number of credits remote should have available, see RFCOMM_CREDITS_MAX
+    uint8_t  credits_window;
+
+    // automatic credits: incoming frame rate measurement
+    uint16_t credits_rate_frames;
+    uint32_t credits_rate_start_ms;
     
     // use incoming flow control
     uint8_t incoming_flow_control;
@@ -282,6 +296,7 @@ void rfcomm_set_required_security_level(gap_security_level_t security_level);
 /* 
  * @brief Create RFCOMM connection to a given server channel on a remote deivce.
  * This channel will automatically provide enough credits to the remote side.
+ * The number of granted credits adapts to the incoming frame rate and round trip time, up to RFCOMM_CREDITS_MAX.
  * @param addr
  * @param server_channel
  * @param out_cid
@@ -308,6 +323,7 @@ void rfcomm_disconnect(uint16_t rfcomm_cid);
 /** 
  * @brief Registers RFCOMM service for a server channel and a maximum frame size, and assigns a packet handler.
  * This channel provides credits automatically to the remote side -> no flow control
+ * The number of granted credits adapts to the incoming frame rate and round trip time, up to RFCOMM_CREDITS_MAX.
  * @param packet handler for all channels of this service
  * @param channel 
  * @param max_frame_size
@@ -361,6 +377,7 @@ void rfcomm_request_can_send_now_event(uint16_t rfcomm_cid);
 
 /** 
  * @brief Sends RFCOMM data packet to the RFCOMM channel with given identifier.
+ * @note Pending incoming credits are piggybacked on the data packet if possible
  * @param rfcomm_cid
  */
 int  rfcomm_send(uint16_t rfcomm_cid, uint8_t *data, uint16_t len);
@@ -743,6 +743,10 @@ uint8_t sdp_client_register_query_callback(btstack_context_callback_registration
     return ERROR_CODE_SUCCESS;
 }
 
+void sdp_client_unregister_query_callback(btstack_context_callback_registration_t * callback_registration){
+    (void) btstack_linked_list_remove(&sdp_client_query_requests, (btstack_linked_item_t*) callback_registration);
+}
+
 uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list){
     if (!sdp_client_ready()) return SDP_QUERY_BUSY;
 
@@ -82,6 +82,12 @@ bool sdp_client_ready(void);
  */
 uint8_t sdp_client_register_query_callback(btstack_context_callback_registration_t * callback_registration);
 
+/**
+ * @brief Cancels a callback request registered with sdp_client_register_query_callback
+ * @param callback_registration
+ */
+void sdp_client_unregister_query_callback(btstack_context_callback_registration_t * callback_registration);
+
 /** 
  * @brief Queries the SDP service of the remote device given a service search pattern and a list of attribute IDs. 
  * The remote data is handled by the SDP parser. The SDP parser delivers attribute values and done event via the callback.
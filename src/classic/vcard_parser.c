@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "vcard_parser.c"
+
+// *****************************************************************************
+//
+// vCard Parser
+//
+// Single pass over the input. Only property name and parameters are buffered,
+// values are reported as slices of the input. The end of a value is only known
+// after the first character of the next line, as a leading space or tab marks
+// a folded line.
+//
+// *****************************************************************************
+
+#include <string.h>
+
+#include "classic/vcard_parser.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+
+enum {
+    VCARD_PARSER_W4_LINE_START = 0,
+    VCARD_PARSER_W4_LF,
+    VCARD_PARSER_NAME,
+    VCARD_PARSER_PARAMS,
+    VCARD_PARSER_PARAMS_QUOTED,
+    VCARD_PARSER_VALUE,
+    VCARD_PARSER_VALUE_QP_EQUAL,
+    VCARD_PARSER_VALUE_QP_EQUAL_CR,
+    VCARD_PARSER_SKIP_LINE,
+};
+
+static const char * vcard_parser_property_names[] = {
+    NULL,
+    "VERSION",
+    "FN",
+    "N",
+    "TEL",
+    "EMAIL",
+    "ADR",
+    "ORG",
+    "PHOTO",
+};
+
+static const uint8_t vcard_parser_equal_sign[] = { '=' };
+
+static char vcard_parser_to_upper(char c){
+    if ((c >= 'a') && (c <= 'z')){
+        return (char) (c - 'a' + 'A');
+    }
+    return c;
+}
+
+static bool vcard_parser_is_separator(char c){
+    switch (c){
+        case ';':
+        case ',':
+        case '=':
+        case '"':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static const char vcard_parser_quoted_printable[] = "QUOTED-PRINTABLE";
+#define VCARD_PARSER_QUOTED_PRINTABLE_LEN (sizeof(vcard_parser_quoted_printable) - 1u)
+#define VCARD_PARSER_QP_MISMATCH 0xffu
+
+static bool vcard_parser_is_name_end(char c){
+    switch (c){
+        case ':':
+        case ';':
+        case '.':
+        case '\r':
+        case '\n':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool vcard_parser_is_params_end(char c){
+    switch (c){
+        case ':':
+        case '"':
+        case '\r':
+        case '\n':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// use memchr for long values, e.g. PHOTO, a CR is only searched up to the next LF
+static uint16_t vcard_parser_find_line_end(const uint8_t * data, uint16_t pos, uint16_t size){
+    uint16_t end = size;
+    const uint8_t * lf = (const uint8_t *) memchr(&data[pos], '\n', size - pos);
+    if (lf != NULL){
+        end = (uint16_t) (lf - data);
+    }
+    const uint8_t * cr = (const uint8_t *) memchr(&data[pos], '\r', end - pos);
+    if (cr != NULL){
+        end = (uint16_t) (cr - data);
+    }
+    return end;
+}
+
+static vcard_property_t vcard_parser_lookup_property(const char * name){
+    uint16_t i;
+    for (i = 1; i < (sizeof(vcard_parser_property_names) / sizeof(vcard_parser_property_names[0])); i++){
+        if (strcmp(name, vcard_parser_property_names[i]) == 0){
+            return (vcard_property_t) i;
+        }
+    }
+    return VCARD_PROPERTY_OTHER;
+}
+
+static void vcard_parser_emit(vcard_parser_t * parser, vcard_parser_event_t event){
+    (*parser->callback)(parser, event, NULL, 0);
+}
+
+static void vcard_parser_emit_value(vcard_parser_t * parser, const uint8_t * data, uint16_t len){
+    if (len == 0u) return;
+    parser->value_len += len;
+    if (parser->report_value){
+        (*parser->callback)(parser, VCARD_PARSER_EVENT_PROPERTY_VALUE, data, len);
+    }
+}
+
+static void vcard_parser_end_property(vcard_parser_t * parser){
+    if (parser->property_open == false) return;
+    parser->property_open = false;
+    vcard_parser_emit(parser, VCARD_PARSER_EVENT_PROPERTY_END);
+}
+
+static void vcard_parser_start_name(vcard_parser_t * parser){
+    parser->name_len = 0;
+    parser->params_len = 0;
+    parser->name[0] = 0;
+    parser->params[0] = 0;
+    parser->encoding_qp = false;
+    parser->qp_match_len = 0;
+}
+
+static void vcard_parser_add_name(vcard_parser_t * parser, char c){
+    if (parser->name_len >= VCARD_PARSER_MAX_NAME_LEN){
+        // truncated names never match a known property
+        parser->name_len = VCARD_PARSER_MAX_NAME_LEN + 1;
+        return;
+    }
+    parser->name[parser->name_len++] = vcard_parser_to_upper(c);
+}
+
+// QUOTED-PRINTABLE is matched while parameters are scanned as the params buffer may be truncated
+static void vcard_parser_match_qp_token_end(vcard_parser_t * parser){
+    if (parser->qp_match_len == VCARD_PARSER_QUOTED_PRINTABLE_LEN){
+        parser->encoding_qp = true;
+    }
+    parser->qp_match_len = 0;
+}
+
+static void vcard_parser_match_qp(vcard_parser_t * parser, char c){
+    if (vcard_parser_is_separator(c)){
+        vcard_parser_match_qp_token_end(parser);
+        return;
+    }
+    if (parser->qp_match_len == VCARD_PARSER_QP_MISMATCH) return;
+    if ((parser->qp_match_len < VCARD_PARSER_QUOTED_PRINTABLE_LEN) &&
+        (vcard_parser_to_upper(c) == vcard_parser_quoted_printable[parser->qp_match_len])){
+        parser->qp_match_len++;
+    } else {
+        parser->qp_match_len = VCARD_PARSER_QP_MISMATCH;
+    }
+}
+
+static void vcard_parser_add_param(vcard_parser_t * parser, char c){
+    vcard_parser_match_qp(parser, c);
+    if (parser->params_len >= VCARD_PARSER_MAX_PARAMS_LEN) return;
+    parser->params[parser->params_len++] = c;
+}
+
+// returns next state
+static uint8_t vcard_parser_start_value(vcard_parser_t * parser){
+    parser->name[btstack_min(parser->name_len, VCARD_PARSER_MAX_NAME_LEN)] = 0;
+    parser->params[parser->params_len] = 0;
+    if (parser->name_len > VCARD_PARSER_MAX_NAME_LEN){
+        parser->property = VCARD_PROPERTY_OTHER;
+    } else {
+        if (strcmp(parser->name, "BEGIN") == 0){
+            vcard_parser_emit(parser, VCARD_PARSER_EVENT_CARD_BEGIN);
+            return VCARD_PARSER_SKIP_LINE;
+        }
+        if (strcmp(parser->name, "END") == 0){
+            vcard_parser_emit(parser, VCARD_PARSER_EVENT_CARD_END);
+            return VCARD_PARSER_SKIP_LINE;
+        }
+        parser->property = vcard_parser_lookup_property(parser->name);
+    }
+    vcard_parser_match_qp_token_end(parser);
+    parser->quoted_printable = parser->encoding_qp;
+    parser->report_value = (parser->property != VCARD_PROPERTY_PHOTO) || parser->report_photo_data;
+    parser->value_len = 0;
+    parser->property_open = true;
+    vcard_parser_emit(parser, VCARD_PARSER_EVENT_PROPERTY_BEGIN);
+    return VCARD_PARSER_VALUE;
+}
+
+void vcard_parser_init(vcard_parser_t * parser, vcard_parser_callback_t callback, void * context){
+    memset(parser, 0, sizeof(vcard_parser_t));
+    parser->callback = callback;
+    parser->context = context;
+    parser->state = VCARD_PARSER_W4_LINE_START;
+}
+
+void vcard_parser_set_report_photo_data(vcard_parser_t * parser, bool enabled){
+    parser->report_photo_data = enabled;
+}
+
+void vcard_parser_process(vcard_parser_t * parser, const uint8_t * data, uint16_t size){
+    uint16_t pos = 0;
+    uint16_t value_start = 0;
+    while (pos < size){
+        char c = (char) data[pos];
+        switch (parser->state){
+            case VCARD_PARSER_VALUE:
+                // fast path: scan to end of value slice
+                value_start = pos;
+                if (parser->quoted_printable){
+                    while ((pos < size) && (data[pos] != '\r') && (data[pos] != '\n') && (data[pos] != '=')) pos++;
+                } else {
+                    pos = vcard_parser_find_line_end(data, pos, size);
+                }
+                vcard_parser_emit_value(parser, &data[value_start], pos - value_start);
+                if (pos == size) break;
+                switch (data[pos]){
+                    case '=':
+                        // soft line break or part of the value
+                        parser->state = VCARD_PARSER_VALUE_QP_EQUAL;
+                        break;
+                    case '\r':
+                        parser->state = VCARD_PARSER_W4_LF;
+                        break;
+                    default:
+                        parser->state = VCARD_PARSER_W4_LINE_START;
+                        break;
+                }
+                pos++;
+                break;
+            case VCARD_PARSER_VALUE_QP_EQUAL:
+                switch (c){
+                    case '\r':
+                        parser->state = VCARD_PARSER_VALUE_QP_EQUAL_CR;
+                        pos++;
+                        break;
+                    case '\n':
+                        parser->state = VCARD_PARSER_VALUE;
+                        pos++;
+                        break;
+                    default:
+                        vcard_parser_emit_value(parser, vcard_parser_equal_sign, 1);
+                        parser->state = VCARD_PARSER_VALUE;
+                        break;
+                }
+                break;
+            case VCARD_PARSER_VALUE_QP_EQUAL_CR:
+                parser->state = VCARD_PARSER_VALUE;
+                if (c == '\n'){
+                    pos++;
+                }
+                break;
+            case VCARD_PARSER_W4_LF:
+                parser->state = VCARD_PARSER_W4_LINE_START;
+                if (c == '\n'){
+                    pos++;
+                }
+                break;
+            case VCARD_PARSER_W4_LINE_START:
+                pos++;
+                switch (c){
+                    case ' ':
+                    case '\t':
+                        // folded line continues value
+                        parser->state = parser->property_open ? VCARD_PARSER_VALUE : VCARD_PARSER_SKIP_LINE;
+                        break;
+                    case '\r':
+                    case '\n':
+                        // empty line, e.g. after vCard 2.1 base64 value
+                        vcard_parser_end_property(parser);
+                        break;
+                    default:
+                        vcard_parser_end_property(parser);
+                        vcard_parser_start_name(parser);
+                        vcard_parser_add_name(parser, c);
+                        parser->state = VCARD_PARSER_NAME;
+                        break;
+                }
+                break;
+            case VCARD_PARSER_NAME:
+                while ((pos < size) && (vcard_parser_is_name_end((char) data[pos]) == false)){
+                    vcard_parser_add_name(parser, (char) data[pos]);
+                    pos++;
+                }
+                if (pos == size) break;
+                c = (char) data[pos++];
+                switch (c){
+                    case ':':
+                        parser->state = vcard_parser_start_value(parser);
+                        break;
+                    case ';':
+                        parser->state = VCARD_PARSER_PARAMS;
+                        break;
+                    case '.':
+                        // drop group prefix
+                        vcard_parser_start_name(parser);
+                        break;
+                    case '\r':
+                    case '\n':
+                        log_info("vCard line without value");
+                        parser->state = VCARD_PARSER_W4_LINE_START;
+                        break;
+                    default:
+                        btstack_assert(false);
+                        break;
+                }
+                break;
+            case VCARD_PARSER_PARAMS:
+            case VCARD_PARSER_PARAMS_QUOTED:
+                while ((pos < size) && (vcard_parser_is_params_end((char) data[pos]) == false)){
+                    vcard_parser_add_param(parser, (char) data[pos]);
+                    pos++;
+                }
+                if (pos == size) break;
+                c = (char) data[pos++];
+                if ((c == '\r') || (c == '\n')){
+                    log_info("vCard line without value");
+                    parser->state = VCARD_PARSER_W4_LINE_START;
+                    break;
+                }
+                if ((c == ':') && (parser->state == VCARD_PARSER_PARAMS)){
+                    parser->state = vcard_parser_start_value(parser);
+                    break;
+                }
+                if (c == '"'){
+                    parser->state = (parser->state == VCARD_PARSER_PARAMS) ? VCARD_PARSER_PARAMS_QUOTED : VCARD_PARSER_PARAMS;
+                }
+                vcard_parser_add_param(parser, c);
+                break;
+            case VCARD_PARSER_SKIP_LINE:
+                pos++;
+                if ((c == '\r') || (c == '\n')){
+                    parser->state = VCARD_PARSER_W4_LINE_START;
+                }
+                break;
+            default:
+                btstack_assert(false);
+                break;
+        }
+    }
+}
+
+void * vcard_parser_get_context(const vcard_parser_t * parser){
+    return parser->context;
+}
+
+vcard_property_t vcard_parser_get_property(const vcard_parser_t * parser){
+    return parser->property;
+}
+
+const char * vcard_parser_get_property_name(const vcard_parser_t * parser){
+    return parser->name;
+}
+
+const char * vcard_parser_get_parameters(const vcard_parser_t * parser){
+    return parser->params;
+}
+
+bool vcard_parser_has_parameter(const vcard_parser_t * parser, const char * parameter){
+    uint16_t parameter_len = (uint16_t) strlen(parameter);
+    uint16_t pos = 0;
+    while (pos < parser->params_len){
+        // find end of token
+        uint16_t token_start = pos;
+        while ((pos < parser->params_len) && (vcard_parser_is_separator(parser->params[pos]) == false)) pos++;
+        uint16_t token_len = pos - token_start;
+        if (token_len == parameter_len){
+            uint16_t i;
+            for (i = 0; i < token_len; i++){
+                if (vcard_parser_to_upper(parser->params[token_start + i]) != vcard_parser_to_upper(parameter[i])) break;
+            }
+            if (i == token_len) return true;
+        }
+        pos++;
+    }
+    return false;
+}
+
+uint32_t vcard_parser_get_value_len(const vcard_parser_t * parser){
+    return parser->value_len;
+}
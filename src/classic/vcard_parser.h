@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title vCard Parser
+ *
+ * Incremental parser for vCard 2.1 and 3.0 data, e.g. the phonebook received via PBAP Pull Phonebook.
+ *
+ * Data can be passed in chunks of arbitrary size as they arrive, e.g. each PBAP_DATA_PACKET.
+ * Property values are reported as slices of the provided data without copying them. Folded lines
+ * and quoted-printable soft line breaks are removed, i.e. a value can be reported in several
+ * slices, but no decoding takes place.
+ *
+ */
+
+#ifndef VCARD_PARSER_H
+#define VCARD_PARSER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include <stdint.h>
+
+#include "btstack_bool.h"
+
+// max len of property name, longer names are truncated and reported as VCARD_PROPERTY_OTHER
+#ifndef VCARD_PARSER_MAX_NAME_LEN
+#define VCARD_PARSER_MAX_NAME_LEN 24
+#endif
+
+// max len of property parameters, e.g. "TYPE=CELL", longer parameter lists are truncated
+#ifndef VCARD_PARSER_MAX_PARAMS_LEN
+#define VCARD_PARSER_MAX_PARAMS_LEN 48
+#endif
+
+typedef enum {
+    VCARD_PROPERTY_OTHER = 0,
+    VCARD_PROPERTY_VERSION,
+    VCARD_PROPERTY_FN,
+    VCARD_PROPERTY_N,
+    VCARD_PROPERTY_TEL,
+    VCARD_PROPERTY_EMAIL,
+    VCARD_PROPERTY_ADR,
+    VCARD_PROPERTY_ORG,
+    VCARD_PROPERTY_PHOTO,
+} vcard_property_t;
+
+typedef enum {
+    // BEGIN:VCARD
+    VCARD_PARSER_EVENT_CARD_BEGIN = 0,
+    // property name and parameters are available
+    VCARD_PARSER_EVENT_PROPERTY_BEGIN,
+    // next slice of property value in data/len, not reported for PHOTO by default
+    VCARD_PARSER_EVENT_PROPERTY_VALUE,
+    // property value complete, total length available via vcard_parser_get_value_len
+    VCARD_PARSER_EVENT_PROPERTY_END,
+    // END:VCARD
+    VCARD_PARSER_EVENT_CARD_END,
+} vcard_parser_event_t;
+
+struct vcard_parser;
+
+/**
+ * @brief Callback for parser events. data/len are only valid for VCARD_PARSER_EVENT_PROPERTY_VALUE
+ * and point into the data passed to vcard_parser_process
+ */
+typedef void (*vcard_parser_callback_t)(struct vcard_parser * parser, vcard_parser_event_t event, const uint8_t * data, uint16_t len);
+
+typedef struct vcard_parser {
+    vcard_parser_callback_t callback;
+    void *   context;
+    uint8_t  state;
+    bool     property_open;
+    bool     quoted_printable;
+    // QUOTED-PRINTABLE parameter found, matched chars of current parameter token
+    bool     encoding_qp;
+    uint8_t  qp_match_len;
+    bool     report_value;
+    bool     report_photo_data;
+    vcard_property_t property;
+    uint32_t value_len;
+    uint8_t  name_len;
+    uint8_t  params_len;
+    char     name[VCARD_PARSER_MAX_NAME_LEN + 1];
+    char     params[VCARD_PARSER_MAX_PARAMS_LEN + 1];
+} vcard_parser_t;
+
+/* API_START */
+
+/**
+ * @brief Init vCard parser
+ * @param parser
+ * @param callback for parser events
+ * @param context available via vcard_parser_get_context
+ */
+void vcard_parser_init(vcard_parser_t * parser, vcard_parser_callback_t callback, void * context);
+
+/**
+ * @brief Report PHOTO data via VCARD_PARSER_EVENT_PROPERTY_VALUE. Default: only length is reported
+ * @param parser
+ * @param enabled
+ */
+void vcard_parser_set_report_photo_data(vcard_parser_t * parser, bool enabled);
+
+/**
+ * @brief Process next chunk of vCard data, events are emitted before the function returns
+ * @param parser
+ * @param data
+ * @param size
+ */
+void vcard_parser_process(vcard_parser_t * parser, const uint8_t * data, uint16_t size);
+
+/**
+ * @brief Get context provided in vcard_parser_init
+ * @param parser
+ * @return context
+ */
+void * vcard_parser_get_context(const vcard_parser_t * parser);
+
+/**
+ * @brief Get current property
+ * @param parser
+ * @return property
+ */
+vcard_property_t vcard_parser_get_property(const vcard_parser_t * parser);
+
+/**
+ * @brief Get name of current property in upper case without group prefix, e.g. "TEL" for "item1.tel"
+ * @param parser
+ * @return zero-terminated name
+ */
+const char * vcard_parser_get_property_name(const vcard_parser_t * parser);
+
+/**
+ * @brief Get raw parameters of current property, e.g. "TYPE=CELL;TYPE=PREF" or "CELL;PREF"
+ * @param parser
+ * @return zero-terminated parameters, empty if none
+ */
+const char * vcard_parser_get_parameters(const vcard_parser_t * parser);
+
+/**
+ * @brief Check if current property has parameter, e.g. "CELL" for "TYPE=CELL", "CELL" or "type=cell,voice"
+ * @note case-insensitive
+ * @param parser
+ * @param parameter
+ * @return true if found
+ */
+bool vcard_parser_has_parameter(const vcard_parser_t * parser, const char * parameter);
+
+/**
+ * @brief Get length of current property value reported so far, total length on VCARD_PARSER_EVENT_PROPERTY_END
+ * @param parser
+ * @return value len
+ */
+uint32_t vcard_parser_get_value_len(const vcard_parser_t * parser);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // VCARD_PARSER_H
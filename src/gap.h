@@ -48,6 +48,7 @@ extern "C" {
 #endif
 
 #include "btstack_defines.h"
+#include "btstack_linked_list.h"
 #include "btstack_util.h"
 
 #ifdef ENABLE_CLASSIC
@@ -135,6 +136,68 @@ typedef enum {
     AUTHORIZATION_GRANTED
 } authorization_state_t;
 
+// LE Extended Advertising Parameters
+typedef struct {
+    uint16_t       advertising_event_properties;
+    uint32_t       primary_advertising_interval_min;
+    uint32_t       primary_advertising_interval_max;
+    uint8_t        primary_advertising_channel_map;
+    bd_addr_type_t own_address_type;
+    bd_addr_type_t peer_address_type;
+    bd_addr_t      peer_address;
+    uint8_t        advertising_filter_policy;
+    int8_t         advertising_tx_power;
+    uint8_t        primary_advertising_phy;
+    uint8_t        secondary_advertising_max_skip;
+    uint8_t        secondary_advertising_phy;
+    uint8_t        advertising_sid;
+    uint8_t        scan_request_notification_enable;
+} le_extended_advertising_parameters_t;
+
+// LE Periodic Advertising Parameters
+typedef struct {
+    uint16_t periodic_advertising_interval_min;
+    uint16_t periodic_advertising_interval_max;
+    uint16_t periodic_advertising_properties;
+} le_periodic_advertising_parameters_t;
+
+// LE Advertising Set, storage provided by application
+typedef struct {
+    btstack_linked_item_t                item;
+    uint8_t                              advertising_handle;
+    uint8_t                              state;
+    uint16_t                             tasks;
+    le_extended_advertising_parameters_t extended_params;
+    le_periodic_advertising_parameters_t periodic_params;
+    bd_addr_t                            random_address;
+    const uint8_t *                      adv_data;
+    const uint8_t *                      scan_data;
+    const uint8_t *                      periodic_data;
+    uint16_t                             adv_data_len;
+    uint16_t                             scan_data_len;
+    uint16_t                             periodic_data_len;
+    // offset of next fragment for data currently sent to Controller, reset when data is set
+    uint16_t                             adv_data_pos;
+    uint16_t                             scan_data_pos;
+    uint16_t                             periodic_data_pos;
+    uint16_t                             enable_timeout;
+    uint8_t                              enable_max_events;
+} le_advertising_set_t;
+
+// LE Scan address filter entry
+typedef struct {
+    bd_addr_type_t address_type;
+    bd_addr_t      address;
+} gap_scan_filter_address_t;
+
+// Iterator over the reports in GAP_EVENT_ADVERTISING_REPORT_BATCH
+typedef struct {
+    const uint8_t * event;
+    uint16_t        size;
+    uint16_t        offset;
+    uint8_t         remaining;
+} gap_advertising_report_iterator_t;
+
 
 /* API_START */
 
@@ -376,8 +439,19 @@ void gap_set_scan_params(uint8_t scan_type, uint16_t scan_interval, uint16_t sca
  */
 void gap_set_scan_parameters(uint8_t scan_type, uint16_t scan_interval, uint16_t scan_window);
 
+/**
+ * @brief Set PHYs for LE Scan
+ * @note only used with ENABLE_LE_EXTENDED_ADVERTISING if Controller supports LE Extended Advertising
+ * @param scan_phys 1 = 1M, 4 = Coded, 5 = 1M and Coded, default: 1M
+ * @returns 0 if ok
+ */
+uint8_t gap_set_scan_phys(uint8_t scan_phys);
+
 /**
  * @brief Start LE Scan 
+ * @note with ENABLE_LE_EXTENDED_ADVERTISING, fragments of an advertisement are collected and filtered as a whole.
+ *       Reports with more than 230 bytes are emitted as several GAP_EVENT_EXTENDED_ADVERTISING_REPORT events,
+ *       all but the last one have data status 1 = incomplete
  */
 void gap_start_scan(void);
 
@@ -386,6 +460,87 @@ void gap_start_scan(void);
  */
 void gap_stop_scan(void);
 
+/**
+ * @brief Register handler for batched advertising reports
+ * @note If registered, LE Advertising Reports are delivered as GAP_EVENT_ADVERTISING_REPORT_BATCH to this handler only
+ *       without copying the individual reports. Neither GAP_EVENT_ADVERTISING_REPORT nor the HCI LE Advertising Report
+ *       are emitted to the registered event handlers.
+ *       With ENABLE_LE_EXTENDED_ADVERTISING, legacy reports from LE Extended Advertising Reports are delivered as
+ *       GAP_EVENT_ADVERTISING_REPORT_BATCH as well, while extended advertisements are delivered to this handler as
+ *       GAP_EVENT_EXTENDED_ADVERTISING_REPORT.
+ * @param handler or NULL to use GAP_EVENT_ADVERTISING_REPORT
+ */
+void gap_scan_register_batch_handler(btstack_packet_handler_t handler);
+
+/**
+ * @brief Only report advertisements from given addresses
+ * @note the list is not copied and needs to stay valid until cleared
+ * @param addresses or NULL to disable
+ * @param num_addresses
+ */
+void gap_scan_filter_set_addresses(const gap_scan_filter_address_t * addresses, uint16_t num_addresses);
+
+/**
+ * @brief Only report advertisements that list the given 16-bit Service UUID
+ * @param uuid16 or 0 to disable
+ */
+void gap_scan_filter_set_service_uuid16(uint16_t uuid16);
+
+/**
+ * @brief Only report advertisements that list the given 128-bit Service UUID
+ * @param uuid128 in big endian or NULL to disable
+ */
+void gap_scan_filter_set_service_uuid128(const uint8_t * uuid128);
+
+/**
+ * @brief Only report advertisements received with at least the given RSSI
+ * @param rssi_threshold in dBm, -128 to disable
+ */
+void gap_scan_filter_set_rssi_threshold(int8_t rssi_threshold);
+
+/**
+ * @brief Suppress reports with same address, event type and data within given time window
+ * @note up to LE_SCAN_DUPLICATE_FILTER_SIZE advertisers are tracked, the oldest entry is replaced
+ * @param window_ms or 0 to disable
+ */
+void gap_scan_filter_set_duplicate_window(uint16_t window_ms);
+
+/**
+ * @brief Disable all scan filters
+ */
+void gap_scan_filter_reset(void);
+
+/**
+ * @brief Init iterator for GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param it
+ * @param event
+ * @param size of event
+ */
+void gap_advertising_report_iterator_init(gap_advertising_report_iterator_t * it, const uint8_t * event, uint16_t size);
+
+/**
+ * @brief Check if there is a report at the current iterator position
+ * @param it
+ * @returns true if report available
+ */
+bool gap_advertising_report_iterator_has_more(const gap_advertising_report_iterator_t * it);
+
+/**
+ * @brief Advance to next report
+ * @param it
+ */
+void gap_advertising_report_iterator_next(gap_advertising_report_iterator_t * it);
+
+/**
+ * @brief Access fields of current report
+ */
+uint8_t         gap_advertising_report_iterator_get_advertising_event_type(const gap_advertising_report_iterator_t * it);
+bd_addr_type_t  gap_advertising_report_iterator_get_address_type(const gap_advertising_report_iterator_t * it);
+void            gap_advertising_report_iterator_get_address(const gap_advertising_report_iterator_t * it, bd_addr_t address);
+int8_t          gap_advertising_report_iterator_get_rssi(const gap_advertising_report_iterator_t * it);
+uint8_t         gap_advertising_report_iterator_get_data_length(const gap_advertising_report_iterator_t * it);
+const uint8_t * gap_advertising_report_iterator_get_data(const gap_advertising_report_iterator_t * it);
+
 /**
  * @brief Enable privacy by using random addresses
  * @param random_address_type to use (incl. OFF)
@@ -466,6 +621,158 @@ void gap_set_connection_parameters(uint16_t conn_scan_interval, uint16_t conn_sc
     uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency,
     uint16_t supervision_timeout, uint16_t min_ce_length, uint16_t max_ce_length);
 
+/**
+ * @brief Set PHYs used to initiate outgoing connections
+ * @note only used with ENABLE_LE_EXTENDED_ADVERTISING if Controller supports LE Extended Advertising
+ * @param initiating_phys 1 = 1M, 2 = 2M, 4 = Coded, any combination that includes 1M or Coded, default: 1M
+ * @returns 0 if ok
+ */
+uint8_t gap_set_connection_phys(uint8_t initiating_phys);
+
+/**
+ * @brief Setup LE Extended Advertising Set
+ * @note requires ENABLE_LE_EXTENDED_ADVERTISING. Legacy advertising configured by gap_advertisements_set_* uses advertising handle 0
+ * @param storage to use by stack, needs to stay valid until gap_extended_advertising_remove was called
+ * @param advertising_parameters
+ * @param out_advertising_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_setup(le_advertising_set_t * storage, const le_extended_advertising_parameters_t * advertising_parameters, uint8_t * out_advertising_handle);
+
+/**
+ * @brief Set Extended Advertising Parameters
+ * @param advertising_handle
+ * @param advertising_parameters
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_set_params(uint8_t advertising_handle, const le_extended_advertising_parameters_t * advertising_parameters);
+
+/**
+ * @brief Get Extended Advertising Parameters
+ * @param advertising_handle
+ * @param advertising_parameters
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_get_params(uint8_t advertising_handle, le_extended_advertising_parameters_t * advertising_parameters);
+
+/**
+ * @brief Set random address used by Advertising Set with own_address_type random
+ * @note if not set, the random address from gap_random_address_set_mode/gap_random_address_set is used
+ * @param advertising_handle
+ * @param random_address
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_set_random_address(uint8_t advertising_handle, bd_addr_t random_address);
+
+/**
+ * @brief Set Extended Advertising Data
+ * @param advertising_handle
+ * @param advertising_data_length, up to 1650 bytes. 31 bytes for legacy advertising PDUs
+ * @param advertising_data
+ * @note data is not copied, pointer has to stay valid
+ * @note data longer than a single HCI Command gets fragmented, advertising set is stopped and restarted if active
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_set_adv_data(uint8_t advertising_handle, uint16_t advertising_data_length, const uint8_t * advertising_data);
+
+/**
+ * @brief Set Extended Scan Response Data
+ * @param advertising_handle
+ * @param scan_response_data_length, up to 1650 bytes. 31 bytes for legacy advertising PDUs
+ * @param scan_response_data
+ * @note data is not copied, pointer has to stay valid
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_set_scan_response_data(uint8_t advertising_handle, uint16_t scan_response_data_length, const uint8_t * scan_response_data);
+
+/**
+ * @brief Start Extended Advertising
+ * @note HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED is emitted if advertising stopped on timeout, max events or a new connection
+ * @param advertising_handle
+ * @param timeout in 10 ms, or 0 == no timeout
+ * @param num_extended_advertising_events Controller shall send, or 0 == no max number
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_start(uint8_t advertising_handle, uint16_t timeout, uint8_t num_extended_advertising_events);
+
+/**
+ * @brief Stop Extended Advertising
+ * @param advertising_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_stop(uint8_t advertising_handle);
+
+/**
+ * @brief Remove Extended Advertising Set. Storage can be re-used after HCI Command Complete for LE Remove Advertising Set
+ * @param advertising_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_extended_advertising_remove(uint8_t advertising_handle);
+
+/**
+ * @brief Set Periodic Advertising Parameters
+ * @note requires ENABLE_LE_PERIODIC_ADVERTISING and a non-connectable, non-scannable, non-legacy advertising set
+ * @param advertising_handle
+ * @param periodic_advertising_parameters
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_set_params(uint8_t advertising_handle, const le_periodic_advertising_parameters_t * periodic_advertising_parameters);
+
+/**
+ * @brief Set Periodic Advertising Data
+ * @param advertising_handle
+ * @param periodic_data_length, up to 1650 bytes
+ * @param periodic_data
+ * @note data is not copied, pointer has to stay valid
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_set_data(uint8_t advertising_handle, uint16_t periodic_data_length, const uint8_t * periodic_data);
+
+/**
+ * @brief Start Periodic Advertising. Periodic advertising starts when the advertising set is active
+ * @param advertising_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_start(uint8_t advertising_handle);
+
+/**
+ * @brief Stop Periodic Advertising
+ * @param advertising_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_stop(uint8_t advertising_handle);
+
+/**
+ * @brief Synchronize to Periodic Advertising Train
+ * @note requires ENABLE_LE_PERIODIC_ADVERTISING. Scanning needs to be active to find the advertiser
+ * @note HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT is emitted on completion
+ * @note periodic advertising data is reported as GAP_EVENT_PERIODIC_ADVERTISING_REPORT, reports with more than 247 bytes
+ *       are split into several events, all but the last one have data status 1 = incomplete
+ * @param options bit 0 = use periodic advertiser list, bit 1 = reporting initially disabled
+ * @param advertising_sid
+ * @param advertiser_address_type
+ * @param advertiser_address
+ * @param skip number of periodic advertising packets that can be skipped
+ * @param sync_timeout in 10 ms
+ * @param sync_cte_type 0 = sync to packets with or without Constant Tone Extension
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_create_sync(uint8_t options, uint8_t advertising_sid, bd_addr_type_t advertiser_address_type,
+                                             bd_addr_t advertiser_address, uint16_t skip, uint16_t sync_timeout, uint8_t sync_cte_type);
+
+/**
+ * @brief Cancel sync to Periodic Advertising Train
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_create_sync_cancel(void);
+
+/**
+ * @brief Stop sync to Periodic Advertising Train
+ * @param sync_handle
+ * @returns 0 if ok
+ */
+uint8_t gap_periodic_advertising_terminate_sync(uint16_t sync_handle);
+
 /**
  * @brief Request an update of the connection parameter for a given LE connection
  * @param handle
@@ -594,6 +901,35 @@ uint8_t gap_auto_connection_stop_all(void);
  */
 uint8_t gap_le_set_phy(hci_con_handle_t con_handle, uint8_t all_phys, uint8_t tx_phys, uint8_t rx_phys, uint8_t phy_options);
 
+/**
+ * @brief Set LE Data Length
+ * @param con_handle
+ * @param tx_octets max payload of transmitted LL Data PDUs, 27-251
+ * @param tx_time max time to transmit a LL Data PDU in us, 328-17040
+ * @returns 0 if ok
+ */
+uint8_t gap_le_set_data_length(hci_con_handle_t con_handle, uint16_t tx_octets, uint16_t tx_time);
+
+/**
+ * @brief Configure Data Length and PHY negotiation for new LE connections
+ * @note requires ENABLE_LE_DATA_LENGTH_EXTENSION for Data Length Extension
+ * @note GAP_EVENT_LE_DATA_CHANNEL_CHANGED is emitted when PHYs or max octets change
+ * @param data_length_extension if true, max tx octets are set to Controller maximum, limited by HCI_ACL_PAYLOAD_SIZE
+ * @param preferred_phys 1 = 1M, 2 = 2M, 4 = Coded, 0 = don't change PHY. PHY update is requested if 2M or Coded is also supported by Controller
+ */
+void gap_le_set_throughput_policy(bool data_length_extension, uint8_t preferred_phys);
+
+/**
+ * @brief Get current PHYs and max payload of LE Data PDUs
+ * @param con_handle
+ * @param tx_phy 1 = 1M, 2 = 2M, 3 = Coded
+ * @param rx_phy 1 = 1M, 2 = 2M, 3 = Coded
+ * @param max_tx_octets
+ * @param max_rx_octets
+ * @returns 0 if ok
+ */
+uint8_t gap_le_get_data_channel(hci_con_handle_t con_handle, uint8_t * tx_phy, uint8_t * rx_phy, uint16_t * max_tx_octets, uint16_t * max_rx_octets);
+
 /**
  * @brief Get connection interval
  * @param con_handle
@@ -153,6 +153,17 @@ static void hci_emit_l2cap_check_timeout(hci_connection_t *conn);
 static void gap_inquiry_explode(uint8_t *packet, uint16_t size);
 #endif
 
+#ifdef ENABLE_BLE
+static void hci_emit_le_data_channel_changed(hci_connection_t * conn);
+#endif
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// max data in a single LE Set Extended Advertising/Scan Response Data and LE Set Periodic Advertising Data command
+#define LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN 251
+#define LE_PERIODIC_ADVERTISING_MAX_CHUNK_LEN 252
+#define LE_EXTENDED_ADVERTISING_MAX_HANDLE    0xEF
+#endif
+
 static int  hci_power_control_on(void);
 static void hci_power_control_off(void);
 static void hci_state_reset(void);
@@ -178,6 +189,12 @@ static int hci_have_usb_transport(void);
 void le_handle_advertisement_report(uint8_t *packet, uint16_t size);
 static uint8_t hci_whitelist_remove(bd_addr_type_t address_type, const bd_addr_t address);
 static hci_connection_t * gap_get_outgoing_connection(void);
+static void hci_send_le_scan_parameters(void);
+#endif
+#if defined(ENABLE_LE_PERIPHERAL) && defined(ENABLE_LE_EXTENDED_ADVERTISING)
+static void hci_le_advertising_set_update_tasks(le_advertising_set_t * advertising_set);
+static void hci_le_handle_advertising_set_terminated(uint8_t advertising_handle);
+static void hci_le_advertising_sets_random_address_changed(void);
 #endif
 #endif
 
@@ -227,9 +244,7 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(const bd_addr_t
     conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
 #ifdef ENABLE_BLE
     conn->le_phy_update_all_phys = 0xff;
-#endif
-#ifdef ENABLE_LE_LIMIT_ACL_FRAGMENT_BY_MAX_OCTETS
-    conn->le_max_tx_octets = 27;
+    conn->le_data_length_update_tx_octets = 0;
 #endif
     btstack_linked_list_add(&hci_stack->connections, (btstack_linked_item_t *) conn);
     return conn;
@@ -631,6 +646,52 @@ static int hci_can_send_comand_packet_transport(void){
     return 1;
 }
 
+// HCI Command flow control: up to HCI_MAX_OUTSTANDING_COMMANDS commands can be in flight,
+// Command Complete and Command Status events are matched to outstanding commands by opcode
+static void hci_command_credits_reset(void){
+    // assume that one cmd can be sent
+    hci_stack->num_cmd_packets = 1;
+    hci_stack->cmd_opcodes_outstanding_num = 0;
+}
+
+static void hci_command_outstanding_add(uint16_t opcode){
+    if (hci_stack->cmd_opcodes_outstanding_num == HCI_MAX_OUTSTANDING_COMMANDS){
+        // controller granted more credits than we track, forget about oldest command
+        log_info("Command %04x still outstanding", hci_stack->cmd_opcodes_outstanding[0]);
+        (void) memmove(&hci_stack->cmd_opcodes_outstanding[0], &hci_stack->cmd_opcodes_outstanding[1],
+                       (HCI_MAX_OUTSTANDING_COMMANDS - 1u) * sizeof(uint16_t));
+        hci_stack->cmd_opcodes_outstanding_num--;
+    }
+    hci_stack->cmd_opcodes_outstanding[hci_stack->cmd_opcodes_outstanding_num++] = opcode;
+}
+
+// returns true if command with given opcode was outstanding
+static bool hci_command_outstanding_remove(uint16_t opcode){
+    uint8_t i;
+    for (i = 0; i < hci_stack->cmd_opcodes_outstanding_num; i++){
+        if (hci_stack->cmd_opcodes_outstanding[i] != opcode) continue;
+        // keep order, commands with same opcode complete in order
+        hci_stack->cmd_opcodes_outstanding_num--;
+        (void) memmove(&hci_stack->cmd_opcodes_outstanding[i], &hci_stack->cmd_opcodes_outstanding[i + 1u],
+                       (hci_stack->cmd_opcodes_outstanding_num - i) * sizeof(uint16_t));
+        return true;
+    }
+    return false;
+}
+
+static void hci_command_credits_update(uint8_t num_hci_command_packets, uint16_t opcode){
+    // opcode 0x0000 only updates Num_HCI_Command_Packets, e.g. after power up
+    if ((opcode != 0u) && !hci_command_outstanding_remove(opcode)){
+        // e.g. chipset init script, which is sent directly via the transport
+        log_debug("Completion for opcode %04x which is not outstanding", opcode);
+    }
+#if HCI_MAX_OUTSTANDING_COMMANDS > 1
+    // credits reported by the Controller don't cover commands still in transit
+    num_hci_command_packets = btstack_min(num_hci_command_packets, HCI_MAX_OUTSTANDING_COMMANDS - hci_stack->cmd_opcodes_outstanding_num);
+#endif
+    hci_stack->num_cmd_packets = btstack_min(num_hci_command_packets, HCI_MAX_OUTSTANDING_COMMANDS);
+}
+
 // new functions replacing hci_can_send_packet_now[_using_packet_buffer]
 int hci_can_send_command_packet_now(void){
     if (hci_can_send_comand_packet_transport() == 0) return 0;
@@ -1145,6 +1206,27 @@ static int hci_le_supported(void){
 
 #ifdef ENABLE_BLE
 
+// PHYs supported by Controller as bitmask for LE Set PHY: 1 = 1M, 2 = 2M, 4 = Coded
+static uint8_t hci_le_supported_phys(void){
+    uint8_t phys = 1u;
+    // LE Supported Features: bit 8 = LE 2M PHY
+    if ((hci_stack->le_supported_features[1u] & 0x01u) != 0u){
+        phys |= 2u;
+    }
+    // LE Supported Features: bit 11 = LE Coded PHY
+    if ((hci_stack->le_supported_features[1u] & 0x08u) != 0u){
+        phys |= 4u;
+    }
+    return phys;
+}
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+static bool hci_le_extended_advertising_supported(void){
+    // LE Supported Features: bit 12 = LE Extended Advertising
+    return (hci_stack->le_supported_features[1u] & 0x10u) != 0u;
+}
+#endif
+
 static void hci_get_own_address_for_addr_type(uint8_t own_addr_type, bd_addr_t own_addr){
     if (own_addr_type == BD_ADDR_TYPE_LE_PUBLIC){
         (void)memcpy(own_addr, hci_stack->local_bd_addr, 6);
@@ -1175,8 +1257,114 @@ void gap_le_get_own_connection_address(uint8_t * addr_type, bd_addr_t addr){
     hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, addr);
 }
 
+// FNV-1a
+static uint32_t le_scan_duplicate_hash(const uint8_t * data, uint16_t data_length){
+    uint32_t hash = 2166136261u;
+    uint16_t i;
+    for (i=0;i<data_length;i++){
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void le_scan_duplicates_reset(void){
+    uint8_t i;
+    for (i=0;i<LE_SCAN_DUPLICATE_FILTER_SIZE;i++){
+        hci_stack->le_scan_duplicates[i].address_type = 0xff;
+    }
+}
+
+// track advertiser, returns true if same report was already seen within duplicate window
+static bool le_scan_filter_is_duplicate(uint8_t event_type, uint8_t address_type, const uint8_t * address, uint16_t data_length, const uint8_t * data){
+    uint32_t now_ms = btstack_run_loop_get_time_ms();
+    uint32_t data_hash = le_scan_duplicate_hash(data, data_length);
+    le_scan_duplicate_t * oldest = &hci_stack->le_scan_duplicates[0];
+    uint8_t i;
+    for (i=0;i<LE_SCAN_DUPLICATE_FILTER_SIZE;i++){
+        le_scan_duplicate_t * entry = &hci_stack->le_scan_duplicates[i];
+        if (entry->address_type == 0xffu){
+            oldest = entry;
+            break;
+        }
+        if ((entry->address_type == address_type) && (entry->event_type == event_type) && (memcmp(entry->address, address, 6) == 0)){
+            if ((entry->data_hash == data_hash) && ((uint32_t)(now_ms - entry->time_ms) < hci_stack->le_scan_filter_duplicate_window_ms)){
+                return true;
+            }
+            oldest = entry;
+            break;
+        }
+        if ((int32_t)(entry->time_ms - oldest->time_ms) < 0){
+            oldest = entry;
+        }
+    }
+    oldest->time_ms      = now_ms;
+    oldest->data_hash    = data_hash;
+    oldest->address_type = address_type;
+    oldest->event_type   = event_type;
+    (void)memcpy(oldest->address, address, 6);
+    return false;
+}
+
+// address in little endian as in HCI LE Advertising Report
+static bool le_scan_filter_matches(uint8_t event_type, uint8_t address_type, const uint8_t * address, int8_t rssi, uint16_t data_length, const uint8_t * data){
+    if (rssi < hci_stack->le_scan_filter_rssi_threshold) return false;
+    if (hci_stack->le_scan_filter_addresses != NULL){
+        bd_addr_t report_address;
+        reverse_bd_addr(address, report_address);
+        uint16_t i;
+        for (i=0;i<hci_stack->le_scan_filter_num_addresses;i++){
+            const gap_scan_filter_address_t * entry = &hci_stack->le_scan_filter_addresses[i];
+            if (((uint8_t) entry->address_type == address_type) && (bd_addr_cmp(entry->address, report_address) == 0)) break;
+        }
+        if (i == hci_stack->le_scan_filter_num_addresses) return false;
+    }
+    // AD parser is limited to 255 bytes
+    uint8_t ad_len = (uint8_t) btstack_min(data_length, 255u);
+    if ((hci_stack->le_scan_filter_uuid16 != 0u) && !ad_data_contains_uuid16(ad_len, data, hci_stack->le_scan_filter_uuid16)) return false;
+    if (hci_stack->le_scan_filter_uuid128_set && !ad_data_contains_uuid128(ad_len, data, hci_stack->le_scan_filter_uuid128)) return false;
+    if (hci_stack->le_scan_filter_duplicate_window_ms == 0u) return true;
+    return !le_scan_filter_is_duplicate(event_type, address_type, address, data_length, data);
+}
+
+// drop filtered reports in place and pass remaining reports to batch handler, reusing the HCI event header
+static void le_handle_advertisement_report_batch(uint8_t *packet, uint16_t size){
+    uint16_t offset = 4;
+    uint16_t pos = 4;
+    uint8_t  num_reports = packet[3];
+    uint8_t  num_matching_reports = 0;
+    uint8_t  i;
+    for (i=0; (i<num_reports) && (offset < size);i++){
+        // report: event type, address type, address, data length, data, rssi
+        if ((offset + 9u) > size) break;
+        uint8_t data_length = packet[offset + 8];
+        if (data_length > LE_ADVERTISING_DATA_SIZE) break;
+        uint16_t report_len = 10u + data_length;
+        if ((offset + report_len) > size) break;
+        int8_t rssi = (int8_t) packet[offset + 9u + data_length];
+        if (le_scan_filter_matches(packet[offset], packet[offset + 1], &packet[offset + 2], rssi, data_length, &packet[offset + 9])){
+            if (pos != offset){
+                (void)memmove(&packet[pos], &packet[offset], report_len);
+            }
+            pos += report_len;
+            num_matching_reports++;
+        }
+        offset += report_len;
+    }
+    if (num_matching_reports == 0u) return;
+    packet[1] = GAP_EVENT_ADVERTISING_REPORT_BATCH;
+    packet[2] = (uint8_t) (pos - 3u);
+    packet[3] = num_matching_reports;
+    (*hci_stack->le_advertising_report_batch_handler)(HCI_EVENT_PACKET, 0, &packet[1], pos - 1u);
+}
+
 void le_handle_advertisement_report(uint8_t *packet, uint16_t size){
 
+    if (hci_stack->le_advertising_report_batch_handler != NULL){
+        le_handle_advertisement_report_batch(packet, size);
+        return;
+    }
+
     int offset = 3;
     int num_reports = packet[offset];
     offset += 1;
@@ -1189,6 +1377,10 @@ void le_handle_advertisement_report(uint8_t *packet, uint16_t size){
         uint8_t data_length = packet[offset + 8];
         if (data_length > LE_ADVERTISING_DATA_SIZE) return;
         if ((offset + 9u + data_length + 1u) > size)    return;
+        if (!le_scan_filter_matches(packet[offset], packet[offset + 1], &packet[offset + 2], (int8_t) packet[offset + 9 + data_length], data_length, &packet[offset + 9])){
+            offset += 10 + data_length;
+            continue;
+        }
         // setup event
         uint8_t event_size = 10u + data_length;
         int pos = 0;
@@ -1206,6 +1398,226 @@ void le_handle_advertisement_report(uint8_t *packet, uint16_t size){
         hci_emit_event(event, pos, 1);
     }
 }
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// map event type of legacy advertising PDU in LE Extended Advertising Report to LE Advertising Report event type
+static uint8_t le_legacy_advertising_event_type(uint16_t extended_event_type){
+    switch (extended_event_type & 0x1fu){
+        case 0x13:
+            return 0;   // ADV_IND
+        case 0x15:
+            return 1;   // ADV_DIRECT_IND
+        case 0x12:
+            return 2;   // ADV_SCAN_IND
+        case 0x10:
+            return 3;   // ADV_NONCONN_IND
+        default:
+            return 4;   // SCAN_RSP to ADV_IND or ADV_SCAN_IND
+    }
+}
+
+static void le_emit_legacy_advertisement_report(const uint8_t * report, uint8_t data_length, const uint8_t * data){
+    if (data_length > LE_ADVERTISING_DATA_SIZE) return;
+    if (!le_scan_filter_matches(le_legacy_advertising_event_type(little_endian_read_16(report, 0)), report[2], &report[3], (int8_t) report[13], data_length, data)) return;
+    uint8_t event[12 + LE_ADVERTISING_DATA_SIZE];
+    int pos = 0;
+    event[pos++] = GAP_EVENT_ADVERTISING_REPORT;
+    event[pos++] = 10u + data_length;
+    event[pos++] = le_legacy_advertising_event_type(little_endian_read_16(report, 0));
+    (void)memcpy(&event[pos], &report[2], 1 + 6); // address type + address
+    pos += 7;
+    event[pos++] = report[13]; // rssi
+    event[pos++] = data_length;
+    (void)memcpy(&event[pos], data, data_length);
+    pos += data_length;
+    hci_emit_event(event, pos, 1);
+}
+
+// store legacy report of LE Extended Advertising Report at dest as in LE Advertising Report, dest must not be behind report
+static bool le_store_legacy_advertisement_report(uint8_t * dest, const uint8_t * report, uint8_t data_length, const uint8_t * data){
+    if (data_length > LE_ADVERTISING_DATA_SIZE) return false;
+    uint8_t event_type = le_legacy_advertising_event_type(little_endian_read_16(report, 0));
+    if (!le_scan_filter_matches(event_type, report[2], &report[3], (int8_t) report[13], data_length, data)) return false;
+    // read header fields before they get overwritten
+    uint8_t address_type = report[2];
+    uint8_t rssi = report[13];
+    bd_addr_t address;
+    (void)memcpy(address, &report[3], 6);
+    (void)memmove(&dest[9], data, data_length);
+    dest[0] = event_type;
+    dest[1] = address_type;
+    (void)memcpy(&dest[2], address, 6);
+    dest[8] = data_length;
+    dest[9u + data_length] = rssi;
+    return true;
+}
+
+static void le_emit_extended_advertisement_event(uint8_t * event, uint16_t size){
+    if (hci_stack->le_advertising_report_batch_handler != NULL){
+        (*hci_stack->le_advertising_report_batch_handler)(HCI_EVENT_PACKET, 0, event, size);
+    } else {
+        hci_emit_event(event, size, 1);
+    }
+}
+
+static void le_emit_extended_advertisement_report(uint8_t data_status){
+    uint8_t * event = hci_stack->le_extended_advertising_report;
+    uint16_t data_length = hci_stack->le_extended_advertising_report_len;
+    hci_stack->le_extended_advertising_report_active = false;
+    if (hci_stack->le_extended_advertising_report_truncated){
+        data_status = LE_ADVERTISING_DATA_STATUS_TRUNCATED;
+    }
+    // event type without data status, address type, address, rssi
+    if (!le_scan_filter_matches(event[2] & 0x1fu, event[4], &event[5], (int8_t) event[15], data_length,
+                                &event[GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE])) return;
+    // report is emitted in events of up to 255 bytes, all but the last one are marked as incomplete.
+    // header is placed in front of the data of each fragment, overwriting data that has already been emitted
+    uint8_t header[GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE];
+    (void)memcpy(header, event, sizeof(header));
+    header[0] = GAP_EVENT_EXTENDED_ADVERTISING_REPORT;
+    uint16_t event_type = little_endian_read_16(header, 2) & ~0x60u;
+    uint16_t offset = 0;
+    do {
+        uint16_t fragment_len = btstack_min(data_length - offset, LE_EXTENDED_ADVERTISING_MAX_FRAGMENT_LEN);
+        uint8_t fragment_status = ((offset + fragment_len) < data_length) ? LE_ADVERTISING_DATA_STATUS_INCOMPLETE : data_status;
+        uint8_t * fragment = &event[offset];
+        (void)memcpy(fragment, header, sizeof(header));
+        fragment[1] = (uint8_t) (GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE - 2u + fragment_len);
+        little_endian_store_16(fragment, 2, event_type | (fragment_status << 5));
+        little_endian_store_16(fragment, 25, fragment_len);
+        le_emit_extended_advertisement_event(fragment, GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE + fragment_len);
+        offset += fragment_len;
+    } while (offset < data_length);
+}
+
+// collect fragments of a single advertisement. Fragments of one advertisement are not expected to be interleaved
+// with reports from other advertising sets, if this happens, the incomplete advertisement is reported as truncated
+static void le_handle_extended_advertisement_fragment(const uint8_t * report, uint8_t data_length, const uint8_t * data){
+    uint8_t * event = hci_stack->le_extended_advertising_report;
+    if (hci_stack->le_extended_advertising_report_active){
+        // same address type, address and advertising sid?
+        if ((memcmp(&event[4], &report[2], 7) != 0) || (event[13] != report[11])){
+            le_emit_extended_advertisement_report(LE_ADVERTISING_DATA_STATUS_TRUNCATED);
+        }
+    }
+    if (!hci_stack->le_extended_advertising_report_active){
+        hci_stack->le_extended_advertising_report_active = true;
+        hci_stack->le_extended_advertising_report_truncated = false;
+        hci_stack->le_extended_advertising_report_len = 0;
+    }
+    // header fields up to direct address, rssi is taken from last fragment
+    (void)memcpy(&event[2], report, 23);
+    // append data
+    uint16_t data_pos = hci_stack->le_extended_advertising_report_len;
+    uint16_t bytes_to_copy = btstack_min(data_length, LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN - data_pos);
+    if (bytes_to_copy < data_length){
+        hci_stack->le_extended_advertising_report_truncated = true;
+    }
+    (void)memcpy(&event[GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE + data_pos], data, bytes_to_copy);
+    hci_stack->le_extended_advertising_report_len += bytes_to_copy;
+    // more fragments to come?
+    uint8_t data_status = (little_endian_read_16(report, 0) >> 5) & 0x03u;
+    if (data_status == LE_ADVERTISING_DATA_STATUS_INCOMPLETE) return;
+    le_emit_extended_advertisement_report(data_status);
+}
+
+static void le_handle_extended_advertisement_report(uint8_t *packet, uint16_t size){
+    int offset = 3;
+    int num_reports = packet[offset];
+    offset += 1;
+
+    // with batch handler, legacy reports are compacted in place into GAP_EVENT_ADVERTISING_REPORT_BATCH
+    bool batch = hci_stack->le_advertising_report_batch_handler != NULL;
+    uint16_t batch_pos = 4;
+    uint8_t  batch_num_reports = 0;
+
+    int i;
+    for (i=0; (i<num_reports) && (offset < size);i++){
+        // report: event type (2), address type, address, primary phy, secondary phy, sid, tx power, rssi,
+        //         periodic advertising interval (2), direct address type, direct address, data length, data
+        if ((offset + 24u) > size) break;
+        uint8_t data_length = packet[offset + 23];
+        if ((offset + 24u + data_length) > size) break;
+        const uint8_t * report = &packet[offset];
+        const uint8_t * data   = &packet[offset + 24];
+        if ((little_endian_read_16(report, 0) & LE_ADVERTISING_PROPERTIES_LEGACY) == 0u){
+            le_handle_extended_advertisement_fragment(report, data_length, data);
+        } else if (batch == false){
+            le_emit_legacy_advertisement_report(report, data_length, data);
+        } else if (le_store_legacy_advertisement_report(&packet[batch_pos], report, data_length, data)){
+            batch_pos += 10u + data_length;
+            batch_num_reports++;
+        }
+        offset += 24u + data_length;
+    }
+
+    if (batch_num_reports == 0u) return;
+    packet[1] = GAP_EVENT_ADVERTISING_REPORT_BATCH;
+    packet[2] = (uint8_t) (batch_pos - 3u);
+    packet[3] = batch_num_reports;
+    (*hci_stack->le_advertising_report_batch_handler)(HCI_EVENT_PACKET, 0, &packet[1], batch_pos - 1u);
+}
+#endif
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+static void le_emit_periodic_advertisement_report(uint8_t data_status){
+    uint8_t * event = hci_stack->le_periodic_advertising_report;
+    uint16_t data_length = hci_stack->le_periodic_advertising_report_len;
+    hci_stack->le_periodic_advertising_report_active = false;
+    if (hci_stack->le_periodic_advertising_report_truncated){
+        data_status = LE_ADVERTISING_DATA_STATUS_TRUNCATED;
+    }
+    // emitted in events of up to 255 bytes like extended advertisement reports
+    uint8_t header[GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE];
+    (void)memcpy(header, event, sizeof(header));
+    header[0] = GAP_EVENT_PERIODIC_ADVERTISING_REPORT;
+    uint16_t offset = 0;
+    do {
+        uint16_t fragment_len = btstack_min(data_length - offset, LE_PERIODIC_ADVERTISING_MAX_FRAGMENT_LEN);
+        uint8_t * fragment = &event[offset];
+        (void)memcpy(fragment, header, sizeof(header));
+        fragment[1] = (uint8_t) (GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE - 2u + fragment_len);
+        fragment[7] = ((offset + fragment_len) < data_length) ? LE_ADVERTISING_DATA_STATUS_INCOMPLETE : data_status;
+        little_endian_store_16(fragment, 8, fragment_len);
+        hci_emit_event(fragment, GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE + fragment_len, 1);
+        offset += fragment_len;
+    } while (offset < data_length);
+}
+
+static void le_handle_periodic_advertisement_report(uint8_t *packet, uint16_t size){
+    // sync handle (2), tx power, rssi, cte type, data status, data length, data
+    if (size < 10u) return;
+    uint8_t data_length = hci_subevent_le_periodic_advertising_report_get_data_length(packet);
+    if ((10u + data_length) > size) return;
+    uint8_t * event = hci_stack->le_periodic_advertising_report;
+    if (hci_stack->le_periodic_advertising_report_active){
+        // reports for different sync handles are interleaved
+        if (memcmp(&event[2], &packet[3], 2) != 0){
+            le_emit_periodic_advertisement_report(LE_ADVERTISING_DATA_STATUS_TRUNCATED);
+        }
+    }
+    if (!hci_stack->le_periodic_advertising_report_active){
+        hci_stack->le_periodic_advertising_report_active = true;
+        hci_stack->le_periodic_advertising_report_truncated = false;
+        hci_stack->le_periodic_advertising_report_len = 0;
+    }
+    // sync handle, tx power, rssi, cte type
+    (void)memcpy(&event[2], &packet[3], 5);
+    // append data
+    uint16_t data_pos = hci_stack->le_periodic_advertising_report_len;
+    uint16_t bytes_to_copy = btstack_min(data_length, LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN - data_pos);
+    if (bytes_to_copy < data_length){
+        hci_stack->le_periodic_advertising_report_truncated = true;
+    }
+    (void)memcpy(&event[GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE + data_pos],
+                 hci_subevent_le_periodic_advertising_report_get_data(packet), bytes_to_copy);
+    hci_stack->le_periodic_advertising_report_len += bytes_to_copy;
+    // more fragments to come?
+    uint8_t data_status = hci_subevent_le_periodic_advertising_report_get_data_status(packet);
+    if (data_status == LE_ADVERTISING_DATA_STATUS_INCOMPLETE) return;
+    le_emit_periodic_advertisement_report(data_status);
+}
+#endif
 #endif
 #endif
 
@@ -1315,7 +1727,7 @@ static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
         case HCI_INIT_W4_SEND_RESET:
             log_info("Resend HCI Reset");
             hci_stack->substate = HCI_INIT_SEND_RESET;
-            hci_stack->num_cmd_packets = 1;
+            hci_command_credits_reset();
             hci_run();
             break;
         case HCI_INIT_W4_CUSTOM_INIT_CSR_WARM_BOOT_LINK_RESET:
@@ -1329,7 +1741,7 @@ static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
         case HCI_INIT_W4_CUSTOM_INIT_CSR_WARM_BOOT:
             log_info("Resend HCI Reset - CSR Warm Boot");
             hci_stack->substate = HCI_INIT_SEND_RESET_CSR_WARM_BOOT;
-            hci_stack->num_cmd_packets = 1;
+            hci_command_credits_reset();
             hci_run();
             break;
         case HCI_INIT_W4_SEND_BAUD_CHANGE:
@@ -1363,6 +1775,8 @@ static void hci_initializing_next_state(void){
     hci_stack->substate = (hci_substate_t )( ((int) hci_stack->substate) + 1);
 }
 
+static void hci_initializing_command_completed(void);
+
 // assumption: hci_can_send_command_packet_now() == true
 static void hci_initializing_run(void){
     log_debug("hci_initializing_run: substate %u, can send %u", hci_stack->substate, hci_can_send_command_packet_now());
@@ -1621,9 +2035,17 @@ static void hci_initializing_run(void){
             hci_stack->substate = HCI_INIT_W4_LE_READ_BUFFER_SIZE;
             hci_send_cmd(&hci_le_read_buffer_size);
             break;
+        case HCI_INIT_LE_READ_SUPPORTED_FEATURES:
+            hci_stack->substate = HCI_INIT_W4_LE_READ_SUPPORTED_FEATURES;
+            hci_send_cmd(&hci_le_read_supported_features);
+            break;
         case HCI_INIT_LE_SET_EVENT_MASK:
             hci_stack->substate = HCI_INIT_W4_LE_SET_EVENT_MASK;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+            hci_send_cmd(&hci_le_set_event_mask, 0xFF9FF, 0x0); // bits 0-8, 11-19
+#else
             hci_send_cmd(&hci_le_set_event_mask, 0x809FF, 0x0); // bits 0-8, 11, 19 
+#endif
             break;
         case HCI_INIT_WRITE_LE_HOST_SUPPORTED:
             // LE Supported Host = 1, Simultaneous Host = 0
@@ -1650,7 +2072,7 @@ static void hci_initializing_run(void){
             break;
         case HCI_INIT_LE_SET_SCAN_PARAMETERS:
             hci_stack->substate = HCI_INIT_W4_LE_SET_SCAN_PARAMETERS;
-            hci_send_cmd(&hci_le_set_scan_parameters, hci_stack->le_scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window, hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy);
+            hci_send_le_scan_parameters();
             break;
 #endif
         default:
@@ -1658,6 +2080,54 @@ static void hci_initializing_run(void){
     }
 }
 
+#if HCI_MAX_OUTSTANDING_COMMANDS > 1
+// init commands that don't return data needed to select the next init command
+static bool hci_initializing_command_can_be_pipelined(void){
+    switch (hci_stack->substate){
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+        case HCI_INIT_W4_SET_CONTROLLER_TO_HOST_FLOW_CONTROL:
+        case HCI_INIT_W4_HOST_BUFFER_SIZE:
+#endif
+        case HCI_INIT_W4_SET_EVENT_MASK:
+#ifdef ENABLE_CLASSIC
+        case HCI_INIT_W4_WRITE_SIMPLE_PAIRING_MODE:
+        case HCI_INIT_W4_WRITE_PAGE_TIMEOUT:
+        case HCI_INIT_W4_WRITE_INQUIRY_MODE:
+        case HCI_INIT_W4_WRITE_SECURE_CONNECTIONS_HOST_ENABLE:
+        case HCI_INIT_W4_WRITE_SCAN_ENABLE:
+        case HCI_INIT_W4_WRITE_SYNCHRONOUS_FLOW_CONTROL_ENABLE:
+        case HCI_INIT_W4_WRITE_DEFAULT_ERRONEOUS_DATA_REPORTING:
+#endif
+#ifdef ENABLE_BLE
+        case HCI_INIT_W4_WRITE_LE_HOST_SUPPORTED:
+        case HCI_INIT_W4_LE_SET_EVENT_MASK:
+#endif
+#ifdef ENABLE_LE_DATA_LENGTH_EXTENSION
+        case HCI_INIT_W4_LE_WRITE_SUGGESTED_DATA_LENGTH:
+#endif
+#ifdef ENABLE_LE_CENTRAL
+        case HCI_INIT_W4_LE_SET_SCAN_PARAMETERS:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+#endif
+
+static void hci_initializing_run_pipelined(void){
+    hci_initializing_run();
+#if HCI_MAX_OUTSTANDING_COMMANDS > 1
+    // don't wait for Command Complete of init commands that can be pipelined, but send next init command
+    while ((hci_stack->state == HCI_STATE_INITIALIZING) && hci_initializing_command_can_be_pipelined()){
+        // Command Complete for pipelined command doesn't match and gets ignored by hci_initializing_event_handler
+        hci_stack->last_cmd_opcode = 0;
+        hci_initializing_command_completed();
+        hci_initializing_run();
+    }
+#endif
+}
+
 static void hci_init_done(void){
     // done. tell the app
     log_info("hci_init_done -> HCI_STATE_WORKING");
@@ -1704,7 +2174,7 @@ static bool hci_initializing_event_handler_command_completed(const uint8_t * pac
         // TODO: track actual command
         command_completed = true;
         // Fix: no HCI Command Complete received, so num_cmd_packets not reset
-        hci_stack->num_cmd_packets = 1;
+        hci_command_credits_reset();
     }
 #endif
 
@@ -1774,6 +2244,11 @@ static void hci_initializing_event_handler(const uint8_t * packet, uint16_t size
 
     if (!command_completed) return;
 
+    hci_initializing_command_completed();
+}
+
+// advance init state machine after command for current substate completed
+static void hci_initializing_command_completed(void){
     bool need_baud_change = false;
     bool need_addr_change = false;
 
@@ -1902,7 +2377,7 @@ static void hci_initializing_event_handler(const uint8_t * packet, uint16_t size
             }
             break;
 #ifdef ENABLE_BLE            
-        case HCI_INIT_W4_LE_READ_BUFFER_SIZE:
+        case HCI_INIT_W4_LE_READ_SUPPORTED_FEATURES:
             // skip write le host if not supported (e.g. on LE only EM9301)
             if (hci_stack->local_supported_commands[0u] & 0x02u) break;
             hci_stack->substate = HCI_INIT_LE_SET_EVENT_MASK;
@@ -2132,10 +2607,10 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
     hci_connection_t * conn;
     uint8_t status;
 #endif
-    // get num cmd packets - limit to 1 to reduce complexity
-    hci_stack->num_cmd_packets = packet[2] ? 1 : 0;
-
     uint16_t opcode = hci_event_command_complete_get_command_opcode(packet);
+
+    // get num cmd packets - limited by HCI_MAX_OUTSTANDING_COMMANDS
+    hci_command_credits_update(packet[2], opcode);
     switch (opcode){
         case HCI_OPCODE_HCI_READ_LOCAL_NAME:
             if (packet[5]) break;
@@ -2180,6 +2655,12 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
             }
             log_info("hci_le_read_buffer_size: size %u, count %u", hci_stack->le_data_packets_length, hci_stack->le_acl_packets_total_num);
             break;
+        case HCI_OPCODE_HCI_LE_READ_SUPPORTED_FEATURES:
+            if (packet[5] != ERROR_CODE_SUCCESS) break;
+            hci_stack->le_supported_features[0] = packet[6];
+            hci_stack->le_supported_features[1] = packet[7];
+            log_info("LE supported features %02x %02x", hci_stack->le_supported_features[0], hci_stack->le_supported_features[1]);
+            break;
 #endif
 #ifdef ENABLE_LE_DATA_LENGTH_EXTENSION
         case HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH:
@@ -2252,7 +2733,9 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
                 ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+32u] & 0x08u) >> 2u) |  // bit  9 = Octet 32, bit 3 / Write Secure Connections Host
                 ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+35u] & 0x02u) << 1u) |  // bit 10 = Octet 35, bit 1 / LE Set Address Resolution Enable
                 ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+32u] & 0x02u) << 2u) |  // bit 11 = Octet 32, bit 1 / Remote OOB Extended Data Request Reply
-                ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+32u] & 0x40u) >> 2u);   // bit 12 = Octet 32, bit 6 / Read Local OOB Extended Data command
+                ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+32u] & 0x40u) >> 2u) |  // bit 12 = Octet 32, bit 6 / Read Local OOB Extended Data command
+                ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+35u] & 0x40u) >> 1u) |  // bit 13 = Octet 35, bit 6 / LE Set PHY
+                ((packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE+1u+33u] & 0x40u)     );   // bit 14 = Octet 33, bit 6 / LE Set Data Length
             log_info("Local supported commands summary %02x - %02x", hci_stack->local_supported_commands[0],  hci_stack->local_supported_commands[1]);
             break;
 #ifdef ENABLE_CLASSIC
@@ -2303,6 +2786,29 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
 }
 
 #ifdef ENABLE_BLE
+// request Data Length and PHY update for new connection according to throughput policy
+static void hci_le_throughput_policy_apply(hci_connection_t * conn){
+#ifdef ENABLE_LE_DATA_LENGTH_EXTENSION
+    // bit 14 = LE Set Data Length
+    if (hci_stack->le_throughput_data_length_extension && ((hci_stack->local_supported_commands[1] & 0x40u) != 0u)){
+        // L2CAP PDUs are limited by HCI ACL buffer, see l2cap_max_le_mtu
+        uint16_t tx_octets = btstack_min(hci_stack->le_supported_max_tx_octets, HCI_ACL_PAYLOAD_SIZE);
+        if (tx_octets > conn->le_max_tx_octets){
+            conn->le_data_length_update_tx_octets = tx_octets;
+            conn->le_data_length_update_tx_time   = hci_stack->le_supported_max_tx_time;
+        }
+    }
+#endif
+    // bit 13 = LE Set PHY, only request PHY update if something other than 1M is preferred and supported
+    uint8_t phys = hci_stack->le_throughput_preferred_phys & hci_le_supported_phys();
+    if (((phys & ~1u) != 0u) && ((hci_stack->local_supported_commands[1] & 0x20u) != 0u)){
+        conn->le_phy_update_all_phys    = 0;
+        conn->le_phy_update_tx_phys     = phys;
+        conn->le_phy_update_rx_phys     = phys;
+        conn->le_phy_update_phy_options = 0;
+    }
+}
+
 static void event_handle_le_connection_complete(const uint8_t * packet){
 	bd_addr_t addr;
 	bd_addr_type_t addr_type;
@@ -2352,8 +2858,15 @@ static void event_handle_le_connection_complete(const uint8_t * packet){
 #endif
 	} else {
 #ifdef ENABLE_LE_PERIPHERAL
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+		// stopped advertising set is reported by HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED
+		if (!hci_le_extended_advertising_supported()){
+			hci_stack->le_advertisements_active = false;
+		}
+#else
 		// if we're slave, it was an incoming connection, advertisements have stopped
 		hci_stack->le_advertisements_active = false;
+#endif
 #endif
 	}
 
@@ -2372,6 +2885,12 @@ static void event_handle_le_connection_complete(const uint8_t * packet){
 	conn->con_handle             = hci_subevent_le_connection_complete_get_connection_handle(packet);
 	conn->le_connection_interval = hci_subevent_le_connection_complete_get_conn_interval(packet);
 
+    // new connections use 1M PHY and 27 octets until updated
+    conn->le_tx_phy = 1;
+    conn->le_rx_phy = 1;
+    conn->le_max_tx_octets = 27;
+    conn->le_max_rx_octets = 27;
+
 #ifdef ENABLE_LE_PERIPHERAL
 	if (packet[6] == HCI_ROLE_SLAVE){
 		hci_update_advertisements_enabled_for_current_roles();
@@ -2382,6 +2901,8 @@ static void event_handle_le_connection_complete(const uint8_t * packet){
     conn->att_connection.mtu = ATT_DEFAULT_MTU;
     conn->att_connection.mtu_exchanged = false;
 
+    hci_le_throughput_policy_apply(conn);
+
     // TODO: store - role, peer address type, conn_interval, conn_latency, supervision timeout, master clock
 
 	// restart timer
@@ -2450,8 +2971,8 @@ static void event_handler(uint8_t *packet, uint16_t size){
             break;
             
         case HCI_EVENT_COMMAND_STATUS:
-            // get num cmd packets - limit to 1 to reduce complexity
-            hci_stack->num_cmd_packets = packet[3] ? 1 : 0;
+            // get num cmd packets - limited by HCI_MAX_OUTSTANDING_COMMANDS
+            hci_command_credits_update(packet[3], hci_event_command_status_get_command_opcode(packet));
 
             // check command status to detected failed outgoing connections
             create_connection_cmd = 0;
@@ -2467,6 +2988,19 @@ static void event_handler(uint8_t *packet, uint16_t size){
             if (HCI_EVENT_IS_COMMAND_STATUS(packet, hci_le_create_connection)){
                 create_connection_cmd = 1;
             }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+            if (HCI_EVENT_IS_COMMAND_STATUS(packet, hci_le_extended_create_connection)){
+                create_connection_cmd = 1;
+            }
+#endif
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+            // no LE Periodic Advertising Sync Established if command failed
+            if (HCI_EVENT_IS_COMMAND_STATUS(packet, hci_le_periodic_advertising_create_sync)){
+                if (hci_event_command_status_get_status(packet) != ERROR_CODE_SUCCESS){
+                    hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_IDLE;
+                }
+            }
+#endif
 #endif
             if (create_connection_cmd) {
                 uint8_t status = hci_event_command_status_get_status(packet);
@@ -3070,6 +3604,29 @@ static void event_handler(uint8_t *packet, uint16_t size){
                     // log_info("advertising report received");
                     if (!hci_stack->le_scanning_enabled) break;
                     le_handle_advertisement_report(packet, size);
+                    // reports have been delivered to batch handler, packet was modified in place
+                    if (hci_stack->le_advertising_report_batch_handler != NULL) return;
+                    break;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+                case HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT:
+                    if (!hci_stack->le_scanning_enabled) break;
+                    le_handle_extended_advertisement_report(packet, size);
+                    // reports have been delivered to batch handler, packet was modified in place
+                    if (hci_stack->le_advertising_report_batch_handler != NULL) return;
+                    break;
+#endif
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+                case HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT:
+                    hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_IDLE;
+                    break;
+                case HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT:
+                    le_handle_periodic_advertisement_report(packet, size);
+                    break;
+#endif
+#endif
+#if defined(ENABLE_LE_PERIPHERAL) && defined(ENABLE_LE_EXTENDED_ADVERTISING)
+                case HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED:
+                    hci_le_handle_advertising_set_terminated(hci_subevent_le_advertising_set_terminated_get_advertising_handle(packet));
                     break;
 #endif
                 case HCI_SUBEVENT_LE_CONNECTION_COMPLETE:
@@ -3110,15 +3667,27 @@ static void event_handler(uint8_t *packet, uint16_t size){
                         }
                     }
                     break;
-#ifdef ENABLE_LE_LIMIT_ACL_FRAGMENT_BY_MAX_OCTETS
                 case HCI_SUBEVENT_LE_DATA_LENGTH_CHANGE:
                     handle = hci_subevent_le_data_length_change_get_connection_handle(packet);
                     conn = hci_connection_for_handle(handle);
-                    if (conn) {
-                        conn->le_max_tx_octets = hci_subevent_le_data_length_change_get_max_tx_octets(packet);
-                    }
+                    if (!conn) break;
+                    conn->le_max_tx_octets = hci_subevent_le_data_length_change_get_max_tx_octets(packet);
+                    conn->le_max_rx_octets = hci_subevent_le_data_length_change_get_max_rx_octets(packet);
+                    hci_emit_le_data_channel_changed(conn);
+                    break;
+
+                case HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE:
+                    if (hci_subevent_le_phy_update_complete_get_status(packet) != ERROR_CODE_SUCCESS) break;
+                    handle = hci_subevent_le_phy_update_complete_get_connection_handle(packet);
+                    conn = hci_connection_for_handle(handle);
+                    if (!conn) break;
+                    // also generated if PHYs did not change
+                    if ((conn->le_tx_phy == hci_subevent_le_phy_update_complete_get_tx_phy(packet))
+                    &&  (conn->le_rx_phy == hci_subevent_le_phy_update_complete_get_rx_phy(packet))) break;
+                    conn->le_tx_phy = hci_subevent_le_phy_update_complete_get_tx_phy(packet);
+                    conn->le_rx_phy = hci_subevent_le_phy_update_complete_get_rx_phy(packet);
+                    hci_emit_le_data_channel_changed(conn);
                     break;
-#endif
                 default:
                     break;
             }
@@ -3129,7 +3698,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
             // To avoid getting stuck as num_cmds_packets is zero, reset it to 1 for controllers with this behaviour
             switch (hci_stack->manufacturer){
                 case BLUETOOTH_COMPANY_ID_CAMBRIDGE_SILICON_RADIO:
-                    hci_stack->num_cmd_packets = 1;
+                    hci_command_credits_reset();
                     break;
                 default:
                     break;
@@ -3288,10 +3857,76 @@ static void packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
 /**
  * @brief Add event packet handler. 
  */
+#ifdef ENABLE_HCI_EVENT_DISPATCH_TABLE
+static bool hci_event_dispatch_is_registered(btstack_packet_callback_registration_t * callback_handler){
+    uint8_t i;
+    for (i = 0; i < hci_stack->event_dispatch_num_handlers; i++){
+        if (hci_stack->event_dispatch_handlers[i] == callback_handler) return true;
+    }
+    return false;
+}
+
+// returns mask for new entry in dispatch table, or 0 if table is full
+static hci_event_dispatch_mask_t hci_event_dispatch_add_handler(btstack_packet_callback_registration_t * callback_handler){
+    uint8_t index = hci_stack->event_dispatch_num_handlers;
+    if (index >= HCI_EVENT_DISPATCH_MAX_HANDLERS) {
+        log_info("event dispatch table full, handler %p receives all events", callback_handler);
+        btstack_linked_list_add_tail(&hci_stack->event_handlers, (btstack_linked_item_t*) callback_handler);
+        return 0;
+    }
+    hci_stack->event_dispatch_handlers[index] = callback_handler;
+    hci_stack->event_dispatch_num_handlers++;
+    return (hci_event_dispatch_mask_t) (1u << index);
+}
+
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    if (hci_event_dispatch_is_registered(callback_handler)) return;
+    hci_event_dispatch_mask_t mask = hci_event_dispatch_add_handler(callback_handler);
+    if (mask == 0u) return;
+    // all LE Meta subevents are covered by HCI_EVENT_LE_META entry
+    uint16_t i;
+    for (i = 0; i < 256u; i++){
+        hci_stack->event_dispatch_events[i] |= mask;
+    }
+}
+
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    if (hci_event_dispatch_is_registered(callback_handler)) return;
+    hci_event_dispatch_mask_t mask = hci_event_dispatch_add_handler(callback_handler);
+    if (mask == 0u) return;
+    uint16_t i;
+    for (i = 0; i < num_event_codes; i++){
+        hci_stack->event_dispatch_events[event_codes[i]] |= mask;
+    }
+    for (i = 0; i < num_le_subevent_codes; i++){
+        uint8_t subevent_code = le_subevent_codes[i];
+        if (subevent_code < HCI_EVENT_DISPATCH_NUM_LE_SUBEVENTS){
+            hci_stack->event_dispatch_le_subevents[subevent_code] |= mask;
+        } else {
+            // not tracked individually, deliver all LE Meta events
+            hci_stack->event_dispatch_events[HCI_EVENT_LE_META] |= mask;
+        }
+    }
+}
+#else
 void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
     btstack_linked_list_add_tail(&hci_stack->event_handlers, (btstack_linked_item_t*) callback_handler);
 }
 
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    UNUSED(event_codes);
+    UNUSED(num_event_codes);
+    UNUSED(le_subevent_codes);
+    UNUSED(num_le_subevent_codes);
+    // without dispatch table, handler receives all events
+    hci_add_event_handler(callback_handler);
+}
+#endif
+
 
 /** Register HCI packet handlers */
 void hci_register_acl_packet_handler(btstack_packet_handler_t handler){
@@ -3361,6 +3996,35 @@ static void hci_state_reset(void){
     if (hci_stack->le_advertisements_data != NULL){
         hci_stack->le_advertisements_todo |= LE_ADVERTISEMENT_TASKS_SET_ADV_DATA;
     }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    // configure advertising sets again after power cycle
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * advertising_set = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_REMOVE_SET) != 0){
+            btstack_linked_list_iterator_remove(&it);
+            continue;
+        }
+        advertising_set->state &= ~(LE_ADVERTISEMENT_STATE_ACTIVE | LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE);
+        advertising_set->adv_data_pos = 0;
+        advertising_set->scan_data_pos = 0;
+        advertising_set->periodic_data_pos = 0;
+        hci_le_advertising_set_update_tasks(advertising_set);
+    }
+#endif
+#endif
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+#ifdef ENABLE_LE_CENTRAL
+    hci_stack->le_extended_advertising_report_active = false;
+#endif
+#endif
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+#ifdef ENABLE_LE_CENTRAL
+    hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_IDLE;
+    hci_stack->le_periodic_terminate_sync_handle = HCI_CON_HANDLE_INVALID;
+    hci_stack->le_periodic_advertising_report_active = false;
+#endif
 #endif
 }
 
@@ -3462,6 +4126,16 @@ void hci_init(const hci_transport_t *transport, const void *config){
     hci_stack->le_scan_type     =   0x1; // active
     hci_stack->le_scan_interval = 0x1e0; // 300 ms
     hci_stack->le_scan_window   =  0x30; //  30 ms
+
+    // report all advertisements
+    hci_stack->le_scan_filter_rssi_threshold = -128;
+    le_scan_duplicates_reset();
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    // scan and connect on 1M PHY
+    hci_stack->le_scan_phys       = 1;
+    hci_stack->le_connection_phys = 1;
+#endif
 #endif
 
 #ifdef ENABLE_LE_PERIPHERAL
@@ -3744,7 +4418,7 @@ static int hci_power_control_wake(void){
 
 static void hci_power_transition_to_initializing(void){
     // set up state machine
-    hci_stack->num_cmd_packets = 1; // assume that one cmd can be sent
+    hci_command_credits_reset();
     hci_stack->hci_packet_buffer_reserved = 0;
     hci_stack->state = HCI_STATE_INITIALIZING;
     hci_stack->substate = HCI_INIT_SEND_RESET;
@@ -4320,45 +4994,312 @@ static bool hci_run_general_gap_classic(void){
 #endif
 
 #ifdef ENABLE_BLE
-static bool hci_run_general_gap_le(void){
-
-    // advertisements, active scanning, and creating connections requires random address to be set if using private address
-
-    if (hci_stack->state != HCI_STATE_WORKING) return false;
-    if ( (hci_stack->le_own_addr_type != BD_ADDR_TYPE_LE_PUBLIC) && (hci_stack->le_random_address_set == 0u) ) return false;
-
-
-    // Phase 1: collect what to stop
-
-    bool scanning_stop = false;
-    bool connecting_stop = false;
-    bool advertising_stop = false;
-
-#ifndef ENABLE_LE_CENTRAL
-    UNUSED(scanning_stop);
-    UNUSED(connecting_stop);
-#endif
-#ifndef ENABLE_LE_PERIPHERAL
-    UNUSED(advertising_stop);
+#ifdef ENABLE_LE_CENTRAL
+static void hci_send_le_scan_enable(uint8_t enable){
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_le_extended_advertising_supported()){
+        hci_send_cmd(&hci_le_set_extended_scan_enable, enable, 0, 0, 0);
+        return;
+    }
 #endif
+    hci_send_cmd(&hci_le_set_scan_enable, enable, 0);
+}
 
-    // check if whitelist needs modification
-    bool whitelist_modification_pending = false;
-    btstack_linked_list_iterator_t lit;
-    btstack_linked_list_iterator_init(&lit, &hci_stack->le_whitelist);
-    while (btstack_linked_list_iterator_has_next(&lit)){
-        whitelist_entry_t * entry = (whitelist_entry_t*) btstack_linked_list_iterator_next(&lit);
-        if (entry->state & (LE_WHITELIST_REMOVE_FROM_CONTROLLER | LE_WHITELIST_ADD_TO_CONTROLLER)){
-            whitelist_modification_pending = true;
-            break;
+static void hci_send_le_scan_parameters(void){
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_le_extended_advertising_supported()){
+        // same parameters for 1M and Coded PHY
+        uint8_t  scan_types[2];
+        uint16_t scan_intervals[2];
+        uint16_t scan_windows[2];
+        uint8_t i;
+        for (i=0;i<2;i++){
+            scan_types[i]     = hci_stack->le_scan_type;
+            scan_intervals[i] = hci_stack->le_scan_interval;
+            scan_windows[i]   = hci_stack->le_scan_window;
         }
+        hci_send_cmd(&hci_le_set_extended_scan_parameters, hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy,
+                     hci_stack->le_scan_phys, scan_types, scan_intervals, scan_windows);
+        return;
     }
-    // check if resolving list needs modification
-    bool resolving_list_modification_pending = false;
-#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
-    bool resolving_list_supported = (hci_stack->local_supported_commands[1] & (1 << 2)) != 0;
-	if (resolving_list_supported && hci_stack->le_resolving_list_state != LE_RESOLVING_LIST_DONE){
-        resolving_list_modification_pending = true;
+#endif
+    hci_send_cmd(&hci_le_set_scan_parameters, hci_stack->le_scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window,
+                 hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy);
+}
+
+static void hci_send_le_create_connection(uint8_t initiator_filter_policy, bd_addr_type_t peer_address_type, const bd_addr_t peer_address){
+    hci_stack->le_connection_own_addr_type =  hci_stack->le_own_addr_type;
+    hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, hci_stack->le_connection_own_address);
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_le_extended_advertising_supported()){
+        // same parameters for 1M, 2M, and Coded PHY
+        uint16_t scan_interval[3];
+        uint16_t scan_window[3];
+        uint16_t conn_interval_min[3];
+        uint16_t conn_interval_max[3];
+        uint16_t conn_latency[3];
+        uint16_t supervision_timeout[3];
+        uint16_t min_ce_length[3];
+        uint16_t max_ce_length[3];
+        uint8_t i;
+        for (i=0;i<3;i++){
+            scan_interval[i]       = hci_stack->le_connection_scan_interval;
+            scan_window[i]         = hci_stack->le_connection_scan_window;
+            conn_interval_min[i]   = hci_stack->le_connection_interval_min;
+            conn_interval_max[i]   = hci_stack->le_connection_interval_max;
+            conn_latency[i]        = hci_stack->le_connection_latency;
+            supervision_timeout[i] = hci_stack->le_supervision_timeout;
+            min_ce_length[i]       = hci_stack->le_minimum_ce_length;
+            max_ce_length[i]       = hci_stack->le_maximum_ce_length;
+        }
+        hci_send_cmd(&hci_le_extended_create_connection, initiator_filter_policy, hci_stack->le_connection_own_addr_type,
+                     peer_address_type, peer_address, hci_stack->le_connection_phys, scan_interval, scan_window,
+                     conn_interval_min, conn_interval_max, conn_latency, supervision_timeout, min_ce_length, max_ce_length);
+        return;
+    }
+#endif
+    hci_send_cmd(&hci_le_create_connection,
+                 hci_stack->le_connection_scan_interval,    // conn scan interval
+                 hci_stack->le_connection_scan_window,      // conn scan windows
+                 initiator_filter_policy,                   // use whitelist
+                 peer_address_type,                         // peer address type
+                 peer_address,                              // peer bd addr
+                 hci_stack->le_connection_own_addr_type,    // our addr type:
+                 hci_stack->le_connection_interval_min,     // conn interval min
+                 hci_stack->le_connection_interval_max,     // conn interval max
+                 hci_stack->le_connection_latency,          // conn latency
+                 hci_stack->le_supervision_timeout,         // conn latency
+                 hci_stack->le_minimum_ce_length,           // min ce length
+                 hci_stack->le_maximum_ce_length            // max ce length
+    );
+}
+#endif
+
+#ifdef ENABLE_LE_PERIPHERAL
+static void hci_send_le_advertise_enable(uint8_t enable){
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_le_extended_advertising_supported()){
+        // legacy advertising uses advertising handle 0
+        hci_send_cmd(&hci_le_set_extended_advertising_enable, enable, 1, 0, 0, 0);
+        return;
+    }
+#endif
+    hci_send_cmd(&hci_le_set_advertise_enable, enable);
+}
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// map advertising type of LE Set Advertising Parameters to properties of legacy advertising PDUs
+static uint16_t hci_le_legacy_advertising_event_properties(uint8_t advertising_type){
+    switch (advertising_type){
+        case 0:
+            return 0x13;    // ADV_IND
+        case 1:
+            return 0x1d;    // ADV_DIRECT_IND, high duty cycle
+        case 2:
+            return 0x12;    // ADV_SCAN_IND
+        case 4:
+            return 0x15;    // ADV_DIRECT_IND, low duty cycle
+        default:
+            return 0x10;    // ADV_NONCONN_IND
+    }
+}
+
+// send next fragment of advertising, scan response or periodic data
+static void hci_send_le_advertising_set_data(le_advertising_set_t * advertising_set, const hci_cmd_t * cmd, uint16_t task,
+                                             const uint8_t * data, uint16_t data_len, uint16_t * data_pos, uint16_t max_fragment_len){
+    uint16_t pos = *data_pos;
+    uint16_t fragment_len = btstack_min(data_len - pos, max_fragment_len);
+    bool first = pos == 0u;
+    bool last  = (pos + fragment_len) == data_len;
+    // operation: 0 = intermediate, 1 = first, 2 = last, 3 = complete
+    uint8_t operation = (first ? 1u : 0u) | (last ? 2u : 0u);
+    if (last){
+        advertising_set->tasks &= ~task;
+        *data_pos = 0;
+    } else {
+        *data_pos += fragment_len;
+    }
+    if (cmd == &hci_le_set_periodic_advertising_data){
+        hci_send_cmd(cmd, advertising_set->advertising_handle, operation, fragment_len, &data[pos]);
+    } else {
+        // fragment preference: Controller should not fragment
+        hci_send_cmd(cmd, advertising_set->advertising_handle, operation, 1, fragment_len, &data[pos]);
+    }
+}
+
+// advertising set needs to be disabled for parameter or address changes and data that does not fit into a single command
+static bool hci_le_advertising_set_requires_stop(const le_advertising_set_t * advertising_set, bool lists_modification_pending){
+    if ((advertising_set->state & LE_ADVERTISEMENT_STATE_ENABLED) == 0u) return true;
+    if ((advertising_set->tasks & (LE_ADVERTISEMENT_TASKS_SET_PARAMS | LE_ADVERTISEMENT_TASKS_SET_ADDRESS | LE_ADVERTISEMENT_TASKS_REMOVE_SET)) != 0u) return true;
+    if (((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_ADV_DATA) != 0u) && (advertising_set->adv_data_len > LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN)) return true;
+    if (((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA) != 0u) && (advertising_set->scan_data_len > LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN)) return true;
+    return lists_modification_pending && (advertising_set->extended_params.advertising_filter_policy != 0u);
+}
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+static bool hci_le_periodic_advertising_requires_stop(const le_advertising_set_t * advertising_set){
+    if ((advertising_set->state & LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED) == 0u) return true;
+    if ((advertising_set->tasks & (LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS | LE_ADVERTISEMENT_TASKS_REMOVE_SET)) != 0u) return true;
+    return ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA) != 0u) && (advertising_set->periodic_data_len > LE_PERIODIC_ADVERTISING_MAX_CHUNK_LEN);
+}
+#endif
+
+static bool hci_run_general_gap_le_advertising_sets_stop(bool lists_modification_pending){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * advertising_set = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        if (((advertising_set->state & LE_ADVERTISEMENT_STATE_ACTIVE) != 0u) && hci_le_advertising_set_requires_stop(advertising_set, lists_modification_pending)){
+            advertising_set->state &= ~LE_ADVERTISEMENT_STATE_ACTIVE;
+            hci_send_cmd(&hci_le_set_extended_advertising_enable, 0, 1, advertising_set->advertising_handle, 0, 0);
+            return true;
+        }
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+        if (((advertising_set->state & LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE) != 0u) && hci_le_periodic_advertising_requires_stop(advertising_set)){
+            advertising_set->state &= ~LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE;
+            hci_send_cmd(&hci_le_set_periodic_advertising_enable, 0, advertising_set->advertising_handle);
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+static bool hci_run_general_gap_le_advertising_sets_modify(void){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * advertising_set = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        // data of an active set can only be updated with a single command
+        bool active = (advertising_set->state & (LE_ADVERTISEMENT_STATE_ACTIVE | LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE)) != 0u;
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_REMOVE_SET) != 0u){
+            if (active) continue;
+            btstack_linked_list_iterator_remove(&it);
+            hci_send_cmd(&hci_le_remove_advertising_set, advertising_set->advertising_handle);
+            return true;
+        }
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_PARAMS) != 0u){
+            if ((advertising_set->state & LE_ADVERTISEMENT_STATE_ACTIVE) != 0u) continue;
+            advertising_set->tasks &= ~LE_ADVERTISEMENT_TASKS_SET_PARAMS;
+            const le_extended_advertising_parameters_t * params = &advertising_set->extended_params;
+            hci_send_cmd(&hci_le_set_extended_advertising_parameters, advertising_set->advertising_handle,
+                         params->advertising_event_properties, params->primary_advertising_interval_min,
+                         params->primary_advertising_interval_max, params->primary_advertising_channel_map,
+                         params->own_address_type, params->peer_address_type, params->peer_address,
+                         params->advertising_filter_policy, params->advertising_tx_power, params->primary_advertising_phy,
+                         params->secondary_advertising_max_skip, params->secondary_advertising_phy,
+                         params->advertising_sid, params->scan_request_notification_enable);
+            return true;
+        }
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_ADDRESS) != 0u){
+            if ((advertising_set->state & LE_ADVERTISEMENT_STATE_RANDOM_ADDRESS_SET) == 0u){
+                // use random address from gap_random_address_set_mode / gap_random_address_set
+                if (hci_stack->le_random_address_set == 0u) continue;
+                (void)memcpy(advertising_set->random_address, hci_stack->le_random_address, 6);
+            }
+            advertising_set->tasks &= ~LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+            hci_send_cmd(&hci_le_set_advertising_set_random_address, advertising_set->advertising_handle, advertising_set->random_address);
+            return true;
+        }
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_ADV_DATA) != 0u){
+            if (active && (advertising_set->adv_data_len > LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN)) continue;
+            hci_send_le_advertising_set_data(advertising_set, &hci_le_set_extended_advertising_data, LE_ADVERTISEMENT_TASKS_SET_ADV_DATA,
+                                             advertising_set->adv_data, advertising_set->adv_data_len, &advertising_set->adv_data_pos, LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN);
+            return true;
+        }
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA) != 0u){
+            if (active && (advertising_set->scan_data_len > LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN)) continue;
+            hci_send_le_advertising_set_data(advertising_set, &hci_le_set_extended_scan_response_data, LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA,
+                                             advertising_set->scan_data, advertising_set->scan_data_len, &advertising_set->scan_data_pos, LE_EXTENDED_ADVERTISING_MAX_CHUNK_LEN);
+            return true;
+        }
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS) != 0u){
+            if ((advertising_set->state & LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE) != 0u) continue;
+            advertising_set->tasks &= ~LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS;
+            const le_periodic_advertising_parameters_t * params = &advertising_set->periodic_params;
+            hci_send_cmd(&hci_le_set_periodic_advertising_parameters, advertising_set->advertising_handle,
+                         params->periodic_advertising_interval_min, params->periodic_advertising_interval_max,
+                         params->periodic_advertising_properties);
+            return true;
+        }
+        if ((advertising_set->tasks & LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA) != 0u){
+            if (((advertising_set->state & LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE) != 0u) && (advertising_set->periodic_data_len > LE_PERIODIC_ADVERTISING_MAX_CHUNK_LEN)) continue;
+            hci_send_le_advertising_set_data(advertising_set, &hci_le_set_periodic_advertising_data, LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA,
+                                             advertising_set->periodic_data, advertising_set->periodic_data_len, &advertising_set->periodic_data_pos, LE_PERIODIC_ADVERTISING_MAX_CHUNK_LEN);
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+static bool hci_run_general_gap_le_advertising_sets_start(void){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * advertising_set = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        // wait until set is configured
+        if (advertising_set->tasks != 0u) continue;
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+        // periodic advertising starts as soon as the advertising set is enabled
+        if (((advertising_set->state & (LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED | LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE)) == LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED)){
+            advertising_set->state |= LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE;
+            hci_send_cmd(&hci_le_set_periodic_advertising_enable, 1, advertising_set->advertising_handle);
+            return true;
+        }
+#endif
+        if ((advertising_set->state & (LE_ADVERTISEMENT_STATE_ENABLED | LE_ADVERTISEMENT_STATE_ACTIVE)) == LE_ADVERTISEMENT_STATE_ENABLED){
+            advertising_set->state |= LE_ADVERTISEMENT_STATE_ACTIVE;
+            hci_send_cmd(&hci_le_set_extended_advertising_enable, 1, 1, advertising_set->advertising_handle,
+                         advertising_set->enable_timeout, advertising_set->enable_max_events);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+#endif
+
+static bool hci_run_general_gap_le(void){
+
+    // advertisements, active scanning, and creating connections requires random address to be set if using private address
+
+    if (hci_stack->state != HCI_STATE_WORKING) return false;
+    if ( (hci_stack->le_own_addr_type != BD_ADDR_TYPE_LE_PUBLIC) && (hci_stack->le_random_address_set == 0u) ) return false;
+
+
+    // Phase 1: collect what to stop
+
+    bool scanning_stop = false;
+    bool connecting_stop = false;
+    bool advertising_stop = false;
+
+#ifndef ENABLE_LE_CENTRAL
+    UNUSED(scanning_stop);
+    UNUSED(connecting_stop);
+#endif
+#ifndef ENABLE_LE_PERIPHERAL
+    UNUSED(advertising_stop);
+#endif
+
+    // check if whitelist needs modification
+    bool whitelist_modification_pending = false;
+    btstack_linked_list_iterator_t lit;
+    btstack_linked_list_iterator_init(&lit, &hci_stack->le_whitelist);
+    while (btstack_linked_list_iterator_has_next(&lit)){
+        whitelist_entry_t * entry = (whitelist_entry_t*) btstack_linked_list_iterator_next(&lit);
+        if (entry->state & (LE_WHITELIST_REMOVE_FROM_CONTROLLER | LE_WHITELIST_ADD_TO_CONTROLLER)){
+            whitelist_modification_pending = true;
+            break;
+        }
+    }
+    // check if resolving list needs modification
+    bool resolving_list_modification_pending = false;
+#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+    bool resolving_list_supported = (hci_stack->local_supported_commands[1] & (1 << 2)) != 0;
+	if (resolving_list_supported && hci_stack->le_resolving_list_state != LE_RESOLVING_LIST_DONE){
+        resolving_list_modification_pending = true;
     }
 #endif
 
@@ -4413,7 +5354,7 @@ static bool hci_run_general_gap_le(void){
         // - whitelist change required but used for advertisement filter policy
         // - resolving list modified
         bool advertising_uses_whitelist = hci_stack->le_advertisements_filter_policy != 0;
-        bool advertising_change = (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_PARAMS) != 0;
+        bool advertising_change = (hci_stack->le_advertisements_todo & (LE_ADVERTISEMENT_TASKS_SET_PARAMS | LE_ADVERTISEMENT_TASKS_SET_ADDRESS)) != 0;
         if (advertising_change ||
             (hci_stack->le_advertisements_enabled_for_current_roles == 0) ||
             (advertising_uses_whitelist & whitelist_modification_pending) ||
@@ -4430,7 +5371,7 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_CENTRAL
     if (scanning_stop){
         hci_stack->le_scanning_active = false;
-        hci_send_cmd(&hci_le_set_scan_enable, 0, 0);
+        hci_send_le_scan_enable(0);
         return true;
     }
 #endif
@@ -4445,9 +5386,14 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_PERIPHERAL
     if (advertising_stop){
         hci_stack->le_advertisements_active = false;
-        hci_send_cmd(&hci_le_set_advertise_enable, 0);
+        hci_send_le_advertise_enable(0);
         return true;
     }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_run_general_gap_le_advertising_sets_stop(whitelist_modification_pending || resolving_list_modification_pending)){
+        return true;
+    }
+#endif
 #endif
 
     // Phase 3: modify
@@ -4455,8 +5401,7 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_CENTRAL
     if (hci_stack->le_scanning_param_update){
         hci_stack->le_scanning_param_update = false;
-        hci_send_cmd(&hci_le_set_scan_parameters, hci_stack->le_scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window,
-                     hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy);
+        hci_send_le_scan_parameters();
         return true;
     }
 #endif
@@ -4465,6 +5410,30 @@ static bool hci_run_general_gap_le(void){
     if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_PARAMS){
         hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_PARAMS;
         hci_stack->le_advertisements_own_addr_type = hci_stack->le_own_addr_type;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+        if (hci_le_extended_advertising_supported()){
+            // legacy advertising uses advertising handle 0 with its own random address
+            if (hci_stack->le_advertisements_own_addr_type != BD_ADDR_TYPE_LE_PUBLIC){
+                hci_stack->le_advertisements_todo |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+            }
+            hci_send_cmd(&hci_le_set_extended_advertising_parameters, 0,
+                         hci_le_legacy_advertising_event_properties(hci_stack->le_advertisements_type),
+                         hci_stack->le_advertisements_interval_min,
+                         hci_stack->le_advertisements_interval_max,
+                         hci_stack->le_advertisements_channel_map,
+                         hci_stack->le_advertisements_own_addr_type,
+                         hci_stack->le_advertisements_direct_address_type,
+                         hci_stack->le_advertisements_direct_address,
+                         hci_stack->le_advertisements_filter_policy,
+                         0x7f,  // tx power: no preference
+                         1,     // primary phy: 1M
+                         0,     // secondary max skip
+                         1,     // secondary phy: 1M
+                         0,     // advertising sid
+                         0);    // scan request notification disabled
+            return true;
+        }
+#endif
         hci_send_cmd(&hci_le_set_advertising_parameters,
                      hci_stack->le_advertisements_interval_min,
                      hci_stack->le_advertisements_interval_max,
@@ -4483,6 +5452,12 @@ static bool hci_run_general_gap_le(void){
         (void)memcpy(adv_data_clean, hci_stack->le_advertisements_data,
                      hci_stack->le_advertisements_data_len);
         btstack_replace_bd_addr_placeholder(adv_data_clean, hci_stack->le_advertisements_data_len, hci_stack->local_bd_addr);
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+        if (hci_le_extended_advertising_supported()){
+            hci_send_cmd(&hci_le_set_extended_advertising_data, 0, 3, 1, hci_stack->le_advertisements_data_len, adv_data_clean);
+            return true;
+        }
+#endif
         hci_send_cmd(&hci_le_set_advertising_data, hci_stack->le_advertisements_data_len, adv_data_clean);
         return true;
     }
@@ -4493,9 +5468,25 @@ static bool hci_run_general_gap_le(void){
         (void)memcpy(scan_data_clean, hci_stack->le_scan_response_data,
                      hci_stack->le_scan_response_data_len);
         btstack_replace_bd_addr_placeholder(scan_data_clean, hci_stack->le_scan_response_data_len, hci_stack->local_bd_addr);
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+        if (hci_le_extended_advertising_supported()){
+            hci_send_cmd(&hci_le_set_extended_scan_response_data, 0, 3, 1, hci_stack->le_scan_response_data_len, scan_data_clean);
+            return true;
+        }
+#endif
         hci_send_cmd(&hci_le_set_scan_response_data, hci_stack->le_scan_response_data_len, scan_data_clean);
         return true;
     }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_ADDRESS){
+        hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+        hci_send_cmd(&hci_le_set_advertising_set_random_address, 0, hci_stack->le_random_address);
+        return true;
+    }
+    if (hci_run_general_gap_le_advertising_sets_modify()){
+        return true;
+    }
+#endif
 #endif
 
 
@@ -4619,7 +5610,7 @@ static bool hci_run_general_gap_le(void){
     // re-start scanning
     if ((hci_stack->le_scanning_enabled && !hci_stack->le_scanning_active)){
         hci_stack->le_scanning_active = true;
-        hci_send_cmd(&hci_le_set_scan_enable, 1, 0);
+        hci_send_le_scan_enable(1);
         return true;
     }
 #endif
@@ -4629,22 +5620,7 @@ static bool hci_run_general_gap_le(void){
     if ( (hci_stack->le_connecting_state == LE_CONNECTING_IDLE) && (hci_stack->le_connecting_request == LE_CONNECTING_WHITELIST)){
         bd_addr_t null_addr;
         memset(null_addr, 0, 6);
-        hci_stack->le_connection_own_addr_type =  hci_stack->le_own_addr_type;
-        hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, hci_stack->le_connection_own_address);
-        hci_send_cmd(&hci_le_create_connection,
-                     hci_stack->le_connection_scan_interval,    // scan interval: 60 ms
-                     hci_stack->le_connection_scan_window,    // scan interval: 30 ms
-                     1,         // use whitelist
-                     0,         // peer address type
-                     null_addr, // peer bd addr
-                     hci_stack->le_connection_own_addr_type,   // our addr type:
-                     hci_stack->le_connection_interval_min,    // conn interval min
-                     hci_stack->le_connection_interval_max,    // conn interval max
-                     hci_stack->le_connection_latency,         // conn latency
-                     hci_stack->le_supervision_timeout,        // conn latency
-                     hci_stack->le_minimum_ce_length,          // min ce length
-                     hci_stack->le_maximum_ce_length           // max ce length
-        );
+        hci_send_le_create_connection(1, BD_ADDR_TYPE_LE_PUBLIC, null_addr);
         return true;
     }
 #endif
@@ -4655,9 +5631,42 @@ static bool hci_run_general_gap_le(void){
         // check if advertisements should be enabled given
         hci_stack->le_advertisements_active = true;
         hci_get_own_address_for_addr_type(hci_stack->le_advertisements_own_addr_type, hci_stack->le_advertisements_own_address);
-        hci_send_cmd(&hci_le_set_advertise_enable, 1);
+        hci_send_le_advertise_enable(1);
+        return true;
+    }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (hci_run_general_gap_le_advertising_sets_start()){
         return true;
     }
+#endif
+#endif
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+#ifdef ENABLE_LE_CENTRAL
+    // periodic advertising sync
+    switch (hci_stack->le_periodic_sync_state){
+        case LE_PERIODIC_SYNC_SEND_CREATE:
+            hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_W4_ESTABLISHMENT;
+            hci_send_cmd(&hci_le_periodic_advertising_create_sync, hci_stack->le_periodic_sync_options,
+                         hci_stack->le_periodic_sync_advertising_sid, hci_stack->le_periodic_sync_advertiser_address_type,
+                         hci_stack->le_periodic_sync_advertiser_address, hci_stack->le_periodic_sync_skip,
+                         hci_stack->le_periodic_sync_timeout, hci_stack->le_periodic_sync_cte_type);
+            return true;
+        case LE_PERIODIC_SYNC_SEND_CANCEL:
+            // LE Periodic Advertising Sync Established with status Operation Cancelled by Host follows
+            hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_W4_ESTABLISHMENT;
+            hci_send_cmd(&hci_le_periodic_advertising_create_sync_cancel);
+            return true;
+        default:
+            break;
+    }
+    if (hci_stack->le_periodic_terminate_sync_handle != HCI_CON_HANDLE_INVALID){
+        uint16_t sync_handle = hci_stack->le_periodic_terminate_sync_handle;
+        hci_stack->le_periodic_terminate_sync_handle = HCI_CON_HANDLE_INVALID;
+        hci_send_cmd(&hci_le_periodic_advertising_terminate_sync, sync_handle);
+        return true;
+    }
+#endif
 #endif
 
     return false;
@@ -4682,22 +5691,7 @@ static bool hci_run_general_pending_commands(void){
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
                         log_info("sending hci_le_create_connection");
-                        hci_stack->le_connection_own_addr_type =  hci_stack->le_own_addr_type;
-                        hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, hci_stack->le_connection_own_address);
-                        hci_send_cmd(&hci_le_create_connection,
-                                     hci_stack->le_connection_scan_interval,    // conn scan interval
-                                     hci_stack->le_connection_scan_window,      // conn scan windows
-                                     0,         // don't use whitelist
-                                     connection->address_type, // peer address type
-                                     connection->address,      // peer bd addr
-                                     hci_stack->le_connection_own_addr_type,   // our addr type:
-                                     hci_stack->le_connection_interval_min,    // conn interval min
-                                     hci_stack->le_connection_interval_max,    // conn interval max
-                                     hci_stack->le_connection_latency,         // conn latency
-                                     hci_stack->le_supervision_timeout,        // conn latency
-                                     hci_stack->le_minimum_ce_length,          // min ce length
-                                     hci_stack->le_maximum_ce_length          // max ce length
-                        );
+                        hci_send_le_create_connection(0, connection->address_type, connection->address);
                         connection->state = SENT_CREATE_CONNECTION;
 #endif
 #endif
@@ -5009,18 +6003,46 @@ static bool hci_run_general_pending_commands(void){
             hci_send_cmd(&hci_le_set_phy, connection->con_handle, all_phys, connection->le_phy_update_tx_phys, connection->le_phy_update_rx_phys, connection->le_phy_update_phy_options);
             return true;
         }
+        if (connection->le_data_length_update_tx_octets != 0u){
+            uint16_t tx_octets = connection->le_data_length_update_tx_octets;
+            connection->le_data_length_update_tx_octets = 0;
+            hci_send_cmd(&hci_le_set_data_length, connection->con_handle, tx_octets, connection->le_data_length_update_tx_time);
+            return true;
+        }
 #endif
     }
     return false;
 }
 
+// returns true if command was sent
+static bool hci_run_general_commands(void){
+    bool done;
+
+    // global/non-connection oriented commands
+
+#ifdef ENABLE_CLASSIC
+    // general gap classic
+    done = hci_run_general_gap_classic();
+    if (done) return true;
+#endif
+
+#ifdef ENABLE_BLE
+    // general gap le
+    done = hci_run_general_gap_le();
+    if (done) return true;
+#endif
+
+    // send pending HCI commands
+    return hci_run_general_pending_commands();
+}
+
 static void hci_run(void){
 
     // stack state sub statemachines
     // halting needs to be called even if we cannot send command packet now
     switch (hci_stack->state) {
         case HCI_STATE_INITIALIZING:
-            hci_initializing_run();
+            hci_initializing_run_pipelined();
             break;
         case HCI_STATE_HALTING:
             hci_halting_run();
@@ -5047,25 +6069,14 @@ static void hci_run(void){
     }
 #endif
 
-    if (!hci_can_send_command_packet_now()) return;
-
-    // global/non-connection oriented commands
-
-
-#ifdef ENABLE_CLASSIC
-    // general gap classic
-    done = hci_run_general_gap_classic();
-    if (done) return;
-#endif
-
-#ifdef ENABLE_BLE
-    // general gap le
-    done = hci_run_general_gap_le();
-    if (done) return;
-#endif
-
-    // send pending HCI commands
-    hci_run_general_pending_commands();
+    // send commands back-to-back as long as the Controller accepts them
+    while (hci_can_send_command_packet_now()){
+        uint8_t num_cmd_packets = hci_stack->num_cmd_packets;
+        done = hci_run_general_commands();
+        if (!done) return;
+        // stop if no command was sent
+        if (hci_stack->num_cmd_packets == num_cmd_packets) return;
+    }
 }
 
 int hci_send_cmd_packet(uint8_t *packet, int size){
@@ -5158,6 +6169,10 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
         case HCI_OPCODE_HCI_LE_SET_RANDOM_ADDRESS:
             hci_stack->le_random_address_set = 1;
             reverse_bd_addr(&packet[3], hci_stack->le_random_address);
+#if defined(ENABLE_LE_PERIPHERAL) && defined(ENABLE_LE_EXTENDED_ADVERTISING)
+            // advertising sets have their own random address
+            hci_le_advertising_sets_random_address_changed();
+#endif
             break;
 #ifdef ENABLE_LE_PERIPHERAL
         case HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE:
@@ -5184,6 +6199,16 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
             hci_stack->outgoing_addr_type = (bd_addr_type_t) packet[8]; // peer addres type
             reverse_bd_addr( &packet[9], hci_stack->outgoing_addr); // peer address
             break;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+        case HCI_OPCODE_HCI_LE_EXTENDED_CREATE_CONNECTION:
+            // white list used?
+            initiator_filter_policy = packet[3];
+            hci_stack->le_connecting_state = (initiator_filter_policy == 0) ? LE_CONNECTING_DIRECT : LE_CONNECTING_WHITELIST;
+            // track outgoing connection
+            hci_stack->outgoing_addr_type = (bd_addr_type_t) packet[5]; // peer addres type
+            reverse_bd_addr( &packet[6], hci_stack->outgoing_addr); // peer address
+            break;
+#endif
         case HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL:
             hci_stack->le_connecting_state = LE_CONNECTING_CANCEL;
             break;
@@ -5194,6 +6219,7 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
     }
 
     hci_stack->num_cmd_packets--;
+    hci_command_outstanding_add(opcode);
 
     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet, size);
     return hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, packet, size);
@@ -5284,7 +6310,23 @@ static void hci_emit_event(uint8_t * event, uint16_t size, int dump){
         hci_dump_packet( HCI_EVENT_PACKET, 0, event, size);
     } 
 
-    // dispatch to all event handlers
+#ifdef ENABLE_HCI_EVENT_DISPATCH_TABLE
+    // dispatch to interested event handlers from dispatch table in order of registration
+    hci_event_dispatch_mask_t mask = hci_stack->event_dispatch_events[event[0]];
+    if ((event[0] == HCI_EVENT_LE_META) && (size >= 3u) && (event[2] < HCI_EVENT_DISPATCH_NUM_LE_SUBEVENTS)){
+        mask |= hci_stack->event_dispatch_le_subevents[event[2]];
+    }
+    uint8_t index = 0;
+    while (mask != 0u){
+        if ((mask & 1u) != 0u){
+            (*hci_stack->event_dispatch_handlers[index]->callback)(HCI_EVENT_PACKET, 0, event, size);
+        }
+        mask >>= 1;
+        index++;
+    }
+#endif
+
+    // dispatch to event handlers that receive all events
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hci_stack->event_handlers);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -5463,6 +6505,22 @@ static void hci_emit_le_connection_complete(uint8_t address_type, const bd_addr_
 #endif
 #endif
 
+#ifdef ENABLE_BLE
+static void hci_emit_le_data_channel_changed(hci_connection_t * conn){
+    log_info("LE data channel changed, handle 0x%04x, phy tx %u rx %u, max octets tx %u rx %u", conn->con_handle,
+             conn->le_tx_phy, conn->le_rx_phy, conn->le_max_tx_octets, conn->le_max_rx_octets);
+    uint8_t event[10];
+    event[0] = GAP_EVENT_LE_DATA_CHANNEL_CHANGED;
+    event[1] = sizeof(event) - 2u;
+    little_endian_store_16(event, 2, conn->con_handle);
+    event[4] = conn->le_tx_phy;
+    event[5] = conn->le_rx_phy;
+    little_endian_store_16(event, 6, conn->le_max_tx_octets);
+    little_endian_store_16(event, 8, conn->le_max_rx_octets);
+    hci_emit_event(event, sizeof(event), 1);
+}
+#endif
+
 static void hci_emit_transport_packet_sent(void){
     // notify upper stack that it might be possible to send again
     uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
@@ -5760,6 +6818,142 @@ void gap_set_scan_parameters(uint8_t scan_type, uint16_t scan_interval, uint16_t
     gap_set_scan_params(scan_type, scan_interval, scan_window, 0);
 }
 
+void gap_scan_register_batch_handler(btstack_packet_handler_t handler){
+    hci_stack->le_advertising_report_batch_handler = handler;
+}
+
+void gap_scan_filter_set_addresses(const gap_scan_filter_address_t * addresses, uint16_t num_addresses){
+    hci_stack->le_scan_filter_addresses = (num_addresses > 0u) ? addresses : NULL;
+    hci_stack->le_scan_filter_num_addresses = num_addresses;
+}
+
+void gap_scan_filter_set_service_uuid16(uint16_t uuid16){
+    hci_stack->le_scan_filter_uuid16 = uuid16;
+}
+
+void gap_scan_filter_set_service_uuid128(const uint8_t * uuid128){
+    hci_stack->le_scan_filter_uuid128_set = uuid128 != NULL;
+    if (uuid128 == NULL) return;
+    (void)memcpy(hci_stack->le_scan_filter_uuid128, uuid128, 16);
+}
+
+void gap_scan_filter_set_rssi_threshold(int8_t rssi_threshold){
+    hci_stack->le_scan_filter_rssi_threshold = rssi_threshold;
+}
+
+void gap_scan_filter_set_duplicate_window(uint16_t window_ms){
+    hci_stack->le_scan_filter_duplicate_window_ms = window_ms;
+    le_scan_duplicates_reset();
+}
+
+void gap_scan_filter_reset(void){
+    gap_scan_filter_set_addresses(NULL, 0);
+    gap_scan_filter_set_service_uuid16(0);
+    gap_scan_filter_set_service_uuid128(NULL);
+    gap_scan_filter_set_rssi_threshold(-128);
+    gap_scan_filter_set_duplicate_window(0);
+}
+
+void gap_advertising_report_iterator_init(gap_advertising_report_iterator_t * it, const uint8_t * event, uint16_t size){
+    it->event     = event;
+    it->size      = size;
+    it->offset    = 3;
+    it->remaining = (size >= 3u) ? event[2] : 0u;
+}
+
+bool gap_advertising_report_iterator_has_more(const gap_advertising_report_iterator_t * it){
+    if (it->remaining == 0u) return false;
+    // event type, address type, address, data length, data, rssi
+    if ((it->offset + 10u) > it->size) return false;
+    return (it->offset + 10u + it->event[it->offset + 8u]) <= it->size;
+}
+
+void gap_advertising_report_iterator_next(gap_advertising_report_iterator_t * it){
+    it->offset += 10u + it->event[it->offset + 8u];
+    it->remaining--;
+}
+
+uint8_t gap_advertising_report_iterator_get_advertising_event_type(const gap_advertising_report_iterator_t * it){
+    return it->event[it->offset];
+}
+
+bd_addr_type_t gap_advertising_report_iterator_get_address_type(const gap_advertising_report_iterator_t * it){
+    return (bd_addr_type_t) it->event[it->offset + 1u];
+}
+
+void gap_advertising_report_iterator_get_address(const gap_advertising_report_iterator_t * it, bd_addr_t address){
+    reverse_bd_addr(&it->event[it->offset + 2u], address);
+}
+
+int8_t gap_advertising_report_iterator_get_rssi(const gap_advertising_report_iterator_t * it){
+    return (int8_t) it->event[it->offset + 9u + it->event[it->offset + 8u]];
+}
+
+uint8_t gap_advertising_report_iterator_get_data_length(const gap_advertising_report_iterator_t * it){
+    return it->event[it->offset + 8u];
+}
+
+const uint8_t * gap_advertising_report_iterator_get_data(const gap_advertising_report_iterator_t * it){
+    return &it->event[it->offset + 9u];
+}
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+uint8_t gap_set_scan_phys(uint8_t scan_phys){
+    // 1M and/or Coded
+    if ((scan_phys == 0u) || ((scan_phys & ~0x05u) != 0u)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    hci_stack->le_scan_phys = scan_phys;
+    hci_stack->le_scanning_param_update = true;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_set_connection_phys(uint8_t initiating_phys){
+    // 1M, 2M, and/or Coded, 2M requires either 1M or Coded for scanning
+    if (((initiating_phys & 0x05u) == 0u) || ((initiating_phys & ~0x07u) != 0u)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    hci_stack->le_connection_phys = initiating_phys;
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+uint8_t gap_periodic_advertising_create_sync(uint8_t options, uint8_t advertising_sid, bd_addr_type_t advertiser_address_type,
+                                             bd_addr_t advertiser_address, uint16_t skip, uint16_t sync_timeout, uint8_t sync_cte_type){
+    if (hci_stack->le_periodic_sync_state != LE_PERIODIC_SYNC_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
+    hci_stack->le_periodic_sync_options = options;
+    hci_stack->le_periodic_sync_advertising_sid = advertising_sid;
+    hci_stack->le_periodic_sync_advertiser_address_type = advertiser_address_type;
+    (void)memcpy(hci_stack->le_periodic_sync_advertiser_address, advertiser_address, 6);
+    hci_stack->le_periodic_sync_skip = skip;
+    hci_stack->le_periodic_sync_timeout = sync_timeout;
+    hci_stack->le_periodic_sync_cte_type = sync_cte_type;
+    hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_SEND_CREATE;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_periodic_advertising_create_sync_cancel(void){
+    switch (hci_stack->le_periodic_sync_state){
+        case LE_PERIODIC_SYNC_SEND_CREATE:
+            // not sent yet
+            hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_IDLE;
+            return ERROR_CODE_SUCCESS;
+        case LE_PERIODIC_SYNC_W4_ESTABLISHMENT:
+            hci_stack->le_periodic_sync_state = LE_PERIODIC_SYNC_SEND_CANCEL;
+            hci_run();
+            return ERROR_CODE_SUCCESS;
+        default:
+            return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+}
+
+uint8_t gap_periodic_advertising_terminate_sync(uint16_t sync_handle){
+    if (hci_stack->le_periodic_terminate_sync_handle != HCI_CON_HANDLE_INVALID) return ERROR_CODE_COMMAND_DISALLOWED;
+    hci_stack->le_periodic_terminate_sync_handle = sync_handle;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+
 uint8_t gap_connect(const bd_addr_t addr, bd_addr_type_t addr_type){
     hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, addr_type);
     if (!conn){
@@ -5991,6 +7185,222 @@ void gap_advertisements_enable(int enabled){
     hci_run();
 }
 
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+static le_advertising_set_t * hci_advertising_set_for_handle(uint8_t advertising_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * item = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        if ((item->tasks & LE_ADVERTISEMENT_TASKS_REMOVE_SET) != 0u) continue;
+        if (item->advertising_handle == advertising_handle) return item;
+    }
+    return NULL;
+}
+
+// configure all parameters and data of an advertising set
+static void hci_le_advertising_set_update_tasks(le_advertising_set_t * advertising_set){
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PARAMS;
+    if (advertising_set->extended_params.own_address_type != BD_ADDR_TYPE_LE_PUBLIC){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+    }
+    if (advertising_set->adv_data != NULL){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADV_DATA;
+    }
+    if (advertising_set->scan_data != NULL){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA;
+    }
+    if (advertising_set->periodic_params.periodic_advertising_interval_min != 0u){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS;
+    }
+    if (advertising_set->periodic_data != NULL){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA;
+    }
+}
+
+static void hci_le_advertising_sets_random_address_changed(void){
+    if (!hci_le_extended_advertising_supported()) return;
+    // legacy advertising
+    if (hci_stack->le_advertisements_own_addr_type != BD_ADDR_TYPE_LE_PUBLIC){
+        hci_stack->le_advertisements_todo |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+    }
+    // advertising sets without random address set by application
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_advertising_set_t * advertising_set = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+        if (advertising_set->extended_params.own_address_type == BD_ADDR_TYPE_LE_PUBLIC) continue;
+        if ((advertising_set->state & LE_ADVERTISEMENT_STATE_RANDOM_ADDRESS_SET) != 0u) continue;
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+    }
+}
+
+static void hci_le_handle_advertising_set_terminated(uint8_t advertising_handle){
+    if (advertising_handle == 0u){
+        // legacy advertising
+        hci_stack->le_advertisements_active = false;
+        return;
+    }
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return;
+    // stopped on connection, timeout, or max events: application needs to start it again
+    advertising_set->state &= ~(LE_ADVERTISEMENT_STATE_ACTIVE | LE_ADVERTISEMENT_STATE_ENABLED);
+}
+
+uint8_t gap_extended_advertising_setup(le_advertising_set_t * storage, const le_extended_advertising_parameters_t * advertising_parameters, uint8_t * out_advertising_handle){
+    if (hci_stack->state == HCI_STATE_WORKING){
+        if (!hci_le_extended_advertising_supported()) return ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE;
+    }
+    // find unused handle, handle 0 is used for legacy advertising
+    uint8_t advertising_handle;
+    for (advertising_handle = 1; advertising_handle <= LE_EXTENDED_ADVERTISING_MAX_HANDLE; advertising_handle++){
+        bool used = false;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_sets);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            le_advertising_set_t * item = (le_advertising_set_t*) btstack_linked_list_iterator_next(&it);
+            if (item == storage) return ERROR_CODE_COMMAND_DISALLOWED;
+            if (item->advertising_handle == advertising_handle) used = true;
+        }
+        if (!used) break;
+    }
+    if (advertising_handle > LE_EXTENDED_ADVERTISING_MAX_HANDLE) return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+
+    memset(storage, 0, sizeof(le_advertising_set_t));
+    storage->advertising_handle = advertising_handle;
+    storage->extended_params = *advertising_parameters;
+    hci_le_advertising_set_update_tasks(storage);
+    btstack_linked_list_add_tail(&hci_stack->le_advertising_sets, (btstack_linked_item_t *) storage);
+    *out_advertising_handle = advertising_handle;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_set_params(uint8_t advertising_handle, const le_extended_advertising_parameters_t * advertising_parameters){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    advertising_set->extended_params = *advertising_parameters;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PARAMS;
+    if (advertising_parameters->own_address_type != BD_ADDR_TYPE_LE_PUBLIC){
+        advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+    }
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_get_params(uint8_t advertising_handle, le_extended_advertising_parameters_t * advertising_parameters){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    *advertising_parameters = advertising_set->extended_params;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_set_random_address(uint8_t advertising_handle, bd_addr_t random_address){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    (void)memcpy(advertising_set->random_address, random_address, 6);
+    advertising_set->state |= LE_ADVERTISEMENT_STATE_RANDOM_ADDRESS_SET;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADDRESS;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_set_adv_data(uint8_t advertising_handle, uint16_t advertising_data_length, const uint8_t * advertising_data){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    if (advertising_data_length > LE_EXTENDED_ADVERTISING_DATA_SIZE) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    advertising_set->adv_data = advertising_data;
+    advertising_set->adv_data_len = advertising_data_length;
+    // restart with first fragment if previous data was only sent partially
+    advertising_set->adv_data_pos = 0;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_ADV_DATA;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_set_scan_response_data(uint8_t advertising_handle, uint16_t scan_response_data_length, const uint8_t * scan_response_data){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    if (scan_response_data_length > LE_EXTENDED_ADVERTISING_DATA_SIZE) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    advertising_set->scan_data = scan_response_data;
+    advertising_set->scan_data_len = scan_response_data_length;
+    advertising_set->scan_data_pos = 0;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_start(uint8_t advertising_handle, uint16_t timeout, uint8_t num_extended_advertising_events){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    advertising_set->state |= LE_ADVERTISEMENT_STATE_ENABLED;
+    advertising_set->enable_timeout = timeout;
+    advertising_set->enable_max_events = num_extended_advertising_events;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_stop(uint8_t advertising_handle){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    advertising_set->state &= ~LE_ADVERTISEMENT_STATE_ENABLED;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_extended_advertising_remove(uint8_t advertising_handle){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    advertising_set->state &= ~(LE_ADVERTISEMENT_STATE_ENABLED | LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED);
+    advertising_set->tasks = LE_ADVERTISEMENT_TASKS_REMOVE_SET;
+    advertising_set->adv_data_pos = 0;
+    advertising_set->scan_data_pos = 0;
+    advertising_set->periodic_data_pos = 0;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+uint8_t gap_periodic_advertising_set_params(uint8_t advertising_handle, const le_periodic_advertising_parameters_t * periodic_advertising_parameters){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    if (periodic_advertising_parameters->periodic_advertising_interval_min < 6u) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    advertising_set->periodic_params = *periodic_advertising_parameters;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_periodic_advertising_set_data(uint8_t advertising_handle, uint16_t periodic_data_length, const uint8_t * periodic_data){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    if (periodic_data_length > LE_EXTENDED_ADVERTISING_DATA_SIZE) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    advertising_set->periodic_data = periodic_data;
+    advertising_set->periodic_data_len = periodic_data_length;
+    advertising_set->periodic_data_pos = 0;
+    advertising_set->tasks |= LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_periodic_advertising_start(uint8_t advertising_handle){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    if (advertising_set->periodic_params.periodic_advertising_interval_min == 0u) return ERROR_CODE_COMMAND_DISALLOWED;
+    advertising_set->state |= LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gap_periodic_advertising_stop(uint8_t advertising_handle){
+    le_advertising_set_t * advertising_set = hci_advertising_set_for_handle(advertising_handle);
+    if (advertising_set == NULL) return ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER;
+    advertising_set->state &= ~LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED;
+    hci_run();
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+#endif
+
 #endif
 
 void hci_le_set_own_address_type(uint8_t own_address_type){
@@ -6087,6 +7497,36 @@ uint8_t gap_le_set_phy(hci_con_handle_t con_handle, uint8_t all_phys, uint8_t tx
     return 0;
 }
 
+uint8_t gap_le_set_data_length(hci_con_handle_t con_handle, uint16_t tx_octets, uint16_t tx_time){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    // valid range: 27-251 octets, 328-17040 us
+    if ((tx_octets < 27u) || (tx_octets > 251u)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    if ((tx_time < 0x0148u) || (tx_time > 0x4290u)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+
+    conn->le_data_length_update_tx_octets = tx_octets;
+    conn->le_data_length_update_tx_time   = tx_time;
+
+    hci_run();
+
+    return ERROR_CODE_SUCCESS;
+}
+
+void gap_le_set_throughput_policy(bool data_length_extension, uint8_t preferred_phys){
+    hci_stack->le_throughput_data_length_extension = data_length_extension;
+    hci_stack->le_throughput_preferred_phys = preferred_phys;
+}
+
+uint8_t gap_le_get_data_channel(hci_con_handle_t con_handle, uint8_t * tx_phy, uint8_t * rx_phy, uint16_t * max_tx_octets, uint16_t * max_rx_octets){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    *tx_phy        = conn->le_tx_phy;
+    *rx_phy        = conn->le_rx_phy;
+    *max_tx_octets = conn->le_max_tx_octets;
+    *max_rx_octets = conn->le_max_rx_octets;
+    return ERROR_CODE_SUCCESS;
+}
+
 static uint8_t hci_whitelist_add(bd_addr_type_t address_type, const bd_addr_t address){
     // check if already in list
     btstack_linked_list_iterator_t it;
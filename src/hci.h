@@ -84,9 +84,12 @@ extern "C" {
 #define HCI_CMD_PAYLOAD_SIZE       255
 
 // Max HCI Command LE payload size:
+// 255 from LE Set Extended Advertising Data command
 // 64 from LE Generate DHKey command
 // 32 from LE Encrypt command
-#if defined(ENABLE_LE_SECURE_CONNECTIONS) && !defined(ENABLE_MICRO_ECC_FOR_LE_SECURE_CONNECTIONS)
+#if defined(ENABLE_LE_EXTENDED_ADVERTISING)
+#define HCI_CMD_PAYLOAD_SIZE_LE 255
+#elif defined(ENABLE_LE_SECURE_CONNECTIONS) && !defined(ENABLE_MICRO_ECC_FOR_LE_SECURE_CONNECTIONS)
 #define HCI_CMD_PAYLOAD_SIZE_LE 64
 #else
 #define HCI_CMD_PAYLOAD_SIZE_LE 32
@@ -151,6 +154,47 @@ extern "C" {
     #endif
 #endif
 
+// max number of HCI Commands in flight, limits the Num_HCI_Command_Packets reported by the Controller
+#ifndef HCI_MAX_OUTSTANDING_COMMANDS
+#define HCI_MAX_OUTSTANDING_COMMANDS 1
+#endif
+
+#if defined(ENABLE_LE_PERIODIC_ADVERTISING) && !defined(ENABLE_LE_EXTENDED_ADVERTISING)
+#error "ENABLE_LE_PERIODIC_ADVERTISING requires ENABLE_LE_EXTENDED_ADVERTISING"
+#endif
+
+// max data of reassembled extended and periodic advertising reports, up to 1650 bytes
+#ifndef LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN
+#define LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN LE_EXTENDED_ADVERTISING_DATA_SIZE
+#endif
+
+// number of advertisers tracked for LE Scan duplicate filter
+#ifndef LE_SCAN_DUPLICATE_FILTER_SIZE
+#define LE_SCAN_DUPLICATE_FILTER_SIZE 16
+#endif
+
+#ifdef ENABLE_HCI_EVENT_DISPATCH_TABLE
+// number of event handlers in the per-event dispatch table, additional handlers receive all events
+#ifndef HCI_EVENT_DISPATCH_MAX_HANDLERS
+#define HCI_EVENT_DISPATCH_MAX_HANDLERS 16
+#endif
+
+#if HCI_EVENT_DISPATCH_MAX_HANDLERS > 16
+#error "HCI_EVENT_DISPATCH_MAX_HANDLERS must not exceed 16"
+#endif
+
+// LE Meta subevents tracked individually by the dispatch table
+#define HCI_EVENT_DISPATCH_NUM_LE_SUBEVENTS 0x40
+#endif
+
+// GAP Advertising Report events: event header + fields before data
+#define GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE 27
+#define GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE 10
+
+// max data in a single report event, larger reports are emitted in multiple events
+#define LE_EXTENDED_ADVERTISING_MAX_FRAGMENT_LEN (255u - (GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE - 2u))
+#define LE_PERIODIC_ADVERTISING_MAX_FRAGMENT_LEN (255u - (GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE - 2u))
+
 // BNEP may uncompress the IP Header by 16 bytes, GATT Client requires two additional bytes for long characteristic reads
 #ifndef HCI_INCOMING_PRE_BUFFER_SIZE
 #ifdef ENABLE_CLASSIC
@@ -276,6 +320,31 @@ typedef enum {
     LE_CONNECTING_WHITELIST,
 } le_connecting_state_t;
 
+// LE Scan duplicate filter entry
+typedef struct {
+    uint32_t  time_ms;
+    uint32_t  data_hash;
+    bd_addr_t address;
+    uint8_t   address_type;
+    uint8_t   event_type;
+} le_scan_duplicate_t;
+
+#ifdef ENABLE_HCI_EVENT_DISPATCH_TABLE
+// event dispatch table entry: bit n set if event_dispatch_handlers[n] is interested in the event
+#if HCI_EVENT_DISPATCH_MAX_HANDLERS > 8
+typedef uint16_t hci_event_dispatch_mask_t;
+#else
+typedef uint8_t  hci_event_dispatch_mask_t;
+#endif
+#endif
+
+typedef enum {
+    LE_PERIODIC_SYNC_IDLE,
+    LE_PERIODIC_SYNC_SEND_CREATE,
+    LE_PERIODIC_SYNC_W4_ESTABLISHMENT,
+    LE_PERIODIC_SYNC_SEND_CANCEL,
+} le_periodic_sync_state_t;
+
 #ifdef ENABLE_BLE
 
 //
@@ -610,12 +679,18 @@ typedef struct {
     uint8_t le_phy_update_rx_phys;
     int8_t  le_phy_update_phy_options;
 
-    // LE Security Manager
-    sm_connection_t sm_connection;
+    // LE Data Length Update via set data length command
+    uint16_t le_data_length_update_tx_octets;  // 0 for idle
+    uint16_t le_data_length_update_tx_time;
 
-#ifdef ENABLE_LE_LIMIT_ACL_FRAGMENT_BY_MAX_OCTETS
+    // LE Data Channel: current PHYs and max payload
+    uint8_t  le_tx_phy;
+    uint8_t  le_rx_phy;
     uint16_t le_max_tx_octets;
-#endif
+    uint16_t le_max_rx_octets;
+
+    // LE Security Manager
+    sm_connection_t sm_connection;
 
     // ATT Connection
     att_connection_t att_connection;
@@ -715,6 +790,8 @@ typedef enum hci_init_state{
 #ifdef ENABLE_BLE
     HCI_INIT_LE_READ_BUFFER_SIZE,
     HCI_INIT_W4_LE_READ_BUFFER_SIZE,
+    HCI_INIT_LE_READ_SUPPORTED_FEATURES,
+    HCI_INIT_W4_LE_READ_SUPPORTED_FEATURES,
     HCI_INIT_WRITE_LE_HOST_SUPPORTED,
     HCI_INIT_W4_WRITE_LE_HOST_SUPPORTED,
     HCI_INIT_LE_SET_EVENT_MASK,
@@ -758,11 +835,23 @@ typedef enum hci_init_state{
 
 enum {
     // Tasks
-    LE_ADVERTISEMENT_TASKS_SET_ADV_DATA  = 1 << 0,
-    LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA = 1 << 1,
-    LE_ADVERTISEMENT_TASKS_SET_PARAMS    = 1 << 2,
+    LE_ADVERTISEMENT_TASKS_SET_ADV_DATA        = 1 << 0,
+    LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA       = 1 << 1,
+    LE_ADVERTISEMENT_TASKS_SET_PARAMS          = 1 << 2,
+    LE_ADVERTISEMENT_TASKS_SET_ADDRESS         = 1 << 3,
+    LE_ADVERTISEMENT_TASKS_SET_PERIODIC_PARAMS = 1 << 4,
+    LE_ADVERTISEMENT_TASKS_SET_PERIODIC_DATA   = 1 << 5,
+    LE_ADVERTISEMENT_TASKS_REMOVE_SET          = 1 << 6,
     // State
-    LE_ADVERTISEMENT_TASKS_PARAMS_SET    = 1 << 7,
+    LE_ADVERTISEMENT_TASKS_PARAMS_SET          = 1 << 7,
+};
+
+enum {
+    LE_ADVERTISEMENT_STATE_ACTIVE             = 1 << 0,
+    LE_ADVERTISEMENT_STATE_ENABLED            = 1 << 1,
+    LE_ADVERTISEMENT_STATE_PERIODIC_ACTIVE    = 1 << 2,
+    LE_ADVERTISEMENT_STATE_PERIODIC_ENABLED   = 1 << 3,
+    LE_ADVERTISEMENT_STATE_RANDOM_ADDRESS_SET = 1 << 4,
 };
 
 enum {
@@ -816,7 +905,15 @@ typedef struct {
     /* callback for SCO data */
     btstack_packet_handler_t sco_packet_handler;
 
-    /* callbacks for events */
+#ifdef ENABLE_HCI_EVENT_DISPATCH_TABLE
+    /* callbacks for events: dispatch table with one bit per handler for each event code and LE Meta subevent */
+    btstack_packet_callback_registration_t * event_dispatch_handlers[HCI_EVENT_DISPATCH_MAX_HANDLERS];
+    uint8_t                  event_dispatch_num_handlers;
+    hci_event_dispatch_mask_t event_dispatch_events[256];
+    hci_event_dispatch_mask_t event_dispatch_le_subevents[HCI_EVENT_DISPATCH_NUM_LE_SUBEVENTS];
+#endif
+
+    /* callbacks for events that receive all events, e.g. did not fit into dispatch table */
     btstack_linked_list_t event_handlers;
 
 #ifdef ENABLE_CLASSIC
@@ -875,6 +972,8 @@ typedef struct {
      
     /* host to controller flow control */
     uint8_t  num_cmd_packets;
+    uint16_t cmd_opcodes_outstanding[HCI_MAX_OUTSTANDING_COMMANDS];
+    uint8_t  cmd_opcodes_outstanding_num;
     uint8_t  acl_packets_total_num;
     uint16_t acl_data_packet_length;
     uint8_t  sco_packets_total_num;
@@ -994,6 +1093,17 @@ typedef struct {
     uint16_t le_connection_scan_window;
     uint8_t  le_connection_own_addr_type;
     bd_addr_t le_connection_own_address;
+
+    // batched advertising reports and scan filter
+    btstack_packet_handler_t          le_advertising_report_batch_handler;
+    const gap_scan_filter_address_t * le_scan_filter_addresses;
+    uint16_t le_scan_filter_num_addresses;
+    uint16_t le_scan_filter_uuid16;
+    bool     le_scan_filter_uuid128_set;
+    uint8_t  le_scan_filter_uuid128[16];
+    int8_t   le_scan_filter_rssi_threshold;
+    uint16_t le_scan_filter_duplicate_window_ms;
+    le_scan_duplicate_t le_scan_duplicates[LE_SCAN_DUPLICATE_FILTER_SIZE];
 #endif
 
     le_connection_parameter_range_t le_connection_parameter_range;
@@ -1029,6 +1139,51 @@ typedef struct {
     uint16_t le_supported_max_tx_time;
 #endif
 
+#ifdef ENABLE_BLE
+    // LE Supported Features, octets 0 and 1
+    uint8_t  le_supported_features[2];
+
+    // throughput policy for new LE connections
+    bool     le_throughput_data_length_extension;
+    uint8_t  le_throughput_preferred_phys;
+#endif
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+#ifdef ENABLE_LE_CENTRAL
+    uint8_t  le_scan_phys;
+    uint8_t  le_connection_phys;
+
+    // reassembly of fragmented extended advertising reports
+    bool     le_extended_advertising_report_active;
+    bool     le_extended_advertising_report_truncated;
+    uint16_t le_extended_advertising_report_len;
+    uint8_t  le_extended_advertising_report[GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE + LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN];
+#endif
+#ifdef ENABLE_LE_PERIPHERAL
+    btstack_linked_list_t le_advertising_sets;
+#endif
+#endif
+
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+#ifdef ENABLE_LE_CENTRAL
+    le_periodic_sync_state_t le_periodic_sync_state;
+    uint8_t          le_periodic_sync_options;
+    uint8_t          le_periodic_sync_advertising_sid;
+    bd_addr_type_t   le_periodic_sync_advertiser_address_type;
+    bd_addr_t        le_periodic_sync_advertiser_address;
+    uint16_t         le_periodic_sync_skip;
+    uint16_t         le_periodic_sync_timeout;
+    uint8_t          le_periodic_sync_cte_type;
+    hci_con_handle_t le_periodic_terminate_sync_handle;
+
+    // reassembly of fragmented periodic advertising reports
+    bool     le_periodic_advertising_report_active;
+    bool     le_periodic_advertising_report_truncated;
+    uint16_t le_periodic_advertising_report_len;
+    uint8_t  le_periodic_advertising_report[GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE + LE_EXTENDED_ADVERTISING_MAX_REPORT_LEN];
+#endif
+#endif
+
     // custom BD ADDR
     bd_addr_t custom_bd_addr; 
     uint8_t   custom_bd_addr_set;
@@ -1144,6 +1299,21 @@ void hci_close(void);
  */
 void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler);
 
+/**
+ * @brief Add event packet handler that only receives the listed events
+ * @note HCI_EVENT_LE_META in event_codes selects all LE Meta subevents, otherwise only the listed subevents are delivered.
+ *       Events are only filtered with ENABLE_HCI_EVENT_DISPATCH_TABLE, which costs about 700 bytes of RAM. Without it, or
+ *       if more than HCI_EVENT_DISPATCH_MAX_HANDLERS handlers are registered, the handler receives all events.
+ * @param callback_handler
+ * @param event_codes list of HCI, BTstack, and GAP event codes
+ * @param num_event_codes
+ * @param le_subevent_codes list of LE Meta subevent codes, can be NULL
+ * @param num_le_subevent_codes
+ */
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes);
+
 /**
  * @brief Registers a packet handler for ACL data. Used by L2CAP
  */
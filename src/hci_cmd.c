@@ -59,6 +59,9 @@
 // calculate combined ogf/ocf value
 #define OPCODE(ogf, ocf) ((ocf) | ((ogf) << 10))
 
+// max number of fields in an array, e.g. 8 parameters per PHY in LE Extended Create Connection
+#define HCI_CMD_MAX_ARRAY_FIELDS 8
+
 /**
  * construct HCI Command based on template
  *
@@ -73,6 +76,10 @@
  *   A: 31 bytes advertising data
  *   S: Service Record (Data Element Sequence)
  *   Q: 32 byte data block, e.g. for X and Y coordinates of P-256 public key
+ *   J: 8-bit length of variable size data block V
+ *   V: variable size data block, e.g. extended advertising data
+ *   [: start of array with one entry for each bit set in the previous 8-bit value, e.g. LE PHYs.
+ *      Fields '1' and '2' inside the array are passed as pointer to uint8_t/uint16_t arrays, ']' ends array
  */
 uint16_t hci_cmd_create_from_template(uint8_t *hci_cmd_buffer, const hci_cmd_t *cmd, va_list argptr){
     
@@ -81,9 +88,10 @@ uint16_t hci_cmd_create_from_template(uint8_t *hci_cmd_buffer, const hci_cmd_t *
     int pos = 3;
     
     const char *format = cmd->format;
-    uint16_t word;
+    uint16_t word = 0;
     uint32_t longword;
     uint8_t * ptr;
+    uint8_t  var_len = 0;
     while (*format) {
         switch(*format) {
             case '1': //  8 bit value
@@ -177,6 +185,43 @@ uint16_t hci_cmd_create_from_template(uint8_t *hci_cmd_buffer, const hci_cmd_t *
                 pos += 32;
                 break;
 #endif
+            case 'J': // 8 bit length of variable size data block
+                // minimal va_arg is int: 2 bytes on 8+16 bit CPUs
+                word = va_arg(argptr, int); // LCOV_EXCL_BR_LINE
+                var_len = word & 0xffu;
+                hci_cmd_buffer[pos++] = var_len;
+                break;
+            case 'V': // variable size data block, length provided by 'J'
+                ptr = va_arg(argptr, uint8_t *); // LCOV_EXCL_BR_LINE
+                (void)memcpy(&hci_cmd_buffer[pos], ptr, var_len);
+                pos += var_len;
+                break;
+            case '[': { // array with one entry for each bit set in previous 8-bit value
+                const void * arrays[HCI_CMD_MAX_ARRAY_FIELDS];
+                const char * fields = format + 1;
+                uint8_t num_fields = 0;
+                while ((fields[num_fields] == '1') || (fields[num_fields] == '2')){
+                    if (num_fields == HCI_CMD_MAX_ARRAY_FIELDS) break;
+                    arrays[num_fields] = va_arg(argptr, const void *); // LCOV_EXCL_BR_LINE
+                    num_fields++;
+                }
+                int num_entries = count_set_bits_uint32(word & 0xffu);
+                int entry;
+                for (entry = 0; entry < num_entries; entry++){
+                    uint8_t field;
+                    for (field = 0; field < num_fields; field++){
+                        if (fields[field] == '1'){
+                            hci_cmd_buffer[pos++] = ((const uint8_t *) arrays[field])[entry];
+                        } else {
+                            little_endian_store_16(hci_cmd_buffer, pos, ((const uint16_t *) arrays[field])[entry]);
+                            pos += 2;
+                        }
+                    }
+                }
+                // continue with ']'
+                format += num_fields;
+                break;
+            }
             case 'K':   // 16 byte OOB Data or Link Key in big endian
                 ptr = va_arg(argptr, uint8_t *); // LCOV_EXCL_BR_LINE
                 reverse_bytes(ptr, &hci_cmd_buffer[pos], 16);
@@ -1435,6 +1480,207 @@ const hci_cmd_t hci_le_set_phy = {
 // LE PHY Update Complete is generated on completion
 };
 
+/**
+ * @param advertising_handle
+ * @param random_address
+ */
+const hci_cmd_t hci_le_set_advertising_set_random_address = {
+    HCI_OPCODE_HCI_LE_SET_ADVERTISING_SET_RANDOM_ADDRESS, "1B"
+    // return: status
+};
+
+/**
+ * @param advertising_handle
+ * @param advertising_event_properties
+ * @param primary_advertising_interval_min in 0.625 ms, range: 0x000020..0xffffff
+ * @param primary_advertising_interval_max in 0.625 ms, range: 0x000020..0xffffff
+ * @param primary_advertising_channel_map
+ * @param own_address_type
+ * @param peer_address_type
+ * @param peer_address
+ * @param advertising_filter_policy
+ * @param advertising_tx_power in dBm, 127 = no preference
+ * @param primary_advertising_phy 1 = 1M, 3 = Coded
+ * @param secondary_advertising_max_skip
+ * @param secondary_advertising_phy 1 = 1M, 2 = 2M, 3 = Coded
+ * @param advertising_sid
+ * @param scan_request_notification_enable
+ */
+const hci_cmd_t hci_le_set_extended_advertising_parameters = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS, "1233111B1111111"
+    // return: status, selected_tx_power
+};
+
+/**
+ * @param advertising_handle
+ * @param operation 0 = intermediate fragment, 1 = first fragment, 2 = last fragment, 3 = complete data, 4 = unchanged data
+ * @param fragment_preference
+ * @param advertising_data_length
+ * @param advertising_data
+ */
+const hci_cmd_t hci_le_set_extended_advertising_data = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA, "111JV"
+    // return: status
+};
+
+/**
+ * @param advertising_handle
+ * @param operation 0 = intermediate fragment, 1 = first fragment, 2 = last fragment, 3 = complete data
+ * @param fragment_preference
+ * @param scan_response_data_length
+ * @param scan_response_data
+ */
+const hci_cmd_t hci_le_set_extended_scan_response_data = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_RESPONSE_DATA, "111JV"
+    // return: status
+};
+
+/**
+ * @note enables/disables a single advertising set
+ * @param enable
+ * @param num_sets = 1
+ * @param advertising_handle
+ * @param duration in 10 ms, 0 = until disabled
+ * @param max_extended_advertising_events, 0 = no maximum
+ */
+const hci_cmd_t hci_le_set_extended_advertising_enable = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE, "11121"
+    // return: status
+};
+
+/**
+ */
+const hci_cmd_t hci_le_read_maximum_advertising_data_length = {
+    HCI_OPCODE_HCI_LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH, ""
+    // return: status, max_advertising_data_length
+};
+
+/**
+ */
+const hci_cmd_t hci_le_read_number_of_supported_advertising_sets = {
+    HCI_OPCODE_HCI_LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS, ""
+    // return: status, num_supported_advertising_sets
+};
+
+/**
+ * @param advertising_handle
+ */
+const hci_cmd_t hci_le_remove_advertising_set = {
+    HCI_OPCODE_HCI_LE_REMOVE_ADVERTISING_SET, "1"
+    // return: status
+};
+
+/**
+ */
+const hci_cmd_t hci_le_clear_advertising_sets = {
+    HCI_OPCODE_HCI_LE_CLEAR_ADVERTISING_SETS, ""
+    // return: status
+};
+
+/**
+ * @param advertising_handle
+ * @param periodic_advertising_interval_min in 1.25 ms, range: 0x0006..0xffff
+ * @param periodic_advertising_interval_max in 1.25 ms, range: 0x0006..0xffff
+ * @param periodic_advertising_properties, bit 6 = include tx power
+ */
+const hci_cmd_t hci_le_set_periodic_advertising_parameters = {
+    HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_PARAMETERS, "1222"
+    // return: status
+};
+
+/**
+ * @param advertising_handle
+ * @param operation 0 = intermediate fragment, 1 = first fragment, 2 = last fragment, 3 = complete data
+ * @param advertising_data_length
+ * @param advertising_data
+ */
+const hci_cmd_t hci_le_set_periodic_advertising_data = {
+    HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_DATA, "11JV"
+    // return: status
+};
+
+/**
+ * @param enable
+ * @param advertising_handle
+ */
+const hci_cmd_t hci_le_set_periodic_advertising_enable = {
+    HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_ENABLE, "11"
+    // return: status
+};
+
+/**
+ * @param own_address_type
+ * @param scanning_filter_policy
+ * @param scanning_phys 1 = 1M, 4 = Coded, 5 = both
+ * @param scan_type array with one entry per PHY
+ * @param scan_interval array with one entry per PHY in 0.625 ms
+ * @param scan_window array with one entry per PHY in 0.625 ms
+ */
+const hci_cmd_t hci_le_set_extended_scan_parameters = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_PARAMETERS, "111[122]"
+    // return: status
+};
+
+/**
+ * @param enable
+ * @param filter_duplicates
+ * @param duration in 10 ms, 0 = until disabled
+ * @param period in 1.28 s, 0 = continuous
+ */
+const hci_cmd_t hci_le_set_extended_scan_enable = {
+    HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_ENABLE, "1122"
+    // return: status
+};
+
+/**
+ * @param initiator_filter_policy
+ * @param own_address_type
+ * @param peer_address_type
+ * @param peer_address
+ * @param initiating_phys 1 = 1M, 2 = 2M, 4 = Coded
+ * @param scan_interval array with one entry per PHY in 0.625 ms
+ * @param scan_window array with one entry per PHY in 0.625 ms
+ * @param conn_interval_min array with one entry per PHY in 1.25 ms
+ * @param conn_interval_max array with one entry per PHY in 1.25 ms
+ * @param conn_latency array with one entry per PHY
+ * @param supervision_timeout array with one entry per PHY in 10 ms
+ * @param minimum_ce_length array with one entry per PHY in 0.625 ms
+ * @param maximum_ce_length array with one entry per PHY in 0.625 ms
+ */
+const hci_cmd_t hci_le_extended_create_connection = {
+    HCI_OPCODE_HCI_LE_EXTENDED_CREATE_CONNECTION, "111B1[22222222]"
+    // LE Connection Complete is generated on completion
+};
+
+/**
+ * @param options
+ * @param advertising_sid
+ * @param advertiser_address_type
+ * @param advertiser_address
+ * @param skip
+ * @param sync_timeout in 10 ms
+ * @param sync_cte_type
+ */
+const hci_cmd_t hci_le_periodic_advertising_create_sync = {
+    HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_CREATE_SYNC, "111B221"
+    // LE Periodic Advertising Sync Established is generated on completion
+};
+
+/**
+ */
+const hci_cmd_t hci_le_periodic_advertising_create_sync_cancel = {
+    HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_CREATE_SYNC_CANCEL, ""
+    // return: status
+};
+
+/**
+ * @param sync_handle
+ */
+const hci_cmd_t hci_le_periodic_advertising_terminate_sync = {
+    HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_TERMINATE_SYNC, "H"
+    // return: status
+};
+
 
 #endif
 
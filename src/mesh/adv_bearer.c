@@ -62,6 +62,12 @@
 #define ADVERTISING_INTERVAL_NONCONNECTABLE_MIN 0xa0
 #define ADVERTISING_INTERVAL_NONCONNECTABLE_MIN_MS (ADVERTISING_INTERVAL_NONCONNECTABLE_MIN * 625 / 1000)
 
+// min advertising interval 20 ms for non-connectable advertisements with LE Extended Advertising
+#define ADVERTISING_INTERVAL_EXTENDED_MIN_MS 20
+
+// LE Extended Advertising Event Properties: legacy ADV_NONCONN_IND
+#define ADVERTISING_EVENT_PROPERTIES_LEGACY_NONCONNECTABLE 0x0010
+
 // num adv bearer message types
 #define NUM_TYPES 3
 
@@ -72,12 +78,28 @@ typedef enum {
     INVALID_ID,
 } message_type_id_t;
 
+// state of legacy advertising, shared with connectable GAP advertisements
 typedef enum {
     STATE_IDLE,
     STATE_BEARER,
     STATE_GAP,
 } state_t;
 
+// queued adv bearer message
+typedef struct {
+    btstack_linked_item_t item;
+    message_type_id_t type_id;
+    // remaining transmissions
+    uint8_t  count;
+    uint16_t interval_ms;
+    // earliest time for next transmission
+    uint32_t next_ms;
+    uint8_t  adv_data_len;
+    uint8_t  adv_data[31];
+} adv_bearer_message_t;
+
+// transmission priority by message type: network pdus first, then provisioning pdus, beacons last
+static const uint8_t adv_bearer_priority[NUM_TYPES] = { 0, 2, 1 };
 
 // prototypes
 static void adv_bearer_run(void);
@@ -85,6 +107,18 @@ static void adv_bearer_run(void);
 // globals
 
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+
+// hci events handled by adv_bearer_packet_handler
+static const uint8_t adv_bearer_hci_event_codes[] = {
+    BTSTACK_EVENT_STATE,
+    GAP_EVENT_ADVERTISING_REPORT,
+};
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+static const uint8_t adv_bearer_hci_le_subevent_codes[] = {
+    HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED,
+};
+#endif
+
 static btstack_timer_source_t adv_timer;
 static int        adv_timer_active;
 static bd_addr_t null_addr;
@@ -92,16 +126,36 @@ static bd_addr_t null_addr;
 static btstack_packet_handler_t client_callbacks[NUM_TYPES];
 static int request_can_send_now[NUM_TYPES];
 static int last_sender;
+static bool emit_can_send_now_active;
 
 // scheduler
 static state_t    adv_bearer_state;
 static uint32_t   gap_adv_next_ms;
 
-// adv bearer packets
+// adv bearer message queue, in order of submission
+static adv_bearer_message_t  adv_bearer_messages[MESH_ADV_BEARER_QUEUE_SIZE];
+static btstack_linked_list_t adv_bearer_messages_free;
+static btstack_linked_list_t adv_bearer_messages_queued;
+
+// adv bearer packet on air with legacy advertising
+static adv_bearer_message_t * adv_bearer_message;
+static uint32_t  adv_bearer_message_start_ms;
 static uint8_t   adv_bearer_buffer[31];
 static uint8_t   adv_bearer_buffer_length;
-static uint8_t   adv_bearer_count;
-static uint16_t  adv_bearer_interval;
+// legacy advertising enabled, non-connectable parameters set
+static bool      adv_bearer_advertising_active;
+static bool      adv_bearer_advertising_params_set;
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// adv bearer messages are sent on LE Advertising Sets if supported by Controller
+static uint8_t                adv_bearer_max_advertising_sets = MESH_ADV_BEARER_MAX_ADVERTISING_SETS;
+static uint8_t                adv_bearer_num_advertising_sets;
+static bool                   adv_bearer_advertising_sets_setup_done;
+static le_advertising_set_t   adv_bearer_advertising_sets[MESH_ADV_BEARER_MAX_ADVERTISING_SETS];
+static uint8_t                adv_bearer_advertising_handles[MESH_ADV_BEARER_MAX_ADVERTISING_SETS];
+static uint16_t               adv_bearer_advertising_intervals_ms[MESH_ADV_BEARER_MAX_ADVERTISING_SETS];
+static adv_bearer_message_t * adv_bearer_advertising_messages[MESH_ADV_BEARER_MAX_ADVERTISING_SETS];
+#endif
 
 // gap advertising
 static int       gap_advertising_enabled;
@@ -116,6 +170,62 @@ static uint8_t   gap_filter_policy  = 0;
 
 static btstack_linked_list_t gap_connectable_advertisements;
 
+static bool adv_bearer_uses_advertising_sets(void){
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    return adv_bearer_num_advertising_sets > 0u;
+#else
+    return false;
+#endif
+}
+
+static void adv_bearer_message_free(adv_bearer_message_t * message){
+    btstack_linked_list_add(&adv_bearer_messages_free, (btstack_linked_item_t *) message);
+}
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+static void adv_bearer_emit_can_send_now(void);
+
+static void adv_bearer_setup_advertising_sets(void){
+    if (adv_bearer_advertising_sets_setup_done) return;
+    adv_bearer_advertising_sets_setup_done = true;
+
+    le_extended_advertising_parameters_t params;
+    memset(&params, 0, sizeof(params));
+    params.advertising_event_properties = ADVERTISING_EVENT_PROPERTIES_LEGACY_NONCONNECTABLE;
+    params.primary_advertising_interval_min = ADVERTISING_INTERVAL_EXTENDED_MIN_MS * 8 / 5;
+    params.primary_advertising_interval_max = ADVERTISING_INTERVAL_EXTENDED_MIN_MS * 8 / 5;
+    params.primary_advertising_channel_map = 0x07;
+    params.own_address_type = (gap_random_address_get_mode() == GAP_RANDOM_ADDRESS_TYPE_OFF) ? BD_ADDR_TYPE_LE_PUBLIC : BD_ADDR_TYPE_LE_RANDOM;
+    params.advertising_tx_power = 127;  // no preference
+    params.primary_advertising_phy = 1;
+    params.secondary_advertising_phy = 1;
+
+    uint8_t i;
+    for (i = 0; i < adv_bearer_max_advertising_sets; i++){
+        uint8_t status = gap_extended_advertising_setup(&adv_bearer_advertising_sets[i], &params, &adv_bearer_advertising_handles[i]);
+        if (status != ERROR_CODE_SUCCESS) break;
+        adv_bearer_advertising_intervals_ms[i] = ADVERTISING_INTERVAL_EXTENDED_MIN_MS;
+        adv_bearer_advertising_messages[i] = NULL;
+    }
+    adv_bearer_num_advertising_sets = i;
+    log_info("ADV Bearer uses %u advertising sets", adv_bearer_num_advertising_sets);
+}
+
+static void adv_bearer_handle_advertising_set_terminated(uint8_t advertising_handle){
+    uint8_t i;
+    for (i = 0; i < adv_bearer_num_advertising_sets; i++){
+        if (adv_bearer_advertising_handles[i] != advertising_handle) continue;
+        if (adv_bearer_advertising_messages[i] == NULL) return;
+        log_debug("Advertising set %u done", advertising_handle);
+        adv_bearer_message_free(adv_bearer_advertising_messages[i]);
+        adv_bearer_advertising_messages[i] = NULL;
+        adv_bearer_emit_can_send_now();
+        adv_bearer_run();
+        return;
+    }
+}
+#endif
+
 // dispatch advertising events
 static void adv_bearer_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     const uint8_t * data;
@@ -127,8 +237,17 @@ static void adv_bearer_packet_handler (uint8_t packet_type, uint16_t channel, ui
             switch(packet[0]){
                 case BTSTACK_EVENT_STATE:
                     if (btstack_event_state_get_state(packet) != HCI_STATE_WORKING) break;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+                    adv_bearer_setup_advertising_sets();
+#endif
                     adv_bearer_run();
                     break;
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+                case HCI_EVENT_LE_META:
+                    if (hci_event_le_meta_get_subevent_code(packet) != HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED) break;
+                    adv_bearer_handle_advertising_set_terminated(hci_subevent_le_advertising_set_terminated_get_advertising_handle(packet));
+                    break;
+#endif
                 case GAP_EVENT_ADVERTISING_REPORT:
                     // only non-connectable ind
                     if (gap_event_advertising_report_get_advertising_event_type(packet) != 0x03) break;
@@ -173,29 +292,75 @@ static void adv_bearer_packet_handler (uint8_t packet_type, uint16_t channel, ui
     }
 }
 
-// round-robin
+// round-robin while messages can be queued
 static void adv_bearer_emit_can_send_now(void){
 
-    if (adv_bearer_count > 0) return;
+    // called from client callback: loop below continues with remaining requests
+    if (emit_can_send_now_active) return;
+    emit_can_send_now_active = true;
+
+    // clients that did not queue a message for can send now
+    uint8_t clients_skipped = 0;
+    while (btstack_linked_list_empty(&adv_bearer_messages_free) == false){
+        int countdown = NUM_TYPES;
+        bool emitted = false;
+        while (countdown--) {
+            last_sender++;
+            if (last_sender == NUM_TYPES) {
+                last_sender = 0;
+            }
+            if ((clients_skipped & (1u << last_sender)) != 0u) continue;
+            if (request_can_send_now[last_sender]){
+                request_can_send_now[last_sender] = 0;
+                // emit can send now
+                log_debug("can send now");
+                int num_free = btstack_linked_list_count(&adv_bearer_messages_free);
+                uint8_t event[3];
+                event[0] = HCI_EVENT_MESH_META;
+                event[1] = 1;
+                event[2] = MESH_SUBEVENT_CAN_SEND_NOW;
+                (*client_callbacks[last_sender])(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
+                if (btstack_linked_list_count(&adv_bearer_messages_free) == num_free){
+                    clients_skipped |= 1u << last_sender;
+                }
+                emitted = true;
+                break;
+            }
+        }
+        if (emitted == false) break;
+    }
+
+    emit_can_send_now_active = false;
+}
 
-    int countdown = NUM_TYPES;
-    while (countdown--) {
-        last_sender++;
-        if (last_sender == NUM_TYPES) {
-            last_sender = 0;
+// highest priority message ready for transmission, in queue order
+static adv_bearer_message_t * adv_bearer_next_message(uint32_t now){
+    adv_bearer_message_t * next = NULL;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &adv_bearer_messages_queued);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        adv_bearer_message_t * message = (adv_bearer_message_t *) btstack_linked_list_iterator_next(&it);
+        if ((int32_t)(now - message->next_ms) < 0) continue;
+        if ((next == NULL) || (adv_bearer_priority[message->type_id] < adv_bearer_priority[next->type_id])){
+            next = message;
         }
-        if (request_can_send_now[last_sender]){
-            request_can_send_now[last_sender] = 0;
-            // emit can send now
-            log_debug("can send now");
-            uint8_t event[3];
-            event[0] = HCI_EVENT_MESH_META;
-            event[1] = 1;
-            event[2] = MESH_SUBEVENT_CAN_SEND_NOW;
-            (*client_callbacks[last_sender])(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
-            return;
+    }
+    return next;
+}
+
+// earliest transmission of queued message, returns false if queue is empty
+static bool adv_bearer_next_message_ms(uint32_t * next_ms){
+    bool found = false;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &adv_bearer_messages_queued);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        adv_bearer_message_t * message = (adv_bearer_message_t *) btstack_linked_list_iterator_next(&it);
+        if ((found == false) || ((int32_t)(message->next_ms - *next_ms) < 0)){
+            *next_ms = message->next_ms;
+            found = true;
         }
     }
+    return found;
 }
 
 static void adv_bearer_timeout_handler(btstack_timer_source_t * ts){
@@ -205,20 +370,29 @@ static void adv_bearer_timeout_handler(btstack_timer_source_t * ts){
     switch (adv_bearer_state){
         case STATE_GAP:
             log_debug("Timeout (state gap)");
-            gap_advertisements_enable(0);
             if (gap_advertising_enabled){
                 gap_adv_next_ms = now + gap_adv_int_ms - ADVERTISING_INTERVAL_CONNECTABLE_MIN_MS;
                 log_debug("Next adv: %u", gap_adv_next_ms);
             }
+            // advertising stays enabled until next transmission is scheduled
+            adv_bearer_advertising_active = true;
+            adv_bearer_advertising_params_set = false;
             adv_bearer_state = STATE_IDLE;
             break;
         case STATE_BEARER:
             log_debug("Timeout (state bearer)");
-            gap_advertisements_enable(0);
-            adv_bearer_count--;
-            if (adv_bearer_count == 0){
+            adv_bearer_message->count--;
+            if (adv_bearer_message->count == 0){
+                btstack_linked_list_remove(&adv_bearer_messages_queued, (btstack_linked_item_t *) adv_bearer_message);
+                adv_bearer_message_free(adv_bearer_message);
                 adv_bearer_emit_can_send_now();
+            } else {
+                // interleave with other queued messages of same priority
+                adv_bearer_message->next_ms = adv_bearer_message_start_ms + adv_bearer_message->interval_ms;
+                btstack_linked_list_remove(&adv_bearer_messages_queued, (btstack_linked_item_t *) adv_bearer_message);
+                btstack_linked_list_add_tail(&adv_bearer_messages_queued, (btstack_linked_item_t *) adv_bearer_message);
             }
+            adv_bearer_message = NULL;
             adv_bearer_state = STATE_IDLE;
             break;
         default:
@@ -234,13 +408,48 @@ static void adv_bearer_set_timeout(uint32_t time_ms){
     adv_timer_active = 1;
 }
 
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// start ready messages on idle advertising sets, the Controller handles all transmissions of a message
+static void adv_bearer_run_advertising_sets(uint32_t now){
+    uint8_t i;
+    for (i = 0; i < adv_bearer_num_advertising_sets; i++){
+        if (adv_bearer_advertising_messages[i] != NULL) continue;
+        adv_bearer_message_t * message = adv_bearer_next_message(now);
+        if (message == NULL) return;
+        btstack_linked_list_remove(&adv_bearer_messages_queued, (btstack_linked_item_t *) message);
+        adv_bearer_advertising_messages[i] = message;
+
+        uint8_t advertising_handle = adv_bearer_advertising_handles[i];
+        log_debug("Send ADV Bearer message on advertising set %u", advertising_handle);
+        // only update parameters if transmit interval changes
+        uint16_t interval_ms = btstack_max(message->interval_ms, ADVERTISING_INTERVAL_EXTENDED_MIN_MS);
+        if (interval_ms != adv_bearer_advertising_intervals_ms[i]){
+            adv_bearer_advertising_intervals_ms[i] = interval_ms;
+            le_extended_advertising_parameters_t params;
+            (void) gap_extended_advertising_get_params(advertising_handle, &params);
+            params.primary_advertising_interval_min = (uint32_t) interval_ms * 8u / 5u;
+            params.primary_advertising_interval_max = params.primary_advertising_interval_min;
+            (void) gap_extended_advertising_set_params(advertising_handle, &params);
+        }
+        (void) gap_extended_advertising_set_adv_data(advertising_handle, message->adv_data_len, message->adv_data);
+        (void) gap_extended_advertising_start(advertising_handle, 0, message->count);
+    }
+}
+#endif
+
 // scheduler
 static void adv_bearer_run(void){
 
     if (hci_get_state() != HCI_STATE_WORKING) return;
+
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    adv_bearer_run_advertising_sets(now);
+#endif
+
     if (adv_timer_active) return;
     
-    uint32_t now = btstack_run_loop_get_time_ms();
     switch (adv_bearer_state){
         case STATE_IDLE:
             if (gap_advertising_enabled){
@@ -251,7 +460,7 @@ static void adv_bearer_run(void){
                         log_debug("Next adv: %u", gap_adv_next_ms);
                     } else {
                         // queue again
-                        btstack_linked_list_add_tail(&gap_connectable_advertisements, (void*) item);                        
+                        btstack_linked_list_add_tail(&gap_connectable_advertisements, (btstack_linked_item_t *) item);                        
                         // time to advertise again
                         log_debug("Start GAP ADV, %p", item);
                         gap_advertisements_set_params(ADVERTISING_INTERVAL_CONNECTABLE_MIN, ADVERTISING_INTERVAL_CONNECTABLE_MIN, gap_adv_type, gap_direct_address_typ, gap_direct_address, gap_channel_map, gap_filter_policy);
@@ -263,22 +472,50 @@ static void adv_bearer_run(void){
                     }
                 }
             }
-            if (adv_bearer_count > 0){
-                // schedule adv bearer message if enough time
-                // if ((gap_advertising_enabled) == 0 || ((int32_t)(gap_adv_next_ms - now) >= ADVERTISING_INTERVAL_NONCONNECTABLE_MIN_MS)){
+            if (adv_bearer_uses_advertising_sets() == false){
+                adv_bearer_message = adv_bearer_next_message(now);
+            }
+            if (adv_bearer_message != NULL){
                 log_debug("Send ADV Bearer message");
-                // configure LE advertisments: non-conn ind
-                gap_advertisements_set_params(ADVERTISING_INTERVAL_NONCONNECTABLE_MIN, ADVERTISING_INTERVAL_NONCONNECTABLE_MIN, 3, 0, null_addr, 0x07, 0);
+                // configure LE advertisments: non-conn ind, only if used for GAP advertising before
+                if (adv_bearer_advertising_params_set == false){
+                    gap_advertisements_set_params(ADVERTISING_INTERVAL_NONCONNECTABLE_MIN, ADVERTISING_INTERVAL_NONCONNECTABLE_MIN, 3, 0, null_addr, 0x07, 0);
+                    adv_bearer_advertising_params_set = true;
+                }
+                // update data of active advertisement
+                adv_bearer_buffer_length = adv_bearer_message->adv_data_len;
+                (void)memcpy(adv_bearer_buffer, adv_bearer_message->adv_data, adv_bearer_buffer_length);
                 gap_advertisements_set_data(adv_bearer_buffer_length, adv_bearer_buffer);
-                gap_advertisements_enable(1);
+                if (adv_bearer_advertising_active == false){
+                    gap_advertisements_enable(1);
+                    adv_bearer_advertising_active = true;
+                }
+                adv_bearer_message_start_ms = now;
                 adv_bearer_state = STATE_BEARER;
                 adv_bearer_set_timeout(ADVERTISING_INTERVAL_NONCONNECTABLE_MIN_MS);
                 break;
-                // }
             }
-            if (gap_advertising_enabled){
-                // use timer to wait for next adv
-                adv_bearer_set_timeout(gap_adv_next_ms - now);
+            // nothing to send right now
+            if (adv_bearer_advertising_active){
+                gap_advertisements_enable(0);
+                adv_bearer_advertising_active = false;
+            }
+            // use timer to wait for next adv or next transmission
+            {
+                uint32_t next_ms = 0;
+                bool next_ms_valid = false;
+                if (adv_bearer_uses_advertising_sets() == false){
+                    next_ms_valid = adv_bearer_next_message_ms(&next_ms);
+                }
+                if (gap_advertising_enabled){
+                    if ((next_ms_valid == false) || ((int32_t)(gap_adv_next_ms - next_ms) < 0)){
+                        next_ms = gap_adv_next_ms;
+                    }
+                    next_ms_valid = true;
+                }
+                if (next_ms_valid){
+                    adv_bearer_set_timeout(next_ms - now);
+                }
             }
             break;
         default:
@@ -287,18 +524,26 @@ static void adv_bearer_run(void){
 }
 
 //
-static void adv_bearer_prepare_message(const uint8_t * data, uint16_t data_len, uint8_t type, uint8_t count, uint16_t interval){
+static void adv_bearer_prepare_message(message_type_id_t type_id, const uint8_t * data, uint16_t data_len, uint8_t type, uint8_t count, uint16_t interval){
     btstack_assert(data_len <= (sizeof(adv_bearer_buffer)-2));
     log_debug("adv bearer message, type 0x%x\n", type);
+    adv_bearer_message_t * message = (adv_bearer_message_t *) btstack_linked_list_pop(&adv_bearer_messages_free);
+    if (message == NULL){
+        log_error("adv bearer queue full, drop message type 0x%x", type);
+        return;
+    }
     // prepare message
-    adv_bearer_buffer[0] = data_len+1;
-    adv_bearer_buffer[1] = type;
-    (void)memcpy(&adv_bearer_buffer[2], data, data_len);
-    adv_bearer_buffer_length = data_len + 2;
+    message->type_id = type_id;
+    message->adv_data[0] = data_len+1;
+    message->adv_data[1] = type;
+    (void)memcpy(&message->adv_data[2], data, data_len);
+    message->adv_data_len = data_len + 2;
 
     // setup trasmission schedule
-    adv_bearer_count    = count;
-    adv_bearer_interval = interval;
+    message->count       = count;
+    message->interval_ms = interval;
+    message->next_ms     = btstack_run_loop_get_time_ms();
+    btstack_linked_list_add_tail(&adv_bearer_messages_queued, (btstack_linked_item_t *) message);
 }
 
 //////
@@ -311,10 +556,37 @@ static void adv_bearer_request(message_type_id_t type_id){
 void adv_bearer_init(void){
     // register for HCI Events
     hci_event_callback_registration.callback = &adv_bearer_packet_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    hci_add_event_handler_for_events(&hci_event_callback_registration, adv_bearer_hci_event_codes, sizeof(adv_bearer_hci_event_codes),
+                                     adv_bearer_hci_le_subevent_codes, sizeof(adv_bearer_hci_le_subevent_codes));
+#else
+    hci_add_event_handler_for_events(&hci_event_callback_registration, adv_bearer_hci_event_codes, sizeof(adv_bearer_hci_event_codes), NULL, 0);
+#endif
     // idle
     adv_bearer_state = STATE_IDLE; 
     memset(null_addr, 0, 6);
+    // empty queue
+    adv_bearer_messages_free = NULL;
+    adv_bearer_messages_queued = NULL;
+    adv_bearer_message = NULL;
+    adv_bearer_advertising_active = false;
+    adv_bearer_advertising_params_set = false;
+    uint16_t i;
+    for (i = 0; i < MESH_ADV_BEARER_QUEUE_SIZE; i++){
+        adv_bearer_message_free(&adv_bearer_messages[i]);
+    }
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    adv_bearer_num_advertising_sets = 0;
+    adv_bearer_advertising_sets_setup_done = false;
+#endif
+}
+
+void adv_bearer_set_max_advertising_sets(uint8_t num_advertising_sets){
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    adv_bearer_max_advertising_sets = btstack_min(num_advertising_sets, MESH_ADV_BEARER_MAX_ADVERTISING_SETS);
+#else
+    UNUSED(num_advertising_sets);
+#endif
 }
 
 // adv bearer packet handler regisration
@@ -345,17 +617,17 @@ void adv_bearer_request_can_send_now_for_provisioning_pdu(void){
 
 void adv_bearer_send_network_pdu(const uint8_t * data, uint16_t data_len, uint8_t count, uint16_t interval){
     btstack_assert(data_len <= (sizeof(adv_bearer_buffer)-2));
-    adv_bearer_prepare_message(data, data_len, BLUETOOTH_DATA_TYPE_MESH_MESSAGE, count, interval);
+    adv_bearer_prepare_message(MESH_NETWORK_ID, data, data_len, BLUETOOTH_DATA_TYPE_MESH_MESSAGE, count, interval);
     adv_bearer_run();
 }
 void adv_bearer_send_beacon(const uint8_t * data, uint16_t data_len){
     btstack_assert(data_len <= (sizeof(adv_bearer_buffer)-2));
-    adv_bearer_prepare_message(data, data_len, BLUETOOTH_DATA_TYPE_MESH_BEACON, 3, 100);
+    adv_bearer_prepare_message(MESH_BEACON_ID, data, data_len, BLUETOOTH_DATA_TYPE_MESH_BEACON, 3, 100);
     adv_bearer_run();
 }
 void adv_bearer_send_provisioning_pdu(const uint8_t * data, uint16_t data_len){
     btstack_assert(data_len <= (sizeof(adv_bearer_buffer)-2));
-    adv_bearer_prepare_message(data, data_len, BLUETOOTH_DATA_TYPE_PB_ADV, 3, 100);
+    adv_bearer_prepare_message(PB_ADV_ID, data, data_len, BLUETOOTH_DATA_TYPE_PB_ADV, 3, 100);
     adv_bearer_run();
 }
 
@@ -371,11 +643,11 @@ void adv_bearer_advertisements_enable(int enabled){
 }
 
 void adv_bearer_advertisements_add_item(adv_bearer_connectable_advertisement_data_item_t * item){
-    btstack_linked_list_add(&gap_connectable_advertisements, (void*) item);
+    btstack_linked_list_add(&gap_connectable_advertisements, (btstack_linked_item_t *) item);
 }
 
 void adv_bearer_advertisements_remove_item(adv_bearer_connectable_advertisement_data_item_t * item){
-    btstack_linked_list_remove(&gap_connectable_advertisements, (void*) item);
+    btstack_linked_list_remove(&gap_connectable_advertisements, (btstack_linked_item_t *) item);
 }
 
 void adv_bearer_advertisements_set_params(uint16_t adv_int_min, uint16_t adv_int_max, uint8_t adv_type,
@@ -48,6 +48,16 @@
 extern "C" {
 #endif
 
+// number of ADV Bearer messages queued for transmission
+#ifndef MESH_ADV_BEARER_QUEUE_SIZE
+#define MESH_ADV_BEARER_QUEUE_SIZE 8
+#endif
+
+// max number of LE Advertising Sets used for ADV Bearer messages with LE Extended Advertising
+#ifndef MESH_ADV_BEARER_MAX_ADVERTISING_SETS
+#define MESH_ADV_BEARER_MAX_ADVERTISING_SETS 4
+#endif
+
 typedef struct {
 	void * next;
 	uint8_t adv_length;
@@ -59,6 +69,14 @@ typedef struct {
  */
 void adv_bearer_init(void);
 
+/**
+ * @brief Set max number of LE Advertising Sets used for ADV Bearer messages
+ * @note requires ENABLE_LE_EXTENDED_ADVERTISING and Controller support, otherwise legacy advertising is used.
+ *       Needs to be called before HCI is working.
+ * @param num_advertising_sets up to MESH_ADV_BEARER_MAX_ADVERTISING_SETS, 0 = legacy advertising, default: MESH_ADV_BEARER_MAX_ADVERTISING_SETS
+ */
+void adv_bearer_set_max_advertising_sets(uint8_t num_advertising_sets);
+
 //
 // Mirror gap.h advertisement API for use with ADV Bearer
 //
@@ -116,6 +134,7 @@ void adv_bearer_request_can_send_now_for_provisioning_pdu(void);
 
 /**
  * Send Mesh Message
+ * @note messages are queued, can send now is emitted as long as the queue has space
  * @param data to send
  * @param data_len max 29 bytes
  * @param count number of transmissions
@@ -56,6 +56,7 @@
 #include "mesh/mesh_configuration_server.h"
 #include "mesh/mesh_health_server.h"
 #include "mesh/mesh_foundation.h"
+#include "mesh/mesh_friend.h"
 #include "mesh/mesh_generic_model.h"
 #include "mesh/mesh_generic_on_off_server.h"
 #include "mesh/mesh_iv_index_seq_number.h"
@@ -1248,6 +1249,11 @@ void mesh_init(void){
     mesh_lower_transport_init();
     mesh_upper_transport_init();
 
+#ifdef ENABLE_MESH_FRIEND
+    // Friend feature
+    mesh_friend_init();
+#endif
+
     // Access layer
     mesh_access_init();
 
@@ -772,6 +772,46 @@ void mesh_access_message_processed(mesh_pdu_t * pdu){
     }
 }
 
+static void mesh_access_message_dispatch(mesh_model_t * model, const mesh_operation_t * operation, mesh_pdu_t * pdu, uint32_t opcode){
+    if (mesh_access_validate_appkey_index(model, mesh_pdu_appkey_index(pdu)) == 0) return;
+    mesh_access_acknowledged_received(mesh_pdu_src(pdu), opcode);
+    mesh_access_received_pdu_refcount++;
+    operation->handler(model, pdu);
+}
+
+// deliver access message to models of element, only to models subscribed to dst for group addresses
+static void mesh_access_message_process_element(mesh_element_t * element, mesh_pdu_t * pdu, uint32_t opcode, uint16_t opcode_size, int check_subscription){
+    uint16_t dst = mesh_pdu_dst(pdu);
+    uint16_t len = mesh_pdu_len(pdu);
+    if (mesh_node_opcode_table_complete()){
+        // lookup models with operation for opcode
+        mesh_model_t * last_model = NULL;
+        mesh_model_operation_iterator_t it;
+        mesh_model_operation_iterator_init(&it, element, opcode);
+        while (mesh_model_operation_iterator_has_next(&it)){
+            const mesh_model_operation_t * entry = mesh_model_operation_iterator_next(&it);
+            // first operation of model with sufficient length
+            if (entry->model == last_model) continue;
+            if ((opcode_size + entry->operation->minimum_length) > len) continue;
+            if (check_subscription && (mesh_model_contains_subscription(entry->model, dst) == 0)) continue;
+            last_model = entry->model;
+            mesh_access_message_dispatch(entry->model, entry->operation, pdu, opcode);
+        }
+    } else {
+        // iterate over models, look for operation
+        mesh_model_iterator_t model_it;
+        mesh_model_iterator_init(&model_it, element);
+        while (mesh_model_iterator_has_next(&model_it)){
+            mesh_model_t * model = mesh_model_iterator_next(&model_it);
+            if (check_subscription && (mesh_model_contains_subscription(model, dst) == 0)) continue;
+            // find opcode in table
+            const mesh_operation_t * operation = mesh_model_lookup_operation(model, pdu);
+            if (operation == NULL) continue;
+            mesh_access_message_dispatch(model, operation, pdu, opcode);
+        }
+    }
+}
+
 static void mesh_access_message_process_handler(mesh_pdu_t * pdu){
 
     // init use count
@@ -787,37 +827,24 @@ static void mesh_access_message_process_handler(mesh_pdu_t * pdu){
         return;
     }
 
-    uint16_t len = mesh_pdu_len(pdu);
-    printf("MESH Access Message, Opcode = %x: ", opcode);
-    printf_hexdump(mesh_pdu_data(pdu), len);
+#ifdef ENABLE_LOG_DEBUG
+    log_debug("MESH Access Message, Opcode = %x: ", opcode);
+    log_debug_hexdump(mesh_pdu_data(pdu), mesh_pdu_len(pdu));
+#endif
 
-    uint16_t src = mesh_pdu_src(pdu);
     uint16_t dst = mesh_pdu_dst(pdu);
-    uint16_t appkey_index = mesh_pdu_appkey_index(pdu);
     if (mesh_network_address_unicast(dst)){
         // loookup element by unicast address
         mesh_element_t * element = mesh_node_element_for_unicast_address(dst);
         if (element != NULL){
-            // iterate over models, look for operation
-            mesh_model_iterator_t model_it;
-            mesh_model_iterator_init(&model_it, element);
-            while (mesh_model_iterator_has_next(&model_it)){
-                mesh_model_t * model = mesh_model_iterator_next(&model_it);
-                // find opcode in table
-                const mesh_operation_t * operation = mesh_model_lookup_operation(model, pdu);
-                if (operation == NULL) continue;
-                if (mesh_access_validate_appkey_index(model, appkey_index) == 0) continue;
-                mesh_access_acknowledged_received(src, opcode);
-                mesh_access_received_pdu_refcount++;
-                operation->handler(model, pdu);
-            }
+            mesh_access_message_process_element(element, pdu, opcode, opcode_size, 0);
         }
     }
     else if (mesh_network_address_group(dst)){
 
-        // handle fixed group address
+        // handle fixed group address: all-proxies, all-friends and all-relays only if feature is enabled, reserved addresses not at all
         if (dst >= 0xff00){
-            int deliver_to_primary_element = 1;
+            int deliver_to_primary_element = 0;
             switch (dst){
                 case MESH_ADDRESS_ALL_PROXIES:
                     if (mesh_foundation_gatt_proxy_get() == 1){
@@ -825,7 +852,9 @@ static void mesh_access_message_process_handler(mesh_pdu_t * pdu){
                     } 
                     break;
                 case MESH_ADDRESS_ALL_FRIENDS:
-                    // TODO: not implemented
+                    if (mesh_foundation_friend_get() == 1){
+                        deliver_to_primary_element = 1;
+                    }
                     break;
                 case MESH_ADDRESS_ALL_RELAYS:
                     if (mesh_foundation_relay_get() == 1){
@@ -839,40 +868,16 @@ static void mesh_access_message_process_handler(mesh_pdu_t * pdu){
                     break;
             }
             if (deliver_to_primary_element){
-                mesh_model_iterator_t model_it;
-                mesh_model_iterator_init(&model_it, mesh_node_get_primary_element());
-                while (mesh_model_iterator_has_next(&model_it)){
-                    mesh_model_t * model = mesh_model_iterator_next(&model_it);
-                    // find opcode in table
-                    const mesh_operation_t * operation = mesh_model_lookup_operation(model, pdu);
-                    if (operation == NULL) continue;
-                    if (mesh_access_validate_appkey_index(model, appkey_index) == 0) continue;
-                    mesh_access_acknowledged_received(src, opcode);
-                    mesh_access_received_pdu_refcount++;
-                    operation->handler(model, pdu);
-                }
+                mesh_access_message_process_element(mesh_node_get_primary_element(), pdu, opcode, opcode_size, 0);
             }
         }
         else {
-            // iterate over all elements / models, check subscription list
+            // iterate over all elements, check subscription list
             mesh_element_iterator_t it;
             mesh_element_iterator_init(&it);
             while (mesh_element_iterator_has_next(&it)){
                 mesh_element_t * element = (mesh_element_t *) mesh_element_iterator_next(&it);
-                mesh_model_iterator_t model_it;
-                mesh_model_iterator_init(&model_it, element);
-                while (mesh_model_iterator_has_next(&model_it)){
-                    mesh_model_t * model = mesh_model_iterator_next(&model_it);
-                    if (mesh_model_contains_subscription(model, dst)){
-                        // find opcode in table
-                        const mesh_operation_t * operation = mesh_model_lookup_operation(model, pdu);
-                        if (operation == NULL) continue;
-                        if (mesh_access_validate_appkey_index(model, appkey_index) == 0) continue;
-                        mesh_access_acknowledged_received(src, opcode);
-                        mesh_access_received_pdu_refcount++;
-                        operation->handler(model, pdu);
-                    }
-                }
+                mesh_access_message_process_element(element, pdu, opcode, opcode_size, 1);
             }
         }
     }
@@ -881,8 +886,10 @@ static void mesh_access_message_process_handler(mesh_pdu_t * pdu){
     mesh_access_message_processed(pdu);
 }
 
-// Mesh Model Publication
+// Mesh Model Publication: pairing heap of models ordered by next publication or retransmission
+// heap nodes are stored in the publication model, so there's no limit on the number of scheduled models
 static btstack_timer_source_t mesh_access_publication_timer;
+static mesh_model_t *         mesh_access_publication_heap_root;
 
 static uint32_t mesh_model_publication_retransmit_count(uint8_t retransmit){
     return retransmit & 0x07u;
@@ -971,109 +978,198 @@ static void mesh_model_trigger_publication(mesh_model_t * mesh_model){
     mesh_upper_transport_request_to_send(&publication_model->send_request);
 }
 
-static void mesh_model_publication_run(btstack_timer_source_t * ts){
+// deadline of scheduled publication or retransmission
+static uint32_t mesh_model_publication_deadline(mesh_model_t * mesh_model){
+    mesh_publication_model_t * publication_model = mesh_model->publication_model;
+    if (publication_model->state == MESH_MODEL_PUBLICATION_STATE_W4_RETRANSMIT_MS){
+        return publication_model->next_retransmit_ms;
+    }
+    return publication_model->next_publication_ms;
+}
 
-    uint32_t now = btstack_run_loop_get_time_ms();
+static int mesh_model_publication_heap_less(mesh_model_t * a, mesh_model_t * b){
+    return btstack_time_delta(mesh_model_publication_deadline(a), mesh_model_publication_deadline(b)) < 0;
+}
 
-    // iterate over elements and models and handle time-based transitions
-    mesh_element_iterator_t element_it;
-    mesh_element_iterator_init(&element_it);
-    while (mesh_element_iterator_has_next(&element_it)){
-        mesh_element_t * element = mesh_element_iterator_next(&element_it);
-        mesh_model_iterator_t model_it;
-        mesh_model_iterator_init(&model_it, element);
-        while (mesh_model_iterator_has_next(&model_it)){
-            mesh_model_t * mesh_model = mesh_model_iterator_next(&model_it);
-            mesh_publication_model_t * publication_model = mesh_model->publication_model;
-            if (publication_model == NULL) continue;
-
-            // check if either timer fired
-            switch (publication_model->state){
-                case MESH_MODEL_PUBLICATION_STATE_W4_PUBLICATION_MS:
-                    if (btstack_time_delta(publication_model->next_publication_ms, now) > 0) break;
-                    publication_model->state = MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY;
-                    break;
-                case MESH_MODEL_PUBLICATION_STATE_W4_RETRANSMIT_MS:
-                    if (btstack_time_delta(publication_model->next_retransmit_ms, now) > 0) break;
-                    publication_model->state = MESH_MODEL_PUBLICATION_STATE_RETRANSMIT_READY;
-                    break;
-                default:
-                    break;
-            }
+static bool mesh_model_publication_heap_contains(mesh_model_t * mesh_model){
+    return (mesh_model == mesh_access_publication_heap_root) || (mesh_model->publication_model->heap_prev != NULL);
+}
 
-            switch (publication_model->state){
-                case MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY:
-                    // schedule next publication and retransmission
-                    mesh_model_publication_setup_publication(publication_model, now);
-                    mesh_model_publication_setup_retransmission(publication_model, now);
-                    mesh_model_trigger_publication(mesh_model);
-                    break;
-                case MESH_MODEL_PUBLICATION_STATE_RETRANSMIT_READY:
-                    // schedule next retransmission
-                    publication_model->retransmit_count--;
-                    mesh_model_publication_setup_retransmission(publication_model, now);
-                    mesh_model_trigger_publication(mesh_model);
-                    break;
-                default:
-                    break;
-            }
-        }
+// meld two detached heaps, returns new root
+static mesh_model_t * mesh_model_publication_heap_meld(mesh_model_t * a, mesh_model_t * b){
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    if (mesh_model_publication_heap_less(b, a)){
+        mesh_model_t * tmp = a;
+        a = b;
+        b = tmp;
     }
-
-    int32_t next_timeout_ms = 0;
-    mesh_element_iterator_init(&element_it);
-    while (mesh_element_iterator_has_next(&element_it)){
-        mesh_element_t * element = mesh_element_iterator_next(&element_it);
-        mesh_model_iterator_t model_it;
-        mesh_model_iterator_init(&model_it, element);
-        while (mesh_model_iterator_has_next(&model_it)){
-            mesh_model_t * mesh_model = mesh_model_iterator_next(&model_it);
-            mesh_publication_model_t * publication_model = mesh_model->publication_model;
-            if (publication_model == NULL) continue;
-
-            // schedule next
-            int32_t timeout_delta_ms;
-            switch (publication_model->state){
-                case MESH_MODEL_PUBLICATION_STATE_W4_PUBLICATION_MS:
-                    timeout_delta_ms = btstack_time_delta(publication_model->next_publication_ms, now);
-                    if (next_timeout_ms == 0 || timeout_delta_ms < next_timeout_ms){
-                        next_timeout_ms = timeout_delta_ms;
-                    }
-                    break;
-                case MESH_MODEL_PUBLICATION_STATE_W4_RETRANSMIT_MS:
-                    timeout_delta_ms = btstack_time_delta(publication_model->next_retransmit_ms, now);
-                    if (next_timeout_ms == 0 || timeout_delta_ms < next_timeout_ms){
-                        next_timeout_ms = timeout_delta_ms;
-                    }
-                    break;
-                default:
-                    break;
-            }
+    // add b as first child of a
+    mesh_publication_model_t * parent = a->publication_model;
+    mesh_publication_model_t * child  = b->publication_model;
+    child->heap_next = parent->heap_child;
+    if (parent->heap_child != NULL){
+        parent->heap_child->publication_model->heap_prev = b;
+    }
+    child->heap_prev = a;
+    parent->heap_child = b;
+    return a;
+}
+
+// two-pass pairing of sibling list, returns new root
+static mesh_model_t * mesh_model_publication_heap_merge_pairs(mesh_model_t * first){
+    // meld pairs from left to right, collect them in reverse order
+    mesh_model_t * pairs = NULL;
+    while (first != NULL){
+        mesh_model_t * a = first;
+        mesh_model_t * b = a->publication_model->heap_next;
+        first = (b != NULL) ? b->publication_model->heap_next : NULL;
+        a->publication_model->heap_prev = NULL;
+        a->publication_model->heap_next = NULL;
+        if (b != NULL){
+            b->publication_model->heap_prev = NULL;
+            b->publication_model->heap_next = NULL;
         }
+        mesh_model_t * pair = mesh_model_publication_heap_meld(a, b);
+        pair->publication_model->heap_next = pairs;
+        pairs = pair;
     }
+    // meld pairs from right to left
+    mesh_model_t * root = NULL;
+    while (pairs != NULL){
+        mesh_model_t * next = pairs->publication_model->heap_next;
+        pairs->publication_model->heap_next = NULL;
+        root = mesh_model_publication_heap_meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
 
-    // remove current timer if active
-    if (ts == NULL){
-        btstack_run_loop_remove_timer(&mesh_access_publication_timer);
+static void mesh_model_publication_heap_remove(mesh_model_t * mesh_model){
+    if (mesh_model_publication_heap_contains(mesh_model) == false) return;
+    mesh_publication_model_t * publication_model = mesh_model->publication_model;
+    mesh_model_t * children = mesh_model_publication_heap_merge_pairs(publication_model->heap_child);
+    publication_model->heap_child = NULL;
+    if (mesh_model == mesh_access_publication_heap_root){
+        mesh_access_publication_heap_root = children;
+        return;
+    }
+    // unlink from parent or previous sibling
+    mesh_model_t * prev = publication_model->heap_prev;
+    mesh_model_t * next = publication_model->heap_next;
+    if (prev->publication_model->heap_child == mesh_model){
+        prev->publication_model->heap_child = next;
+    } else {
+        prev->publication_model->heap_next = next;
+    }
+    if (next != NULL){
+        next->publication_model->heap_prev = prev;
+    }
+    publication_model->heap_prev = NULL;
+    publication_model->heap_next = NULL;
+    mesh_access_publication_heap_root = mesh_model_publication_heap_meld(mesh_access_publication_heap_root, children);
+}
 
+// add model to heap if publication or retransmission is scheduled
+static void mesh_model_publication_heap_add(mesh_model_t * mesh_model){
+    switch (mesh_model->publication_model->state){
+        case MESH_MODEL_PUBLICATION_STATE_W4_PUBLICATION_MS:
+        case MESH_MODEL_PUBLICATION_STATE_W4_RETRANSMIT_MS:
+            break;
+        default:
+            return;
     }
+    if (mesh_model_publication_heap_contains(mesh_model)) return;
+    mesh_access_publication_heap_root = mesh_model_publication_heap_meld(mesh_access_publication_heap_root, mesh_model);
+}
 
-    // new timeout?
-    if (next_timeout_ms == 0) return;
+static void mesh_model_publication_timeout_handler(btstack_timer_source_t * ts);
 
-    // set timer
-    btstack_run_loop_set_timer(&mesh_access_publication_timer, next_timeout_ms);
-    btstack_run_loop_set_timer_handler(&mesh_access_publication_timer, mesh_model_publication_run);
+static void mesh_model_publication_set_timer(uint32_t now){
+    btstack_run_loop_remove_timer(&mesh_access_publication_timer);
+    if (mesh_access_publication_heap_root == NULL) return;
+
+    int32_t timeout_delta_ms = btstack_time_delta(mesh_model_publication_deadline(mesh_access_publication_heap_root), now);
+    if (timeout_delta_ms < 0){
+        timeout_delta_ms = 0;
+    }
+    btstack_run_loop_set_timer(&mesh_access_publication_timer, (uint32_t) timeout_delta_ms);
+    btstack_run_loop_set_timer_handler(&mesh_access_publication_timer, &mesh_model_publication_timeout_handler);
     btstack_run_loop_add_timer(&mesh_access_publication_timer);
 }
 
+// publish or retransmit if ready and schedule next publication or retransmission
+static void mesh_model_publication_run(mesh_model_t * mesh_model, uint32_t now){
+    mesh_publication_model_t * publication_model = mesh_model->publication_model;
+    switch (publication_model->state){
+        case MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY:
+            // schedule next publication and retransmission
+            mesh_model_publication_setup_publication(publication_model, now);
+            mesh_model_publication_setup_retransmission(publication_model, now);
+            mesh_model_trigger_publication(mesh_model);
+            break;
+        case MESH_MODEL_PUBLICATION_STATE_RETRANSMIT_READY:
+            // schedule next retransmission
+            publication_model->retransmit_count--;
+            mesh_model_publication_setup_retransmission(publication_model, now);
+            mesh_model_trigger_publication(mesh_model);
+            break;
+        default:
+            break;
+    }
+    mesh_model_publication_heap_add(mesh_model);
+}
+
+static void mesh_model_publication_timeout_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+    // collect all models that are due to publish them in the same send cycle
+    mesh_model_t * due_models = NULL;
+    mesh_model_t * due_models_tail = NULL;
+    while (mesh_access_publication_heap_root != NULL){
+        mesh_model_t * mesh_model = mesh_access_publication_heap_root;
+        if (btstack_time_delta(mesh_model_publication_deadline(mesh_model), now) > 0) break;
+        mesh_model_publication_heap_remove(mesh_model);
+        mesh_publication_model_t * publication_model = mesh_model->publication_model;
+        if (publication_model->state == MESH_MODEL_PUBLICATION_STATE_W4_RETRANSMIT_MS){
+            publication_model->state = MESH_MODEL_PUBLICATION_STATE_RETRANSMIT_READY;
+        } else {
+            publication_model->state = MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY;
+        }
+        publication_model->due_next = NULL;
+        if (due_models_tail == NULL){
+            due_models = mesh_model;
+        } else {
+            due_models_tail->publication_model->due_next = mesh_model;
+        }
+        due_models_tail = mesh_model;
+    }
+
+    while (due_models != NULL){
+        mesh_model_t * mesh_model = due_models;
+        due_models = mesh_model->publication_model->due_next;
+        mesh_model->publication_model->due_next = NULL;
+        mesh_model_publication_run(mesh_model, now);
+    }
+
+    mesh_model_publication_set_timer(now);
+}
+
+// publish right away
+static void mesh_model_publication_publish_now(mesh_model_t * mesh_model){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    mesh_model_publication_heap_remove(mesh_model);
+    mesh_model->publication_model->state = MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY;
+    mesh_model_publication_run(mesh_model, now);
+    mesh_model_publication_set_timer(now);
+}
+
 void mesh_model_publication_start(mesh_model_t * mesh_model){
     mesh_publication_model_t * publication_model = mesh_model->publication_model;
     if (publication_model == NULL) return;
 
-    // publish right away
-    publication_model->state = MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY;
-    mesh_model_publication_run(NULL);
+    mesh_model_publication_publish_now(mesh_model);
 }
 
 void mesh_model_publication_stop(mesh_model_t * mesh_model){
@@ -1081,13 +1177,14 @@ void mesh_model_publication_stop(mesh_model_t * mesh_model){
     if (publication_model == NULL) return;
 
     // reset state
+    mesh_model_publication_heap_remove(mesh_model);
     publication_model->state = MESH_MODEL_PUBLICATION_STATE_IDLE;
+    mesh_model_publication_set_timer(btstack_run_loop_get_time_ms());
 }
 
 void mesh_access_state_changed(mesh_model_t * mesh_model){
     mesh_publication_model_t * publication_model = mesh_model->publication_model;
     if (publication_model == NULL) return;
-    publication_model->state = MESH_MODEL_PUBLICATION_STATE_PUBLICATION_READY;
-    mesh_model_publication_run(NULL);
-}
 
+    mesh_model_publication_publish_now(mesh_model);
+}
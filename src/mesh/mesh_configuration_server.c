@@ -54,6 +54,7 @@
 #include "mesh/mesh_access.h"
 #include "mesh/mesh_crypto.h"
 #include "mesh/mesh_foundation.h"
+#include "mesh/mesh_friend.h"
 #include "mesh/mesh_iv_index_seq_number.h"
 #include "mesh/mesh_keys.h"
 #include "mesh/mesh_network.h"
@@ -416,6 +417,12 @@ static void config_friend_set_handler(mesh_model_t *mesh_model, mesh_pdu_t * pdu
         if (mesh_foundation_friend_get() != MESH_FOUNDATION_STATE_NOT_SUPPORTED){
             mesh_foundation_friend_set(new_friend_state);
             mesh_foundation_state_store();
+#ifdef ENABLE_MESH_FRIEND
+            // - "If the Friend state is set to 0, all existing friendships shall be terminated"
+            if (new_friend_state == 0){
+                mesh_friend_reset();
+            }
+#endif
         }
 
         // send status
@@ -2135,16 +2142,14 @@ static void config_node_reset_handler(mesh_model_t *mesh_model, mesh_pdu_t * pdu
     mesh_access_message_processed(pdu);
 }
 
-static void low_power_node_poll_timeout_status(mesh_model_t *mesh_model, uint16_t netkey_index_dest, uint16_t dest, uint8_t status){
+static void low_power_node_poll_timeout_status(mesh_model_t *mesh_model, uint16_t netkey_index_dest, uint16_t dest, uint16_t lpn_address, uint32_t poll_timeout){
     UNUSED(mesh_model);
 
     mesh_upper_transport_pdu_t * transport_pdu = mesh_access_setup_message(
         &mesh_foundation_low_power_node_poll_timeout_status,
-        status,
-        0,  // The unicast address of the Low Power node
-        0); // The current value of the PollTimeout timer of the Low Power node
+        lpn_address,
+        poll_timeout);
     if (!transport_pdu) return;
-    printf("TODO: send unicast address of the Low Power node and the current value of the PollTimeout timer, instead of 0s\n");
     // send as segmented access pdu
     config_server_send_message(netkey_index_dest, dest, (mesh_pdu_t *) transport_pdu);
 }
@@ -2152,8 +2157,14 @@ static void low_power_node_poll_timeout_status(mesh_model_t *mesh_model, uint16_
 static void config_low_power_node_poll_timeout_get_handler(mesh_model_t *mesh_model, mesh_pdu_t * pdu){
     mesh_access_parser_state_t parser;
     mesh_access_parser_init(&parser, (mesh_pdu_t*) pdu);
-    printf("TODO: implement get the current value of PollTimeout timer of the Low Power node within a Friend node\n");
-    low_power_node_poll_timeout_status(mesh_model, mesh_pdu_netkey_index(pdu), mesh_pdu_src(pdu), MESH_FOUNDATION_STATUS_SUCCESS);
+    uint16_t lpn_address = mesh_access_parser_get_uint16(&parser);
+
+    // current value of PollTimeout timer of Low Power Node, 0 if no friendship
+    uint32_t poll_timeout = 0;
+#ifdef ENABLE_MESH_FRIEND
+    poll_timeout = mesh_friend_get_poll_timeout(lpn_address);
+#endif
+    low_power_node_poll_timeout_status(mesh_model, mesh_pdu_netkey_index(pdu), mesh_pdu_src(pdu), lpn_address, poll_timeout);
 
     mesh_access_message_processed(pdu);
 }
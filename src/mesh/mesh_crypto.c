@@ -72,8 +72,10 @@ static void (*         mesh_k2_callback)(void * arg);
 static void *          mesh_k2_arg;
 static uint8_t       * mesh_k2_result;
 static uint8_t         mesh_k2_t[16];
-static uint8_t         mesh_k2_t1[18];
+static uint8_t         mesh_k2_t1[16 + 9 + 1];
 static uint8_t         mesh_k2_t2[16];
+static uint8_t         mesh_k2_p[9];
+static uint8_t         mesh_k2_p_len;
 
 static const uint8_t mesh_salt_smk2[] = { 0x4f, 0x90, 0x48, 0x0c, 0x18, 0x71, 0xbf, 0xbf, 0xfd, 0x16, 0x97, 0x1f, 0x4d, 0x8d, 0x10, 0xb1 };
 
@@ -95,9 +97,9 @@ static void mesh_k2_callback_c(void * arg){
     (void)memcpy(&mesh_k2_result[1], mesh_k2_t2, 16);
     //
     (void)memcpy(mesh_k2_t1, mesh_k2_t2, 16);
-    mesh_k2_t1[16] = 0; // p
-    mesh_k2_t1[17] = 0x03;
-    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, 18, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_d, request);
+    (void)memcpy(&mesh_k2_t1[16], mesh_k2_p, mesh_k2_p_len);
+    mesh_k2_t1[16 + mesh_k2_p_len] = 0x03;
+    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, 16 + mesh_k2_p_len + 1, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_d, request);
 }
 static void mesh_k2_callback_b(void * arg){
     btstack_crypto_aes128_cmac_t * request = (btstack_crypto_aes128_cmac_t*) arg;
@@ -106,24 +108,34 @@ static void mesh_k2_callback_b(void * arg){
     mesh_k2_result[0] = mesh_k2_t2[15] & 0x7f;
     //
     (void)memcpy(mesh_k2_t1, mesh_k2_t2, 16);
-    mesh_k2_t1[16] = 0; // p
-    mesh_k2_t1[17] = 0x02;
-    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, 18, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_c, request);
+    (void)memcpy(&mesh_k2_t1[16], mesh_k2_p, mesh_k2_p_len);
+    mesh_k2_t1[16 + mesh_k2_p_len] = 0x02;
+    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, 16 + mesh_k2_p_len + 1, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_c, request);
 }
 static void mesh_k2_callback_a(void * arg){
     btstack_crypto_aes128_cmac_t * request = (btstack_crypto_aes128_cmac_t*) arg;
     log_info("T:");
     log_info_hexdump(mesh_k2_t, 16);
-    mesh_k2_t1[0] = 0; // p
-    mesh_k2_t1[1] = 0x01;
-    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, 2, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_b, request);
+    (void)memcpy(mesh_k2_t1, mesh_k2_p, mesh_k2_p_len);
+    mesh_k2_t1[mesh_k2_p_len] = 0x01;
+    btstack_crypto_aes128_cmac_message(request, mesh_k2_t, mesh_k2_p_len + 1, mesh_k2_t1, mesh_k2_t2, mesh_k2_callback_b, request);
 }
-void mesh_k2(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, uint8_t * result, void (* callback)(void * arg), void * callback_arg){
+static void mesh_k2_with_p(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, const uint8_t * p, uint8_t p_len, uint8_t * result, void (* callback)(void * arg), void * callback_arg){
     mesh_k2_callback = callback;
     mesh_k2_arg      = callback_arg;
     mesh_k2_result   = result;
+    mesh_k2_p_len    = p_len;
+    (void)memcpy(mesh_k2_p, p, p_len);
     btstack_crypto_aes128_cmac_message(request, mesh_salt_smk2, 16, n, mesh_k2_t, mesh_k2_callback_a, request);
 }
+void mesh_k2(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, uint8_t * result, void (* callback)(void * arg), void * callback_arg){
+    // master security credentials: P = 0x00
+    const uint8_t p = 0;
+    mesh_k2_with_p(request, n, &p, 1, result, callback, callback_arg);
+}
+void mesh_k2_friendship(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, const uint8_t * p, uint8_t * result, void (* callback)(void * arg), void * callback_arg){
+    mesh_k2_with_p(request, n, p, 9, result, callback, callback_arg);
+}
 
 
 // mesh k3 - might get moved to btstack_crypto and all vars go into btstack_crypto_mesh_k3_t struct
@@ -66,6 +66,13 @@ void mesh_k1(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, uint16_t
  */
 void mesh_k2(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, uint8_t * result, void (* callback)(void * arg), void * callback_arg);
 
+/**
+ * Calculate mesh k2 function for friendship security credentials
+ * @param p 9 bytes: 0x01 || LPNAddress || FriendAddress || LPNCounter || FriendCounter
+ * @param result 33 bytes (7 bit NID + 16 byte Encryption Key + 16 byte Privacy Key)
+ */
+void mesh_k2_friendship(btstack_crypto_aes128_cmac_t * request, const uint8_t * n, const uint8_t * p, uint8_t * result, void (* callback)(void * arg), void * callback_arg);
+
 /**
  * Calculate mesh k3 function
  */
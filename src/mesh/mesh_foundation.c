@@ -50,7 +50,7 @@ static uint8_t mesh_foundation_default_ttl = 7;
 static uint8_t mesh_foundation_network_transmit = (10 << 3) | 2; // step 300 ms, send 3 times
 static uint8_t mesh_foundation_relay = 0;
 static uint8_t mesh_foundation_relay_retransmit = 0;
-static uint8_t mesh_foundation_friend    = 0; // not supported
+static uint8_t mesh_foundation_friend    = 0;
 static uint8_t mesh_foundation_low_power = 0;
 
 void mesh_foundation_gatt_proxy_set(uint8_t value){
@@ -102,7 +102,11 @@ void mesh_foundation_friend_set(uint8_t value){
     printf("MESH: Friend = 0x%x\n", mesh_foundation_friend);
 }
 uint8_t mesh_foundation_friend_get(void){
+#ifdef ENABLE_MESH_FRIEND
+    return mesh_foundation_friend;
+#else
     return MESH_FOUNDATION_STATE_NOT_SUPPORTED;
+#endif
 }
 
 void mesh_foundation_network_transmit_set(uint8_t network_transmit){
@@ -0,0 +1,924 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "mesh_friend.c"
+
+#include "mesh/mesh_friend.h"
+
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+
+#include "mesh/mesh_crypto.h"
+#include "mesh/mesh_foundation.h"
+#include "mesh/mesh_iv_index_seq_number.h"
+#include "mesh/mesh_keys.h"
+#include "mesh/mesh_lower_transport.h"
+#include "mesh/mesh_node.h"
+
+// - "If the Friend node does not receive a Friend Poll message within 1 second after sending a Friend Offer, ..."
+#define MESH_FRIEND_ESTABLISHMENT_TIMEOUT_MS 1000
+// - Friend Offer Delay: "If the Local Delay value is less than 100 ms, the Friend node shall use 100 ms."
+#define MESH_FRIEND_OFFER_DELAY_MIN_MS 100
+// - Friend Clear Repeat timer: "initial value of 1 second", doubled after each Friend Clear
+#define MESH_FRIEND_CLEAR_REPEAT_MS 1000
+// - "The incomplete timer shall be set to a minimum of 10 seconds"
+#define MESH_FRIEND_SEGMENTS_INCOMPLETE_MS 10000
+
+typedef enum {
+    MESH_FRIENDSHIP_STATE_IDLE = 0,
+    MESH_FRIENDSHIP_STATE_W2_SEND_OFFER,
+    MESH_FRIENDSHIP_STATE_W4_POLL,
+    MESH_FRIENDSHIP_STATE_ESTABLISHED,
+} mesh_friendship_state_t;
+
+typedef enum {
+    MESH_FRIEND_RESPONSE_NONE = 0,
+    MESH_FRIEND_RESPONSE_UPDATE,
+    MESH_FRIEND_RESPONSE_QUEUED_MESSAGE,
+} mesh_friend_response_t;
+
+typedef struct {
+    mesh_friendship_state_t state;
+
+    // Friend Request
+    uint16_t netkey_index;
+    uint16_t lpn_address;
+    uint8_t  num_elements;
+    uint16_t lpn_counter;
+    uint16_t previous_address;
+    uint8_t  receive_delay_ms;
+    uint32_t poll_timeout_ms;
+
+    // Friend Offer
+    uint16_t friend_counter;
+
+    // friendship security credentials
+    mesh_network_key_t friendship_key;
+    bool     credentials_pending;
+    bool     credentials_valid;
+
+    // Friend Poll: FSN of last poll and response to it
+    uint8_t                fsn;
+    mesh_friend_response_t poll_response;
+    // response sent after Receive Delay
+    mesh_friend_response_t pending_response;
+    bool                   subscription_confirm_pending;
+    uint8_t                subscription_transaction_number;
+
+    // Friend Queue
+    btstack_linked_list_t queue;
+    uint8_t               queue_len;
+
+    // Friend Subscription List
+    uint16_t subscription_list[MESH_FRIEND_SUBSCRIPTION_LIST_SIZE];
+
+    // segmented message for Low Power Node, segments are added to Friend Queue once complete
+    btstack_linked_list_t  segments;
+    uint16_t               segments_src;
+    uint16_t               segments_seq_zero;
+    uint8_t                segments_seg_n;
+    uint8_t                segments_ttl;
+    uint32_t               segments_block_ack;
+    bool                   segments_acknowledge;
+    bool                   segments_complete;
+    // acknowledgment timer, incomplete timer
+    btstack_timer_source_t segments_ack_timer;
+    bool                   segments_ack_timer_active;
+    btstack_timer_source_t segments_incomplete_timer;
+
+    // Friend Offer delay, Receive Delay
+    btstack_timer_source_t response_timer;
+    // establishment timeout, PollTimeout
+    btstack_timer_source_t poll_timer;
+    uint32_t               poll_deadline_ms;
+    // Friend Clear procedure
+    btstack_timer_source_t clear_timer;
+    uint32_t               clear_repeat_ms;
+    uint32_t               clear_deadline_ms;
+    bool                   clear_active;
+} mesh_friendship_t;
+
+static mesh_friendship_t mesh_friendships[MESH_FRIEND_MAX_LOW_POWER_NODES];
+
+// number of Friend Offers sent
+static uint16_t mesh_friend_counter;
+
+// friendship security credentials
+static btstack_crypto_aes128_cmac_t mesh_friend_cmac_request;
+static mesh_friendship_t *          mesh_friend_credentials_active;
+static uint8_t                      mesh_friend_credentials_p[9];
+static uint8_t                      mesh_friend_credentials_k2[33];
+
+static void mesh_friend_derive_credentials(void);
+
+static mesh_friendship_t * mesh_friend_friendship_for_lpn(uint16_t lpn_address){
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        mesh_friendship_t * friendship = &mesh_friendships[i];
+        if (friendship->state == MESH_FRIENDSHIP_STATE_IDLE) continue;
+        if (friendship->lpn_address == lpn_address) return friendship;
+    }
+    return NULL;
+}
+
+static mesh_friendship_t * mesh_friend_friendship_get_free(void){
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        if (mesh_friendships[i].state == MESH_FRIENDSHIP_STATE_IDLE) return &mesh_friendships[i];
+    }
+    return NULL;
+}
+
+// SeqZero of segment or Segment Acknowledgment
+static uint16_t mesh_friend_seq_zero(mesh_network_pdu_t * network_pdu){
+    return (big_endian_read_16(mesh_network_pdu_data(network_pdu), 1) >> 2) & 0x1fff;
+}
+
+// remove message at head of Friend Queue
+static mesh_network_pdu_t * mesh_friend_queue_pop(mesh_friendship_t * friendship){
+    mesh_network_pdu_t * network_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&friendship->queue);
+    if (network_pdu == NULL) return NULL;
+    friendship->queue_len--;
+    // message sent in response to last Friend Poll is gone
+    if (friendship->poll_response == MESH_FRIEND_RESPONSE_QUEUED_MESSAGE){
+        friendship->poll_response = MESH_FRIEND_RESPONSE_NONE;
+    }
+    return network_pdu;
+}
+
+// discard oldest message, segments of a segmented message are discarded together
+static void mesh_friend_queue_drop_oldest(mesh_friendship_t * friendship){
+    mesh_network_pdu_t * network_pdu = mesh_friend_queue_pop(friendship);
+    if (network_pdu == NULL) return;
+    if (mesh_network_segmented(network_pdu)){
+        uint16_t src = mesh_network_src(network_pdu);
+        uint16_t seq_zero = mesh_friend_seq_zero(network_pdu);
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &friendship->queue);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            mesh_network_pdu_t * queued_pdu = (mesh_network_pdu_t *) btstack_linked_list_iterator_next(&it);
+            if (mesh_network_segmented(queued_pdu) == 0) continue;
+            if (mesh_network_src(queued_pdu) != src) continue;
+            if (mesh_friend_seq_zero(queued_pdu) != seq_zero) continue;
+            btstack_linked_list_iterator_remove(&it);
+            mesh_network_pdu_free(queued_pdu);
+            friendship->queue_len--;
+        }
+    }
+    mesh_network_pdu_free(network_pdu);
+}
+
+// discard oldest messages until num_pdus fit into Friend Queue
+static void mesh_friend_queue_make_room(mesh_friendship_t * friendship, uint16_t num_pdus){
+    while ((friendship->queue_len + num_pdus) > MESH_FRIEND_QUEUE_SIZE){
+        mesh_friend_queue_drop_oldest(friendship);
+    }
+}
+
+static void mesh_friend_queue_add(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu){
+    mesh_friend_queue_make_room(friendship, 1);
+    btstack_linked_list_add_tail(&friendship->queue, (btstack_linked_item_t *) network_pdu);
+    friendship->queue_len++;
+}
+
+static void mesh_friend_segments_stop_timers(mesh_friendship_t * friendship){
+    btstack_run_loop_remove_timer(&friendship->segments_ack_timer);
+    btstack_run_loop_remove_timer(&friendship->segments_incomplete_timer);
+    friendship->segments_ack_timer_active = false;
+}
+
+static void mesh_friend_segments_drop(mesh_friendship_t * friendship){
+    mesh_friend_segments_stop_timers(friendship);
+    while (!btstack_linked_list_empty(&friendship->segments)){
+        mesh_network_pdu_free((mesh_network_pdu_t *) btstack_linked_list_pop(&friendship->segments));
+    }
+}
+
+static void mesh_friend_terminate(mesh_friendship_t * friendship){
+    log_info("Friendship with LPN %04x terminated", friendship->lpn_address);
+    btstack_run_loop_remove_timer(&friendship->response_timer);
+    btstack_run_loop_remove_timer(&friendship->poll_timer);
+    btstack_run_loop_remove_timer(&friendship->clear_timer);
+    mesh_friend_segments_drop(friendship);
+    while (friendship->queue_len > 0){
+        mesh_friend_queue_drop_oldest(friendship);
+    }
+    if (friendship->credentials_valid){
+        mesh_network_key_friendship_remove(&friendship->friendship_key);
+    }
+    memset(friendship, 0, sizeof(mesh_friendship_t));
+}
+
+static bool mesh_friend_lpn_destination(const mesh_friendship_t * friendship, uint16_t dst){
+    if (mesh_network_address_unicast(dst)){
+        return (dst >= friendship->lpn_address) && (dst < (friendship->lpn_address + friendship->num_elements));
+    }
+    int i;
+    for (i=0;i<MESH_FRIEND_SUBSCRIPTION_LIST_SIZE;i++){
+        if (friendship->subscription_list[i] == dst) return true;
+    }
+    return false;
+}
+
+static void mesh_friend_send_control_message(mesh_friendship_t * friendship, uint16_t dst, uint8_t ttl, bool friendship_credentials,
+                                             const uint8_t * transport_pdu_data, uint8_t transport_pdu_len){
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    if (network_pdu == NULL) return;
+    network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_FRIEND;
+
+    uint8_t nid = 0;
+    mesh_subnet_t * subnet = mesh_subnet_get_by_netkey_index(friendship->netkey_index);
+    if (subnet != NULL){
+        nid = mesh_subnet_get_outgoing_network_key(subnet)->nid;
+    }
+    mesh_network_setup_pdu(network_pdu, friendship->netkey_index, nid, 1, ttl, mesh_sequence_number_next(),
+                           mesh_node_get_primary_element_address(), dst, transport_pdu_data, transport_pdu_len);
+    if (friendship_credentials){
+        mesh_network_send_pdu_with_friendship_credentials(network_pdu, friendship->lpn_address);
+    } else {
+        mesh_network_send_pdu(network_pdu);
+    }
+}
+
+static void mesh_friend_send_offer(mesh_friendship_t * friendship){
+    uint8_t offer[7];
+    offer[0] = (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_OFFER;
+    offer[1] = MESH_FRIEND_RECEIVE_WINDOW_MS;
+    offer[2] = MESH_FRIEND_QUEUE_SIZE;
+    offer[3] = MESH_FRIEND_SUBSCRIPTION_LIST_SIZE;
+    // RSSI of Friend Request is not available in Network Layer
+    offer[4] = 0;
+    big_endian_store_16(offer, 5, friendship->friend_counter);
+    mesh_friend_send_control_message(friendship, friendship->lpn_address, 0, false, offer, sizeof(offer));
+}
+
+static void mesh_friend_send_update(mesh_friendship_t * friendship){
+    uint8_t flags = 0;
+    mesh_subnet_t * subnet = mesh_subnet_get_by_netkey_index(friendship->netkey_index);
+    if ((subnet != NULL) && (subnet->key_refresh == MESH_KEY_REFRESH_SECOND_PHASE)){
+        flags |= 1;
+    }
+    if (mesh_iv_update_active()){
+        flags |= 2;
+    }
+    uint8_t update[7];
+    update[0] = (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_UPDATE;
+    update[1] = flags;
+    big_endian_store_32(update, 2, mesh_get_iv_index());
+    update[6] = (friendship->queue_len > 0) ? 1 : 0;
+    mesh_friend_send_control_message(friendship, friendship->lpn_address, 0, true, update, sizeof(update));
+}
+
+static void mesh_friend_send_queued_message(mesh_friendship_t * friendship){
+    mesh_network_pdu_t * queued_pdu = (mesh_network_pdu_t *) friendship->queue;
+    btstack_assert(queued_pdu != NULL);
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    if (network_pdu == NULL) return;
+    network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_FRIEND;
+    network_pdu->netkey_index = queued_pdu->netkey_index;
+    network_pdu->len = queued_pdu->len;
+    (void)memcpy(network_pdu->data, queued_pdu->data, queued_pdu->len);
+    mesh_network_send_pdu_with_friendship_credentials(network_pdu, friendship->lpn_address);
+}
+
+static void mesh_friend_send_subscription_list_confirm(mesh_friendship_t * friendship){
+    uint8_t confirm[2];
+    confirm[0] = (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_CONFIRM;
+    confirm[1] = friendship->subscription_transaction_number;
+    mesh_friend_send_control_message(friendship, friendship->lpn_address, 0, true, confirm, sizeof(confirm));
+}
+
+static void mesh_friend_send_clear(mesh_friendship_t * friendship){
+    uint8_t clear[5];
+    clear[0] = (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_CLEAR;
+    big_endian_store_16(clear, 1, friendship->lpn_address);
+    big_endian_store_16(clear, 3, friendship->lpn_counter);
+    mesh_friend_send_control_message(friendship, friendship->previous_address, mesh_foundation_default_ttl_get(), false, clear, sizeof(clear));
+}
+
+static void mesh_friend_send_segment_acknowledgment(mesh_friendship_t * friendship){
+    // Segment Acknowledgment with OBO = 1 on behalf of Low Power Node
+    uint8_t ack[7];
+    ack[0] = (uint8_t) MESH_TRANSPORT_OPCODE_ACK;
+    big_endian_store_16(ack, 1, 0x8000u | (friendship->segments_seq_zero << 2));
+    big_endian_store_32(ack, 3, friendship->segments_block_ack);
+    mesh_friend_send_control_message(friendship, friendship->segments_src, friendship->segments_ttl, false, ack, sizeof(ack));
+}
+
+static void mesh_friend_response_timeout(btstack_timer_source_t * ts){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) btstack_run_loop_get_timer_context(ts);
+    switch (friendship->state){
+        case MESH_FRIENDSHIP_STATE_W2_SEND_OFFER:
+            mesh_friend_send_offer(friendship);
+            friendship->state = MESH_FRIENDSHIP_STATE_W4_POLL;
+            btstack_run_loop_set_timer(&friendship->poll_timer, MESH_FRIEND_ESTABLISHMENT_TIMEOUT_MS);
+            btstack_run_loop_add_timer(&friendship->poll_timer);
+            break;
+        case MESH_FRIENDSHIP_STATE_ESTABLISHED:
+            if (friendship->subscription_confirm_pending){
+                friendship->subscription_confirm_pending = false;
+                mesh_friend_send_subscription_list_confirm(friendship);
+            }
+            switch (friendship->pending_response){
+                case MESH_FRIEND_RESPONSE_UPDATE:
+                    mesh_friend_send_update(friendship);
+                    break;
+                case MESH_FRIEND_RESPONSE_QUEUED_MESSAGE:
+                    mesh_friend_send_queued_message(friendship);
+                    break;
+                default:
+                    break;
+            }
+            friendship->pending_response = MESH_FRIEND_RESPONSE_NONE;
+            break;
+        default:
+            break;
+    }
+}
+
+static void mesh_friend_poll_timeout(btstack_timer_source_t * ts){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) btstack_run_loop_get_timer_context(ts);
+    // no Friend Poll within 1 second after Friend Offer or within PollTimeout
+    mesh_friend_terminate(friendship);
+}
+
+static void mesh_friend_clear_timeout(btstack_timer_source_t * ts){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) btstack_run_loop_get_timer_context(ts);
+    // - "The Friend Clear Procedure timer shall be set to 2 * PollTimeout"
+    if ((int32_t)(btstack_run_loop_get_time_ms() - friendship->clear_deadline_ms) >= 0){
+        friendship->clear_active = false;
+        return;
+    }
+    mesh_friend_send_clear(friendship);
+    friendship->clear_repeat_ms *= 2;
+    btstack_run_loop_set_timer(&friendship->clear_timer, friendship->clear_repeat_ms);
+    btstack_run_loop_add_timer(&friendship->clear_timer);
+}
+
+static void mesh_friend_segments_ack_timeout(btstack_timer_source_t * ts){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) btstack_run_loop_get_timer_context(ts);
+    friendship->segments_ack_timer_active = false;
+    mesh_friend_send_segment_acknowledgment(friendship);
+}
+
+static void mesh_friend_segments_incomplete_timeout(btstack_timer_source_t * ts){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) btstack_run_loop_get_timer_context(ts);
+    log_info("Segmented message for LPN %04x incomplete, drop", friendship->lpn_address);
+    mesh_friend_segments_drop(friendship);
+    friendship->segments_src = MESH_ADDRESS_UNSASSIGNED;
+}
+
+static void mesh_friend_restart_poll_timer(mesh_friendship_t * friendship){
+    btstack_run_loop_remove_timer(&friendship->poll_timer);
+    btstack_run_loop_set_timer(&friendship->poll_timer, friendship->poll_timeout_ms);
+    btstack_run_loop_add_timer(&friendship->poll_timer);
+    friendship->poll_deadline_ms = btstack_run_loop_get_time_ms() + friendship->poll_timeout_ms;
+}
+
+// respond after Receive Delay, Low Power Node listens during Receive Window
+static void mesh_friend_schedule_response(mesh_friendship_t * friendship){
+    btstack_run_loop_remove_timer(&friendship->response_timer);
+    btstack_run_loop_set_timer(&friendship->response_timer, friendship->receive_delay_ms);
+    btstack_run_loop_add_timer(&friendship->response_timer);
+}
+
+static void mesh_friend_start_clear_procedure(mesh_friendship_t * friendship){
+    if (!mesh_network_address_unicast(friendship->previous_address)) return;
+    if (friendship->previous_address == mesh_node_get_primary_element_address()) return;
+    friendship->clear_active = true;
+    friendship->clear_repeat_ms = MESH_FRIEND_CLEAR_REPEAT_MS;
+    friendship->clear_deadline_ms = btstack_run_loop_get_time_ms() + (2 * friendship->poll_timeout_ms);
+    mesh_friend_send_clear(friendship);
+    btstack_run_loop_set_timer(&friendship->clear_timer, friendship->clear_repeat_ms);
+    btstack_run_loop_add_timer(&friendship->clear_timer);
+}
+
+static void mesh_friend_store_credentials_p(const mesh_friendship_t * friendship, uint8_t * p){
+    // P = 0x01 || LPNAddress || FriendAddress || LPNCounter || FriendCounter
+    p[0] = 0x01;
+    big_endian_store_16(p, 1, friendship->lpn_address);
+    big_endian_store_16(p, 3, mesh_node_get_primary_element_address());
+    big_endian_store_16(p, 5, friendship->lpn_counter);
+    big_endian_store_16(p, 7, friendship->friend_counter);
+}
+
+static void mesh_friend_credentials_derived(void * arg){
+    mesh_friendship_t * friendship = (mesh_friendship_t *) arg;
+    mesh_friend_credentials_active = NULL;
+
+    // ignore result if friendship was terminated or replaced in the meantime
+    uint8_t p[9];
+    mesh_friend_store_credentials_p(friendship, p);
+    if (friendship->credentials_pending && (memcmp(p, mesh_friend_credentials_p, sizeof(p)) == 0)){
+        friendship->credentials_pending = false;
+        friendship->credentials_valid = true;
+        friendship->friendship_key.netkey_index = friendship->netkey_index;
+        friendship->friendship_key.lpn_address  = friendship->lpn_address;
+        friendship->friendship_key.nid          = mesh_friend_credentials_k2[0];
+        (void)memcpy(friendship->friendship_key.encryption_key, &mesh_friend_credentials_k2[1], 16);
+        (void)memcpy(friendship->friendship_key.privacy_key,    &mesh_friend_credentials_k2[17], 16);
+        mesh_network_key_friendship_add(&friendship->friendship_key);
+    }
+
+    mesh_friend_derive_credentials();
+}
+
+static void mesh_friend_derive_credentials(void){
+    if (mesh_friend_credentials_active != NULL) return;
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        mesh_friendship_t * friendship = &mesh_friendships[i];
+        if (friendship->credentials_pending == false) continue;
+        mesh_subnet_t * subnet = mesh_subnet_get_by_netkey_index(friendship->netkey_index);
+        if (subnet == NULL){
+            mesh_friend_terminate(friendship);
+            continue;
+        }
+        mesh_network_key_t * network_key = mesh_subnet_get_outgoing_network_key(subnet);
+        mesh_friend_credentials_active = friendship;
+        mesh_friend_store_credentials_p(friendship, mesh_friend_credentials_p);
+        mesh_k2_friendship(&mesh_friend_cmac_request, network_key->net_key, mesh_friend_credentials_p, mesh_friend_credentials_k2,
+                           &mesh_friend_credentials_derived, friendship);
+        return;
+    }
+}
+
+static void mesh_friend_handle_request(mesh_network_pdu_t * network_pdu){
+    if (mesh_foundation_friend_get() != 1) return;
+    if (mesh_network_pdu_len(network_pdu) != 11) return;
+
+    const uint8_t * data = mesh_network_pdu_data(network_pdu);
+    uint16_t lpn_address        = mesh_network_src(network_pdu);
+    uint8_t  criteria           = data[1];
+    uint8_t  receive_delay_ms   = data[2];
+    uint32_t poll_timeout       = big_endian_read_24(data, 3);
+    uint16_t previous_address   = big_endian_read_16(data, 6);
+    uint8_t  num_elements       = data[8];
+    uint16_t lpn_counter        = big_endian_read_16(data, 9);
+
+    uint8_t min_queue_size_log      = criteria & 0x07;
+    uint8_t receive_window_factor   = (criteria >> 3) & 0x03;
+
+    // validate parameters
+    if (mesh_network_address_unicast(lpn_address) == 0) return;
+    if (min_queue_size_log == 0) return;
+    if (receive_delay_ms < 0x0a) return;
+    if ((poll_timeout < 0x00000a) || (poll_timeout > 0x34bbff)) return;
+    if (num_elements == 0) return;
+
+    // - "MinQueueSizeLog: minimum number of messages that the Friend node can store in its Friend Queue"
+    if ((1u << min_queue_size_log) > MESH_FRIEND_QUEUE_SIZE) return;
+
+    // new Friend Request from Low Power Node replaces existing friendship
+    mesh_friendship_t * friendship = mesh_friend_friendship_for_lpn(lpn_address);
+    if (friendship != NULL){
+        mesh_friend_terminate(friendship);
+    }
+    friendship = mesh_friend_friendship_get_free();
+    if (friendship == NULL) {
+        log_info("Friend Request from %04x: no resources", lpn_address);
+        return;
+    }
+
+    friendship->netkey_index     = network_pdu->netkey_index;
+    friendship->lpn_address      = lpn_address;
+    friendship->num_elements     = num_elements;
+    friendship->lpn_counter      = lpn_counter;
+    friendship->previous_address = previous_address;
+    friendship->receive_delay_ms = receive_delay_ms;
+    friendship->poll_timeout_ms  = poll_timeout * 100;
+    friendship->friend_counter   = mesh_friend_counter++;
+    friendship->state            = MESH_FRIENDSHIP_STATE_W2_SEND_OFFER;
+    friendship->credentials_pending = true;
+
+    btstack_run_loop_set_timer_handler(&friendship->response_timer, &mesh_friend_response_timeout);
+    btstack_run_loop_set_timer_context(&friendship->response_timer, friendship);
+    btstack_run_loop_set_timer_handler(&friendship->poll_timer, &mesh_friend_poll_timeout);
+    btstack_run_loop_set_timer_context(&friendship->poll_timer, friendship);
+    btstack_run_loop_set_timer_handler(&friendship->clear_timer, &mesh_friend_clear_timeout);
+    btstack_run_loop_set_timer_context(&friendship->clear_timer, friendship);
+    btstack_run_loop_set_timer_handler(&friendship->segments_ack_timer, &mesh_friend_segments_ack_timeout);
+    btstack_run_loop_set_timer_context(&friendship->segments_ack_timer, friendship);
+    btstack_run_loop_set_timer_handler(&friendship->segments_incomplete_timer, &mesh_friend_segments_incomplete_timeout);
+    btstack_run_loop_set_timer_context(&friendship->segments_incomplete_timer, friendship);
+
+    // - "Local Delay = ReceiveWindowFactor * ReceiveWindow - RSSIFactor * RSSI", RSSI not available
+    uint32_t offer_delay_ms = ((2 + receive_window_factor) * MESH_FRIEND_RECEIVE_WINDOW_MS) / 2;
+    offer_delay_ms = btstack_max(offer_delay_ms, MESH_FRIEND_OFFER_DELAY_MIN_MS);
+    btstack_run_loop_set_timer(&friendship->response_timer, offer_delay_ms);
+    btstack_run_loop_add_timer(&friendship->response_timer);
+
+    mesh_friend_derive_credentials();
+}
+
+static void mesh_friend_handle_poll(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu){
+    if (mesh_network_pdu_len(network_pdu) != 2) return;
+    uint8_t fsn = mesh_network_pdu_data(network_pdu)[1] & 1;
+
+    if (friendship->state == MESH_FRIENDSHIP_STATE_W4_POLL){
+        // friendship established, Friend Update first
+        log_info("Friendship with LPN %04x established", friendship->lpn_address);
+        friendship->state = MESH_FRIENDSHIP_STATE_ESTABLISHED;
+        friendship->pending_response = MESH_FRIEND_RESPONSE_UPDATE;
+        mesh_friend_start_clear_procedure(friendship);
+    } else {
+        // - "If the FSN field ... differs from the previous Friend Poll, the message in the Friend Queue has been received"
+        if ((fsn != friendship->fsn) && (friendship->poll_response == MESH_FRIEND_RESPONSE_QUEUED_MESSAGE)){
+            mesh_network_pdu_t * received_pdu = mesh_friend_queue_pop(friendship);
+            if (received_pdu != NULL){
+                mesh_network_pdu_free(received_pdu);
+            }
+        }
+        friendship->pending_response = (friendship->queue_len > 0) ? MESH_FRIEND_RESPONSE_QUEUED_MESSAGE : MESH_FRIEND_RESPONSE_UPDATE;
+    }
+    friendship->fsn = fsn;
+    friendship->poll_response = friendship->pending_response;
+
+    mesh_friend_restart_poll_timer(friendship);
+    mesh_friend_schedule_response(friendship);
+}
+
+static void mesh_friend_handle_subscription_list(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu, bool add){
+    uint8_t len = mesh_network_pdu_len(network_pdu);
+    if ((len < 2) || ((len & 1) != 0)) return;
+    const uint8_t * data = mesh_network_pdu_data(network_pdu);
+
+    uint8_t pos;
+    for (pos = 2; pos < len; pos += 2){
+        uint16_t address = big_endian_read_16(data, pos);
+        if (mesh_network_address_unicast(address) || (address == MESH_ADDRESS_UNSASSIGNED)) continue;
+        int free_index = -1;
+        int i;
+        for (i=0;i<MESH_FRIEND_SUBSCRIPTION_LIST_SIZE;i++){
+            if (friendship->subscription_list[i] == address) break;
+            if ((free_index < 0) && (friendship->subscription_list[i] == MESH_ADDRESS_UNSASSIGNED)) {
+                free_index = i;
+            }
+        }
+        if (add){
+            if ((i == MESH_FRIEND_SUBSCRIPTION_LIST_SIZE) && (free_index >= 0)){
+                friendship->subscription_list[free_index] = address;
+            }
+        } else {
+            if (i < MESH_FRIEND_SUBSCRIPTION_LIST_SIZE){
+                friendship->subscription_list[i] = MESH_ADDRESS_UNSASSIGNED;
+            }
+        }
+    }
+
+    friendship->subscription_transaction_number = data[1];
+    friendship->subscription_confirm_pending = true;
+    mesh_friend_restart_poll_timer(friendship);
+    mesh_friend_schedule_response(friendship);
+}
+
+static void mesh_friend_handle_clear(mesh_network_pdu_t * network_pdu){
+    if (mesh_network_pdu_len(network_pdu) != 5) return;
+    const uint8_t * data = mesh_network_pdu_data(network_pdu);
+    uint16_t lpn_address = big_endian_read_16(data, 1);
+    uint16_t lpn_counter = big_endian_read_16(data, 3);
+
+    mesh_friendship_t * friendship = mesh_friend_friendship_for_lpn(lpn_address);
+    if (friendship == NULL) return;
+
+    // - "the difference between LPNCounter in Friend Clear and in Friend Request is in the range 0 to 255"
+    if ((uint16_t)(lpn_counter - friendship->lpn_counter) > 255) return;
+
+    uint8_t confirm[5];
+    confirm[0] = (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_CLEAR_CONFIRM;
+    big_endian_store_16(confirm, 1, lpn_address);
+    big_endian_store_16(confirm, 3, lpn_counter);
+    mesh_friend_send_control_message(friendship, mesh_network_src(network_pdu), mesh_foundation_default_ttl_get(), false, confirm, sizeof(confirm));
+
+    mesh_friend_terminate(friendship);
+}
+
+static void mesh_friend_handle_clear_confirm(mesh_network_pdu_t * network_pdu){
+    if (mesh_network_pdu_len(network_pdu) != 5) return;
+    const uint8_t * data = mesh_network_pdu_data(network_pdu);
+    mesh_friendship_t * friendship = mesh_friend_friendship_for_lpn(big_endian_read_16(data, 1));
+    if (friendship == NULL) return;
+    if (friendship->clear_active == false) return;
+    if (friendship->previous_address != mesh_network_src(network_pdu)) return;
+    friendship->clear_active = false;
+    btstack_run_loop_remove_timer(&friendship->clear_timer);
+}
+
+void mesh_friend_process_control_message(mesh_network_pdu_t * network_pdu){
+    uint8_t opcode = mesh_network_pdu_data(network_pdu)[0] & 0x7f;
+    uint16_t dst = mesh_network_dst(network_pdu);
+
+    // Friend Request to all friends
+    if (opcode == (uint8_t) MESH_TRANSPORT_OPCODE_FRIEND_REQUEST){
+        if (dst == MESH_ADDRESS_ALL_FRIENDS){
+            mesh_friend_handle_request(network_pdu);
+        }
+        return;
+    }
+
+    if (dst != mesh_node_get_primary_element_address()) return;
+
+    // Friend Clear and Friend Clear Confirm from other Friend nodes use master security credentials
+    if ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) == 0){
+        switch (opcode){
+            case MESH_TRANSPORT_OPCODE_FRIEND_CLEAR:
+                mesh_friend_handle_clear(network_pdu);
+                break;
+            case MESH_TRANSPORT_OPCODE_FRIEND_CLEAR_CONFIRM:
+                mesh_friend_handle_clear_confirm(network_pdu);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    // messages from Low Power Node use friendship security credentials
+    mesh_friendship_t * friendship = mesh_friend_friendship_for_lpn(network_pdu->lpn_address);
+    if (friendship == NULL) return;
+    if (friendship->lpn_address != mesh_network_src(network_pdu)) return;
+
+    switch (opcode){
+        case MESH_TRANSPORT_OPCODE_FRIEND_POLL:
+            if (friendship->state < MESH_FRIENDSHIP_STATE_W4_POLL) break;
+            mesh_friend_handle_poll(friendship, network_pdu);
+            break;
+        case MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_ADD:
+            if (friendship->state != MESH_FRIENDSHIP_STATE_ESTABLISHED) break;
+            mesh_friend_handle_subscription_list(friendship, network_pdu, true);
+            break;
+        case MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_REMOVE:
+            if (friendship->state != MESH_FRIENDSHIP_STATE_ESTABLISHED) break;
+            mesh_friend_handle_subscription_list(friendship, network_pdu, false);
+            break;
+        default:
+            break;
+    }
+}
+
+static void mesh_friend_queue_remove_segment_acknowledgment(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu){
+    // - "the Friend node shall discard older Segment Acknowledgment messages for the same SeqZero and source"
+    uint16_t src = mesh_network_src(network_pdu);
+    uint16_t seq_zero = mesh_friend_seq_zero(network_pdu);
+    mesh_network_pdu_t * head = (mesh_network_pdu_t *) friendship->queue;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &friendship->queue);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_network_pdu_t * queued_pdu = (mesh_network_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (mesh_network_control(queued_pdu) == 0) continue;
+        if (mesh_network_segmented(queued_pdu)) continue;
+        if (mesh_network_control_opcode(queued_pdu) != (uint8_t) MESH_TRANSPORT_OPCODE_ACK) continue;
+        if (mesh_network_src(queued_pdu) != src) continue;
+        if (mesh_friend_seq_zero(queued_pdu) != seq_zero) continue;
+        // keep message sent in response to last Friend Poll
+        if ((queued_pdu == head) && (friendship->poll_response == MESH_FRIEND_RESPONSE_QUEUED_MESSAGE)) continue;
+        btstack_linked_list_iterator_remove(&it);
+        mesh_network_pdu_free(queued_pdu);
+        friendship->queue_len--;
+    }
+}
+
+static mesh_network_pdu_t * mesh_friend_copy_network_pdu(mesh_network_pdu_t * network_pdu, uint8_t ttl){
+    mesh_network_pdu_t * copy = mesh_network_pdu_get();
+    if (copy == NULL) return NULL;
+    copy->netkey_index = network_pdu->netkey_index;
+    copy->len = network_pdu->len;
+    (void)memcpy(copy->data, network_pdu->data, network_pdu->len);
+    copy->data[1] = (network_pdu->data[1] & 0x80) | ttl;
+    return copy;
+}
+
+static void mesh_friend_queue_unsegmented(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu, uint8_t ttl){
+    if (mesh_network_control(network_pdu) && (mesh_network_control_opcode(network_pdu) == (uint8_t) MESH_TRANSPORT_OPCODE_ACK)){
+        mesh_friend_queue_remove_segment_acknowledgment(friendship, network_pdu);
+    }
+    mesh_network_pdu_t * queued_pdu = mesh_friend_copy_network_pdu(network_pdu, ttl);
+    if (queued_pdu == NULL) return;
+    mesh_friend_queue_add(friendship, queued_pdu);
+}
+
+static bool mesh_friend_queue_contains_message(mesh_friendship_t * friendship, uint16_t src, uint16_t seq_zero){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &friendship->queue);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_network_pdu_t * queued_pdu = (mesh_network_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (mesh_network_segmented(queued_pdu) == 0) continue;
+        if (mesh_network_src(queued_pdu) != src) continue;
+        if (mesh_friend_seq_zero(queued_pdu) == seq_zero) return true;
+    }
+    return false;
+}
+
+static bool mesh_friend_queue_contains_segment(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu){
+    uint16_t src = mesh_network_src(network_pdu);
+    const uint8_t * lower_transport_pdu = mesh_network_pdu_data(network_pdu);
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &friendship->queue);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_network_pdu_t * queued_pdu = (mesh_network_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (mesh_network_segmented(queued_pdu) == 0) continue;
+        if (mesh_network_src(queued_pdu) != src) continue;
+        // same SZMIC, SeqZero, SegO and SegN
+        if (memcmp(&mesh_network_pdu_data(queued_pdu)[1], &lower_transport_pdu[1], 3) == 0) return true;
+    }
+    return false;
+}
+
+// collect segments and acknowledge them on behalf of the Low Power Node, queue them when message is complete
+static void mesh_friend_segment_received(mesh_friendship_t * friendship, mesh_network_pdu_t * network_pdu, uint8_t ttl){
+    const uint8_t * data = mesh_network_pdu_data(network_pdu);
+    uint16_t src      = mesh_network_src(network_pdu);
+    uint16_t seq_zero = mesh_friend_seq_zero(network_pdu);
+    uint8_t  seg_o    = (big_endian_read_16(data, 2) >> 5) & 0x1f;
+    uint8_t  seg_n    = data[3] & 0x1f;
+    if (seg_o > seg_n) return;
+    // message that does not fit into Friend Queue is neither collected nor acknowledged
+    if (seg_n >= MESH_FRIEND_QUEUE_SIZE) return;
+
+    bool same_message = (friendship->segments_src == src) && (friendship->segments_seq_zero == seq_zero);
+    if (same_message && friendship->segments_complete){
+        // segment of message already in Friend Queue, acknowledge again
+        if (friendship->segments_acknowledge){
+            mesh_friend_send_segment_acknowledgment(friendship);
+        }
+        return;
+    }
+
+    if (same_message == false){
+        // single reassembly slot: incomplete message from another source is kept, other sender retransmits
+        bool incomplete = btstack_linked_list_empty(&friendship->segments) == false;
+        if (incomplete && (friendship->segments_src != src)) return;
+        // new message from same source replaces incomplete one
+        mesh_friend_segments_drop(friendship);
+        friendship->segments_src         = src;
+        friendship->segments_seq_zero    = seq_zero;
+        friendship->segments_seg_n       = seg_n;
+        friendship->segments_ttl         = ttl;
+        friendship->segments_block_ack   = 0;
+        friendship->segments_complete    = false;
+        // - segmented messages to group and virtual addresses are not acknowledged
+        friendship->segments_acknowledge = mesh_network_address_unicast(mesh_network_dst(network_pdu)) != 0;
+    }
+
+    if (seg_n != friendship->segments_seg_n) return;
+    if ((friendship->segments_block_ack & (1u << seg_o)) != 0) return;
+
+    // relayed to Low Power Node with decremented TTL
+    mesh_network_pdu_t * segment = mesh_friend_copy_network_pdu(network_pdu, ttl - 1);
+    if (segment == NULL) return;
+    btstack_linked_list_add_tail(&friendship->segments, (btstack_linked_item_t *) segment);
+    friendship->segments_block_ack |= 1u << seg_o;
+
+    uint32_t all_segments = (seg_n == 31) ? 0xffffffffu : ((1u << (seg_n + 1)) - 1u);
+    if (friendship->segments_block_ack != all_segments){
+        // - "The acknowledgment timer shall be set to a minimum of 150 + 50 * TTL milliseconds"
+        if (friendship->segments_acknowledge && (friendship->segments_ack_timer_active == false)){
+            friendship->segments_ack_timer_active = true;
+            btstack_run_loop_set_timer(&friendship->segments_ack_timer, 150 + (50 * ttl));
+            btstack_run_loop_add_timer(&friendship->segments_ack_timer);
+        }
+        btstack_run_loop_remove_timer(&friendship->segments_incomplete_timer);
+        btstack_run_loop_set_timer(&friendship->segments_incomplete_timer, MESH_FRIEND_SEGMENTS_INCOMPLETE_MS);
+        btstack_run_loop_add_timer(&friendship->segments_incomplete_timer);
+        return;
+    }
+
+    // message complete: acknowledge and move all segments into Friend Queue
+    mesh_friend_segments_stop_timers(friendship);
+    friendship->segments_complete = true;
+    if (friendship->segments_acknowledge){
+        mesh_friend_send_segment_acknowledgment(friendship);
+    }
+    mesh_friend_queue_make_room(friendship, seg_n + 1);
+    while (!btstack_linked_list_empty(&friendship->segments)){
+        mesh_friend_queue_add(friendship, (mesh_network_pdu_t *) btstack_linked_list_pop(&friendship->segments));
+    }
+}
+
+void mesh_friend_network_pdu_received(mesh_network_pdu_t * network_pdu){
+    // ignore messages from Low Power Node
+    if ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0) return;
+
+    // - messages with TTL 0 or 1 are not relayed
+    uint8_t ttl = mesh_network_ttl(network_pdu);
+    if (ttl < 2) return;
+
+    uint16_t src = mesh_network_src(network_pdu);
+    uint16_t dst = mesh_network_dst(network_pdu);
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        mesh_friendship_t * friendship = &mesh_friendships[i];
+        if (friendship->state != MESH_FRIENDSHIP_STATE_ESTABLISHED) continue;
+        if (friendship->netkey_index != network_pdu->netkey_index) continue;
+        if ((src >= friendship->lpn_address) && (src < (friendship->lpn_address + friendship->num_elements))) continue;
+        if (mesh_friend_lpn_destination(friendship, dst) == false) continue;
+
+        if (mesh_network_segmented(network_pdu)){
+            mesh_friend_segment_received(friendship, network_pdu, ttl);
+            continue;
+        }
+
+        // relayed to Low Power Node with decremented TTL
+        mesh_friend_queue_unsegmented(friendship, network_pdu, ttl - 1);
+    }
+}
+
+// store locally originated messages for Low Power Node
+static void mesh_friend_outgoing_network_pdu(mesh_network_pdu_t * network_pdu){
+    // Friend messages are sent directly
+    if (network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_FRIEND) return;
+
+    uint16_t dst = mesh_network_dst(network_pdu);
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        mesh_friendship_t * friendship = &mesh_friendships[i];
+        if (friendship->state != MESH_FRIENDSHIP_STATE_ESTABLISHED) continue;
+        if (friendship->netkey_index != network_pdu->netkey_index) continue;
+        if (mesh_friend_lpn_destination(friendship, dst) == false) continue;
+
+        if (mesh_network_segmented(network_pdu) == 0){
+            mesh_friend_queue_unsegmented(friendship, network_pdu, mesh_network_ttl(network_pdu));
+            continue;
+        }
+
+        // retransmitted segments are only stored once
+        if (mesh_friend_queue_contains_segment(friendship, network_pdu)) continue;
+        const uint8_t * data = mesh_network_pdu_data(network_pdu);
+        uint8_t seg_o = (big_endian_read_16(data, 2) >> 5) & 0x1f;
+        uint8_t seg_n = data[3] & 0x1f;
+        if (seg_n >= MESH_FRIEND_QUEUE_SIZE) continue;
+        if (seg_o == 0){
+            mesh_friend_queue_make_room(friendship, seg_n + 1);
+        } else {
+            // other segments are only stored if message has not been discarded
+            mesh_friend_queue_make_room(friendship, 1);
+            if (mesh_friend_queue_contains_message(friendship, mesh_network_src(network_pdu), mesh_friend_seq_zero(network_pdu)) == false) continue;
+        }
+        mesh_network_pdu_t * queued_pdu = mesh_friend_copy_network_pdu(network_pdu, mesh_network_ttl(network_pdu));
+        if (queued_pdu == NULL) return;
+        mesh_friend_queue_add(friendship, queued_pdu);
+    }
+}
+
+uint32_t mesh_friend_get_poll_timeout(uint16_t lpn_address){
+    mesh_friendship_t * friendship = mesh_friend_friendship_for_lpn(lpn_address);
+    if (friendship == NULL) return 0;
+    if (friendship->state != MESH_FRIENDSHIP_STATE_ESTABLISHED) return 0;
+    int32_t remaining_ms = (int32_t)(friendship->poll_deadline_ms - btstack_run_loop_get_time_ms());
+    if (remaining_ms <= 0) return 0;
+    return ((uint32_t) remaining_ms + 99) / 100;
+}
+
+void mesh_friend_reset(void){
+    int i;
+    for (i=0;i<MESH_FRIEND_MAX_LOW_POWER_NODES;i++){
+        if (mesh_friendships[i].state != MESH_FRIENDSHIP_STATE_IDLE){
+            mesh_friend_terminate(&mesh_friendships[i]);
+        }
+    }
+}
+
+void mesh_friend_init(void){
+    memset(mesh_friendships, 0, sizeof(mesh_friendships));
+    mesh_friend_counter = 0;
+    mesh_friend_credentials_active = NULL;
+    mesh_network_set_outgoing_message_handler(&mesh_friend_outgoing_network_pdu);
+}
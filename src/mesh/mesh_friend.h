@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#ifndef __MESH_FRIEND_H
+#define __MESH_FRIEND_H
+
+#include <stdint.h>
+
+#include "mesh/mesh_network.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Max number of Low Power Nodes with friendship
+#ifndef MESH_FRIEND_MAX_LOW_POWER_NODES
+#define MESH_FRIEND_MAX_LOW_POWER_NODES 2
+#endif
+
+// Network PDUs stored in Friend Queue per Low Power Node, oldest messages are discarded if full
+// Segmented messages with more segments are not stored
+#ifndef MESH_FRIEND_QUEUE_SIZE
+#define MESH_FRIEND_QUEUE_SIZE 16
+#endif
+
+// Group and virtual addresses in Friend Subscription List per Low Power Node
+#ifndef MESH_FRIEND_SUBSCRIPTION_LIST_SIZE
+#define MESH_FRIEND_SUBSCRIPTION_LIST_SIZE 8
+#endif
+
+// Receive Window offered in Friend Offer in ms
+#ifndef MESH_FRIEND_RECEIVE_WINDOW_MS
+#define MESH_FRIEND_RECEIVE_WINDOW_MS 20
+#endif
+
+/**
+ * @brief Init Friend feature
+ */
+void mesh_friend_init(void);
+
+/**
+ * @brief Store copy of network pdu in Friend Queue if addressed to Low Power Node
+ * @note Segments are acknowledged on behalf of the Low Power Node and stored once the message is complete.
+ *       One segmented message is collected per Low Power Node at a time, segments of a message from another
+ *       source are ignored until the current one is complete or has timed out
+ * @param network_pdu received from network layer
+ */
+void mesh_friend_network_pdu_received(mesh_network_pdu_t * network_pdu);
+
+/**
+ * @brief Process Friend Request, Poll, Clear, Clear Confirm and Subscription List Add/Remove
+ * @param network_pdu with unsegmented control message
+ */
+void mesh_friend_process_control_message(mesh_network_pdu_t * network_pdu);
+
+/**
+ * @brief Get current value of PollTimeout timer for Low Power Node
+ * @param lpn_address
+ * @returns PollTimeout in 100 ms units or 0 if no friendship with Low Power Node
+ */
+uint32_t mesh_friend_get_poll_timeout(uint16_t lpn_address);
+
+/**
+ * @brief Terminate all friendships and drop Friend Queues
+ */
+void mesh_friend_reset(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif //__MESH_FRIEND_H
@@ -50,8 +50,12 @@
 static btstack_linked_list_t network_keys;
 static uint8_t mesh_network_key_used[MAX_NR_MESH_NETWORK_KEYS];
 
+// friendship security credentials
+static btstack_linked_list_t network_keys_friendship;
+
 void mesh_network_key_init(void){
     network_keys = NULL;
+    network_keys_friendship = NULL;
 }
 
 uint16_t mesh_network_key_get_free_index(void){
@@ -101,18 +105,45 @@ mesh_network_key_t * mesh_network_key_iterator_get_next(mesh_network_key_iterato
     return (mesh_network_key_t *) btstack_linked_list_iterator_next(&it->it);
 }
 
+// friendship security credentials
+void mesh_network_key_friendship_add(mesh_network_key_t * network_key){
+    btstack_linked_list_add_tail(&network_keys_friendship, (btstack_linked_item_t *) network_key);
+}
+
+bool mesh_network_key_friendship_remove(mesh_network_key_t * network_key){
+    return btstack_linked_list_remove(&network_keys_friendship, (btstack_linked_item_t *) network_key);
+}
+
+mesh_network_key_t * mesh_network_key_friendship_get(uint16_t netkey_index, uint16_t lpn_address){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &network_keys_friendship);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_network_key_t * item = (mesh_network_key_t *) btstack_linked_list_iterator_next(&it);
+        if ((item->netkey_index == netkey_index) && (item->lpn_address == lpn_address)) return item;
+    }
+    return NULL;
+}
+
 // mesh network key iterator for a given nid
 void mesh_network_key_nid_iterator_init(mesh_network_key_iterator_t *it, uint8_t nid){
     btstack_linked_list_iterator_init(&it->it, &network_keys);
     it->key = NULL;
     it->nid = nid;
+    it->friendship = false;
 }
 
 int mesh_network_key_nid_iterator_has_more(mesh_network_key_iterator_t *it){
     // find next matching key
     while (true){
         if (it->key && it->key->nid == it->nid) return 1;
-        if (!btstack_linked_list_iterator_has_next(&it->it)) break;
+        if (!btstack_linked_list_iterator_has_next(&it->it)) {
+            // continue with friendship security credentials
+            if (it->friendship) break;
+            it->friendship = true;
+            it->key = NULL;
+            btstack_linked_list_iterator_init(&it->it, &network_keys_friendship);
+            continue;
+        }
         it->key = (mesh_network_key_t *) btstack_linked_list_iterator_next(&it->it);
     }
     return 0;
@@ -80,12 +80,17 @@ typedef struct {
     uint8_t encryption_key[16];
     uint8_t privacy_key[16];
 
+    // friendship security credentials: address of Low Power Node, 0 for master security credentials
+    uint16_t lpn_address;
+
 } mesh_network_key_t;
 
 typedef struct {
     btstack_linked_list_iterator_t it;
     mesh_network_key_t * key;
     uint8_t nid;
+    // NID iterator continues with friendship security credentials
+    bool friendship;
 } mesh_network_key_iterator_t;
 
 typedef struct {
@@ -189,7 +194,28 @@ int mesh_network_key_iterator_has_more(mesh_network_key_iterator_t *it);
 mesh_network_key_t * mesh_network_key_iterator_get_next(mesh_network_key_iterator_t *it);
 
 /**
- * @brief Iterate over all network keys with a given NID
+ * @brief Add friendship security credentials, only used by NID iterator and mesh_network_key_friendship_get
+ * @param network_key with netkey_index, lpn_address and k2 derived from NetKey and friendship parameters
+ */
+void mesh_network_key_friendship_add(mesh_network_key_t * network_key);
+
+/**
+ * @brief Remove friendship security credentials
+ * @param network_key
+ * @return true if removed
+ */
+bool mesh_network_key_friendship_remove(mesh_network_key_t * network_key);
+
+/**
+ * @brief Get friendship security credentials for Low Power Node
+ * @param netkey_index
+ * @param lpn_address
+ * @returns mesh_network_key_t or NULL
+ */
+mesh_network_key_t * mesh_network_key_friendship_get(uint16_t netkey_index, uint16_t lpn_address);
+
+/**
+ * @brief Iterate over all network keys with a given NID, including friendship security credentials
  * @param it
  * @param nid
  */
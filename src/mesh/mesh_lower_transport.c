@@ -47,12 +47,15 @@
 #include "btstack_debug.h"
 
 #include "mesh/beacon.h"
+#include "mesh/mesh_friend.h"
 #include "mesh/mesh_iv_index_seq_number.h"
 #include "mesh/mesh_lower_transport.h"
 #include "mesh/mesh_node.h"
 #include "mesh/mesh_peer.h"
 
+#ifdef ENABLE_LOG_DEBUG
 #define LOG_LOWER_TRANSPORT
+#endif
 
 // prototypes
 static void mesh_lower_transport_run(void);
@@ -62,39 +65,33 @@ static void mesh_lower_transport_outgoing_segment_transmission_timeout(btstack_t
 
 // lower transport outgoing state
 
-// queued mesh_segmented_pdu_t or mesh_network_pdu_t
+// queued mesh_segmented_pdu_t or mesh_network_pdu_t, segmented pdus with segments to send are served round-robin
 static btstack_linked_list_t lower_transport_outgoing_ready;
 
-// mesh_segmented_pdu_t to unicast address, segment transmission timer is active
+// mesh_segmented_pdu_t to unicast address, all segments sent, segment transmission timer is active
 static btstack_linked_list_t lower_transport_outgoing_waiting;
 
-// active outgoing segmented message
-static mesh_segmented_pdu_t * lower_transport_outgoing_message;
-// index of outgoing segment
-static uint16_t               lower_transport_outgoing_seg_o;
-// network pdu with outgoing segment
-static mesh_network_pdu_t   * lower_transport_outgoing_segment;
-// segment currently queued at network layer (only valid for lower_transport_outgoing_message)
-static bool                    lower_transport_outgoing_segment_at_network_layer;
-// transmission timeout occurred (while outgoing segment queued at network layer)
-static bool                    lower_transport_outgoing_transmission_timeout;
-// transmission completed fully ack'ed (while outgoing segment queued at network layer)
-static bool                    lower_transport_outgoing_transmission_complete;
-// transmission aborted by remote (while outgoing segment queued at network layer)
-static bool                    lower_transport_outgoing_transmission_aborted;
-
-// active outgoing unsegmented message
-static mesh_network_pdu_t *   lower_transport_outgoing_network_pdu;
+// network pdus for outgoing segments
+static mesh_network_pdu_t *   lower_transport_outgoing_segments[MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT];
+// segment currently queued at network layer
+static bool                   lower_transport_outgoing_segment_at_network_layer[MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT];
+
+// smoothed round trip time and its variation for Segment Acknowledgment messages
+static bool                   lower_transport_outgoing_rtt_valid;
+static uint32_t               lower_transport_outgoing_srtt_ms;
+static uint32_t               lower_transport_outgoing_rttvar_ms;
 
 // deliver to higher layer
 static void (*higher_layer_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
 static mesh_pdu_t * mesh_lower_transport_higher_layer_pdu;
 static btstack_linked_list_t mesh_lower_transport_queued_for_higher_layer;
 
+#ifdef LOG_LOWER_TRANSPORT
 static void mesh_print_hex(const char * name, const uint8_t * data, uint16_t len){
     printf("%-20s ", name);
     printf_hexdump(data, len);
 }
+#endif
 
 // utility
 
@@ -270,6 +267,39 @@ static void mesh_lower_transport_incoming_restart_incomplete_timer(mesh_segmente
     segmented_pdu->flags |= MESH_TRANSPORT_FLAG_INCOMPLETE_TIMER;
 }
 
+// allocate Network PDUs to store payload of incoming segmented message in order, same layout as outgoing messages
+static bool mesh_lower_transport_incoming_allocate_segments(mesh_segmented_pdu_t * segmented_pdu, uint16_t payload_len){
+    uint16_t storage_size = 0;
+    while (storage_size < payload_len){
+        mesh_network_pdu_t * chunk = mesh_network_pdu_get();
+        if (chunk == NULL) return false;
+        btstack_linked_list_add_tail(&segmented_pdu->segments, (btstack_linked_item_t *) chunk);
+        storage_size += MESH_NETWORK_PAYLOAD_MAX;
+    }
+    // capacity until last segment is received
+    segmented_pdu->len = payload_len;
+    return true;
+}
+
+static void mesh_lower_transport_incoming_store_segment(mesh_segmented_pdu_t * segmented_pdu, uint16_t offset, const uint8_t * data, uint8_t len){
+    // find chunk for offset
+    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) segmented_pdu->segments;
+    while (offset >= MESH_NETWORK_PAYLOAD_MAX){
+        chunk = (mesh_network_pdu_t *) chunk->pdu_header.item.next;
+        offset -= MESH_NETWORK_PAYLOAD_MAX;
+    }
+    // segment might span two chunks
+    while (len > 0){
+        uint8_t bytes_to_copy = btstack_min(MESH_NETWORK_PAYLOAD_MAX - offset, len);
+        (void) memcpy(&chunk->data[offset], data, bytes_to_copy);
+        chunk->len = btstack_max(chunk->len, offset + bytes_to_copy);
+        data   += bytes_to_copy;
+        len    -= bytes_to_copy;
+        offset  = 0;
+        chunk   = (mesh_network_pdu_t *) chunk->pdu_header.item.next;
+    }
+}
+
 static mesh_segmented_pdu_t * mesh_lower_transport_incoming_pdu_for_segmented_message(mesh_network_pdu_t *network_pdu){
     uint16_t src = mesh_network_src(network_pdu);
     uint16_t seq_zero = ( big_endian_read_16(mesh_network_pdu_data(network_pdu), 1) >> 2) & 0x1fff;
@@ -323,6 +353,14 @@ static mesh_segmented_pdu_t * mesh_lower_transport_incoming_pdu_for_segmented_me
         mesh_segmented_pdu_t * pdu = mesh_segmented_pdu_get();
         if (!pdu) return NULL;
 
+        // allocate storage for all segments
+        uint8_t max_segment_len = mesh_network_control(network_pdu) ? 8 : 12;
+        uint8_t seg_n = mesh_network_pdu_data(network_pdu)[3] & 0x1f;
+        if (mesh_lower_transport_incoming_allocate_segments(pdu, (seg_n + 1) * max_segment_len) == false){
+            mesh_segmented_pdu_free(pdu);
+            return NULL;
+        }
+
         // cache network pdu header
         pdu->ivi_nid = network_pdu->data[0];
         pdu->ctl_ttl = network_pdu->data[1];
@@ -367,9 +405,6 @@ static void mesh_lower_transport_incoming_process_segment(mesh_segmented_pdu_t *
     uint8_t * lower_transport_pdu     = mesh_network_pdu_data(network_pdu);
     uint8_t   lower_transport_pdu_len = mesh_network_pdu_len(network_pdu);
 
-    // get seq_zero
-    uint16_t seq_zero =  ( big_endian_read_16(lower_transport_pdu, 1) >> 2) & 0x1fff;
-
     // get seg fields
     uint8_t  seg_o    =  ( big_endian_read_16(lower_transport_pdu, 2) >> 5) & 0x001f;
     uint8_t  seg_n    =  lower_transport_pdu[3] & 0x1f;
@@ -377,13 +412,18 @@ static void mesh_lower_transport_incoming_process_segment(mesh_segmented_pdu_t *
     uint8_t * segment_data = &lower_transport_pdu[4];
 
 #ifdef LOG_LOWER_TRANSPORT
+    uint16_t seq_zero =  ( big_endian_read_16(lower_transport_pdu, 1) >> 2) & 0x1fff;
     uint8_t transmic_len = ((message_pdu->flags & MESH_TRANSPORT_FLAG_TRANSMIC_64) != 0) ? 64 : 32;
     printf("mesh_lower_transport_incoming_process_segment: seq zero %04x, seg_o %02x, seg_n %02x, transmic len: %u bit\n", seq_zero, seg_o, seg_n, transmic_len);
     mesh_print_hex("Segment", segment_data, segment_len);
 #endif
 
-    // drop if already stored
-    if ((message_pdu->block_ack & (1<<seg_o)) != 0){
+    // drop if already stored or not matching current message: all segments but the last one are of max size
+    uint8_t max_segment_len = mesh_network_control(network_pdu) ? 8 : 12;
+    uint8_t message_seg_n   = (message_pdu->len - 1) / max_segment_len;
+    bool    segment_invalid = (seg_n != message_seg_n) || (seg_o > seg_n) || (segment_len == 0) || (segment_len > max_segment_len)
+                           || ((seg_o < seg_n) && (segment_len != max_segment_len));
+    if (segment_invalid || ((message_pdu->block_ack & (1<<seg_o)) != 0)){
         mesh_network_message_processed_by_higher_layer(network_pdu);
         return;
     }
@@ -391,27 +431,9 @@ static void mesh_lower_transport_incoming_process_segment(mesh_segmented_pdu_t *
     // mark as received
     message_pdu->block_ack |= (1<<seg_o);
 
-    // store segment
-    uint8_t max_segment_len = mesh_network_control(network_pdu) ? 8 : 12;
-    mesh_network_pdu_t * latest_segment = (mesh_network_pdu_t *) btstack_linked_list_get_first_item(&message_pdu->segments);
-    if ((latest_segment != NULL) && ((MESH_NETWORK_PAYLOAD_MAX - latest_segment->len) > (max_segment_len  + 1))){
-        // store in last added segment if there is enough space available
-        latest_segment->data[latest_segment->len++] = seg_o;
-        (void) memcpy(&latest_segment->data[latest_segment->len], &lower_transport_pdu[4], segment_len);
-        latest_segment->len += segment_len;
-        // free buffer
-        mesh_network_message_processed_by_higher_layer(network_pdu);
-    } else {
-        // move to beginning
-        network_pdu->data[0] = seg_o;
-        uint8_t i;
-        for (i=0;i<segment_len;i++){
-            network_pdu->data[1+i] = network_pdu->data[13+i];
-        }
-        network_pdu->len = 1 + segment_len;
-        // add this buffer
-        btstack_linked_list_add(&message_pdu->segments, (btstack_linked_item_t *) network_pdu);
-    }
+    // store segment at its position in the payload
+    mesh_lower_transport_incoming_store_segment(message_pdu, seg_o * max_segment_len, segment_data, segment_len);
+    mesh_network_message_processed_by_higher_layer(network_pdu);
 
     // last segment -> store len
     if (seg_o == seg_n){
@@ -437,11 +459,11 @@ static void mesh_lower_transport_incoming_process_segment(mesh_segmented_pdu_t *
     // send ack
     mesh_lower_transport_incoming_send_ack_for_segmented_pdu(message_pdu);
 
+    // mark as done before forwarding, as higher layer might process and free message right away
+    mesh_lower_transport_incoming_segmented_message_complete(message_pdu);
+
     // forward to upper transport
     mesh_lower_transport_incoming_queue_for_higher_layer((mesh_pdu_t *) message_pdu);
-
-    // mark as done
-    mesh_lower_transport_incoming_segmented_message_complete(message_pdu);
 }
 
 void mesh_lower_transport_message_processed_by_higher_layer(mesh_pdu_t * pdu){
@@ -478,20 +500,115 @@ static void mesh_lower_transport_outgoing_setup_block_ack(mesh_segmented_pdu_t *
     }
 }
 
-static mesh_segmented_pdu_t * mesh_lower_transport_outgoing_message_for_dst(uint16_t dst){
-    if (lower_transport_outgoing_message != NULL && lower_transport_outgoing_message->dst == dst){
-        return lower_transport_outgoing_message;
+static mesh_segmented_pdu_t * mesh_lower_transport_outgoing_message_in_list(btstack_linked_list_t * list, uint16_t dst){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, list);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) continue;
+        mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) pdu;
+        if (segmented_pdu->dst == dst){
+            return segmented_pdu;
+        }
     }
     return NULL;
 }
 
+static mesh_segmented_pdu_t * mesh_lower_transport_outgoing_message_for_dst(uint16_t dst){
+    mesh_segmented_pdu_t * segmented_pdu = mesh_lower_transport_outgoing_message_in_list(&lower_transport_outgoing_ready, dst);
+    if (segmented_pdu != NULL){
+        return segmented_pdu;
+    }
+    return mesh_lower_transport_outgoing_message_in_list(&lower_transport_outgoing_waiting, dst);
+}
+
+static void mesh_lower_transport_outgoing_update_round_trip_time(mesh_segmented_pdu_t *segmented_pdu){
+    // ignore acknowledgments for retransmitted segments, as they cannot be matched to a transmission
+    if ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_RETRANSMISSION) != 0) return;
+
+    uint32_t sample_ms = btstack_run_loop_get_time_ms() - segmented_pdu->segment_sent_ms;
+    if (lower_transport_outgoing_rtt_valid == false){
+        lower_transport_outgoing_srtt_ms   = sample_ms;
+        lower_transport_outgoing_rttvar_ms = sample_ms / 2;
+        lower_transport_outgoing_rtt_valid = true;
+    } else {
+        uint32_t delta_ms = (sample_ms > lower_transport_outgoing_srtt_ms) ? (sample_ms - lower_transport_outgoing_srtt_ms) : (lower_transport_outgoing_srtt_ms - sample_ms);
+        lower_transport_outgoing_rttvar_ms = ((3 * lower_transport_outgoing_rttvar_ms) + delta_ms) / 4;
+        lower_transport_outgoing_srtt_ms   = ((7 * lower_transport_outgoing_srtt_ms) + sample_ms) / 8;
+    }
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] Lower transport, ack after %u ms, srtt %u ms, rttvar %u ms\n", (int) sample_ms,
+           (int) lower_transport_outgoing_srtt_ms, (int) lower_transport_outgoing_rttvar_ms);
+#endif
+}
+
+static uint32_t mesh_lower_transport_outgoing_segment_transmission_timeout_ms(mesh_segmented_pdu_t *segmented_pdu){
+    // - "This timer shall be set to a minimum of 200 + 50 * TTL milliseconds."
+    uint32_t timeout_ms = 200 + 50 * (segmented_pdu->ctl_ttl & 0x7f);
+    if (lower_transport_outgoing_rtt_valid){
+        // wait longer if acknowledgments take longer, but retry before the incomplete timer of the receiver (10 s) fires
+        uint32_t observed_ms = lower_transport_outgoing_srtt_ms + (4 * lower_transport_outgoing_rttvar_ms);
+        timeout_ms = btstack_max(timeout_ms, btstack_min(observed_ms, 5000));
+    }
+    return timeout_ms;
+}
+
+static void mesh_lower_transport_outgoing_stop_acknowledgment_timer(mesh_segmented_pdu_t *segmented_pdu){
+    if ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) == 0) return;
+    segmented_pdu->flags &= ~MESH_TRANSPORT_FLAG_ACK_TIMER;
+    btstack_run_loop_remove_timer(&segmented_pdu->acknowledgement_timer);
+}
+
+static void mesh_lower_transport_outgoing_restart_segment_transmission_timer(mesh_segmented_pdu_t *segmented_pdu){
+    // restart segment transmission timer for unicast dst
+    uint32_t timeout = mesh_lower_transport_outgoing_segment_transmission_timeout_ms(segmented_pdu);
+    mesh_lower_transport_outgoing_stop_acknowledgment_timer(segmented_pdu);
+
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] Lower transport, segmented pdu %p, seq %06x: setup transmission timeout %u ms\n", segmented_pdu,
+           segmented_pdu->seq, (int) timeout);
+#endif
+
+    btstack_run_loop_set_timer(&segmented_pdu->acknowledgement_timer, timeout);
+    btstack_run_loop_set_timer_handler(&segmented_pdu->acknowledgement_timer, &mesh_lower_transport_outgoing_segment_transmission_timeout);
+    btstack_run_loop_set_timer_context(&segmented_pdu->acknowledgement_timer, segmented_pdu);
+    btstack_run_loop_add_timer(&segmented_pdu->acknowledgement_timer);
+    segmented_pdu->flags |= MESH_TRANSPORT_FLAG_ACK_TIMER;
+}
+
+static void mesh_lower_transport_outgoing_complete(mesh_segmented_pdu_t * segmented_pdu, mesh_transport_status_t status){
+    btstack_assert(segmented_pdu != NULL);
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] outgoing_complete %p, ack timer active %u, incomplete active %u\n", segmented_pdu,
+           ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) != 0), ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_INCOMPLETE_TIMER) != 0));
+#endif
+    // stop timers
+    mesh_lower_transport_outgoing_stop_acknowledgment_timer(segmented_pdu);
+
+    // remove from lists, segments queued at network layer have been copied and don't refer to the message
+    btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
+    btstack_linked_list_remove(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
+
+    // notify upper transport
+    higher_layer_handler(MESH_TRANSPORT_PDU_SENT, status, (mesh_pdu_t *) segmented_pdu);
+}
+
+static void mesh_lower_transport_outgoing_retransmit(mesh_segmented_pdu_t *segmented_pdu){
+    // re-queue message for sending remaining segments
+    segmented_pdu->seg_o = 0;
+    segmented_pdu->flags |= MESH_TRANSPORT_FLAG_RETRANSMISSION;
+    btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
+    btstack_linked_list_remove(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
+    btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
+}
+
 static void mesh_lower_transport_outgoing_process_segment_acknowledgement_message(mesh_network_pdu_t *network_pdu){
     mesh_segmented_pdu_t * segmented_pdu = mesh_lower_transport_outgoing_message_for_dst( mesh_network_src(network_pdu));
     if (segmented_pdu == NULL) return;
 
     uint8_t * lower_transport_pdu     = mesh_network_pdu_data(network_pdu);
     uint16_t seq_zero_pdu = big_endian_read_16(lower_transport_pdu, 1) >> 2;
-    uint16_t seq_zero_out = lower_transport_outgoing_message->seq & 0x1fff;
+    uint16_t seq_zero_out = segmented_pdu->seq & 0x1fff;
     uint32_t block_ack = big_endian_read_32(lower_transport_pdu, 3);
 
 #ifdef LOG_LOWER_TRANSPORT
@@ -506,12 +623,7 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
 #ifdef LOG_LOWER_TRANSPORT
         printf("[+] Block Ack == 0 => Abort\n");
 #endif
-        // current?
-        if ((lower_transport_outgoing_message == segmented_pdu) && lower_transport_outgoing_segment_at_network_layer){
-            lower_transport_outgoing_transmission_aborted = true;
-        } else {
-            mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SEND_ABORT_BY_REMOTE);
-        }
+        mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SEND_ABORT_BY_REMOTE);
         return;
     }
     if (seq_zero_pdu != seq_zero_out){
@@ -522,6 +634,11 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
         return;
     }
 
+    // ignore duplicate acknowledgments
+    if ((segmented_pdu->block_ack & block_ack) == 0) return;
+
+    mesh_lower_transport_outgoing_update_round_trip_time(segmented_pdu);
+
     segmented_pdu->block_ack &= ~block_ack;
 #ifdef LOG_LOWER_TRANSPORT
     printf("[+] Updated block_ack %08x\n", segmented_pdu->block_ack);
@@ -531,60 +648,18 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
 #ifdef LOG_LOWER_TRANSPORT
         printf("[+] Sent complete\n");
 #endif
-
-        if ((lower_transport_outgoing_message == segmented_pdu) && lower_transport_outgoing_segment_at_network_layer){
-            lower_transport_outgoing_transmission_complete = true;
-        } else {
-            mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SUCCESS);
-        }
-    }
-}
-
-static void mesh_lower_transport_outgoing_stop_acknowledgment_timer(mesh_segmented_pdu_t *segmented_pdu){
-    if ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) == 0) return;
-    segmented_pdu->flags &= ~MESH_TRANSPORT_FLAG_ACK_TIMER;
-    btstack_run_loop_remove_timer(&segmented_pdu->acknowledgement_timer);
-}
-
-static void mesh_lower_transport_outgoing_restart_segment_transmission_timer(mesh_segmented_pdu_t *segmented_pdu){
-    // restart segment transmission timer for unicast dst
-    // - "This timer shall be set to a minimum of 200 + 50 * TTL milliseconds."
-    uint32_t timeout = 200 + 50 * (segmented_pdu->ctl_ttl & 0x7f);
-    if ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) != 0){
-        btstack_run_loop_remove_timer(&lower_transport_outgoing_message->acknowledgement_timer);
+        mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SUCCESS);
+        return;
     }
 
+    // all segments sent but some not acknowledged: reset segment transmission timer and retransmit missing segments now
+    if (btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu)){
 #ifdef LOG_LOWER_TRANSPORT
-    printf("[+] Lower transport, segmented pdu %p, seq %06x: setup transmission timeout %u ms\n", segmented_pdu,
-           segmented_pdu->seq, (int) timeout);
+        printf("[+] Lower transport, segmented pdu %p, seq %06x: partially acknowledged, retransmit\n", segmented_pdu, segmented_pdu->seq);
 #endif
-
-    btstack_run_loop_set_timer(&segmented_pdu->acknowledgement_timer, timeout);
-    btstack_run_loop_set_timer_handler(&segmented_pdu->acknowledgement_timer, &mesh_lower_transport_outgoing_segment_transmission_timeout);
-    btstack_run_loop_set_timer_context(&segmented_pdu->acknowledgement_timer, lower_transport_outgoing_message);
-    btstack_run_loop_add_timer(&segmented_pdu->acknowledgement_timer);
-    segmented_pdu->flags |= MESH_TRANSPORT_FLAG_ACK_TIMER;
-}
-
-static void mesh_lower_transport_outgoing_complete(mesh_segmented_pdu_t * segmented_pdu, mesh_transport_status_t status){
-    btstack_assert(segmented_pdu != NULL);
-#ifdef LOG_LOWER_TRANSPORT
-    printf("[+] outgoing_complete %p, ack timer active %u, incomplete active %u\n", segmented_pdu,
-           ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) != 0), ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_INCOMPLETE_TIMER) != 0));
-#endif
-    // stop timers
-    mesh_lower_transport_outgoing_stop_acknowledgment_timer(segmented_pdu);
-
-    // remove from lists
-    if (lower_transport_outgoing_message == segmented_pdu){
-        lower_transport_outgoing_message = NULL;
-    } else {
-        btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
-        btstack_linked_list_remove(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
+        mesh_lower_transport_outgoing_retransmit(segmented_pdu);
+        mesh_lower_transport_outgoing_restart_segment_transmission_timer(segmented_pdu);
     }
-
-    // notify upper transport
-    higher_layer_handler(MESH_TRANSPORT_PDU_SENT, status, (mesh_pdu_t *) segmented_pdu);
 }
 
 static void mesh_lower_transport_outgoing_setup_segment(mesh_segmented_pdu_t *message_pdu, uint8_t seg_o, mesh_network_pdu_t *network_pdu){
@@ -622,7 +697,7 @@ static void mesh_lower_transport_outgoing_setup_segment(mesh_segmented_pdu_t *me
     uint16_t lower_transport_pdu_len = 4 + segment_len;
 
     // find network-pdu with chunk for seg_offset
-    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) lower_transport_outgoing_message->segments;
+    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) message_pdu->segments;
     uint16_t chunk_start = 0;
     while ((chunk_start + MESH_NETWORK_PAYLOAD_MAX) <= seg_offset){
         chunk = (mesh_network_pdu_t *) chunk->pdu_header.item.next;
@@ -644,116 +719,112 @@ static void mesh_lower_transport_outgoing_setup_segment(mesh_segmented_pdu_t *me
     mesh_network_setup_pdu(network_pdu, message_pdu->netkey_index, nid, 0, ttl, seq, src, dest, lower_transport_pdu_data, lower_transport_pdu_len);
 }
 
-static void mesh_lower_transport_outgoing_send_next_segment(void){
-    btstack_assert(lower_transport_outgoing_message != NULL);
-
-#ifdef LOG_LOWER_TRANSPORT
-    printf("[+] Lower Transport, segmented pdu %p, seq %06x: send next segment\n", lower_transport_outgoing_message,
-           lower_transport_outgoing_message->seq);
-#endif
-
-    int ctl = lower_transport_outgoing_message->ctl_ttl >> 7;
+// returns true if segment has not been acknowledged yet
+static bool mesh_lower_transport_outgoing_next_unacknowledged_segment(mesh_segmented_pdu_t *segmented_pdu){
+    int ctl = segmented_pdu->ctl_ttl >> 7;
     uint16_t max_segment_len = ctl ? 8 : 12;    // control 8 bytes (64 bit NetMic), access 12 bytes (32 bit NetMIC)
-    uint8_t  seg_n = (lower_transport_outgoing_message->len - 1) / max_segment_len;
-
-    // find next unacknowledged segment
-    while ((lower_transport_outgoing_seg_o <= seg_n) && ((lower_transport_outgoing_message->block_ack & (1 << lower_transport_outgoing_seg_o)) == 0)){
-        lower_transport_outgoing_seg_o++;
+    uint8_t  seg_n = (segmented_pdu->len - 1) / max_segment_len;
+    while ((segmented_pdu->seg_o <= seg_n) && ((segmented_pdu->block_ack & (1 << segmented_pdu->seg_o)) == 0)){
+        segmented_pdu->seg_o++;
     }
+    return segmented_pdu->seg_o <= seg_n;
+}
 
-    if (lower_transport_outgoing_seg_o > seg_n){
-#ifdef LOG_LOWER_TRANSPORT
-        printf("[+] Lower Transport, segmented pdu %p, seq %06x: send complete (dst %x)\n", lower_transport_outgoing_message,
-               lower_transport_outgoing_message->seq,
-               lower_transport_outgoing_message->dst);
-#endif
-        lower_transport_outgoing_seg_o   = 0;
-
-        // done for unicast, ack timer already set, too
-        if (mesh_network_address_unicast(lower_transport_outgoing_message->dst)) {
-            btstack_linked_list_add(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) lower_transport_outgoing_message);
-            lower_transport_outgoing_message = NULL;
-            return;
+static int mesh_lower_transport_outgoing_segment_index(mesh_network_pdu_t * network_pdu){
+    int i;
+    for (i=0;i<MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT;i++){
+        if (lower_transport_outgoing_segments[i] == network_pdu){
+            return i;
         }
+    }
+    return -1;
+}
 
-        // done for group/virtual, no more retries?
-        if (lower_transport_outgoing_message->retry_count == 0){
-#ifdef LOG_LOWER_TRANSPORT
-            printf("[+] Lower Transport, message unacknowledged -> free\n");
-#endif
-            // notify upper transport
-            mesh_lower_transport_outgoing_complete(lower_transport_outgoing_message, MESH_TRANSPORT_STATUS_SUCCESS);
-            return;
+// get network pdu for next segment, allocated on first use
+static int mesh_lower_transport_outgoing_free_segment_index(void){
+    int i;
+    for (i=0;i<MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT;i++){
+        if (lower_transport_outgoing_segment_at_network_layer[i]) continue;
+        if (lower_transport_outgoing_segments[i] == NULL){
+            lower_transport_outgoing_segments[i] = mesh_network_pdu_get();
+            if (lower_transport_outgoing_segments[i] == NULL) continue;
         }
+        return i;
+    }
+    return -1;
+}
 
-        // re-queue mssage
+static void mesh_lower_transport_outgoing_send_next_segment(mesh_segmented_pdu_t *segmented_pdu, int segment_index){
+    if (segmented_pdu->seg_o == 0){
 #ifdef LOG_LOWER_TRANSPORT
-        printf("[+] Lower Transport, message unacknowledged retry count %u\n", lower_transport_outgoing_message->retry_count);
+        printf("[+] Lower Transport, segmented pdu %p, seq %06x: start sending, retry count %u\n", segmented_pdu,
+               segmented_pdu->seq, segmented_pdu->retry_count);
 #endif
-        lower_transport_outgoing_message->retry_count--;
-        btstack_linked_list_add(&lower_transport_outgoing_ready, (btstack_linked_item_t *) lower_transport_outgoing_message);
-        lower_transport_outgoing_message = NULL;
-        mesh_lower_transport_run();
-        return;
     }
 
-    // restart segment transmission timer for unicast dst
-    if (mesh_network_address_unicast(lower_transport_outgoing_message->dst)){
-        mesh_lower_transport_outgoing_restart_segment_transmission_timer(lower_transport_outgoing_message);
-    }
+    bool segment_pending = mesh_lower_transport_outgoing_next_unacknowledged_segment(segmented_pdu);
+    mesh_network_pdu_t * network_pdu = NULL;
+    if (segment_pending){
+        // restart segment transmission timer for unicast dst
+        if (mesh_network_address_unicast(segmented_pdu->dst)){
+            mesh_lower_transport_outgoing_restart_segment_transmission_timer(segmented_pdu);
+        }
 
-    mesh_lower_transport_outgoing_setup_segment(lower_transport_outgoing_message, lower_transport_outgoing_seg_o,
-                                                lower_transport_outgoing_segment);
+        network_pdu = lower_transport_outgoing_segments[segment_index];
+        mesh_lower_transport_outgoing_setup_segment(segmented_pdu, segmented_pdu->seg_o, network_pdu);
+        segmented_pdu->segment_sent_ms = btstack_run_loop_get_time_ms();
 
 #ifdef LOG_LOWER_TRANSPORT
-    printf("[+] Lower Transport, segmented pdu %p, seq %06x: send seg_o %x, seg_n %x\n", lower_transport_outgoing_message,
-           lower_transport_outgoing_message->seq, lower_transport_outgoing_seg_o, seg_n);
-    mesh_print_hex("LowerTransportPDU", &lower_transport_outgoing_segment->data[9], lower_transport_outgoing_segment->len-9);
+        printf("[+] Lower Transport, segmented pdu %p, seq %06x: send seg_o %x\n", segmented_pdu, segmented_pdu->seq, segmented_pdu->seg_o);
+        mesh_print_hex("LowerTransportPDU", &network_pdu->data[9], network_pdu->len-9);
 #endif
 
-    // next segment
-    lower_transport_outgoing_seg_o++;
+        // next segment
+        segmented_pdu->seg_o++;
+        segment_pending = mesh_lower_transport_outgoing_next_unacknowledged_segment(segmented_pdu);
+    }
 
-    // send network pdu
-    lower_transport_outgoing_segment_at_network_layer = true;
-    mesh_network_send_pdu(lower_transport_outgoing_segment);
-}
+    // more segments: serve other messages first
+    if (segment_pending){
+        btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
+    }
 
-static void mesh_lower_transport_outgoing_setup_sending_segmented_pdus(mesh_segmented_pdu_t *segmented_pdu) {
-    printf("[+] Lower Transport, segmented pdu %p, seq %06x: send retry count %u\n", segmented_pdu, segmented_pdu->seq, segmented_pdu->retry_count);
+    // send network pdu
+    if (network_pdu != NULL){
+        lower_transport_outgoing_segment_at_network_layer[segment_index] = true;
+        mesh_network_send_pdu(network_pdu);
+    }
 
-    segmented_pdu->retry_count--;
-    lower_transport_outgoing_seg_o   = 0;
-    lower_transport_outgoing_transmission_timeout  = false;
-    lower_transport_outgoing_transmission_complete = false;
-    lower_transport_outgoing_transmission_aborted  = false;
+    if (segment_pending) return;
 
-    lower_transport_outgoing_message = segmented_pdu;
-}
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] Lower Transport, segmented pdu %p, seq %06x: all segments sent (dst %x)\n", segmented_pdu, segmented_pdu->seq,
+           segmented_pdu->dst);
+#endif
+    segmented_pdu->seg_o = 0;
 
-static void mesh_lower_transport_outgoing_segment_transmission_fired(mesh_segmented_pdu_t *segmented_pdu) {
-    // once more?
-    if (segmented_pdu->retry_count == 0){
-        printf("[!] Lower transport, segmented pdu %p, seq %06x: send failed, retries exhausted\n", segmented_pdu,
-               segmented_pdu->seq);
-        mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SEND_FAILED);
+    // done for unicast, ack timer already set, too
+    if (mesh_network_address_unicast(segmented_pdu->dst)) {
+        btstack_linked_list_add(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
         return;
     }
 
+    // done for group/virtual, no more retries?
+    if (segmented_pdu->retry_count == 0){
 #ifdef LOG_LOWER_TRANSPORT
-    printf("[+] Lower transport, segmented pdu %p, seq %06x: transmission fired\n", segmented_pdu, segmented_pdu->seq);
+        printf("[+] Lower Transport, message unacknowledged -> free\n");
 #endif
-
-    // re-queue message for sending remaining segments
-    if (lower_transport_outgoing_message == segmented_pdu){
-        lower_transport_outgoing_message = NULL;
-    } else {
-        btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
+        // notify upper transport
+        mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SUCCESS);
+        return;
     }
-    btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
 
-    // continue
-    mesh_lower_transport_run();
+    // re-queue message
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] Lower Transport, message unacknowledged retry count %u\n", segmented_pdu->retry_count);
+#endif
+    segmented_pdu->retry_count--;
+    mesh_lower_transport_outgoing_retransmit(segmented_pdu);
 }
 
 static void mesh_lower_transport_outgoing_segment_transmission_timeout(btstack_timer_source_t * ts){
@@ -764,11 +835,19 @@ static void mesh_lower_transport_outgoing_segment_transmission_timeout(btstack_t
 #endif
     segmented_pdu->flags &= ~MESH_TRANSPORT_FLAG_ACK_TIMER;
 
-    if ((segmented_pdu == lower_transport_outgoing_message) && lower_transport_outgoing_segment_at_network_layer){
-        lower_transport_outgoing_transmission_timeout = true;
-    } else {
-        mesh_lower_transport_outgoing_segment_transmission_fired(segmented_pdu);
+    // once more?
+    if (segmented_pdu->retry_count == 0){
+        log_info("Lower transport, segmented pdu %p, seq %06x: send failed, retries exhausted", segmented_pdu,
+                 segmented_pdu->seq);
+        mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SEND_FAILED);
+        return;
     }
+
+    segmented_pdu->retry_count--;
+    mesh_lower_transport_outgoing_retransmit(segmented_pdu);
+
+    // continue
+    mesh_lower_transport_run();
 }
 
 // GENERAL //
@@ -776,46 +855,20 @@ static void mesh_lower_transport_outgoing_segment_transmission_timeout(btstack_t
 static void mesh_lower_transport_network_pdu_sent(mesh_network_pdu_t *network_pdu){
     // figure out what pdu was sent
 
-    // Segment Acknowledgment message sent by us?
-    if (network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT){
+    // Segment Acknowledgment message or Friend message sent by us?
+    if ((network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT) || (network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_FRIEND)){
         btstack_memory_mesh_network_pdu_free(network_pdu);
         return;
     }
 
-    // single segment?
-    if (lower_transport_outgoing_segment == network_pdu){
-        btstack_assert(lower_transport_outgoing_message != NULL);
-
-        // of segmented message
+    // segment of segmented message?
+    int segment_index = mesh_lower_transport_outgoing_segment_index(network_pdu);
+    if (segment_index >= 0){
 #ifdef LOG_LOWER_TRANSPORT
-        printf("[+] Lower transport, segmented pdu %p, seq %06x: network pdu %p sent\n", lower_transport_outgoing_message,
-               lower_transport_outgoing_message->seq, network_pdu);
+        printf("[+] Lower transport, segment network pdu %p sent\n", network_pdu);
 #endif
-
-        lower_transport_outgoing_segment_at_network_layer = false;
-        if (lower_transport_outgoing_transmission_complete){
-            // handle success
-            lower_transport_outgoing_transmission_complete = false;
-            lower_transport_outgoing_transmission_timeout  = false;
-            mesh_lower_transport_outgoing_complete(lower_transport_outgoing_message, MESH_TRANSPORT_STATUS_SUCCESS);
-            return;
-        }
-        if (lower_transport_outgoing_transmission_aborted){
-            // handle abort
-            lower_transport_outgoing_transmission_complete = false;
-            lower_transport_outgoing_transmission_timeout  = false;
-            mesh_lower_transport_outgoing_complete(lower_transport_outgoing_message, MESH_TRANSPORT_STATUS_SEND_ABORT_BY_REMOTE);
-            return;
-        }
-        if (lower_transport_outgoing_transmission_timeout){
-            // handle timeout
-            lower_transport_outgoing_transmission_timeout = false;
-            mesh_lower_transport_outgoing_segment_transmission_fired(lower_transport_outgoing_message);
-            return;
-        }
-
-        // send next segment
-        mesh_lower_transport_outgoing_send_next_segment();
+        lower_transport_outgoing_segment_at_network_layer[segment_index] = false;
+        mesh_lower_transport_run();
         return;
     }
 
@@ -828,7 +881,7 @@ static void mesh_lower_transport_process_unsegmented_control_message(mesh_networ
     uint8_t  opcode = lower_transport_pdu[0];
 
 #ifdef LOG_LOWER_TRANSPORT
-    printf("Unsegmented Control message, outgoing message %p, opcode %x\n", lower_transport_outgoing_message, opcode);
+    printf("Unsegmented Control message, opcode %x\n", opcode);
 #endif
 
     switch (opcode){
@@ -837,6 +890,10 @@ static void mesh_lower_transport_process_unsegmented_control_message(mesh_networ
             mesh_network_message_processed_by_higher_layer(network_pdu);
             break;
         default:
+#ifdef ENABLE_MESH_FRIEND
+            // Friend Request, Poll, Clear, ... are handled by Friend feature and passed on to higher layer
+            mesh_friend_process_control_message(network_pdu);
+#endif
             mesh_lower_transport_incoming_queue_for_higher_layer((mesh_pdu_t *) network_pdu);
             break;
     }
@@ -887,6 +944,10 @@ void mesh_lower_transport_received_message(mesh_network_callback_type_t callback
             if (peer && seq > peer->seq){
                 // track seq
                 peer->seq = seq;
+#ifdef ENABLE_MESH_FRIEND
+                // store in Friend Queue of Low Power Nodes
+                mesh_friend_network_pdu_received(network_pdu);
+#endif
                 // process
                 mesh_lower_transport_process_network_pdu(network_pdu);
                 mesh_lower_transport_run();
@@ -908,28 +969,34 @@ void mesh_lower_transport_received_message(mesh_network_callback_type_t callback
 
 static void mesh_lower_transport_run(void){
 
-    // check if outgoing segmented pdu is active
-    if (lower_transport_outgoing_message) return;
+    while (true){
+        // segments of different messages are interleaved as long as network pdus for segments are available
+        int segment_index = mesh_lower_transport_outgoing_free_segment_index();
+
+        // get first unsegmented pdu or segmented pdu if network pdu for segment is available
+        mesh_pdu_t * pdu = NULL;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &lower_transport_outgoing_ready);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            mesh_pdu_t * next_pdu = (mesh_pdu_t *) btstack_linked_list_iterator_next(&it);
+            if ((next_pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) || (segment_index >= 0)){
+                pdu = next_pdu;
+                break;
+            }
+        }
+        if (pdu == NULL) return;
 
-    while(!btstack_linked_list_empty(&lower_transport_outgoing_ready)) {
-        // get next message
-        mesh_segmented_pdu_t   * message_pdu;
-        mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_pop(&lower_transport_outgoing_ready);
+        btstack_linked_list_remove(&lower_transport_outgoing_ready, (btstack_linked_item_t *) pdu);
         switch (pdu->pdu_type) {
             case MESH_PDU_TYPE_UPPER_UNSEGMENTED_ACCESS:
             case MESH_PDU_TYPE_UPPER_UNSEGMENTED_CONTROL:
+#ifdef LOG_LOWER_TRANSPORT
                 printf("[+] Lower transport, unsegmented pdu, sending now %p\n", pdu);
-                lower_transport_outgoing_network_pdu = (mesh_network_pdu_t *) pdu;
-                mesh_network_send_pdu(lower_transport_outgoing_network_pdu);
+#endif
+                mesh_network_send_pdu((mesh_network_pdu_t *) pdu);
                 break;
             case MESH_PDU_TYPE_SEGMENTED:
-                message_pdu = (mesh_segmented_pdu_t *) pdu;
-                //
-                printf("[+] Lower transport, segmented pdu %p, seq %06x: run start sending now\n", message_pdu,
-                       message_pdu->seq);
-                // start sending segmented pdu
-                mesh_lower_transport_outgoing_setup_sending_segmented_pdus(message_pdu);
-                mesh_lower_transport_outgoing_send_next_segment();
+                mesh_lower_transport_outgoing_send_next_segment((mesh_segmented_pdu_t *) pdu, segment_index);
                 break;
             default:
                 btstack_assert(false);
@@ -946,9 +1013,11 @@ void mesh_lower_transport_send_pdu(mesh_pdu_t *pdu){
             btstack_assert(((mesh_network_pdu_t *) pdu)->len >= 9);
             break;
         case MESH_PDU_TYPE_SEGMENTED:
-            // set num retries, set of segments to send
+            // set num retries (3 transmissions for unicast, 2 for group and virtual addresses), set of segments to send
             segmented_pdu = (mesh_segmented_pdu_t *) pdu;
-            segmented_pdu->retry_count = 3;
+            segmented_pdu->retry_count = mesh_network_address_unicast(segmented_pdu->dst) ? 2 : 1;
+            segmented_pdu->seg_o = 0;
+            segmented_pdu->flags &= ~MESH_TRANSPORT_FLAG_RETRANSMISSION;
             mesh_lower_transport_outgoing_setup_block_ack(segmented_pdu);
             break;
         default:
@@ -977,28 +1046,27 @@ void mesh_lower_transport_reset_network_pdus(btstack_linked_list_t *list){
 }
 
 bool mesh_lower_transport_can_send_to_dest(uint16_t dest){
-    UNUSED(dest);
-    // check current
+    // only a single segmented message per destination, count active segmented messages
     uint16_t num_messages = 0;
-    if (lower_transport_outgoing_message != NULL) {
-        if (lower_transport_outgoing_message->dst == dest) {
-            return false;
-        }
-        num_messages++;
-    }
-    // check waiting
-    btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &lower_transport_outgoing_waiting);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) btstack_linked_list_iterator_next(&it);
-        num_messages++;
-        if (segmented_pdu->dst == dest){
-            return false;
+    btstack_linked_list_t * lists[] = { &lower_transport_outgoing_ready, &lower_transport_outgoing_waiting };
+    uint8_t i;
+    for (i=0;i<2;i++){
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, lists[i]);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_iterator_next(&it);
+            if (pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) continue;
+            if (((mesh_segmented_pdu_t *) pdu)->dst == dest){
+                return false;
+            }
+            num_messages++;
         }
     }
 #ifdef MAX_NR_MESH_OUTGOING_SEGMENTED_MESSAGES
     // limit number of parallel outgoing messages if configured
     if (num_messages >= MAX_NR_MESH_OUTGOING_SEGMENTED_MESSAGES) return false;
+#else
+    UNUSED(num_messages);
 #endif
     return true;
 }
@@ -1006,29 +1074,47 @@ bool mesh_lower_transport_can_send_to_dest(uint16_t dest){
 void mesh_lower_transport_reserve_slot(void){
 }
 
+static void mesh_lower_transport_outgoing_reset_segmented_pdus(btstack_linked_list_t * list){
+    while (!btstack_linked_list_empty(list)){
+        mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_pop(list);
+        // unsegmented pdus are owned by upper transport
+        if (pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) continue;
+        mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) pdu;
+        btstack_run_loop_remove_timer(&segmented_pdu->acknowledgement_timer);
+        btstack_run_loop_remove_timer(&segmented_pdu->incomplete_timer);
+        mesh_segmented_pdu_free(segmented_pdu);
+    }
+}
+
 void mesh_lower_transport_reset(void){
-    if (lower_transport_outgoing_message){
-        while (!btstack_linked_list_empty(&lower_transport_outgoing_message->segments)){
-            mesh_network_pdu_t * network_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&lower_transport_outgoing_message->segments);
-            mesh_network_pdu_free(network_pdu);
+    mesh_lower_transport_outgoing_reset_segmented_pdus(&lower_transport_outgoing_ready);
+    mesh_lower_transport_outgoing_reset_segmented_pdus(&lower_transport_outgoing_waiting);
+    int i;
+    for (i=0;i<MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT;i++){
+        // segments queued at network layer are freed by mesh_network_reset
+        if ((lower_transport_outgoing_segments[i] != NULL) && !lower_transport_outgoing_segment_at_network_layer[i]){
+            mesh_network_pdu_free(lower_transport_outgoing_segments[i]);
         }
-        lower_transport_outgoing_message = NULL;
-    }
-    while (!btstack_linked_list_empty(&lower_transport_outgoing_waiting)){
-        mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) btstack_linked_list_pop(&lower_transport_outgoing_waiting);
-        btstack_memory_mesh_segmented_pdu_free(segmented_pdu);
+        lower_transport_outgoing_segments[i] = NULL;
+        lower_transport_outgoing_segment_at_network_layer[i] = false;
     }
-    mesh_network_pdu_free(lower_transport_outgoing_segment);
-    lower_transport_outgoing_segment_at_network_layer = false;
-    lower_transport_outgoing_segment = NULL;
+    lower_transport_outgoing_rtt_valid = false;
+#ifdef ENABLE_MESH_FRIEND
+    mesh_friend_reset();
+#endif
 }
 
 void mesh_lower_transport_init(){
     // register with network layer
     mesh_network_set_higher_layer_handler(&mesh_lower_transport_received_message);
-    // allocate network_pdu for segmentation
-    lower_transport_outgoing_segment_at_network_layer = false;
-    lower_transport_outgoing_segment = mesh_network_pdu_get();
+    // allocate first network_pdu for segmentation, others are allocated on demand
+    int i;
+    for (i=0;i<MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT;i++){
+        lower_transport_outgoing_segment_at_network_layer[i] = false;
+        lower_transport_outgoing_segments[i] = NULL;
+    }
+    lower_transport_outgoing_segments[0] = mesh_network_pdu_get();
+    lower_transport_outgoing_rtt_valid = false;
 }
 
 void mesh_lower_transport_set_higher_layer_handler(void (*pdu_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu)){
@@ -48,6 +48,10 @@ extern "C"
 {
 #endif
 
+// Network PDUs used for segments of outgoing segmented messages, shared by all messages
+#ifndef MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT
+#define MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT 4
+#endif
 
 typedef enum {
     MESH_TRANSPORT_OPCODE_ACK = 0,
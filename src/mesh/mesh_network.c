@@ -76,6 +76,7 @@ static void mesh_network_dump_network_pdus(const char * name, btstack_linked_lis
 
 static void (*mesh_network_higher_layer_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu);
 static void (*mesh_network_proxy_message_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu);
+static void (*mesh_network_outgoing_message_handler)(mesh_network_pdu_t * network_pdu);
 
 #ifdef ENABLE_MESH_GATT_BEARER
 static hci_con_handle_t gatt_bearer_con_handle;
@@ -363,7 +364,26 @@ static void mesh_network_send_a(void){
     }
 
     // get network key to use for sending
-    current_network_key = mesh_subnet_get_outgoing_network_key(subnet);
+    if ((outgoing_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0){
+        current_network_key = mesh_network_key_friendship_get(outgoing_pdu->netkey_index, outgoing_pdu->lpn_address);
+        if (current_network_key == NULL){
+            // friendship terminated
+            mesh_crypto_active = 0;
+            mesh_network_pdu_t * network_pdu = outgoing_pdu;
+            outgoing_pdu = NULL;
+            mesh_network_send_complete(network_pdu);
+            mesh_network_run();
+            return;
+        }
+        // use NID of friendship security credentials
+        outgoing_pdu->data[0] = (outgoing_pdu->data[0] & 0x80) | current_network_key->nid;
+    } else {
+        current_network_key = mesh_subnet_get_outgoing_network_key(subnet);
+        // relayed message from Low Power Node was received with NID of friendship security credentials
+        if ((outgoing_pdu->flags & MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE) != 0){
+            outgoing_pdu->data[0] = (outgoing_pdu->data[0] & 0x80) | current_network_key->nid;
+        }
+    }
 
 #ifdef LOG_NETWORK
     printf("TX-A-NetworkPDU (%p): ", outgoing_pdu);
@@ -397,16 +417,20 @@ static void mesh_network_send_a(void){
     btstack_crypto_ccm_encrypt_block(&mesh_network_crypto_request.ccm, cypher_len, &outgoing_pdu->data[7], &outgoing_pdu->data[7], &mesh_network_send_b, NULL);
 }
 
-#if defined(ENABLE_MESH_RELAY) || defined (ENABLE_MESH_PROXY_SERVER)
+#if defined(ENABLE_MESH_RELAY) || defined (ENABLE_MESH_PROXY_SERVER) || defined(ENABLE_MESH_FRIEND)
 static void mesh_network_relay_message(mesh_network_pdu_t * network_pdu){
 
     uint8_t ctl_ttl      = network_pdu->data[1];
     uint8_t ctl_in_bit_7 = ctl_ttl & 0x80;
     uint8_t ttl          = ctl_ttl & 0x7f;
 
-    // prepare pdu for resending
+    // prepare pdu for resending, messages from Low Power Node are relayed with master security credentials
     network_pdu->data[1] = ctl_in_bit_7 | (ttl - 1);
     network_pdu->flags |= MESH_NETWORK_PDU_FLAGS_RELAY;
+    if ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0){
+        network_pdu->flags &= ~MESH_NETWORK_PDU_FLAGS_FRIENDSHIP;
+        network_pdu->flags |= MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE;
+    }
 
 #ifdef LOG_NETWORK
     printf("TX-Relay-NetworkPDU (%p): ", network_pdu);
@@ -425,7 +449,7 @@ static void mesh_network_relay_message(mesh_network_pdu_t * network_pdu){
 
 void mesh_network_message_processed_by_higher_layer(mesh_network_pdu_t * network_pdu){
 
-#if defined(ENABLE_MESH_RELAY) || defined (ENABLE_MESH_PROXY_SERVER)
+#if defined(ENABLE_MESH_RELAY) || defined (ENABLE_MESH_PROXY_SERVER) || defined(ENABLE_MESH_FRIEND)
 
     // check if address does not matches elements on our node and TTL >= 2
     uint16_t src     = mesh_network_src(network_pdu);
@@ -435,6 +459,18 @@ void mesh_network_message_processed_by_higher_layer(mesh_network_pdu_t * network
 
     if (((src < mesh_network_primary_address) || (src > (mesh_network_primary_address + mesh_node_element_count()))) && (ttl >= 2)){
 
+#ifdef ENABLE_MESH_FRIEND
+        // - messages from Low Power Node are relayed with master security credentials, independent of Relay and Proxy state
+        if ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0){
+            uint16_t dst = mesh_network_dst(network_pdu);
+            if ((dst < mesh_network_primary_address) || (dst >= (mesh_network_primary_address + mesh_node_element_count()))){
+                mesh_network_relay_message(network_pdu);
+                mesh_network_run();
+                return;
+            }
+        }
+#endif
+
         if ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_GATT_BEARER) == 0){
 
             // message received via ADV bearer are relayed:
@@ -534,6 +570,12 @@ static void process_network_pdu_validate_d(void * arg){
     // set netkey_index
     incoming_pdu_decoded->netkey_index = current_network_key->netkey_index;
 
+    // mark messages from Low Power Node
+    if (current_network_key->lpn_address != MESH_ADDRESS_UNSASSIGNED){
+        incoming_pdu_decoded->flags |= MESH_NETWORK_PDU_FLAGS_FRIENDSHIP;
+        incoming_pdu_decoded->lpn_address = current_network_key->lpn_address;
+    }
+
     if (incoming_pdu_decoded->flags & MESH_NETWORK_PDU_FLAGS_PROXY_CONFIGURATION){
 
         mesh_network_pdu_t * decoded_pdu = incoming_pdu_decoded;
@@ -767,9 +809,11 @@ static bool mesh_network_run_adv(void){
     // packet was received via gatt bearer and proxy active, or,
     // packet originated locally (== not relayed), or,
     // packet was received via ADV bearer and relay is active, or,
+    // packet was received from Low Power Node
     int send_via_adv = (((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_GATT_BEARER) != 0) && (mesh_foundation_gatt_proxy_get() == 1)) ||
                        (((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_GATT_BEARER) == 0) && (mesh_foundation_relay_get() == 1)) ||
-                        ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_RELAY) == 0);
+                        ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_RELAY) == 0) ||
+                        ((network_pdu->flags & MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE) != 0);
 
     if (send_via_adv){
 #ifdef LOG_NETWORK
@@ -872,8 +916,9 @@ static void mesh_adv_bearer_handle_network_event(uint8_t packet_type, uint16_t c
                 case MESH_SUBEVENT_CAN_SEND_NOW:
                     if (adv_bearer_network_pdu == NULL) break;
 
-                    // Get Transmission config depending on relay flag
-                    if (adv_bearer_network_pdu->flags & MESH_NETWORK_PDU_FLAGS_RELAY){
+                    // Get Transmission config depending on relay flag, messages from Low Power Node use Network Transmit
+                    if (((adv_bearer_network_pdu->flags & MESH_NETWORK_PDU_FLAGS_RELAY) != 0) &&
+                        ((adv_bearer_network_pdu->flags & MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE) == 0)){
                         transmit_config = mesh_foundation_relay_get();
                     } else {
                         transmit_config = mesh_foundation_network_transmit_get();
@@ -1015,6 +1060,10 @@ void mesh_network_set_proxy_message_handler(void (*packet_handler)(mesh_network_
     mesh_network_proxy_message_handler = packet_handler;
 }
 
+void mesh_network_set_outgoing_message_handler(void (*handler)(mesh_network_pdu_t * network_pdu)){
+    mesh_network_outgoing_message_handler = handler;
+}
+
 void mesh_network_received_message(const uint8_t * pdu_data, uint8_t pdu_len, uint8_t flags){
     // verify len
     if (pdu_len > 29) return;
@@ -1062,6 +1111,11 @@ void mesh_network_send_pdu(mesh_network_pdu_t * network_pdu){
     btstack_assert((network_pdu->len + (network_pdu->data[1] & 0x80 ? 8 : 4)) <= 29);
     btstack_assert(network_pdu->len >= 9);
 
+    // e.g. store copy in Friend Queue
+    if (mesh_network_outgoing_message_handler != NULL){
+        (*mesh_network_outgoing_message_handler)(network_pdu);
+    }
+
     // setup callback
     network_pdu->flags    = 0;
 
@@ -1075,6 +1129,21 @@ void mesh_network_send_pdu(mesh_network_pdu_t * network_pdu){
     mesh_network_run();
 }
 
+void mesh_network_send_pdu_with_friendship_credentials(mesh_network_pdu_t * network_pdu, uint16_t lpn_address){
+    btstack_assert((network_pdu->len + (network_pdu->data[1] & 0x80 ? 8 : 4)) <= 29);
+    btstack_assert(network_pdu->len >= 9);
+
+    // setup callback
+    network_pdu->flags       = MESH_NETWORK_PDU_FLAGS_FRIENDSHIP;
+    network_pdu->lpn_address = lpn_address;
+
+    // queue up
+    btstack_linked_list_add_tail(&network_pdus_queued, (btstack_linked_item_t *) network_pdu);
+
+    // go
+    mesh_network_run();
+}
+
 void mesh_network_encrypt_proxy_configuration_message(mesh_network_pdu_t * network_pdu){
     printf("ProxyPDU(unencrypted): ");
     printf_hexdump(network_pdu->data, network_pdu->len);
@@ -1214,6 +1283,17 @@ void mesh_network_dump(void){
 #endif
 
 }
+
+static bool mesh_network_pdu_freed_when_sent(const mesh_network_pdu_t * network_pdu){
+    switch (network_pdu->pdu_header.pdu_type){
+        case MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT:
+        case MESH_PDU_TYPE_FRIEND:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void mesh_network_reset(void){
     mesh_network_reset_network_pdus(&network_pdus_received);
     mesh_network_reset_network_pdus(&network_pdus_queued);
@@ -1224,20 +1304,20 @@ void mesh_network_reset(void){
     // - adv_bearer_network_pdu
     // - gatt_bearer_network_pdu
     // - outoing_pdu
-    // unless they are SEG ACK messages
+    // unless they are SEG ACK or Friend messages
 #ifdef ENABLE_MESH_ADV_BEARER
-    if ((adv_bearer_network_pdu != NULL) && (adv_bearer_network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT)){
+    if ((adv_bearer_network_pdu != NULL) && mesh_network_pdu_freed_when_sent(adv_bearer_network_pdu)){
         btstack_memory_mesh_network_pdu_free(adv_bearer_network_pdu);
     }
     adv_bearer_network_pdu = NULL;
 #endif
 #ifdef ENABLE_MESH_GATT_BEARER
-    if ((gatt_bearer_network_pdu != NULL) && (gatt_bearer_network_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT)){
+    if ((gatt_bearer_network_pdu != NULL) && mesh_network_pdu_freed_when_sent(gatt_bearer_network_pdu)){
         btstack_memory_mesh_network_pdu_free(gatt_bearer_network_pdu);
     }
     gatt_bearer_network_pdu = NULL;
 #endif
-    if ((outgoing_pdu != NULL) && (outgoing_pdu->pdu_header.pdu_type == MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT)){
+    if ((outgoing_pdu != NULL) && mesh_network_pdu_freed_when_sent(outgoing_pdu)){
         btstack_memory_mesh_network_pdu_free(outgoing_pdu);
     }
     outgoing_pdu = NULL;
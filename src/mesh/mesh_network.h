@@ -71,6 +71,7 @@ typedef enum {
     MESH_PDU_TYPE_INVALID,
     MESH_PDU_TYPE_NETWORK,
     MESH_PDU_TYPE_SEGMENT_ACKNOWLEDGMENT,
+    MESH_PDU_TYPE_FRIEND,
     MESH_PDU_TYPE_SEGMENTED,
     MESH_PDU_TYPE_UNSEGMENTED,
     MESH_PDU_TYPE_ACCESS,
@@ -93,6 +94,8 @@ typedef struct mesh_pdu {
 #define MESH_NETWORK_PDU_FLAGS_PROXY_CONFIGURATION 1
 #define MESH_NETWORK_PDU_FLAGS_GATT_BEARER         2
 #define MESH_NETWORK_PDU_FLAGS_RELAY               4
+#define MESH_NETWORK_PDU_FLAGS_FRIENDSHIP          8
+#define MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE      16
 
 typedef struct mesh_network_pdu {
     mesh_pdu_t pdu_header;
@@ -101,6 +104,9 @@ typedef struct mesh_network_pdu {
     uint16_t              netkey_index;
     // MESH_NETWORK_PDU_FLAGS
     uint16_t              flags;
+    // MESH_NETWORK_PDU_FLAGS_FRIENDSHIP: friendship security credentials for Low Power Node
+    // MESH_NETWORK_PDU_FLAGS_LOW_POWER_NODE: relayed message from Low Power Node
+    uint16_t              lpn_address;
 
     // pdu
     uint16_t              len;
@@ -112,6 +118,7 @@ typedef struct mesh_network_pdu {
 #define MESH_TRANSPORT_FLAG_TRANSMIC_64       4
 #define MESH_TRANSPORT_FLAG_ACK_TIMER         8
 #define MESH_TRANSPORT_FLAG_INCOMPLETE_TIMER 16
+#define MESH_TRANSPORT_FLAG_RETRANSMISSION   32
 
 typedef struct {
     mesh_pdu_t pdu_header;
@@ -136,6 +143,10 @@ typedef struct {
     uint16_t              flags;
     // retry count
     uint8_t               retry_count;
+    // outgoing: index of next segment to send
+    uint8_t               seg_o;
+    // outgoing: time last segment was passed to network layer
+    uint32_t              segment_sent_ms;
     // pdu segments
     uint16_t              len;
     btstack_linked_list_t segments;
@@ -286,6 +297,12 @@ void mesh_network_set_higher_layer_handler(void (*packet_handler)(mesh_network_c
  */
 void mesh_network_set_proxy_message_handler(void (*packet_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu));
 
+/**
+ * @brief Set handler for locally originated Network PDUs, used by Friend feature to store messages for Low Power Nodes
+ * @param handler called with network_pdu before encryption
+ */
+void mesh_network_set_outgoing_message_handler(void (*handler)(mesh_network_pdu_t * network_pdu));
+
 /**
  * @brief Mark packet as processed
  * @param newtork_pdu received via call packet_handler
@@ -298,6 +315,13 @@ void mesh_network_message_processed_by_higher_layer(mesh_network_pdu_t * network
  */
 void mesh_network_send_pdu(mesh_network_pdu_t * network_pdu);
 
+/**
+ * @brief Send network_pdu to Low Power Node after encryption with friendship security credentials
+ * @param network_pdu
+ * @param lpn_address
+ */
+void mesh_network_send_pdu_with_friendship_credentials(mesh_network_pdu_t * network_pdu, uint16_t lpn_address);
+
 /*
  * @brief Setup network pdu header
  * @param netkey_index
@@ -38,6 +38,7 @@
 #define BTSTACK_FILE__ "mesh_node.c"
 
 #include "bluetooth_company_id.h"
+#include "btstack_debug.h"
 #include "mesh/mesh_foundation.h"
 
 #include "mesh/mesh_node.h"
@@ -58,6 +59,14 @@ static uint16_t mid_counter;
 static uint8_t mesh_node_device_uuid[16];
 static int     mesh_node_have_device_uuid;
 
+// opcode table: (model, operation) for opcode and element, open addressing with linear probing, entries are never removed
+static mesh_model_operation_t mesh_node_opcode_table[MESH_NODE_OPCODE_TABLE_SIZE];
+static int mesh_node_opcode_table_overflow;
+
+#if (MESH_NODE_OPCODE_TABLE_SIZE & (MESH_NODE_OPCODE_TABLE_SIZE - 1u)) != 0
+#error "MESH_NODE_OPCODE_TABLE_SIZE must be a power of 2"
+#endif
+
 static uint16_t mesh_node_company_id;
 static uint16_t mesh_node_product_id;
 static uint16_t mesh_node_product_version_id;
@@ -189,6 +198,32 @@ void mesh_model_reset_appkeys(mesh_model_t * mesh_model){
     }
 }
 
+// key: opcode and element index, adjacent opcodes of a model are spread over the table
+static uint16_t mesh_node_opcode_table_hash(uint32_t opcode, uint16_t element_index){
+    uint32_t key = opcode ^ ((uint32_t) element_index << 24);
+    return (uint16_t) (((key * 0x9E3779B1u) >> 16) & (MESH_NODE_OPCODE_TABLE_SIZE - 1u));
+}
+
+static void mesh_node_opcode_table_add_model(mesh_model_t * mesh_model){
+    const mesh_operation_t * operation = mesh_model->operations;
+    if (operation == NULL) return;
+    for ( ; operation->handler != NULL ; operation++){
+        uint16_t index = mesh_node_opcode_table_hash(operation->opcode, mesh_model->element->element_index);
+        uint16_t probes;
+        for (probes = 0; probes < MESH_NODE_OPCODE_TABLE_SIZE; probes++){
+            if (mesh_node_opcode_table[index].operation == NULL) break;
+            index = (index + 1u) & (MESH_NODE_OPCODE_TABLE_SIZE - 1u);
+        }
+        if (probes == MESH_NODE_OPCODE_TABLE_SIZE){
+            log_error("Opcode table full, increase MESH_NODE_OPCODE_TABLE_SIZE");
+            mesh_node_opcode_table_overflow = 1;
+            return;
+        }
+        mesh_node_opcode_table[index].model = mesh_model;
+        mesh_node_opcode_table[index].operation = operation;
+    }
+}
+
 void mesh_element_add_model(mesh_element_t * element, mesh_model_t * mesh_model){
     // reset app keys
     mesh_model_reset_appkeys(mesh_model);
@@ -201,6 +236,38 @@ void mesh_element_add_model(mesh_element_t * element, mesh_model_t * mesh_model)
     mesh_model->mid = mid_counter++;
     mesh_model->element = element;
     btstack_linked_list_add_tail(&element->models, (btstack_linked_item_t *) mesh_model);
+
+    mesh_node_opcode_table_add_model(mesh_model);
+}
+
+int mesh_node_opcode_table_complete(void){
+    return mesh_node_opcode_table_overflow == 0;
+}
+
+void mesh_model_operation_iterator_init(mesh_model_operation_iterator_t * iterator, mesh_element_t * element, uint32_t opcode){
+    iterator->element = element;
+    iterator->opcode  = opcode;
+    iterator->index   = mesh_node_opcode_table_hash(opcode, element->element_index);
+    iterator->probes = 0;
+}
+
+int mesh_model_operation_iterator_has_next(mesh_model_operation_iterator_t * iterator){
+    while (iterator->probes < MESH_NODE_OPCODE_TABLE_SIZE){
+        const mesh_model_operation_t * entry = &mesh_node_opcode_table[iterator->index];
+        // end of probe sequence
+        if (entry->operation == NULL) return 0;
+        if ((entry->operation->opcode == iterator->opcode) && (entry->model->element == iterator->element)) return 1;
+        iterator->index = (iterator->index + 1u) & (MESH_NODE_OPCODE_TABLE_SIZE - 1u);
+        iterator->probes++;
+    }
+    return 0;
+}
+
+const mesh_model_operation_t * mesh_model_operation_iterator_next(mesh_model_operation_iterator_t * iterator){
+    const mesh_model_operation_t * entry = &mesh_node_opcode_table[iterator->index];
+    iterator->index = (iterator->index + 1u) & (MESH_NODE_OPCODE_TABLE_SIZE - 1u);
+    iterator->probes++;
+    return entry;
 }
 
 void mesh_model_iterator_init(mesh_model_iterator_t * iterator, mesh_element_t * element){
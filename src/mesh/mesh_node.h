@@ -52,6 +52,11 @@ extern "C" {
 #define MAX_NR_MESH_APPKEYS_PER_MODEL           3u
 #define MAX_NR_MESH_SUBSCRIPTION_PER_MODEL      3u
 
+// opcode table for received access messages, needs to hold the operations of all models, power of 2
+#ifndef MESH_NODE_OPCODE_TABLE_SIZE
+#define MESH_NODE_OPCODE_TABLE_SIZE             128u
+#endif
+
 #define MESH_HEARTBEAT_PUBLICATION_FEATURE_RELAY      1
 #define MESH_HEARTBEAT_PUBLICATION_FEATURE_PROXY      2
 #define MESH_HEARTBEAT_PUBLICATION_FEATURE_FRIEND     4
@@ -95,6 +100,12 @@ typedef struct {
     uint32_t next_publication_ms;
     uint32_t next_retransmit_ms;
     uint8_t  retransmit_count;
+    // publication heap (pairing heap): first child, next sibling, previous sibling or parent
+    struct mesh_model * heap_child;
+    struct mesh_model * heap_next;
+    struct mesh_model * heap_prev;
+    // models due in current publication timeout
+    struct mesh_model * due_next;
 
     uint16_t address;
     uint16_t appkey_index;
@@ -156,6 +167,19 @@ typedef struct {
     btstack_linked_list_iterator_t it;
 } mesh_model_iterator_t;
 
+// entry in opcode table
+typedef struct {
+    mesh_model_t * model;
+    const mesh_operation_t * operation;
+} mesh_model_operation_t;
+
+typedef struct {
+    struct mesh_element * element;
+    uint32_t opcode;
+    uint16_t index;
+    uint16_t probes;
+} mesh_model_operation_iterator_t;
+
 typedef struct mesh_element {
     // linked list item
     btstack_linked_item_t item;
@@ -248,6 +272,7 @@ uint16_t mesh_access_get_element_address(mesh_model_t * mesh_model);
 
 /**
  * @brief Add model to element
+ * @note model operations are added to the opcode table and need to be set before
  * @param element
  * @param mesh_model
  */
@@ -268,6 +293,20 @@ int mesh_model_iterator_has_next(mesh_model_iterator_t * iterator);
 
 mesh_model_t * mesh_model_iterator_next(mesh_model_iterator_t * iterator);
 
+// Mesh Model Operation Iterator: models of element with operation for given opcode, in order of registration
+
+/**
+ * @brief Check if opcode table holds operations of all models
+ * @returns 0 if MESH_NODE_OPCODE_TABLE_SIZE is too small
+ */
+int mesh_node_opcode_table_complete(void);
+
+void mesh_model_operation_iterator_init(mesh_model_operation_iterator_t * iterator, mesh_element_t * element, uint32_t opcode);
+
+int mesh_model_operation_iterator_has_next(mesh_model_operation_iterator_t * iterator);
+
+const mesh_model_operation_t * mesh_model_operation_iterator_next(mesh_model_operation_iterator_t * iterator);
+
 // Mesh Model Utility
 
 mesh_model_t * mesh_model_get_by_identifier(mesh_element_t * element, uint32_t model_identifier);
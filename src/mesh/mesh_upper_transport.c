@@ -69,6 +69,11 @@
 // MESH_ACCESS_MESH_NETWORK_PAYLOAD_MAX (384) / MESH_NETWORK_PAYLOAD_MAX (29) = 13.24.. < 14
 #define MESSAGE_BUILDER_MAX_NUM_NETWORK_PDUS (14)
 
+// with AES128 in software or custom AES128 implementation, all keys and virtual addresses are tried in a single pass
+#if defined(ENABLE_SOFTWARE_AES128) || defined(HAVE_AES128)
+#define MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
+#endif
+
 // combined key x address iterator for upper transport decryption
 
 typedef struct {
@@ -78,14 +83,33 @@ typedef struct {
     // elements
     const mesh_transport_key_t *   key;
     const mesh_virtual_address_t * address;
+    // current key while iterating over virtual addresses
+    const mesh_transport_key_t *   address_key;
     // address - might be virtual
     uint16_t dst;
-    // key info
+    // key and virtual address from key cache, tried first
+    const mesh_transport_key_t *   cached_key;
+    const mesh_virtual_address_t * cached_address;
+    bool cached_pending;
 } mesh_transport_key_and_virtual_address_iterator_t;
 
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+// AppKey and virtual address that decrypted last message with same src, dst, NetKey and AID
+typedef struct {
+    uint16_t src;
+    uint16_t dst;
+    uint16_t netkey_index;
+    uint16_t appkey_index;
+    uint16_t pseudo_dst;
+    uint8_t  aid;
+} mesh_upper_transport_key_cache_entry_t;
+#endif
+
 static void mesh_upper_transport_run(void);
 static void mesh_upper_transport_schedule_send_requests(void);
+#ifndef MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
 static void mesh_upper_transport_validate_access_message(void);
+#endif
 
 // upper transport callbacks - in access layer
 static void (*mesh_access_message_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
@@ -97,6 +121,17 @@ static uint8_t application_nonce[13];
 static btstack_crypto_ccm_t ccm;
 static mesh_transport_key_and_virtual_address_iterator_t mesh_transport_key_it;
 
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+// most recently used entry first
+static mesh_upper_transport_key_cache_entry_t mesh_upper_transport_key_cache[MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE];
+static uint16_t mesh_upper_transport_key_cache_num_entries;
+#endif
+
+#ifdef MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
+// flattened segmented access message, decrypted into incoming_access_decrypted for each trial
+static uint8_t mesh_upper_transport_trial_ciphertext[MESH_ACCESS_PAYLOAD_MAX];
+#endif
+
 // incoming segmented (mesh_segmented_pdu_t) or unsegmented (network_pdu_t)
 static mesh_pdu_t *          incoming_access_encrypted;
 
@@ -141,8 +176,14 @@ static bool upper_transport_need_pdu_for_run_outgoing;
 #define MESH_ACCESS_OPCODE_NOT_SET 0xFFFFFFFEu
 
 static void mesh_print_hex(const char * name, const uint8_t * data, uint16_t len){
-    printf("%-20s ", name);
-    printf_hexdump(data, len);
+#ifdef ENABLE_LOG_DEBUG
+    log_debug("%-20s", name);
+    log_debug_hexdump(data, len);
+#else
+    UNUSED(name);
+    UNUSED(data);
+    UNUSED(len);
+#endif
 }
 // static void mesh_print_x(const char * name, uint32_t value){
 //     printf("%20s: 0x%x", name, (int) value);
@@ -151,12 +192,16 @@ static void mesh_print_hex(const char * name, const uint8_t * data, uint16_t len
 static void mesh_transport_key_and_virtual_address_iterator_init(mesh_transport_key_and_virtual_address_iterator_t *it,
                                                                  uint16_t dst, uint16_t netkey_index, uint8_t akf,
                                                                  uint8_t aid) {
-    printf("KEY_INIT: dst %04x, akf %x, aid %x\n", dst, akf, aid);
+    log_debug("KEY_INIT: dst %04x, akf %x, aid %x", dst, akf, aid);
     // config
     it->dst   = dst;
     // init elements
     it->key     = NULL;
     it->address = NULL;
+    it->address_key = NULL;
+    it->cached_key = NULL;
+    it->cached_address = NULL;
+    it->cached_pending = false;
     // init element iterators
     mesh_transport_key_aid_iterator_init(&it->key_it, netkey_index, akf, aid);
     // init address iterator
@@ -164,7 +209,7 @@ static void mesh_transport_key_and_virtual_address_iterator_init(mesh_transport_
         mesh_virtual_address_iterator_init(&it->address_it, dst);
         // get first key
         if (mesh_transport_key_aid_iterator_has_more(&it->key_it)) {
-            it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
+            it->address_key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
         }
     }
 }
@@ -177,7 +222,7 @@ static int mesh_transport_key_and_virtual_address_iterator_has_more(mesh_transpo
             if (mesh_virtual_address_iterator_has_more(&it->address_it)) return 1;
             if (!mesh_transport_key_aid_iterator_has_more(&it->key_it)) return 0;
             // get next key
-            it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
+            it->address_key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
             mesh_virtual_address_iterator_init(&it->address_it, it->dst);
         }
     } else {
@@ -187,27 +232,112 @@ static int mesh_transport_key_and_virtual_address_iterator_has_more(mesh_transpo
 
 static void mesh_transport_key_and_virtual_address_iterator_next(mesh_transport_key_and_virtual_address_iterator_t * it){
     if (mesh_network_address_virtual(it->dst)) {
+        it->key = it->address_key;
         it->address = mesh_virtual_address_iterator_get_next(&it->address_it);
     } else {
         it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
     }
 }
 
+// cached key and virtual address first, then all others
+static bool mesh_transport_key_and_virtual_address_iterator_next_candidate(mesh_transport_key_and_virtual_address_iterator_t * it){
+    if (it->cached_pending){
+        it->cached_pending = false;
+        it->key = it->cached_key;
+        it->address = it->cached_address;
+        return true;
+    }
+    while (mesh_transport_key_and_virtual_address_iterator_has_more(it)){
+        mesh_transport_key_and_virtual_address_iterator_next(it);
+        if ((it->key == it->cached_key) && (it->address == it->cached_address)) continue;
+        return true;
+    }
+    return false;
+}
+
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+
+static int mesh_upper_transport_key_cache_find(uint16_t src, uint16_t dst, uint16_t netkey_index, uint8_t aid){
+    uint16_t i;
+    for (i = 0; i < mesh_upper_transport_key_cache_num_entries; i++){
+        const mesh_upper_transport_key_cache_entry_t * entry = &mesh_upper_transport_key_cache[i];
+        if (entry->src != src) continue;
+        if (entry->dst != dst) continue;
+        if (entry->netkey_index != netkey_index) continue;
+        if (entry->aid != aid) continue;
+        return i;
+    }
+    return -1;
+}
+
+// remove entry by moving more recently used entries back
+static void mesh_upper_transport_key_cache_remove(uint16_t index){
+    mesh_upper_transport_key_cache_num_entries--;
+    (void)memmove(&mesh_upper_transport_key_cache[index], &mesh_upper_transport_key_cache[index + 1u],
+                  (mesh_upper_transport_key_cache_num_entries - index) * sizeof(mesh_upper_transport_key_cache_entry_t));
+}
+
+// add or update entry as most recently used, drop least recently used entry if full
+static void mesh_upper_transport_key_cache_add(uint16_t src, uint16_t dst, uint16_t netkey_index, uint8_t aid,
+                                               uint16_t appkey_index, uint16_t pseudo_dst){
+    int index = mesh_upper_transport_key_cache_find(src, dst, netkey_index, aid);
+    if (index >= 0){
+        mesh_upper_transport_key_cache_remove((uint16_t) index);
+    } else if (mesh_upper_transport_key_cache_num_entries == MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE){
+        mesh_upper_transport_key_cache_num_entries--;
+    }
+    (void)memmove(&mesh_upper_transport_key_cache[1], &mesh_upper_transport_key_cache[0],
+                  mesh_upper_transport_key_cache_num_entries * sizeof(mesh_upper_transport_key_cache_entry_t));
+    mesh_upper_transport_key_cache_num_entries++;
+    mesh_upper_transport_key_cache_entry_t * entry = &mesh_upper_transport_key_cache[0];
+    entry->src = src;
+    entry->dst = dst;
+    entry->netkey_index = netkey_index;
+    entry->aid = aid;
+    entry->appkey_index = appkey_index;
+    entry->pseudo_dst = pseudo_dst;
+}
+
+// AppKey and virtual address have to be looked up again as they might have been removed since
+static void mesh_upper_transport_key_cache_lookup(mesh_transport_key_and_virtual_address_iterator_t * it, uint16_t src,
+                                                  uint16_t netkey_index, uint8_t aid){
+    int index = mesh_upper_transport_key_cache_find(src, it->dst, netkey_index, aid);
+    if (index < 0) return;
+    const mesh_upper_transport_key_cache_entry_t * entry = &mesh_upper_transport_key_cache[index];
+
+    const mesh_virtual_address_t * address = NULL;
+    if (mesh_network_address_virtual(it->dst)){
+        address = mesh_virtual_address_for_pseudo_dst(entry->pseudo_dst);
+        if ((address == NULL) || (address->hash != it->dst)) return;
+    }
+
+    mesh_transport_key_iterator_t key_it;
+    mesh_transport_key_aid_iterator_init(&key_it, netkey_index, 1, aid);
+    while (mesh_transport_key_aid_iterator_has_more(&key_it)){
+        const mesh_transport_key_t * key = mesh_transport_key_aid_iterator_get_next(&key_it);
+        if (key->appkey_index != entry->appkey_index) continue;
+        // try first
+        it->cached_key = key;
+        it->cached_address = address;
+        it->cached_pending = true;
+        return;
+    }
+}
+
+#endif
+
 // UPPER TRANSPORT
 
-static void mesh_segmented_pdu_flatten(btstack_linked_list_t * segments, uint8_t segment_len, uint8_t * buffer) {
-    // assemble payload
-    btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, segments);
-    while (btstack_linked_list_iterator_has_next(&it)) {
-        mesh_network_pdu_t *segment = (mesh_network_pdu_t *) btstack_linked_list_iterator_next(&it);
+static void mesh_segmented_pdu_flatten(mesh_segmented_pdu_t * segmented_pdu, uint8_t * buffer) {
+    // segments are stored in order by lower transport, copy payload chunk by chunk
+    mesh_network_pdu_t * segment = (mesh_network_pdu_t *) segmented_pdu->segments;
+    uint16_t offset = 0;
+    while (offset < segmented_pdu->len) {
         btstack_assert(segment->pdu_header.pdu_type == MESH_PDU_TYPE_NETWORK);
-        uint8_t offset = 0;
-        while (offset < segment->len){
-            uint8_t seg_o = segment->data[offset++];
-            (void) memcpy(&buffer[seg_o * segment_len], &segment->data[offset], segment_len);
-            offset += segment_len;
-        }
+        uint16_t bytes_to_copy = btstack_min(MESH_NETWORK_PAYLOAD_MAX, segmented_pdu->len - offset);
+        (void) memcpy(&buffer[offset], segment->data, bytes_to_copy);
+        offset += bytes_to_copy;
+        segment = (mesh_network_pdu_t *) segment->pdu_header.item.next;
     }
 }
 
@@ -286,6 +416,9 @@ void mesh_upper_transport_dump(void){
 
 void mesh_upper_transport_reset(void){
     crypto_active = 0;
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+    mesh_upper_transport_key_cache_num_entries = 0;
+#endif
     mesh_upper_transport_reset_pdus(&upper_transport_incoming);
     mesh_upper_transport_reset_pdus(&upper_transport_outgoing);
     message_builder_num_network_pdus_reserved = 0;
@@ -478,6 +611,52 @@ void mesh_upper_transport_request_to_send(btstack_context_callback_registration_
     mesh_upper_transport_schedule_send_requests();
 }
 
+static void mesh_upper_transport_validate_access_message_valid(void){
+    uint8_t transmic_len = ((incoming_access_decrypted->flags & MESH_TRANSPORT_FLAG_TRANSMIC_64) != 0) ? 8 : 4;
+
+    log_debug("TransMIC matches");
+
+    // remove TransMIC from payload
+    incoming_access_decrypted->len -= transmic_len;
+
+    // store application / device key index
+    incoming_access_decrypted->appkey_index = mesh_transport_key_it.key->appkey_index;
+
+    // remember AppKey and virtual address for next message
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+    if (mesh_transport_key_it.key->akf != 0){
+        uint16_t pseudo_dst = (mesh_transport_key_it.address != NULL) ? mesh_transport_key_it.address->pseudo_dst : MESH_ADDRESS_UNSASSIGNED;
+        mesh_upper_transport_key_cache_add(incoming_access_decrypted->src, incoming_access_decrypted->dst, incoming_access_decrypted->netkey_index,
+                                           mesh_transport_key_it.key->aid, mesh_transport_key_it.key->appkey_index, pseudo_dst);
+    }
+#endif
+
+    // if virtual address, update dst to pseudo_dst
+    if (mesh_network_address_virtual(incoming_access_decrypted->dst)){
+        incoming_access_decrypted->dst = mesh_transport_key_it.address->pseudo_dst;
+    }
+
+    // pass to upper layer
+    incoming_access_pdu_ready = true;
+    mesh_upper_transport_schedule_send_requests();
+}
+
+static void mesh_upper_transport_validate_access_message_invalid(void){
+    log_debug("No valid transport key found");
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+    // drop outdated cache entry
+    if (mesh_transport_key_it.cached_key != NULL){
+        int index = mesh_upper_transport_key_cache_find(incoming_access_decrypted->src, incoming_access_decrypted->dst,
+                                                        incoming_access_decrypted->netkey_index, mesh_transport_key_it.cached_key->aid);
+        if (index >= 0){
+            mesh_upper_transport_key_cache_remove((uint16_t) index);
+        }
+    }
+#endif
+    mesh_upper_transport_process_access_message_done(incoming_access_decrypted);
+}
+
+#ifndef MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
 static void mesh_upper_transport_validate_access_message_ccm(void * arg){
     UNUSED(arg);
 
@@ -493,27 +672,14 @@ static void mesh_upper_transport_validate_access_message_ccm(void * arg){
     mesh_print_hex("TransMIC", trans_mic, transmic_len);
 
     if (memcmp(trans_mic, &upper_transport_pdu[upper_transport_pdu_len], transmic_len) == 0){
-        printf("TransMIC matches\n");
-
-        // remove TransMIC from payload
-        incoming_access_decrypted->len -= transmic_len;
-
-        // if virtual address, update dst to pseudo_dst
-        if (mesh_network_address_virtual(incoming_access_decrypted->dst)){
-            incoming_access_decrypted->dst = mesh_transport_key_it.address->pseudo_dst;
-        }
-
-        // pass to upper layer
-        incoming_access_pdu_ready = true;
-        mesh_upper_transport_schedule_send_requests();
-
+        mesh_upper_transport_validate_access_message_valid();
     } else {
         uint8_t akf = incoming_access_decrypted->akf_aid_control & 0x40;
         if (akf){
-            printf("TransMIC does not match, try next key\n");
+            log_debug("TransMIC does not match, try next key");
             mesh_upper_transport_validate_access_message();
         } else {
-            printf("TransMIC does not match device key, done\n");
+            log_debug("TransMIC does not match device key, done");
             // done
             mesh_upper_transport_process_access_message_done(incoming_access_decrypted);
         }
@@ -531,7 +697,7 @@ static void mesh_upper_transport_validate_access_message_digest(void * arg){
     switch (incoming_access_encrypted->pdu_type){
         case MESH_PDU_TYPE_SEGMENTED:
             segmented_pdu = (mesh_segmented_pdu_t *) incoming_access_encrypted;
-            mesh_segmented_pdu_flatten(&segmented_pdu->segments, 12, upper_transport_pdu_data_out);
+            mesh_segmented_pdu_flatten(segmented_pdu, upper_transport_pdu_data_out);
             mesh_print_hex("Encrypted Payload:", upper_transport_pdu_data_out, upper_transport_pdu_len);
             btstack_crypto_ccm_decrypt_block(&ccm, upper_transport_pdu_len, upper_transport_pdu_data_out, upper_transport_pdu_data_out,
                                              &mesh_upper_transport_validate_access_message_ccm, NULL);
@@ -554,12 +720,10 @@ static void mesh_upper_transport_validate_access_message(void){
     uint8_t * upper_transport_pdu_data =  incoming_access_decrypted->data;
     uint8_t   upper_transport_pdu_len  = incoming_access_decrypted->len - transmic_len;
 
-    if (!mesh_transport_key_and_virtual_address_iterator_has_more(&mesh_transport_key_it)){
-        printf("No valid transport key found\n");
-        mesh_upper_transport_process_access_message_done(incoming_access_decrypted);
+    if (!mesh_transport_key_and_virtual_address_iterator_next_candidate(&mesh_transport_key_it)){
+        mesh_upper_transport_validate_access_message_invalid();
         return;
     }
-    mesh_transport_key_and_virtual_address_iterator_next(&mesh_transport_key_it);
     const mesh_transport_key_t * message_key = mesh_transport_key_it.key;
 
     if (message_key->akf){
@@ -568,10 +732,7 @@ static void mesh_upper_transport_validate_access_message(void){
         transport_segmented_setup_device_nonce(application_nonce, (mesh_pdu_t *) incoming_access_decrypted);
     }
 
-    // store application / device key index
     mesh_print_hex("AppOrDevKey", message_key->key, 16);
-    incoming_access_decrypted->appkey_index = message_key->appkey_index;
-
     mesh_print_hex("EncAccessPayload", upper_transport_pdu_data, upper_transport_pdu_len);
 
     // decrypt ccm
@@ -589,6 +750,111 @@ static void mesh_upper_transport_validate_access_message(void){
         mesh_upper_transport_validate_access_message_digest(NULL);
     }
 }
+#endif
+
+#ifdef MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
+
+// CCM decryption using AES128 directly, returns true if TransMIC matches
+static bool mesh_upper_transport_ccm_decrypt(const uint8_t * key, const uint8_t * nonce, const uint8_t * aad, uint16_t aad_len,
+                                             const uint8_t * ciphertext, uint16_t len, uint8_t transmic_len, uint8_t * plaintext){
+    uint8_t  a_i[16];
+    uint8_t  s_i[16];
+    uint8_t  x_i[16];
+    uint16_t i;
+
+    // X_1 = E(B_0) with Adata, M' and L' = 1
+    x_i[0] = ((aad_len > 0u) ? 0x40u : 0x00u) | (((transmic_len - 2u) / 2u) << 3) | 1u;
+    (void)memcpy(&x_i[1], nonce, 13);
+    big_endian_store_16(x_i, 14, len);
+    btstack_aes128_calc(key, x_i, x_i);
+
+    // authenticate length of additional data and additional data
+    if (aad_len > 0u){
+        x_i[0] ^= (uint8_t) (aad_len >> 8);
+        x_i[1] ^= (uint8_t) aad_len;
+        uint16_t pos = 2;
+        for (i = 0; i < aad_len; i++){
+            x_i[pos++] ^= aad[i];
+            if (pos == 16u){
+                btstack_aes128_calc(key, x_i, x_i);
+                pos = 0;
+            }
+        }
+        if (pos > 0u){
+            btstack_aes128_calc(key, x_i, x_i);
+        }
+    }
+
+    // decrypt with A_1..A_n and authenticate plaintext
+    a_i[0] = 1;
+    (void)memcpy(&a_i[1], nonce, 13);
+    uint16_t counter = 1;
+    uint16_t offset;
+    for (offset = 0; offset < len; offset += 16u){
+        uint16_t block_len = btstack_min(16, len - offset);
+        big_endian_store_16(a_i, 14, counter++);
+        btstack_aes128_calc(key, a_i, s_i);
+        for (i = 0; i < block_len; i++){
+            plaintext[offset + i] = ciphertext[offset + i] ^ s_i[i];
+            x_i[i] ^= plaintext[offset + i];
+        }
+        btstack_aes128_calc(key, x_i, x_i);
+    }
+
+    // TransMIC = X_n+1 xor E(A_0)
+    big_endian_store_16(a_i, 14, 0);
+    btstack_aes128_calc(key, a_i, s_i);
+    uint8_t diff = 0;
+    for (i = 0; i < transmic_len; i++){
+        diff |= (uint8_t) (x_i[i] ^ s_i[i] ^ ciphertext[len + i]);
+    }
+    return diff == 0u;
+}
+
+// try all keys and virtual addresses without waiting for crypto callbacks
+static void mesh_upper_transport_validate_access_message_sync(void){
+    uint8_t   transmic_len = ((incoming_access_decrypted->flags & MESH_TRANSPORT_FLAG_TRANSMIC_64) != 0) ? 8 : 4;
+    uint16_t  upper_transport_pdu_len = incoming_access_decrypted->len - transmic_len;
+
+    const uint8_t * ciphertext = NULL;
+    switch (incoming_access_encrypted->pdu_type){
+        case MESH_PDU_TYPE_SEGMENTED:
+            mesh_segmented_pdu_flatten((mesh_segmented_pdu_t *) incoming_access_encrypted, mesh_upper_transport_trial_ciphertext);
+            ciphertext = mesh_upper_transport_trial_ciphertext;
+            break;
+        case MESH_PDU_TYPE_UNSEGMENTED:
+            ciphertext = &((mesh_network_pdu_t *) incoming_access_encrypted)->data[10];
+            break;
+        default:
+            btstack_assert(false);
+            break;
+    }
+
+    crypto_active = 1;
+    while (mesh_transport_key_and_virtual_address_iterator_next_candidate(&mesh_transport_key_it)){
+        const mesh_transport_key_t * message_key = mesh_transport_key_it.key;
+        if (message_key->akf){
+            transport_segmented_setup_application_nonce(application_nonce, (mesh_pdu_t *) incoming_access_decrypted);
+        } else {
+            transport_segmented_setup_device_nonce(application_nonce, (mesh_pdu_t *) incoming_access_decrypted);
+        }
+        const uint8_t * aad = NULL;
+        uint16_t aad_len = 0;
+        if (mesh_network_address_virtual(incoming_access_decrypted->dst)){
+            aad = mesh_transport_key_it.address->label_uuid;
+            aad_len = 16;
+        }
+        if (mesh_upper_transport_ccm_decrypt(message_key->key, application_nonce, aad, aad_len, ciphertext, upper_transport_pdu_len,
+                                             transmic_len, incoming_access_decrypted->data)){
+            mesh_upper_transport_validate_access_message_valid();
+            return;
+        }
+        // only a single device key
+        if (message_key->akf == 0u) break;
+    }
+    mesh_upper_transport_validate_access_message_invalid();
+}
+#endif
 
 static void mesh_upper_transport_process_access_message(void){
     uint8_t   transmic_len = ((incoming_access_decrypted->flags & MESH_TRANSPORT_FLAG_TRANSMIC_64) != 0) ? 8 : 4;
@@ -599,12 +865,20 @@ static void mesh_upper_transport_process_access_message(void){
     uint8_t aid = incoming_access_decrypted->akf_aid_control & 0x3f;
     uint8_t akf = (incoming_access_decrypted->akf_aid_control & 0x40) >> 6;
 
-    printf("AKF: %u\n",   akf);
-    printf("AID: %02x\n", aid);
+    log_debug("AKF: %u, AID: %02x", akf, aid);
 
     mesh_transport_key_and_virtual_address_iterator_init(&mesh_transport_key_it, incoming_access_decrypted->dst,
                                                          incoming_access_decrypted->netkey_index, akf, aid);
+#if MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE > 0
+    if (akf != 0u){
+        mesh_upper_transport_key_cache_lookup(&mesh_transport_key_it, incoming_access_decrypted->src, incoming_access_decrypted->netkey_index, aid);
+    }
+#endif
+#ifdef MESH_UPPER_TRANSPORT_SYNC_TRIAL_DECRYPTION
+    mesh_upper_transport_validate_access_message_sync();
+#else
     mesh_upper_transport_validate_access_message();
+#endif
 }
 
 static void mesh_upper_transport_message_received(mesh_pdu_t * pdu){
@@ -897,7 +1171,7 @@ static void mesh_upper_transport_run(void){
                     incoming_control_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_CONTROL;
 
                     // flatten
-                    mesh_segmented_pdu_flatten(&segmented_pdu->segments, 8, incoming_control_pdu->data);
+                    mesh_segmented_pdu_flatten(segmented_pdu, incoming_control_pdu->data);
 
                     // copy meta data into encrypted pdu buffer
                     incoming_control_pdu->flags = 0;
@@ -48,6 +48,11 @@ extern "C"
 {
 #endif
 
+// number of (src, dst, AID) -> (AppKey, Label UUID) mappings remembered for incoming access messages, 0 to disable
+#ifndef MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE
+#define MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE 8
+#endif
+
 // upper transport message builder
 typedef struct {
     mesh_upper_transport_pdu_t  * pdu;
@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// AVRCP Browsing Cursor performance test
+//
+// Browses a synthetic Now Playing list with 20000 tracks over a simulated
+// browsing channel and compares the cursor against fetching the complete list
+// and against paging without prefetch. Reports time until the visible items
+// are available, number of GetFolderItems requests, transferred bytes and
+// memory for item metadata. Also measures host item parsing throughput.
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_util.h"
+#include "classic/avrcp_browsing_controller.h"
+#include "classic/avrcp_browsing_cursor.h"
+#include "perf_timer.h"
+
+#define NUM_TRACKS       20000
+#define NUM_ITERATIONS   10
+#define NUM_VISIBLE      8
+
+// browsing channel: round trip for GetFolderItems, L2CAP MTU and throughput
+#define LINK_RTT_US           30000
+#define LINK_MTU              672
+#define LINK_KBPS             1000
+// L2CAP header and AVCTP header of start/continue packets
+#define LINK_PACKET_OVERHEAD  8
+
+// user scrolls a step every 50 ms, pauses are not modelled
+#define SCROLL_STEP_ITEMS     4
+#define SCROLL_INTERVAL_US    50000
+
+static uint8_t * library;
+static uint32_t  library_len;
+static uint32_t  item_offsets[NUM_TRACKS + 1];
+
+static uint32_t store_attribute(uint8_t * buffer, uint32_t attribute_id, const char * value){
+    uint16_t len = (uint16_t) strlen(value);
+    big_endian_store_32(buffer, 0, attribute_id);
+    big_endian_store_16(buffer, 4, 0x006a);
+    big_endian_store_16(buffer, 6, len);
+    memcpy(&buffer[8], value, len);
+    return 8u + len;
+}
+
+// media element items with title, artist and album attribute
+static void library_generate(void){
+    static const char * artists[] = { "The Beatles", "Daft Punk", "Miles Davis", "Nina Simone", "Kraftwerk", "Radiohead" };
+    library = (uint8_t *) malloc(NUM_TRACKS * 150);
+    library_len = 0;
+    char name[40];
+    char album[40];
+    uint32_t i;
+    for (i = 0; i < NUM_TRACKS; i++){
+        uint8_t * item = &library[library_len];
+        item_offsets[i] = library_len;
+        snprintf(name, sizeof(name), "Track %05u of the Library", (unsigned int) i);
+        snprintf(album, sizeof(album), "Album %u", (unsigned int) (i / 12));
+        const char * artist = artists[(i / 12) % 6];
+        uint32_t pos = 3;
+        big_endian_store_32(item, pos, 0);
+        big_endian_store_32(item, pos + 4, i + 1);
+        pos += 8;
+        item[pos++] = 0;
+        big_endian_store_16(item, pos, 0x006a);
+        pos += 2;
+        big_endian_store_16(item, pos, (uint16_t) strlen(name));
+        pos += 2;
+        memcpy(&item[pos], name, strlen(name));
+        pos += (uint32_t) strlen(name);
+        item[pos++] = 3;
+        pos += store_attribute(&item[pos], AVRCP_MEDIA_ATTR_TITLE, name);
+        pos += store_attribute(&item[pos], AVRCP_MEDIA_ATTR_ARTIST, artist);
+        pos += store_attribute(&item[pos], AVRCP_MEDIA_ATTR_ALBUM, album);
+        item[0] = AVRCP_BROWSING_MEDIA_ELEMENT_ITEM;
+        big_endian_store_16(item, 1, (uint16_t) (pos - 3));
+        library_len += pos;
+    }
+    item_offsets[NUM_TRACKS] = library_len;
+}
+
+// GetFolderItems response size and transfer time on simulated link
+static uint32_t response_bytes(uint32_t start_item, uint32_t end_item){
+    // status, uid counter and number of items
+    return 5u + item_offsets[end_item + 1] - item_offsets[start_item];
+}
+
+static uint32_t transfer_time_us(uint32_t num_bytes){
+    uint32_t num_packets = (num_bytes + LINK_MTU - LINK_PACKET_OVERHEAD - 1) / (LINK_MTU - LINK_PACKET_OVERHEAD);
+    uint32_t air_bytes = num_bytes + (num_packets * LINK_PACKET_OVERHEAD);
+    return LINK_RTT_US + (uint32_t) (((uint64_t) air_bytes * 8000u) / LINK_KBPS);
+}
+
+static void deliver_response(avrcp_browsing_cursor_t * cursor, uint32_t start_item, uint32_t end_item){
+    uint32_t num_items = end_item - start_item + 1;
+    avrcp_browsing_cursor_handle_response_begin(cursor, 1, (uint16_t) num_items);
+    uint32_t pos = item_offsets[start_item];
+    uint32_t end = item_offsets[end_item + 1];
+    while (pos < end){
+        uint16_t len = (uint16_t) btstack_min(LINK_MTU - LINK_PACKET_OVERHEAD, end - pos);
+        avrcp_browsing_cursor_handle_response_data(cursor, &library[pos], len);
+        pos += len;
+    }
+    avrcp_browsing_cursor_handle_response_end(cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+}
+
+// simulated browsing channel with a single outstanding GetFolderItems
+typedef struct {
+    uint32_t now_us;
+    bool     busy;
+    uint32_t complete_us;
+    uint32_t start_item;
+    uint32_t end_item;
+    uint32_t num_requests;
+    uint32_t num_bytes;
+} link_t;
+
+static link_t link;
+
+static void link_start_request(avrcp_browsing_cursor_t * cursor){
+    if (link.busy) return;
+    if (!avrcp_browsing_cursor_get_request(cursor, &link.start_item, &link.end_item)) return;
+    link.end_item = btstack_min(link.end_item, NUM_TRACKS - 1);
+    uint32_t num_bytes = response_bytes(link.start_item, link.end_item);
+    link.busy = true;
+    link.complete_us = link.now_us + transfer_time_us(num_bytes);
+    link.num_requests++;
+    link.num_bytes += num_bytes;
+}
+
+static void link_request_handler(avrcp_browsing_cursor_t * cursor){
+    link_start_request(cursor);
+}
+
+// complete next request, returns false if idle
+static bool link_step(avrcp_browsing_cursor_t * cursor, uint32_t time_limit_us){
+    if (!link.busy || (link.complete_us > time_limit_us)) return false;
+    link.now_us = link.complete_us;
+    link.busy = false;
+    // may start next request
+    deliver_response(cursor, link.start_item, link.end_item);
+    link_start_request(cursor);
+    return true;
+}
+
+static bool visible_items_available(avrcp_browsing_cursor_t * cursor, uint32_t first_visible){
+    uint32_t i;
+    for (i = 0; i < NUM_VISIBLE; i++){
+        if (avrcp_browsing_cursor_get_item(cursor, first_visible + i) == NULL) return false;
+    }
+    return true;
+}
+
+typedef struct {
+    uint32_t num_steps;
+    uint32_t num_stalls;
+    uint32_t first_visible_us;
+    uint32_t max_wait_us;
+    uint64_t total_wait_us;
+} scroll_stats_t;
+
+static void scroll_to(avrcp_browsing_cursor_t * cursor, uint32_t first_visible, scroll_stats_t * stats){
+    uint32_t step_start_us = link.now_us;
+    avrcp_browsing_cursor_set_position(cursor, first_visible, NUM_VISIBLE);
+    while (!visible_items_available(cursor, first_visible)){
+        if (!link_step(cursor, 0xffffffffu)) break;
+    }
+    uint32_t wait_us = link.now_us - step_start_us;
+    if (stats->num_steps == 0){
+        stats->first_visible_us = wait_us;
+    }
+    stats->num_steps++;
+    if (wait_us > 0){
+        stats->num_stalls++;
+    }
+    stats->max_wait_us = btstack_max(stats->max_wait_us, wait_us);
+    stats->total_wait_us += wait_us;
+    // prefetch continues while user looks at the list
+    uint32_t next_step_us = link.now_us + SCROLL_INTERVAL_US;
+    while (link_step(cursor, next_step_us)){
+    }
+    link.now_us = next_step_us;
+}
+
+// scroll through first 2000 tracks, jump to track 15000 and scroll back 400 tracks
+static void run_scroll_trace(avrcp_browsing_cursor_t * cursor, scroll_stats_t * stats){
+    uint32_t first_visible;
+    for (first_visible = 0; first_visible < 2000; first_visible += SCROLL_STEP_ITEMS){
+        scroll_to(cursor, first_visible, stats);
+    }
+    for (first_visible = 15000; first_visible > 14600; first_visible -= SCROLL_STEP_ITEMS){
+        scroll_to(cursor, first_visible, stats);
+    }
+}
+
+static void print_result(const char * name, const scroll_stats_t * stats, uint32_t memory){
+    printf("%-24s first visible %7.1f ms, stalls %3u/%u, avg wait %6.2f ms, max wait %7.1f ms, %5u requests, %8u bytes, %8u bytes metadata\n",
+           name, stats->first_visible_us / 1000.0, stats->num_stalls, stats->num_steps,
+           (double) stats->total_wait_us / stats->num_steps / 1000.0, stats->max_wait_us / 1000.0,
+           link.num_requests, link.num_bytes, memory);
+}
+
+static void run_cursor(const char * name, uint16_t page_size, uint16_t num_pages, uint8_t prefetch_pages){
+    avrcp_browsing_cursor_t cursor;
+    uint16_t num_items = page_size * num_pages;
+    avrcp_browsing_cursor_item_t * items = (avrcp_browsing_cursor_item_t *) malloc(num_items * sizeof(avrcp_browsing_cursor_item_t));
+    avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, num_items, page_size, NULL);
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, prefetch_pages);
+    avrcp_browsing_cursor_set_total_items(&cursor, NUM_TRACKS);
+    cursor.request_handler = &link_request_handler;
+    memset(&link, 0, sizeof(link));
+    scroll_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    run_scroll_trace(&cursor, &stats);
+    print_result(name, &stats, (uint32_t) (sizeof(cursor) + (num_items * sizeof(avrcp_browsing_cursor_item_t))));
+    free(items);
+}
+
+// Baseline: single GetFolderItems for complete list before anything is shown
+static void run_complete_list(void){
+    memset(&link, 0, sizeof(link));
+    link.num_requests = 1;
+    link.num_bytes = response_bytes(0, NUM_TRACKS - 1);
+    scroll_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.num_steps = (2000 + 400) / SCROLL_STEP_ITEMS;
+    stats.num_stalls = 1;
+    stats.first_visible_us = transfer_time_us(link.num_bytes);
+    stats.max_wait_us = stats.first_visible_us;
+    stats.total_wait_us = stats.first_visible_us;
+    print_result("Complete list", &stats, (uint32_t) (NUM_TRACKS * sizeof(avrcp_browsing_cursor_item_t)));
+}
+
+// host processing: parse all items page by page
+static uint32_t run_parser(uint32_t * checksum){
+    static avrcp_browsing_cursor_item_t items[100];
+    uint32_t start = perf_timer_get_time_us();
+    int iteration;
+    for (iteration = 0; iteration < NUM_ITERATIONS; iteration++){
+        avrcp_browsing_cursor_t cursor;
+        avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, 100, 100, NULL);
+        avrcp_browsing_cursor_set_prefetch_pages(&cursor, 0);
+        *checksum = 0;
+        uint32_t first_visible;
+        for (first_visible = 0; first_visible < NUM_TRACKS; first_visible += 100){
+            avrcp_browsing_cursor_set_position(&cursor, first_visible, 100);
+            uint32_t start_item;
+            uint32_t end_item;
+            if (!avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item)) break;
+            deliver_response(&cursor, start_item, btstack_min(end_item, NUM_TRACKS - 1));
+            const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, first_visible + 99);
+            if (item != NULL){
+                *checksum += item->name_len + item->artist_len + item->uid[7];
+            }
+        }
+    }
+    return (perf_timer_get_time_us() - start) / NUM_ITERATIONS;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    library_generate();
+    printf("Library: %u tracks, %u bytes of items, %u bytes per cached item\n", NUM_TRACKS, library_len,
+           (unsigned int) sizeof(avrcp_browsing_cursor_item_t));
+    printf("Link: RTT %u ms, MTU %u, %u kbit/s - %u visible items, scroll %u items every %u ms\n",
+           LINK_RTT_US / 1000, LINK_MTU, LINK_KBPS, NUM_VISIBLE, SCROLL_STEP_ITEMS, SCROLL_INTERVAL_US / 1000);
+
+    run_complete_list();
+    run_cursor("Paging, no prefetch", 20, 2, 0);
+    run_cursor("Cursor 20x8, prefetch 1", 20, 8, 1);
+    run_cursor("Cursor 25x8, prefetch 2", 25, 8, 2);
+    run_cursor("Cursor 50x4, prefetch 1", 50, 4, 1);
+
+    uint32_t checksum;
+    uint32_t parser_us = run_parser(&checksum);
+    printf("Item parser: %u items in %u us, %.1f M items/s, %.1f MB/s (checksum %u)\n", NUM_TRACKS, parser_us,
+           (double) NUM_TRACKS / (double) parser_us, (double) library_len / (double) parser_us, checksum);
+    free(library);
+    return 0;
+}
@@ -0,0 +1,666 @@
+// *****************************************************************************
+//
+// AVRCP Browsing Cursor Test
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/avrcp_browsing.h"
+#include "classic/avrcp_browsing_controller.h"
+#include "classic/avrcp_browsing_cursor.h"
+#include "classic/avrcp_controller.h"
+#include "l2cap.h"
+
+#define PAGE_SIZE 10
+#define NUM_ITEMS (4 * PAGE_SIZE)
+
+// synthetic media library served by mock target
+static uint32_t library_size;
+static uint16_t library_uid_counter;
+static uint8_t  library_status;
+static uint16_t library_chunk_size;
+
+static avrcp_browsing_cursor_t      cursor;
+static avrcp_browsing_cursor_item_t items[NUM_ITEMS];
+
+static int      num_requests_triggered;
+static char     event_log[1000];
+static uint16_t event_log_len;
+
+static void event_log_append(const char * text){
+    uint16_t len = (uint16_t) strlen(text);
+    if ((event_log_len + len) >= sizeof(event_log)) return;
+    memcpy(&event_log[event_log_len], text, len);
+    event_log_len += len;
+    event_log[event_log_len] = 0;
+}
+
+static void cursor_callback(avrcp_browsing_cursor_t * context, avrcp_browsing_cursor_event_t event, uint32_t start_index, uint32_t count){
+    (void) context;
+    char buffer[40];
+    switch (event){
+        case AVRCP_BROWSING_CURSOR_EVENT_ITEMS_AVAILABLE:
+            snprintf(buffer, sizeof(buffer), "A%u+%u|", (unsigned int) start_index, (unsigned int) count);
+            break;
+        case AVRCP_BROWSING_CURSOR_EVENT_INVALIDATED:
+            snprintf(buffer, sizeof(buffer), "I|");
+            break;
+        case AVRCP_BROWSING_CURSOR_EVENT_ERROR:
+            snprintf(buffer, sizeof(buffer), "E%u|", (unsigned int) start_index);
+            break;
+        default:
+            buffer[0] = 0;
+            break;
+    }
+    event_log_append(buffer);
+}
+
+static void request_handler(avrcp_browsing_cursor_t * context){
+    (void) context;
+    num_requests_triggered++;
+}
+
+static uint16_t store_element_item(uint8_t * buffer, uint32_t index, const char * name, const char * artist){
+    uint16_t pos = 3;
+    big_endian_store_32(buffer, pos, 0);
+    big_endian_store_32(buffer, pos + 4, 0x1000 + index);
+    pos += 8;
+    buffer[pos++] = 0;  // audio
+    big_endian_store_16(buffer, pos, 0x006a);
+    pos += 2;
+    big_endian_store_16(buffer, pos, (uint16_t) strlen(name));
+    pos += 2;
+    memcpy(&buffer[pos], name, strlen(name));
+    pos += (uint16_t) strlen(name);
+    // album and artist attribute
+    buffer[pos++] = 2;
+    const char * album = "Album";
+    big_endian_store_32(buffer, pos, AVRCP_MEDIA_ATTR_ALBUM);
+    big_endian_store_16(buffer, pos + 4, 0x006a);
+    big_endian_store_16(buffer, pos + 6, (uint16_t) strlen(album));
+    pos += 8;
+    memcpy(&buffer[pos], album, strlen(album));
+    pos += (uint16_t) strlen(album);
+    big_endian_store_32(buffer, pos, AVRCP_MEDIA_ATTR_ARTIST);
+    big_endian_store_16(buffer, pos + 4, 0x006a);
+    big_endian_store_16(buffer, pos + 6, (uint16_t) strlen(artist));
+    pos += 8;
+    memcpy(&buffer[pos], artist, strlen(artist));
+    pos += (uint16_t) strlen(artist);
+    buffer[0] = AVRCP_BROWSING_MEDIA_ELEMENT_ITEM;
+    big_endian_store_16(buffer, 1, pos - 3);
+    return pos;
+}
+
+static uint16_t store_track(uint8_t * buffer, uint32_t index){
+    char name[20];
+    char artist[20];
+    snprintf(name, sizeof(name), "Track %u", (unsigned int) index);
+    snprintf(artist, sizeof(artist), "Artist %u", (unsigned int) (index % 7));
+    return store_element_item(buffer, index, name, artist);
+}
+
+static void send_data(const uint8_t * data, uint16_t len){
+    uint16_t pos = 0;
+    while (pos < len){
+        uint16_t chunk_len = btstack_min(library_chunk_size, len - pos);
+        avrcp_browsing_cursor_handle_response_data(&cursor, &data[pos], chunk_len);
+        pos += chunk_len;
+    }
+}
+
+// answer a single GetFolderItems request, returns false if cursor has nothing to fetch
+static bool serve_request(void){
+    uint32_t start_item;
+    uint32_t end_item;
+    if (!avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item)) return false;
+    if (library_status != AVRCP_BROWSING_ERROR_CODE_SUCCESS){
+        avrcp_browsing_cursor_handle_response_end(&cursor, library_status);
+        return true;
+    }
+    if (start_item >= library_size){
+        avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_RANGE_OUT_OF_BOUNDS);
+        return true;
+    }
+    end_item = btstack_min(end_item, library_size - 1);
+    uint16_t num_items = (uint16_t) (end_item - start_item + 1);
+    avrcp_browsing_cursor_handle_response_begin(&cursor, library_uid_counter, num_items);
+    uint8_t buffer[2000];
+    uint16_t len = 0;
+    uint32_t index;
+    for (index = start_item; index <= end_item; index++){
+        len += store_track(&buffer[len], index);
+    }
+    send_data(buffer, len);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+    return true;
+}
+
+static int serve_all(void){
+    int num_requests = 0;
+    while (serve_request()){
+        num_requests++;
+    }
+    return num_requests;
+}
+
+static bool is_cached(uint32_t index){
+    return avrcp_browsing_cursor_get_item(&cursor, index) != NULL;
+}
+
+TEST_GROUP(AVRCPBrowsingCursor){
+    void setup(void){
+        library_size = 1000;
+        library_uid_counter = 1;
+        library_status = AVRCP_BROWSING_ERROR_CODE_SUCCESS;
+        library_chunk_size = 1000;
+        num_requests_triggered = 0;
+        event_log_len = 0;
+        event_log[0] = 0;
+        avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, NUM_ITEMS, PAGE_SIZE, &cursor_callback);
+        cursor.request_handler = &request_handler;
+    }
+};
+
+TEST(AVRCPBrowsingCursor, NoRequestWithoutPosition){
+    CHECK_FALSE(serve_request());
+    CHECK_EQUAL(0, num_requests_triggered);
+}
+
+TEST(AVRCPBrowsingCursor, VisibleAndPrefetch){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 8);
+    CHECK_EQUAL(1, num_requests_triggered);
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    CHECK_EQUAL(0, start_item);
+    CHECK_EQUAL(PAGE_SIZE - 1, end_item);
+    // single request in flight
+    CHECK_FALSE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    avrcp_browsing_cursor_handle_response_begin(&cursor, 1, 0);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+
+    setup();
+    avrcp_browsing_cursor_set_position(&cursor, 0, 8);
+    CHECK_EQUAL(2, serve_all());
+    STRCMP_EQUAL("A0+10|A10+10|", event_log);
+    CHECK_TRUE(is_cached(0));
+    CHECK_TRUE(is_cached(19));
+    CHECK_FALSE(is_cached(20));
+
+    const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, 13);
+    CHECK(item != NULL);
+    CHECK_EQUAL(13, item->index);
+    CHECK_EQUAL(AVRCP_BROWSING_MEDIA_ELEMENT_ITEM, item->item_type);
+    CHECK_EQUAL(0x100d, big_endian_read_32(item->uid, 4));
+    CHECK_EQUAL(0x006a, item->charset);
+    STRCMP_EQUAL("Track 13", item->name);
+    STRCMP_EQUAL("Artist 6", item->artist);
+}
+
+TEST(AVRCPBrowsingCursor, PrefetchPages){
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, 2);
+    avrcp_browsing_cursor_set_position(&cursor, 5, 10);
+    // pages 0 and 1 visible, pages 2 and 3 prefetched
+    CHECK_EQUAL(4, serve_all());
+    CHECK_TRUE(is_cached(39));
+}
+
+TEST(AVRCPBrowsingCursor, PrefetchLimitedByCache){
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, 10);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(4, serve_all());
+    STRCMP_EQUAL("A0+10|A10+10|A20+10|A30+10|", event_log);
+}
+
+TEST(AVRCPBrowsingCursor, ScrollForward){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(2, serve_all());
+    avrcp_browsing_cursor_set_position(&cursor, 10, 10);
+    CHECK_EQUAL(1, serve_all());
+    STRCMP_EQUAL("A0+10|A10+10|A20+10|", event_log);
+    // nothing new to fetch
+    avrcp_browsing_cursor_set_position(&cursor, 12, 8);
+    CHECK_EQUAL(0, serve_all());
+}
+
+TEST(AVRCPBrowsingCursor, ScrollBackward){
+    avrcp_browsing_cursor_set_position(&cursor, 500, 10);
+    CHECK_EQUAL(2, serve_all());
+    STRCMP_EQUAL("A500+10|A510+10|", event_log);
+    event_log_len = 0;
+    avrcp_browsing_cursor_set_position(&cursor, 485, 10);
+    // visible pages first, then prefetch page before them
+    CHECK_EQUAL(3, serve_all());
+    STRCMP_EQUAL("A490+10|A480+10|A470+10|", event_log);
+}
+
+TEST(AVRCPBrowsingCursor, LeastRecentlyUsedEviction){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    serve_all();
+    avrcp_browsing_cursor_set_position(&cursor, 10, 10);
+    serve_all();
+    // cache full with pages 0..3
+    avrcp_browsing_cursor_set_position(&cursor, 20, 10);
+    serve_all();
+    CHECK_TRUE(is_cached(0));
+    CHECK_TRUE(is_cached(39));
+    // page 0 used again, page 1 gets evicted next
+    CHECK_TRUE(is_cached(5));
+    avrcp_browsing_cursor_set_position(&cursor, 30, 10);
+    serve_all();
+    CHECK_TRUE(is_cached(40));
+    CHECK_TRUE(is_cached(0));
+    CHECK_FALSE(is_cached(10));
+    CHECK_TRUE(is_cached(20));
+    CHECK_TRUE(is_cached(30));
+}
+
+TEST(AVRCPBrowsingCursor, EndOfList){
+    library_size = 25;
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, 3);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(3, serve_all());
+    STRCMP_EQUAL("A0+10|A10+10|A20+5|", event_log);
+    CHECK_EQUAL(25, avrcp_browsing_cursor_get_total_items(&cursor));
+    CHECK_TRUE(is_cached(24));
+    CHECK_FALSE(is_cached(25));
+}
+
+TEST(AVRCPBrowsingCursor, RangeOutOfBounds){
+    library_size = 20;
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, 3);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(3, serve_all());
+    STRCMP_EQUAL("A0+10|A10+10|", event_log);
+    CHECK_EQUAL(20, avrcp_browsing_cursor_get_total_items(&cursor));
+    CHECK_EQUAL(AVRCP_BROWSING_ERROR_CODE_SUCCESS, avrcp_browsing_cursor_get_status(&cursor));
+    // no request beyond end
+    avrcp_browsing_cursor_set_position(&cursor, 15, 10);
+    CHECK_EQUAL(0, serve_all());
+}
+
+TEST(AVRCPBrowsingCursor, TotalItems){
+    avrcp_browsing_cursor_set_total_items(&cursor, 15);
+    avrcp_browsing_cursor_set_prefetch_pages(&cursor, 3);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_TRUE(serve_request());
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    CHECK_EQUAL(10, start_item);
+    CHECK_EQUAL(14, end_item);
+    avrcp_browsing_cursor_cancel_request(&cursor);
+    CHECK_EQUAL(1, serve_all());
+    CHECK_EQUAL(15, avrcp_browsing_cursor_get_total_items(&cursor));
+
+    avrcp_browsing_cursor_set_total_items(&cursor, 0);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_FALSE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+}
+
+TEST(AVRCPBrowsingCursor, UidCounterChanged){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    serve_all();
+    event_log_len = 0;
+    library_uid_counter = 2;
+    avrcp_browsing_cursor_set_position(&cursor, 10, 10);
+    CHECK_EQUAL(2, serve_all());
+    // page 2 invalidated pages 0 and 1, page 1 fetched again
+    STRCMP_EQUAL("I|A20+10|A10+10|", event_log);
+    CHECK_FALSE(is_cached(0));
+    CHECK_TRUE(is_cached(10));
+    CHECK_TRUE(is_cached(20));
+}
+
+TEST(AVRCPBrowsingCursor, Error){
+    library_status = AVRCP_BROWSING_ERROR_CODE_INTERNAL_ERROR;
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(1, serve_all());
+    STRCMP_EQUAL("E0|", event_log);
+    CHECK_EQUAL(AVRCP_BROWSING_ERROR_CODE_INTERNAL_ERROR, avrcp_browsing_cursor_get_status(&cursor));
+    CHECK_FALSE(is_cached(0));
+    // resume on next position update
+    library_status = AVRCP_BROWSING_ERROR_CODE_SUCCESS;
+    num_requests_triggered = 0;
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(1, num_requests_triggered);
+    CHECK_EQUAL(2, serve_all());
+}
+
+TEST(AVRCPBrowsingCursor, Reset){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    serve_all();
+    avrcp_browsing_cursor_reset(&cursor);
+    CHECK_FALSE(is_cached(0));
+    CHECK_EQUAL(AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN, avrcp_browsing_cursor_get_total_items(&cursor));
+    CHECK_EQUAL(2, serve_all());
+    CHECK_TRUE(is_cached(0));
+}
+
+TEST(AVRCPBrowsingCursor, ResetDuringRequest){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    avrcp_browsing_cursor_handle_response_begin(&cursor, 1, 1);
+    avrcp_browsing_cursor_reset(&cursor);
+    uint8_t buffer[100];
+    uint16_t len = store_track(buffer, 0);
+    avrcp_browsing_cursor_handle_response_data(&cursor, buffer, len);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+    // items of old folder dropped and list end not derived from it
+    STRCMP_EQUAL("", event_log);
+    CHECK_FALSE(is_cached(0));
+    CHECK_EQUAL(AVRCP_BROWSING_CURSOR_TOTAL_ITEMS_UNKNOWN, avrcp_browsing_cursor_get_total_items(&cursor));
+    CHECK_EQUAL(2, serve_all());
+}
+
+TEST(AVRCPBrowsingCursor, CancelRequest){
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    avrcp_browsing_cursor_cancel_request(&cursor);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+    STRCMP_EQUAL("", event_log);
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    CHECK_EQUAL(0, start_item);
+}
+
+TEST(AVRCPBrowsingCursor, AllChunkSizes){
+    for (library_chunk_size = 1; library_chunk_size < 60; library_chunk_size++){
+        event_log_len = 0;
+        avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, NUM_ITEMS, PAGE_SIZE, &cursor_callback);
+        avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+        CHECK_EQUAL(2, serve_all());
+        STRCMP_EQUAL("A0+10|A10+10|", event_log);
+        const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, 19);
+        CHECK(item != NULL);
+        STRCMP_EQUAL("Track 19", item->name);
+        STRCMP_EQUAL("Artist 5", item->artist);
+    }
+}
+
+// folder, media player, unknown item and media element
+static uint16_t store_mixed_items(uint8_t * buffer){
+    uint16_t pos = 0;
+    // folder item
+    const uint8_t folder[] = { AVRCP_BROWSING_FOLDER_ITEM, 0, 17, 0, 0, 0, 0, 0, 0, 0, 7, 1, 1, 0, 0x6a, 0, 3, 'P', 'o', 'p' };
+    memcpy(&buffer[pos], folder, sizeof(folder));
+    pos += sizeof(folder);
+    // media player item
+    uint8_t player[3 + 28 + 4];
+    memset(player, 0, sizeof(player));
+    player[0] = AVRCP_BROWSING_MEDIA_PLAYER_ITEM;
+    big_endian_store_16(player, 1, sizeof(player) - 3);
+    big_endian_store_16(player, 3, 0x0102);
+    player[5] = AVRCP_BROWSING_MEDIA_PLAYER_MAJOR_TYPE_AUDIO;
+    player[10] = AVRCP_BROWSING_MEDIA_PLAYER_STATUS_PLAYING;
+    big_endian_store_16(player, 27, 0x006a);
+    big_endian_store_16(player, 29, 4);
+    memcpy(&player[31], "Play", 4);
+    memcpy(&buffer[pos], player, sizeof(player));
+    pos += sizeof(player);
+    // unknown item type
+    const uint8_t unknown[] = { 0x7f, 0, 2, 0xaa, 0xbb };
+    memcpy(&buffer[pos], unknown, sizeof(unknown));
+    pos += sizeof(unknown);
+    pos += store_element_item(&buffer[pos], 3, "Song", "Band");
+    return pos;
+}
+
+static void check_mixed_items(void){
+    const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, 0);
+    CHECK(item != NULL);
+    CHECK_EQUAL(AVRCP_BROWSING_FOLDER_ITEM, item->item_type);
+    CHECK_EQUAL(7, item->uid[7]);
+    CHECK_EQUAL(1, item->type);
+    CHECK_EQUAL(1, item->playable);
+    STRCMP_EQUAL("Pop", item->name);
+    item = avrcp_browsing_cursor_get_item(&cursor, 1);
+    CHECK(item != NULL);
+    CHECK_EQUAL(AVRCP_BROWSING_MEDIA_PLAYER_ITEM, item->item_type);
+    CHECK_EQUAL(0x0102, big_endian_read_16(item->uid, 0));
+    CHECK_EQUAL(AVRCP_BROWSING_MEDIA_PLAYER_MAJOR_TYPE_AUDIO, item->type);
+    CHECK_EQUAL(AVRCP_BROWSING_MEDIA_PLAYER_STATUS_PLAYING, item->playable);
+    STRCMP_EQUAL("Play", item->name);
+    item = avrcp_browsing_cursor_get_item(&cursor, 2);
+    CHECK(item != NULL);
+    CHECK_EQUAL(0x7f, item->item_type);
+    CHECK_EQUAL(0, item->name_len);
+    item = avrcp_browsing_cursor_get_item(&cursor, 3);
+    CHECK(item != NULL);
+    STRCMP_EQUAL("Song", item->name);
+    STRCMP_EQUAL("Band", item->artist);
+}
+
+TEST(AVRCPBrowsingCursor, AllSplitPositions){
+    uint8_t buffer[200];
+    uint16_t len = store_mixed_items(buffer);
+    uint16_t split;
+    for (split = 0; split <= len; split++){
+        event_log_len = 0;
+        avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_MEDIA_PLAYER_VIRTUAL_FILESYSTEM, AVRCP_MEDIA_ATTR_ALL, items, NUM_ITEMS, PAGE_SIZE, &cursor_callback);
+        avrcp_browsing_cursor_set_position(&cursor, 0, 4);
+        uint32_t start_item;
+        uint32_t end_item;
+        CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+        avrcp_browsing_cursor_handle_response_begin(&cursor, 1, 4);
+        avrcp_browsing_cursor_handle_response_data(&cursor, buffer, split);
+        avrcp_browsing_cursor_handle_response_data(&cursor, &buffer[split], len - split);
+        avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+        STRCMP_EQUAL("A0+4|", event_log);
+        check_mixed_items();
+    }
+}
+
+TEST(AVRCPBrowsingCursor, LongValuesTruncated){
+    char name[100];
+    memset(name, 'n', sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    uint8_t buffer[300];
+    uint16_t len = store_element_item(buffer, 0, name, name);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 1);
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    avrcp_browsing_cursor_handle_response_begin(&cursor, 1, 1);
+    avrcp_browsing_cursor_handle_response_data(&cursor, buffer, len);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+    const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, 0);
+    CHECK(item != NULL);
+    CHECK_EQUAL(AVRCP_BROWSING_CURSOR_MAX_NAME_LEN, item->name_len);
+    CHECK_EQUAL(AVRCP_BROWSING_CURSOR_MAX_NAME_LEN, strlen(item->name));
+    CHECK_EQUAL(AVRCP_BROWSING_CURSOR_MAX_NAME_LEN, strlen(item->artist));
+}
+
+TEST(AVRCPBrowsingCursor, TruncatedItem){
+    // item length shorter than name, next item parsed from declared item length
+    uint8_t buffer[200];
+    uint16_t len = store_element_item(buffer, 0, "Song", "Band");
+    big_endian_store_16(buffer, 1, 14);
+    uint16_t item_len = 3 + 14;
+    len = item_len + store_element_item(&buffer[item_len], 1, "Next", "Band");
+    avrcp_browsing_cursor_set_position(&cursor, 0, 1);
+    uint32_t start_item;
+    uint32_t end_item;
+    CHECK_TRUE(avrcp_browsing_cursor_get_request(&cursor, &start_item, &end_item));
+    avrcp_browsing_cursor_handle_response_begin(&cursor, 1, 2);
+    avrcp_browsing_cursor_handle_response_data(&cursor, buffer, len);
+    avrcp_browsing_cursor_handle_response_end(&cursor, AVRCP_BROWSING_ERROR_CODE_SUCCESS);
+    const avrcp_browsing_cursor_item_t * item = avrcp_browsing_cursor_get_item(&cursor, 0);
+    CHECK(item != NULL);
+    STRCMP_EQUAL("S", item->name);
+    item = avrcp_browsing_cursor_get_item(&cursor, 1);
+    CHECK(item != NULL);
+    STRCMP_EQUAL("Next", item->name);
+}
+
+TEST(AVRCPBrowsingCursor, SmallStorage){
+    // storage for less than a page
+    avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, PAGE_SIZE - 1, PAGE_SIZE, &cursor_callback);
+    avrcp_browsing_cursor_set_position(&cursor, 0, 10);
+    CHECK_EQUAL(0, serve_all());
+}
+
+// AVRCP and L2CAP stubs for Browsing Controller
+#define BROWSING_CID 0x41
+#define L2CAP_CID    0x42
+
+avrcp_context_t avrcp_controller_context;
+
+static avrcp_connection_t          avrcp_connection;
+static avrcp_browsing_connection_t browsing_connection;
+static btstack_packet_handler_t    browsing_packet_handler;
+static int      num_can_send_now_requests;
+static int      num_browsing_events;
+static uint8_t  sent_command[100];
+static uint16_t sent_command_len;
+
+void avrcp_browsing_register_controller_packet_handler(btstack_packet_handler_t callback){
+    browsing_packet_handler = callback;
+}
+
+void avrcp_browsing_request_can_send_now(avrcp_browsing_connection_t * connection, uint16_t l2cap_cid){
+    (void) connection;
+    (void) l2cap_cid;
+    num_can_send_now_requests++;
+}
+
+avrcp_connection_t * avrcp_get_connection_for_browsing_cid_for_role(avrcp_role_t role, uint16_t browsing_cid){
+    if ((role != AVRCP_CONTROLLER) || (browsing_cid != BROWSING_CID)) return NULL;
+    return &avrcp_connection;
+}
+
+avrcp_browsing_connection_t * avrcp_get_browsing_connection_for_l2cap_cid_for_role(avrcp_role_t role, uint16_t l2cap_cid){
+    if ((role != AVRCP_CONTROLLER) || (l2cap_cid != L2CAP_CID)) return NULL;
+    return &browsing_connection;
+}
+
+int l2cap_send(uint16_t local_cid, uint8_t * data, uint16_t len){
+    (void) local_cid;
+    if (len > sizeof(sent_command)) return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
+    memcpy(sent_command, data, len);
+    sent_command_len = len;
+    return ERROR_CODE_SUCCESS;
+}
+
+static void browsing_event_handler(uint8_t packet_type, uint16_t channel, uint8_t * packet, uint16_t size){
+    (void) packet_type;
+    (void) channel;
+    (void) packet;
+    (void) size;
+    num_browsing_events++;
+}
+
+static void controller_can_send_now(void){
+    uint8_t event[4] = { L2CAP_EVENT_CAN_SEND_NOW, 2 };
+    little_endian_store_16(event, 2, L2CAP_CID);
+    (*browsing_packet_handler)(HCI_EVENT_PACKET, L2CAP_CID, event, sizeof(event));
+}
+
+// GetFolderItems response for range of last command
+static void controller_receive_get_folder_items_response(void){
+    CHECK_EQUAL(AVRCP_PDU_ID_GET_FOLDER_ITEMS, sent_command[3]);
+    uint32_t start_item = big_endian_read_32(sent_command, 7);
+    uint32_t end_item = big_endian_read_32(sent_command, 11);
+    uint8_t packet[2000];
+    uint16_t pos = 0;
+    packet[pos++] = (AVRCP_SINGLE_PACKET << 2) | (AVRCP_RESPONSE_FRAME << 1);
+    big_endian_store_16(packet, pos, BLUETOOTH_SERVICE_CLASS_AV_REMOTE_CONTROL);
+    pos += 2;
+    packet[pos++] = AVRCP_PDU_ID_GET_FOLDER_ITEMS;
+    pos += 2;
+    packet[pos++] = AVRCP_BROWSING_ERROR_CODE_SUCCESS;
+    big_endian_store_16(packet, pos, library_uid_counter);
+    pos += 2;
+    big_endian_store_16(packet, pos, (uint16_t) (end_item - start_item + 1));
+    pos += 2;
+    uint32_t index;
+    for (index = start_item; index <= end_item; index++){
+        pos += store_track(&packet[pos], index);
+    }
+    big_endian_store_16(packet, 4, pos - 7);
+    (*browsing_packet_handler)(L2CAP_DATA_PACKET, L2CAP_CID, packet, pos);
+}
+
+TEST_GROUP(AVRCPBrowsingControllerCursor){
+    void setup(void){
+        library_uid_counter = 1;
+        num_can_send_now_requests = 0;
+        num_browsing_events = 0;
+        sent_command_len = 0;
+        event_log_len = 0;
+        event_log[0] = 0;
+        memset(&avrcp_connection, 0, sizeof(avrcp_connection));
+        memset(&browsing_connection, 0, sizeof(browsing_connection));
+        avrcp_connection.browsing_connection = &browsing_connection;
+        browsing_connection.l2cap_browsing_cid = L2CAP_CID;
+        browsing_connection.state = AVCTP_CONNECTION_OPENED;
+        avrcp_browsing_controller_init();
+        avrcp_browsing_controller_register_packet_handler(&browsing_event_handler);
+        avrcp_browsing_cursor_init(&cursor, AVRCP_BROWSING_NOW_PLAYING, AVRCP_MEDIA_ATTR_ALL, items, NUM_ITEMS, PAGE_SIZE, &cursor_callback);
+        avrcp_browsing_cursor_set_position(&cursor, 0, PAGE_SIZE);
+    }
+};
+
+TEST(AVRCPBrowsingControllerCursor, PageFetched){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_attach_cursor(BROWSING_CID, &cursor));
+    CHECK_EQUAL(1, num_can_send_now_requests);
+    controller_can_send_now();
+    CHECK_EQUAL(AVRCP_PDU_ID_GET_FOLDER_ITEMS, sent_command[3]);
+    controller_receive_get_folder_items_response();
+    CHECK(is_cached(0));
+    CHECK(is_cached(PAGE_SIZE - 1));
+    CHECK_EQUAL(0, num_browsing_events);
+    CHECK_EQUAL(AVCTP_CONNECTION_OPENED, browsing_connection.state);
+}
+
+TEST(AVRCPBrowsingControllerCursor, DetachWithPendingRequest){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_attach_cursor(BROWSING_CID, &cursor));
+    controller_can_send_now();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_detach_cursor(BROWSING_CID));
+
+    // response is dropped without events
+    controller_receive_get_folder_items_response();
+    CHECK_FALSE(is_cached(0));
+    STRCMP_EQUAL("", event_log);
+    CHECK_EQUAL(0, num_browsing_events);
+    CHECK_EQUAL(AVCTP_CONNECTION_OPENED, browsing_connection.state);
+    CHECK_FALSE(browsing_connection.cursor_request);
+}
+
+TEST(AVRCPBrowsingControllerCursor, AttachWithPendingRequest){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_attach_cursor(BROWSING_CID, &cursor));
+    controller_can_send_now();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_detach_cursor(BROWSING_CID));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, avrcp_browsing_controller_attach_cursor(BROWSING_CID, &cursor));
+
+    // response to request of detached cursor is dropped, then cursor sends its own request
+    int num_requests = num_can_send_now_requests;
+    controller_receive_get_folder_items_response();
+    CHECK_FALSE(is_cached(0));
+    CHECK_EQUAL(0, num_browsing_events);
+    CHECK_EQUAL(num_requests + 1, num_can_send_now_requests);
+    sent_command_len = 0;
+    controller_can_send_now();
+    CHECK(sent_command_len > 0);
+    controller_receive_get_folder_items_response();
+    CHECK(is_cached(0));
+    CHECK_EQUAL(0, num_browsing_events);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
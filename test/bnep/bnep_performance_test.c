@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// BNEP loopback performance test
+//
+// An iperf-style sender writes 1500 byte ethernet frames into a SOCK_SEQPACKET
+// socket pair that stands in for the TAP device. Frames are read and sent over
+// a BNEP channel with a mocked L2CAP layer providing a fixed number of ACL
+// buffers. Each iteration of the simulated run loop ends with one ACL round
+// trip: sent packets are looped back into BNEP as received data and their ACL
+// buffers are completed.
+//
+// - single frame: one frame read per run loop iteration, sent via
+//   bnep_request_can_send_now_event / bnep_send (previous btstack_network_posix)
+// - queued:       all available frames are read into a frame pool and queued
+//   with bnep_send_frame
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "bluetooth_sdp.h"
+#include "classic/bnep.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define NUM_ACL_BUFFERS 8
+#define NUM_FRAMES_POOL 16
+#define FRAME_LEN       1500
+#define NUM_FRAMES      200000
+#define PRE_BUFFER      16
+
+static bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static int      sockets[2];
+static uint16_t bnep_cid;
+static uint8_t  sender_frame[FRAME_LEN];
+static uint32_t frames_sent_by_sender;
+
+// ACL packets in flight
+static uint8_t  in_flight[NUM_ACL_BUFFERS][PRE_BUFFER + BNEP_MTU_MIN];
+static uint16_t in_flight_len[NUM_ACL_BUFFERS];
+static int      num_in_flight;
+
+// loopback receiver
+static uint32_t frames_received;
+static uint64_t bytes_received;
+
+// single frame flow
+static uint8_t  network_buffer[BNEP_MTU_MIN];
+static uint16_t network_buffer_len;
+static int      read_enabled;
+
+// queued flow
+typedef struct {
+    bnep_tx_frame_t tx;
+    uint8_t data[BNEP_MTU_MIN];
+} frame_t;
+static frame_t   frames[NUM_FRAMES_POOL];
+static frame_t * frames_free[NUM_FRAMES_POOL];
+static int       num_frames_free;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) != BNEP_EVENT_CAN_SEND_NOW) break;
+            if (network_buffer_len == 0) break;
+            bnep_send(bnep_cid, network_buffer, network_buffer_len);
+            network_buffer_len = 0;
+            // btstack_network_packet_sent: tap data source gets enabled for next run loop iteration
+            read_enabled = 1;
+            break;
+        case BNEP_DATA_PACKET:
+            if (size == FRAME_LEN){
+                frames_received++;
+                bytes_received += size;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_handler(uint16_t cid, const uint8_t * packet, uint16_t size){
+    UNUSED(cid);
+    memcpy(&in_flight[num_in_flight][PRE_BUFFER], packet, size);
+    in_flight_len[num_in_flight] = size;
+    num_in_flight++;
+}
+
+static void sender_top_up(void){
+    while (frames_sent_by_sender < NUM_FRAMES){
+        ssize_t res = send(sockets[0], sender_frame, FRAME_LEN, MSG_DONTWAIT);
+        if (res < 0) break;
+        frames_sent_by_sender++;
+    }
+}
+
+static void acl_round_trip(void){
+    int i;
+    int num_completed = num_in_flight;
+    for (i=0;i<num_completed;i++){
+        mock_l2cap_receive(bnep_cid, &in_flight[i][PRE_BUFFER], in_flight_len[i]);
+    }
+    num_in_flight = 0;
+    mock_l2cap_complete_packets(num_completed);
+}
+
+static void frame_done(bnep_tx_frame_t * tx, uint8_t status){
+    UNUSED(status);
+    frames_free[num_frames_free++] = (frame_t *) tx->context;
+}
+
+static void single_frame_iteration(void){
+    if (read_enabled == 0) return;
+    ssize_t len = read(sockets[1], network_buffer, sizeof(network_buffer));
+    if (len <= 0) return;
+    network_buffer_len = (uint16_t) len;
+    read_enabled = 0;
+    bnep_request_can_send_now_event(bnep_cid);
+}
+
+static void queued_iteration(void){
+    while (num_frames_free > 0){
+        frame_t * frame = frames_free[num_frames_free - 1];
+        ssize_t len = read(sockets[1], frame->data, sizeof(frame->data));
+        if (len <= 0) return;
+        num_frames_free--;
+        frame->tx.data = frame->data;
+        frame->tx.len = (uint16_t) len;
+        frame->tx.callback = &frame_done;
+        frame->tx.context = frame;
+        bnep_send_frame(bnep_cid, &frame->tx);
+    }
+}
+
+static void measure(const char * name, void (*iteration)(void)){
+    btstack_memory_init();
+    mock_l2cap_init(NUM_ACL_BUFFERS, BNEP_MTU_MIN);
+    bnep_init();
+    bnep_register_service(&packet_handler, BLUETOOTH_SERVICE_CLASS_NAP, BNEP_MTU_MIN);
+    bnep_cid = mock_bnep_open_channel(remote_addr);
+    mock_l2cap_complete_packets(1);
+    mock_l2cap_set_send_handler(&send_handler);
+
+    socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets);
+    fcntl(sockets[1], F_SETFL, fcntl(sockets[1], F_GETFL, 0) | O_NONBLOCK);
+
+    int i;
+    num_frames_free = 0;
+    for (i=0;i<NUM_FRAMES_POOL;i++){
+        frames_free[num_frames_free++] = &frames[i];
+    }
+    frames_sent_by_sender = 0;
+    frames_received = 0;
+    bytes_received = 0;
+    num_in_flight = 0;
+    network_buffer_len = 0;
+    read_enabled = 1;
+
+    uint32_t iterations = 0;
+    uint32_t start_us = perf_timer_get_time_us();
+    while (frames_received < NUM_FRAMES){
+        sender_top_up();
+        (*iteration)();
+        acl_round_trip();
+        iterations++;
+    }
+    double duration_us = (double) (perf_timer_get_time_us() - start_us);
+
+    printf("  %-12s: %5.2f frames per ACL round trip, %6.3f us per frame, %7.1f Mbit/s loopback\n", name,
+           (double) frames_received / iterations, duration_us / frames_received, (double) bytes_received * 8 / duration_us);
+
+    close(sockets[0]);
+    close(sockets[1]);
+    mock_l2cap_close_channel(bnep_cid);
+    btstack_memory_deinit();
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    memset(sender_frame, 0x55, sizeof(sender_frame));
+    // destination: remote, source: local -> compressed header
+    memcpy(&sender_frame[0], remote_addr, 6);
+    mock_gap_local_bd_addr(&sender_frame[6]);
+    big_endian_store_16(sender_frame, 12, 0x0800);
+
+    printf("%u frames of %u bytes, %u ACL buffers, %u frame buffers\n", NUM_FRAMES, FRAME_LEN, NUM_ACL_BUFFERS, NUM_FRAMES_POOL);
+    measure("single frame", &single_frame_iteration);
+    measure("queued",       &queued_iteration);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "bluetooth_sdp.h"
+#include "classic/bnep.h"
+
+#include "mock.h"
+
+#define NUM_FRAMES 10
+#define PAYLOAD_LEN 100
+
+static bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static bd_addr_t other_addr  = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static int channel_opened;
+static int frames_sent;
+static int frames_dropped;
+static uint8_t sent_order[NUM_FRAMES];
+static uint8_t last_packet[BNEP_MTU_MIN];
+static uint16_t last_packet_len;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) == BNEP_EVENT_CHANNEL_OPENED){
+        channel_opened = 1;
+    }
+}
+
+static void send_handler(uint16_t cid, const uint8_t * packet, uint16_t size){
+    UNUSED(cid);
+    memcpy(last_packet, packet, size);
+    last_packet_len = size;
+}
+
+static void frame_done(bnep_tx_frame_t * frame, uint8_t status){
+    if (status == ERROR_CODE_SUCCESS){
+        if (frames_sent < NUM_FRAMES){
+            sent_order[frames_sent] = (uint8_t)(uintptr_t) frame->context;
+        }
+        frames_sent++;
+    } else {
+        frames_dropped++;
+    }
+}
+
+static uint16_t build_frame(uint8_t * frame, const uint8_t * dest, const uint8_t * source, uint8_t tag){
+    memcpy(&frame[0], dest, 6);
+    memcpy(&frame[6], source, 6);
+    big_endian_store_16(frame, 12, 0x0800);
+    memset(&frame[14], tag, PAYLOAD_LEN);
+    return 14 + PAYLOAD_LEN;
+}
+
+TEST_GROUP(BNEP){
+    uint16_t bnep_cid;
+    bd_addr_t local_addr;
+    bnep_tx_frame_t tx_frames[NUM_FRAMES];
+    uint8_t frame_data[NUM_FRAMES][14 + PAYLOAD_LEN];
+
+    void setup(void){
+        channel_opened = 0;
+        frames_sent = 0;
+        frames_dropped = 0;
+        last_packet_len = 0;
+        btstack_memory_init();
+        mock_l2cap_init(4, BNEP_MTU_MIN);
+        mock_gap_local_bd_addr(local_addr);
+        bnep_init();
+        bnep_register_service(&packet_handler, BLUETOOTH_SERVICE_CLASS_NAP, BNEP_MTU_MIN);
+        bnep_cid = mock_bnep_open_channel(remote_addr);
+        // connection response uses one ACL buffer
+        mock_l2cap_complete_packets(1);
+        mock_l2cap_set_send_handler(&send_handler);
+    }
+
+    void teardown(void){
+        mock_l2cap_close_channel(bnep_cid);
+        btstack_memory_deinit();
+    }
+
+    void queue_frame(int i, const uint8_t * dest, const uint8_t * source){
+        tx_frames[i].len = build_frame(frame_data[i], dest, source, (uint8_t) i);
+        tx_frames[i].data = frame_data[i];
+        tx_frames[i].callback = &frame_done;
+        tx_frames[i].context = (void *)(uintptr_t) i;
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, bnep_send_frame(bnep_cid, &tx_frames[i]));
+    }
+};
+
+TEST(BNEP, ChannelOpened){
+    CHECK_EQUAL(1, channel_opened);
+}
+
+TEST(BNEP, QueueSendsMultipleFramesPerRoundTrip){
+    int i;
+    for (i=0;i<NUM_FRAMES;i++){
+        queue_frame(i, remote_addr, local_addr);
+    }
+    // all available ACL buffers used right away
+    CHECK_EQUAL(4, frames_sent);
+    mock_l2cap_complete_packets(4);
+    CHECK_EQUAL(8, frames_sent);
+    mock_l2cap_complete_packets(4);
+    CHECK_EQUAL(NUM_FRAMES, frames_sent);
+    for (i=0;i<NUM_FRAMES;i++){
+        CHECK_EQUAL(i, sent_order[i]);
+    }
+    CHECK_EQUAL(0, frames_dropped);
+}
+
+TEST(BNEP, HeaderCompressed){
+    queue_frame(0, remote_addr, local_addr);
+    CHECK_EQUAL(3 + PAYLOAD_LEN, last_packet_len);
+    CHECK_EQUAL(0x02, last_packet[0]);
+    CHECK_EQUAL(0x0800, big_endian_read_16(last_packet, 1));
+    CHECK_EQUAL(0, last_packet[3]);
+}
+
+TEST(BNEP, HeaderSourceOnly){
+    queue_frame(1, remote_addr, other_addr);
+    CHECK_EQUAL(9 + PAYLOAD_LEN, last_packet_len);
+    CHECK_EQUAL(0x03, last_packet[0]);
+    MEMCMP_EQUAL(other_addr, &last_packet[1], 6);
+}
+
+TEST(BNEP, HeaderDestOnly){
+    queue_frame(2, other_addr, local_addr);
+    CHECK_EQUAL(9 + PAYLOAD_LEN, last_packet_len);
+    CHECK_EQUAL(0x04, last_packet[0]);
+    MEMCMP_EQUAL(other_addr, &last_packet[1], 6);
+}
+
+TEST(BNEP, HeaderGeneral){
+    queue_frame(3, other_addr, other_addr);
+    CHECK_EQUAL(15 + PAYLOAD_LEN, last_packet_len);
+    CHECK_EQUAL(0x00, last_packet[0]);
+    CHECK_EQUAL(3, last_packet[15]);
+}
+
+TEST(BNEP, DropOnClose){
+    int i;
+    for (i=0;i<NUM_FRAMES;i++){
+        queue_frame(i, remote_addr, local_addr);
+    }
+    CHECK_EQUAL(4, frames_sent);
+    mock_l2cap_close_channel(bnep_cid);
+    CHECK_EQUAL(NUM_FRAMES - 4, frames_dropped);
+}
+
+TEST(BNEP, FrameTooLarge){
+    static uint8_t large_frame[BNEP_MTU_MIN + 20];
+    bnep_tx_frame_t tx;
+    memset(large_frame, 0, sizeof(large_frame));
+    tx.data = large_frame;
+    tx.len  = sizeof(large_frame);
+    tx.callback = &frame_done;
+    CHECK_EQUAL(BNEP_DATA_LEN_EXCEEDS_MTU, bnep_send_frame(bnep_cid, &tx));
+}
+
+TEST(BNEP, NotConnected){
+    bnep_tx_frame_t tx;
+    tx.data = frame_data[0];
+    tx.len  = 14;
+    tx.callback = &frame_done;
+    CHECK_EQUAL(BNEP_CHANNEL_NOT_CONNECTED, bnep_send_frame(0x1234, &tx));
+}
+
+TEST(BNEP, SendWithoutQueue){
+    uint16_t len = build_frame(frame_data[0], remote_addr, local_addr, 0);
+    int i;
+    for (i=0;i<4;i++){
+        CHECK_EQUAL(0, bnep_send(bnep_cid, frame_data[0], len));
+    }
+    CHECK_EQUAL(BTSTACK_ACL_BUFFERS_FULL, bnep_send(bnep_cid, frame_data[0], len));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,15 @@
+#include <stdint.h>
+
+#include "bluetooth.h"
+#include "bluetooth_psm.h"
+
+#include "mock.h"
+
+uint16_t mock_bnep_open_channel(bd_addr_t remote_addr){
+    mock_l2cap_open_channel(remote_addr, BLUETOOTH_PSM_BNEP);
+
+    // BNEP setup connection request: NAP <- PANU
+    uint8_t setup_request[] = { 0x01, 0x01, 0x02, 0x11, 0x16, 0x11, 0x15 };
+    mock_l2cap_receive(MOCK_L2CAP_CID, setup_request, sizeof(setup_request));
+    return MOCK_L2CAP_CID;
+}
@@ -0,0 +1,20 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+
+#include "mock_l2cap.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// open BNEP channel from remote device, returns bnep_cid
+uint16_t mock_bnep_open_channel(bd_addr_t remote_addr);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/CommandLineTestRunner.h"
 
@@ -45,6 +46,91 @@ TEST(RemoteDeviceDB, SinglePutGetDeleteKey){
     CHECK(btstack_link_key_db_fs_instance()->get_link_key(bd_addr, test_link_key, &test_link_key_type) == 0);
 }
 
+TEST(RemoteDeviceDB, PersistAcrossClose){
+    link_key_t test_link_key;
+    link_key_type_t test_link_key_type;
+    bd_addr_t local_addr = {0x00, 0x1b, 0xdc, 0x07, 0x32, 0xef };
+
+    const btstack_link_key_db_t * db = btstack_link_key_db_fs_instance();
+    db->set_local_bd_addr(local_addr);
+    db->put_link_key(bd_addr, link_key, link_key_type);
+    db->close();
+
+    db->open();
+    db->set_local_bd_addr(local_addr);
+    CHECK(db->get_link_key(bd_addr, test_link_key, &test_link_key_type) == 1);
+    CHECK(memcmp(link_key, test_link_key, 16) == 0);
+    CHECK_EQUAL(link_key_type, test_link_key_type);
+    db->delete_link_key(bd_addr);
+    db->close();
+}
+
+TEST(RemoteDeviceDB, IterateAndDelete){
+    bd_addr_t addr;
+    link_key_t test_link_key;
+    link_key_type_t test_link_key_type;
+    const btstack_link_key_db_t * db = btstack_link_key_db_fs_instance();
+    int i;
+    for (i=0;i<10;i++){
+        bd_addr_copy(addr, bd_addr);
+        addr[5] = (uint8_t) (0x10 + i);
+        db->put_link_key(addr, link_key, (link_key_type_t) i);
+    }
+
+    btstack_link_key_iterator_t it;
+    CHECK(db->iterator_init(&it) == 1);
+    int found = 0;
+    while (db->iterator_get_next(&it, addr, test_link_key, &test_link_key_type)){
+        CHECK_EQUAL(addr[5] - 0x10, (int) test_link_key_type);
+        CHECK(memcmp(link_key, test_link_key, 16) == 0);
+        db->delete_link_key(addr);
+        found++;
+    }
+    db->iterator_done(&it);
+    CHECK_EQUAL(10, found);
+
+    CHECK(db->iterator_init(&it) == 1);
+    CHECK(db->iterator_get_next(&it, addr, test_link_key, &test_link_key_type) == 0);
+    db->iterator_done(&it);
+}
+
+TEST(RemoteDeviceDB, ImportLegacyFormat){
+    link_key_t test_link_key;
+    link_key_type_t test_link_key_type;
+    bd_addr_t local_addr = {0x00, 0x1b, 0xdc, 0x07, 0x32, 0xee };
+    const char * db_path     = "/tmp/btstack_at_00-1B-DC-07-32-EE_link_keys.db";
+    const char * legacy_path = "/tmp/btstack_at_00-1B-DC-07-32-EE_link_key_for_00-01-02-03-04-01.txt";
+    const char * other_path  = "/tmp/btstack_at_00-1B-DC-07-32-EE_link_key_for_00-01-02-03-04-02.txt.bak";
+    unlink(db_path);
+    FILE * file = fopen(legacy_path, "w");
+    fputs("000102030405060708090A0B0C0D0E0F5", file);
+    fclose(file);
+    file = fopen(other_path, "w");
+    fputs("000102030405060708090A0B0C0D0E0F5", file);
+    fclose(file);
+
+    const btstack_link_key_db_t * db = btstack_link_key_db_fs_instance();
+    db->set_local_bd_addr(local_addr);
+    CHECK(db->get_link_key(bd_addr, test_link_key, &test_link_key_type) == 1);
+    CHECK_EQUAL(5, test_link_key_type);
+    int i;
+    for (i=0;i<16;i++){
+        CHECK_EQUAL(i, test_link_key[i]);
+    }
+    bd_addr_t other_addr = {0x00, 0x01, 0x02, 0x03, 0x04, 0x02 };
+    CHECK(db->get_link_key(other_addr, test_link_key, &test_link_key_type) == 0);
+
+    // not imported again once log exists
+    db->delete_link_key(bd_addr);
+    db->close();
+    db->open();
+    db->set_local_bd_addr(local_addr);
+    CHECK(db->get_link_key(bd_addr, test_link_key, &test_link_key_type) == 0);
+    db->close();
+    unlink(legacy_path);
+    unlink(other_path);
+    unlink(db_path);
+}
 
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
@@ -89,6 +89,10 @@ void CHECK_EQUAL_ARRAY(const uint8_t * expected, uint8_t * actual, int size){
 extern "C" {
     void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
     }
+    void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                          const uint8_t * event_codes, uint16_t num_event_codes,
+                                          const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    }
     int hci_can_send_command_packet_now(void){
         return 1;
     }
@@ -13,6 +13,16 @@ void hci_add_event_handler(btstack_packet_callback_registration_t * callback_han
 	btstack_linked_list_add(&event_packet_handlers, (btstack_linked_item_t *) callback_handler);
 }
 
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    UNUSED(event_codes);
+    UNUSED(num_event_codes);
+    UNUSED(le_subevent_codes);
+    UNUSED(num_le_subevent_codes);
+    hci_add_event_handler(callback_handler);
+}
+
 int hci_can_send_command_packet_now(void){
 	return 1;
 }
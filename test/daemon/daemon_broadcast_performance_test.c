@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Daemon broadcast performance test
+//
+// Accepts a number of unix socket clients and forwards a stream of LE
+// Advertising Reports to them from a run loop timer, as during heavy scanning.
+// Reports daemon thread CPU time when all clients receive all events and
+// when only one client subscribed to advertising reports.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "btstack_defines.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "daemon_packet_filter.h"
+#include "perf_timer.h"
+#include "socket_connection.h"
+
+#define MAX_CLIENTS             16
+#define NUM_REPORTS             20000
+#define REPORTS_PER_TICK        50
+#define TICK_MS                 1
+
+typedef struct {
+    connection_t * connection;
+    daemon_packet_filter_t packet_filter;
+    // output stats at start of run
+    socket_connection_output_stats_t stats;
+} client_t;
+
+static client_t clients[MAX_CLIENTS];
+static int      num_clients_connected;
+static int      client_fds[MAX_CLIENTS];
+
+static const int num_clients_per_run[] = { 1, 4, 16 };
+static int run_index;
+static int run_filtered;
+static int run_active_clients;
+static int reports_sent;
+static uint32_t run_start_us;
+
+static btstack_timer_source_t tick_timer;
+
+static uint8_t le_advertising_report[] = {
+    HCI_EVENT_LE_META, 0x27, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 0x01, 0x00, 0x00,
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x1e,
+    0x02, 0x01, 0x06, 0x1a, 0xff, 0x4c, 0x00, 0x02, 0x15, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x00, 0x01, 0x00, 0x02, 0xc5,
+    0xc0,
+};
+
+static void connect_clients(void){
+    int i;
+    for (i=0;i<MAX_CLIENTS;i++){
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un server;
+        memset(&server, 0, sizeof(server));
+        server.sun_family = AF_UNIX;
+        strcpy(server.sun_path, BTSTACK_UNIX);
+        if (connect(fd, (struct sockaddr *)&server, sizeof(server)) < 0){
+            perror("connect");
+            exit(1);
+        }
+        client_fds[i] = fd;
+    }
+}
+
+// connect clients while the daemon run loop accepts them, then drain all client sockets
+static void * client_thread(void * context){
+    (void) context;
+    static uint8_t buffer[8192];
+    struct pollfd fds[MAX_CLIENTS];
+    int i;
+    connect_clients();
+    for (i=0;i<MAX_CLIENTS;i++){
+        fds[i].fd = client_fds[i];
+        fds[i].events = POLLIN;
+    }
+    while (1){
+        if (poll(fds, MAX_CLIENTS, -1) <= 0) continue;
+        for (i=0;i<MAX_CLIENTS;i++){
+            if (fds[i].revents & POLLIN){
+                if (read(fds[i].fd, buffer, sizeof(buffer)) <= 0) return NULL;
+            }
+        }
+    }
+}
+
+// same as daemon_emit_packet for broadcast packets
+static void emit_packet(uint8_t packet_type, uint8_t * packet, uint16_t size){
+    int i;
+    for (i=0;i<run_active_clients;i++){
+        if (!daemon_packet_filter_matches(&clients[i].packet_filter, packet_type, packet, size)) continue;
+        socket_connection_send_packet(clients[i].connection, packet_type, 0, packet, size);
+    }
+}
+
+static void start_run(void){
+    int i;
+    run_active_clients = num_clients_per_run[run_index / 2];
+    run_filtered = run_index & 1;
+    for (i=0;i<MAX_CLIENTS;i++){
+        socket_connection_get_output_stats(clients[i].connection, &clients[i].stats);
+        daemon_packet_filter_init(&clients[i].packet_filter);
+        if (run_filtered && (i > 0)){
+            // other clients are not scanning
+            daemon_packet_filter_set_event(&clients[i].packet_filter, HCI_EVENT_LE_META, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 0);
+        }
+    }
+    reports_sent = 0;
+    run_start_us = perf_timer_get_cpu_time_us();
+}
+
+static void finish_run(void){
+    double cpu_us = (double) (perf_timer_get_cpu_time_us() - run_start_us);
+    uint32_t packets_sent = 0;
+    uint32_t packets_dropped = 0;
+    int i;
+    for (i=0;i<run_active_clients;i++){
+        socket_connection_output_stats_t stats;
+        socket_connection_get_output_stats(clients[i].connection, &stats);
+        packets_sent    += (stats.packets_sent + stats.packets_queued) - (clients[i].stats.packets_sent + clients[i].stats.packets_queued);
+        packets_dropped += stats.packets_dropped - clients[i].stats.packets_dropped;
+    }
+    printf("%2u clients, %-14s: %8.0f us CPU, %5.2f us per report, %6u packets forwarded, %5u dropped\n",
+        run_active_clients, run_filtered ? "one subscribed" : "all subscribed",
+        cpu_us, cpu_us / NUM_REPORTS, packets_sent, packets_dropped);
+}
+
+static void tick_handler(btstack_timer_source_t * ts){
+    int i;
+    for (i=0;i<REPORTS_PER_TICK;i++){
+        emit_packet(HCI_EVENT_PACKET, le_advertising_report, sizeof(le_advertising_report));
+    }
+    reports_sent += REPORTS_PER_TICK;
+    if (reports_sent >= NUM_REPORTS){
+        finish_run();
+        run_index++;
+        if (run_index == (2 * sizeof(num_clients_per_run) / sizeof(int))){
+            unlink(BTSTACK_UNIX);
+            exit(0);
+        }
+        start_run();
+    }
+    btstack_run_loop_set_timer(ts, TICK_MS);
+    btstack_run_loop_add_timer(ts);
+}
+
+static int daemon_packet_handler(connection_t * connection, uint16_t packet_type, uint16_t channel, uint8_t * packet, uint16_t size){
+    (void) channel;
+    (void) size;
+    if (packet_type != DAEMON_EVENT_PACKET) return 0;
+    if (packet[0] != DAEMON_EVENT_CONNECTION_OPENED) return 0;
+    clients[num_clients_connected++].connection = connection;
+    if (num_clients_connected < MAX_CLIENTS) return 0;
+    start_run();
+    btstack_run_loop_set_timer_handler(&tick_timer, &tick_handler);
+    btstack_run_loop_set_timer(&tick_timer, TICK_MS);
+    btstack_run_loop_add_timer(&tick_timer);
+    return 0;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    socket_connection_init();
+    socket_connection_register_packet_callback(&daemon_packet_handler);
+    if (socket_connection_create_unix((char *) BTSTACK_UNIX) < 0){
+        printf("Could not create %s\n", BTSTACK_UNIX);
+        return 1;
+    }
+
+    printf("%u LE Advertising Reports, %u per %u ms\n", NUM_REPORTS, REPORTS_PER_TICK, TICK_MS);
+    pthread_t thread;
+    pthread_create(&thread, NULL, &client_thread, NULL);
+    btstack_run_loop_execute();
+    return 0;
+}
@@ -0,0 +1,93 @@
+// *****************************************************************************
+//
+// Daemon Packet Filter Test
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth.h"
+#include "btstack_defines.h"
+#include "daemon_packet_filter.h"
+
+static const uint8_t le_advertising_report[]  = { HCI_EVENT_LE_META, 0x0c, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 0x01, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x00, 0xc0 };
+static const uint8_t le_connection_complete[] = { HCI_EVENT_LE_META, 0x02, HCI_SUBEVENT_LE_CONNECTION_COMPLETE, 0x00 };
+static const uint8_t gap_advertising_report[] = { GAP_EVENT_ADVERTISING_REPORT, 0x01, 0x00 };
+static const uint8_t command_complete[]       = { HCI_EVENT_COMMAND_COMPLETE, 0x03, 0x01, 0x03, 0x0c };
+static const uint8_t acl_handle_1[]           = { 0x01, 0x20, 0x00, 0x00 };
+static const uint8_t acl_handle_2[]           = { 0x02, 0x20, 0x00, 0x00 };
+
+TEST_GROUP(DaemonPacketFilter){
+    daemon_packet_filter_t filter;
+
+    void setup(void){
+        daemon_packet_filter_init(&filter);
+    }
+};
+
+TEST(DaemonPacketFilter, AcceptAllByDefault){
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_advertising_report, sizeof(le_advertising_report)));
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_ACL_DATA_PACKET, acl_handle_1, sizeof(acl_handle_1)));
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, LOG_MESSAGE_PACKET, NULL, 0));
+}
+
+TEST(DaemonPacketFilter, PacketTypes){
+    daemon_packet_filter_set_packet_types(&filter, 1u << HCI_EVENT_PACKET);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_ACL_DATA_PACKET, acl_handle_1, sizeof(acl_handle_1)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_SCO_DATA_PACKET, acl_handle_1, sizeof(acl_handle_1)));
+    // packet types >= 16 are not filtered
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, LOG_MESSAGE_PACKET, NULL, 0));
+}
+
+TEST(DaemonPacketFilter, UnsubscribeEvent){
+    daemon_packet_filter_set_event(&filter, GAP_EVENT_ADVERTISING_REPORT, 0, 0);
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, gap_advertising_report, sizeof(gap_advertising_report)));
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    daemon_packet_filter_set_event(&filter, GAP_EVENT_ADVERTISING_REPORT, 0, 1);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, gap_advertising_report, sizeof(gap_advertising_report)));
+}
+
+TEST(DaemonPacketFilter, SubscribeOnly){
+    daemon_packet_filter_set_event(&filter, 0, 0, 0);
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_connection_complete, sizeof(le_connection_complete)));
+    daemon_packet_filter_set_event(&filter, HCI_EVENT_COMMAND_COMPLETE, 0, 1);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, gap_advertising_report, sizeof(gap_advertising_report)));
+}
+
+TEST(DaemonPacketFilter, LESubevents){
+    daemon_packet_filter_set_event(&filter, HCI_EVENT_LE_META, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 0);
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_advertising_report, sizeof(le_advertising_report)));
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_connection_complete, sizeof(le_connection_complete)));
+
+    // unsubscribe from all LE subevents
+    daemon_packet_filter_set_event(&filter, HCI_EVENT_LE_META, 0, 0);
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_connection_complete, sizeof(le_connection_complete)));
+
+    // subscribe to single subevent
+    daemon_packet_filter_set_event(&filter, HCI_EVENT_LE_META, HCI_SUBEVENT_LE_CONNECTION_COMPLETE, 1);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_connection_complete, sizeof(le_connection_complete)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, le_advertising_report, sizeof(le_advertising_report)));
+}
+
+TEST(DaemonPacketFilter, ConHandle){
+    daemon_packet_filter_set_con_handle(&filter, 0x0001);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_ACL_DATA_PACKET, acl_handle_1, sizeof(acl_handle_1)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_ACL_DATA_PACKET, acl_handle_2, sizeof(acl_handle_2)));
+    CHECK_EQUAL(0, daemon_packet_filter_matches(&filter, HCI_SCO_DATA_PACKET, acl_handle_2, sizeof(acl_handle_2)));
+    // events are not affected
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_EVENT_PACKET, command_complete, sizeof(command_complete)));
+    daemon_packet_filter_set_con_handle(&filter, HCI_CON_HANDLE_INVALID);
+    CHECK_EQUAL(1, daemon_packet_filter_matches(&filter, HCI_ACL_DATA_PACKET, acl_handle_2, sizeof(acl_handle_2)));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Flash Bank TLV performance test
+//
+// Fills hal_flash_bank_memory banks of different sizes with 32 byte values and
+// reports time and number of flash reads for boot restore (init + read all
+// tags) and for random lookups, with and without RAM index.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_flash_bank.h"
+#include "hal_flash_bank_memory.h"
+#include "btstack_tlv.h"
+#include "btstack_tlv_flash_bank.h"
+#include "perf_timer.h"
+
+#define VALUE_LEN       32
+#define NUM_LOOKUPS     10000
+#define MAX_TAGS        4096
+
+static const uint32_t bank_sizes[] = { 4096, 16384, 65536 };
+
+// flash bank wrapper that counts reads
+static const hal_flash_bank_t * memory_impl;
+static hal_flash_bank_memory_t  memory_context;
+static uint32_t                 num_reads;
+
+static uint32_t counting_get_size(void * context){
+    return memory_impl->get_size(context);
+}
+static uint32_t counting_get_alignment(void * context){
+    return memory_impl->get_alignment(context);
+}
+static void counting_erase(void * context, int bank){
+    memory_impl->erase(context, bank);
+}
+static void counting_read(void * context, int bank, uint32_t offset, uint8_t * buffer, uint32_t size){
+    num_reads++;
+    memory_impl->read(context, bank, offset, buffer, size);
+}
+static void counting_write(void * context, int bank, uint32_t offset, const uint8_t * data, uint32_t size){
+    memory_impl->write(context, bank, offset, data, size);
+}
+
+static const hal_flash_bank_t counting_impl = {
+    &counting_get_size,
+    &counting_get_alignment,
+    &counting_erase,
+    &counting_read,
+    &counting_write,
+};
+
+static btstack_tlv_flash_bank_t             tlv_context;
+static btstack_tlv_flash_bank_index_entry_t index_entries[MAX_TAGS];
+
+static const btstack_tlv_t * init_tlv(int use_index){
+    const btstack_tlv_t * tlv_impl = btstack_tlv_flash_bank_init_instance(&tlv_context, &counting_impl, &memory_context);
+    if (use_index){
+        btstack_tlv_flash_bank_enable_index(&tlv_context, index_entries, MAX_TAGS);
+    }
+    return tlv_impl;
+}
+
+static void measure(uint32_t num_tags, int use_index){
+    uint8_t value[VALUE_LEN];
+    uint32_t i;
+
+    // boot restore: init and read all tags
+    num_reads = 0;
+    uint32_t start_us = perf_timer_get_time_us();
+    const btstack_tlv_t * tlv_impl = init_tlv(use_index);
+    for (i=0;i<num_tags;i++){
+        tlv_impl->get_tag(&tlv_context, i + 1, value, VALUE_LEN);
+    }
+    double boot_us = (double) (perf_timer_get_time_us() - start_us);
+    uint32_t boot_reads = num_reads;
+
+    // random lookups
+    num_reads = 0;
+    srand(0);
+    start_us = perf_timer_get_time_us();
+    for (i=0;i<NUM_LOOKUPS;i++){
+        tlv_impl->get_tag(&tlv_context, (uint32_t)(rand() % num_tags) + 1, value, VALUE_LEN);
+    }
+    double lookup_us = (double) (perf_timer_get_time_us() - start_us);
+    uint32_t lookup_reads = num_reads;
+
+    printf("  %-8s: boot restore %9.0f us, %8u reads - lookup %7.2f us, %6.1f reads\n",
+           use_index ? "index" : "scan",
+           boot_us, boot_reads,
+           lookup_us / NUM_LOOKUPS, (double) lookup_reads / NUM_LOOKUPS);
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    printf("%u byte values, %u random lookups\n", VALUE_LEN, NUM_LOOKUPS);
+
+    unsigned int j;
+    for (j=0;j<sizeof(bank_sizes)/sizeof(uint32_t);j++){
+        uint32_t bank_size = bank_sizes[j];
+        uint8_t * storage = (uint8_t *) malloc(2 * bank_size);
+        memory_impl = hal_flash_bank_memory_init_instance(&memory_context, storage, 2 * bank_size);
+        memory_impl->erase(&memory_context, 0);
+        memory_impl->erase(&memory_context, 1);
+
+        // fill bank to about 75%
+        uint32_t num_tags = (bank_size * 3 / 4) / (8 + VALUE_LEN);
+        const btstack_tlv_t * tlv_impl = init_tlv(1);
+        uint8_t value[VALUE_LEN];
+        memset(value, 0x55, sizeof(value));
+        uint32_t i;
+        for (i=0;i<num_tags;i++){
+            tlv_impl->store_tag(&tlv_context, i + 1, value, VALUE_LEN);
+        }
+
+        printf("bank size %6u, %4u tags\n", bank_size, num_tags);
+        measure(num_tags, 0);
+        measure(num_tags, 1);
+        free(storage);
+    }
+    return 0;
+}
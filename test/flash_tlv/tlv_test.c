@@ -245,6 +245,121 @@ TEST(BSTACK_TLV, TestWriteResetRead){
     CHECK_EQUAL(buffer, data);
 }
 
+/// TLV with RAM index
+TEST_GROUP(BSTACK_TLV_INDEX){
+
+	const hal_flash_bank_t * hal_flash_bank_impl;
+	hal_flash_bank_memory_t  hal_flash_bank_context;
+
+	const btstack_tlv_t *    btstack_tlv_impl;
+	btstack_tlv_flash_bank_t btstack_tlv_context;
+	btstack_tlv_flash_bank_index_entry_t index_entries[4];
+
+    void setup(void){
+    	hal_flash_bank_impl = hal_flash_bank_memory_init_instance(&hal_flash_bank_context, hal_flash_bank_memory_storage, HAL_FLASH_BANK_MEMORY_STORAGE_SIZE);
+		hal_flash_bank_impl->erase(&hal_flash_bank_context, 0);
+		hal_flash_bank_impl->erase(&hal_flash_bank_context, 1);
+		init_with_index();
+    }
+
+	void init_with_index(void){
+		btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+		btstack_tlv_flash_bank_enable_index(&btstack_tlv_context, index_entries, 4);
+	}
+};
+
+TEST(BSTACK_TLV_INDEX, TestMissingTag){
+	int size = btstack_tlv_impl->get_tag(&btstack_tlv_context, 'abcd', NULL, 0);
+	CHECK_EQUAL(0, size);
+}
+
+TEST(BSTACK_TLV_INDEX, TestWriteABARead){
+	uint32_t tag_a = 'aaaa';
+	uint32_t tag_b = 'bbbb';
+	uint8_t  buffer = 1;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_a, &buffer, 1);
+	buffer = 2;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_b, &buffer, 1);
+	buffer = 3;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_a, &buffer, 1);
+	CHECK_EQUAL(2, btstack_tlv_context.index_count);
+	CHECK_EQUAL(1, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_a, NULL, 0));
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_a, &buffer, 1);
+	CHECK_EQUAL(3, buffer);
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_b, &buffer, 1);
+	CHECK_EQUAL(2, buffer);
+
+	// old entry deleted in flash
+	btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_a, &buffer, 1);
+	CHECK_EQUAL(3, buffer);
+}
+
+TEST(BSTACK_TLV_INDEX, TestWriteDeleteRead){
+	uint32_t tag = 'abcd';
+	uint8_t  buffer = 7;
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &buffer, 1);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &buffer, 1);
+	btstack_tlv_impl->delete_tag(&btstack_tlv_context, tag);
+	CHECK_EQUAL(0, btstack_tlv_context.index_count);
+	CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, NULL, 0));
+	// deleted in flash
+	btstack_tlv_impl = btstack_tlv_flash_bank_init_instance(&btstack_tlv_context, hal_flash_bank_impl, &hal_flash_bank_context);
+	CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, NULL, 0));
+}
+
+TEST(BSTACK_TLV_INDEX, TestMigrate){
+	uint32_t tag1 = 0x11223344;
+	uint32_t tag2 = 0x44556677;
+	uint8_t  data1[8];
+	memcpy(data1, "01234567", 8);
+	uint8_t  data2[8];
+	memcpy(data2, "abcdefgh", 8);
+
+	int i;
+	for (i=0;i<8;i++){
+		data1[0] = '0' + i;
+		data2[0] = 'a' + i;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag1, data1, 8);
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag2, data2, 8);
+	}
+	CHECK(btstack_tlv_context.index_entries != NULL);
+
+	uint8_t buffer[8];
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag1, &buffer[0], 8);
+	CHECK_EQUAL_ARRAY(data1, buffer, 8);
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag2, &buffer[0], 8);
+	CHECK_EQUAL_ARRAY(data2, buffer, 8);
+
+	init_with_index();
+	CHECK_EQUAL(2, btstack_tlv_context.index_count);
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag1, &buffer[0], 8);
+	CHECK_EQUAL_ARRAY(data1, buffer, 8);
+	btstack_tlv_impl->get_tag(&btstack_tlv_context, tag2, &buffer[0], 8);
+	CHECK_EQUAL_ARRAY(data2, buffer, 8);
+}
+
+TEST(BSTACK_TLV_INDEX, TestIndexFull){
+	uint8_t buffer;
+	uint32_t tag;
+	for (tag=1;tag<=5;tag++){
+		buffer = (uint8_t) tag;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &buffer, 1);
+	}
+	// index disabled, fall back to scanning
+	CHECK(btstack_tlv_context.index_entries == NULL);
+	for (tag=1;tag<=5;tag++){
+		btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, &buffer, 1);
+		CHECK_EQUAL(tag, buffer);
+	}
+	// cannot be enabled with 5 tags
+	CHECK_EQUAL(1, btstack_tlv_flash_bank_enable_index(&btstack_tlv_context, index_entries, 4));
+	CHECK(btstack_tlv_context.index_entries == NULL);
+	btstack_tlv_impl->delete_tag(&btstack_tlv_context, 5);
+	CHECK_EQUAL(0, btstack_tlv_flash_bank_enable_index(&btstack_tlv_context, index_entries, 4));
+	CHECK_EQUAL(4, btstack_tlv_context.index_count);
+}
+
 //
 TEST_GROUP(LINK_KEY_DB){
 	const hal_flash_bank_t * hal_flash_bank_impl;
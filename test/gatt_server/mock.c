@@ -119,6 +119,16 @@ void hci_add_event_handler(btstack_packet_callback_registration_t * callback_han
 	registered_hci_event_handler = callback_handler->callback;
 }
 
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    UNUSED(event_codes);
+    UNUSED(num_event_codes);
+    UNUSED(le_subevent_codes);
+    UNUSED(num_le_subevent_codes);
+    hci_add_event_handler(callback_handler);
+}
+
 int l2cap_reserve_packet_buffer(void){
 	return 1;
 }
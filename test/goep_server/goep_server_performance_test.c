@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// GOEP Server loopback performance test
+//
+// A simulated OBEX client pushes (PUT) and pulls (GET) a 1 MB object from the
+// GOEP Server with different OBEX packet sizes, with and without SRM, over
+// L2CAP ERTM and RFCOMM.
+//
+// - host: bytes per second of wall clock time with an ideal link, i.e. the
+//   processing cost of GOEP Server and the simulated client
+// - link: throughput on a simulated 2100 kbit/s link with fixed one-way latency.
+//   Each OBEX packet is sent as L2CAP frames of at most MPS bytes plus ACL and
+//   L2CAP headers. Over L2CAP ERTM, the data in flight is limited by the
+//   receiver's ERTM window and each frame is acknowledged after the latency.
+//   Without SRM, the client waits for each response before sending the next request.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/goep_server.h"
+#include "classic/obex.h"
+#include "classic/obex_iterator.h"
+#include "classic/obex_message_builder.h"
+#include "classic/opp_server.h"
+#include "classic/ftp_server.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define OBJECT_SIZE         (1024 * 1024)
+#define NUM_ITERATIONS      100
+#define LINK_KBPS           2100
+#define MAX_FRAMES_IN_FLIGHT 64
+#define OPP_L2CAP_PSM       0x1001
+#define OPP_RFCOMM_CHANNEL  1
+#define FTP_L2CAP_PSM       0x1003
+#define FTP_RFCOMM_CHANNEL  2
+
+static const uint8_t folder_browsing_uuid[] = { 0xF9, 0xEC, 0x7B, 0xC4, 0x95, 0x3C, 0x11, 0xD2, 0x98, 0x4E, 0x52, 0x54, 0x00, 0xDC, 0x9E, 0x09 };
+
+// one direction of the simulated link
+typedef struct {
+    uint64_t free_us;
+    uint32_t window_bytes;
+    uint32_t in_flight_bytes;
+    uint64_t ack_us[MAX_FRAMES_IN_FLIGHT];
+    uint16_t ack_len[MAX_FRAMES_IN_FLIGHT];
+    uint32_t ack_head;
+    uint32_t ack_tail;
+} link_direction_t;
+
+static uint8_t  object[OBJECT_SIZE];
+static uint8_t  request[8192];
+static uint8_t  response[8192];
+static uint16_t response_len;
+
+static bool     link_simulated;
+static uint32_t latency_us;
+static uint16_t frame_size;
+static uint16_t frame_overhead;
+static link_direction_t uplink;
+static link_direction_t downlink;
+static uint64_t server_now_us;
+static uint64_t response_arrival_us;
+static uint16_t num_responses;
+static bool     count_get_body;
+
+static uint16_t goep_cid;
+static uint32_t bytes_received;
+static bool     transfer_completed;
+
+static void link_init(link_direction_t * direction, uint32_t window_bytes){
+    memset(direction, 0, sizeof(link_direction_t));
+    direction->window_bytes = window_bytes;
+}
+
+// send packet at given time, returns arrival time of the last frame
+static uint64_t link_send(link_direction_t * direction, uint64_t now_us, uint16_t len){
+    uint64_t arrival_us = now_us;
+    uint16_t offset = 0;
+    while (offset < len){
+        uint16_t payload_len = btstack_min(frame_size, len - offset);
+        uint16_t frame_len = payload_len + frame_overhead;
+        // wait for acknowledgements if window is full
+        while ((direction->ack_head != direction->ack_tail) &&
+               (((direction->in_flight_bytes + payload_len) > direction->window_bytes) || ((direction->ack_tail - direction->ack_head) == MAX_FRAMES_IN_FLIGHT))){
+            uint32_t index = direction->ack_head % MAX_FRAMES_IN_FLIGHT;
+            now_us = btstack_max(now_us, direction->ack_us[index]);
+            direction->in_flight_bytes -= direction->ack_len[index];
+            direction->ack_head++;
+        }
+        uint64_t start_us = btstack_max(now_us, direction->free_us);
+        direction->free_us = start_us + ((uint64_t) frame_len * 8 * 1000 / LINK_KBPS);
+        arrival_us = direction->free_us + latency_us;
+        if (direction->window_bytes > 0){
+            uint32_t index = direction->ack_tail % MAX_FRAMES_IN_FLIGHT;
+            direction->ack_us[index] = arrival_us + latency_us;
+            direction->ack_len[index] = payload_len;
+            direction->in_flight_bytes += payload_len;
+            direction->ack_tail++;
+        }
+        offset += payload_len;
+    }
+    return arrival_us;
+}
+
+static void send_handler(uint16_t cid, const uint8_t * packet, uint16_t size){
+    (void) cid;
+    num_responses++;
+    response_len = btstack_min(size, sizeof(response));
+    memcpy(response, packet, response_len);
+    if (count_get_body){
+        obex_iterator_t it;
+        for (obex_iterator_init_with_response_packet(&it, OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK, packet, size); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+            uint8_t hi = obex_iterator_get_hi(&it);
+            if ((hi == OBEX_HEADER_BODY) || (hi == OBEX_HEADER_END_OF_BODY)){
+                bytes_received += obex_iterator_get_data_len(&it);
+            }
+        }
+    }
+    if (link_simulated){
+        response_arrival_us = link_send(&downlink, server_now_us, size);
+    }
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) channel;
+    if (packet_type == GOEP_DATA_PACKET){
+        bytes_received += size;
+        return;
+    }
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_GOEP_META) return;
+    switch (hci_event_goep_meta_get_subevent_code(packet)){
+        case GOEP_SUBEVENT_CONNECTION_OPENED:
+            goep_cid = goep_subevent_connection_opened_get_goep_cid(packet);
+            break;
+        case GOEP_SUBEVENT_PUT_COMPLETED:
+        case GOEP_SUBEVENT_GET_COMPLETED:
+            transfer_completed = true;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint16_t get_callback(uint16_t cid, uint32_t offset, uint8_t * buffer, uint16_t buffer_size){
+    (void) cid;
+    uint16_t len = (uint16_t) btstack_min(buffer_size, OBJECT_SIZE - offset);
+    memcpy(buffer, &object[offset], len);
+    return len;
+}
+
+static void get_request_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    if ((packet_type == HCI_EVENT_PACKET) && (hci_event_packet_get_type(packet) == HCI_EVENT_GOEP_META) &&
+        (hci_event_goep_meta_get_subevent_code(packet) == GOEP_SUBEVENT_GET_REQUEST)){
+        goep_server_accept_get(channel, OBJECT_SIZE, &get_callback);
+        return;
+    }
+    packet_handler(packet_type, channel, packet, size);
+}
+
+// client sends request at given time, returns time when client can send next request
+static uint64_t client_send(uint16_t cid, uint64_t now_us, bool wait_for_response){
+    uint16_t len = big_endian_read_16(request, 1);
+    if (link_simulated){
+        server_now_us = link_send(&uplink, now_us, len);
+    }
+    num_responses = 0;
+    response_arrival_us = now_us;
+    mock_receive(cid, request, len);
+    mock_run();
+    if (wait_for_response){
+        return btstack_max(response_arrival_us, now_us);
+    }
+    // client is limited by uplink
+    return now_us;
+}
+
+static uint16_t client_connect(bool l2cap, bool ftp, uint16_t mtu){
+    uint16_t cid;
+    if (l2cap){
+        cid = mock_l2cap_connect(ftp ? FTP_L2CAP_PSM : OPP_L2CAP_PSM, mtu);
+    } else {
+        cid = mock_rfcomm_connect(ftp ? FTP_RFCOMM_CHANNEL : OPP_RFCOMM_CHANNEL, mtu);
+    }
+    obex_message_builder_request_create_connect(request, sizeof(request), OBEX_VERSION, 0, mtu);
+    if (ftp){
+        obex_message_builder_header_add_target(request, sizeof(request), folder_browsing_uuid, sizeof(folder_browsing_uuid));
+    }
+    client_send(cid, 0, true);
+    return cid;
+}
+
+static void setup(bool l2cap, uint16_t mtu){
+    mock_init();
+    mock_set_send_handler(&send_handler);
+    goep_server_init();
+    opp_server_init(&packet_handler, OPP_RFCOMM_CHANNEL, OPP_L2CAP_PSM, LEVEL_0);
+    ftp_server_init(&get_request_handler, FTP_RFCOMM_CHANNEL, FTP_L2CAP_PSM, LEVEL_0);
+    bytes_received = 0;
+    transfer_completed = false;
+    if (l2cap){
+        frame_size = HCI_ACL_PAYLOAD_SIZE - 10;
+        // ACL header, L2CAP header, ERTM control, FCS
+        frame_overhead = 4 + 4 + 2 + 2;
+    } else {
+        frame_size = mtu;
+        // ACL header, L2CAP header, RFCOMM header with 2 byte length, credits and FCS
+        frame_overhead = 4 + 4 + 6;
+    }
+}
+
+// returns simulated duration in us
+static uint64_t push(bool l2cap, uint16_t mtu, bool srm){
+    setup(l2cap, mtu);
+    uint16_t cid = client_connect(l2cap, false, mtu);
+    uint16_t max_packet_len = goep_server_get_max_packet_len(goep_cid);
+    if (l2cap){
+        uint32_t window = mock_channel_for_cid(cid)->ertm_config.num_rx_buffers * frame_size;
+        link_init(&uplink, window);
+        link_init(&downlink, window);
+    } else {
+        link_init(&uplink, 0);
+        link_init(&downlink, 0);
+    }
+
+    uint64_t now_us = 0;
+    uint32_t offset = 0;
+    bool first = true;
+    bool srm_active = false;
+    while (offset < OBJECT_SIZE){
+        obex_message_builder_request_create_put(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+        request[0] = OBEX_OPCODE_PUT;
+        if (first){
+            obex_message_builder_header_add_name(request, sizeof(request), "object.bin");
+            obex_message_builder_header_add_word(request, sizeof(request), OBEX_HEADER_LENGTH, OBJECT_SIZE);
+            if (srm){
+                obex_message_builder_header_add_srm_enable(request, sizeof(request));
+            }
+        }
+        uint16_t body_len = (uint16_t) btstack_min(max_packet_len - big_endian_read_16(request, 1) - 3, OBJECT_SIZE - offset);
+        bool final = (offset + body_len) == OBJECT_SIZE;
+        if (final){
+            request[0] |= OBEX_OPCODE_FINAL_BIT_MASK;
+        }
+        obex_message_builder_header_add_variable(request, sizeof(request), final ? OBEX_HEADER_END_OF_BODY : OBEX_HEADER_BODY, &object[offset], body_len);
+        offset += body_len;
+        // with SRM, the client only waits for the first and the final response
+        bool wait_for_response = (srm_active == false) || final;
+        now_us = client_send(cid, now_us, wait_for_response);
+        if (first && srm && (num_responses == 1)){
+            srm_active = true;
+        }
+        first = false;
+    }
+    if ((transfer_completed == false) || (bytes_received != OBJECT_SIZE)){
+        printf("PUT failed, received %u\n", (unsigned int) bytes_received);
+    }
+    goep_server_deinit();
+    return now_us;
+}
+
+static uint64_t pull(bool l2cap, uint16_t mtu, bool srm){
+    setup(l2cap, mtu);
+    uint16_t cid = client_connect(l2cap, true, mtu);
+    if (l2cap){
+        uint32_t window = mock_channel_for_cid(cid)->ertm_config.num_rx_buffers * frame_size;
+        link_init(&uplink, window);
+        link_init(&downlink, window);
+    } else {
+        link_init(&uplink, 0);
+        link_init(&downlink, 0);
+    }
+
+    uint64_t now_us = 0;
+    bool first = true;
+    count_get_body = true;
+    while (transfer_completed == false){
+        obex_message_builder_request_create_get(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+        if (first){
+            obex_message_builder_header_add_name(request, sizeof(request), "object.bin");
+            if (srm){
+                obex_message_builder_header_add_srm_enable(request, sizeof(request));
+            }
+        }
+        first = false;
+        // with SRM, all responses are sent for the first request
+        now_us = client_send(cid, now_us, true);
+        if (num_responses == 0) break;
+    }
+    count_get_body = false;
+    if ((transfer_completed == false) || (bytes_received != OBJECT_SIZE)){
+        printf("GET failed, received %u\n", (unsigned int) bytes_received);
+    }
+    goep_server_deinit();
+    return now_us;
+}
+
+typedef uint64_t (*transfer_t)(bool l2cap, uint16_t mtu, bool srm);
+
+static void measure(const char * name, transfer_t transfer, bool l2cap, uint16_t mtu, bool srm){
+    // host processing
+    link_simulated = false;
+    uint32_t start_us = perf_timer_get_time_us();
+    int i;
+    for (i=0;i<NUM_ITERATIONS;i++){
+        (*transfer)(l2cap, mtu, srm);
+    }
+    uint32_t duration_us = (perf_timer_get_time_us() - start_us) / NUM_ITERATIONS;
+    printf("  %s %-6s MTU %4u, SRM %-3s: host %6.0f MB/s", name, l2cap ? "L2CAP" : "RFCOMM", mtu, srm ? "on" : "off",
+           (double) OBJECT_SIZE / (double) btstack_max(1, duration_us));
+
+    // simulated link
+    static const uint32_t latencies_ms[] = { 5, 20 };
+    unsigned int j;
+    link_simulated = true;
+    for (j=0;j<sizeof(latencies_ms)/sizeof(uint32_t);j++){
+        latency_us = latencies_ms[j] * 1000;
+        uint64_t link_us = (*transfer)(l2cap, mtu, srm);
+        printf(", link %2u ms: %4u kbit/s", (unsigned int) latencies_ms[j], (unsigned int) ((uint64_t) OBJECT_SIZE * 8 * 1000 / link_us));
+    }
+    printf("\n");
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    uint32_t i;
+    for (i=0;i<OBJECT_SIZE;i++){
+        object[i] = (uint8_t) (i * 13);
+    }
+    printf("Transfer %u byte object, link %u kbit/s\n", OBJECT_SIZE, LINK_KBPS);
+    static const uint16_t mtus[] = { 512, 1024, 2048, 4096, 8192 };
+    unsigned int j;
+    for (j=0;j<sizeof(mtus)/sizeof(uint16_t);j++){
+        measure("PUT", &push, true, mtus[j], false);
+        measure("PUT", &push, true, mtus[j], true);
+    }
+    measure("PUT", &push, false, 127, false);
+    measure("PUT", &push, false, 1000, false);
+    for (j=0;j<sizeof(mtus)/sizeof(uint16_t);j++){
+        measure("GET", &pull, true, mtus[j], false);
+        measure("GET", &pull, true, mtus[j], true);
+    }
+    measure("GET", &pull, false, 127, false);
+    measure("GET", &pull, false, 1000, false);
+    return 0;
+}
@@ -0,0 +1,940 @@
+// *****************************************************************************
+//
+// GOEP Server Test
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/ftp_server.h"
+#include "classic/goep_server.h"
+#include "classic/obex.h"
+#include "classic/obex_iterator.h"
+#include "classic/obex_message_builder.h"
+#include "classic/opp_server.h"
+#include "classic/sdp_util.h"
+
+#include "mock.h"
+
+#define OPP_RFCOMM_CHANNEL  1
+#define OPP_L2CAP_PSM       0x1001
+#define FTP_RFCOMM_CHANNEL  2
+#define FTP_L2CAP_PSM       0x1003
+
+static const uint8_t folder_browsing_uuid[] = { 0xF9, 0xEC, 0x7B, 0xC4, 0x95, 0x3C, 0x11, 0xD2, 0x98, 0x4E, 0x52, 0x54, 0x00, 0xDC, 0x9E, 0x09 };
+
+// events
+static uint16_t goep_cid;
+static int      num_connection_opened;
+static int      num_connection_closed;
+static char     request_name[GOEP_SERVER_MAX_NAME_LEN + 1];
+static char     request_type[GOEP_SERVER_MAX_TYPE_LEN + 1];
+static uint32_t request_length;
+static uint8_t  request_flags;
+static int      num_put_requests;
+static int      num_get_requests;
+static int      num_delete_requests;
+static int      num_set_path_requests;
+static int      num_put_completed;
+static int      num_get_completed;
+static uint8_t  completed_status;
+static uint8_t  data_received[20000];
+static uint32_t data_received_len;
+
+// application behavior
+static uint8_t  reject_code;
+static uint8_t  reject_code_after_bytes;
+static uint32_t reject_after_bytes;
+static uint8_t  get_object[20000];
+static uint32_t get_object_len;
+static bool     get_accept;
+
+// OBEX client
+static uint8_t  request[8192];
+static uint8_t  response[8192];
+static uint16_t response_len;
+
+static void copy_string(char * buffer, uint16_t buffer_size, const uint8_t * data, uint8_t len){
+    uint16_t copy_len = btstack_min(len, buffer_size - 1);
+    memcpy(buffer, data, copy_len);
+    buffer[copy_len] = 0;
+}
+
+static uint16_t get_callback(uint16_t cid, uint32_t offset, uint8_t * buffer, uint16_t buffer_size){
+    (void) cid;
+    uint16_t len = (uint16_t) btstack_min(buffer_size, get_object_len - offset);
+    memcpy(buffer, &get_object[offset], len);
+    return len;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    if (packet_type == GOEP_DATA_PACKET){
+        if ((data_received_len + size) <= sizeof(data_received)){
+            memcpy(&data_received[data_received_len], packet, size);
+        }
+        data_received_len += size;
+        if ((reject_code_after_bytes != 0) && (data_received_len >= reject_after_bytes)){
+            CHECK_EQUAL(ERROR_CODE_SUCCESS, goep_server_reject_request(channel, reject_code_after_bytes));
+            reject_code_after_bytes = 0;
+        }
+        return;
+    }
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_GOEP_META) return;
+    switch (hci_event_goep_meta_get_subevent_code(packet)){
+        case GOEP_SUBEVENT_CONNECTION_OPENED:
+            goep_cid = goep_subevent_connection_opened_get_goep_cid(packet);
+            CHECK_EQUAL(1, goep_subevent_connection_opened_get_incoming(packet));
+            num_connection_opened++;
+            break;
+        case GOEP_SUBEVENT_CONNECTION_CLOSED:
+            num_connection_closed++;
+            break;
+        case GOEP_SUBEVENT_PUT_REQUEST:
+            num_put_requests++;
+            request_length = goep_subevent_put_request_get_length(packet);
+            copy_string(request_name, sizeof(request_name), goep_subevent_put_request_get_name(packet), goep_subevent_put_request_get_name_len(packet));
+            copy_string(request_type, sizeof(request_type), goep_subevent_put_request_get_type(packet), goep_subevent_put_request_get_type_len(packet));
+            if (reject_code != 0){
+                goep_server_reject_request(channel, reject_code);
+            }
+            break;
+        case GOEP_SUBEVENT_GET_REQUEST:
+            num_get_requests++;
+            copy_string(request_name, sizeof(request_name), goep_subevent_get_request_get_name(packet), goep_subevent_get_request_get_name_len(packet));
+            copy_string(request_type, sizeof(request_type), goep_subevent_get_request_get_type(packet), goep_subevent_get_request_get_type_len(packet));
+            if (get_accept){
+                goep_server_accept_get(channel, get_object_len, &get_callback);
+            }
+            break;
+        case GOEP_SUBEVENT_DELETE_REQUEST:
+            num_delete_requests++;
+            copy_string(request_name, sizeof(request_name), goep_subevent_delete_request_get_name(packet), goep_subevent_delete_request_get_name_len(packet));
+            if (reject_code != 0){
+                goep_server_reject_request(channel, reject_code);
+            }
+            break;
+        case GOEP_SUBEVENT_SET_PATH_REQUEST:
+            num_set_path_requests++;
+            request_flags = goep_subevent_set_path_request_get_flags(packet);
+            copy_string(request_name, sizeof(request_name), goep_subevent_set_path_request_get_name(packet), goep_subevent_set_path_request_get_name_len(packet));
+            if (reject_code != 0){
+                goep_server_reject_request(channel, reject_code);
+            }
+            break;
+        case GOEP_SUBEVENT_PUT_COMPLETED:
+            num_put_completed++;
+            completed_status = goep_subevent_put_completed_get_status(packet);
+            break;
+        case GOEP_SUBEVENT_GET_COMPLETED:
+            num_get_completed++;
+            completed_status = goep_subevent_get_completed_get_status(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+// deliver data in RFCOMM frames of given size
+static void receive_frames(uint16_t cid, const uint8_t * data, uint16_t size, uint16_t frame_size){
+    uint16_t pos = 0;
+    while (pos < size){
+        uint16_t len = btstack_min(frame_size, size - pos);
+        mock_receive(cid, &data[pos], len);
+        pos += len;
+    }
+}
+
+// send request and return opcode of response, 0 if none
+static uint8_t send_request(uint16_t cid){
+    mock_receive(cid, request, big_endian_read_16(request, 1));
+    mock_run();
+    response_len = mock_get_response(cid, response, sizeof(response));
+    if (response_len == 0) return 0;
+    return response[0];
+}
+
+static uint8_t send_connect(uint16_t cid, const uint8_t * target, uint16_t target_len, uint16_t max_packet_len){
+    obex_message_builder_request_create_connect(request, sizeof(request), OBEX_VERSION, 0, max_packet_len);
+    if (target != NULL){
+        obex_message_builder_header_add_target(request, sizeof(request), target, target_len);
+    }
+    return send_request(cid);
+}
+
+static void create_put(bool final, const char * name, const char * type, uint32_t length, bool srm){
+    obex_message_builder_request_create_put(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    if (final == false){
+        request[0] = OBEX_OPCODE_PUT;
+    }
+    if (name != NULL){
+        obex_message_builder_header_add_name(request, sizeof(request), name);
+    }
+    if (type != NULL){
+        obex_message_builder_header_add_type(request, sizeof(request), type);
+    }
+    if (length != 0){
+        obex_message_builder_header_add_word(request, sizeof(request), OBEX_HEADER_LENGTH, length);
+    }
+    if (srm){
+        obex_message_builder_header_add_srm_enable(request, sizeof(request));
+    }
+}
+
+static void add_body(const uint8_t * data, uint16_t len, bool end_of_body){
+    obex_message_builder_header_add_variable(request, sizeof(request), end_of_body ? OBEX_HEADER_END_OF_BODY : OBEX_HEADER_BODY, data, len);
+}
+
+static void create_get(bool final, const char * name, const char * type, bool srm, bool srm_wait){
+    obex_message_builder_request_create_get(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    if (final == false){
+        request[0] = OBEX_OPCODE_GET;
+    }
+    if (name != NULL){
+        obex_message_builder_header_add_name(request, sizeof(request), name);
+    }
+    if (type != NULL){
+        obex_message_builder_header_add_type(request, sizeof(request), type);
+    }
+    if (srm){
+        obex_message_builder_header_add_srm_enable(request, sizeof(request));
+    }
+    if (srm_wait){
+        obex_message_builder_header_add_byte(request, sizeof(request), OBEX_HEADER_SINGLE_RESPONSE_MODE_PARAMETER, OBEX_SRMP_WAIT);
+    }
+}
+
+static bool response_has_header(uint8_t request_opcode, uint8_t header_id, uint8_t value){
+    obex_iterator_t it;
+    for (obex_iterator_init_with_response_packet(&it, request_opcode, response, response_len); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+        if (obex_iterator_get_hi(&it) != header_id) continue;
+        if (((header_id >> 6) == 2) && (obex_iterator_get_data_8(&it) != value)) continue;
+        return true;
+    }
+    return false;
+}
+
+// append body of GET response to data buffer, returns true for End of Body
+static bool store_get_body(uint8_t * data, uint32_t * data_len){
+    obex_iterator_t it;
+    bool end_of_body = false;
+    for (obex_iterator_init_with_response_packet(&it, OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK, response, response_len); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+        uint8_t hi = obex_iterator_get_hi(&it);
+        if ((hi != OBEX_HEADER_BODY) && (hi != OBEX_HEADER_END_OF_BODY)) continue;
+        uint32_t len = obex_iterator_get_data_len(&it);
+        memcpy(&data[*data_len], obex_iterator_get_data(&it), len);
+        *data_len += len;
+        end_of_body = hi == OBEX_HEADER_END_OF_BODY;
+    }
+    return end_of_body;
+}
+
+// returns cid of connected OBEX session, 0 on failure
+static uint16_t connect_opp_l2cap(void){
+    uint16_t cid = mock_l2cap_connect(OPP_L2CAP_PSM, 4096);
+    if (send_connect(cid, NULL, 0, 4096) != OBEX_RESP_SUCCESS) return 0;
+    return cid;
+}
+
+static uint16_t connect_ftp_l2cap(void){
+    uint16_t cid = mock_l2cap_connect(FTP_L2CAP_PSM, 4096);
+    if (send_connect(cid, folder_browsing_uuid, sizeof(folder_browsing_uuid), 4096) != OBEX_RESP_SUCCESS) return 0;
+    return cid;
+}
+
+TEST_GROUP(GOEPServer){
+    void setup(void){
+        mock_init();
+        goep_server_init();
+        goep_cid = 0;
+        num_connection_opened = 0;
+        num_connection_closed = 0;
+        request_name[0] = 0;
+        request_type[0] = 0;
+        request_length = 0;
+        request_flags = 0;
+        num_put_requests = 0;
+        num_get_requests = 0;
+        num_delete_requests = 0;
+        num_set_path_requests = 0;
+        num_put_completed = 0;
+        num_get_completed = 0;
+        completed_status = 0xff;
+        data_received_len = 0;
+        reject_code = 0;
+        reject_code_after_bytes = 0;
+        reject_after_bytes = 0;
+        get_accept = false;
+        get_object_len = 0;
+        uint32_t i;
+        for (i = 0; i < sizeof(get_object); i++){
+            get_object[i] = (uint8_t) (i * 7);
+        }
+        opp_server_init(&packet_handler, OPP_RFCOMM_CHANNEL, OPP_L2CAP_PSM, LEVEL_2);
+        ftp_server_init(&packet_handler, FTP_RFCOMM_CHANNEL, FTP_L2CAP_PSM, LEVEL_2);
+    }
+    void teardown(void){
+        goep_server_deinit();
+    }
+};
+
+TEST(GOEPServer, RegisterService){
+    CHECK_TRUE(mock_rfcomm_service_registered(OPP_RFCOMM_CHANNEL));
+    CHECK_TRUE(mock_l2cap_service_registered(OPP_L2CAP_PSM));
+    CHECK_TRUE(mock_rfcomm_service_registered(FTP_RFCOMM_CHANNEL));
+    CHECK_TRUE(mock_l2cap_service_registered(FTP_L2CAP_PSM));
+    CHECK_EQUAL(RFCOMM_CHANNEL_ALREADY_REGISTERED, opp_server_init(&packet_handler, OPP_RFCOMM_CHANNEL, 0, LEVEL_2));
+    CHECK_EQUAL(L2CAP_SERVICE_ALREADY_REGISTERED, opp_server_init(&packet_handler, 3, OPP_L2CAP_PSM, LEVEL_2));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, goep_server_register_service(&packet_handler, 0, 0, LEVEL_2, NULL, 0, 0));
+    // both service slots in use
+    CHECK_EQUAL(BTSTACK_MEMORY_ALLOC_FAILED, goep_server_register_service(&packet_handler, 5, 0, LEVEL_2, NULL, 0, 0));
+}
+
+TEST(GOEPServer, UnknownService){
+    CHECK_EQUAL(0, mock_rfcomm_connect(9, 1000));
+    CHECK_EQUAL(0, num_connection_opened);
+}
+
+TEST(GOEPServer, ConnectionLimit){
+    CHECK_TRUE(mock_l2cap_connect(OPP_L2CAP_PSM, 4096) != 0);
+    CHECK_TRUE(mock_rfcomm_connect(FTP_RFCOMM_CHANNEL, 1000) != 0);
+    uint16_t cid = mock_l2cap_connect(OPP_L2CAP_PSM, 4096);
+    CHECK_EQUAL(0, cid);
+    CHECK_EQUAL(2, num_connection_opened);
+}
+
+TEST(GOEPServer, ErtmConfig){
+    uint16_t cid = mock_l2cap_connect(OPP_L2CAP_PSM, 4096);
+    mock_channel_t * channel = mock_channel_for_cid(cid);
+    CHECK_TRUE(channel->accepted);
+    CHECK_EQUAL(GOEP_SERVER_ERTM_MTU, channel->ertm_config.local_mtu);
+    CHECK_EQUAL(1, channel->ertm_config.ertm_mandatory);
+    // rx and tx window cover two OBEX packets of max size with MPS = HCI_ACL_PAYLOAD_SIZE - 10
+    uint16_t mps = HCI_ACL_PAYLOAD_SIZE - 10;
+    uint16_t window = ((2 * GOEP_SERVER_ERTM_MTU) + mps - 1) / mps;
+    CHECK_EQUAL(window, channel->ertm_config.num_rx_buffers);
+    CHECK_EQUAL(window, channel->ertm_config.num_tx_buffers);
+    uint32_t required = 16 + (window * (sizeof(l2cap_ertm_rx_packet_state_t) + sizeof(l2cap_ertm_tx_packet_state_t))) +
+                        GOEP_SERVER_ERTM_MTU + (2 * window * mps);
+    CHECK_EQUAL(required, channel->ertm_buffer_size);
+}
+
+TEST(GOEPServer, ConnectWithoutTarget){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(1, num_connection_opened);
+    CHECK_EQUAL(0, goep_server_get_max_packet_len(goep_cid));
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 0xffff));
+    // version, flags, max packet len, no connection id
+    CHECK_EQUAL(7, response_len);
+    CHECK_EQUAL(OBEX_VERSION, response[3]);
+    // RFCOMM: size of reassembly buffer, default GOEP_SERVER_RFCOMM_MAX_PACKET_LEN
+    CHECK_EQUAL(1024, big_endian_read_16(response, 5));
+    CHECK_EQUAL(1000, goep_server_get_max_packet_len(goep_cid));
+}
+
+TEST(GOEPServer, ConnectSmallerMaxPacketLen){
+    uint16_t cid = mock_l2cap_connect(OPP_L2CAP_PSM, 4096);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 255));
+    CHECK_EQUAL(4096, big_endian_read_16(response, 5));
+    CHECK_EQUAL(255, goep_server_get_max_packet_len(goep_cid));
+}
+
+TEST(GOEPServer, ConnectTargetMissing){
+    uint16_t cid = mock_l2cap_connect(FTP_L2CAP_PSM, 4096);
+    CHECK_EQUAL(OBEX_RESP_SERVICE_UNAVAILABLE, send_connect(cid, NULL, 0, 4096));
+    CHECK_EQUAL(0, goep_server_get_max_packet_len(goep_cid));
+    // requests are rejected
+    create_put(true, "a.txt", NULL, 0, false);
+    add_body((const uint8_t *) "a", 1, true);
+    CHECK_EQUAL(OBEX_RESP_BAD_REQUEST, send_request(cid));
+    CHECK_EQUAL(0, num_put_requests);
+}
+
+TEST(GOEPServer, ConnectWithTarget){
+    uint16_t cid = mock_l2cap_connect(FTP_L2CAP_PSM, 4096);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, folder_browsing_uuid, sizeof(folder_browsing_uuid), 4096));
+    CHECK_TRUE(response_has_header(OBEX_OPCODE_CONNECT, OBEX_HEADER_CONNECTION_ID, 0));
+    obex_iterator_t it;
+    bool who_found = false;
+    for (obex_iterator_init_with_response_packet(&it, OBEX_OPCODE_CONNECT, response, response_len); obex_iterator_has_more(&it) ; obex_iterator_next(&it)){
+        if (obex_iterator_get_hi(&it) != OBEX_HEADER_WHO) continue;
+        CHECK_EQUAL(sizeof(folder_browsing_uuid), obex_iterator_get_data_len(&it));
+        MEMCMP_EQUAL(folder_browsing_uuid, obex_iterator_get_data(&it), sizeof(folder_browsing_uuid));
+        who_found = true;
+    }
+    CHECK_TRUE(who_found);
+}
+
+TEST(GOEPServer, ConnectWrongTarget){
+    uint8_t target[16];
+    memcpy(target, folder_browsing_uuid, sizeof(target));
+    target[15] ^= 1;
+    uint16_t cid = mock_l2cap_connect(FTP_L2CAP_PSM, 4096);
+    CHECK_EQUAL(OBEX_RESP_SERVICE_UNAVAILABLE, send_connect(cid, target, sizeof(target), 4096));
+}
+
+TEST(GOEPServer, Disconnect){
+    uint16_t cid = connect_opp_l2cap();
+    obex_message_builder_request_create_disconnect(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(0, goep_server_get_max_packet_len(goep_cid));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, goep_server_disconnect(goep_cid));
+    CHECK_EQUAL(1, mock_num_local_disconnects());
+    CHECK_EQUAL(1, num_connection_closed);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, goep_server_disconnect(goep_cid));
+}
+
+TEST(GOEPServer, PutWithoutSrm){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    uint8_t data[2500];
+    uint16_t i;
+    for (i = 0; i < sizeof(data); i++){
+        data[i] = (uint8_t) i;
+    }
+    create_put(false, "test.txt", "text/plain", sizeof(data), false);
+    add_body(&data[0], 800, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    CHECK_EQUAL(1, num_put_requests);
+    STRCMP_EQUAL("test.txt", request_name);
+    STRCMP_EQUAL("text/plain", request_type);
+    CHECK_EQUAL(sizeof(data), request_length);
+    CHECK_FALSE(goep_server_srm_active(goep_cid));
+
+    create_put(false, NULL, NULL, 0, false);
+    add_body(&data[800], 900, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    create_put(true, NULL, NULL, 0, false);
+    add_body(&data[1700], 800, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+
+    CHECK_EQUAL(1, num_put_requests);
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, completed_status);
+    CHECK_EQUAL(sizeof(data), data_received_len);
+    MEMCMP_EQUAL(data, data_received, sizeof(data));
+}
+
+TEST(GOEPServer, PutRfcommSplitPackets){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    uint8_t data[1600];
+    uint16_t i;
+    for (i = 0; i < sizeof(data); i++){
+        data[i] = (uint8_t) (i * 5);
+    }
+    // OBEX header split after first byte
+    create_put(false, "test.txt", "text/plain", sizeof(data), false);
+    add_body(&data[0], 800, false);
+    uint16_t request_len = big_endian_read_16(request, 1);
+    mock_receive(cid, request, 1);
+    mock_receive(cid, &request[1], 20);
+    mock_run();
+    CHECK_EQUAL(0, mock_num_responses());
+    CHECK_EQUAL(0, num_put_requests);
+    mock_receive(cid, &request[21], request_len - 21);
+    mock_run();
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, mock_get_response(cid, response, sizeof(response)) ? response[0] : 0);
+    CHECK_EQUAL(1, num_put_requests);
+
+    create_put(true, NULL, NULL, 0, false);
+    add_body(&data[800], 800, true);
+    receive_frames(cid, request, big_endian_read_16(request, 1), 127);
+    mock_run();
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, mock_get_response(cid, response, sizeof(response)) ? response[0] : 0);
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(sizeof(data), data_received_len);
+    MEMCMP_EQUAL(data, data_received, sizeof(data));
+}
+
+TEST(GOEPServer, PutRfcommCoalescedPackets){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    uint8_t data[2000];
+    uint16_t i;
+    for (i = 0; i < sizeof(data); i++){
+        data[i] = (uint8_t) (i * 3);
+    }
+    create_put(false, "photo.jpg", "image/jpeg", sizeof(data), true);
+    add_body(&data[0], 500, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    CHECK_TRUE(goep_server_srm_active(goep_cid));
+
+    // with SRM, remaining packets are streamed and arrive in frames that don't match packet boundaries
+    uint8_t stream[2000];
+    uint16_t stream_len = 0;
+    for (i = 1; i < 4; i++){
+        create_put(i == 3, NULL, NULL, 0, false);
+        add_body(&data[i * 500], 500, i == 3);
+        uint16_t request_len = big_endian_read_16(request, 1);
+        memcpy(&stream[stream_len], request, request_len);
+        stream_len += request_len;
+    }
+    receive_frames(cid, stream, stream_len, 700);
+    mock_run();
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, mock_get_response(cid, response, sizeof(response)) ? response[0] : 0);
+    CHECK_EQUAL(0, mock_num_responses());
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, completed_status);
+    CHECK_EQUAL(sizeof(data), data_received_len);
+    MEMCMP_EQUAL(data, data_received, sizeof(data));
+}
+
+TEST(GOEPServer, PutRfcommPacketTooLarge){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    uint8_t data[1500];
+    memset(data, 0x55, sizeof(data));
+    // larger than advertised max packet length, dropped
+    create_put(true, "big.bin", NULL, 0, false);
+    add_body(data, sizeof(data), true);
+    receive_frames(cid, request, big_endian_read_16(request, 1), 1000);
+    mock_run();
+    CHECK_EQUAL(OBEX_RESP_BAD_REQUEST, mock_get_response(cid, response, sizeof(response)) ? response[0] : 0);
+    CHECK_EQUAL(0, num_put_requests);
+    // next packet is handled
+    create_put(true, "a.vcf", "text/x-vcard", 3, false);
+    add_body((const uint8_t *) "abc", 3, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_put_completed);
+}
+
+TEST(GOEPServer, PutWithSrm){
+    uint16_t cid = connect_opp_l2cap();
+    uint8_t data[4000];
+    uint16_t i;
+    for (i = 0; i < sizeof(data); i++){
+        data[i] = (uint8_t) (i * 3);
+    }
+    create_put(false, "photo.jpg", "image/jpeg", sizeof(data), true);
+    add_body(&data[0], 1000, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    CHECK_TRUE(response_has_header(OBEX_OPCODE_PUT, OBEX_HEADER_SINGLE_RESPONSE_MODE, OBEX_SRM_ENABLE));
+    CHECK_TRUE(goep_server_srm_active(goep_cid));
+
+    // no responses for intermediate packets
+    for (i = 1; i < 3; i++){
+        create_put(false, NULL, NULL, 0, false);
+        add_body(&data[i * 1000], 1000, false);
+        CHECK_EQUAL(0, send_request(cid));
+    }
+    create_put(true, NULL, NULL, 0, false);
+    add_body(&data[3000], 1000, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_FALSE(response_has_header(OBEX_OPCODE_PUT, OBEX_HEADER_SINGLE_RESPONSE_MODE, OBEX_SRM_ENABLE));
+    CHECK_FALSE(goep_server_srm_active(goep_cid));
+    CHECK_EQUAL(0, mock_num_responses());
+
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, completed_status);
+    CHECK_EQUAL(sizeof(data), data_received_len);
+    MEMCMP_EQUAL(data, data_received, sizeof(data));
+}
+
+TEST(GOEPServer, PutSingleSrmPacket){
+    // SRM is not enabled for single packet
+    uint16_t cid = connect_opp_l2cap();
+    create_put(true, "a.vcf", "text/x-vcard", 3, true);
+    add_body((const uint8_t *) "abc", 3, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_FALSE(response_has_header(OBEX_OPCODE_PUT, OBEX_HEADER_SINGLE_RESPONSE_MODE, OBEX_SRM_ENABLE));
+    CHECK_EQUAL(3, data_received_len);
+    CHECK_EQUAL(1, num_put_completed);
+}
+
+TEST(GOEPServer, PutEmptyObject){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(true, "empty.txt", NULL, 0, false);
+    add_body(NULL, 0, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_put_requests);
+    CHECK_EQUAL(0, num_delete_requests);
+    CHECK_EQUAL(0, data_received_len);
+    CHECK_EQUAL(1, num_put_completed);
+}
+
+TEST(GOEPServer, PutNameUtf8){
+    uint16_t cid = connect_opp_l2cap();
+    // "Jörg€.txt" in UTF-16BE
+    const uint8_t name[] = { 0x00, 'J', 0x00, 0xF6, 0x00, 'r', 0x00, 'g', 0x20, 0xAC, 0x00, '.', 0x00, 't', 0x00, 'x', 0x00, 't', 0x00, 0x00 };
+    obex_message_builder_request_create_put(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    obex_message_builder_header_add_variable(request, sizeof(request), OBEX_HEADER_NAME, name, sizeof(name));
+    add_body((const uint8_t *) "x", 1, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    STRCMP_EQUAL("J\xC3\xB6rg\xE2\x82\xAC.txt", request_name);
+}
+
+TEST(GOEPServer, PutRejectInEvent){
+    uint16_t cid = connect_opp_l2cap();
+    reject_code = OBEX_RESP_FORBIDDEN;
+    create_put(false, "big.bin", NULL, 100000, true);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(OBEX_RESP_FORBIDDEN, send_request(cid));
+    CHECK_EQUAL(0, data_received_len);
+    CHECK_FALSE(goep_server_srm_active(goep_cid));
+
+    // packets already streamed by client are dropped
+    reject_code = 0;
+    create_put(false, NULL, NULL, 0, false);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(0, send_request(cid));
+    create_put(true, NULL, NULL, 0, false);
+    add_body(get_object, 1000, true);
+    CHECK_EQUAL(0, send_request(cid));
+    CHECK_EQUAL(0, data_received_len);
+    CHECK_EQUAL(0, num_put_completed);
+
+    // next PUT is accepted
+    create_put(true, "small.txt", NULL, 0, false);
+    add_body((const uint8_t *) "ok", 2, true);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(2, data_received_len);
+}
+
+TEST(GOEPServer, PutRejectDuringTransfer){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    reject_code_after_bytes = OBEX_RESP_INTERNAL_SERVER_ERROR;
+    reject_after_bytes = 1000;
+    create_put(false, "big.bin", NULL, 0, false);
+    add_body(get_object, 500, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    // rejected while handling data, current request gets the error
+    create_put(false, NULL, NULL, 0, false);
+    add_body(get_object, 500, false);
+    CHECK_EQUAL(OBEX_RESP_INTERNAL_SERVER_ERROR, send_request(cid));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, goep_server_reject_request(goep_cid, OBEX_RESP_FORBIDDEN));
+    // remaining packets are dropped
+    create_put(true, NULL, NULL, 0, false);
+    add_body(get_object, 500, true);
+    CHECK_EQUAL(0, send_request(cid));
+    CHECK_EQUAL(1000, data_received_len);
+    CHECK_EQUAL(0, num_put_completed);
+}
+
+TEST(GOEPServer, PutRejectLater){
+    uint16_t cid = mock_rfcomm_connect(OPP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    create_put(false, "big.bin", NULL, 0, false);
+    add_body(get_object, 500, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    // without SRM, next request gets the error
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, goep_server_reject_request(goep_cid, OBEX_RESP_FORBIDDEN));
+    mock_run();
+    CHECK_EQUAL(0, mock_num_responses());
+    create_put(false, NULL, NULL, 0, false);
+    add_body(get_object, 500, false);
+    CHECK_EQUAL(OBEX_RESP_FORBIDDEN, send_request(cid));
+    CHECK_EQUAL(500, data_received_len);
+    CHECK_EQUAL(0, num_put_completed);
+}
+
+TEST(GOEPServer, PutRejectDuringSrmTransfer){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(false, "big.bin", NULL, 0, true);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    create_put(false, NULL, NULL, 0, false);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(0, send_request(cid));
+    // with SRM, error is sent right away
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, goep_server_reject_request(goep_cid, OBEX_RESP_INTERNAL_SERVER_ERROR));
+    mock_run();
+    response_len = mock_get_response(cid, response, sizeof(response));
+    CHECK_EQUAL(3, response_len);
+    CHECK_EQUAL(OBEX_RESP_INTERNAL_SERVER_ERROR, response[0]);
+    create_put(true, NULL, NULL, 0, false);
+    add_body(get_object, 1000, true);
+    CHECK_EQUAL(0, send_request(cid));
+    CHECK_EQUAL(2000, data_received_len);
+}
+
+TEST(GOEPServer, PutNotSupported){
+    uint16_t cid = connect_ftp_l2cap();
+    goep_server_deinit();
+    goep_server_init();
+    mock_init();
+    goep_server_register_service(&packet_handler, 1, 0, LEVEL_2, NULL, 0, GOEP_SERVER_OPERATION_GET);
+    cid = mock_rfcomm_connect(1, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, NULL, 0, 1000));
+    create_put(true, "a.txt", NULL, 0, false);
+    add_body((const uint8_t *) "a", 1, true);
+    CHECK_EQUAL(OBEX_RESP_NOT_IMPLEMENTED, send_request(cid));
+    CHECK_EQUAL(0, num_put_requests);
+}
+
+TEST(GOEPServer, Abort){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(false, "big.bin", NULL, 0, false);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    obex_message_builder_request_create_abort(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(OBEX_ABORTED, completed_status);
+}
+
+TEST(GOEPServer, DisconnectDuringPut){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(false, "big.bin", NULL, 0, true);
+    add_body(get_object, 1000, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    mock_disconnect(cid);
+    CHECK_EQUAL(1, num_put_completed);
+    CHECK_EQUAL(OBEX_DISCONNECTED, completed_status);
+    CHECK_EQUAL(1, num_connection_closed);
+    CHECK_FALSE(goep_server_srm_active(goep_cid));
+}
+
+TEST(GOEPServer, Delete){
+    uint16_t cid = connect_ftp_l2cap();
+    create_put(true, "old.txt", NULL, 0, false);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_delete_requests);
+    CHECK_EQUAL(0, num_put_requests);
+    STRCMP_EQUAL("old.txt", request_name);
+
+    reject_code = OBEX_RESP_FORBIDDEN;
+    CHECK_EQUAL(OBEX_RESP_FORBIDDEN, send_request(cid));
+    CHECK_EQUAL(2, num_delete_requests);
+}
+
+TEST(GOEPServer, DeleteNotSupported){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(true, "old.txt", NULL, 0, false);
+    CHECK_EQUAL(OBEX_RESP_NOT_IMPLEMENTED, send_request(cid));
+    CHECK_EQUAL(0, num_delete_requests);
+}
+
+TEST(GOEPServer, SetPath){
+    uint16_t cid = connect_ftp_l2cap();
+    obex_message_builder_request_create_set_path(request, sizeof(request), 2, OBEX_CONNECTION_ID_INVALID);
+    obex_message_builder_header_add_name(request, sizeof(request), "docs");
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_set_path_requests);
+    CHECK_EQUAL(2, request_flags);
+    STRCMP_EQUAL("docs", request_name);
+
+    // backup without name
+    obex_message_builder_request_create_set_path(request, sizeof(request), 3, OBEX_CONNECTION_ID_INVALID);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(3, request_flags);
+    STRCMP_EQUAL("", request_name);
+
+    reject_code = OBEX_RESP_NOT_FOUND;
+    obex_message_builder_request_create_set_path(request, sizeof(request), 2, OBEX_CONNECTION_ID_INVALID);
+    obex_message_builder_header_add_name(request, sizeof(request), "missing");
+    CHECK_EQUAL(OBEX_RESP_NOT_FOUND, send_request(cid));
+}
+
+TEST(GOEPServer, SetPathNotSupported){
+    uint16_t cid = connect_opp_l2cap();
+    obex_message_builder_request_create_set_path(request, sizeof(request), 2, OBEX_CONNECTION_ID_INVALID);
+    CHECK_EQUAL(OBEX_RESP_NOT_IMPLEMENTED, send_request(cid));
+}
+
+TEST(GOEPServer, GetNotFound){
+    uint16_t cid = connect_ftp_l2cap();
+    create_get(true, "missing.txt", NULL, false, false);
+    CHECK_EQUAL(OBEX_RESP_NOT_FOUND, send_request(cid));
+    CHECK_EQUAL(1, num_get_requests);
+    CHECK_EQUAL(0, num_get_completed);
+    STRCMP_EQUAL("missing.txt", request_name);
+}
+
+TEST(GOEPServer, GetNotSupported){
+    uint16_t cid = connect_opp_l2cap();
+    create_get(true, NULL, "text/x-vcard", false, false);
+    CHECK_EQUAL(OBEX_RESP_NOT_IMPLEMENTED, send_request(cid));
+    CHECK_EQUAL(0, num_get_requests);
+}
+
+TEST(GOEPServer, AcceptGetOutsideOfEvent){
+    connect_ftp_l2cap();
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, goep_server_accept_get(goep_cid, 10, &get_callback));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, goep_server_accept_get(0x1234, 10, &get_callback));
+}
+
+TEST(GOEPServer, GetWithoutSrm){
+    uint16_t cid = mock_rfcomm_connect(FTP_RFCOMM_CHANNEL, 1000);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_connect(cid, folder_browsing_uuid, sizeof(folder_browsing_uuid), 1000));
+    get_accept = true;
+    get_object_len = 5000;
+    create_get(true, NULL, "x-obex/folder-listing", false, false);
+    uint8_t data[6000];
+    uint32_t data_len = 0;
+    int num_responses = 0;
+    while (true){
+        uint8_t response_code = send_request(cid);
+        num_responses++;
+        CHECK_TRUE(response_len <= 1000);
+        if (num_responses == 1){
+            CHECK_TRUE(response_has_header(OBEX_OPCODE_GET, OBEX_HEADER_LENGTH, 0));
+        }
+        bool end_of_body = store_get_body(data, &data_len);
+        if (response_code == OBEX_RESP_SUCCESS){
+            CHECK_TRUE(end_of_body);
+            break;
+        }
+        CHECK_EQUAL(OBEX_RESP_CONTINUE, response_code);
+        CHECK_EQUAL(0, mock_num_responses());
+        create_get(true, NULL, NULL, false, false);
+    }
+    STRCMP_EQUAL("x-obex/folder-listing", request_type);
+    CHECK_EQUAL(1, num_get_requests);
+    CHECK_EQUAL(6, num_responses);
+    CHECK_EQUAL(get_object_len, data_len);
+    MEMCMP_EQUAL(get_object, data, get_object_len);
+    CHECK_EQUAL(1, num_get_completed);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, completed_status);
+}
+
+TEST(GOEPServer, GetWithSrm){
+    uint16_t cid = connect_ftp_l2cap();
+    get_accept = true;
+    get_object_len = 20000;
+    create_get(true, "file.bin", NULL, true, false);
+    uint8_t response_code = send_request(cid);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, response_code);
+    CHECK_TRUE(response_has_header(OBEX_OPCODE_GET, OBEX_HEADER_SINGLE_RESPONSE_MODE, OBEX_SRM_ENABLE));
+    uint8_t data[20000];
+    uint32_t data_len = 0;
+    store_get_body(data, &data_len);
+    // remaining responses are streamed without further requests
+    int num_responses = 1;
+    while (true){
+        response_len = mock_get_response(cid, response, sizeof(response));
+        if (response_len == 0) break;
+        num_responses++;
+        CHECK_TRUE(response_len <= 4096);
+        response_code = response[0];
+        store_get_body(data, &data_len);
+    }
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, response_code);
+    CHECK_EQUAL(5, num_responses);
+    CHECK_EQUAL(get_object_len, data_len);
+    MEMCMP_EQUAL(get_object, data, get_object_len);
+    CHECK_EQUAL(1, num_get_completed);
+    CHECK_FALSE(goep_server_srm_active(goep_cid));
+}
+
+TEST(GOEPServer, GetWithSrmWait){
+    uint16_t cid = connect_ftp_l2cap();
+    get_accept = true;
+    get_object_len = 10000;
+    create_get(true, "file.bin", NULL, true, true);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    uint8_t data[10000];
+    uint32_t data_len = 0;
+    store_get_body(data, &data_len);
+    // paused by client
+    CHECK_EQUAL(0, mock_num_responses());
+    create_get(true, NULL, NULL, false, true);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    store_get_body(data, &data_len);
+    CHECK_EQUAL(0, mock_num_responses());
+    // resume streaming
+    create_get(true, NULL, NULL, false, false);
+    uint8_t response_code = send_request(cid);
+    while (response_len > 0){
+        response_code = response[0];
+        store_get_body(data, &data_len);
+        response_len = mock_get_response(cid, response, sizeof(response));
+    }
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, response_code);
+    CHECK_EQUAL(get_object_len, data_len);
+    MEMCMP_EQUAL(get_object, data, get_object_len);
+}
+
+TEST(GOEPServer, GetMultiPacketRequest){
+    uint16_t cid = connect_ftp_l2cap();
+    get_accept = true;
+    get_object_len = 100;
+    create_get(false, "file.bin", NULL, false, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    CHECK_EQUAL(1, num_get_requests);
+    create_get(true, NULL, NULL, false, false);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    uint8_t data[100];
+    uint32_t data_len = 0;
+    CHECK_TRUE(store_get_body(data, &data_len));
+    CHECK_EQUAL(100, data_len);
+    CHECK_EQUAL(1, num_get_completed);
+}
+
+TEST(GOEPServer, GetEmptyObject){
+    uint16_t cid = connect_ftp_l2cap();
+    get_accept = true;
+    get_object_len = 0;
+    create_get(true, "empty.txt", NULL, true, false);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    uint8_t data[1];
+    uint32_t data_len = 0;
+    CHECK_TRUE(store_get_body(data, &data_len));
+    CHECK_EQUAL(0, data_len);
+    CHECK_EQUAL(1, num_get_completed);
+}
+
+TEST(GOEPServer, AbortGet){
+    uint16_t cid = connect_ftp_l2cap();
+    get_accept = true;
+    get_object_len = 10000;
+    create_get(true, "file.bin", NULL, false, false);
+    CHECK_EQUAL(OBEX_RESP_CONTINUE, send_request(cid));
+    obex_message_builder_request_create_abort(request, sizeof(request), OBEX_CONNECTION_ID_INVALID);
+    CHECK_EQUAL(OBEX_RESP_SUCCESS, send_request(cid));
+    CHECK_EQUAL(1, num_get_completed);
+    CHECK_EQUAL(OBEX_ABORTED, completed_status);
+}
+
+TEST(GOEPServer, UnsupportedOpcode){
+    uint16_t cid = connect_opp_l2cap();
+    request[0] = OBEX_OPCODE_SESSION;
+    big_endian_store_16(request, 1, 3);
+    CHECK_EQUAL(OBEX_RESP_NOT_IMPLEMENTED, send_request(cid));
+}
+
+TEST(GOEPServer, InvalidPacketLength){
+    uint16_t cid = connect_opp_l2cap();
+    create_put(true, "a.txt", NULL, 0, false);
+    add_body((const uint8_t *) "abc", 3, true);
+    mock_receive(cid, request, big_endian_read_16(request, 1) - 1);
+    mock_run();
+    response_len = mock_get_response(cid, response, sizeof(response));
+    CHECK_EQUAL(OBEX_RESP_BAD_REQUEST, response[0]);
+    CHECK_EQUAL(0, num_put_requests);
+}
+
+TEST(GOEPServer, SdpRecords){
+    uint8_t service[200];
+    memset(service, 0, sizeof(service));
+    const uint8_t formats[] = { OPP_SERVER_FORMAT_VCARD_21, OPP_SERVER_FORMAT_ANY };
+    opp_server_create_sdp_record(service, 0x10001, OPP_RFCOMM_CHANNEL, OPP_L2CAP_PSM, "OPP", sizeof(formats), formats);
+    CHECK_EQUAL(1, sdp_record_matches_service_search_pattern(service, (uint8_t *) "\x35\x03\x19\x11\x05"));
+    uint8_t * psm = sdp_get_attribute_value_for_attribute_id(service, BLUETOOTH_ATTRIBUTE_GOEP_L2CAP_PSM);
+    CHECK_TRUE(psm != NULL);
+    CHECK_EQUAL(OPP_L2CAP_PSM, big_endian_read_16(psm, 1));
+    uint8_t * supported_formats = sdp_get_attribute_value_for_attribute_id(service, BLUETOOTH_ATTRIBUTE_SUPPORTED_FORMATS_LIST);
+    CHECK_TRUE(supported_formats != NULL);
+    // sequence with 16-bit length and two uint8 elements
+    CHECK_EQUAL(3 + 2 + 2, de_get_len(supported_formats));
+
+    memset(service, 0, sizeof(service));
+    ftp_server_create_sdp_record(service, 0x10002, FTP_RFCOMM_CHANNEL, 0, "FTP");
+    CHECK_EQUAL(1, sdp_record_matches_service_search_pattern(service, (uint8_t *) "\x35\x03\x19\x11\x06"));
+    CHECK_EQUAL(1, sdp_record_matches_service_search_pattern(service, (uint8_t *) "\x35\x03\x19\x00\x08"));
+    CHECK_TRUE(sdp_get_attribute_value_for_attribute_id(service, BLUETOOTH_ATTRIBUTE_GOEP_L2CAP_PSM) == NULL);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,355 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "btstack_defines.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "l2cap.h"
+#include "classic/rfcomm.h"
+
+#include "mock.h"
+
+#define MAX_SERVICES        4
+#define MAX_CHANNELS        4
+#define MAX_RESPONSES       64
+#define MAX_RESPONSE_LEN    8192
+
+typedef struct {
+    btstack_packet_handler_t packet_handler;
+    uint16_t id;
+    bool     l2cap;
+} mock_service_t;
+
+typedef struct {
+    uint16_t cid;
+    uint16_t len;
+    uint8_t  data[MAX_RESPONSE_LEN];
+} mock_response_t;
+
+static const bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static mock_service_t  services[MAX_SERVICES];
+static int             num_services;
+static mock_channel_t  channels[MAX_CHANNELS];
+static int             num_channels;
+static uint16_t        cid_counter;
+static int             num_local_disconnects;
+static mock_response_t responses[MAX_RESPONSES];
+static int             responses_head;
+static int             responses_count;
+static uint8_t         rfcomm_outgoing_buffer[MAX_RESPONSE_LEN];
+static void (*send_handler)(uint16_t cid, const uint8_t * packet, uint16_t size);
+
+void mock_init(void){
+    memset(services, 0, sizeof(services));
+    memset(channels, 0, sizeof(channels));
+    num_services = 0;
+    num_channels = 0;
+    cid_counter = 0x40;
+    num_local_disconnects = 0;
+    responses_head = 0;
+    responses_count = 0;
+    send_handler = NULL;
+}
+
+static mock_service_t * mock_service_for_id(uint16_t id, bool l2cap){
+    int i;
+    for (i=0;i<num_services;i++){
+        if ((services[i].id == id) && (services[i].l2cap == l2cap)) return &services[i];
+    }
+    return NULL;
+}
+
+static uint8_t mock_register_service(btstack_packet_handler_t packet_handler, uint16_t id, bool l2cap){
+    if (mock_service_for_id(id, l2cap) != NULL) return l2cap ? L2CAP_SERVICE_ALREADY_REGISTERED : RFCOMM_CHANNEL_ALREADY_REGISTERED;
+    if (num_services == MAX_SERVICES) return BTSTACK_MEMORY_ALLOC_FAILED;
+    services[num_services].packet_handler = packet_handler;
+    services[num_services].id = id;
+    services[num_services].l2cap = l2cap;
+    num_services++;
+    return ERROR_CODE_SUCCESS;
+}
+
+static void mock_unregister_service(uint16_t id, bool l2cap){
+    mock_service_t * service = mock_service_for_id(id, l2cap);
+    if (service == NULL) return;
+    service->packet_handler = NULL;
+    service->id = 0;
+}
+
+bool mock_l2cap_service_registered(uint16_t psm){
+    return mock_service_for_id(psm, true) != NULL;
+}
+
+bool mock_rfcomm_service_registered(uint8_t server_channel){
+    return mock_service_for_id(server_channel, false) != NULL;
+}
+
+mock_channel_t * mock_channel_for_cid(uint16_t cid){
+    int i;
+    for (i=0;i<num_channels;i++){
+        if (channels[i].cid == cid) return &channels[i];
+    }
+    return NULL;
+}
+
+static mock_channel_t * mock_channel_create(mock_service_t * service, bool l2cap){
+    if (num_channels == MAX_CHANNELS) return NULL;
+    mock_channel_t * channel = &channels[num_channels++];
+    memset(channel, 0, sizeof(mock_channel_t));
+    channel->cid = ++cid_counter;
+    channel->l2cap = l2cap;
+    channel->packet_handler = service->packet_handler;
+    return channel;
+}
+
+uint16_t mock_l2cap_connect(uint16_t psm, uint16_t remote_mtu){
+    mock_service_t * service = mock_service_for_id(psm, true);
+    if (service == NULL) return 0;
+    mock_channel_t * channel = mock_channel_create(service, true);
+    if (channel == NULL) return 0;
+
+    uint8_t event[16];
+    event[0] = L2CAP_EVENT_INCOMING_CONNECTION;
+    event[1] = sizeof(event) - 2;
+    reverse_bd_addr(remote_addr, &event[2]);
+    little_endian_store_16(event,  8, 0x0001);
+    little_endian_store_16(event, 10, psm);
+    little_endian_store_16(event, 12, channel->cid);
+    little_endian_store_16(event, 14, channel->cid);
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    if (channel->accepted == false) return 0;
+
+    uint8_t opened[26];
+    memset(opened, 0, sizeof(opened));
+    opened[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    opened[1] = sizeof(opened) - 2;
+    reverse_bd_addr(remote_addr, &opened[3]);
+    little_endian_store_16(opened,  9, 0x0001);
+    little_endian_store_16(opened, 11, psm);
+    little_endian_store_16(opened, 13, channel->cid);
+    little_endian_store_16(opened, 15, channel->cid);
+    little_endian_store_16(opened, 17, channel->ertm_config.local_mtu);
+    little_endian_store_16(opened, 19, remote_mtu);
+    opened[24] = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+    channel->open = true;
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, opened, sizeof(opened));
+    return channel->cid;
+}
+
+uint16_t mock_rfcomm_connect(uint8_t server_channel, uint16_t max_frame_size){
+    mock_service_t * service = mock_service_for_id(server_channel, false);
+    if (service == NULL) return 0;
+    mock_channel_t * channel = mock_channel_create(service, false);
+    if (channel == NULL) return 0;
+
+    uint8_t event[11];
+    event[0] = RFCOMM_EVENT_INCOMING_CONNECTION;
+    event[1] = sizeof(event) - 2;
+    reverse_bd_addr(remote_addr, &event[2]);
+    event[8] = server_channel;
+    little_endian_store_16(event, 9, channel->cid);
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    if (channel->accepted == false) return 0;
+
+    uint8_t opened[17];
+    memset(opened, 0, sizeof(opened));
+    opened[0] = RFCOMM_EVENT_CHANNEL_OPENED;
+    opened[1] = sizeof(opened) - 2;
+    opened[2] = ERROR_CODE_SUCCESS;
+    reverse_bd_addr(remote_addr, &opened[3]);
+    little_endian_store_16(opened,  9, 0x0001);
+    opened[11] = server_channel;
+    little_endian_store_16(opened, 12, channel->cid);
+    little_endian_store_16(opened, 14, max_frame_size);
+    opened[16] = 1;
+    channel->open = true;
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, opened, sizeof(opened));
+    return channel->cid;
+}
+
+static void mock_emit_closed(mock_channel_t * channel){
+    if (channel->open == false) return;
+    channel->open = false;
+    uint8_t event[4];
+    event[0] = channel->l2cap ? L2CAP_EVENT_CHANNEL_CLOSED : RFCOMM_EVENT_CHANNEL_CLOSED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, channel->cid);
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void mock_disconnect(uint16_t cid){
+    mock_channel_t * channel = mock_channel_for_cid(cid);
+    if (channel == NULL) return;
+    mock_emit_closed(channel);
+}
+
+int mock_num_local_disconnects(void){
+    return num_local_disconnects;
+}
+
+void mock_receive(uint16_t cid, const uint8_t * packet, uint16_t size){
+    mock_channel_t * channel = mock_channel_for_cid(cid);
+    if (channel == NULL) return;
+    if (channel->open == false) return;
+    // packet handlers don't modify received data
+    (*channel->packet_handler)(channel->l2cap ? L2CAP_DATA_PACKET : RFCOMM_DATA_PACKET, cid, (uint8_t *) packet, size);
+}
+
+void mock_set_send_handler(void (*handler)(uint16_t cid, const uint8_t * packet, uint16_t size)){
+    send_handler = handler;
+}
+
+static void mock_send(uint16_t cid, const uint8_t * packet, uint16_t size){
+    if (send_handler != NULL){
+        (*send_handler)(cid, packet, size);
+        return;
+    }
+    if (responses_count == MAX_RESPONSES) return;
+    mock_response_t * response = &responses[(responses_head + responses_count) % MAX_RESPONSES];
+    responses_count++;
+    response->cid = cid;
+    response->len = btstack_min(size, sizeof(response->data));
+    memcpy(response->data, packet, response->len);
+}
+
+uint16_t mock_get_response(uint16_t cid, uint8_t * buffer, uint16_t buffer_size){
+    if (responses_count == 0) return 0;
+    mock_response_t * response = &responses[responses_head];
+    if (response->cid != cid) return 0;
+    responses_head = (responses_head + 1) % MAX_RESPONSES;
+    responses_count--;
+    uint16_t len = btstack_min(response->len, buffer_size);
+    memcpy(buffer, response->data, len);
+    return len;
+}
+
+int mock_num_responses(void){
+    return responses_count;
+}
+
+int mock_run(void){
+    int num_events = 0;
+    bool emitted = true;
+    while (emitted){
+        emitted = false;
+        int i;
+        for (i=0;i<num_channels;i++){
+            mock_channel_t * channel = &channels[i];
+            if (channel->open == false) continue;
+            if (channel->can_send_now_requested == false) continue;
+            channel->can_send_now_requested = false;
+            uint8_t event[4];
+            event[0] = channel->l2cap ? L2CAP_EVENT_CAN_SEND_NOW : RFCOMM_EVENT_CAN_SEND_NOW;
+            event[1] = sizeof(event) - 2;
+            little_endian_store_16(event, 2, channel->cid);
+            (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+            num_events++;
+            emitted = true;
+        }
+    }
+    return num_events;
+}
+
+// L2CAP
+
+uint8_t l2cap_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, uint16_t mtu, gap_security_level_t security_level){
+    UNUSED(mtu);
+    UNUSED(security_level);
+    return mock_register_service(packet_handler, psm, true);
+}
+
+uint8_t l2cap_unregister_service(uint16_t psm){
+    mock_unregister_service(psm, true);
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_accept_ertm_connection(uint16_t local_cid, l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size){
+    UNUSED(buffer);
+    mock_channel_t * channel = mock_channel_for_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    channel->accepted = true;
+    channel->ertm_config = *ertm_config;
+    channel->ertm_buffer_size = size;
+    return ERROR_CODE_SUCCESS;
+}
+
+void l2cap_decline_connection(uint16_t local_cid){
+    mock_channel_t * channel = mock_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    channel->declined = true;
+}
+
+void l2cap_request_can_send_now_event(uint16_t local_cid){
+    mock_channel_t * channel = mock_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    channel->can_send_now_requested = true;
+}
+
+int l2cap_send(uint16_t local_cid, uint8_t *data, uint16_t len){
+    mock_channel_t * channel = mock_channel_for_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    mock_send(local_cid, data, len);
+    return ERROR_CODE_SUCCESS;
+}
+
+void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
+    UNUSED(reason);
+    mock_channel_t * channel = mock_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    num_local_disconnects++;
+    mock_emit_closed(channel);
+}
+
+// RFCOMM
+
+uint8_t rfcomm_register_service(btstack_packet_handler_t packet_handler, uint8_t channel, uint16_t max_frame_size){
+    UNUSED(max_frame_size);
+    return mock_register_service(packet_handler, channel, false);
+}
+
+void rfcomm_unregister_service(uint8_t service_channel){
+    mock_unregister_service(service_channel, false);
+}
+
+void rfcomm_accept_connection(uint16_t rfcomm_cid){
+    mock_channel_t * channel = mock_channel_for_cid(rfcomm_cid);
+    if (channel == NULL) return;
+    channel->accepted = true;
+}
+
+void rfcomm_decline_connection(uint16_t rfcomm_cid){
+    mock_channel_t * channel = mock_channel_for_cid(rfcomm_cid);
+    if (channel == NULL) return;
+    channel->declined = true;
+}
+
+void rfcomm_disconnect(uint16_t rfcomm_cid){
+    mock_channel_t * channel = mock_channel_for_cid(rfcomm_cid);
+    if (channel == NULL) return;
+    num_local_disconnects++;
+    mock_emit_closed(channel);
+}
+
+void rfcomm_request_can_send_now_event(uint16_t rfcomm_cid){
+    mock_channel_t * channel = mock_channel_for_cid(rfcomm_cid);
+    if (channel == NULL) return;
+    channel->can_send_now_requested = true;
+}
+
+int rfcomm_reserve_packet_buffer(void){
+    return 1;
+}
+
+uint8_t * rfcomm_get_outgoing_buffer(void){
+    return rfcomm_outgoing_buffer;
+}
+
+int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
+    mock_channel_t * channel = mock_channel_for_cid(rfcomm_cid);
+    if (channel == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    mock_send(rfcomm_cid, rfcomm_outgoing_buffer, len);
+    return ERROR_CODE_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+#include "btstack_bool.h"
+#include "l2cap.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t                 cid;
+    bool                     l2cap;
+    bool                     accepted;
+    bool                     declined;
+    bool                     open;
+    bool                     can_send_now_requested;
+    btstack_packet_handler_t packet_handler;
+    // ERTM config and buffer size provided by l2cap_accept_ertm_connection
+    l2cap_ertm_config_t      ertm_config;
+    uint32_t                 ertm_buffer_size;
+} mock_channel_t;
+
+// reset L2CAP and RFCOMM mock
+void mock_init(void);
+
+// services registered with l2cap_register_service and rfcomm_register_service
+bool mock_l2cap_service_registered(uint16_t psm);
+bool mock_rfcomm_service_registered(uint8_t server_channel);
+
+// remote opens channel to service, returns local cid or 0 if declined
+uint16_t mock_l2cap_connect(uint16_t psm, uint16_t remote_mtu);
+uint16_t mock_rfcomm_connect(uint8_t server_channel, uint16_t max_frame_size);
+
+mock_channel_t * mock_channel_for_cid(uint16_t cid);
+
+// remote closes channel
+void mock_disconnect(uint16_t cid);
+
+// number of l2cap_disconnect / rfcomm_disconnect calls
+int mock_num_local_disconnects(void);
+
+// deliver OBEX request from remote
+void mock_receive(uint16_t cid, const uint8_t * packet, uint16_t size);
+
+// pass OBEX responses to handler instead of response queue, e.g. to simulate link
+void mock_set_send_handler(void (*handler)(uint16_t cid, const uint8_t * packet, uint16_t size));
+
+// next OBEX response sent on channel, returns 0 if none
+uint16_t mock_get_response(uint16_t cid, uint8_t * buffer, uint16_t buffer_size);
+int      mock_num_responses(void);
+
+// emit pending can send now events until idle, returns number of events
+int mock_run(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
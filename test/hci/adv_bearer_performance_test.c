@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+// *****************************************************************************
+//
+// Mesh ADV Bearer relay throughput test
+//
+// Simulates a relay node that receives Network PDUs at a fixed rate and
+// retransmits each of them with the default Relay Retransmit Count and
+// Interval. Reports relay throughput, latency from reception to the first and
+// last transmission and the number of HCI Commands per PDU in virtual time,
+// for legacy advertising and for different numbers of advertising sets.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bluetooth_data_types.h"
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/le_device_db.h"
+#include "mesh/adv_bearer.h"
+#include "hci.h"
+
+#include "mock.h"
+
+#define NUM_PDUS                  100
+#define NETWORK_PDU_LEN           29
+// Relay Retransmit Count 2 = 3 transmissions, Relay Retransmit Interval Steps 1 = 20 ms
+#define RELAY_TRANSMISSIONS       3
+#define RELAY_INTERVAL_MS         20
+
+typedef struct {
+    const char * name;
+    uint8_t      num_advertising_sets;
+    int          extended_advertising;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "legacy advertising",   0, 0 },
+    { "1 advertising set",    1, 1 },
+    { "2 advertising sets",   2, 1 },
+    { "4 advertising sets",   4, 1 },
+};
+
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenario_t))
+
+// received PDUs per second
+static const uint16_t rx_rates[] = { 5, 20, 50 };
+
+#define NUM_RX_RATES (sizeof(rx_rates) / sizeof(uint16_t))
+
+static const mock_controller_config_t controller_usb = {
+    4,      // num_cmd_packets
+    500,    // latency_host_to_controller_us
+    1000,   // latency_controller_to_host_us
+    0,      // byte_time_us
+    100,    // processing_us
+};
+
+static btstack_timer_source_t rx_timer;
+static uint16_t rx_interval_ms;
+static uint16_t num_received;
+static uint16_t num_relayed;
+static uint32_t rx_time_us[NUM_PDUS];
+static uint32_t first_tx_time_us[NUM_PDUS];
+static uint32_t last_tx_time_us[NUM_PDUS];
+static uint8_t  num_transmissions[NUM_PDUS];
+
+static void bearer_advertising_callback(uint32_t time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len){
+    UNUSED(advertising_handle);
+    if (len < 4) return;
+    if (data[1] != BLUETOOTH_DATA_TYPE_MESH_MESSAGE) return;
+    uint16_t index = little_endian_read_16(data, 2);
+    if (index >= NUM_PDUS) return;
+    if (num_transmissions[index] == 0){
+        first_tx_time_us[index] = time_us;
+    }
+    last_tx_time_us[index] = time_us;
+    num_transmissions[index]++;
+}
+
+static void relay_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_MESH_META) return;
+    if (hci_event_mesh_meta_get_subevent_code(packet) != MESH_SUBEVENT_CAN_SEND_NOW) return;
+    if (num_relayed >= num_received) return;
+    uint8_t pdu[NETWORK_PDU_LEN];
+    memset(pdu, 0x55, sizeof(pdu));
+    little_endian_store_16(pdu, 0, num_relayed);
+    adv_bearer_send_network_pdu(pdu, sizeof(pdu), RELAY_TRANSMISSIONS, RELAY_INTERVAL_MS);
+    num_relayed++;
+    if (num_relayed < num_received){
+        adv_bearer_request_can_send_now_for_network_pdu();
+    }
+}
+
+static void rx_timer_handler(btstack_timer_source_t * ts){
+    rx_time_us[num_received] = mock_controller_get_time_us();
+    num_received++;
+    // request can send now if relay queue was empty
+    if (num_relayed + 1 == num_received){
+        adv_bearer_request_can_send_now_for_network_pdu();
+    }
+    if (num_received < NUM_PDUS){
+        btstack_run_loop_set_timer(ts, rx_interval_ms);
+        btstack_run_loop_add_timer(ts);
+    }
+}
+
+static void benchmark(const scenario_t * scenario, uint16_t rx_rate){
+    btstack_memory_init();
+    btstack_run_loop_init(mock_run_loop_get_instance());
+    mock_controller_init(&controller_usb);
+    mock_controller_set_le_extended_advertising(scenario->extended_advertising);
+    mock_controller_set_advertising_callback(&bearer_advertising_callback);
+    hci_init(mock_controller_get_transport(), NULL);
+    le_device_db_init();
+    adv_bearer_init();
+    adv_bearer_set_max_advertising_sets(scenario->num_advertising_sets);
+    adv_bearer_register_for_network_pdu(&relay_handler);
+    hci_power_control(HCI_POWER_ON);
+    mock_controller_run();
+
+    num_received = 0;
+    num_relayed = 0;
+    memset(num_transmissions, 0, sizeof(num_transmissions));
+    uint16_t num_commands_start = mock_controller_num_commands();
+
+    rx_interval_ms = 1000 / rx_rate;
+    btstack_run_loop_set_timer_handler(&rx_timer, &rx_timer_handler);
+    btstack_run_loop_set_timer(&rx_timer, rx_interval_ms);
+    btstack_run_loop_add_timer(&rx_timer);
+    mock_controller_run();
+
+    uint32_t first_latency_us = 0;
+    uint32_t last_latency_us = 0;
+    uint16_t num_complete = 0;
+    uint16_t i;
+    for (i = 0; i < NUM_PDUS; i++){
+        if (num_transmissions[i] != RELAY_TRANSMISSIONS) continue;
+        first_latency_us += first_tx_time_us[i] - rx_time_us[i];
+        last_latency_us  += last_tx_time_us[i]  - rx_time_us[i];
+        num_complete++;
+    }
+    uint32_t duration_ms = (last_tx_time_us[NUM_PDUS - 1] - rx_time_us[0]) / 1000;
+    uint16_t num_commands = mock_controller_num_commands() - num_commands_start;
+    if (num_complete == 0){
+        num_complete = 1;
+    }
+    printf("  %-20s %4u PDU/s %8u PDU/s %6u ms %6u ms %8u.%u\n", scenario->name, rx_rate,
+           (uint32_t) (num_relayed * 1000 / btstack_max(duration_ms, 1)),
+           first_latency_us / num_complete / 1000, last_latency_us / num_complete / 1000,
+           num_commands / NUM_PDUS, (num_commands * 10 / NUM_PDUS) % 10);
+
+    hci_deinit();
+    btstack_memory_deinit();
+    btstack_run_loop_deinit();
+}
+
+int main (int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    printf("%u relayed Network PDUs, %u transmissions, %u ms interval, queue size %u\n",
+           NUM_PDUS, RELAY_TRANSMISSIONS, RELAY_INTERVAL_MS, MESH_ADV_BEARER_QUEUE_SIZE);
+    printf("  %-20s %9s %14s %9s %9s %10s\n", "", "received", "relayed", "first tx", "last tx", "HCI cmds");
+    unsigned int i;
+    unsigned int j;
+    for (j = 0; j < NUM_RX_RATES; j++){
+        for (i = 0; i < NUM_SCENARIOS; i++){
+            benchmark(&scenarios[i], rx_rates[j]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+//
+// btstack_config.h for HCI unit test
+//
+
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+// Port related features
+#define HAVE_MALLOC
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_CLASSIC
+#define ENABLE_HCI_EVENT_DISPATCH_TABLE
+#define ENABLE_LE_CENTRAL
+#define ENABLE_LE_DATA_LENGTH_EXTENSION
+#define ENABLE_LE_EXTENDED_ADVERTISING
+#define ENABLE_LE_PERIODIC_ADVERTISING
+#define ENABLE_LE_PERIPHERAL
+#define ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+#define ENABLE_LOG_ERROR
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 1021
+#define LE_SCAN_DUPLICATE_FILTER_SIZE 64
+#define MAX_NR_LE_DEVICE_DB_ENTRIES 4
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+// *****************************************************************************
+//
+// HCI event dispatch performance test
+//
+// Registers the HCI event handlers of a full Classic + LE profile set (L2CAP,
+// SM, ATT Server, GATT Client, Crypto, HFP HF, HFP AG, application) and
+// measures the cost of delivering typical events to them, once with every
+// handler receiving all events and once with handlers registered for the
+// events they handle.
+//
+// The cost of HCI itself is measured without any event handler and
+// subtracted from the results.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/le_device_db.h"
+#include "gap.h"
+#include "hci.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define NUM_ITERATIONS 200000
+
+typedef struct {
+    const char *    name;
+    const uint8_t * event_codes;
+    uint16_t        num_event_codes;
+    const uint8_t * le_subevent_codes;
+    uint16_t        num_le_subevent_codes;
+} profile_t;
+
+typedef struct {
+    const char *  name;
+    uint8_t       len;
+    uint8_t       event[16];
+} event_template_t;
+
+typedef enum {
+    DISPATCH_NONE = 0,
+    DISPATCH_ALL_EVENTS,
+    DISPATCH_TABLE,
+} dispatch_mode_t;
+
+// events handled by the HCI event handlers of the stack modules and a typical application
+static const uint8_t l2cap_events[] = {
+    BTSTACK_EVENT_NR_CONNECTIONS_CHANGED, GAP_EVENT_SECURITY_LEVEL, HCI_EVENT_COMMAND_COMPLETE, HCI_EVENT_COMMAND_STATUS,
+    HCI_EVENT_CONNECTION_COMPLETE, HCI_EVENT_DISCONNECTION_COMPLETE, HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS,
+    HCI_EVENT_READ_REMOTE_EXTENDED_FEATURES_COMPLETE, HCI_EVENT_READ_REMOTE_SUPPORTED_FEATURES_COMPLETE, HCI_EVENT_TRANSPORT_PACKET_SENT,
+};
+static const uint8_t le_connection_subevents[] = {
+    HCI_SUBEVENT_LE_CONNECTION_COMPLETE,
+};
+static const uint8_t sm_events[] = {
+    BTSTACK_EVENT_STATE, HCI_EVENT_COMMAND_COMPLETE, HCI_EVENT_DISCONNECTION_COMPLETE,
+    HCI_EVENT_ENCRYPTION_CHANGE, HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+};
+static const uint8_t sm_subevents[] = {
+    HCI_SUBEVENT_LE_CONNECTION_COMPLETE, HCI_SUBEVENT_LE_LONG_TERM_KEY_REQUEST,
+};
+static const uint8_t att_server_events[] = {
+    HCI_EVENT_DISCONNECTION_COMPLETE, HCI_EVENT_ENCRYPTION_CHANGE, HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+};
+static const uint8_t gatt_client_events[] = {
+    HCI_EVENT_DISCONNECTION_COMPLETE,
+};
+static const uint8_t crypto_events[] = {
+    BTSTACK_EVENT_STATE, HCI_EVENT_COMMAND_COMPLETE,
+};
+static const uint8_t crypto_subevents[] = {
+    HCI_SUBEVENT_LE_READ_LOCAL_P256_PUBLIC_KEY_COMPLETE, HCI_SUBEVENT_LE_GENERATE_DHKEY_COMPLETE,
+};
+static const uint8_t hfp_events[] = {
+    HCI_EVENT_COMMAND_STATUS, HCI_EVENT_CONNECTION_REQUEST, HCI_EVENT_DISCONNECTION_COMPLETE, HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE,
+};
+static const uint8_t app_events[] = {
+    BTSTACK_EVENT_STATE, GAP_EVENT_ADVERTISING_REPORT, HCI_EVENT_DISCONNECTION_COMPLETE,
+    HCI_EVENT_PIN_CODE_REQUEST, HCI_EVENT_USER_CONFIRMATION_REQUEST,
+};
+
+static const profile_t profiles[] = {
+    { "L2CAP",       l2cap_events,       sizeof(l2cap_events),       le_connection_subevents, sizeof(le_connection_subevents) },
+    { "SM",          sm_events,          sizeof(sm_events),          sm_subevents,            sizeof(sm_subevents) },
+    { "ATT Server",  att_server_events,  sizeof(att_server_events),  le_connection_subevents, sizeof(le_connection_subevents) },
+    { "GATT Client", gatt_client_events, sizeof(gatt_client_events), NULL,                    0 },
+    { "Crypto",      crypto_events,      sizeof(crypto_events),      crypto_subevents,        sizeof(crypto_subevents) },
+    { "HFP HF",      hfp_events,         sizeof(hfp_events),         NULL,                    0 },
+    { "HFP AG",      hfp_events,         sizeof(hfp_events),         NULL,                    0 },
+    { "App",         app_events,         sizeof(app_events),         le_connection_subevents, sizeof(le_connection_subevents) },
+};
+
+#define NUM_PROFILES (sizeof(profiles) / sizeof(profile_t))
+
+// events for unknown connections are passed to the event handlers without further processing in HCI
+static const event_template_t event_templates[] = {
+    { "Number Of Completed Packets", 7, { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0x40, 0x00, 0x01, 0x00 } },
+    { "LE Advertising Report",      15, { HCI_EVENT_LE_META, 13, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 1, 0, 1, 1, 2, 3, 4, 5, 0xc6, 1, 0, 0xc4 } },
+    { "LE Data Length Change",      13, { HCI_EVENT_LE_META, 11, HCI_SUBEVENT_LE_DATA_LENGTH_CHANGE, 0x40, 0x00, 0xfb, 0x00, 0x48, 0x08, 0xfb, 0x00, 0x48, 0x08 } },
+    { "Mode Change",                 8, { HCI_EVENT_MODE_CHANGE, 6, 0, 0x40, 0x00, 2, 0x20, 0x00 } },
+    { "Encryption Change",           6, { HCI_EVENT_ENCRYPTION_CHANGE, 4, 0, 0x40, 0x00, 1 } },
+    { "Vendor Specific",             5, { HCI_EVENT_VENDOR_SPECIFIC, 3, 0x01, 0x02, 0x03 } },
+};
+
+#define NUM_EVENT_TEMPLATES (sizeof(event_templates) / sizeof(event_template_t))
+
+static const mock_controller_config_t controller_usb = {
+    4,      // num_cmd_packets
+    500,    // latency_host_to_controller_us
+    1000,   // latency_controller_to_host_us
+    0,      // byte_time_us
+    100,    // processing_us
+};
+
+static btstack_packet_callback_registration_t hci_event_callback_registrations[NUM_PROFILES];
+static bool     profile_interested[NUM_PROFILES][256];
+static bool     profile_interested_le[NUM_PROFILES][256];
+static uint32_t handler_calls;
+static uint32_t events_handled;
+
+// equivalent of the event type switch in the event handler of a stack module
+static void profile_handle_event(uint8_t index, uint8_t packet_type, const uint8_t * packet){
+    if (packet_type != HCI_EVENT_PACKET) return;
+    handler_calls++;
+    uint8_t event_code = hci_event_packet_get_type(packet);
+    if (event_code == HCI_EVENT_LE_META){
+        if (profile_interested_le[index][hci_event_le_meta_get_subevent_code(packet)]){
+            events_handled++;
+        }
+    } else if (profile_interested[index][event_code]){
+        events_handled++;
+    }
+}
+
+static void profile_0_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(0, packet_type, packet);
+}
+static void profile_1_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(1, packet_type, packet);
+}
+static void profile_2_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(2, packet_type, packet);
+}
+static void profile_3_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(3, packet_type, packet);
+}
+static void profile_4_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(4, packet_type, packet);
+}
+static void profile_5_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(5, packet_type, packet);
+}
+static void profile_6_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(6, packet_type, packet);
+}
+static void profile_7_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    profile_handle_event(7, packet_type, packet);
+}
+
+static const btstack_packet_handler_t profile_handlers[] = {
+    &profile_0_handler, &profile_1_handler, &profile_2_handler, &profile_3_handler,
+    &profile_4_handler, &profile_5_handler, &profile_6_handler, &profile_7_handler,
+};
+
+static void profiles_init(void){
+    memset(profile_interested, 0, sizeof(profile_interested));
+    memset(profile_interested_le, 0, sizeof(profile_interested_le));
+    unsigned int i;
+    for (i = 0; i < NUM_PROFILES; i++){
+        uint16_t j;
+        for (j = 0; j < profiles[i].num_event_codes; j++){
+            profile_interested[i][profiles[i].event_codes[j]] = true;
+        }
+        for (j = 0; j < profiles[i].num_le_subevent_codes; j++){
+            profile_interested_le[i][profiles[i].le_subevent_codes[j]] = true;
+        }
+    }
+}
+
+static void stack_init(dispatch_mode_t mode){
+    btstack_memory_init();
+    btstack_run_loop_init(mock_run_loop_get_instance());
+    mock_controller_init(&controller_usb);
+    hci_init(mock_controller_get_transport(), NULL);
+    le_device_db_init();
+    unsigned int i;
+    for (i = 0; i < NUM_PROFILES; i++){
+        hci_event_callback_registrations[i].callback = profile_handlers[i];
+        switch (mode){
+            case DISPATCH_ALL_EVENTS:
+                hci_add_event_handler(&hci_event_callback_registrations[i]);
+                break;
+            case DISPATCH_TABLE:
+                hci_add_event_handler_for_events(&hci_event_callback_registrations[i],
+                                                 profiles[i].event_codes, profiles[i].num_event_codes,
+                                                 profiles[i].le_subevent_codes, profiles[i].num_le_subevent_codes);
+                break;
+            default:
+                break;
+        }
+    }
+    hci_power_control(HCI_POWER_ON);
+    gap_start_scan();
+    mock_controller_run();
+}
+
+static void stack_deinit(void){
+    hci_deinit();
+    btstack_memory_deinit();
+    btstack_run_loop_deinit();
+}
+
+// returns duration in us for NUM_ITERATIONS events
+static uint32_t benchmark(dispatch_mode_t mode, const event_template_t * event_template){
+    stack_init(mode);
+    handler_calls = 0;
+    events_handled = 0;
+    uint32_t time_us = mock_controller_get_time_us();
+    uint32_t start_us = perf_timer_get_time_us();
+    uint32_t i;
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        mock_controller_deliver_event(time_us, event_template->event, event_template->len);
+    }
+    uint32_t duration_us = perf_timer_get_time_us() - start_us;
+    stack_deinit();
+    return duration_us;
+}
+
+int main (int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    profiles_init();
+
+    printf("%u event handlers, %u events per type, %u dispatch table entries\n",
+           (unsigned int) NUM_PROFILES, NUM_ITERATIONS, HCI_EVENT_DISPATCH_MAX_HANDLERS);
+    printf("  %-28s %10s %18s %18s\n", "", "HCI only", "all events", "dispatch table");
+
+    uint32_t total_all_events_ns = 0;
+    uint32_t total_table_ns = 0;
+    unsigned int i;
+    for (i = 0; i < NUM_EVENT_TEMPLATES; i++){
+        uint32_t hci_us = benchmark(DISPATCH_NONE, &event_templates[i]);
+        uint32_t all_events_us = benchmark(DISPATCH_ALL_EVENTS, &event_templates[i]);
+        uint32_t all_events_calls = handler_calls;
+        uint32_t table_us = benchmark(DISPATCH_TABLE, &event_templates[i]);
+        uint32_t table_calls = handler_calls;
+        // dispatch cost per event in ns
+        uint32_t hci_ns = hci_us * 1000 / NUM_ITERATIONS;
+        uint32_t all_events_ns = (all_events_us > hci_us) ? (all_events_us - hci_us) * 1000 / NUM_ITERATIONS : 0;
+        uint32_t table_ns = (table_us > hci_us) ? (table_us - hci_us) * 1000 / NUM_ITERATIONS : 0;
+        total_all_events_ns += all_events_ns;
+        total_table_ns += table_ns;
+        printf("  %-28s %7u ns %5u ns %2u calls %5u ns %2u calls\n", event_templates[i].name, hci_ns,
+               all_events_ns, all_events_calls / NUM_ITERATIONS, table_ns, table_calls / NUM_ITERATIONS);
+    }
+    printf("  %-28s %10s %5u ns %8s %5u ns\n", "average dispatch cost", "",
+           (uint32_t) (total_all_events_ns / NUM_EVENT_TEMPLATES), "", (uint32_t) (total_table_ns / NUM_EVENT_TEMPLATES));
+    return 0;
+}
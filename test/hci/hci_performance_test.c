@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// HCI command pipeline performance test
+//
+// Powers up the stack against a simulated Controller that accepts up to
+// 4 commands (Num_HCI_Command_Packets) and reports time until HCI_STATE_WORKING,
+// time until all application and GAP commands have been processed with four
+// bonded devices, and time from a remote disconnect until the next connection
+// has been set up (Set PHY, Connection Update, Read RSSI acknowledged).
+// Transports are modeled by a fixed one-way latency and a time per byte.
+//
+// Build with -DHCI_MAX_OUTSTANDING_COMMANDS=1 for serialized commands as reference.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bluetooth_data_types.h"
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/le_device_db.h"
+#include "gap.h"
+#include "hci.h"
+#include "hci_cmd.h"
+
+#include "mock.h"
+
+#define NUM_BONDED_DEVICES 4
+#define CONNECT_DELAY_US   20000
+
+typedef struct {
+    const char * name;
+    mock_controller_config_t config;
+} transport_profile_t;
+
+static const transport_profile_t transport_profiles[] = {
+    // name            credits  to ctrl  to host  per byte  processing
+    { "USB",          {   4,      500,    1000,      0,       100 } },
+    { "UART 1 Mbit",  {   4,      100,     100,     10,       100 } },
+    { "UART 115200",  {   4,      100,     100,     87,       100 } },
+};
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static uint32_t stack_working_us;
+static uint32_t connected_us;
+static hci_con_handle_t le_con_handle;
+
+static void bonded_device_address(int index, bd_addr_t address){
+    bd_addr_t base = { 0xC0, 0x11, 0x22, 0x33, 0x44, 0x00 };
+    bd_addr_copy(address, base);
+    address[5] = (uint8_t) index;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case BTSTACK_EVENT_STATE:
+            if (btstack_event_state_get_state(packet) != HCI_STATE_WORKING) break;
+            stack_working_us = mock_controller_get_time_us();
+            break;
+        case HCI_EVENT_LE_META:
+            if (hci_event_le_meta_get_subevent_code(packet) != HCI_SUBEVENT_LE_CONNECTION_COMPLETE) break;
+            if (hci_subevent_le_connection_complete_get_status(packet) != ERROR_CODE_SUCCESS) break;
+            connected_us = mock_controller_get_time_us();
+            le_con_handle = hci_subevent_le_connection_complete_get_connection_handle(packet);
+            gap_le_set_phy(le_con_handle, 0, 2, 2, 0);
+            gap_update_connection_parameters(le_con_handle, 12, 12, 0, 500);
+            gap_read_rssi(le_con_handle);
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            gap_connect_with_whitelist();
+            break;
+        default:
+            break;
+    }
+}
+
+static void stack_configure(void){
+    static uint8_t adv_data[] = { 0x02, BLUETOOTH_DATA_TYPE_FLAGS, 0x06 };
+    bd_addr_t null_addr;
+    memset(null_addr, 0, sizeof(null_addr));
+    gap_set_local_name("HCI Test 00:00:00:00:00:00");
+    gap_set_class_of_device(0x200404);
+    gap_set_default_link_policy_settings(LM_LINK_POLICY_ENABLE_ROLE_SWITCH | LM_LINK_POLICY_ENABLE_SNIFF_MODE);
+    gap_discoverable_control(1);
+    gap_connectable_control(1);
+    hci_le_advertisements_set_params(0x0030, 0x0030, 0, 0, null_addr, 0x07, 0);
+    gap_advertisements_set_data(sizeof(adv_data), adv_data);
+    gap_scan_response_set_data(sizeof(adv_data), adv_data);
+    gap_advertisements_enable(1);
+
+    sm_key_t irk;
+    memset(irk, 0x55, sizeof(irk));
+    int i;
+    for (i = 0; i < NUM_BONDED_DEVICES; i++){
+        bd_addr_t address;
+        bonded_device_address(i, address);
+        le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, address, irk);
+    }
+}
+
+static void simulate(const transport_profile_t * profile){
+    btstack_memory_init();
+    btstack_run_loop_init(mock_run_loop_get_instance());
+    mock_controller_init(&profile->config);
+    hci_init(mock_controller_get_transport(), NULL);
+    le_device_db_init();
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+    stack_working_us = 0;
+    connected_us = 0;
+
+    // power up with application config and bonded devices
+    stack_configure();
+    hci_power_control(HCI_POWER_ON);
+    mock_controller_run();
+    uint32_t idle_us = mock_controller_get_time_us();
+    uint16_t init_commands = mock_controller_num_commands();
+
+    // connect to bonded device, then measure reconnect after remote disconnect
+    bd_addr_t address;
+    bonded_device_address(1, address);
+    mock_controller_set_le_peer(BD_ADDR_TYPE_LE_PUBLIC, address, CONNECT_DELAY_US);
+    int i;
+    for (i = 0; i < NUM_BONDED_DEVICES; i++){
+        bonded_device_address(i, address);
+        gap_auto_connection_start(BD_ADDR_TYPE_LE_PUBLIC, address);
+    }
+    mock_controller_run();
+    uint32_t disconnect_us = mock_controller_get_time_us();
+    mock_controller_disconnect(le_con_handle);
+    mock_controller_run();
+    // reconnect time without the simulated connection establishment of the remote
+    uint32_t reconnect_us = mock_controller_get_time_us() - disconnect_us - CONNECT_DELAY_US;
+
+    printf("  %-12s working %6u us, idle %6u us (%3u commands), reconnect setup %5u us, max %u in flight\n",
+           profile->name, (unsigned int) stack_working_us, (unsigned int) idle_us, init_commands,
+           (unsigned int) reconnect_us, mock_controller_max_commands_in_flight());
+
+    hci_deinit();
+    btstack_memory_deinit();
+    btstack_run_loop_deinit();
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    printf("HCI commands in flight: max %u\n", HCI_MAX_OUTSTANDING_COMMANDS);
+    unsigned int i;
+    for (i=0;i<sizeof(transport_profiles)/sizeof(transport_profile_t);i++){
+        simulate(&transport_profiles[i]);
+    }
+    return 0;
+}
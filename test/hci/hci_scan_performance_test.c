@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// LE Scan performance test
+//
+// Replays the LE Advertising Reports of a pklg scan capture through HCI and
+// compares per-report GAP_EVENT_ADVERTISING_REPORT delivery to several event
+// handlers with GAP_EVENT_ADVERTISING_REPORT_BATCH delivery to a single
+// handler, with and without in-stack scan filters.
+//
+// pklg/scan.pklg: 3 seconds, 120 advertisers (beacons, connectable devices
+// with scan response, devices with changing manufacturer data)
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/le_device_db.h"
+#include "gap.h"
+#include "hci.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define PACKET_TYPE_HCI_EVENT   0x01
+#define NUM_ITERATIONS          200
+#define NUM_EVENT_HANDLERS      4
+
+typedef struct {
+    uint32_t  time_us;
+    uint16_t  len;
+    uint8_t * packet;
+} replay_event_t;
+
+typedef struct {
+    const char * name;
+    bool         batch;
+    int8_t       rssi_threshold;
+    uint16_t     uuid16;
+    uint16_t     duplicate_window_ms;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    // name                          batch  rssi   uuid16  duplicates
+    { "per-report",                  false, -128,  0,         0 },
+    { "batch",                       true,  -128,  0,         0 },
+    { "per-report, RSSI + dup 1s",   false,  -70,  0,      1000 },
+    { "batch, RSSI + dup 1s",        true,   -70,  0,      1000 },
+    { "batch, UUID 0x180D",          true,  -128,  0x180D,    0 },
+};
+
+static const mock_controller_config_t controller_usb = {
+    4,      // num_cmd_packets
+    500,    // latency_host_to_controller_us
+    1000,   // latency_controller_to_host_us
+    0,      // byte_time_us
+    100,    // processing_us
+};
+
+static replay_event_t * replay_events;
+static uint32_t replay_events_num;
+static uint32_t replay_events_size;
+static uint32_t replay_reports_num;
+static uint32_t replay_duration_us;
+
+static btstack_packet_callback_registration_t hci_event_callback_registrations[NUM_EVENT_HANDLERS];
+static uint32_t handler_calls;
+static uint32_t reports_delivered;
+
+static void show_usage(void){
+    printf("\n\nUsage: ./hci_scan_performance_test input_file\n");
+    printf("Example: ./hci_scan_performance_test pklg/scan\n");
+}
+
+static ssize_t __read(int fd, void *buf, size_t count){
+    ssize_t len, pos = 0;
+
+    while (count > 0) {
+        len = read(fd, (int8_t * )buf + pos, count);
+        if (len <= 0)
+            return pos;
+
+        count -= len;
+        pos   += len;
+    }
+    return pos;
+}
+
+static int load_advertising_reports(const char * pklg_path){
+    int oflags = O_RDONLY;
+#ifdef _WIN32
+    oflags |= O_BINARY;
+#endif
+    int fd = open(pklg_path, oflags);
+    if (fd < 0) {
+        printf("Can't open file %s\n", pklg_path);
+        return -1;
+    }
+
+    uint32_t start_us = 0;
+    replay_events_num = 0;
+    replay_reports_num = 0;
+    while (1){
+        uint8_t header[13];
+        int bytes_read = __read(fd, header, sizeof(header));
+        if (0 >= bytes_read) break;
+
+        uint32_t size = big_endian_read_32(header, 0);
+        // auto-detect endianess of size param
+        if (size >0xffff){
+            size = little_endian_read_32(header, 0);
+        }
+        // subtract header
+        size -= 9;
+
+        uint8_t packet[260];
+        if (size > sizeof(packet)){
+            printf("Error: size %u\n", size);
+            break;
+        }
+        __read(fd, packet, size);
+        if (header[12] != PACKET_TYPE_HCI_EVENT) continue;
+        if (size < 4) continue;
+        if (packet[0] != HCI_EVENT_LE_META) continue;
+        if (packet[2] != HCI_SUBEVENT_LE_ADVERTISING_REPORT) continue;
+
+        uint32_t time_us = big_endian_read_32(header, 4) * 1000000 + big_endian_read_32(header, 8);
+        if (replay_events_num == 0){
+            start_us = time_us;
+        }
+        if (replay_events_num == replay_events_size){
+            replay_events_size = (replay_events_size + 1) * 2;
+            replay_events = (replay_event_t *) realloc(replay_events, replay_events_size * sizeof(replay_event_t));
+        }
+        replay_event_t * event = &replay_events[replay_events_num++];
+        event->time_us = time_us - start_us;
+        event->len = (uint16_t) size;
+        event->packet = (uint8_t *) malloc(size);
+        memcpy(event->packet, packet, size);
+        replay_reports_num += packet[3];
+        replay_duration_us = event->time_us;
+    }
+    close(fd);
+    return 0;
+}
+
+static void count_reports(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != GAP_EVENT_ADVERTISING_REPORT) return;
+    handler_calls++;
+}
+
+static void count_batch_reports(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != GAP_EVENT_ADVERTISING_REPORT_BATCH) return;
+    handler_calls++;
+    gap_advertising_report_iterator_t it;
+    for (gap_advertising_report_iterator_init(&it, packet, size); gap_advertising_report_iterator_has_more(&it); gap_advertising_report_iterator_next(&it)){
+        reports_delivered++;
+    }
+}
+
+static void benchmark(const scenario_t * scenario){
+    btstack_memory_init();
+    btstack_run_loop_init(mock_run_loop_get_instance());
+    mock_controller_init(&controller_usb);
+    hci_init(mock_controller_get_transport(), NULL);
+    le_device_db_init();
+    // typical application: app, GATT Client, SM, and profile listen for HCI events
+    int i;
+    for (i = 0; i < NUM_EVENT_HANDLERS; i++){
+        hci_event_callback_registrations[i].callback = &count_reports;
+        hci_add_event_handler(&hci_event_callback_registrations[i]);
+    }
+    if (scenario->batch){
+        gap_scan_register_batch_handler(&count_batch_reports);
+    }
+    gap_scan_filter_set_rssi_threshold(scenario->rssi_threshold);
+    gap_scan_filter_set_service_uuid16(scenario->uuid16);
+    gap_scan_filter_set_duplicate_window(scenario->duplicate_window_ms);
+
+    hci_power_control(HCI_POWER_ON);
+    gap_start_scan();
+    mock_controller_run();
+
+    handler_calls = 0;
+    reports_delivered = 0;
+    uint32_t base_us = mock_controller_get_time_us();
+    uint32_t start_us = perf_timer_get_time_us();
+    int iteration;
+    for (iteration = 0; iteration < NUM_ITERATIONS; iteration++){
+        uint32_t j;
+        for (j = 0; j < replay_events_num; j++){
+            mock_controller_deliver_event(base_us + replay_events[j].time_us, replay_events[j].packet, replay_events[j].len);
+        }
+        // next replay starts after duplicate window
+        base_us += replay_duration_us + 2000000;
+    }
+    uint32_t duration_us = perf_timer_get_time_us() - start_us;
+
+    uint32_t num_reports = replay_reports_num * NUM_ITERATIONS;
+    if (!scenario->batch){
+        // each report is delivered to all event handlers
+        reports_delivered = handler_calls / NUM_EVENT_HANDLERS;
+    }
+    printf("  %-26s %7u us, %6.3f us/report, %5u reports delivered, %5u handler calls per replay\n",
+           scenario->name, duration_us, (float) duration_us / num_reports,
+           reports_delivered / NUM_ITERATIONS, handler_calls / NUM_ITERATIONS);
+
+    hci_deinit();
+    btstack_memory_deinit();
+    btstack_run_loop_deinit();
+}
+
+int main (int argc, const char * argv[]){
+    char pklg_path[1000];
+
+    if (argc < 2){
+        show_usage();
+        return -1;
+    }
+
+    const char * filename = argv[1];
+    snprintf(pklg_path, sizeof(pklg_path), "%s.pklg", filename);
+    pklg_path[sizeof(pklg_path) - 1] = 0;
+
+    if (load_advertising_reports(pklg_path) < 0) return -1;
+    printf("%s: %u LE Advertising Report events with %u reports, %u event handlers, %u replays, %u duplicate filter entries\n",
+           pklg_path, replay_events_num, replay_reports_num, NUM_EVENT_HANDLERS, NUM_ITERATIONS, LE_SCAN_DUPLICATE_FILTER_SIZE);
+
+    unsigned int i;
+    for (i=0;i<sizeof(scenarios)/sizeof(scenario_t);i++){
+        benchmark(&scenarios[i]);
+    }
+
+    uint32_t j;
+    for (j = 0; j < replay_events_num; j++){
+        free(replay_events[j].packet);
+    }
+    free(replay_events);
+    return 0;
+}
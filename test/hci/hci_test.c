@@ -0,0 +1,1349 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_data_types.h"
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/le_device_db.h"
+#include "gap.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "mesh/adv_bearer.h"
+
+#include "mock.h"
+
+#define NUM_BONDED_DEVICES 4
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static int      stack_working;
+static uint32_t stack_working_us;
+static int      le_connections;
+static hci_con_handle_t le_con_handle;
+static int      connection_setup;
+static int      data_channel_events;
+static uint8_t  data_channel_tx_phy;
+static uint16_t data_channel_max_tx_octets;
+static int      advertising_reports;
+static int      extended_advertising_reports;
+static int      periodic_advertising_reports;
+static uint8_t  report_data_status;
+static uint16_t report_data_length;
+static uint8_t  report_data[LE_EXTENDED_ADVERTISING_DATA_SIZE];
+static int      report_fragments;
+static bool     report_complete;
+
+// collect report fragments, returns true if report is complete
+// called on Command Complete, e.g. to update data while previous data is sent in fragments
+static void (*command_complete_callback)(uint16_t opcode);
+
+static bool report_data_append(uint8_t data_status, const uint8_t * data, uint16_t data_length){
+    if (report_complete){
+        report_data_length = 0;
+    }
+    memcpy(&report_data[report_data_length], data, data_length);
+    report_data_length += data_length;
+    report_data_status = data_status;
+    report_fragments++;
+    report_complete = data_status != LE_ADVERTISING_DATA_STATUS_INCOMPLETE;
+    return report_complete;
+}
+
+static const mock_controller_config_t controller_usb = {
+    4,      // num_cmd_packets
+    500,    // latency_host_to_controller_us
+    1000,   // latency_controller_to_host_us
+    0,      // byte_time_us
+    100,    // processing_us
+};
+
+static void bonded_device_address(int index, bd_addr_t address){
+    bd_addr_t base = { 0xC0, 0x11, 0x22, 0x33, 0x44, 0x00 };
+    bd_addr_copy(address, base);
+    address[5] = (uint8_t) index;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case BTSTACK_EVENT_STATE:
+            if (btstack_event_state_get_state(packet) != HCI_STATE_WORKING) break;
+            stack_working = 1;
+            stack_working_us = mock_controller_get_time_us();
+            break;
+        case HCI_EVENT_LE_META:
+            if (hci_event_le_meta_get_subevent_code(packet) != HCI_SUBEVENT_LE_CONNECTION_COMPLETE) break;
+            if (hci_subevent_le_connection_complete_get_status(packet) != ERROR_CODE_SUCCESS) break;
+            le_connections++;
+            le_con_handle = hci_subevent_le_connection_complete_get_connection_handle(packet);
+            if (!connection_setup) break;
+            // per-connection setup: independent commands for the same connection
+            gap_le_set_phy(le_con_handle, 0, 2, 2, 0);
+            gap_update_connection_parameters(le_con_handle, 12, 12, 0, 500);
+            gap_read_rssi(le_con_handle);
+            break;
+        case GAP_EVENT_LE_DATA_CHANNEL_CHANGED:
+            data_channel_events++;
+            data_channel_tx_phy = gap_event_le_data_channel_changed_get_tx_phy(packet);
+            data_channel_max_tx_octets = gap_event_le_data_channel_changed_get_max_tx_octets(packet);
+            break;
+        case GAP_EVENT_ADVERTISING_REPORT:
+            advertising_reports++;
+            break;
+        case GAP_EVENT_EXTENDED_ADVERTISING_REPORT:
+            CHECK_EQUAL(GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE + gap_event_extended_advertising_report_get_data_length(packet), size);
+            CHECK_EQUAL(size, packet[1] + 2);
+            if (report_data_append((gap_event_extended_advertising_report_get_advertising_event_type(packet) >> 5) & 0x03,
+                                   gap_event_extended_advertising_report_get_data(packet), gap_event_extended_advertising_report_get_data_length(packet))){
+                extended_advertising_reports++;
+            }
+            break;
+        case GAP_EVENT_PERIODIC_ADVERTISING_REPORT:
+            CHECK_EQUAL(GAP_EVENT_PERIODIC_ADVERTISING_REPORT_HEADER_SIZE + gap_event_periodic_advertising_report_get_data_length(packet), size);
+            CHECK_EQUAL(size, packet[1] + 2);
+            if (report_data_append(gap_event_periodic_advertising_report_get_data_status(packet),
+                                   gap_event_periodic_advertising_report_get_data(packet), gap_event_periodic_advertising_report_get_data_length(packet))){
+                periodic_advertising_reports++;
+            }
+            break;
+        case HCI_EVENT_COMMAND_COMPLETE:
+            if (command_complete_callback == NULL) break;
+            (*command_complete_callback)(hci_event_command_complete_get_command_opcode(packet));
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            // reconnect to bonded devices
+            gap_connect_with_whitelist();
+            break;
+        default:
+            break;
+    }
+}
+
+static void stack_init(const mock_controller_config_t * config){
+    btstack_memory_init();
+    command_complete_callback = NULL;
+    btstack_run_loop_init(mock_run_loop_get_instance());
+    mock_controller_init(config);
+    hci_init(mock_controller_get_transport(), NULL);
+    le_device_db_init();
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+    stack_working = 0;
+    stack_working_us = 0;
+    le_connections = 0;
+    connection_setup = 1;
+    data_channel_events = 0;
+    data_channel_tx_phy = 0;
+    data_channel_max_tx_octets = 0;
+    advertising_reports = 0;
+    extended_advertising_reports = 0;
+    periodic_advertising_reports = 0;
+    report_data_status = 0;
+    report_data_length = 0;
+    report_fragments = 0;
+    report_complete = true;
+}
+
+static void stack_configure_app(void){
+    static uint8_t adv_data[] = { 0x02, BLUETOOTH_DATA_TYPE_FLAGS, 0x06 };
+    bd_addr_t null_addr;
+    memset(null_addr, 0, sizeof(null_addr));
+    gap_set_local_name("HCI Test 00:00:00:00:00:00");
+    gap_set_class_of_device(0x200404);
+    gap_set_default_link_policy_settings(LM_LINK_POLICY_ENABLE_ROLE_SWITCH | LM_LINK_POLICY_ENABLE_SNIFF_MODE);
+    gap_discoverable_control(1);
+    gap_connectable_control(1);
+    hci_le_advertisements_set_params(0x0030, 0x0030, 0, 0, null_addr, 0x07, 0);
+    gap_advertisements_set_data(sizeof(adv_data), adv_data);
+    gap_scan_response_set_data(sizeof(adv_data), adv_data);
+    gap_advertisements_enable(1);
+}
+
+static void stack_add_bonded_devices(void){
+    sm_key_t irk;
+    memset(irk, 0x55, sizeof(irk));
+    int i;
+    for (i = 0; i < NUM_BONDED_DEVICES; i++){
+        bd_addr_t address;
+        bonded_device_address(i, address);
+        le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, address, irk);
+    }
+}
+
+static void stack_auto_connect_bonded_devices(void){
+    int i;
+    for (i = 0; i < NUM_BONDED_DEVICES; i++){
+        bd_addr_t address;
+        bonded_device_address(i, address);
+        gap_auto_connection_start(BD_ADDR_TYPE_LE_PUBLIC, address);
+    }
+}
+
+static void stack_power_on(void){
+    hci_power_control(HCI_POWER_ON);
+    mock_controller_run();
+}
+
+static void stack_deinit(void){
+    hci_deinit();
+    btstack_memory_deinit();
+    btstack_run_loop_deinit();
+}
+
+// sorted opcodes of all commands received by the controller
+static uint16_t collect_sorted_opcodes(uint16_t * opcodes, uint16_t max_opcodes){
+    uint16_t num = btstack_min(mock_controller_num_commands(), max_opcodes);
+    uint16_t i;
+    for (i = 0; i < num; i++){
+        opcodes[i] = mock_controller_get_command_opcode(i);
+    }
+    // insertion sort
+    for (i = 1; i < num; i++){
+        uint16_t opcode = opcodes[i];
+        uint16_t j = i;
+        while ((j > 0) && (opcodes[j-1] > opcode)){
+            opcodes[j] = opcodes[j-1];
+            j--;
+        }
+        opcodes[j] = opcode;
+    }
+    return num;
+}
+
+TEST_GROUP(HCI_COMMAND_PIPELINE){
+    void setup(void){
+        stack_init(&controller_usb);
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+};
+
+TEST(HCI_COMMAND_PIPELINE, InitPipelinesIndependentCommands){
+    stack_configure_app();
+    stack_add_bonded_devices();
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    CHECK(mock_controller_max_commands_in_flight() > 1);
+    CHECK(mock_controller_max_commands_in_flight() <= HCI_MAX_OUTSTANDING_COMMANDS);
+    CHECK_EQUAL(0, mock_controller_num_queue_overflows());
+    // each init and gap command sent exactly once
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_RESET));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_SET_EVENT_MASK));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_WRITE_PAGE_TIMEOUT));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_WRITE_LE_HOST_SUPPORTED));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EVENT_MASK));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_WRITE_LOCAL_NAME));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE));
+    CHECK_EQUAL(NUM_BONDED_DEVICES, mock_controller_count_commands(HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_RESOLVING_LIST));
+}
+
+TEST(HCI_COMMAND_PIPELINE, InitSerializedWithSingleCredit){
+    mock_controller_config_t config = controller_usb;
+    config.num_cmd_packets = 1;
+    stack_deinit();
+    stack_init(&config);
+    stack_configure_app();
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    CHECK_EQUAL(1, mock_controller_max_commands_in_flight());
+    CHECK_EQUAL(0, mock_controller_num_queue_overflows());
+}
+
+TEST(HCI_COMMAND_PIPELINE, InitSendsSameCommandsAsSerialized){
+    static uint16_t opcodes_serialized[256];
+    static uint16_t opcodes_pipelined[256];
+
+    mock_controller_config_t config = controller_usb;
+    config.num_cmd_packets = 1;
+    stack_deinit();
+    stack_init(&config);
+    stack_configure_app();
+    stack_add_bonded_devices();
+    stack_power_on();
+    uint16_t num_serialized = collect_sorted_opcodes(opcodes_serialized, 256);
+    uint32_t time_serialized_us = mock_controller_get_time_us();
+    stack_deinit();
+
+    stack_init(&controller_usb);
+    stack_configure_app();
+    stack_add_bonded_devices();
+    stack_power_on();
+    uint16_t num_pipelined = collect_sorted_opcodes(opcodes_pipelined, 256);
+    uint32_t time_pipelined_us = mock_controller_get_time_us();
+
+    CHECK_EQUAL(num_serialized, num_pipelined);
+    MEMCMP_EQUAL(opcodes_serialized, opcodes_pipelined, num_serialized * sizeof(uint16_t));
+    CHECK(time_pipelined_us < time_serialized_us);
+}
+
+TEST(HCI_COMMAND_PIPELINE, InitWithOutOfOrderCompletion){
+    mock_controller_set_reverse_order(1);
+    stack_configure_app();
+    stack_add_bonded_devices();
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_RESET));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_WRITE_SCAN_ENABLE));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_SCAN_PARAMETERS));
+}
+
+TEST(HCI_COMMAND_PIPELINE, WhitelistUpdatesPipelined){
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    uint16_t commands_before = mock_controller_num_commands();
+    stack_auto_connect_bonded_devices();
+    mock_controller_run();
+    CHECK_EQUAL(NUM_BONDED_DEVICES, mock_controller_count_commands(HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST));
+    CHECK(mock_controller_count_commands(HCI_OPCODE_HCI_LE_CREATE_CONNECTION) >= 1);
+    CHECK(mock_controller_num_commands() > commands_before);
+    CHECK_EQUAL(0, mock_controller_num_queue_overflows());
+}
+
+TEST(HCI_COMMAND_PIPELINE, ReconnectSetupCommands){
+    bd_addr_t address;
+    bonded_device_address(1, address);
+    stack_add_bonded_devices();
+    stack_power_on();
+    mock_controller_set_le_peer(BD_ADDR_TYPE_LE_PUBLIC, address, 20000);
+    stack_auto_connect_bonded_devices();
+    mock_controller_run();
+    CHECK_EQUAL(1, le_connections);
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_CONNECTION_UPDATE));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_READ_RSSI));
+
+    // remote disconnects, LE Create Connection with whitelist reconnects
+    mock_controller_disconnect(le_con_handle);
+    mock_controller_run();
+    CHECK_EQUAL(2, le_connections);
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_CONNECTION_UPDATE));
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_READ_RSSI));
+    CHECK_EQUAL(0, mock_controller_num_queue_overflows());
+}
+
+TEST_GROUP(HCI_LE_DATA_CHANNEL){
+    void setup(void){
+        stack_init(&controller_usb);
+        connection_setup = 0;
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+    void connect(void){
+        bd_addr_t address;
+        bonded_device_address(1, address);
+        stack_power_on();
+        mock_controller_set_le_peer(BD_ADDR_TYPE_LE_PUBLIC, address, 20000);
+        gap_auto_connection_start(BD_ADDR_TYPE_LE_PUBLIC, address);
+        mock_controller_run();
+        CHECK_EQUAL(1, le_connections);
+    }
+    void check_data_channel(uint8_t expected_phy, uint16_t expected_max_tx_octets, uint16_t expected_max_rx_octets){
+        uint8_t  tx_phy;
+        uint8_t  rx_phy;
+        uint16_t max_tx_octets;
+        uint16_t max_rx_octets;
+        uint8_t status = gap_le_get_data_channel(le_con_handle, &tx_phy, &rx_phy, &max_tx_octets, &max_rx_octets);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_EQUAL(expected_phy, tx_phy);
+        CHECK_EQUAL(expected_phy, rx_phy);
+        CHECK_EQUAL(expected_max_tx_octets, max_tx_octets);
+        CHECK_EQUAL(expected_max_rx_octets, max_rx_octets);
+    }
+};
+
+TEST(HCI_LE_DATA_CHANNEL, NoPolicy){
+    connect();
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_DATA_LENGTH));
+    CHECK_EQUAL(0, data_channel_events);
+    check_data_channel(1, 27, 27);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, Policy2MAndDataLength){
+    gap_le_set_throughput_policy(true, 2);
+    connect();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_DATA_LENGTH));
+    CHECK_EQUAL(2, data_channel_events);
+    CHECK_EQUAL(2, data_channel_tx_phy);
+    CHECK_EQUAL(251, data_channel_max_tx_octets);
+    check_data_channel(2, 251, 251);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, PolicyDataLengthOnly){
+    gap_le_set_throughput_policy(true, 0);
+    connect();
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_DATA_LENGTH));
+    CHECK_EQUAL(1, data_channel_events);
+    check_data_channel(1, 251, 251);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, ControllerWithout2M){
+    mock_controller_set_le_data_channel(1, 3, 251);
+    gap_le_set_throughput_policy(true, 2);
+    connect();
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    check_data_channel(1, 251, 251);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, PeerWithout2M){
+    mock_controller_set_le_data_channel(3, 1, 251);
+    gap_le_set_throughput_policy(true, 2);
+    connect();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    // PHY Update Complete without change is not reported
+    CHECK_EQUAL(1, data_channel_events);
+    check_data_channel(1, 251, 251);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, PeerLimitsDataLength){
+    mock_controller_set_le_data_channel(3, 3, 100);
+    gap_le_set_throughput_policy(true, 2);
+    connect();
+    CHECK_EQUAL(100, data_channel_max_tx_octets);
+    check_data_channel(2, 100, 100);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, PolicyOnReconnect){
+    gap_le_set_throughput_policy(true, 2);
+    connect();
+    mock_controller_disconnect(le_con_handle);
+    mock_controller_run();
+    CHECK_EQUAL(2, le_connections);
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PHY));
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_DATA_LENGTH));
+    check_data_channel(2, 251, 251);
+}
+
+TEST(HCI_LE_DATA_CHANNEL, SetDataLength){
+    connect();
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, gap_le_set_data_length(le_con_handle, 26, 2120));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, gap_le_set_data_length(le_con_handle, 252, 2120));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, gap_le_set_data_length(le_con_handle, 251, 100));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, gap_le_set_data_length(HCI_CON_HANDLE_INVALID, 251, 2120));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_le_set_data_length(le_con_handle, 120, 1072));
+    mock_controller_run();
+    check_data_channel(1, 120, 251);
+}
+
+TEST_GROUP(HCI_LE_EXTENDED_ADVERTISING){
+    uint8_t data[LE_EXTENDED_ADVERTISING_DATA_SIZE];
+    le_advertising_set_t advertising_set;
+    le_extended_advertising_parameters_t params;
+    void setup(void){
+        stack_init(&controller_usb);
+        connection_setup = 0;
+        mock_controller_set_le_extended_advertising(1);
+        int i;
+        for (i = 0; i < LE_EXTENDED_ADVERTISING_DATA_SIZE; i++){
+            data[i] = (uint8_t) i;
+        }
+        memset(&params, 0, sizeof(params));
+        params.advertising_event_properties = LE_ADVERTISING_PROPERTIES_CONNECTABLE;
+        params.primary_advertising_interval_min = 0x0030;
+        params.primary_advertising_interval_max = 0x0030;
+        params.primary_advertising_channel_map = 0x07;
+        params.primary_advertising_phy = 1;
+        params.secondary_advertising_phy = 2;
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+    // check LE Set Extended Advertising Data commands for advertising handle and return reassembled data
+    void collect_advertising_data(uint8_t advertising_handle, uint8_t * buffer, uint16_t * buffer_len){
+        collect_data(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA, advertising_handle, buffer, buffer_len);
+    }
+    // Command Complete for each fragment before next one is sent
+    void use_single_command_credit(void){
+        mock_controller_config_t config = controller_usb;
+        config.num_cmd_packets = 1;
+        stack_deinit();
+        stack_init(&config);
+        mock_controller_set_le_extended_advertising(1);
+    }
+    void collect_data(uint16_t opcode, uint8_t advertising_handle, uint8_t * buffer, uint16_t * buffer_len){
+        uint16_t len = 0;
+        *buffer_len = 0;
+        int fragments = 0;
+        uint16_t i;
+        for (i = 0; i < mock_controller_num_commands(); i++){
+            if (mock_controller_get_command_opcode(i) != opcode) continue;
+            const uint8_t * command = mock_controller_get_command(i);
+            if (command[3] != advertising_handle) continue;
+            // operation: first fragment, intermediate, last fragment, complete
+            uint8_t operation = command[4];
+            CHECK_EQUAL(fragments == 0 ? 1 : 0, (operation == 1) || (operation == 3) ? 1 : 0);
+            CHECK(command[6] <= 251);
+            memcpy(&buffer[len], &command[7], command[6]);
+            len += command[6];
+            fragments++;
+            if ((operation == 2) || (operation == 3)) fragments = 0;
+        }
+        *buffer_len = len;
+    }
+    void start_scanning(void){
+        stack_power_on();
+        gap_start_scan();
+        mock_controller_run();
+    }
+    void send_extended_advertising_report(uint8_t data_status, uint8_t sid, uint16_t offset, uint8_t len){
+        uint8_t event[2 + 255];
+        memset(event, 0, sizeof(event));
+        event[0] = HCI_EVENT_LE_META;
+        event[1] = 26 + len;
+        event[2] = HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT;
+        event[3] = 1;
+        little_endian_store_16(event, 4, (uint16_t) (LE_ADVERTISING_PROPERTIES_SCANNABLE | (data_status << 5)));
+        event[6] = BD_ADDR_TYPE_LE_PUBLIC;
+        memset(&event[7], 0x33, 6);
+        event[13] = 1;
+        event[14] = 2;
+        event[15] = sid;
+        event[16] = 0x7f;
+        event[17] = (uint8_t) -60;
+        event[27] = len;
+        memcpy(&event[28], &data[offset], len);
+        mock_controller_send_event(event, 28 + len);
+    }
+    void send_periodic_advertising_report(uint16_t sync_handle, uint8_t data_status, uint16_t offset, uint8_t len){
+        uint8_t event[2 + 255];
+        event[0] = HCI_EVENT_LE_META;
+        event[1] = 8 + len;
+        event[2] = HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_REPORT;
+        little_endian_store_16(event, 3, sync_handle);
+        event[5] = 0x7f;
+        event[6] = (uint8_t) -60;
+        event[7] = 0xff;
+        event[8] = data_status;
+        event[9] = len;
+        memcpy(&event[10], &data[offset], len);
+        mock_controller_send_event(event, 10 + len);
+    }
+};
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, LegacyCommandsWithoutControllerSupport){
+    mock_controller_set_le_extended_advertising(0);
+    stack_configure_app();
+    start_scanning();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE));
+    CHECK(mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_SCAN_ENABLE) >= 1);
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_ENABLE));
+    CHECK_EQUAL(ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE, gap_extended_advertising_setup(&advertising_set, &params, &advertising_set.advertising_handle));
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, LegacyApiMappedToHandle0){
+    stack_configure_app();
+    start_scanning();
+    CHECK_EQUAL(1, stack_working);
+    // controllers reject legacy commands after extended commands
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_SCAN_PARAMETERS));
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_SCAN_ENABLE));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_RESPONSE_DATA));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+    CHECK(mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_PARAMETERS) >= 1);
+    CHECK(mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_ENABLE) >= 1);
+    uint8_t buffer[LE_EXTENDED_ADVERTISING_DATA_SIZE];
+    uint16_t len;
+    collect_advertising_data(0, buffer, &len);
+    CHECK_EQUAL(3, len);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, AdvertisingSetWithFragmentedData){
+    uint8_t advertising_handle;
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &advertising_handle));
+    CHECK_EQUAL(1, advertising_handle);
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, gap_extended_advertising_set_adv_data(advertising_handle, LE_EXTENDED_ADVERTISING_DATA_SIZE + 1, data));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(advertising_handle, sizeof(data), data));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(advertising_handle, 0, 0));
+    mock_controller_run();
+    // 6 x 251 + 144 bytes
+    CHECK_EQUAL(7, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA));
+    uint8_t buffer[LE_EXTENDED_ADVERTISING_DATA_SIZE];
+    uint16_t len;
+    collect_advertising_data(advertising_handle, buffer, &len);
+    CHECK_EQUAL(sizeof(data), len);
+    MEMCMP_EQUAL(data, buffer, sizeof(data));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+    // enabled after data was set
+    uint16_t last = mock_controller_num_commands() - 1u;
+    CHECK_EQUAL(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE, mock_controller_get_command_opcode(last));
+    const uint8_t * enable = mock_controller_get_command(last);
+    CHECK_EQUAL(1, enable[3]);
+    CHECK_EQUAL(advertising_handle, enable[5]);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, AdvertisingSetUpdateDataWhileActive){
+    uint8_t advertising_handle;
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(advertising_handle, 31, data));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(advertising_handle, 0, 0));
+    mock_controller_run();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+    // single fragment is updated while advertising
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(advertising_handle, 100, data));
+    mock_controller_run();
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+    // fragmented data requires advertising set to be disabled
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(advertising_handle, 300, data));
+    mock_controller_run();
+    CHECK_EQUAL(4, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA));
+    CHECK_EQUAL(3, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+}
+
+static uint8_t  update_advertising_handle;
+static uint16_t update_opcode;
+static uint16_t update_count;
+static uint8_t  update_data[100];
+static uint16_t update_data_len;
+
+// set advertising data after first fragment of update_opcode was sent
+static void update_advertising_data(uint16_t opcode){
+    if (opcode != update_opcode) return;
+    update_count++;
+    if (update_count != 1) return;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(update_advertising_handle, update_data_len, update_data));
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, AdvertisingSetUpdateDataDuringFragmentation){
+    use_single_command_credit();
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &update_advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(update_advertising_handle, 600, data));
+    memset(update_data, 0x55, sizeof(update_data));
+    update_data_len = sizeof(update_data);
+    update_opcode = HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA;
+    update_count = 0;
+    command_complete_callback = &update_advertising_data;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(update_advertising_handle, 0, 0));
+    mock_controller_run();
+
+    // shorter data restarts with a complete fragment
+    uint16_t operations[4];
+    uint16_t num_operations = 0;
+    uint16_t i;
+    for (i = 0; i < mock_controller_num_commands(); i++){
+        if (mock_controller_get_command_opcode(i) != HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA) continue;
+        const uint8_t * command = mock_controller_get_command(i);
+        CHECK(num_operations < 4);
+        operations[num_operations++] = command[4];
+        if (command[4] != 3) continue;
+        CHECK_EQUAL(sizeof(update_data), command[6]);
+        MEMCMP_EQUAL(update_data, &command[7], sizeof(update_data));
+    }
+    CHECK_EQUAL(2, num_operations);
+    CHECK_EQUAL(1, operations[0]);
+    CHECK_EQUAL(3, operations[1]);
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, AdvertisingSetUpdateDataDuringScanResponseFragmentation){
+    use_single_command_credit();
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &update_advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_adv_data(update_advertising_handle, 31, data));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_set_scan_response_data(update_advertising_handle, 600, data));
+    memset(update_data, 0x55, sizeof(update_data));
+    update_data_len = 31;
+    update_opcode = HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_RESPONSE_DATA;
+    update_count = 0;
+    command_complete_callback = &update_advertising_data;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(update_advertising_handle, 0, 0));
+    mock_controller_run();
+
+    // scan response data continues at its own offset
+    uint8_t buffer[LE_EXTENDED_ADVERTISING_DATA_SIZE];
+    uint16_t len;
+    collect_data(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_RESPONSE_DATA, update_advertising_handle, buffer, &len);
+    CHECK_EQUAL(600, len);
+    MEMCMP_EQUAL(data, buffer, 600);
+    CHECK_EQUAL(3, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_SCAN_RESPONSE_DATA));
+    // advertising data sent as complete data both times
+    collect_advertising_data(update_advertising_handle, buffer, &len);
+    CHECK_EQUAL(62, len);
+    MEMCMP_EQUAL(data, buffer, 31);
+    MEMCMP_EQUAL(update_data, &buffer[31], 31);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, AdvertisingSetRemove){
+    uint8_t advertising_handle;
+    le_extended_advertising_parameters_t read_params;
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_get_params(advertising_handle, &read_params));
+    MEMCMP_EQUAL(&params, &read_params, sizeof(params));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(advertising_handle, 0, 0));
+    mock_controller_run();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_remove(advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_ADVERTISING_IDENTIFIER, gap_extended_advertising_start(advertising_handle, 0, 0));
+    mock_controller_run();
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_REMOVE_ADVERTISING_SET));
+    // handle can be reused
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &advertising_handle));
+    CHECK_EQUAL(1, advertising_handle);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, PeriodicAdvertising){
+    uint8_t advertising_handle;
+    le_periodic_advertising_parameters_t periodic_params = { 0x0050, 0x0060, 0 };
+    params.advertising_event_properties = 0;
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_setup(&advertising_set, &params, &advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, gap_periodic_advertising_start(advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_set_params(advertising_handle, &periodic_params));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_set_data(advertising_handle, 600, data));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_start(advertising_handle));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_extended_advertising_start(advertising_handle, 0, 0));
+    mock_controller_run();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_PARAMETERS));
+    // 2 x 252 + 96 bytes
+    CHECK_EQUAL(3, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_DATA));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_PERIODIC_ADVERTISING_ENABLE));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, ReportReassembly){
+    start_scanning();
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_INCOMPLETE, 1,   0, 229);
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_INCOMPLETE, 1, 229, 229);
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_COMPLETE,   1, 458, 100);
+    mock_controller_run();
+    CHECK_EQUAL(1, extended_advertising_reports);
+    // 230 + 230 + 98 bytes
+    CHECK_EQUAL(3, report_fragments);
+    CHECK_EQUAL(LE_ADVERTISING_DATA_STATUS_COMPLETE, report_data_status);
+    CHECK_EQUAL(558, report_data_length);
+    MEMCMP_EQUAL(data, report_data, 558);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, ReportInterleavedIsTruncated){
+    start_scanning();
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_INCOMPLETE, 1,   0, 229);
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_COMPLETE,   2,   0,  20);
+    mock_controller_run();
+    CHECK_EQUAL(2, extended_advertising_reports);
+    CHECK_EQUAL(LE_ADVERTISING_DATA_STATUS_COMPLETE, report_data_status);
+    CHECK_EQUAL(20, report_data_length);
+    // controller truncated data
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_INCOMPLETE, 1,   0, 229);
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_TRUNCATED,  1, 229,  10);
+    mock_controller_run();
+    CHECK_EQUAL(3, extended_advertising_reports);
+    CHECK_EQUAL(LE_ADVERTISING_DATA_STATUS_TRUNCATED, report_data_status);
+    CHECK_EQUAL(239, report_data_length);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, ReportNotScanning){
+    stack_power_on();
+    send_extended_advertising_report(LE_ADVERTISING_DATA_STATUS_COMPLETE, 1, 0, 20);
+    mock_controller_run();
+    CHECK_EQUAL(0, extended_advertising_reports);
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, PeriodicReportReassembly){
+    bd_addr_t address;
+    memset(address, 0x33, sizeof(address));
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_create_sync(0, 1, BD_ADDR_TYPE_LE_PUBLIC, address, 0, 100, 0));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, gap_periodic_advertising_create_sync(0, 1, BD_ADDR_TYPE_LE_PUBLIC, address, 0, 100, 0));
+    mock_controller_run();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_CREATE_SYNC));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_create_sync_cancel());
+    mock_controller_run();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_CREATE_SYNC_CANCEL));
+
+    send_periodic_advertising_report(0x0001, LE_ADVERTISING_DATA_STATUS_INCOMPLETE,   0, 247);
+    send_periodic_advertising_report(0x0001, LE_ADVERTISING_DATA_STATUS_COMPLETE,   247, 100);
+    mock_controller_run();
+    CHECK_EQUAL(1, periodic_advertising_reports);
+    // 247 + 100 bytes
+    CHECK_EQUAL(2, report_fragments);
+    CHECK_EQUAL(LE_ADVERTISING_DATA_STATUS_COMPLETE, report_data_status);
+    CHECK_EQUAL(347, report_data_length);
+    MEMCMP_EQUAL(data, report_data, 347);
+
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_periodic_advertising_terminate_sync(0x0001));
+    mock_controller_run();
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_TERMINATE_SYNC));
+}
+
+TEST(HCI_LE_EXTENDED_ADVERTISING, ExtendedCreateConnection){
+    bd_addr_t address;
+    bonded_device_address(1, address);
+    stack_power_on();
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, gap_set_connection_phys(2));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_set_connection_phys(3));
+    mock_controller_set_le_peer(BD_ADDR_TYPE_LE_PUBLIC, address, 20000);
+    gap_auto_connection_start(BD_ADDR_TYPE_LE_PUBLIC, address);
+    mock_controller_run();
+    CHECK_EQUAL(1, le_connections);
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_CREATE_CONNECTION));
+    CHECK_EQUAL(1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_EXTENDED_CREATE_CONNECTION));
+}
+
+static int     batch_events;
+static int     batch_reports;
+static int8_t  batch_rssi[4];
+static int     batch_extended_reports;
+
+static void batch_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) == GAP_EVENT_EXTENDED_ADVERTISING_REPORT){
+        CHECK_EQUAL(GAP_EVENT_EXTENDED_ADVERTISING_REPORT_HEADER_SIZE + gap_event_extended_advertising_report_get_data_length(packet), size);
+        batch_extended_reports++;
+        return;
+    }
+    if (hci_event_packet_get_type(packet) != GAP_EVENT_ADVERTISING_REPORT_BATCH) return;
+    batch_events++;
+    CHECK_EQUAL(size, packet[1] + 2);
+    int num_reports = 0;
+    gap_advertising_report_iterator_t it;
+    for (gap_advertising_report_iterator_init(&it, packet, size); gap_advertising_report_iterator_has_more(&it); gap_advertising_report_iterator_next(&it)){
+        CHECK_EQUAL(0x02, gap_advertising_report_iterator_get_data_length(&it));
+        CHECK_EQUAL(BD_ADDR_TYPE_LE_RANDOM, gap_advertising_report_iterator_get_address_type(&it));
+        if (num_reports < 4){
+            batch_rssi[num_reports] = gap_advertising_report_iterator_get_rssi(&it);
+        }
+        num_reports++;
+    }
+    CHECK_EQUAL(gap_event_advertising_report_batch_get_num_reports(packet), num_reports);
+    batch_reports += num_reports;
+}
+
+TEST_GROUP(HCI_SCAN_FILTER){
+    uint8_t event[2 + 255];
+    uint16_t event_len;
+    void setup(void){
+        stack_init(&controller_usb);
+        batch_events = 0;
+        batch_reports = 0;
+        batch_extended_reports = 0;
+        memset(batch_rssi, 0, sizeof(batch_rssi));
+        stack_power_on();
+        gap_start_scan();
+        mock_controller_run();
+        start_event();
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+    void start_event(void){
+        event[0] = HCI_EVENT_LE_META;
+        event[2] = HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+        event[3] = 0;
+        event_len = 4;
+    }
+    // random address 00:00:00:00:00:<index>, AD data is either flags or given 16-bit Service UUID
+    void add_report(uint8_t index, int8_t rssi, uint16_t uuid16){
+        uint8_t * report = &event[event_len];
+        report[0] = 0;  // ADV_IND
+        report[1] = BD_ADDR_TYPE_LE_RANDOM;
+        memset(&report[2], 0, 6);
+        report[2] = index;
+        if (uuid16 != 0){
+            report[8] = 4;
+            report[9] = 3;
+            report[10] = BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS;
+            little_endian_store_16(report, 11, uuid16);
+            report[13] = (uint8_t) rssi;
+            event_len += 14;
+        } else {
+            report[8] = 2;
+            report[9] = 1;
+            report[10] = BLUETOOTH_DATA_TYPE_FLAGS;
+            report[11] = (uint8_t) rssi;
+            event_len += 12;
+        }
+        event[3]++;
+    }
+    // report in LE Extended Advertising Report, random address 00:00:00:00:00:<index>, AD data is empty flags
+    void add_extended_report(uint8_t index, int8_t rssi, bool legacy){
+        uint8_t * report = &event[event_len];
+        memset(report, 0, 24);
+        little_endian_store_16(report, 0, legacy ? (LE_ADVERTISING_PROPERTIES_LEGACY | LE_ADVERTISING_PROPERTIES_CONNECTABLE | LE_ADVERTISING_PROPERTIES_SCANNABLE) : 0);
+        report[2] = BD_ADDR_TYPE_LE_RANDOM;
+        report[3] = index;
+        report[9] = 1;
+        report[12] = 0x7f;
+        report[13] = (uint8_t) rssi;
+        report[23] = 2;
+        report[24] = 1;
+        report[25] = BLUETOOTH_DATA_TYPE_FLAGS;
+        event_len += 26;
+        event[2] = HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT;
+        event[3]++;
+    }
+    void add_report_uuid128(uint8_t index, const uint8_t * uuid128){
+        uint8_t * report = &event[event_len];
+        report[0] = 0;  // ADV_IND
+        report[1] = BD_ADDR_TYPE_LE_RANDOM;
+        memset(&report[2], 0, 6);
+        report[2] = index;
+        report[8] = 18;
+        report[9] = 17;
+        report[10] = BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_128_BIT_SERVICE_CLASS_UUIDS;
+        reverse_128(uuid128, &report[11]);
+        report[27] = (uint8_t) -50;
+        event_len += 28;
+        event[3]++;
+    }
+    void send_event(uint32_t time_us){
+        event[1] = (uint8_t) (event_len - 2);
+        mock_controller_deliver_event(time_us, event, event_len);
+        start_event();
+    }
+};
+
+TEST(HCI_SCAN_FILTER, NoFilter){
+    add_report(1, -50, 0);
+    add_report(2, -90, 0);
+    send_event(0);
+    CHECK_EQUAL(2, advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, BatchWithRssiThreshold){
+    gap_scan_register_batch_handler(&batch_handler);
+    gap_scan_filter_set_rssi_threshold(-70);
+    add_report(1, -50, 0);
+    add_report(2, -90, 0);
+    add_report(3, -60, 0);
+    send_event(0);
+    CHECK_EQUAL(1, batch_events);
+    CHECK_EQUAL(2, batch_reports);
+    CHECK_EQUAL(-50, batch_rssi[0]);
+    CHECK_EQUAL(-60, batch_rssi[1]);
+    // neither single reports nor HCI event are emitted
+    CHECK_EQUAL(0, advertising_reports);
+    // no event if all reports are filtered
+    add_report(2, -90, 0);
+    send_event(0);
+    CHECK_EQUAL(1, batch_events);
+    gap_scan_register_batch_handler(NULL);
+    add_report(1, -50, 0);
+    send_event(0);
+    CHECK_EQUAL(1, advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, BatchWithExtendedReports){
+    gap_scan_register_batch_handler(&batch_handler);
+    gap_scan_filter_set_rssi_threshold(-70);
+    add_extended_report(1, -50, true);
+    add_extended_report(2, -40, false);
+    add_extended_report(3, -90, true);
+    add_extended_report(4, -60, true);
+    send_event(0);
+    // legacy reports converted in place into a batch, extended advertisement delivered to batch handler
+    CHECK_EQUAL(1, batch_events);
+    CHECK_EQUAL(2, batch_reports);
+    CHECK_EQUAL(-50, batch_rssi[0]);
+    CHECK_EQUAL(-60, batch_rssi[1]);
+    CHECK_EQUAL(1, batch_extended_reports);
+    // neither single reports nor HCI event are emitted
+    CHECK_EQUAL(0, advertising_reports);
+    CHECK_EQUAL(0, extended_advertising_reports);
+    gap_scan_register_batch_handler(NULL);
+    add_extended_report(1, -50, true);
+    add_extended_report(2, -40, false);
+    send_event(0);
+    CHECK_EQUAL(1, advertising_reports);
+    CHECK_EQUAL(1, extended_advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, Addresses){
+    static gap_scan_filter_address_t addresses[2];
+    memset(addresses, 0, sizeof(addresses));
+    addresses[0].address_type = BD_ADDR_TYPE_LE_RANDOM;
+    addresses[0].address[5] = 2;
+    addresses[1].address_type = BD_ADDR_TYPE_LE_PUBLIC;
+    addresses[1].address[5] = 3;
+    gap_scan_filter_set_addresses(addresses, 2);
+    add_report(1, -50, 0);
+    add_report(2, -50, 0);
+    add_report(3, -50, 0);
+    send_event(0);
+    CHECK_EQUAL(1, advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, ServiceUuid){
+    uint8_t uuid128[16];
+    uint8_t other_uuid128[16];
+    memset(uuid128, 0x11, sizeof(uuid128));
+    memset(other_uuid128, 0x22, sizeof(other_uuid128));
+    gap_scan_filter_set_service_uuid16(0x180D);
+    add_report(1, -50, 0x180D);
+    add_report(2, -50, 0x180F);
+    add_report(3, -50, 0);
+    send_event(0);
+    CHECK_EQUAL(1, advertising_reports);
+    gap_scan_filter_set_service_uuid16(0);
+    gap_scan_filter_set_service_uuid128(uuid128);
+    add_report(1, -50, 0x180D);
+    add_report_uuid128(2, uuid128);
+    add_report_uuid128(3, other_uuid128);
+    send_event(0);
+    CHECK_EQUAL(2, advertising_reports);
+    gap_scan_filter_reset();
+    add_report(1, -50, 0x180D);
+    add_report(2, -50, 0x180F);
+    send_event(0);
+    CHECK_EQUAL(4, advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, Duplicates){
+    uint32_t now_us = mock_controller_get_time_us();
+    gap_scan_filter_set_duplicate_window(1000);
+    add_report(1, -50, 0);
+    add_report(1, -52, 0);
+    send_event(now_us);
+    CHECK_EQUAL(1, advertising_reports);
+    // same advertiser with different data
+    add_report(1, -50, 0x180D);
+    send_event(now_us + 100000);
+    CHECK_EQUAL(2, advertising_reports);
+    add_report(1, -50, 0x180D);
+    send_event(now_us + 900000);
+    CHECK_EQUAL(2, advertising_reports);
+    // window expired
+    add_report(1, -50, 0x180D);
+    send_event(now_us + 1200000);
+    CHECK_EQUAL(3, advertising_reports);
+}
+
+TEST(HCI_SCAN_FILTER, DuplicatesReplaceOldest){
+    uint32_t now_us = mock_controller_get_time_us();
+    gap_scan_filter_set_duplicate_window(10000);
+    uint8_t i;
+    for (i = 0; i < LE_SCAN_DUPLICATE_FILTER_SIZE; i++){
+        add_report(i, -50, 0);
+        send_event(now_us + i * 1000u);
+    }
+    CHECK_EQUAL(LE_SCAN_DUPLICATE_FILTER_SIZE, advertising_reports);
+    // table full, new advertiser replaces entry of advertiser 0
+    add_report(LE_SCAN_DUPLICATE_FILTER_SIZE, -50, 0);
+    add_report(1, -50, 0);
+    send_event(now_us + 100000);
+    CHECK_EQUAL(LE_SCAN_DUPLICATE_FILTER_SIZE + 1, advertising_reports);
+    add_report(0, -50, 0);
+    send_event(now_us + 100000);
+    CHECK_EQUAL(LE_SCAN_DUPLICATE_FILTER_SIZE + 2, advertising_reports);
+}
+
+// handler index and event code of events received by dispatch test handlers
+#define DISPATCH_TEST_MAX_CALLS 200
+static btstack_packet_callback_registration_t dispatch_registrations[HCI_EVENT_DISPATCH_MAX_HANDLERS + 1];
+static uint8_t  dispatch_call_handler[DISPATCH_TEST_MAX_CALLS];
+static uint8_t  dispatch_call_event[DISPATCH_TEST_MAX_CALLS];
+static uint16_t dispatch_num_calls;
+
+static void dispatch_record(uint8_t handler, const uint8_t * packet){
+    if (dispatch_num_calls >= DISPATCH_TEST_MAX_CALLS) return;
+    dispatch_call_handler[dispatch_num_calls] = handler;
+    dispatch_call_event[dispatch_num_calls] = packet[0];
+    dispatch_num_calls++;
+}
+
+static void dispatch_handler_0(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    dispatch_record(0, packet);
+}
+
+static void dispatch_handler_1(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    dispatch_record(1, packet);
+}
+
+static void dispatch_handler_2(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    dispatch_record(2, packet);
+}
+
+static uint16_t dispatch_count(uint8_t handler, uint8_t event_code){
+    uint16_t count = 0;
+    uint16_t i;
+    for (i = 0; i < dispatch_num_calls; i++){
+        if (dispatch_call_handler[i] != handler) continue;
+        if ((event_code != 0) && (dispatch_call_event[i] != event_code)) continue;
+        count++;
+    }
+    return count;
+}
+
+TEST_GROUP(HCI_EVENT_DISPATCH){
+    void setup(void){
+        stack_init(&controller_usb);
+        memset(dispatch_registrations, 0, sizeof(dispatch_registrations));
+        dispatch_num_calls = 0;
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+    void send_le_meta(uint8_t subevent_code){
+        uint8_t event[4] = { HCI_EVENT_LE_META, 2, 0, 0 };
+        event[2] = subevent_code;
+        mock_controller_deliver_event(mock_controller_get_time_us() + 1000, event, sizeof(event));
+    }
+};
+
+TEST(HCI_EVENT_DISPATCH, EventCodes){
+    const uint8_t events[] = { BTSTACK_EVENT_STATE };
+    dispatch_registrations[0].callback = &dispatch_handler_0;
+    hci_add_event_handler_for_events(&dispatch_registrations[0], events, sizeof(events), NULL, 0);
+    dispatch_registrations[1].callback = &dispatch_handler_1;
+    hci_add_event_handler(&dispatch_registrations[1]);
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    CHECK(dispatch_count(0, 0) > 0);
+    CHECK_EQUAL(dispatch_count(0, 0), dispatch_count(0, BTSTACK_EVENT_STATE));
+    CHECK_EQUAL(dispatch_count(0, 0), dispatch_count(1, BTSTACK_EVENT_STATE));
+    CHECK(dispatch_count(1, 0) > dispatch_count(1, BTSTACK_EVENT_STATE));
+}
+
+TEST(HCI_EVENT_DISPATCH, LeSubevents){
+    const uint8_t le_subevents[] = { HCI_SUBEVENT_LE_CONNECTION_COMPLETE };
+    const uint8_t events[] = { HCI_EVENT_LE_META };
+    dispatch_registrations[0].callback = &dispatch_handler_0;
+    hci_add_event_handler_for_events(&dispatch_registrations[0], NULL, 0, le_subevents, sizeof(le_subevents));
+    dispatch_registrations[1].callback = &dispatch_handler_1;
+    hci_add_event_handler_for_events(&dispatch_registrations[1], events, sizeof(events), NULL, 0);
+    stack_power_on();
+    dispatch_num_calls = 0;
+    send_le_meta(HCI_SUBEVENT_LE_DATA_LENGTH_CHANGE);
+    CHECK_EQUAL(0, dispatch_count(0, 0));
+    CHECK_EQUAL(1, dispatch_count(1, HCI_EVENT_LE_META));
+    send_le_meta(HCI_SUBEVENT_LE_CONNECTION_COMPLETE);
+    CHECK_EQUAL(1, dispatch_count(0, HCI_EVENT_LE_META));
+    CHECK_EQUAL(2, dispatch_count(1, HCI_EVENT_LE_META));
+    CHECK_EQUAL(3, dispatch_num_calls);
+}
+
+TEST(HCI_EVENT_DISPATCH, OrderAndDuplicates){
+    const uint8_t events[] = { BTSTACK_EVENT_STATE };
+    dispatch_registrations[0].callback = &dispatch_handler_0;
+    hci_add_event_handler_for_events(&dispatch_registrations[0], events, sizeof(events), NULL, 0);
+    dispatch_registrations[1].callback = &dispatch_handler_1;
+    hci_add_event_handler(&dispatch_registrations[1]);
+    // ignored
+    hci_add_event_handler(&dispatch_registrations[0]);
+    hci_add_event_handler_for_events(&dispatch_registrations[1], events, sizeof(events), NULL, 0);
+    hci_power_control(HCI_POWER_ON);
+    CHECK_EQUAL(2, dispatch_num_calls);
+    CHECK_EQUAL(0, dispatch_call_handler[0]);
+    CHECK_EQUAL(1, dispatch_call_handler[1]);
+}
+
+TEST(HCI_EVENT_DISPATCH, TableFull){
+    const uint8_t events[] = { BTSTACK_EVENT_STATE };
+    // test packet handler from stack_init uses first entry
+    uint8_t i;
+    for (i = 0; i < HCI_EVENT_DISPATCH_MAX_HANDLERS - 1; i++){
+        dispatch_registrations[i].callback = &dispatch_handler_0;
+        hci_add_event_handler_for_events(&dispatch_registrations[i], events, sizeof(events), NULL, 0);
+    }
+    // does not fit into table, receives all events
+    dispatch_registrations[i].callback = &dispatch_handler_2;
+    hci_add_event_handler_for_events(&dispatch_registrations[i], events, sizeof(events), NULL, 0);
+    stack_power_on();
+    CHECK_EQUAL(1, stack_working);
+    CHECK_EQUAL(dispatch_count(0, 0), dispatch_count(0, BTSTACK_EVENT_STATE));
+    CHECK_EQUAL(dispatch_count(0, 0), (HCI_EVENT_DISPATCH_MAX_HANDLERS - 1) * dispatch_count(2, BTSTACK_EVENT_STATE));
+    CHECK(dispatch_count(2, 0) > dispatch_count(2, BTSTACK_EVENT_STATE));
+}
+
+// ADV Bearer client: sends queued network pdus with index in first byte on can send now
+#define BEARER_TEST_MAX_PDUS 16
+static uint8_t  bearer_pdus_to_send;
+static uint8_t  bearer_pdus_sent;
+static uint8_t  bearer_beacons_to_send;
+static uint8_t  bearer_count;
+static uint16_t bearer_interval_ms;
+static uint8_t  bearer_tx_count[BEARER_TEST_MAX_PDUS + 1];
+static uint32_t bearer_tx_first_us[BEARER_TEST_MAX_PDUS + 1];
+static uint32_t bearer_tx_last_us[BEARER_TEST_MAX_PDUS + 1];
+static uint32_t bearer_tx_min_gap_us[BEARER_TEST_MAX_PDUS + 1];
+static uint8_t  bearer_tx_order[2 * BEARER_TEST_MAX_PDUS];
+static uint8_t  bearer_tx_order_len;
+
+// beacons use index BEARER_TEST_MAX_PDUS
+static void bearer_advertising_callback(uint32_t time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len){
+    UNUSED(advertising_handle);
+    if (len < 3) return;
+    uint8_t index;
+    switch (data[1]){
+        case BLUETOOTH_DATA_TYPE_MESH_MESSAGE:
+            index = data[2];
+            break;
+        case BLUETOOTH_DATA_TYPE_MESH_BEACON:
+            index = BEARER_TEST_MAX_PDUS;
+            break;
+        default:
+            return;
+    }
+    if (index > BEARER_TEST_MAX_PDUS) return;
+    if (bearer_tx_count[index] == 0){
+        bearer_tx_first_us[index] = time_us;
+        if (bearer_tx_order_len < sizeof(bearer_tx_order)){
+            bearer_tx_order[bearer_tx_order_len++] = index;
+        }
+    } else {
+        bearer_tx_min_gap_us[index] = btstack_min(bearer_tx_min_gap_us[index], time_us - bearer_tx_last_us[index]);
+    }
+    bearer_tx_last_us[index] = time_us;
+    bearer_tx_count[index]++;
+}
+
+static void bearer_network_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_MESH_META) return;
+    if (hci_event_mesh_meta_get_subevent_code(packet) != MESH_SUBEVENT_CAN_SEND_NOW) return;
+    if (bearer_pdus_sent >= bearer_pdus_to_send) return;
+    uint8_t pdu[20];
+    memset(pdu, 0, sizeof(pdu));
+    pdu[0] = bearer_pdus_sent++;
+    adv_bearer_send_network_pdu(pdu, sizeof(pdu), bearer_count, bearer_interval_ms);
+    if (bearer_pdus_sent < bearer_pdus_to_send){
+        adv_bearer_request_can_send_now_for_network_pdu();
+    }
+}
+
+static void bearer_beacon_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_MESH_META) return;
+    if (bearer_beacons_to_send == 0) return;
+    bearer_beacons_to_send--;
+    uint8_t beacon[22];
+    memset(beacon, 0xbb, sizeof(beacon));
+    adv_bearer_send_beacon(beacon, sizeof(beacon));
+}
+
+TEST_GROUP(MESH_ADV_BEARER){
+    void setup(void){
+        stack_init(&controller_usb);
+        adv_bearer_init();
+        adv_bearer_register_for_network_pdu(&bearer_network_handler);
+        adv_bearer_register_for_beacon(&bearer_beacon_handler);
+        mock_controller_set_advertising_callback(&bearer_advertising_callback);
+        bearer_pdus_to_send = 0;
+        bearer_pdus_sent = 0;
+        bearer_beacons_to_send = 0;
+        bearer_count = 3;
+        bearer_interval_ms = 20;
+        memset(bearer_tx_count, 0, sizeof(bearer_tx_count));
+        memset(bearer_tx_min_gap_us, 0xff, sizeof(bearer_tx_min_gap_us));
+        bearer_tx_order_len = 0;
+    }
+    void teardown(void){
+        stack_deinit();
+    }
+    void send_network_pdus(uint8_t num_pdus){
+        bearer_pdus_to_send = num_pdus;
+        adv_bearer_request_can_send_now_for_network_pdu();
+        mock_controller_run();
+    }
+};
+
+TEST(MESH_ADV_BEARER, LegacyQueue){
+    adv_bearer_set_max_advertising_sets(0);
+    stack_power_on();
+    uint16_t num_params = mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS);
+    uint16_t num_data   = mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA);
+    uint16_t num_enable = mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE);
+    send_network_pdus(4);
+    CHECK_EQUAL(4, bearer_pdus_sent);
+    uint8_t i;
+    for (i = 0; i < 4; i++){
+        CHECK_EQUAL(3, bearer_tx_count[i]);
+        CHECK(bearer_tx_min_gap_us[i] >= 20000);
+    }
+    // transmissions are interleaved, advertising parameters are set once and advertising stays enabled
+    CHECK(bearer_tx_first_us[3] < bearer_tx_last_us[0]);
+    CHECK_EQUAL(num_params + 1, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS));
+    CHECK_EQUAL(num_data + 12, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA));
+    // enabled once, disabled when queue is empty
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE) - num_enable);
+}
+
+TEST(MESH_ADV_BEARER, LegacyQueueFull){
+    adv_bearer_set_max_advertising_sets(0);
+    stack_power_on();
+    send_network_pdus(BEARER_TEST_MAX_PDUS);
+    // can send now is emitted again when queue has space
+    CHECK_EQUAL(BEARER_TEST_MAX_PDUS, bearer_pdus_sent);
+    uint8_t i;
+    for (i = 0; i < BEARER_TEST_MAX_PDUS; i++){
+        CHECK_EQUAL(3, bearer_tx_count[i]);
+    }
+}
+
+TEST(MESH_ADV_BEARER, Priority){
+    adv_bearer_set_max_advertising_sets(0);
+    bearer_beacons_to_send = 1;
+    adv_bearer_request_can_send_now_for_beacon();
+    bearer_pdus_to_send = 2;
+    adv_bearer_request_can_send_now_for_network_pdu();
+    // queued before HCI is working
+    stack_power_on();
+    CHECK_EQUAL(3, bearer_tx_count[BEARER_TEST_MAX_PDUS]);
+    CHECK_EQUAL(3, bearer_tx_count[0]);
+    CHECK_EQUAL(3, bearer_tx_count[1]);
+    CHECK_EQUAL(0, bearer_tx_order[0]);
+    CHECK_EQUAL(1, bearer_tx_order[1]);
+    CHECK_EQUAL(BEARER_TEST_MAX_PDUS, bearer_tx_order[2]);
+}
+
+TEST(MESH_ADV_BEARER, AdvertisingSets){
+    adv_bearer_set_max_advertising_sets(2);
+    mock_controller_set_le_extended_advertising(1);
+    stack_power_on();
+    bearer_interval_ms = 30;
+    send_network_pdus(4);
+    CHECK_EQUAL(4, bearer_pdus_sent);
+    uint8_t i;
+    for (i = 0; i < 4; i++){
+        CHECK_EQUAL(3, bearer_tx_count[i]);
+        CHECK_EQUAL(30000, bearer_tx_min_gap_us[i]);
+    }
+    // two messages in parallel, no legacy advertising
+    CHECK(bearer_tx_first_us[1] < bearer_tx_last_us[0]);
+    CHECK(bearer_tx_first_us[2] > bearer_tx_last_us[0]);
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA));
+    // setup + parameters only updated once per set for new interval
+    CHECK_EQUAL(2, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS) - 2);
+}
+
+TEST(MESH_ADV_BEARER, AdvertisingSetsNotSupported){
+    adv_bearer_set_max_advertising_sets(2);
+    stack_power_on();
+    send_network_pdus(2);
+    CHECK_EQUAL(3, bearer_tx_count[0]);
+    CHECK_EQUAL(3, bearer_tx_count[1]);
+    CHECK_EQUAL(0, mock_controller_count_commands(HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,763 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+#include "btstack_run_loop.h"
+#include "bluetooth.h"
+#include "bluetooth_company_id.h"
+#include "hci.h"
+#include "hci_cmd.h"
+
+#include "mock.h"
+
+#define MOCK_MAX_ITEMS      64
+#define MOCK_MAX_COMMANDS   256
+#define MOCK_MAX_WHITELIST  8
+#define MOCK_PACKET_SIZE    260
+#define MOCK_MAX_ADVERTISING_SETS 16
+
+typedef enum {
+    ITEM_COMMAND_ARRIVAL = 0,   // command reached controller
+    ITEM_COMMAND_DONE,          // controller finished command
+    ITEM_EVENT,                 // event reached host
+    ITEM_LE_CONNECT,            // peer got connected
+    ITEM_PACKET_SENT,           // transport finished sending command
+} item_type_t;
+
+typedef struct {
+    item_type_t type;
+    uint32_t    time_us;
+    uint32_t    seq_nr;
+    uint16_t    len;
+    uint8_t     packet[MOCK_PACKET_SIZE];
+} item_t;
+
+static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0 };
+
+static mock_controller_config_t controller_config;
+static void (*host_packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static item_t   items[MOCK_MAX_ITEMS];
+static uint8_t  items_used[MOCK_MAX_ITEMS];
+static uint32_t items_seq_nr;
+static uint32_t time_us;
+static uint32_t link_to_controller_busy_us;
+static uint32_t link_to_host_busy_us;
+static int      transport_busy;
+
+// controller command queue, holds indices into items
+static uint8_t  controller_queue[MOCK_MAX_ITEMS];
+static uint8_t  controller_queue_len;
+static int      controller_busy;
+static int      controller_reverse_order;
+static uint16_t controller_queue_overflows;
+
+static uint16_t commands_opcodes[MOCK_MAX_COMMANDS];
+static uint8_t  commands_packets[MOCK_MAX_COMMANDS][MOCK_PACKET_SIZE];
+static uint16_t commands_num;
+static uint16_t commands_acknowledged;
+static uint8_t  commands_in_flight_max;
+
+static bd_addr_type_t le_peer_addr_type;
+static bd_addr_t      le_peer_addr;
+static uint32_t       le_peer_connect_delay_us;
+static int            le_peer_set;
+static int            le_connecting;
+static int            le_peer_connected;
+static hci_con_handle_t le_next_con_handle;
+static bd_addr_t      whitelist_addr[MOCK_MAX_WHITELIST];
+static uint8_t        whitelist_addr_type[MOCK_MAX_WHITELIST];
+static uint8_t        whitelist_num;
+
+// data channel: supported PHYs as bitmask (1 = 1M, 2 = 2M, 4 = Coded), current PHY and max tx octets
+static uint8_t        le_local_phys;
+static uint8_t        le_peer_phys;
+static uint16_t       le_peer_max_octets;
+static uint8_t        le_phy;
+static uint16_t       le_max_tx_octets;
+
+// LE Extended Advertising and LE Periodic Advertising supported
+static int            le_extended_advertising;
+
+// legacy advertising: events are reported when advertising gets disabled or data changes
+static uint32_t       le_advertising_interval_us;
+static uint8_t        le_advertising_data[31];
+static uint8_t        le_advertising_data_len;
+static int            le_advertising_enabled;
+static uint32_t       le_advertising_next_event_us;
+
+// advertising sets: events are reported when advertising set gets enabled with max number of events
+static uint32_t       le_advertising_set_interval_us[MOCK_MAX_ADVERTISING_SETS];
+static uint8_t        le_advertising_set_data[MOCK_MAX_ADVERTISING_SETS][31];
+static uint8_t        le_advertising_set_data_len[MOCK_MAX_ADVERTISING_SETS];
+static void (*advertising_callback)(uint32_t time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len);
+
+// virtual time run loop
+
+static uint32_t mock_run_loop_get_time_ms(void){
+    return time_us / 1000u;
+}
+
+static void mock_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    timer->timeout = mock_run_loop_get_time_ms() + timeout_in_ms;
+}
+
+static void mock_run_loop_execute(void){
+    mock_controller_run();
+}
+
+static const btstack_run_loop_t mock_run_loop = {
+    &btstack_run_loop_base_init,
+    &btstack_run_loop_base_add_data_source,
+    &btstack_run_loop_base_remove_data_source,
+    &btstack_run_loop_base_enable_data_source_callbacks,
+    &btstack_run_loop_base_disable_data_source_callbacks,
+    &mock_run_loop_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    &mock_run_loop_execute,
+    &btstack_run_loop_base_dump_timer,
+    &mock_run_loop_get_time_ms,
+};
+
+const btstack_run_loop_t * mock_run_loop_get_instance(void){
+    return &mock_run_loop;
+}
+
+// items
+
+static item_t * item_add(item_type_t type, uint32_t item_time_us, const uint8_t * packet, uint16_t len){
+    int i;
+    for (i = 0; i < MOCK_MAX_ITEMS; i++){
+        if (items_used[i]) continue;
+        items_used[i] = 1;
+        items[i].type = type;
+        items[i].time_us = item_time_us;
+        items[i].seq_nr = items_seq_nr++;
+        items[i].len = len;
+        if (len > 0){
+            (void) memcpy(items[i].packet, packet, len);
+        }
+        return &items[i];
+    }
+    btstack_assert(false);
+    return NULL;
+}
+
+static int item_next(void){
+    int next = -1;
+    int i;
+    for (i = 0; i < MOCK_MAX_ITEMS; i++){
+        // skip free items and commands queued in controller
+        if (items_used[i] != 1u) continue;
+        if ((next < 0) || (items[i].time_us < items[next].time_us)
+            || ((items[i].time_us == items[next].time_us) && (items[i].seq_nr < items[next].seq_nr))){
+            next = i;
+        }
+    }
+    return next;
+}
+
+// links are serialized, each packet occupies the link for its transfer time
+
+static void send_to_host(const uint8_t * event, uint16_t len){
+    uint32_t start_us = btstack_max(time_us, link_to_host_busy_us);
+    link_to_host_busy_us = start_us + ((len + 1u) * controller_config.byte_time_us);
+    (void) item_add(ITEM_EVENT, link_to_host_busy_us + controller_config.latency_controller_to_host_us, event, len);
+}
+
+static void send_command_complete(uint16_t opcode, const uint8_t * return_params, uint8_t return_params_len){
+    uint8_t event[MOCK_PACKET_SIZE];
+    uint8_t credits = (controller_queue_len < controller_config.num_cmd_packets) ? (controller_config.num_cmd_packets - controller_queue_len) : 0;
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 3u + return_params_len;
+    event[2] = credits;
+    little_endian_store_16(event, 3, opcode);
+    (void) memcpy(&event[5], return_params, return_params_len);
+    send_to_host(event, 5u + return_params_len);
+}
+
+static void send_command_status(uint16_t opcode, uint8_t status){
+    uint8_t event[6];
+    uint8_t credits = (controller_queue_len < controller_config.num_cmd_packets) ? (controller_config.num_cmd_packets - controller_queue_len) : 0;
+    event[0] = HCI_EVENT_COMMAND_STATUS;
+    event[1] = 4;
+    event[2] = status;
+    event[3] = credits;
+    little_endian_store_16(event, 4, opcode);
+    send_to_host(event, sizeof(event));
+}
+
+static void send_le_connection_complete(uint8_t status, hci_con_handle_t con_handle){
+    uint8_t event[21];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 19;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    event[3] = status;
+    little_endian_store_16(event, 4, con_handle);
+    event[6] = HCI_ROLE_MASTER;
+    event[7] = (uint8_t) le_peer_addr_type;
+    reverse_bd_addr(le_peer_addr, &event[8]);
+    little_endian_store_16(event, 14, 0x0028);  // interval
+    little_endian_store_16(event, 16, 0);       // latency
+    little_endian_store_16(event, 18, 0x01f4);  // supervision timeout
+    send_to_host(event, sizeof(event));
+}
+
+static void send_le_phy_update_complete(hci_con_handle_t con_handle){
+    uint8_t event[8];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 6;
+    event[2] = HCI_SUBEVENT_LE_PHY_UPDATE_COMPLETE;
+    event[3] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 4, con_handle);
+    event[6] = le_phy;
+    event[7] = le_phy;
+    send_to_host(event, sizeof(event));
+}
+
+static void send_le_data_length_change(hci_con_handle_t con_handle){
+    uint8_t event[13];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 11;
+    event[2] = HCI_SUBEVENT_LE_DATA_LENGTH_CHANGE;
+    little_endian_store_16(event, 3, con_handle);
+    little_endian_store_16(event, 5, le_max_tx_octets);
+    little_endian_store_16(event, 7, (le_max_tx_octets + 14u) * 8u);
+    little_endian_store_16(event, 9, le_peer_max_octets);
+    little_endian_store_16(event, 11, (le_peer_max_octets + 14u) * 8u);
+    send_to_host(event, sizeof(event));
+}
+
+static int whitelist_contains(uint8_t address_type, const bd_addr_t address){
+    uint8_t i;
+    for (i = 0; i < whitelist_num; i++){
+        if (whitelist_addr_type[i] != address_type) continue;
+        if (bd_addr_cmp(whitelist_addr[i], address) != 0) continue;
+        return 1;
+    }
+    return 0;
+}
+
+static void cancel_le_connect(void){
+    int i;
+    for (i = 0; i < MOCK_MAX_ITEMS; i++){
+        if (items_used[i] && (items[i].type == ITEM_LE_CONNECT)){
+            items_used[i] = 0;
+        }
+    }
+}
+
+static void report_advertising_event(uint32_t event_time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len){
+    if (advertising_callback == NULL) return;
+    (*advertising_callback)(event_time_us, advertising_handle, data, len);
+}
+
+// report legacy advertising events up to now
+static void legacy_advertising_update(void){
+    if (!le_advertising_enabled) return;
+    while ((int32_t)(time_us - le_advertising_next_event_us) >= 0){
+        report_advertising_event(le_advertising_next_event_us, 0, le_advertising_data, le_advertising_data_len);
+        le_advertising_next_event_us += le_advertising_interval_us;
+    }
+}
+
+static void advertising_set_start(uint8_t advertising_handle, uint8_t max_events){
+    if (advertising_handle >= MOCK_MAX_ADVERTISING_SETS) return;
+    // without max number of events, the advertising set does not terminate
+    if (max_events == 0u) return;
+    uint32_t interval_us = le_advertising_set_interval_us[advertising_handle];
+    uint8_t i;
+    for (i = 0; i < max_events; i++){
+        report_advertising_event(time_us + i * interval_us, advertising_handle,
+                                 le_advertising_set_data[advertising_handle], le_advertising_set_data_len[advertising_handle]);
+    }
+    uint8_t event[8];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 6;
+    event[2] = HCI_SUBEVENT_LE_ADVERTISING_SET_TERMINATED;
+    event[3] = ERROR_CODE_LIMIT_REACHED;
+    event[4] = advertising_handle;
+    little_endian_store_16(event, 5, HCI_CON_HANDLE_INVALID);
+    event[7] = max_events;
+    (void) item_add(ITEM_EVENT, time_us + (max_events - 1u) * interval_us + controller_config.latency_controller_to_host_us, event, sizeof(event));
+}
+
+static void controller_process_command(const uint8_t * packet){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    const uint8_t * params = &packet[3];
+    uint8_t return_params[MOCK_PACKET_SIZE];
+    uint8_t pos = 0;
+    bd_addr_t address;
+
+    return_params[pos++] = ERROR_CODE_SUCCESS;
+
+    legacy_advertising_update();
+
+    switch (opcode){
+        case HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION:
+            return_params[pos++] = 0x09;    // HCI Version 5.0
+            little_endian_store_16(return_params, pos, 0x0001);
+            pos += 2;
+            return_params[pos++] = 0x09;    // LMP Version 5.0
+            little_endian_store_16(return_params, pos, BLUETOOTH_COMPANY_ID_TEXAS_INSTRUMENTS_INC);
+            pos += 2;
+            little_endian_store_16(return_params, pos, 0x0001);
+            pos += 2;
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_NAME:
+            memset(&return_params[pos], 0, 248);
+            pos += 248;
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS:
+            memset(&return_params[pos], 0xff, 64);
+            pos += 64;
+            break;
+        case HCI_OPCODE_HCI_READ_BD_ADDR:
+            memset(&return_params[pos], 0x42, 6);
+            pos += 6;
+            break;
+        case HCI_OPCODE_HCI_READ_BUFFER_SIZE:
+            little_endian_store_16(return_params, pos, 1021);
+            pos += 2;
+            return_params[pos++] = 64;
+            little_endian_store_16(return_params, pos, 8);
+            pos += 2;
+            little_endian_store_16(return_params, pos, 0);
+            pos += 2;
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES:
+            // dual mode controller: all features, bit 37 'No BR/EDR Support' cleared
+            memset(&return_params[pos], 0xff, 8);
+            return_params[pos + 4] &= ~(1u << 5);
+            pos += 8;
+            break;
+        case HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE:
+            little_endian_store_16(return_params, pos, 27);
+            pos += 2;
+            return_params[pos++] = 8;
+            break;
+        case HCI_OPCODE_HCI_LE_READ_SUPPORTED_FEATURES:
+            // all LE 4.2 features, bit 8 = LE 2M PHY, bit 11 = LE Coded PHY
+            memset(&return_params[pos], 0, 8);
+            return_params[pos] = 0xff;
+            if ((le_local_phys & 2u) != 0u) return_params[pos + 1] |= 0x01u;
+            if ((le_local_phys & 4u) != 0u) return_params[pos + 1] |= 0x08u;
+            // bit 12 = LE Extended Advertising, bit 13 = LE Periodic Advertising
+            if (le_extended_advertising) return_params[pos + 1] |= 0x30u;
+            pos += 8;
+            break;
+        case HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE:
+        case HCI_OPCODE_HCI_LE_READ_RESOLVING_LIST_SIZE:
+            return_params[pos++] = MOCK_MAX_WHITELIST;
+            break;
+        case HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH:
+            little_endian_store_16(return_params, pos + 0, 251);
+            little_endian_store_16(return_params, pos + 2, 2120);
+            little_endian_store_16(return_params, pos + 4, 251);
+            little_endian_store_16(return_params, pos + 6, 2120);
+            pos += 8;
+            break;
+        case HCI_OPCODE_HCI_READ_RSSI:
+            little_endian_store_16(return_params, pos, little_endian_read_16(params, 0));
+            pos += 2;
+            return_params[pos++] = (uint8_t) -50;
+            break;
+        case HCI_OPCODE_HCI_LE_CLEAR_WHITE_LIST:
+            whitelist_num = 0;
+            break;
+        case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST:
+            reverse_bd_addr(&params[1], address);
+            if (!whitelist_contains(params[0], address) && (whitelist_num < MOCK_MAX_WHITELIST)){
+                whitelist_addr_type[whitelist_num] = params[0];
+                bd_addr_copy(whitelist_addr[whitelist_num], address);
+                whitelist_num++;
+            }
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS:
+            le_advertising_interval_us = little_endian_read_16(params, 0) * 625u;
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA:
+            le_advertising_data_len = btstack_min(params[0], sizeof(le_advertising_data));
+            (void) memcpy(le_advertising_data, &params[1], le_advertising_data_len);
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE:
+            if ((params[0] != 0u) && !le_advertising_enabled){
+                le_advertising_next_event_us = time_us;
+            }
+            le_advertising_enabled = params[0];
+            break;
+        case HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_PARAMETERS:
+            if (params[0] < MOCK_MAX_ADVERTISING_SETS){
+                le_advertising_set_interval_us[params[0]] = little_endian_read_24(params, 3) * 625u;
+            }
+            return_params[pos++] = 0;   // selected tx power
+            break;
+        case HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_DATA:
+            // complete data in single command
+            if ((params[0] < MOCK_MAX_ADVERTISING_SETS) && (params[1] == 3u) && (params[3] <= 31u)){
+                le_advertising_set_data_len[params[0]] = params[3];
+                (void) memcpy(le_advertising_set_data[params[0]], &params[4], params[3]);
+            }
+            break;
+        case HCI_OPCODE_HCI_LE_SET_EXTENDED_ADVERTISING_ENABLE:
+            send_command_complete(opcode, return_params, pos);
+            // single set
+            if ((params[0] != 0u) && (params[1] == 1u)){
+                advertising_set_start(params[2], params[5]);
+            }
+            return;
+        case HCI_OPCODE_HCI_LE_CREATE_CONNECTION:
+            send_command_status(opcode, ERROR_CODE_SUCCESS);
+            le_connecting = 1;
+            reverse_bd_addr(&params[6], address);
+            if (le_peer_set && !le_peer_connected){
+                bool use_whitelist = params[4] != 0;
+                if ((use_whitelist && whitelist_contains((uint8_t) le_peer_addr_type, le_peer_addr))
+                    || (!use_whitelist && (bd_addr_cmp(address, le_peer_addr) == 0))){
+                    (void) item_add(ITEM_LE_CONNECT, time_us + le_peer_connect_delay_us, NULL, 0);
+                }
+            }
+            return;
+        case HCI_OPCODE_HCI_LE_EXTENDED_CREATE_CONNECTION:
+            send_command_status(opcode, ERROR_CODE_SUCCESS);
+            le_connecting = 1;
+            reverse_bd_addr(&params[3], address);
+            if (le_peer_set && !le_peer_connected){
+                bool use_whitelist = params[0] != 0;
+                if ((use_whitelist && whitelist_contains((uint8_t) le_peer_addr_type, le_peer_addr))
+                    || (!use_whitelist && (bd_addr_cmp(address, le_peer_addr) == 0))){
+                    (void) item_add(ITEM_LE_CONNECT, time_us + le_peer_connect_delay_us, NULL, 0);
+                }
+            }
+            return;
+        case HCI_OPCODE_HCI_LE_PERIODIC_ADVERTISING_CREATE_SYNC:
+            send_command_status(opcode, ERROR_CODE_SUCCESS);
+            return;
+        case HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL:
+            if (le_connecting == 0){
+                return_params[0] = ERROR_CODE_COMMAND_DISALLOWED;
+                break;
+            }
+            le_connecting = 0;
+            cancel_le_connect();
+            send_command_complete(opcode, return_params, pos);
+            send_le_connection_complete(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, 0);
+            return;
+        case HCI_OPCODE_HCI_LE_SET_PHY: {
+            send_command_status(opcode, ERROR_CODE_SUCCESS);
+            // use fastest PHY supported by both sides, also reports unchanged PHY
+            uint8_t phys = params[3] & le_local_phys & le_peer_phys;
+            le_phy = ((phys & 2u) != 0u) ? 2u : (((phys & 4u) != 0u) ? 3u : 1u);
+            send_le_phy_update_complete(little_endian_read_16(params, 0));
+            return;
+        }
+        case HCI_OPCODE_HCI_LE_SET_DATA_LENGTH: {
+            hci_con_handle_t con_handle = little_endian_read_16(params, 0);
+            little_endian_store_16(return_params, pos, con_handle);
+            pos += 2;
+            send_command_complete(opcode, return_params, pos);
+            // report change only
+            uint16_t max_tx_octets = btstack_min(little_endian_read_16(params, 2), le_peer_max_octets);
+            if (max_tx_octets == le_max_tx_octets) return;
+            le_max_tx_octets = max_tx_octets;
+            send_le_data_length_change(con_handle);
+            return;
+        }
+        case HCI_OPCODE_HCI_LE_CONNECTION_UPDATE:
+        case HCI_OPCODE_HCI_LE_READ_REMOTE_USED_FEATURES:
+        case HCI_OPCODE_HCI_DISCONNECT:
+            send_command_status(opcode, ERROR_CODE_SUCCESS);
+            return;
+        default:
+            break;
+    }
+    send_command_complete(opcode, return_params, pos);
+}
+
+static void controller_start_next_command(void){
+    if (controller_busy) return;
+    if (controller_queue_len == 0u) return;
+    controller_busy = 1;
+    (void) item_add(ITEM_COMMAND_DONE, time_us + controller_config.processing_us, NULL, 0);
+}
+
+static void controller_command_done(void){
+    uint8_t index;
+    if (controller_reverse_order){
+        index = controller_queue[controller_queue_len - 1u];
+    } else {
+        index = controller_queue[0];
+        (void) memmove(&controller_queue[0], &controller_queue[1], controller_queue_len - 1u);
+    }
+    controller_queue_len--;
+    controller_busy = 0;
+    controller_process_command(items[index].packet);
+    items_used[index] = 0;
+    controller_start_next_command();
+}
+
+// transport
+
+static void mock_transport_init(const void * transport_config){
+    UNUSED(transport_config);
+}
+
+static int mock_transport_open(void){
+    return 0;
+}
+
+static int mock_transport_close(void){
+    return 0;
+}
+
+static void mock_transport_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    host_packet_handler = handler;
+}
+
+static int mock_transport_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return transport_busy == 0;
+}
+
+static int mock_transport_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    if (packet_type != HCI_COMMAND_DATA_PACKET) return 0;
+    if (commands_num < MOCK_MAX_COMMANDS){
+        commands_opcodes[commands_num] = little_endian_read_16(packet, 0);
+        (void) memcpy(commands_packets[commands_num], packet, btstack_min(size, MOCK_PACKET_SIZE));
+    }
+    commands_num++;
+    uint8_t commands_in_flight = (uint8_t) (commands_num - commands_acknowledged);
+    commands_in_flight_max = btstack_max(commands_in_flight_max, commands_in_flight);
+
+    uint32_t start_us = btstack_max(time_us, link_to_controller_busy_us);
+    link_to_controller_busy_us = start_us + ((size + 1u) * controller_config.byte_time_us);
+    (void) item_add(ITEM_COMMAND_ARRIVAL, link_to_controller_busy_us + controller_config.latency_host_to_controller_us, packet, (uint16_t) size);
+    // packet buffer is released when packet is on the wire
+    transport_busy = 1;
+    (void) item_add(ITEM_PACKET_SENT, link_to_controller_busy_us, NULL, 0);
+    return 0;
+}
+
+static const hci_transport_t mock_transport = {
+    /* const char * name; */                                        "MOCK",
+    /* void   (*init) (const void *transport_config); */            &mock_transport_init,
+    /* int    (*open)(void); */                                     &mock_transport_open,
+    /* int    (*close)(void); */                                    &mock_transport_close,
+    /* void   (*register_packet_handler)(void (*handler)(...); */   &mock_transport_register_packet_handler,
+    /* int    (*can_send_packet_now)(uint8_t packet_type); */       &mock_transport_can_send_packet_now,
+    /* int    (*send_packet)(...); */                               &mock_transport_send_packet,
+    /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+    /* void   (*reset_link)(void); */                               NULL,
+    /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+};
+
+const hci_transport_t * mock_controller_get_transport(void){
+    return &mock_transport;
+}
+
+// controller
+
+void mock_controller_init(const mock_controller_config_t * config){
+    controller_config = *config;
+    memset(items_used, 0, sizeof(items_used));
+    items_seq_nr = 0;
+    time_us = 0;
+    link_to_controller_busy_us = 0;
+    link_to_host_busy_us = 0;
+    transport_busy = 0;
+    controller_queue_len = 0;
+    controller_busy = 0;
+    controller_reverse_order = 0;
+    controller_queue_overflows = 0;
+    commands_num = 0;
+    commands_acknowledged = 0;
+    commands_in_flight_max = 0;
+    le_peer_set = 0;
+    le_connecting = 0;
+    le_peer_connected = 0;
+    le_next_con_handle = 0x0040;
+    whitelist_num = 0;
+    le_local_phys = 0x03;
+    le_peer_phys = 0x03;
+    le_peer_max_octets = 251;
+    le_extended_advertising = 0;
+    le_advertising_interval_us = 0x0800 * 625u;
+    le_advertising_data_len = 0;
+    le_advertising_enabled = 0;
+    memset(le_advertising_set_interval_us, 0, sizeof(le_advertising_set_interval_us));
+    memset(le_advertising_set_data_len, 0, sizeof(le_advertising_set_data_len));
+    advertising_callback = NULL;
+}
+
+void mock_controller_set_reverse_order(int reverse_order){
+    controller_reverse_order = reverse_order;
+}
+
+void mock_controller_set_le_peer(bd_addr_type_t address_type, const bd_addr_t address, uint32_t connect_delay_us){
+    le_peer_set = 1;
+    le_peer_addr_type = address_type;
+    bd_addr_copy(le_peer_addr, address);
+    le_peer_connect_delay_us = connect_delay_us;
+}
+
+void mock_controller_set_le_data_channel(uint8_t local_phys, uint8_t peer_phys, uint16_t peer_max_octets){
+    le_local_phys = local_phys;
+    le_peer_phys = peer_phys;
+    le_peer_max_octets = peer_max_octets;
+}
+
+void mock_controller_set_le_extended_advertising(int supported){
+    le_extended_advertising = supported;
+}
+
+void mock_controller_set_advertising_callback(void (*callback)(uint32_t time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len)){
+    advertising_callback = callback;
+}
+
+void mock_controller_send_event(const uint8_t * event, uint16_t len){
+    send_to_host(event, len);
+}
+
+void mock_controller_deliver_event(uint32_t event_time_us, const uint8_t * event, uint16_t len){
+    // copy into receive buffer as HCI Transport does, the stack may modify the event in place
+    static uint8_t buffer[MOCK_PACKET_SIZE];
+    if (len > sizeof(buffer)) return;
+    (void) memcpy(buffer, event, len);
+    time_us = btstack_max(time_us, event_time_us);
+    (*host_packet_handler)(HCI_EVENT_PACKET, buffer, len);
+}
+
+void mock_controller_disconnect(hci_con_handle_t con_handle){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    event[1] = 4;
+    event[2] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 3, con_handle);
+    event[5] = ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION;
+    send_to_host(event, sizeof(event));
+    le_peer_connected = 0;
+    // peer keeps advertising, pending LE Create Connection with whitelist picks it up again
+    if (le_connecting && whitelist_contains((uint8_t) le_peer_addr_type, le_peer_addr)){
+        (void) item_add(ITEM_LE_CONNECT, time_us + le_peer_connect_delay_us, NULL, 0);
+    }
+}
+
+void mock_controller_run(void){
+    while (true){
+        int next = item_next();
+
+        // fire timers that expire before next item
+        int32_t time_until_timeout_ms = btstack_run_loop_base_get_time_until_timeout(mock_run_loop_get_time_ms());
+        if (time_until_timeout_ms >= 0){
+            uint32_t timeout_us = (mock_run_loop_get_time_ms() + (uint32_t) time_until_timeout_ms) * 1000u;
+            if ((next < 0) || (timeout_us <= items[next].time_us)){
+                time_us = btstack_max(time_us, timeout_us);
+                btstack_run_loop_base_process_timers(mock_run_loop_get_time_ms());
+                continue;
+            }
+        }
+
+        if (next < 0) {
+            legacy_advertising_update();
+            break;
+        }
+
+        time_us = items[next].time_us;
+        switch (items[next].type){
+            case ITEM_COMMAND_ARRIVAL:
+                // keep item as command buffer until processed
+                if (controller_queue_len >= controller_config.num_cmd_packets){
+                    controller_queue_overflows++;
+                }
+                controller_queue[controller_queue_len++] = (uint8_t) next;
+                items_used[next] = 2;
+                controller_start_next_command();
+                break;
+            case ITEM_COMMAND_DONE:
+                items_used[next] = 0;
+                controller_command_done();
+                break;
+            case ITEM_EVENT:
+                items_used[next] = 0;
+                if ((items[next].packet[0] == HCI_EVENT_COMMAND_COMPLETE) || (items[next].packet[0] == HCI_EVENT_COMMAND_STATUS)){
+                    commands_acknowledged++;
+                }
+                (*host_packet_handler)(HCI_EVENT_PACKET, items[next].packet, items[next].len);
+                break;
+            case ITEM_LE_CONNECT:
+                items_used[next] = 0;
+                le_connecting = 0;
+                le_peer_connected = 1;
+                le_phy = 1;
+                le_max_tx_octets = 27;
+                send_le_connection_complete(ERROR_CODE_SUCCESS, le_next_con_handle++);
+                break;
+            case ITEM_PACKET_SENT:
+                items_used[next] = 0;
+                transport_busy = 0;
+                (*host_packet_handler)(HCI_EVENT_PACKET, (uint8_t *) packet_sent_event, sizeof(packet_sent_event));
+                break;
+            default:
+                btstack_assert(false);
+                break;
+        }
+    }
+}
+
+uint32_t mock_controller_get_time_us(void){
+    return time_us;
+}
+
+uint16_t mock_controller_num_commands(void){
+    return commands_num;
+}
+
+uint16_t mock_controller_get_command_opcode(uint16_t index){
+    if (index >= MOCK_MAX_COMMANDS) return 0;
+    return commands_opcodes[index];
+}
+
+const uint8_t * mock_controller_get_command(uint16_t index){
+    if (index >= MOCK_MAX_COMMANDS) return NULL;
+    return commands_packets[index];
+}
+
+uint16_t mock_controller_count_commands(uint16_t opcode){
+    uint16_t count = 0;
+    uint16_t i;
+    for (i = 0; (i < commands_num) && (i < MOCK_MAX_COMMANDS); i++){
+        if (commands_opcodes[i] == opcode){
+            count++;
+        }
+    }
+    return count;
+}
+
+uint8_t mock_controller_max_commands_in_flight(void){
+    return commands_in_flight_max;
+}
+
+uint16_t mock_controller_num_queue_overflows(void){
+    return controller_queue_overflows;
+}
+
+// stubs for modules not linked into the test
+
+const uint8_t * gap_get_persistent_irk(void){
+    static const uint8_t irk[16] = { 0 };
+    return irk;
+}
+
+void gap_advertisements_set_params(uint16_t adv_int_min, uint16_t adv_int_max, uint8_t adv_type,
+    uint8_t direct_address_typ, bd_addr_t direct_address, uint8_t channel_map, uint8_t filter_policy){
+    hci_le_advertisements_set_params(adv_int_min, adv_int_max, adv_type,
+        direct_address_typ, direct_address, channel_map, filter_policy);
+}
+
+gap_random_address_type_t gap_random_address_get_mode(void){
+    return GAP_RANDOM_ADDRESS_TYPE_OFF;
+}
@@ -0,0 +1,83 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+#include "btstack_run_loop.h"
+#include "hci_transport.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    // Num_HCI_Command_Packets: size of the command queue in the Controller
+    uint8_t  num_cmd_packets;
+    // fixed one-way latency in both directions, e.g. USB polling interval or UART driver
+    uint32_t latency_host_to_controller_us;
+    uint32_t latency_controller_to_host_us;
+    // time on the wire per byte, 0 for USB
+    uint32_t byte_time_us;
+    // time to process a single command in the Controller
+    uint32_t processing_us;
+} mock_controller_config_t;
+
+// reset simulated controller and virtual time
+void mock_controller_init(const mock_controller_config_t * config);
+
+// HCI Transport connected to the simulated controller
+const hci_transport_t * mock_controller_get_transport(void);
+
+// run loop with virtual time driven by mock_controller_run
+const btstack_run_loop_t * mock_run_loop_get_instance(void);
+
+// deliver commands, events and timers until the controller is idle
+void mock_controller_run(void);
+
+// virtual time
+uint32_t mock_controller_get_time_us(void);
+
+// complete queued commands in reverse order
+void mock_controller_set_reverse_order(int reverse_order);
+
+// connectable LE device that gets connected by LE Create Connection after connect_delay_us
+void mock_controller_set_le_peer(bd_addr_type_t address_type, const bd_addr_t address, uint32_t connect_delay_us);
+
+// PHYs supported by controller and peer as bitmask (1 = 1M, 2 = 2M, 4 = Coded), max LL payload of peer
+// default: 1M and 2M on both sides, 251 octets
+void mock_controller_set_le_data_channel(uint8_t local_phys, uint8_t peer_phys, uint16_t peer_max_octets);
+
+// report LE Extended Advertising and LE Periodic Advertising in LE Supported Features, default: off
+void mock_controller_set_le_extended_advertising(int supported);
+
+// called for each advertising event of legacy advertising (handle 0) and advertising sets started with max number of events
+void mock_controller_set_advertising_callback(void (*callback)(uint32_t time_us, uint8_t advertising_handle, const uint8_t * data, uint8_t len));
+
+// send event to host, e.g. advertising reports
+void mock_controller_send_event(const uint8_t * event, uint16_t len);
+
+// advance virtual time and pass event to host right away, bypassing simulated link and controller
+void mock_controller_deliver_event(uint32_t event_time_us, const uint8_t * event, uint16_t len);
+
+// disconnect connection from remote
+void mock_controller_disconnect(hci_con_handle_t con_handle);
+
+// commands received by the controller
+uint16_t mock_controller_num_commands(void);
+uint16_t mock_controller_get_command_opcode(uint16_t index);
+uint16_t mock_controller_count_commands(uint16_t opcode);
+
+// complete command packet: opcode, parameter length, parameters
+const uint8_t * mock_controller_get_command(uint16_t index);
+
+// max number of commands sent by the host without Command Complete or Command Status
+uint8_t mock_controller_max_commands_in_flight(void);
+
+// number of commands received while the controller command queue was full
+uint16_t mock_controller_num_queue_overflows(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// PLC pattern matching performance test
+//
+// Replays the SCO input of a pklg trace and runs the CVSD and SBC PLC pattern
+// matching for every frame position. Compares against a reference
+// implementation that recomputes all energy terms for each lag.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "btstack.h"
+#include "classic/btstack_cvsd_plc.h"
+#include "classic/btstack_sbc_plc.h"
+#include "perf_timer.h"
+
+#define PAKET_TYPE_SCO_IN  9
+
+#define NUM_ITERATIONS 10
+
+static int16_t * pcm_samples;
+static uint32_t  pcm_samples_len;
+static uint32_t  pcm_samples_size;
+
+static int16_t history[SBC_LHIST + SBC_FS + SBC_RT + SBC_OLAL];
+
+static void show_usage(void){
+    printf("\n\nUsage: ./pklg_plc_performance_test input_file\n");
+    printf("Example: ./pklg_plc_performance_test pklg/test1\n");
+}
+
+static ssize_t __read(int fd, void *buf, size_t count){
+    ssize_t len, pos = 0;
+
+    while (count > 0) {
+        len = read(fd, (int8_t * )buf + pos, count);
+        if (len <= 0)
+            return pos;
+
+        count -= len;
+        pos   += len;
+    }
+    return pos;
+}
+
+// reference implementation: per-lag energy computation and approximated square root
+static float reference_sqrt3(const float x){
+    union {
+        int i;
+        float x;
+    } u;
+    u.x = x;
+    u.i = (1<<29) + (u.i >> 1) - (1<<22);
+    u.x =       u.x + (x/u.x);
+    u.x = (0.25f*u.x) + (x/u.x);
+    return u.x;
+}
+
+static float reference_cross_correlation(int16_t *x, int16_t *y, int len){
+    float num = 0;
+    float x2 = 0;
+    float y2 = 0;
+    int   m;
+    for (m=0;m<len;m++){
+        num+=((float)x[m])*y[m];
+        x2+=((float)x[m])*x[m];
+        y2+=((float)y[m])*y[m];
+    }
+    return num / reference_sqrt3(x2*y2);
+}
+
+static int reference_pattern_match(int16_t *y, int lhist, int n_max, int m_len){
+    float maxCn = -999999.0;
+    int   bestmatch = 0;
+    int   n;
+    for (n=0;n<n_max;n++){
+        float Cn = reference_cross_correlation(&y[lhist-m_len], &y[n], m_len);
+        if (Cn>maxCn){
+            bestmatch=n;
+            maxCn = Cn;
+        }
+    }
+    return bestmatch;
+}
+
+// normalized cross correlation in double precision to compare lags found by both implementations
+static double exact_cross_correlation(int16_t *y, int lhist, int m_len, int lag){
+    double num = 0;
+    double x2 = 0;
+    double y2 = 0;
+    int    m;
+    for (m=0;m<m_len;m++){
+        double x_m = y[lhist-m_len+m];
+        double y_m = y[lag+m];
+        num += x_m * y_m;
+        x2  += x_m * x_m;
+        y2  += y_m * y_m;
+    }
+    if (x2 * y2 == 0) return 0;
+    return num / sqrt(x2 * y2);
+}
+
+static int load_pcm_samples(const char * pklg_path){
+    int oflags = O_RDONLY;
+#ifdef _WIN32
+    oflags |= O_BINARY;
+#endif
+    int fd = open(pklg_path, oflags);
+    if (fd < 0) {
+        printf("Can't open file %s\n", pklg_path);
+        return -1;
+    }
+
+    pcm_samples_len = 0;
+    while (1){
+        uint8_t header[13];
+        int bytes_read = __read(fd, header, sizeof(header));
+        if (0 >= bytes_read) break;
+
+        uint32_t size = big_endian_read_32(header, 0);
+        // auto-detect endianess of size param
+        if (size >0xffff){
+            size = little_endian_read_32(header, 0);
+        }
+        // subtract header
+        size -= 9;
+
+        uint8_t packet[256];
+        if (size > sizeof(packet)){
+            printf("Error: size %u\n", size);
+            break;
+        }
+        __read(fd, packet, size);
+        if (header[12] != PAKET_TYPE_SCO_IN) continue;
+        if (size < 3) continue;
+
+        int num_samples = (size - 3) / 2;
+        if ((pcm_samples_len + num_samples) > pcm_samples_size){
+            pcm_samples_size = (pcm_samples_size + num_samples) * 2;
+            pcm_samples = (int16_t *) realloc(pcm_samples, pcm_samples_size * sizeof(int16_t));
+        }
+        int i;
+        for (i=0;i<num_samples;i++){
+            pcm_samples[pcm_samples_len++] = (int16_t) little_endian_read_16(packet, 3 + i * 2);
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+typedef int (*pattern_match_func_t)(int16_t * y);
+
+static int cvsd_reference_pattern_match(int16_t * y){
+    return reference_pattern_match(y, CVSD_LHIST, CVSD_N, CVSD_M);
+}
+
+static int sbc_reference_pattern_match(int16_t * y){
+    return reference_pattern_match(y, SBC_LHIST, SBC_N, SBC_M);
+}
+
+static uint32_t run_pattern_match(pattern_match_func_t pattern_match, int lhist, int frame_size, int * lags){
+    uint32_t start = perf_timer_get_time_us();
+    int iteration;
+    for (iteration = 0; iteration < NUM_ITERATIONS; iteration++){
+        uint32_t pos;
+        int frame = 0;
+        for (pos = lhist; pos <= pcm_samples_len; pos += frame_size){
+            memcpy(history, &pcm_samples[pos - lhist], lhist * sizeof(int16_t));
+            lags[frame++] = pattern_match(history);
+        }
+    }
+    return perf_timer_get_time_us() - start;
+}
+
+static void benchmark(const char * name, pattern_match_func_t reference, pattern_match_func_t current, int lhist, int frame_size, int m_len){
+    if (pcm_samples_len < (uint32_t) lhist) return;
+    int num_frames = (pcm_samples_len - lhist) / frame_size + 1;
+    int * reference_lags = (int *) malloc(num_frames * sizeof(int));
+    int * current_lags   = (int *) malloc(num_frames * sizeof(int));
+
+    uint32_t reference_us = run_pattern_match(reference, lhist, frame_size, reference_lags);
+    uint32_t current_us   = run_pattern_match(current,   lhist, frame_size, current_lags);
+
+    // lags may differ for (near) identical correlation, only count lags that are worse than the reference
+    int i;
+    int lag_differences = 0;
+    int worse_lags = 0;
+    for (i=0;i<num_frames;i++){
+        if (reference_lags[i] == current_lags[i]) continue;
+        lag_differences++;
+        memcpy(history, &pcm_samples[i * frame_size], lhist * sizeof(int16_t));
+        double reference_cn = exact_cross_correlation(history, lhist, m_len, reference_lags[i]);
+        double current_cn   = exact_cross_correlation(history, lhist, m_len, current_lags[i]);
+        if (current_cn < (reference_cn - 1e-6)){
+            worse_lags++;
+        }
+    }
+
+    uint32_t num_matches = num_frames * NUM_ITERATIONS;
+    printf("%s: %u pattern matches, reference %u us (%.2f us/match), current %u us (%.2f us/match), speedup %.1fx, %u/%u lags differ, %u with lower correlation\n",
+           name, num_matches,
+           reference_us, (float) reference_us / num_matches,
+           current_us,   (float) current_us   / num_matches,
+           current_us ? (float) reference_us / current_us : 0.0f,
+           lag_differences, num_frames, worse_lags);
+
+    free(reference_lags);
+    free(current_lags);
+}
+
+int main (int argc, const char * argv[]){
+    char pklg_path[1000];
+
+    if (argc < 2){
+        show_usage();
+        return -1;
+    }
+
+    const char * filename = argv[1];
+    snprintf(pklg_path, sizeof(pklg_path), "%s.pklg", filename);
+    pklg_path[sizeof(pklg_path) - 1] = 0;
+
+    if (load_pcm_samples(pklg_path) < 0) return -1;
+    printf("%s: %u SCO input samples\n", pklg_path, pcm_samples_len);
+
+    benchmark("CVSD PLC", &cvsd_reference_pattern_match, &btstack_cvsd_plc_pattern_match, CVSD_LHIST, CVSD_FS, CVSD_M);
+    benchmark("SBC PLC ", &sbc_reference_pattern_match,  &btstack_sbc_plc_pattern_match,  SBC_LHIST,  SBC_FS,  SBC_M);
+
+    free(pcm_samples);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// HID Parser performance test
+//
+// Decodes gamepad input reports with the single-pass HID Parser and with the
+// compiled HID Report Map and reports time per report.
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bluetooth.h"
+#include "btstack_hid_parser.h"
+#include "perf_timer.h"
+
+#define NUM_REPORTS 200000
+
+static const uint8_t gamepad_descriptor[] = {
+    0x05, 0x01,         // Usage Page (Generic Desktop)
+    0x09, 0x05,         // Usage (Game Pad)
+    0xa1, 0x01,         // Collection (Application)
+    0x85, 0x01,         //   Report ID (1)
+    0x05, 0x09,         //   Usage Page (Button)
+    0x19, 0x01,         //   Usage Minimum (1)
+    0x29, 0x10,         //   Usage Maximum (16)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x25, 0x01,         //   Logical Maximum (1)
+    0x75, 0x01,         //   Report Size (1)
+    0x95, 0x10,         //   Report Count (16)
+    0x81, 0x02,         //   Input (Data, Variable, Absolute)
+    0x05, 0x01,         //   Usage Page (Generic Desktop)
+    0x09, 0x39,         //   Usage (Hat switch)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x25, 0x07,         //   Logical Maximum (7)
+    0x75, 0x04,         //   Report Size (4)
+    0x95, 0x01,         //   Report Count (1)
+    0x81, 0x42,         //   Input (Data, Variable, Absolute, Null State)
+    0x75, 0x04,         //   Report Size (4)
+    0x95, 0x01,         //   Report Count (1)
+    0x81, 0x03,         //   Input (Constant)
+    0x09, 0x30,         //   Usage (X)
+    0x09, 0x31,         //   Usage (Y)
+    0x09, 0x32,         //   Usage (Z)
+    0x09, 0x35,         //   Usage (Rz)
+    0x16, 0x00, 0x80,   //   Logical Minimum (-32768)
+    0x26, 0xff, 0x7f,   //   Logical Maximum (32767)
+    0x75, 0x10,         //   Report Size (16)
+    0x95, 0x04,         //   Report Count (4)
+    0x81, 0x02,         //   Input (Data, Variable, Absolute)
+    0x05, 0x02,         //   Usage Page (Simulation Controls)
+    0x09, 0xc5,         //   Usage (Brake)
+    0x09, 0xc4,         //   Usage (Accelerator)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x26, 0xff, 0x00,   //   Logical Maximum (255)
+    0x75, 0x08,         //   Report Size (8)
+    0x95, 0x02,         //   Report Count (2)
+    0x81, 0x02,         //   Input (Data, Variable, Absolute)
+    0x85, 0x02,         //   Report ID (2)
+    0x06, 0x00, 0xff,   //   Usage Page (Vendor Defined)
+    0x09, 0x01,         //   Usage (1)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x26, 0xff, 0x00,   //   Logical Maximum (255)
+    0x75, 0x08,         //   Report Size (8)
+    0x95, 0x20,         //   Report Count (32)
+    0x91, 0x02,         //   Output (Data, Variable, Absolute)
+    0xc0,               // End Collection
+};
+
+static uint8_t gamepad_reports[16][14];
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    int i;
+    int j;
+    srand(42);
+    for (i = 0; i < 16; i++){
+        gamepad_reports[i][0] = 1;
+        for (j = 1; j < (int) sizeof(gamepad_reports[i]); j++){
+            gamepad_reports[i][j] = (uint8_t) rand();
+        }
+    }
+
+    // HID Parser
+    int32_t  parser_checksum = 0;
+    uint32_t parser_fields   = 0;
+    uint32_t parser_start = perf_timer_get_time_us();
+    for (i = 0; i < NUM_REPORTS; i++){
+        btstack_hid_parser_t parser;
+        const uint8_t * report = gamepad_reports[i & 15];
+        btstack_hid_parser_init(&parser, gamepad_descriptor, sizeof(gamepad_descriptor), HID_REPORT_TYPE_INPUT, report, sizeof(gamepad_reports[0]));
+        while (btstack_hid_parser_has_more(&parser)){
+            uint16_t usage_page;
+            uint16_t usage;
+            int32_t  value;
+            btstack_hid_parser_get_field(&parser, &usage_page, &usage, &value);
+            parser_checksum += value + usage + usage_page;
+            parser_fields++;
+        }
+    }
+    uint32_t parser_us = perf_timer_get_time_us() - parser_start;
+
+    // HID Report Map
+    static btstack_hid_report_map_t   report_map;
+    static btstack_hid_report_t       reports[4];
+    static btstack_hid_report_field_t fields[64];
+    uint32_t compile_start = perf_timer_get_time_us();
+    uint8_t status = btstack_hid_report_map_compile(&report_map, reports, 4, fields, 64, gamepad_descriptor, sizeof(gamepad_descriptor));
+    uint32_t compile_us = perf_timer_get_time_us() - compile_start;
+    if (status != ERROR_CODE_SUCCESS){
+        printf("Compile failed, status 0x%02x\n", status);
+        return 1;
+    }
+
+    int32_t  decoder_checksum = 0;
+    uint32_t decoder_fields   = 0;
+    uint32_t decoder_start = perf_timer_get_time_us();
+    for (i = 0; i < NUM_REPORTS; i++){
+        btstack_hid_report_decoder_t decoder;
+        const uint8_t * report = gamepad_reports[i & 15];
+        btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, report, sizeof(gamepad_reports[0]));
+        while (btstack_hid_report_decoder_has_more(&decoder)){
+            uint16_t usage_page;
+            uint16_t usage;
+            int32_t  value;
+            btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+            decoder_checksum += value + usage + usage_page;
+            decoder_fields++;
+        }
+    }
+    uint32_t decoder_us = perf_timer_get_time_us() - decoder_start;
+
+    printf("%u reports, %u fields per report, %u reports and %u fields in report map, compiled in %u us\n",
+           NUM_REPORTS, parser_fields / NUM_REPORTS, report_map.num_reports, report_map.num_fields, compile_us);
+    printf("HID Parser:     %6u ms, %.3f us/report\n", parser_us / 1000, (double) parser_us / NUM_REPORTS);
+    printf("HID Report Map: %6u ms, %.3f us/report, speedup %.1fx\n", decoder_us / 1000, (double) decoder_us / NUM_REPORTS, (double) parser_us / (double) decoder_us);
+    if ((parser_checksum != decoder_checksum) || (parser_fields != decoder_fields)){
+        printf("Mismatch: HID Parser %u fields, checksum %d - HID Report Map %u fields, checksum %d\n",
+               parser_fields, parser_checksum, decoder_fields, decoder_checksum);
+        return 1;
+    }
+    return 0;
+}
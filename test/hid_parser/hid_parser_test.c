@@ -14,6 +14,7 @@
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/CommandLineTestRunner.h"
 
+#include "bluetooth.h"
 #include "btstack_hid_parser.h"
 #include "hci_dump_posix_fs.h"
 
@@ -344,6 +345,195 @@ TEST(HID, GetReportSize){
     CHECK_EQUAL(8, report_size);
 }
 
+// report map
+
+static btstack_hid_report_map_t   report_map;
+static btstack_hid_report_t       report_map_reports[4];
+static btstack_hid_report_field_t report_map_fields[40];
+
+static void compile_report_map(const uint8_t * hid_descriptor, uint16_t hid_descriptor_len){
+    uint8_t status = btstack_hid_report_map_compile(&report_map, report_map_reports, 4, report_map_fields, 40, hid_descriptor, hid_descriptor_len);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+}
+
+// decode report with report map and compare against HID parser
+static void expect_same_fields(int expected_num_fields, const uint8_t * hid_descriptor, uint16_t hid_descriptor_len, hid_report_type_t report_type, const uint8_t * report, uint16_t report_len){
+    btstack_hid_parser_t hid_parser;
+    btstack_hid_report_decoder_t decoder;
+    btstack_hid_parser_init(&hid_parser, hid_descriptor, hid_descriptor_len, report_type, report, report_len);
+    btstack_hid_report_decoder_init(&decoder, &report_map, report_type, report, report_len);
+    int num_fields = 0;
+    while (btstack_hid_parser_has_more(&hid_parser)){
+        uint16_t expected_usage_page;
+        uint16_t expected_usage;
+        int32_t  expected_value;
+        btstack_hid_parser_get_field(&hid_parser, &expected_usage_page, &expected_usage, &expected_value);
+        CHECK_TRUE(btstack_hid_report_decoder_has_more(&decoder));
+        uint16_t usage_page;
+        uint16_t usage;
+        int32_t  value;
+        btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+        CHECK_EQUAL(expected_usage_page, usage_page);
+        CHECK_EQUAL(expected_usage, usage);
+        CHECK_EQUAL(expected_value, value);
+        num_fields++;
+    }
+    CHECK_EQUAL(false, btstack_hid_report_decoder_has_more(&decoder));
+    CHECK_EQUAL(expected_num_fields, num_fields);
+}
+
+TEST(HID, ReportMapMouse){
+    compile_report_map(mouse_descriptor_without_report_id, sizeof(mouse_descriptor_without_report_id));
+    CHECK_EQUAL(false, report_map.report_ids_declared);
+    CHECK_EQUAL(1, report_map.num_reports);
+    CHECK_EQUAL(5, report_map.num_fields);
+    expect_same_fields(5, mouse_descriptor_without_report_id, sizeof(mouse_descriptor_without_report_id), HID_REPORT_TYPE_INPUT, mouse_report_without_id_positive_xy, sizeof(mouse_report_without_id_positive_xy));
+    expect_same_fields(5, mouse_descriptor_without_report_id, sizeof(mouse_descriptor_without_report_id), HID_REPORT_TYPE_INPUT, mouse_report_without_id_negative_xy, sizeof(mouse_report_without_id_negative_xy));
+
+    const btstack_hid_report_field_t * field = &report_map_fields[3];
+    CHECK_EQUAL(8,    field->bit_offset);
+    CHECK_EQUAL(8,    field->bit_size);
+    CHECK_EQUAL(1,    field->usage_page);
+    CHECK_EQUAL(0x30, field->usage);
+    CHECK_EQUAL(-127, field->logical_minimum);
+    CHECK_EQUAL(127,  field->logical_maximum);
+    CHECK_EQUAL(BTSTACK_HID_REPORT_FIELD_FLAG_VARIABLE | BTSTACK_HID_REPORT_FIELD_FLAG_SIGNED, field->flags);
+}
+
+TEST(HID, ReportMapMouseWithReportID){
+    compile_report_map(mouse_descriptor_with_report_id, sizeof(mouse_descriptor_with_report_id));
+    CHECK_EQUAL(true, report_map.report_ids_declared);
+    expect_same_fields(5, mouse_descriptor_with_report_id, sizeof(mouse_descriptor_with_report_id), HID_REPORT_TYPE_INPUT, mouse_report_with_id_1, sizeof(mouse_report_with_id_1));
+}
+
+TEST(HID, ReportMapBootKeyboard){
+    compile_report_map(hid_descriptor_keyboard_boot_mode, sizeof(hid_descriptor_keyboard_boot_mode));
+    // input and output report
+    CHECK_EQUAL(2, report_map.num_reports);
+    expect_same_fields(14, hid_descriptor_keyboard_boot_mode, sizeof(hid_descriptor_keyboard_boot_mode), HID_REPORT_TYPE_INPUT, keyboard_report1, sizeof(keyboard_report1));
+    const btstack_hid_report_t * report = btstack_hid_report_map_get_report(&report_map, HID_REPORT_TYPE_OUTPUT, 0);
+    CHECK_TRUE(report != NULL);
+    CHECK_EQUAL(5, report->num_fields);
+    CHECK_EQUAL(8, report->size_in_bits);
+}
+
+TEST(HID, ReportMapCombo){
+    compile_report_map(combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids));
+    CHECK_EQUAL(3, report_map.num_reports);
+    expect_same_fields(5, combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids), HID_REPORT_TYPE_INPUT, combo_report1, sizeof(combo_report1));
+    expect_same_fields(14, combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids), HID_REPORT_TYPE_INPUT, combo_report2, sizeof(combo_report2));
+}
+
+TEST(HID, ReportMapUnknownReportID){
+    const uint8_t report[] = { 0x03, 0x01, 0x02, 0x03 };
+    btstack_hid_report_decoder_t decoder;
+    compile_report_map(combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids));
+    btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, report, sizeof(report));
+    CHECK_EQUAL(false, btstack_hid_report_decoder_has_more(&decoder));
+    btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, report, 0);
+    CHECK_EQUAL(false, btstack_hid_report_decoder_has_more(&decoder));
+}
+
+TEST(HID, ReportMapTruncatedReport){
+    btstack_hid_report_decoder_t decoder;
+    compile_report_map(mouse_descriptor_without_report_id, sizeof(mouse_descriptor_without_report_id));
+    // buttons and X only
+    btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, mouse_report_without_id_negative_xy, 2);
+    int num_fields = 0;
+    while (btstack_hid_report_decoder_has_more(&decoder)){
+        uint16_t usage_page;
+        uint16_t usage;
+        int32_t  value;
+        CHECK_TRUE(btstack_hid_report_decoder_get_field_info(&decoder) != NULL);
+        btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+        num_fields++;
+    }
+    CHECK_EQUAL(4, num_fields);
+}
+
+TEST(HID, ReportMapGetReportSize){
+    compile_report_map(combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids));
+    CHECK_EQUAL(btstack_hid_get_report_size_for_id(1, HID_REPORT_TYPE_INPUT, sizeof(combo_descriptor_with_report_ids), combo_descriptor_with_report_ids),
+                btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_INPUT, 1));
+    CHECK_EQUAL(btstack_hid_get_report_size_for_id(2, HID_REPORT_TYPE_INPUT, sizeof(combo_descriptor_with_report_ids), combo_descriptor_with_report_ids),
+                btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_INPUT, 2));
+    CHECK_EQUAL(btstack_hid_get_report_size_for_id(2, HID_REPORT_TYPE_OUTPUT, sizeof(combo_descriptor_with_report_ids), combo_descriptor_with_report_ids),
+                btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_OUTPUT, 2));
+    CHECK_EQUAL(0, btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_FEATURE, 1));
+
+    compile_report_map(hid_descriptor_keyboard_boot_mode, sizeof(hid_descriptor_keyboard_boot_mode));
+    CHECK_EQUAL(1, btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_OUTPUT, 0));
+    CHECK_EQUAL(8, btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_INPUT, 0));
+}
+
+TEST(HID, ReportMapCapacityExceeded){
+    uint8_t status;
+    status = btstack_hid_report_map_compile(&report_map, report_map_reports, 4, report_map_fields, 13, hid_descriptor_keyboard_boot_mode, sizeof(hid_descriptor_keyboard_boot_mode));
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, status);
+    CHECK_EQUAL(0, report_map.num_reports);
+    status = btstack_hid_report_map_compile(&report_map, report_map_reports, 2, report_map_fields, 40, combo_descriptor_with_report_ids, sizeof(combo_descriptor_with_report_ids));
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, status);
+}
+
+TEST(HID, ReportMapRepeatLastUsage){
+    const uint8_t descriptor[] = {
+        0x05, 0x01,         // Usage Page (Desktop)
+        0x09, 0x30,         // Usage (X)
+        0x15, 0x00,         // Logical Minimum (0)
+        0x26, 0xff, 0x0f,   // Logical Maximum (4095)
+        0x75, 0x0c,         // Report Size (12)
+        0x95, 0x02,         // Report Count (2)
+        0x81, 0x02,         // Input (Variable)
+    };
+    const uint8_t report[] = { 0x23, 0x41, 0xfe };
+    compile_report_map(descriptor, sizeof(descriptor));
+    btstack_hid_report_decoder_t decoder;
+    btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, report, sizeof(report));
+    uint16_t usage_page;
+    uint16_t usage;
+    int32_t  value;
+    btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+    CHECK_EQUAL(0x30, usage);
+    CHECK_EQUAL(0x123, value);
+    btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+    CHECK_EQUAL(0x30, usage);
+    CHECK_EQUAL(0xfe4, value);
+    CHECK_EQUAL(false, btstack_hid_report_decoder_has_more(&decoder));
+}
+
+TEST(HID, ReportMapFieldWiderThan32Bit){
+    const uint8_t descriptor[] = {
+        0x06, 0x00, 0xff,   // Usage Page (Vendor)
+        0x09, 0x01,         // Usage (1)
+        0x75, 0x28,         // Report Size (40)
+        0x95, 0x01,         // Report Count (1)
+        0x81, 0x02,         // Input (Variable)
+        0x05, 0x01,         // Usage Page (Desktop)
+        0x09, 0x30,         // Usage (X)
+        0x15, 0x00,         // Logical Minimum (0)
+        0x25, 0x7f,         // Logical Maximum (127)
+        0x75, 0x08,         // Report Size (8)
+        0x95, 0x01,         // Report Count (1)
+        0x81, 0x02,         // Input (Variable)
+    };
+    const uint8_t report[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0x42 };
+    compile_report_map(descriptor, sizeof(descriptor));
+    // wide field is skipped but counted in report size
+    CHECK_EQUAL(1, report_map.num_fields);
+    CHECK_EQUAL(40, report_map_fields[0].bit_offset);
+    CHECK_EQUAL(6, btstack_hid_report_map_get_report_size(&report_map, HID_REPORT_TYPE_INPUT, 0));
+    btstack_hid_report_decoder_t decoder;
+    btstack_hid_report_decoder_init(&decoder, &report_map, HID_REPORT_TYPE_INPUT, report, sizeof(report));
+    CHECK_TRUE(btstack_hid_report_decoder_has_more(&decoder));
+    uint16_t usage_page;
+    uint16_t usage;
+    int32_t  value;
+    btstack_hid_report_decoder_get_field(&decoder, &usage_page, &usage, &value);
+    CHECK_EQUAL(1, usage_page);
+    CHECK_EQUAL(0x30, usage);
+    CHECK_EQUAL(0x42, value);
+    CHECK_EQUAL(false, btstack_hid_report_decoder_has_more(&decoder));
+}
 
 int main (int argc, const char * argv[]){
     // log into file using HCI_DUMP_PACKETLOGGER format
@@ -29,6 +29,7 @@
 
 // Link Key DB and LE Device DB using TLV on top of Flash Sector interface
 #define NVM_NUM_DEVICE_DB_ENTRIES 16
+#define NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL 16
 
 // BTstack configuration. buffers, sizes, ...
 #define HCI_ACL_PAYLOAD_SIZE 52
@@ -51,10 +51,17 @@
 #include "bluetooth.h"
 #include "btstack_tlv_flash_bank.h"
 #include "hal_flash_bank_memory.h"
+#include "hci.h"
 
 #define HAL_FLASH_BANK_MEMORY_STORAGE_SIZE 4096
 static uint8_t hal_flash_bank_memory_storage[HAL_FLASH_BANK_MEMORY_STORAGE_SIZE];
 
+static btstack_packet_callback_registration_t * hci_event_callback_registration;
+
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    hci_event_callback_registration = callback_handler;
+}
+
 
 TEST_GROUP(LE_DEVICE_DB_TLV){
     const hal_flash_bank_t * hal_flash_bank_impl;
@@ -199,6 +206,138 @@ TEST(LE_DEVICE_DB_TLV, AddExisting){
     CHECK_EQUAL(1, le_device_db_count());
 }
 
+TEST(LE_DEVICE_DB_TLV, LookupByAddress){
+    sm_key_t sm_key_zero;
+    memset(sm_key_zero, 0, 16);
+    int index_aa = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    int index_bb = le_device_db_add(BD_ADDR_TYPE_LE_RANDOM, addr_bb, sm_key_bb);
+    int index_cc = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_cc, sm_key_zero);
+
+    CHECK_EQUAL(index_aa, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr_aa));
+    CHECK_EQUAL(index_bb, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_RANDOM, addr_bb));
+    CHECK_EQUAL(index_cc, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr_cc));
+    CHECK_EQUAL(-1, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_RANDOM, addr_aa));
+
+    le_device_db_remove(index_aa);
+    CHECK_EQUAL(-1, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr_aa));
+
+    // index rebuilt from TLV
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_EQUAL(2, le_device_db_count());
+    CHECK_EQUAL(index_bb, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_RANDOM, addr_bb));
+}
+
+TEST(LE_DEVICE_DB_TLV, AddAll){
+    int indices[NVM_NUM_DEVICE_DB_ENTRIES];
+    uint8_t i;
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        memset(addr, i, 6);
+        memset(sm_key, i + 1, 16);
+        indices[i] = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, sm_key);
+        CHECK_TRUE(indices[i] >= 0);
+    }
+    // replaces least recently added entry
+    CHECK_EQUAL(indices[0], le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa));
+    CHECK_EQUAL(NVM_NUM_DEVICE_DB_ENTRIES, le_device_db_count());
+    memset(addr, 0, 6);
+    CHECK_EQUAL(-1, le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr));
+    CHECK_EQUAL(indices[0], le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr_aa));
+    for (i=1;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        memset(addr, i, 6);
+        CHECK_EQUAL(indices[i], le_device_db_tlv_lookup_by_address(BD_ADDR_TYPE_LE_PUBLIC, addr));
+    }
+}
+
+TEST(LE_DEVICE_DB_TLV, RemoteCounterCoalesced){
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    int write_offset = btstack_tlv_context.write_offset;
+    uint32_t counter;
+    for (counter = 1; counter < NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL; counter++){
+        le_device_db_remote_counter_set(index, counter);
+        CHECK_EQUAL(counter, le_device_db_remote_counter_get(index));
+    }
+    // nothing stored yet
+    CHECK_EQUAL(write_offset, btstack_tlv_context.write_offset);
+    le_device_db_remote_counter_set(index, counter);
+    CHECK(write_offset != btstack_tlv_context.write_offset);
+
+    // flush stores pending counter
+    le_device_db_remote_counter_set(index, counter + 1);
+    le_device_db_tlv_flush();
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_EQUAL(counter + 1, le_device_db_remote_counter_get(index));
+
+    // nothing to flush
+    write_offset = btstack_tlv_context.write_offset;
+    le_device_db_tlv_flush();
+    CHECK_EQUAL(write_offset, btstack_tlv_context.write_offset);
+}
+
+TEST(LE_DEVICE_DB_TLV, DisconnectAndPowerDownFlushRemoteCounter){
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    CHECK(hci_event_callback_registration != NULL);
+
+    le_device_db_remote_counter_set(index, 1);
+    int write_offset = btstack_tlv_context.write_offset;
+    uint8_t disconnection_complete[] = { HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, 0x40, 0x00, 0x13 };
+    (*hci_event_callback_registration->callback)(HCI_EVENT_PACKET, 0, disconnection_complete, sizeof(disconnection_complete));
+    CHECK(write_offset != btstack_tlv_context.write_offset);
+    write_offset = btstack_tlv_context.write_offset;
+
+    le_device_db_remote_counter_set(index, 2);
+    uint8_t state_halting[] = { BTSTACK_EVENT_STATE, 1, HCI_STATE_HALTING };
+    (*hci_event_callback_registration->callback)(HCI_EVENT_PACKET, 0, state_halting, sizeof(state_halting));
+    CHECK(write_offset != btstack_tlv_context.write_offset);
+
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_EQUAL(2, le_device_db_remote_counter_get(index));
+}
+
+TEST(LE_DEVICE_DB_TLV, CounterPowerLoss){
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    uint32_t counter;
+    for (counter = 1; counter <= 100; counter++){
+        le_device_db_local_counter_set(index, counter);
+        le_device_db_remote_counter_set(index, counter);
+
+        // simulate reset without flush: restore from flash
+        btstack_tlv_flash_bank_t tlv_context_after_reset;
+        const btstack_tlv_t * tlv_impl_after_reset = btstack_tlv_flash_bank_init_instance(&tlv_context_after_reset, hal_flash_bank_impl, &hal_flash_bank_context);
+        btstack_tlv_flash_bank_t tlv_context_before_reset = btstack_tlv_context;
+        le_device_db_tlv_configure(tlv_impl_after_reset, &tlv_context_after_reset);
+
+        // local counter is never used twice
+        CHECK(le_device_db_local_counter_get(index) >= counter);
+        CHECK(le_device_db_local_counter_get(index) < counter + NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL);
+        // remote counter lags behind by less than persist interval
+        CHECK(le_device_db_remote_counter_get(index) <= counter);
+        CHECK(le_device_db_remote_counter_get(index) + NVM_LE_DEVICE_DB_COUNTER_PERSIST_INTERVAL > counter);
+
+        // continue without reset
+        btstack_tlv_context = tlv_context_before_reset;
+        le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+        le_device_db_local_counter_set(index, counter);
+        le_device_db_remote_counter_set(index, counter);
+    }
+}
+
+TEST(LE_DEVICE_DB_TLV, EncryptionKeepsLocalCounterReservation){
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    le_device_db_local_counter_set(index, 5);
+    uint8_t rand[8];
+    memset(rand, 0x12, 8);
+    le_device_db_encryption_set(index, 0x1234, rand, sm_key_bb, 16, 1, 0, 1);
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK(le_device_db_local_counter_get(index) >= 5);
+    uint16_t ediv = 0;
+    sm_key_t ltk;
+    int key_size = 0;
+    le_device_db_encryption_get(index, &ediv, NULL, ltk, &key_size, NULL, NULL, NULL);
+    CHECK_EQUAL(0x1234, ediv);
+    CHECK_EQUAL(16, key_size);
+    MEMCMP_EQUAL(sm_key_bb, ltk, 16);
+}
+
 
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
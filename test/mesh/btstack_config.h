@@ -27,6 +27,7 @@
 #define ENABLE_MESH_PB_GATT
 #define ENABLE_MESH_PROXY_SERVER
 #define ENABLE_MESH_RELAY
+#define ENABLE_MESH_FRIEND
 
 #define ENABLE_MESH
 #define ENABLE_MESH_PROVISIONER
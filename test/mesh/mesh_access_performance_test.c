@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+// *****************************************************************************
+//
+// Mesh Access Layer dispatch performance test
+//
+// Sets up a node with four elements and the operation tables of typical
+// models: Configuration Server and Health Server on the primary element,
+// Generic OnOff Server, Generic Level Server and a vendor model on each element.
+// Access messages to unicast, fixed group and group addresses are passed to
+// the Access Layer as received from the Upper Transport Layer and the number
+// of messages dispatched per second is reported.
+//
+// Build with -DMESH_NODE_OPCODE_TABLE_SIZE=1 for reference: the opcode table
+// overflows and the Access Layer iterates over all models.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bluetooth_company_id.h"
+#include "btstack_debug.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "mesh/adv_bearer.h"
+#include "mesh/gatt_bearer.h"
+#include "mesh/mesh.h"
+#include "mesh/mesh_access.h"
+#include "mesh/mesh_foundation.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_node.h"
+#include "mesh/mesh_upper_transport.h"
+#include "perf_timer.h"
+
+#define NUM_ITERATIONS              1000000
+#define NUM_ELEMENTS                4
+#define NUM_CONFIGURATION_OPCODES   47
+#define NUM_HEALTH_OPCODES          11
+#define VENDOR_COMPANY_ID           BLUETOOTH_COMPANY_ID_BLUEKITCHEN_GMBH
+
+#define PRIMARY_ELEMENT_ADDRESS     0x0100
+#define GROUP_ADDRESS               0xc000
+
+typedef struct {
+    const char * name;
+    uint8_t      num_handlers;
+    uint16_t     dst;
+    uint8_t      len;
+    uint8_t      data[8];
+} message_template_t;
+
+static const message_template_t message_templates[] = {
+    { "Config Beacon Get",        1, PRIMARY_ELEMENT_ADDRESS,     2, { 0x80, 0x09 } },
+    { "Generic OnOff Get",        1, PRIMARY_ELEMENT_ADDRESS + 3, 2, { 0x82, 0x01 } },
+    { "Generic Level Set",        1, PRIMARY_ELEMENT_ADDRESS + 2, 5, { 0x82, 0x06, 0x34, 0x12, 0x01 } },
+    { "Vendor Message",           1, PRIMARY_ELEMENT_ADDRESS + 1, 4, { 0xc1, 0x8f, 0x04, 0x55 } },
+    { "Generic OnOff Set Group",  3, GROUP_ADDRESS,               4, { 0x82, 0x02, 0x01, 0x02 } },
+    { "Health Message All Nodes", 1, MESH_ADDRESS_ALL_NODES,      2, { 0x80, 0x41 } },
+    { "Unknown Opcode",           0, PRIMARY_ELEMENT_ADDRESS + 3, 2, { 0x82, 0x7f } },
+};
+
+#define NUM_MESSAGE_TEMPLATES (sizeof(message_templates) / sizeof(message_template_t))
+
+static mesh_operation_t configuration_server_operations[NUM_CONFIGURATION_OPCODES + 1];
+static mesh_operation_t health_server_operations[NUM_HEALTH_OPCODES + 1];
+static mesh_operation_t generic_on_off_server_operations[4];
+static mesh_operation_t generic_level_server_operations[8];
+static mesh_operation_t vendor_operations[3];
+
+static mesh_element_t secondary_elements[NUM_ELEMENTS - 1];
+static mesh_model_t   configuration_server_model;
+static mesh_model_t   health_server_model;
+static mesh_model_t   generic_on_off_server_models[NUM_ELEMENTS];
+static mesh_model_t   generic_level_server_models[NUM_ELEMENTS];
+static mesh_model_t   vendor_models[NUM_ELEMENTS];
+
+static void (*access_message_handler)(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
+static mesh_access_pdu_t access_pdu;
+static uint32_t messages_handled;
+static uint32_t messages_processed;
+
+static void operation_handler(mesh_model_t * mesh_model, mesh_pdu_t * pdu){
+    UNUSED(mesh_model);
+    messages_handled++;
+    mesh_access_message_processed(pdu);
+}
+
+static void operations_init(mesh_operation_t * operations, uint16_t num_operations, uint32_t first_opcode){
+    uint16_t i;
+    for (i = 0; i < num_operations; i++){
+        operations[i].opcode = first_opcode + i;
+        operations[i].minimum_length = 0;
+        operations[i].handler = &operation_handler;
+    }
+    operations[num_operations].handler = NULL;
+}
+
+static void model_init(mesh_element_t * element, mesh_model_t * model, uint32_t model_identifier, const mesh_operation_t * operations){
+    model->model_identifier = model_identifier;
+    model->operations = operations;
+    mesh_element_add_model(element, model);
+    mesh_model_reset_appkeys(model);
+    model->appkey_indices[0] = 0;
+    uint16_t i;
+    for (i = 0; i < MAX_NR_MESH_SUBSCRIPTION_PER_MODEL; i++){
+        model->subscriptions[i] = MESH_ADDRESS_UNSASSIGNED;
+    }
+}
+
+static void node_init(void){
+    // Config Server 0x8008.., Health Server 0x8040.., Generic OnOff 0x8201.., Generic Level 0x8205..
+    operations_init(configuration_server_operations, NUM_CONFIGURATION_OPCODES, 0x8008);
+    operations_init(health_server_operations, NUM_HEALTH_OPCODES, 0x8040);
+    operations_init(generic_on_off_server_operations, 3, 0x8201);
+    operations_init(generic_level_server_operations, 7, 0x8205);
+    operations_init(vendor_operations, 2, 0);
+    vendor_operations[0].opcode = 0xc10000u | VENDOR_COMPANY_ID;
+    vendor_operations[1].opcode = 0xc20000u | VENDOR_COMPANY_ID;
+    generic_level_server_operations[1].minimum_length = 3;
+
+    mesh_node_init();
+    mesh_node_primary_element_address_set(PRIMARY_ELEMENT_ADDRESS);
+    uint16_t i;
+    for (i = 0; i < (NUM_ELEMENTS - 1); i++){
+        mesh_node_add_element(&secondary_elements[i]);
+    }
+    mesh_element_t * primary_element = mesh_node_get_primary_element();
+    model_init(primary_element, &configuration_server_model, mesh_model_get_model_identifier_bluetooth_sig(MESH_SIG_MODEL_ID_CONFIGURATION_SERVER), configuration_server_operations);
+    model_init(primary_element, &health_server_model, mesh_model_get_model_identifier_bluetooth_sig(MESH_SIG_MODEL_ID_HEALTH_SERVER), health_server_operations);
+    for (i = 0; i < NUM_ELEMENTS; i++){
+        mesh_element_t * element = mesh_node_element_for_index(i);
+        model_init(element, &generic_on_off_server_models[i], mesh_model_get_model_identifier_bluetooth_sig(MESH_SIG_MODEL_ID_GENERIC_ON_OFF_SERVER), generic_on_off_server_operations);
+        model_init(element, &generic_level_server_models[i], mesh_model_get_model_identifier_bluetooth_sig(MESH_SIG_MODEL_ID_GENERIC_LEVEL_SERVER), generic_level_server_operations);
+        model_init(element, &vendor_models[i], mesh_model_get_model_identifier(VENDOR_COMPANY_ID, 0x0001), vendor_operations);
+        // Generic OnOff Servers of secondary elements subscribed to group
+        if (i > 0){
+            generic_on_off_server_models[i].subscriptions[0] = GROUP_ADDRESS;
+        }
+    }
+}
+
+// returns duration in us for NUM_ITERATIONS messages
+static uint32_t benchmark(const message_template_t * message_template){
+    memset(&access_pdu, 0, sizeof(access_pdu));
+    access_pdu.pdu_header.pdu_type = MESH_PDU_TYPE_ACCESS;
+    access_pdu.src = 0x0001;
+    access_pdu.dst = message_template->dst;
+    access_pdu.appkey_index = 0;
+    access_pdu.len = message_template->len;
+    (void)memcpy(access_pdu.data, message_template->data, message_template->len);
+
+    messages_handled = 0;
+    messages_processed = 0;
+    uint32_t start_us = perf_timer_get_time_us();
+    uint32_t i;
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        (*access_message_handler)(MESH_TRANSPORT_PDU_RECEIVED, MESH_TRANSPORT_STATUS_SUCCESS, (mesh_pdu_t *) &access_pdu);
+    }
+    return perf_timer_get_time_us() - start_us;
+}
+
+// Upper Transport Layer
+void mesh_upper_transport_register_access_message_handler(void (*callback)(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu)){
+    access_message_handler = callback;
+}
+
+void mesh_upper_transport_message_processed_by_higher_layer(mesh_pdu_t * pdu){
+    UNUSED(pdu);
+    messages_processed++;
+}
+
+void mesh_upper_transport_request_to_send(btstack_context_callback_registration_t * request){
+    UNUSED(request);
+}
+
+// Mesh
+int mesh_model_contains_appkey(mesh_model_t * mesh_model, uint16_t appkey_index){
+    uint16_t i;
+    for (i = 0; i < MAX_NR_MESH_APPKEYS_PER_MODEL; i++){
+        if (mesh_model->appkey_indices[i] == appkey_index) return 1;
+    }
+    return 0;
+}
+
+int main (int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    btstack_memory_init();
+    mesh_access_init();
+    node_init();
+
+    uint16_t num_models = 0;
+    mesh_element_iterator_t it;
+    mesh_element_iterator_init(&it);
+    while (mesh_element_iterator_has_next(&it)){
+        mesh_element_t * element = mesh_element_iterator_next(&it);
+        num_models += element->models_count_sig + element->models_count_vendor;
+    }
+
+    printf("%u elements, %u models, %u messages per type, opcode table %s\n", NUM_ELEMENTS, num_models, NUM_ITERATIONS,
+           mesh_node_opcode_table_complete() ? "complete" : "overflow");
+    printf("  %-25s %12s %10s %10s\n", "", "messages/s", "per msg", "handlers");
+    uint64_t total_us = 0;
+    unsigned int i;
+    for (i = 0; i < NUM_MESSAGE_TEMPLATES; i++){
+        uint32_t duration_us = benchmark(&message_templates[i]);
+        total_us += duration_us;
+        if ((messages_processed != NUM_ITERATIONS) || (messages_handled != (message_templates[i].num_handlers * NUM_ITERATIONS))){
+            printf("%s: %u of %u messages processed, %u handler calls\n", message_templates[i].name, messages_processed, NUM_ITERATIONS, messages_handled);
+            return 1;
+        }
+        printf("  %-25s %12u %7u ns %10u\n", message_templates[i].name,
+               (uint32_t) ((uint64_t) NUM_ITERATIONS * 1000000u / btstack_max(duration_us, 1)),
+               (uint32_t) ((uint64_t) duration_us * 1000u / NUM_ITERATIONS), messages_handled / NUM_ITERATIONS);
+    }
+    printf("  %-25s %12u\n", "average", (uint32_t) ((uint64_t) NUM_ITERATIONS * NUM_MESSAGE_TEMPLATES * 1000000u / total_us));
+    return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_util.h"
+#include "mesh/adv_bearer.h"
+#include "mesh/gatt_bearer.h"
+#include "mesh/mesh_access.h"
+#include "mesh/mesh_foundation.h"
+#include "mesh/mesh_node.h"
+#include "mesh/mesh_upper_transport.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "mock.h"
+
+// GDTT: number of steps in bits 0..5, step resolution in bits 6..7
+#define PERIOD_100MS(steps)     (0x00u | (steps))
+#define PERIOD_1S(steps)        (0x40u | (steps))
+
+// Publish Retransmit: count in bits 0..2, interval steps in bits 3..7, 50 ms each
+#define RETRANSMIT(count, interval_steps) ((uint8_t)(((interval_steps) << 3) | (count)))
+
+#define MAX_REQUESTS 2000
+
+// models used by load tests, scheduler has no fixed limit
+#define NUM_MODELS      64
+#define NUM_LOAD_MODELS 16
+
+static mesh_model_t             models[NUM_MODELS];
+static mesh_publication_model_t publication_models[NUM_MODELS];
+
+static uint32_t request_time_ms[NUM_MODELS][MAX_REQUESTS];
+static uint16_t num_requests[NUM_MODELS];
+
+static void (*access_message_handler)(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
+
+// model on primary element that counts received messages
+static mesh_model_t receiver_model;
+static uint16_t     num_received_messages;
+
+// Upper Transport Layer: record time of publication requests per model
+void mesh_upper_transport_request_to_send(btstack_context_callback_registration_t * request){
+    mesh_model_t * mesh_model = (mesh_model_t *) request->context;
+    uint16_t index = (uint16_t) (mesh_model - models);
+    if (num_requests[index] == MAX_REQUESTS) return;
+    request_time_ms[index][num_requests[index]++] = btstack_run_loop_get_time_ms();
+}
+
+void mesh_upper_transport_register_access_message_handler(void (*callback)(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu)){
+    access_message_handler = callback;
+}
+
+void mesh_upper_transport_message_processed_by_higher_layer(mesh_pdu_t * pdu){
+    UNUSED(pdu);
+}
+
+extern "C" int mesh_model_contains_appkey(mesh_model_t * mesh_model, uint16_t appkey_index){
+    UNUSED(mesh_model);
+    UNUSED(appkey_index);
+    return 1;
+}
+
+static void model_setup(uint16_t index, uint8_t period, uint8_t retransmit){
+    memset(&publication_models[index], 0, sizeof(mesh_publication_model_t));
+    publication_models[index].address = 0xc000;
+    publication_models[index].period = period;
+    publication_models[index].retransmit = retransmit;
+    models[index].publication_model = &publication_models[index];
+}
+
+// compare recorded requests with publications at multiples of the period, each followed by its retransmissions
+static void check_schedule(uint16_t index, uint32_t start_ms, uint32_t end_ms){
+    uint8_t  period = publication_models[index].period;
+    uint8_t  retransmit = publication_models[index].retransmit;
+    uint32_t period_ms = mesh_access_time_gdtt2ms(period);
+    uint32_t retransmit_count = retransmit & 0x07u;
+    uint32_t retransmit_interval_ms = ((retransmit >> 3) + 1u) * 50u;
+    uint16_t num_expected = 0;
+    uint32_t publication_ms;
+    for (publication_ms = start_ms; publication_ms <= end_ms; publication_ms += period_ms){
+        uint32_t i;
+        for (i = 0; i <= retransmit_count; i++){
+            uint32_t expected_ms = publication_ms + (i * retransmit_interval_ms);
+            if (expected_ms > end_ms) break;
+            CHECK(num_expected < num_requests[index]);
+            CHECK_EQUAL(expected_ms, request_time_ms[index][num_expected]);
+            num_expected++;
+        }
+    }
+    CHECK_EQUAL(num_expected, num_requests[index]);
+}
+
+TEST_GROUP(MeshAccessPublication){
+    void setup(void){
+        mock_init();
+        memset(models, 0, sizeof(models));
+        memset(num_requests, 0, sizeof(num_requests));
+    }
+    void teardown(void){
+        uint16_t i;
+        for (i = 0; i < NUM_MODELS; i++){
+            if (models[i].publication_model == NULL) continue;
+            mesh_model_publication_stop(&models[i]);
+        }
+    }
+};
+
+TEST(MeshAccessPublication, Periodic){
+    model_setup(0, PERIOD_100MS(7), 0);
+    mesh_model_publication_start(&models[0]);
+    mock_run_loop_advance_time_ms(10000);
+    check_schedule(0, 0, 10000);
+    CHECK_EQUAL(10000 / 700, mock_run_loop_get_num_timeouts());
+}
+
+TEST(MeshAccessPublication, Retransmissions){
+    model_setup(0, PERIOD_1S(2), RETRANSMIT(3, 1));
+    mesh_model_publication_start(&models[0]);
+    mock_run_loop_advance_time_ms(20000);
+    check_schedule(0, 0, 20000);
+}
+
+TEST(MeshAccessPublication, Batched){
+    uint16_t i;
+    for (i = 0; i < 4; i++){
+        model_setup(i, PERIOD_1S(1), 0);
+        mesh_model_publication_start(&models[i]);
+    }
+    mock_run_loop_advance_time_ms(10000);
+    for (i = 0; i < 4; i++){
+        check_schedule(i, 0, 10000);
+    }
+    // all due publications handled by a single timeout
+    CHECK_EQUAL(10, mock_run_loop_get_num_timeouts());
+}
+
+TEST(MeshAccessPublication, Load){
+    // all models with different periods and retransmissions, retransmissions complete before next publication
+    uint16_t i;
+    for (i = 0; i < NUM_LOAD_MODELS; i++){
+        uint8_t period = ((i & 1u) == 0u) ? PERIOD_100MS(5u + i) : PERIOD_1S(1u + (i / 4u));
+        model_setup(i, period, RETRANSMIT(i % 4u, i % 3u));
+    }
+    // start models at different times
+    for (i = 0; i < NUM_LOAD_MODELS; i++){
+        mesh_model_publication_start(&models[i]);
+        mock_run_loop_advance_time_ms(10);
+    }
+    uint32_t end_ms = 120000;
+    mock_run_loop_advance_time_ms(end_ms - (NUM_LOAD_MODELS * 10));
+    for (i = 0; i < NUM_LOAD_MODELS; i++){
+        check_schedule(i, i * 10u, end_ms);
+    }
+}
+
+TEST(MeshAccessPublication, ManyModels){
+    // more models than a fixed size heap would hold, stop every other model while others are scheduled
+    uint16_t i;
+    for (i = 0; i < NUM_MODELS; i++){
+        model_setup(i, PERIOD_100MS(5u + (i % 32u)), RETRANSMIT(i % 4u, i % 3u));
+    }
+    for (i = 0; i < NUM_MODELS; i++){
+        mesh_model_publication_start(&models[i]);
+        mock_run_loop_advance_time_ms(10);
+    }
+    uint32_t stop_ms = 60005;
+    mock_run_loop_advance_time_ms(stop_ms - (NUM_MODELS * 10));
+    for (i = 1; i < NUM_MODELS; i += 2){
+        mesh_model_publication_stop(&models[i]);
+    }
+    uint32_t end_ms = 120000;
+    mock_run_loop_advance_time_ms(end_ms - stop_ms);
+    for (i = 0; i < NUM_MODELS; i++){
+        check_schedule(i, i * 10u, ((i & 1u) == 0u) ? end_ms : stop_ms);
+    }
+}
+
+TEST(MeshAccessPublication, Stop){
+    model_setup(0, PERIOD_1S(1), 0);
+    model_setup(1, PERIOD_1S(1), RETRANSMIT(2, 0));
+    mesh_model_publication_start(&models[0]);
+    mesh_model_publication_start(&models[1]);
+    mock_run_loop_advance_time_ms(5500);
+    mesh_model_publication_stop(&models[1]);
+    mock_run_loop_advance_time_ms(4500);
+    check_schedule(0, 0, 10000);
+    check_schedule(1, 0, 5500);
+}
+
+TEST(MeshAccessPublication, StateChanged){
+    model_setup(0, PERIOD_1S(10), 0);
+    mesh_model_publication_start(&models[0]);
+    mock_run_loop_advance_time_ms(3000);
+    mesh_access_state_changed(&models[0]);
+    mock_run_loop_advance_time_ms(20000);
+    CHECK_EQUAL(4, num_requests[0]);
+    CHECK_EQUAL(0,     request_time_ms[0][0]);
+    CHECK_EQUAL(3000,  request_time_ms[0][1]);
+    CHECK_EQUAL(13000, request_time_ms[0][2]);
+    CHECK_EQUAL(23000, request_time_ms[0][3]);
+}
+
+static void receiver_handler(mesh_model_t * mesh_model, mesh_pdu_t * pdu){
+    UNUSED(mesh_model);
+    num_received_messages++;
+    mesh_access_message_processed(pdu);
+}
+
+static const mesh_operation_t receiver_operations[] = {
+    { 0x8201, 0, receiver_handler },
+    { 0, 0, NULL }
+};
+
+static uint16_t receive_message(uint16_t dst){
+    mesh_access_pdu_t access_pdu;
+    memset(&access_pdu, 0, sizeof(access_pdu));
+    access_pdu.pdu_header.pdu_type = MESH_PDU_TYPE_ACCESS;
+    access_pdu.src = 0x0002;
+    access_pdu.dst = dst;
+    access_pdu.appkey_index = MESH_DEVICE_KEY_INDEX;
+    access_pdu.data[0] = 0x82;
+    access_pdu.data[1] = 0x01;
+    access_pdu.len = 2;
+    num_received_messages = 0;
+    (*access_message_handler)(MESH_TRANSPORT_PDU_RECEIVED, MESH_TRANSPORT_STATUS_SUCCESS, (mesh_pdu_t *) &access_pdu);
+    return num_received_messages;
+}
+
+TEST_GROUP(MeshAccessFixedGroupAddress){
+    void setup(void){
+        static bool model_added = false;
+        mock_init();
+        if (model_added == false){
+            mesh_node_init();
+            receiver_model.model_identifier = mesh_model_get_model_identifier_bluetooth_sig(0x1000);
+            receiver_model.operations = receiver_operations;
+            mesh_element_add_model(mesh_node_get_primary_element(), &receiver_model);
+            model_added = true;
+        }
+        mesh_access_init();
+        mesh_foundation_gatt_proxy_set(0);
+        mesh_foundation_friend_set(0);
+        mesh_foundation_relay_set(0);
+    }
+};
+
+// delivered to primary element only if the corresponding feature is enabled
+TEST(MeshAccessFixedGroupAddress, FeatureDisabled){
+    CHECK_EQUAL(0, receive_message(MESH_ADDRESS_ALL_PROXIES));
+    CHECK_EQUAL(0, receive_message(MESH_ADDRESS_ALL_FRIENDS));
+    CHECK_EQUAL(0, receive_message(MESH_ADDRESS_ALL_RELAYS));
+    CHECK_EQUAL(1, receive_message(MESH_ADDRESS_ALL_NODES));
+    // reserved fixed group address
+    CHECK_EQUAL(0, receive_message(0xff00));
+}
+
+TEST(MeshAccessFixedGroupAddress, FeatureEnabled){
+    mesh_foundation_gatt_proxy_set(1);
+    mesh_foundation_friend_set(1);
+    mesh_foundation_relay_set(1);
+    CHECK_EQUAL(1, receive_message(MESH_ADDRESS_ALL_PROXIES));
+    CHECK_EQUAL(1, receive_message(MESH_ADDRESS_ALL_FRIENDS));
+    CHECK_EQUAL(1, receive_message(MESH_ADDRESS_ALL_RELAYS));
+    CHECK_EQUAL(1, receive_message(MESH_ADDRESS_ALL_NODES));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
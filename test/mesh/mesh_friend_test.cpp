@@ -0,0 +1,919 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Mesh Friend test
+//
+// The Friend node under test runs the real Lower Transport Layer and Friend feature
+// on top of a Network Layer stub. A simulated Low Power Node establishes a friendship,
+// polls the Friend node and only listens during the Receive Window. Messages from
+// other nodes are injected as received Network PDUs.
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_crypto.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "mesh/mesh_crypto.h"
+#include "mesh/mesh_foundation.h"
+#include "mesh/mesh_friend.h"
+#include "mesh/mesh_iv_index_seq_number.h"
+#include "mesh/mesh_keys.h"
+#include "mesh/mesh_lower_transport.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_node.h"
+#include "mesh/mesh_peer.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "mock.h"
+
+// addresses from Mesh Profile sample data: Friend Request from 0x1201, Friend Offer from 0x2345
+#define FRIEND_ADDRESS          0x2345
+#define LPN_ADDRESS             0x1201
+#define OTHER_NODE_ADDRESS      0x0300
+#define THIRD_NODE_ADDRESS      0x0310
+#define PREVIOUS_FRIEND_ADDRESS 0x0400
+
+// Criteria: RSSIFactor 2, ReceiveWindowFactor 1, MinQueueSizeLog 3
+#define LPN_CRITERIA            0x4b
+#define LPN_RECEIVE_DELAY_MS    100
+
+// LPN radio on-time for a single Network PDU on the ADV bearer
+#define PDU_AIRTIME_MS          1
+
+#define MAX_SENT_MESSAGES       256
+
+typedef struct {
+    uint32_t time_ms;
+    bool     friendship;
+    uint16_t lpn_address;
+    uint8_t  data[29];
+    uint8_t  len;
+} sent_message_t;
+
+static void (*lower_transport_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu);
+static void (*outgoing_message_handler)(mesh_network_pdu_t * network_pdu);
+static btstack_linked_list_t bearer_queue;
+
+static sent_message_t sent_messages[MAX_SENT_MESSAGES];
+static uint16_t       num_sent_messages;
+
+static mesh_network_key_t test_network_key;
+static mesh_subnet_t      test_subnet;
+
+static uint32_t seq_lpn;
+static uint32_t seq_other_node;
+static uint32_t seq_previous_friend;
+
+static btstack_crypto_aes128_cmac_t k2_request;
+static uint8_t k2_result[33];
+static bool    k2_done;
+
+// Network Layer stub
+void mesh_network_set_higher_layer_handler(void (*packet_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu)){
+    lower_transport_handler = packet_handler;
+}
+
+static void network_record_pdu(mesh_network_pdu_t * network_pdu){
+    CHECK(num_sent_messages < MAX_SENT_MESSAGES);
+    sent_message_t * message = &sent_messages[num_sent_messages++];
+    message->time_ms = btstack_run_loop_get_time_ms();
+    message->friendship = (network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0;
+    message->lpn_address = network_pdu->lpn_address;
+    message->len = network_pdu->len;
+    (void) memcpy(message->data, network_pdu->data, network_pdu->len);
+    btstack_linked_list_add_tail(&bearer_queue, (btstack_linked_item_t *) network_pdu);
+}
+
+void mesh_network_set_outgoing_message_handler(void (*handler)(mesh_network_pdu_t * network_pdu)){
+    outgoing_message_handler = handler;
+}
+
+void mesh_network_send_pdu(mesh_network_pdu_t * network_pdu){
+    if (outgoing_message_handler != NULL){
+        (*outgoing_message_handler)(network_pdu);
+    }
+    network_record_pdu(network_pdu);
+}
+
+void mesh_network_send_pdu_with_friendship_credentials(mesh_network_pdu_t * network_pdu, uint16_t lpn_address){
+    network_pdu->flags |= MESH_NETWORK_PDU_FLAGS_FRIENDSHIP;
+    network_pdu->lpn_address = lpn_address;
+    network_record_pdu(network_pdu);
+}
+
+void mesh_network_message_processed_by_higher_layer(mesh_network_pdu_t * network_pdu){
+    btstack_memory_mesh_network_pdu_free(network_pdu);
+}
+
+mesh_network_pdu_t * mesh_network_pdu_get(void){
+    mesh_network_pdu_t * network_pdu = btstack_memory_mesh_network_pdu_get();
+    if (network_pdu) {
+        memset(network_pdu, 0, sizeof(mesh_network_pdu_t));
+        network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_NETWORK;
+    }
+    return network_pdu;
+}
+
+void mesh_network_pdu_free(mesh_network_pdu_t * network_pdu){
+    btstack_memory_mesh_network_pdu_free(network_pdu);
+}
+
+void mesh_network_setup_pdu(mesh_network_pdu_t * network_pdu, uint16_t netkey_index, uint8_t nid, uint8_t ctl, uint8_t ttl, uint32_t seq, uint16_t src, uint16_t dest, const uint8_t * transport_pdu_data, uint8_t transport_pdu_len){
+    network_pdu->netkey_index = netkey_index;
+    network_pdu->data[0] = nid;
+    network_pdu->data[1] = (ctl << 7) | (ttl & 0x7f);
+    big_endian_store_24(network_pdu->data, 2, seq);
+    big_endian_store_16(network_pdu->data, 5, src);
+    big_endian_store_16(network_pdu->data, 7, dest);
+    (void) memcpy(&network_pdu->data[9], transport_pdu_data, transport_pdu_len);
+    network_pdu->len = 9 + transport_pdu_len;
+}
+
+mesh_subnet_t * mesh_subnet_get_by_netkey_index(uint16_t netkey_index){
+    if (netkey_index != test_subnet.netkey_index) return NULL;
+    return &test_subnet;
+}
+
+mesh_network_key_t * mesh_subnet_get_outgoing_network_key(mesh_subnet_t * subnet){
+    return subnet->old_key;
+}
+
+int mesh_network_address_unicast(uint16_t addr){
+    return (addr != MESH_ADDRESS_UNSASSIGNED) && (addr < 0x8000);
+}
+
+uint16_t mesh_network_control(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[1] & 0x80;
+}
+
+uint8_t mesh_network_ttl(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[1] & 0x7f;
+}
+
+uint32_t mesh_network_seq(mesh_network_pdu_t * network_pdu){
+    return big_endian_read_24(network_pdu->data, 2);
+}
+
+uint16_t mesh_network_src(mesh_network_pdu_t * network_pdu){
+    return big_endian_read_16(network_pdu->data, 5);
+}
+
+uint16_t mesh_network_dst(mesh_network_pdu_t * network_pdu){
+    return big_endian_read_16(network_pdu->data, 7);
+}
+
+int mesh_network_segmented(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[9] & 0x80;
+}
+
+uint8_t mesh_network_control_opcode(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[9] & 0x7f;
+}
+
+uint8_t * mesh_network_pdu_data(mesh_network_pdu_t * network_pdu){
+    return &network_pdu->data[9];
+}
+
+uint8_t mesh_network_pdu_len(mesh_network_pdu_t * network_pdu){
+    return network_pdu->len - 9;
+}
+
+// Upper Transport Layer stub
+static void test_lower_transport_higher_layer_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
+    UNUSED(status);
+    if ((callback_type == MESH_TRANSPORT_PDU_SENT) && (pdu->pdu_type == MESH_PDU_TYPE_UPPER_UNSEGMENTED_ACCESS)){
+        mesh_network_pdu_free((mesh_network_pdu_t *) pdu);
+        return;
+    }
+    if (callback_type != MESH_TRANSPORT_PDU_RECEIVED) return;
+    mesh_lower_transport_message_processed_by_higher_layer(pdu);
+}
+
+static void process(void){
+    while (mock_process_hci_cmd()){
+    }
+    // report sent network pdus to Lower Transport
+    while (!btstack_linked_list_empty(&bearer_queue)){
+        mesh_network_pdu_t * network_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&bearer_queue);
+        (*lower_transport_handler)(MESH_NETWORK_PDU_SENT, network_pdu);
+    }
+}
+
+static void run(uint32_t time_ms){
+    process();
+    mock_run_loop_advance_time_ms(time_ms);
+    process();
+}
+
+static bool receive(uint16_t src, uint32_t seq, uint16_t dst, uint8_t ctl, uint8_t ttl, bool friendship, const uint8_t * data, uint8_t len){
+    // messages with friendship security credentials can only be decrypted while friendship exists
+    if (friendship && (mesh_network_key_friendship_get(0, src) == NULL)) return false;
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    if (network_pdu == NULL) return false;
+    mesh_network_setup_pdu(network_pdu, 0, 0x68, ctl, ttl, seq, src, dst, data, len);
+    if (friendship){
+        network_pdu->flags |= MESH_NETWORK_PDU_FLAGS_FRIENDSHIP;
+        network_pdu->lpn_address = src;
+    }
+    (*lower_transport_handler)(MESH_NETWORK_PDU_RECEIVED, network_pdu);
+    process();
+    return true;
+}
+
+// simulated Low Power Node
+static void lpn_send_request(uint8_t criteria, uint8_t receive_delay_ms, uint32_t poll_timeout, uint16_t previous_address, uint16_t lpn_counter){
+    uint8_t request[11];
+    request[0] = MESH_TRANSPORT_OPCODE_FRIEND_REQUEST;
+    request[1] = criteria;
+    request[2] = receive_delay_ms;
+    big_endian_store_24(request, 3, poll_timeout);
+    big_endian_store_16(request, 6, previous_address);
+    request[8] = 1;
+    big_endian_store_16(request, 9, lpn_counter);
+    receive(LPN_ADDRESS, ++seq_lpn, MESH_ADDRESS_ALL_FRIENDS, 1, 0, false, request, sizeof(request));
+}
+
+static bool lpn_send_control(const uint8_t * data, uint8_t len){
+    return receive(LPN_ADDRESS, ++seq_lpn, FRIEND_ADDRESS, 1, 0, true, data, len);
+}
+
+static bool lpn_send_poll(uint8_t fsn){
+    uint8_t poll[2] = { MESH_TRANSPORT_OPCODE_FRIEND_POLL, fsn };
+    return lpn_send_control(poll, sizeof(poll));
+}
+
+static void other_node_send_message(uint16_t dst, uint8_t value){
+    // unsegmented access message, AKF = 0
+    uint8_t access[5] = { 0x00, value, 0x11, 0x22, 0x33 };
+    receive(OTHER_NODE_ADDRESS, ++seq_other_node, dst, 0, 5, false, access, sizeof(access));
+}
+
+static void node_send_segment(uint16_t src, uint16_t dst, uint16_t seq_zero, uint8_t seg_o, uint8_t seg_n){
+    // segmented access message, AKF = 0, SZMIC = 0, 12 bytes per segment
+    uint8_t segment[16];
+    segment[0] = 0x80;
+    big_endian_store_24(segment, 1, ((uint32_t) seq_zero << 10) | ((uint32_t) seg_o << 5) | seg_n);
+    memset(&segment[4], seg_o, 12);
+    receive(src, ++seq_other_node, dst, 0, 5, false, segment, sizeof(segment));
+}
+
+static void other_node_send_segment(uint16_t dst, uint16_t seq_zero, uint8_t seg_o, uint8_t seg_n){
+    node_send_segment(OTHER_NODE_ADDRESS, dst, seq_zero, seg_o, seg_n);
+}
+
+// unsegmented access message sent by Friend node itself
+static void friend_send_message(uint16_t dst, uint8_t value){
+    uint8_t access[5] = { 0x00, value, 0x11, 0x22, 0x33 };
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    CHECK(network_pdu != NULL);
+    mesh_network_setup_pdu(network_pdu, 0, 0x68, 0, 5, mesh_sequence_number_next(), FRIEND_ADDRESS, dst, access, sizeof(access));
+    network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_UPPER_UNSEGMENTED_ACCESS;
+    mesh_lower_transport_send_pdu((mesh_pdu_t *) network_pdu);
+    process();
+}
+
+static void parse_hex(const char * string, uint16_t len, uint8_t * buffer){
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        buffer[i] = (uint8_t) ((nibble_for_char(string[2*i]) << 4) | nibble_for_char(string[2*i+1]));
+    }
+}
+
+static const sent_message_t * last_sent_message(void){
+    if (num_sent_messages == 0) return NULL;
+    return &sent_messages[num_sent_messages - 1];
+}
+
+static uint16_t sent_src(const sent_message_t * message){
+    return big_endian_read_16(message->data, 5);
+}
+
+static uint16_t sent_dst(const sent_message_t * message){
+    return big_endian_read_16(message->data, 7);
+}
+
+static uint8_t sent_ttl(const sent_message_t * message){
+    return message->data[1] & 0x7f;
+}
+
+static bool sent_control(const sent_message_t * message, uint8_t opcode){
+    return ((message->data[1] & 0x80) != 0) && ((message->data[9] & 0x7f) == opcode);
+}
+
+static bool sent_friend_update(const sent_message_t * message){
+    return (sent_src(message) == FRIEND_ADDRESS) && sent_control(message, MESH_TRANSPORT_OPCODE_FRIEND_UPDATE);
+}
+
+// Segment Acknowledgment sent by Friend node on behalf of Low Power Node
+static const sent_message_t * last_segment_acknowledgment_on_behalf(void){
+    uint16_t i = num_sent_messages;
+    while (i > 0){
+        i--;
+        const sent_message_t * message = &sent_messages[i];
+        if (!sent_control(message, MESH_TRANSPORT_OPCODE_ACK)) continue;
+        if ((message->data[10] & 0x80) == 0) continue;
+        return message;
+    }
+    return NULL;
+}
+
+static void establish_friendship(uint32_t poll_timeout, uint16_t previous_address){
+    lpn_send_request(LPN_CRITERIA, LPN_RECEIVE_DELAY_MS, poll_timeout, previous_address, 0);
+    run(100);
+    const sent_message_t * offer = last_sent_message();
+    CHECK(offer != NULL);
+    CHECK(sent_control(offer, MESH_TRANSPORT_OPCODE_FRIEND_OFFER));
+    CHECK(lpn_send_poll(0));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+}
+
+static void k2_handler(void * arg){
+    UNUSED(arg);
+    k2_done = true;
+}
+
+TEST_GROUP(MeshFriend){
+    void setup(void){
+        mock_init();
+        btstack_memory_init();
+        btstack_crypto_init();
+        mock_simulate_hci_state_working();
+        mesh_network_key_init();
+        mesh_seq_auth_reset();
+        mesh_node_primary_element_address_set(FRIEND_ADDRESS);
+        mesh_set_iv_index(0x12345678);
+        mesh_sequence_number_set(1);
+        mesh_foundation_friend_set(1);
+
+        memset(&test_network_key, 0, sizeof(test_network_key));
+        parse_hex("7dd7364cd842ad18c17c2b820c84c3d6", 16, test_network_key.net_key);
+        test_network_key.nid = 0x68;
+        memset(&test_subnet, 0, sizeof(test_subnet));
+        test_subnet.old_key = &test_network_key;
+        test_subnet.key_refresh = MESH_KEY_REFRESH_NOT_ACTIVE;
+
+        bearer_queue = NULL;
+        num_sent_messages = 0;
+        seq_lpn = 0;
+        seq_other_node = 0;
+        seq_previous_friend = 0;
+        k2_done = false;
+
+        mesh_lower_transport_init();
+        mesh_lower_transport_set_higher_layer_handler(&test_lower_transport_higher_layer_handler);
+        mesh_friend_init();
+    }
+    void teardown(void){
+        process();
+        mesh_lower_transport_reset();
+        btstack_crypto_reset();
+    }
+};
+
+// Mesh Profile Sample Data, Message #2: Friend Offer from 0x2345 to 0x1201, FriendCounter 0x072f, NID 0x5e
+TEST(MeshFriend, FriendshipCredentials){
+    uint8_t p[9];
+    parse_hex("01120123450000072f", 9, p);
+    mesh_k2_friendship(&k2_request, test_network_key.net_key, p, k2_result, &k2_handler, NULL);
+    process();
+    CHECK(k2_done);
+    uint8_t expected_encryption_key[16];
+    uint8_t expected_privacy_key[16];
+    parse_hex("be635105434859f484fc798e043ce40e", 16, expected_encryption_key);
+    parse_hex("5d396d4b54d3cbafe943e051fe9a4eb8", 16, expected_privacy_key);
+    CHECK_EQUAL(0x5e, k2_result[0]);
+    MEMCMP_EQUAL(expected_encryption_key, &k2_result[1], 16);
+    MEMCMP_EQUAL(expected_privacy_key, &k2_result[17], 16);
+}
+
+TEST(MeshFriend, Establishment){
+    // Mesh Profile Sample Data, Message #1: Friend Request
+    uint8_t request[11];
+    parse_hex("034b50057e400000010000", 11, request);
+    receive(LPN_ADDRESS, ++seq_lpn, MESH_ADDRESS_ALL_FRIENDS, 1, 0, false, request, sizeof(request));
+
+    // Friend Offer after max(100 ms, ReceiveWindowFactor * ReceiveWindow)
+    run(99);
+    CHECK_EQUAL(0, num_sent_messages);
+    run(1);
+    const sent_message_t * offer = last_sent_message();
+    CHECK(offer != NULL);
+    CHECK_EQUAL(100, offer->time_ms);
+    CHECK(offer->friendship == false);
+    CHECK_EQUAL(LPN_ADDRESS, sent_dst(offer));
+    CHECK_EQUAL(0, sent_ttl(offer));
+    CHECK(sent_control(offer, MESH_TRANSPORT_OPCODE_FRIEND_OFFER));
+    CHECK_EQUAL(9 + 7, offer->len);
+    CHECK_EQUAL(MESH_FRIEND_RECEIVE_WINDOW_MS, offer->data[10]);
+    CHECK_EQUAL(MESH_FRIEND_QUEUE_SIZE, offer->data[11]);
+    CHECK_EQUAL(MESH_FRIEND_SUBSCRIPTION_LIST_SIZE, offer->data[12]);
+
+    // friendship security credentials derived from NetKey and Friend Request / Friend Offer
+    uint8_t p[9];
+    p[0] = 0x01;
+    big_endian_store_16(p, 1, LPN_ADDRESS);
+    big_endian_store_16(p, 3, FRIEND_ADDRESS);
+    big_endian_store_16(p, 5, 0);
+    (void) memcpy(&p[7], &offer->data[14], 2);
+    mesh_k2_friendship(&k2_request, test_network_key.net_key, p, k2_result, &k2_handler, NULL);
+    process();
+    CHECK(k2_done);
+    const mesh_network_key_t * friendship_key = mesh_network_key_friendship_get(0, LPN_ADDRESS);
+    CHECK(friendship_key != NULL);
+    CHECK_EQUAL(k2_result[0], friendship_key->nid);
+    MEMCMP_EQUAL(&k2_result[1],  friendship_key->encryption_key, 16);
+    MEMCMP_EQUAL(&k2_result[17], friendship_key->privacy_key, 16);
+
+    // Friend Update after ReceiveDelay of 0x50 ms
+    CHECK(lpn_send_poll(0));
+    uint32_t poll_time_ms = btstack_run_loop_get_time_ms();
+    run(0x50 - 1);
+    CHECK(sent_friend_update(last_sent_message()) == false);
+    run(1);
+    const sent_message_t * update = last_sent_message();
+    CHECK(sent_friend_update(update));
+    CHECK_EQUAL(poll_time_ms + 0x50, update->time_ms);
+    CHECK(update->friendship);
+    CHECK_EQUAL(LPN_ADDRESS, update->lpn_address);
+    CHECK_EQUAL(9 + 7, update->len);
+    CHECK_EQUAL(0, update->data[10]);
+    CHECK_EQUAL(0x12345678, big_endian_read_32(update->data, 11));
+    CHECK_EQUAL(0, update->data[15]);
+
+    // PollTimeout timer restarted by Friend Poll
+    CHECK_EQUAL(0x057e40, mesh_friend_get_poll_timeout(LPN_ADDRESS));
+}
+
+TEST(MeshFriend, RequestRejected){
+    // MinQueueSizeLog exceeds Friend Queue
+    lpn_send_request(0x07, LPN_RECEIVE_DELAY_MS, 100, MESH_ADDRESS_UNSASSIGNED, 0);
+    // ReceiveDelay below 10 ms
+    lpn_send_request(LPN_CRITERIA, 9, 100, MESH_ADDRESS_UNSASSIGNED, 0);
+    // PollTimeout below 1 second
+    lpn_send_request(LPN_CRITERIA, LPN_RECEIVE_DELAY_MS, 9, MESH_ADDRESS_UNSASSIGNED, 0);
+    run(1000);
+    CHECK_EQUAL(0, num_sent_messages);
+
+    // Friend feature disabled
+    mesh_foundation_friend_set(0);
+    lpn_send_request(LPN_CRITERIA, LPN_RECEIVE_DELAY_MS, 100, MESH_ADDRESS_UNSASSIGNED, 0);
+    run(1000);
+    CHECK_EQUAL(0, num_sent_messages);
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) == NULL);
+}
+
+TEST(MeshFriend, NoPollAfterOffer){
+    lpn_send_request(LPN_CRITERIA, LPN_RECEIVE_DELAY_MS, 100, MESH_ADDRESS_UNSASSIGNED, 0);
+    run(100);
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) != NULL);
+    run(1000);
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) == NULL);
+    CHECK(lpn_send_poll(0) == false);
+}
+
+TEST(MeshFriend, PollTimeout){
+    // PollTimeout timer started by Friend Poll, ReceiveDelay before establish_friendship returns
+    establish_friendship(10, MESH_ADDRESS_UNSASSIGNED);
+    run(500 - LPN_RECEIVE_DELAY_MS);
+    CHECK_EQUAL(5, mesh_friend_get_poll_timeout(LPN_ADDRESS));
+    run(499);
+    CHECK_EQUAL(1, mesh_friend_get_poll_timeout(LPN_ADDRESS));
+    run(1);
+    CHECK_EQUAL(0, mesh_friend_get_poll_timeout(LPN_ADDRESS));
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) == NULL);
+}
+
+TEST(MeshFriend, QueueAndRetransmission){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    other_node_send_message(LPN_ADDRESS, 1);
+    other_node_send_message(LPN_ADDRESS, 2);
+    // not for Low Power Node
+    other_node_send_message(LPN_ADDRESS + 1, 3);
+    CHECK_EQUAL(2, num_sent_messages);
+
+    // first stored message, relayed with friendship security credentials and TTL - 1
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    const sent_message_t * message = last_sent_message();
+    CHECK(message->friendship);
+    CHECK_EQUAL(OTHER_NODE_ADDRESS, sent_src(message));
+    CHECK_EQUAL(4, sent_ttl(message));
+    CHECK_EQUAL(1, message->data[10]);
+
+    // same FSN: Friend node responds with the same message
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK_EQUAL(1, last_sent_message()->data[10]);
+
+    // FSN toggled: next message
+    CHECK(lpn_send_poll(0));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK_EQUAL(2, last_sent_message()->data[10]);
+
+    // queue empty: Friend Update with MD = 0
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    message = last_sent_message();
+    CHECK(sent_friend_update(message));
+    CHECK_EQUAL(0, message->data[15]);
+}
+
+TEST(MeshFriend, QueueOverflow){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    const uint8_t num_messages = MESH_FRIEND_QUEUE_SIZE + 4;
+    uint8_t i;
+    for (i = 0; i < num_messages; i++){
+        other_node_send_message(LPN_ADDRESS, i);
+    }
+
+    // oldest messages have been discarded
+    uint8_t fsn = 1;
+    uint8_t expected = num_messages - MESH_FRIEND_QUEUE_SIZE;
+    while (true){
+        CHECK(lpn_send_poll(fsn));
+        fsn ^= 1;
+        run(LPN_RECEIVE_DELAY_MS);
+        const sent_message_t * message = last_sent_message();
+        if (sent_friend_update(message)) break;
+        CHECK_EQUAL(expected, message->data[10]);
+        expected++;
+    }
+    CHECK_EQUAL(num_messages, expected);
+}
+
+TEST(MeshFriend, SegmentedMessage){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint16_t seq_zero = (uint16_t) ((seq_other_node + 1) & 0x1fff);
+
+    // first segment is not queued before message is complete
+    other_node_send_segment(LPN_ADDRESS, seq_zero, 0, 1);
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+    CHECK_EQUAL(0, last_sent_message()->data[15]);
+
+    // acknowledged on behalf of Low Power Node after 150 + 50 * TTL ms
+    CHECK(last_segment_acknowledgment_on_behalf() == NULL);
+    run(150 + (50 * 5) - LPN_RECEIVE_DELAY_MS);
+    const sent_message_t * ack = last_segment_acknowledgment_on_behalf();
+    CHECK(ack != NULL);
+    CHECK(ack->friendship == false);
+    CHECK_EQUAL(FRIEND_ADDRESS, sent_src(ack));
+    CHECK_EQUAL(OTHER_NODE_ADDRESS, sent_dst(ack));
+    CHECK_EQUAL(seq_zero, (big_endian_read_16(ack->data, 10) >> 2) & 0x1fff);
+    CHECK_EQUAL(1, big_endian_read_32(ack->data, 12));
+
+    // last segment: acknowledged right away, all segments queued
+    uint16_t num_messages = num_sent_messages;
+    other_node_send_segment(LPN_ADDRESS, seq_zero, 1, 1);
+    ack = last_segment_acknowledgment_on_behalf();
+    CHECK(ack == &sent_messages[num_messages]);
+    CHECK_EQUAL(3, big_endian_read_32(ack->data, 12));
+
+    // retransmitted segment of complete message is acknowledged again but not queued twice
+    num_messages = num_sent_messages;
+    other_node_send_segment(LPN_ADDRESS, seq_zero, 1, 1);
+    CHECK(last_segment_acknowledgment_on_behalf() == &sent_messages[num_messages]);
+
+    uint8_t seg_o;
+    for (seg_o = 0; seg_o < 2; seg_o++){
+        CHECK(lpn_send_poll(seg_o));
+        run(LPN_RECEIVE_DELAY_MS);
+        const sent_message_t * message = last_sent_message();
+        CHECK(message->friendship);
+        CHECK_EQUAL(OTHER_NODE_ADDRESS, sent_src(message));
+        CHECK_EQUAL(4, sent_ttl(message));
+        CHECK_EQUAL(seg_o, (big_endian_read_16(message->data, 11) >> 5) & 0x1f);
+    }
+    CHECK(lpn_send_poll(0));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+}
+
+TEST(MeshFriend, SegmentedMessageTooLarge){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint16_t seq_zero = (uint16_t) ((seq_other_node + 1) & 0x1fff);
+
+    // not acknowledged as it can't be stored completely
+    other_node_send_segment(LPN_ADDRESS, seq_zero, 0, MESH_FRIEND_QUEUE_SIZE);
+    run(150 + (50 * 5));
+    CHECK(last_segment_acknowledgment_on_behalf() == NULL);
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+}
+
+TEST(MeshFriend, QueueOverflowDiscardsWholeMessage){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint16_t seq_zero = (uint16_t) ((seq_other_node + 1) & 0x1fff);
+    uint8_t seg_o;
+    for (seg_o = 0; seg_o < 3; seg_o++){
+        other_node_send_segment(LPN_ADDRESS, seq_zero, seg_o, 2);
+    }
+    // one more message than fits after the segmented message
+    const uint8_t num_messages = MESH_FRIEND_QUEUE_SIZE - 2;
+    uint8_t i;
+    for (i = 0; i < num_messages; i++){
+        other_node_send_message(LPN_ADDRESS, i);
+    }
+
+    // all segments have been discarded
+    uint8_t fsn = 1;
+    uint8_t expected = 0;
+    while (true){
+        CHECK(lpn_send_poll(fsn));
+        fsn ^= 1;
+        run(LPN_RECEIVE_DELAY_MS);
+        const sent_message_t * message = last_sent_message();
+        if (sent_friend_update(message)) break;
+        CHECK_EQUAL(0, message->data[9] & 0x80);
+        CHECK_EQUAL(expected, message->data[10]);
+        expected++;
+    }
+    CHECK_EQUAL(num_messages, expected);
+}
+
+TEST(MeshFriend, InterleavedSegmentedMessages){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint16_t seq_zero_other = (uint16_t) ((seq_other_node + 1) & 0x1fff);
+    other_node_send_segment(LPN_ADDRESS, seq_zero_other, 0, 1);
+
+    // segments from third node are ignored while message from other node is incomplete
+    uint16_t seq_zero_third = (uint16_t) ((seq_other_node + 1) & 0x1fff);
+    node_send_segment(THIRD_NODE_ADDRESS, LPN_ADDRESS, seq_zero_third, 0, 1);
+    node_send_segment(THIRD_NODE_ADDRESS, LPN_ADDRESS, seq_zero_third, 1, 1);
+    CHECK(last_segment_acknowledgment_on_behalf() == NULL);
+
+    other_node_send_segment(LPN_ADDRESS, seq_zero_other, 1, 1);
+    const sent_message_t * ack = last_segment_acknowledgment_on_behalf();
+    CHECK(ack != NULL);
+    CHECK_EQUAL(OTHER_NODE_ADDRESS, sent_dst(ack));
+
+    // retransmission from third node is collected afterwards
+    node_send_segment(THIRD_NODE_ADDRESS, LPN_ADDRESS, seq_zero_third, 0, 1);
+    node_send_segment(THIRD_NODE_ADDRESS, LPN_ADDRESS, seq_zero_third, 1, 1);
+    ack = last_segment_acknowledgment_on_behalf();
+    CHECK(ack != NULL);
+    CHECK_EQUAL(THIRD_NODE_ADDRESS, sent_dst(ack));
+    CHECK_EQUAL(3, big_endian_read_32(ack->data, 12));
+
+    const uint16_t expected_src[4] = { OTHER_NODE_ADDRESS, OTHER_NODE_ADDRESS, THIRD_NODE_ADDRESS, THIRD_NODE_ADDRESS };
+    uint8_t i;
+    for (i = 0; i < 4; i++){
+        CHECK(lpn_send_poll((i + 1) & 1));
+        run(LPN_RECEIVE_DELAY_MS);
+        CHECK_EQUAL(expected_src[i], sent_src(last_sent_message()));
+        CHECK_EQUAL((i & 1), (big_endian_read_16(last_sent_message()->data, 11) >> 5) & 0x1f);
+    }
+}
+
+TEST(MeshFriend, LocallyOriginatedMessage){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint8_t add[4] = { MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_ADD, 7, 0xc0, 0x01};
+    CHECK(lpn_send_control(add, sizeof(add)));
+    run(LPN_RECEIVE_DELAY_MS);
+
+    // sent as usual and stored for Low Power Node with unchanged TTL
+    uint16_t num_messages = num_sent_messages;
+    friend_send_message(LPN_ADDRESS, 1);
+    friend_send_message(0xc001, 2);
+    friend_send_message(0xc002, 3);
+    CHECK_EQUAL(num_messages + 3, num_sent_messages);
+
+    // segment sent again by Lower Transport is only stored once
+    uint8_t segment[16];
+    segment[0] = 0x80;
+    big_endian_store_24(segment, 1, ((uint32_t) 0x0123 << 10) | 0);
+    memset(&segment[4], 4, 12);
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    CHECK(network_pdu != NULL);
+    mesh_network_setup_pdu(network_pdu, 0, 0x68, 0, 5, mesh_sequence_number_next(), FRIEND_ADDRESS, LPN_ADDRESS, segment, sizeof(segment));
+    mesh_network_send_pdu(network_pdu);
+    run(1);
+    mesh_network_send_pdu(network_pdu);
+    run(1);
+
+    uint8_t fsn = 1;
+    uint8_t value;
+    for (value = 1; value < 3; value++){
+        CHECK(lpn_send_poll(fsn));
+        fsn ^= 1;
+        run(LPN_RECEIVE_DELAY_MS);
+        const sent_message_t * message = last_sent_message();
+        CHECK(message->friendship);
+        CHECK_EQUAL(FRIEND_ADDRESS, sent_src(message));
+        CHECK_EQUAL(5, sent_ttl(message));
+        CHECK_EQUAL(value, message->data[10]);
+    }
+    CHECK(lpn_send_poll(fsn));
+    fsn ^= 1;
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(last_sent_message()->friendship);
+    CHECK_EQUAL(0x80, last_sent_message()->data[9]);
+    CHECK(lpn_send_poll(fsn));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+    mesh_network_pdu_free(network_pdu);
+}
+
+TEST(MeshFriend, SubscriptionList){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+
+    uint8_t add[5] = { MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_ADD, 7, 0xc0, 0x01, 0};
+    big_endian_store_16(add, 2, 0xc001);
+    CHECK(lpn_send_control(add, 4));
+    run(LPN_RECEIVE_DELAY_MS);
+    const sent_message_t * confirm = last_sent_message();
+    CHECK(sent_control(confirm, MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_CONFIRM));
+    CHECK(confirm->friendship);
+    CHECK_EQUAL(7, confirm->data[10]);
+
+    other_node_send_message(0xc001, 1);
+    other_node_send_message(0xc002, 2);
+
+    uint8_t remove[4] = { MESH_TRANSPORT_OPCODE_FRIEND_FRIEND_SUBSCRIPTION_LIST_REMOVE, 8, 0xc0, 0x01};
+    CHECK(lpn_send_control(remove, sizeof(remove)));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK_EQUAL(8, last_sent_message()->data[10]);
+
+    other_node_send_message(0xc001, 3);
+
+    CHECK(lpn_send_poll(1));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK_EQUAL(0xc001, sent_dst(last_sent_message()));
+    CHECK_EQUAL(1, last_sent_message()->data[10]);
+    CHECK(lpn_send_poll(0));
+    run(LPN_RECEIVE_DELAY_MS);
+    CHECK(sent_friend_update(last_sent_message()));
+}
+
+TEST(MeshFriend, FriendClearReceived){
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    other_node_send_message(LPN_ADDRESS, 1);
+
+    // LPNCounter out of range
+    uint8_t clear[5] = { MESH_TRANSPORT_OPCODE_FRIEND_CLEAR, 0x12, 0x01, 0x01, 0x00 };
+    receive(PREVIOUS_FRIEND_ADDRESS, ++seq_previous_friend, FRIEND_ADDRESS, 1, 7, false, clear, sizeof(clear));
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) != NULL);
+
+    // new friendship of Low Power Node established via another Friend node
+    big_endian_store_16(clear, 3, 1);
+    uint16_t num_messages = num_sent_messages;
+    receive(PREVIOUS_FRIEND_ADDRESS, ++seq_previous_friend, FRIEND_ADDRESS, 1, 7, false, clear, sizeof(clear));
+    CHECK_EQUAL(num_messages + 1, num_sent_messages);
+    const sent_message_t * confirm = last_sent_message();
+    CHECK(sent_control(confirm, MESH_TRANSPORT_OPCODE_FRIEND_CLEAR_CONFIRM));
+    CHECK(confirm->friendship == false);
+    CHECK_EQUAL(PREVIOUS_FRIEND_ADDRESS, sent_dst(confirm));
+    CHECK_EQUAL(mesh_foundation_default_ttl_get(), sent_ttl(confirm));
+    MEMCMP_EQUAL(&clear[1], &confirm->data[10], 4);
+    CHECK(mesh_network_key_friendship_get(0, LPN_ADDRESS) == NULL);
+    CHECK_EQUAL(0, mesh_friend_get_poll_timeout(LPN_ADDRESS));
+}
+
+TEST(MeshFriend, FriendClearSent){
+    establish_friendship(1000, PREVIOUS_FRIEND_ADDRESS);
+    uint32_t established_ms = btstack_run_loop_get_time_ms();
+
+    // Friend Clear repeated after 1 s, 2 s, 4 s ...
+    run(4000);
+    uint32_t clear_times_ms[4];
+    uint16_t num_clears = 0;
+    uint16_t i;
+    for (i = 0; i < num_sent_messages; i++){
+        if (!sent_control(&sent_messages[i], MESH_TRANSPORT_OPCODE_FRIEND_CLEAR)) continue;
+        CHECK(num_clears < 4);
+        CHECK_EQUAL(PREVIOUS_FRIEND_ADDRESS, sent_dst(&sent_messages[i]));
+        CHECK(sent_messages[i].friendship == false);
+        clear_times_ms[num_clears++] = sent_messages[i].time_ms - established_ms + LPN_RECEIVE_DELAY_MS;
+    }
+    CHECK_EQUAL(3, num_clears);
+    CHECK_EQUAL(0,    clear_times_ms[0]);
+    CHECK_EQUAL(1000, clear_times_ms[1]);
+    CHECK_EQUAL(3000, clear_times_ms[2]);
+
+    // Friend Clear Confirm stops Friend Clear procedure
+    uint8_t confirm[5] = { MESH_TRANSPORT_OPCODE_FRIEND_CLEAR_CONFIRM, 0x12, 0x01, 0x00, 0x00 };
+    receive(PREVIOUS_FRIEND_ADDRESS, ++seq_previous_friend, FRIEND_ADDRESS, 1, 7, false, confirm, sizeof(confirm));
+    uint16_t num_messages = num_sent_messages;
+    CHECK(lpn_send_poll(1));
+    run(10000);
+    CHECK_EQUAL(num_messages + 1, num_sent_messages);
+}
+
+// LPN polls every second and keeps polling while the Friend node has more data. It only
+// listens for the Friend node's response within the Receive Window after ReceiveDelay.
+TEST(MeshFriend, DutyCycle){
+    const uint32_t poll_interval_ms = 1000;
+    const uint32_t message_interval_ms = 2900;
+    const uint32_t duration_ms = 60000;
+
+    establish_friendship(100, MESH_ADDRESS_UNSASSIGNED);
+    uint32_t start_ms = btstack_run_loop_get_time_ms();
+    uint32_t end_ms = start_ms + duration_ms;
+
+    uint32_t next_message_ms = start_ms + 37;
+    uint32_t next_poll_ms    = start_ms + poll_interval_ms;
+    uint8_t  messages_sent = 0;
+    uint8_t  messages_received = 0;
+    uint32_t lpn_on_time_ms = 0;
+    uint8_t  fsn = 1;
+
+    while (btstack_run_loop_get_time_ms() < end_ms){
+        uint32_t now_ms = btstack_run_loop_get_time_ms();
+        uint32_t next_ms = btstack_min(next_message_ms, next_poll_ms);
+        if (next_ms > now_ms){
+            run(next_ms - now_ms);
+        }
+        now_ms = btstack_run_loop_get_time_ms();
+
+        if (now_ms >= next_message_ms){
+            other_node_send_message(LPN_ADDRESS, messages_sent++);
+            next_message_ms += message_interval_ms;
+        }
+
+        if (now_ms < next_poll_ms) continue;
+
+        // poll until Friend Update
+        while (true){
+            uint16_t num_messages = num_sent_messages;
+            uint32_t poll_ms = btstack_run_loop_get_time_ms();
+            CHECK(lpn_send_poll(fsn));
+            lpn_on_time_ms += PDU_AIRTIME_MS;
+
+            // LPN sleeps during ReceiveDelay and listens for up to ReceiveWindow
+            run(LPN_RECEIVE_DELAY_MS - 1);
+            CHECK_EQUAL(num_messages, num_sent_messages);
+            run(1 + MESH_FRIEND_RECEIVE_WINDOW_MS);
+            CHECK_EQUAL(num_messages + 1, num_sent_messages);
+            const sent_message_t * response = last_sent_message();
+            uint32_t window_start_ms = poll_ms + LPN_RECEIVE_DELAY_MS;
+            CHECK(response->time_ms >= window_start_ms);
+            CHECK(response->time_ms <  (window_start_ms + MESH_FRIEND_RECEIVE_WINDOW_MS));
+            CHECK(response->friendship);
+            lpn_on_time_ms += (response->time_ms - window_start_ms) + PDU_AIRTIME_MS;
+            fsn ^= 1;
+
+            if (sent_friend_update(response)) {
+                CHECK_EQUAL(0, response->data[15]);
+                break;
+            }
+            CHECK_EQUAL(messages_received, response->data[10]);
+            CHECK_EQUAL(4, sent_ttl(response));
+            messages_received++;
+        }
+        next_poll_ms += poll_interval_ms;
+    }
+
+    // all messages delivered while the LPN radio was on for less than 1% of the time
+    CHECK_EQUAL(messages_sent, messages_received);
+    CHECK(messages_sent >= (duration_ms / message_interval_ms));
+    CHECK((lpn_on_time_ms * 100) < duration_ms);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
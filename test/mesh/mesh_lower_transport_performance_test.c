@@ -0,0 +1,571 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Mesh Lower Transport Layer throughput test
+//
+// Outgoing: a provisioner sends segmented access messages to many nodes over a
+// simulated ADV bearer that transmits one Network PDU at a time. Nodes acknowledge
+// segments like the Lower Transport Layer does, with optional segment loss and
+// additional delay for nodes reached via relays. The time until all messages
+// are acknowledged is reported in virtual time.
+//
+// Incoming: segmented messages from many sources are received with segments of
+// different messages interleaved and out of order. The CPU time per reassembled
+// message is reported.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "mesh/mesh_friend.h"
+#include "mesh/mesh_iv_index_seq_number.h"
+#include "mesh/mesh_keys.h"
+#include "mesh/mesh_lower_transport.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_node.h"
+#include "mesh/mesh_peer.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define NUM_NODES                   32
+#define NUM_MESSAGES_PER_NODE       4
+#define PAYLOAD_LEN                 96
+#define SEGMENT_LEN                 12
+#define TTL                         3
+#define BEARER_PDU_TIME_MS          10
+#define PROVISIONER_ADDRESS         0x0001
+#define FIRST_NODE_ADDRESS          0x0100
+#define MAX_DURATION_MS             600000
+#define MAX_ACKS_IN_FLIGHT          256
+#define NUM_INCOMING_ITERATIONS     2000
+
+typedef struct {
+    const char * name;
+    uint16_t     nodes_in_parallel;
+    uint16_t     relay_delay_ms;
+    uint8_t      loss_percent;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "1 node at a time",              1,         0,   0  },
+    { "32 nodes in parallel",          NUM_NODES, 0,   0  },
+    { "1 node at a time, 10% loss",    1,         0,   10 },
+    { "32 nodes, 10% loss",            NUM_NODES, 0,   10 },
+    { "1 node, relays, 10% loss",      1,         400, 10 },
+    { "32 nodes, relays, 10% loss",    NUM_NODES, 400, 10 },
+};
+
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenario_t))
+
+typedef struct {
+    uint16_t address;
+    // seq for Segment Acknowledgment messages sent by node
+    uint32_t seq;
+    // reassembly
+    uint16_t seq_zero;
+    uint32_t block_ack;
+    uint32_t block_ack_complete;
+    bool     ack_timer_active;
+    uint32_t ack_timer_ms;
+    // messages to node
+    uint8_t  messages_queued;
+    bool     message_active;
+} node_t;
+
+typedef struct {
+    uint32_t deliver_ms;
+    uint16_t src;
+    uint32_t seq;
+    uint16_t seq_zero;
+    uint32_t block_ack;
+} ack_t;
+
+static node_t   nodes[NUM_NODES];
+static ack_t    acks_in_flight[MAX_ACKS_IN_FLIGHT];
+static uint16_t acks_in_flight_count;
+static const scenario_t * scenario;
+static uint32_t random_state;
+
+static uint32_t messages_acknowledged;
+static uint32_t messages_failed;
+static uint32_t segments_sent;
+static uint32_t acks_received;
+
+// simulated ADV bearer
+static void (*lower_transport_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu);
+static btstack_linked_list_t bearer_queue;
+static mesh_network_pdu_t *  bearer_pdu;
+static uint32_t              bearer_done_ms;
+
+// peers with replay protection
+static mesh_peer_t peers[NUM_NODES + 1];
+
+static bool random_lost(void){
+    random_state = (random_state * 1103515245u) + 12345u;
+    return ((random_state >> 16) % 100u) < scenario->loss_percent;
+}
+
+static uint8_t payload_byte(uint16_t address, uint16_t pos){
+    return (uint8_t) (address + pos);
+}
+
+static node_t * node_for_address(uint16_t address){
+    if ((address < FIRST_NODE_ADDRESS) || (address >= (FIRST_NODE_ADDRESS + NUM_NODES))) return NULL;
+    return &nodes[address - FIRST_NODE_ADDRESS];
+}
+
+// Network Layer stub
+void mesh_network_set_higher_layer_handler(void (*packet_handler)(mesh_network_callback_type_t callback_type, mesh_network_pdu_t * network_pdu)){
+    lower_transport_handler = packet_handler;
+}
+
+void mesh_network_send_pdu(mesh_network_pdu_t * network_pdu){
+    btstack_linked_list_add_tail(&bearer_queue, (btstack_linked_item_t *) network_pdu);
+}
+
+void mesh_network_message_processed_by_higher_layer(mesh_network_pdu_t * network_pdu){
+    btstack_memory_mesh_network_pdu_free(network_pdu);
+}
+
+mesh_network_pdu_t * mesh_network_pdu_get(void){
+    mesh_network_pdu_t * network_pdu = btstack_memory_mesh_network_pdu_get();
+    if (network_pdu) {
+        memset(network_pdu, 0, sizeof(mesh_network_pdu_t));
+        network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_NETWORK;
+    }
+    return network_pdu;
+}
+
+void mesh_network_pdu_free(mesh_network_pdu_t * network_pdu){
+    btstack_memory_mesh_network_pdu_free(network_pdu);
+}
+
+void mesh_network_setup_pdu(mesh_network_pdu_t * network_pdu, uint16_t netkey_index, uint8_t nid, uint8_t ctl, uint8_t ttl, uint32_t seq, uint16_t src, uint16_t dest, const uint8_t * transport_pdu_data, uint8_t transport_pdu_len){
+    network_pdu->netkey_index = netkey_index;
+    network_pdu->data[0] = nid;
+    network_pdu->data[1] = (ctl << 7) | (ttl & 0x7f);
+    big_endian_store_24(network_pdu->data, 2, seq);
+    big_endian_store_16(network_pdu->data, 5, src);
+    big_endian_store_16(network_pdu->data, 7, dest);
+    (void) memcpy(&network_pdu->data[9], transport_pdu_data, transport_pdu_len);
+    network_pdu->len = 9 + transport_pdu_len;
+}
+
+mesh_network_key_t * mesh_network_key_list_get(uint16_t netkey_index){
+    static mesh_network_key_t network_key;
+    UNUSED(netkey_index);
+    return &network_key;
+}
+
+int mesh_network_address_unicast(uint16_t addr){
+    return (addr != MESH_ADDRESS_UNSASSIGNED) && (addr < 0x8000);
+}
+
+uint16_t mesh_network_control(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[1] & 0x80;
+}
+
+uint8_t mesh_network_ttl(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[1] & 0x7f;
+}
+
+uint32_t mesh_network_seq(mesh_network_pdu_t * network_pdu){
+    return big_endian_read_24(network_pdu->data, 2);
+}
+
+uint16_t mesh_network_src(mesh_network_pdu_t * network_pdu){
+    return big_endian_read_16(network_pdu->data, 5);
+}
+
+int mesh_network_segmented(mesh_network_pdu_t * network_pdu){
+    return network_pdu->data[9] & 0x80;
+}
+
+uint8_t * mesh_network_pdu_data(mesh_network_pdu_t * network_pdu){
+    return &network_pdu->data[9];
+}
+
+uint8_t mesh_network_pdu_len(mesh_network_pdu_t * network_pdu){
+    return network_pdu->len - 9;
+}
+
+uint16_t mesh_node_get_primary_element_address(void){
+    return PROVISIONER_ADDRESS;
+}
+
+mesh_peer_t * mesh_peer_for_addr(uint16_t address){
+    uint16_t i;
+    for (i = 0; i < (NUM_NODES + 1); i++){
+        if (peers[i].address == address) return &peers[i];
+    }
+    for (i = 0; i < (NUM_NODES + 1); i++){
+        if (peers[i].address == MESH_ADDRESS_UNSASSIGNED){
+            memset(&peers[i], 0, sizeof(mesh_peer_t));
+            peers[i].address = address;
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+#ifdef ENABLE_MESH_FRIEND
+// Friend stub
+void mesh_friend_network_pdu_received(mesh_network_pdu_t * network_pdu){
+    UNUSED(network_pdu);
+}
+
+void mesh_friend_process_control_message(mesh_network_pdu_t * network_pdu){
+    UNUSED(network_pdu);
+}
+
+void mesh_friend_reset(void){
+}
+#endif
+
+// simulated nodes
+static void node_receive_segment(node_t * node, mesh_network_pdu_t * network_pdu, uint32_t now_ms){
+    uint8_t * lower_transport_pdu = mesh_network_pdu_data(network_pdu);
+    uint16_t seq_zero = (big_endian_read_16(lower_transport_pdu, 1) >> 2) & 0x1fff;
+    uint8_t  seg_o    = (big_endian_read_16(lower_transport_pdu, 2) >> 5) & 0x1f;
+    uint8_t  seg_n    = lower_transport_pdu[3] & 0x1f;
+    if ((node->block_ack_complete == 0) || (seq_zero != node->seq_zero)){
+        node->seq_zero = seq_zero;
+        node->block_ack = 0;
+        node->block_ack_complete = (1u << (seg_n + 1)) - 1;
+        node->ack_timer_active = false;
+    }
+    node->block_ack |= 1u << seg_o;
+    if (node->block_ack == node->block_ack_complete){
+        // acknowledge right away when complete
+        node->ack_timer_active = true;
+        node->ack_timer_ms = now_ms;
+    } else if (node->ack_timer_active == false){
+        // - "The acknowledgment timer shall be set to a minimum of 150 + 50 * TTL milliseconds"
+        node->ack_timer_active = true;
+        node->ack_timer_ms = now_ms + 150 + 50 * TTL;
+    }
+}
+
+static void nodes_run(uint32_t now_ms){
+    uint16_t i;
+    for (i = 0; i < NUM_NODES; i++){
+        node_t * node = &nodes[i];
+        if (!node->ack_timer_active || (now_ms < node->ack_timer_ms)) continue;
+        node->ack_timer_active = false;
+        if (random_lost()) continue;
+        btstack_assert(acks_in_flight_count < MAX_ACKS_IN_FLIGHT);
+        ack_t * ack = &acks_in_flight[acks_in_flight_count++];
+        ack->deliver_ms = now_ms + scenario->relay_delay_ms;
+        ack->src = node->address;
+        ack->seq = ++node->seq;
+        ack->seq_zero = node->seq_zero;
+        ack->block_ack = node->block_ack;
+    }
+}
+
+static void acks_run(uint32_t now_ms){
+    uint16_t i = 0;
+    while (i < acks_in_flight_count){
+        ack_t * ack = &acks_in_flight[i];
+        if (now_ms < ack->deliver_ms){
+            i++;
+            continue;
+        }
+        uint8_t ack_msg[7];
+        ack_msg[0] = 0;
+        big_endian_store_16(ack_msg, 1, ack->seq_zero << 2);
+        big_endian_store_32(ack_msg, 3, ack->block_ack);
+        mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+        mesh_network_setup_pdu(network_pdu, 0, 0, 1, TTL, ack->seq, ack->src, PROVISIONER_ADDRESS, ack_msg, sizeof(ack_msg));
+        acks_in_flight[i] = acks_in_flight[--acks_in_flight_count];
+        acks_received++;
+        mesh_lower_transport_received_message(MESH_NETWORK_PDU_RECEIVED, network_pdu);
+    }
+}
+
+static void bearer_run(uint32_t now_ms){
+    if ((bearer_pdu != NULL) && (now_ms >= bearer_done_ms)){
+        mesh_network_pdu_t * network_pdu = bearer_pdu;
+        bearer_pdu = NULL;
+        if (mesh_network_segmented(network_pdu)){
+            segments_sent++;
+            node_t * node = node_for_address(big_endian_read_16(network_pdu->data, 7));
+            if ((node != NULL) && !random_lost()){
+                node_receive_segment(node, network_pdu, now_ms);
+            }
+        }
+        (*lower_transport_handler)(MESH_NETWORK_PDU_SENT, network_pdu);
+    }
+    if ((bearer_pdu == NULL) && !btstack_linked_list_empty(&bearer_queue)){
+        bearer_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&bearer_queue);
+        bearer_done_ms = now_ms + BEARER_PDU_TIME_MS;
+    }
+}
+
+static void bearer_flush(void){
+    while (!btstack_linked_list_empty(&bearer_queue)){
+        mesh_network_pdu_t * network_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&bearer_queue);
+        (*lower_transport_handler)(MESH_NETWORK_PDU_SENT, network_pdu);
+    }
+}
+
+// provisioner
+static mesh_segmented_pdu_t * create_outgoing_message(uint16_t dst){
+    mesh_segmented_pdu_t * segmented_pdu = mesh_segmented_pdu_get();
+    btstack_assert(segmented_pdu != NULL);
+    segmented_pdu->ivi_nid = 0;
+    segmented_pdu->ctl_ttl = TTL;
+    segmented_pdu->src = PROVISIONER_ADDRESS;
+    segmented_pdu->dst = dst;
+    segmented_pdu->seq = mesh_sequence_number_next();
+    segmented_pdu->flags = MESH_TRANSPORT_FLAG_SEQ_RESERVED;
+    segmented_pdu->netkey_index = 0;
+    segmented_pdu->akf_aid_control = 0x40;
+    segmented_pdu->len = PAYLOAD_LEN;
+    uint16_t pos = 0;
+    while (pos < PAYLOAD_LEN){
+        mesh_network_pdu_t * chunk = mesh_network_pdu_get();
+        btstack_assert(chunk != NULL);
+        while ((chunk->len < MESH_NETWORK_PAYLOAD_MAX) && (pos < PAYLOAD_LEN)){
+            chunk->data[chunk->len++] = payload_byte(dst, pos++);
+        }
+        btstack_linked_list_add_tail(&segmented_pdu->segments, (btstack_linked_item_t *) chunk);
+    }
+    return segmented_pdu;
+}
+
+static void provisioner_run(void){
+    uint16_t nodes_active = 0;
+    uint16_t i;
+    for (i = 0; i < NUM_NODES; i++){
+        if (nodes[i].message_active) nodes_active++;
+    }
+    for (i = 0; i < NUM_NODES; i++){
+        node_t * node = &nodes[i];
+        if (nodes_active >= scenario->nodes_in_parallel) return;
+        if (node->message_active || (node->messages_queued == 0)) continue;
+        if (mesh_lower_transport_can_send_to_dest(node->address) == false) continue;
+        node->messages_queued--;
+        node->message_active = true;
+        nodes_active++;
+        mesh_lower_transport_send_pdu((mesh_pdu_t *) create_outgoing_message(node->address));
+    }
+}
+
+// incoming messages
+static uint32_t messages_reassembled;
+static uint32_t messages_invalid;
+
+static void incoming_message(mesh_segmented_pdu_t * segmented_pdu){
+    // verify payload stored in order, as accessed by Upper Transport
+    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) segmented_pdu->segments;
+    uint16_t pos;
+    bool valid = segmented_pdu->len == PAYLOAD_LEN;
+    for (pos = 0; valid && (pos < segmented_pdu->len); pos++){
+        if ((pos > 0) && ((pos % MESH_NETWORK_PAYLOAD_MAX) == 0)){
+            chunk = (mesh_network_pdu_t *) chunk->pdu_header.item.next;
+        }
+        valid = chunk->data[pos % MESH_NETWORK_PAYLOAD_MAX] == payload_byte(segmented_pdu->src, pos);
+    }
+    if (valid){
+        messages_reassembled++;
+    } else {
+        messages_invalid++;
+    }
+}
+
+static void transport_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
+    node_t * node;
+    switch (callback_type){
+        case MESH_TRANSPORT_PDU_SENT:
+            node = node_for_address(((mesh_segmented_pdu_t *) pdu)->dst);
+            btstack_assert(node != NULL);
+            node->message_active = false;
+            if (status == MESH_TRANSPORT_STATUS_SUCCESS){
+                messages_acknowledged++;
+            } else {
+                messages_failed++;
+            }
+            mesh_segmented_pdu_free((mesh_segmented_pdu_t *) pdu);
+            break;
+        case MESH_TRANSPORT_PDU_RECEIVED:
+            btstack_assert(pdu->pdu_type == MESH_PDU_TYPE_SEGMENTED);
+            incoming_message((mesh_segmented_pdu_t *) pdu);
+            mesh_lower_transport_message_processed_by_higher_layer(pdu);
+            break;
+        default:
+            break;
+    }
+}
+
+static void setup(void){
+    mock_init();
+    btstack_memory_init();
+    memset(nodes, 0, sizeof(nodes));
+    memset(peers, 0, sizeof(peers));
+    uint16_t i;
+    for (i = 0; i < NUM_NODES; i++){
+        nodes[i].address = FIRST_NODE_ADDRESS + i;
+        nodes[i].messages_queued = NUM_MESSAGES_PER_NODE;
+    }
+    acks_in_flight_count = 0;
+    bearer_queue = NULL;
+    bearer_pdu = NULL;
+    random_state = 0x12345678;
+    messages_acknowledged = 0;
+    messages_failed = 0;
+    segments_sent = 0;
+    acks_received = 0;
+    messages_reassembled = 0;
+    messages_invalid = 0;
+    mesh_lower_transport_init();
+    mesh_lower_transport_set_higher_layer_handler(&transport_handler);
+}
+
+static void teardown(void){
+    bearer_flush();
+    if (bearer_pdu != NULL){
+        (*lower_transport_handler)(MESH_NETWORK_PDU_SENT, bearer_pdu);
+        bearer_pdu = NULL;
+    }
+    mesh_lower_transport_reset();
+}
+
+// returns virtual time in ms until all messages have been acknowledged or failed
+static uint32_t benchmark_outgoing(uint32_t * cpu_time_us){
+    setup();
+    const uint32_t num_messages = NUM_NODES * NUM_MESSAGES_PER_NODE;
+    uint32_t start_us = perf_timer_get_time_us();
+    uint32_t now_ms = 0;
+    while ((messages_acknowledged + messages_failed) < num_messages){
+        if (now_ms >= MAX_DURATION_MS) break;
+        provisioner_run();
+        bearer_run(now_ms);
+        nodes_run(now_ms);
+        acks_run(now_ms);
+        mock_run_loop_advance_time_ms(1);
+        now_ms = btstack_run_loop_get_time_ms();
+    }
+    *cpu_time_us = perf_timer_get_time_us() - start_us;
+    teardown();
+    return now_ms;
+}
+
+// incoming segmented messages from all nodes, segments of different sources interleaved, even sources in reverse order
+static uint32_t benchmark_incoming(void){
+    setup();
+    const uint8_t seg_n = (PAYLOAD_LEN - 1) / SEGMENT_LEN;
+    uint32_t duration_us = 0;
+    uint32_t iteration;
+    for (iteration = 0; iteration < NUM_INCOMING_ITERATIONS; iteration += NUM_NODES){
+        uint32_t start_us = perf_timer_get_time_us();
+        uint8_t i;
+        for (i = 0; i <= seg_n; i++){
+            uint16_t n;
+            for (n = 0; n < NUM_NODES; n++){
+                node_t * node = &nodes[n];
+                uint8_t seg_o = ((n & 1) == 0) ? (seg_n - i) : i;
+                if (i == 0){
+                    node->seq_zero = (node->seq + 1) & 0x1fff;
+                }
+                uint8_t lower_transport_pdu[4 + SEGMENT_LEN];
+                lower_transport_pdu[0] = 0x80 | 0x40;
+                big_endian_store_24(lower_transport_pdu, 1, (node->seq_zero << 10) | (seg_o << 5) | seg_n);
+                uint16_t pos;
+                for (pos = 0; pos < SEGMENT_LEN; pos++){
+                    lower_transport_pdu[4 + pos] = payload_byte(node->address, (seg_o * SEGMENT_LEN) + pos);
+                }
+                mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+                mesh_network_setup_pdu(network_pdu, 0, 0, 0, TTL, ++node->seq, node->address, PROVISIONER_ADDRESS, lower_transport_pdu, sizeof(lower_transport_pdu));
+                mesh_lower_transport_received_message(MESH_NETWORK_PDU_RECEIVED, network_pdu);
+            }
+        }
+        // Segment Acknowledgment messages
+        bearer_flush();
+        duration_us += perf_timer_get_time_us() - start_us;
+    }
+    teardown();
+    return duration_us;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    printf("%u nodes, %u segmented messages of %u segments per node, %u ms per Network PDU on ADV bearer, up to %u segments in flight\n",
+           NUM_NODES, NUM_MESSAGES_PER_NODE, (PAYLOAD_LEN + SEGMENT_LEN - 1) / SEGMENT_LEN, BEARER_PDU_TIME_MS,
+           MESH_LOWER_TRANSPORT_MAX_SEGMENTS_IN_FLIGHT);
+    printf("%-28s %10s %10s %10s %8s %8s %10s\n", "Outgoing", "time", "messages/s", "segments", "acks", "failed", "cpu");
+
+    int errors = 0;
+    uint16_t i;
+    for (i = 0; i < NUM_SCENARIOS; i++){
+        scenario = &scenarios[i];
+        uint32_t cpu_time_us;
+        uint32_t duration_ms = benchmark_outgoing(&cpu_time_us);
+        uint32_t messages_done = messages_acknowledged + messages_failed;
+        printf("%-28s %8ums %10.1f %10u %8u %8u %8uus\n", scenario->name, (unsigned int) duration_ms,
+               (double) messages_acknowledged * 1000.0 / (double) duration_ms,
+               (unsigned int) segments_sent, (unsigned int) acks_received, (unsigned int) messages_failed, (unsigned int) cpu_time_us);
+        if (messages_done != (NUM_NODES * NUM_MESSAGES_PER_NODE)){
+            printf("-> only %u of %u messages completed\n", (unsigned int) messages_done, NUM_NODES * NUM_MESSAGES_PER_NODE);
+            errors++;
+        }
+    }
+
+    scenario = &scenarios[0];
+    uint32_t duration_us = benchmark_incoming();
+    printf("%-28s %10.0f messages/s %8.2fus per message, %u reassembled\n", "Incoming, interleaved",
+           (double) messages_reassembled * 1000000.0 / (double) duration_us,
+           (double) duration_us / (double) messages_reassembled, (unsigned int) messages_reassembled);
+    if ((messages_reassembled == 0) || (messages_invalid != 0)){
+        printf("-> %u invalid messages\n", (unsigned int) messages_invalid);
+        errors++;
+    }
+    return errors;
+}
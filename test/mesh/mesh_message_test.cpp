@@ -906,6 +906,62 @@ TEST(MessageTest, Message18Send){
     test_send_access_message(netkey_index, appkey_index, ttl, src, dest, szmic, message18_upper_transport_pdu, 1, message18_lower_transport_pdus, message18_network_pdus);
 }
 
+// Friend node relays message from Low Power Node with master security credentials, also if Relay and Proxy are disabled
+static mesh_network_key_t friendship_key_nid_5e;
+TEST(MessageTest, FriendRelaysLowPowerNodeMessage){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345678);
+    uint8_t relay = mesh_foundation_relay_get();
+    mesh_foundation_relay_set(0);
+    mesh_foundation_gatt_proxy_set(0);
+
+    // friendship security credentials of Message #2 for Low Power Node 0x1201
+    memset(&friendship_key_nid_5e, 0, sizeof(friendship_key_nid_5e));
+    friendship_key_nid_5e.lpn_address = 0x1201;
+    friendship_key_nid_5e.nid = 0x5e;
+    btstack_parse_hex("be635105434859f484fc798e043ce40e", 16, friendship_key_nid_5e.encryption_key);
+    btstack_parse_hex("5d396d4b54d3cbafe943e051fe9a4eb8", 16, friendship_key_nid_5e.privacy_key);
+    mesh_network_key_friendship_add(&friendship_key_nid_5e);
+
+    // lower transport pdu of Message #18 sent by Low Power Node with friendship security credentials
+    uint8_t lower_transport_pdu[10];
+    btstack_parse_hex(message18_lower_transport_pdus[0], sizeof(lower_transport_pdu), lower_transport_pdu);
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    network_pdu->pdu_header.pdu_type = MESH_PDU_TYPE_FRIEND;
+    mesh_network_setup_pdu(network_pdu, 0, 0x5e, 0, 3, 0x001234, 0x1201, 0xffff, lower_transport_pdu, sizeof(lower_transport_pdu));
+    mesh_network_send_pdu_with_friendship_credentials(network_pdu, 0x1201);
+    while (outgoing_adv_network_pdu_len == 0) {
+        mock_process_hci_cmd();
+    }
+    test_network_pdu_len = outgoing_adv_network_pdu_len;
+    memcpy(test_network_pdu_data, outgoing_adv_network_pdu_data, test_network_pdu_len);
+    CHECK_EQUAL(0x5e, test_network_pdu_data[0] & 0x7f);
+    outgoing_adv_network_pdu_len = 0;
+    adv_bearer_emit_sent();
+
+    // received with friendship security credentials
+    mesh_network_received_message(test_network_pdu_data, test_network_pdu_len, 0);
+    while (received_network_pdu == NULL) {
+        mock_process_hci_cmd();
+    }
+    CHECK((received_network_pdu->flags & MESH_NETWORK_PDU_FLAGS_FRIENDSHIP) != 0);
+    CHECK_EQUAL(0x1201, received_network_pdu->lpn_address);
+    CHECK_EQUAL(3, mesh_network_ttl(received_network_pdu));
+
+    // relayed with NID of master security credentials
+    mesh_network_message_processed_by_higher_layer(received_network_pdu);
+    received_network_pdu = NULL;
+    while (outgoing_adv_network_pdu_len == 0) {
+        mock_process_hci_cmd();
+    }
+    CHECK_EQUAL(test_network_pdu_len, outgoing_adv_network_pdu_len);
+    CHECK_EQUAL(0x68, outgoing_adv_network_pdu_data[0] & 0x7f);
+    outgoing_adv_network_pdu_len = 0;
+    adv_bearer_emit_sent();
+
+    mesh_network_key_friendship_remove(&friendship_key_nid_5e);
+    mesh_foundation_relay_set(relay);
+}
 
 // Message 19
 // The Low Power node sends another Health Current Status message indicating that there are three faults:
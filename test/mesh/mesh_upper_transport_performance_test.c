@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+// *****************************************************************************
+//
+// Mesh Upper Transport Layer decryption performance test
+//
+// Sets up a node with many AppKeys that share the same AID and many virtual
+// addresses that share the same hash. Unsegmented access messages encrypted
+// with the last matching AppKey and Label UUID are passed to the Upper Transport
+// Layer as received from the Lower Transport Layer and the number of messages
+// decrypted per second is reported, for a single source (key cache hit) and
+// for more sources than the key cache holds (key cache miss).
+//
+// Build with ENABLE_SOFTWARE_AES128 to try all keys in a single pass, without
+// it each AES128 operation is a round-trip to the (simulated) Controller.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_crypto.h"
+#include "btstack_debug.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "mesh/adv_bearer.h"
+#include "mesh/gatt_bearer.h"
+#include "mesh/mesh_access.h"
+#include "mesh/mesh_iv_index_seq_number.h"
+#include "mesh/mesh_keys.h"
+#include "mesh/mesh_lower_transport.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_upper_transport.h"
+#include "mesh/mesh_virtual_addresses.h"
+#include "rijndael.h"
+
+#include "mock.h"
+#include "perf_timer.h"
+
+#define NUM_ITERATIONS              20000
+#define NUM_APPKEYS                 16
+#define NUM_VIRTUAL_ADDRESSES       8
+#define NUM_SOURCES                 64
+#define APPKEY_AID                  0x2a
+#define VIRTUAL_ADDRESS_HASH        0x8123
+#define UNICAST_ADDRESS             0x0100
+#define FIRST_SOURCE_ADDRESS        0x0200
+#define PAYLOAD_LEN                 7
+#define TRANSMIC_LEN                4
+
+typedef struct {
+    const char * name;
+    uint16_t     dst;
+    uint16_t     num_sources;
+    int          valid;
+} message_template_t;
+
+static const message_template_t message_templates[] = {
+    { "Unicast, single source",  UNICAST_ADDRESS,      1,           1 },
+    { "Unicast, 64 sources",     UNICAST_ADDRESS,      NUM_SOURCES, 1 },
+    { "Virtual, single source",  VIRTUAL_ADDRESS_HASH, 1,           1 },
+    { "Virtual, 64 sources",     VIRTUAL_ADDRESS_HASH, NUM_SOURCES, 1 },
+    { "Unicast, unknown AppKey", UNICAST_ADDRESS,      1,           0 },
+};
+
+#define NUM_MESSAGE_TEMPLATES (sizeof(message_templates) / sizeof(message_template_t))
+
+static mesh_transport_key_t     appkeys[NUM_APPKEYS];
+static mesh_virtual_address_t * virtual_addresses[NUM_VIRTUAL_ADDRESSES];
+static const uint8_t            payload[PAYLOAD_LEN] = { 0x82, 0x02, 0x01, 0x00, 0x05, 0x01, 0x02 };
+
+static void (*higher_layer_handler)(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
+static mesh_network_pdu_t incoming_network_pdu;
+static uint32_t seq;
+static uint32_t messages_decrypted;
+static uint32_t messages_processed;
+static uint16_t expected_dst;
+static uint16_t expected_appkey_index;
+
+static void aes128_calc(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext){
+    uint32_t rk[RKLENGTH(KEYBITS)];
+    int nrounds = rijndaelSetupEncrypt(rk, key, KEYBITS);
+    rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+}
+
+// CCM with 13 byte nonce, optional 16 byte Label UUID as additional data, TransMIC appended to ciphertext
+static void ccm_encrypt(const uint8_t * key, const uint8_t * nonce, const uint8_t * label_uuid, const uint8_t * plaintext, uint16_t len, uint8_t * ciphertext){
+    uint8_t a_i[16];
+    uint8_t s_i[16];
+    uint8_t x_i[16];
+    uint8_t block[16];
+    uint16_t i;
+
+    block[0] = ((label_uuid != NULL) ? 0x40 : 0x00) | (((TRANSMIC_LEN - 2) / 2) << 3) | 1;
+    memcpy(&block[1], nonce, 13);
+    big_endian_store_16(block, 14, len);
+    aes128_calc(key, block, x_i);
+
+    if (label_uuid != NULL){
+        memset(block, 0, sizeof(block));
+        big_endian_store_16(block, 0, 16);
+        memcpy(&block[2], label_uuid, 14);
+        for (i = 0; i < 16; i++) x_i[i] ^= block[i];
+        aes128_calc(key, x_i, x_i);
+        memset(block, 0, sizeof(block));
+        memcpy(block, &label_uuid[14], 2);
+        for (i = 0; i < 16; i++) x_i[i] ^= block[i];
+        aes128_calc(key, x_i, x_i);
+    }
+
+    // single block message
+    for (i = 0; i < len; i++) x_i[i] ^= plaintext[i];
+    aes128_calc(key, x_i, x_i);
+
+    a_i[0] = 1;
+    memcpy(&a_i[1], nonce, 13);
+    big_endian_store_16(a_i, 14, 1);
+    aes128_calc(key, a_i, s_i);
+    for (i = 0; i < len; i++) ciphertext[i] = plaintext[i] ^ s_i[i];
+
+    big_endian_store_16(a_i, 14, 0);
+    aes128_calc(key, a_i, s_i);
+    for (i = 0; i < TRANSMIC_LEN; i++) ciphertext[len + i] = x_i[i] ^ s_i[i];
+}
+
+static void setup_message(uint16_t src, uint16_t dst, const mesh_transport_key_t * appkey, const mesh_virtual_address_t * virtual_address){
+    seq++;
+    uint8_t nonce[13];
+    nonce[0] = 0x01;
+    nonce[1] = 0x00;
+    big_endian_store_24(nonce, 2, seq);
+    big_endian_store_16(nonce, 5, src);
+    big_endian_store_16(nonce, 7, dst);
+    big_endian_store_32(nonce, 9, mesh_get_iv_index());
+
+    memset(&incoming_network_pdu, 0, sizeof(incoming_network_pdu));
+    incoming_network_pdu.pdu_header.pdu_type = MESH_PDU_TYPE_UNSEGMENTED;
+    incoming_network_pdu.netkey_index = 0;
+    incoming_network_pdu.data[0] = (mesh_get_iv_index() & 1) << 7;
+    incoming_network_pdu.data[1] = 5;
+    big_endian_store_24(incoming_network_pdu.data, 2, seq);
+    big_endian_store_16(incoming_network_pdu.data, 5, src);
+    big_endian_store_16(incoming_network_pdu.data, 7, dst);
+    incoming_network_pdu.data[9] = 0x40 | APPKEY_AID;
+    ccm_encrypt(appkey->key, nonce, (virtual_address != NULL) ? virtual_address->label_uuid : NULL, payload, PAYLOAD_LEN, &incoming_network_pdu.data[10]);
+    incoming_network_pdu.len = 10 + PAYLOAD_LEN + TRANSMIC_LEN;
+}
+
+static void node_init(void){
+    mesh_transport_key_t * appkey;
+    uint16_t i;
+    for (i = 0; i < NUM_APPKEYS; i++){
+        appkey = &appkeys[i];
+        appkey->internal_index = i;
+        appkey->netkey_index = 0;
+        appkey->appkey_index = i;
+        appkey->akf = 1;
+        appkey->aid = APPKEY_AID;
+        memset(appkey->key, 0x10 + i, 16);
+        mesh_transport_key_add(appkey);
+    }
+    for (i = 0; i < NUM_VIRTUAL_ADDRESSES; i++){
+        uint8_t label_uuid[16];
+        memset(label_uuid, 0xa0 + i, 16);
+        virtual_addresses[i] = mesh_virtual_address_register(label_uuid, VIRTUAL_ADDRESS_HASH);
+    }
+}
+
+// returns duration in us for NUM_ITERATIONS messages
+static uint32_t benchmark(const message_template_t * message_template){
+    // encrypted with last AppKey and last Label UUID to try, unknown AppKey for invalid messages
+    mesh_transport_key_t unknown_appkey;
+    memset(&unknown_appkey, 0x55, sizeof(unknown_appkey));
+    const mesh_transport_key_t * appkey = message_template->valid ? &appkeys[NUM_APPKEYS - 1] : &unknown_appkey;
+    const mesh_virtual_address_t * virtual_address = NULL;
+    expected_dst = message_template->dst;
+    expected_appkey_index = appkey->appkey_index;
+    if (mesh_network_address_virtual(message_template->dst)){
+        virtual_address = virtual_addresses[NUM_VIRTUAL_ADDRESSES - 1];
+        expected_dst = virtual_address->pseudo_dst;
+    }
+
+    messages_decrypted = 0;
+    messages_processed = 0;
+    uint32_t duration_us = 0;
+    uint32_t i;
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        uint16_t src = FIRST_SOURCE_ADDRESS + (i % message_template->num_sources);
+        setup_message(src, message_template->dst, appkey, virtual_address);
+        uint32_t start_us = perf_timer_get_time_us();
+        (*higher_layer_handler)(MESH_TRANSPORT_PDU_RECEIVED, MESH_TRANSPORT_STATUS_SUCCESS, (mesh_pdu_t *) &incoming_network_pdu);
+        // complete AES128 operations in Controller
+        while (messages_processed <= i){
+            if (mock_process_hci_cmd() == 0) break;
+        }
+        duration_us += perf_timer_get_time_us() - start_us;
+    }
+    return duration_us;
+}
+
+static void access_message_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
+    UNUSED(status);
+    if (callback_type != MESH_TRANSPORT_PDU_RECEIVED) return;
+    mesh_access_pdu_t * access_pdu = (mesh_access_pdu_t *) pdu;
+    if ((access_pdu->dst == expected_dst) && (access_pdu->appkey_index == expected_appkey_index) &&
+        (access_pdu->len == PAYLOAD_LEN) && (memcmp(access_pdu->data, payload, PAYLOAD_LEN) == 0)){
+        messages_decrypted++;
+    }
+    mesh_upper_transport_message_processed_by_higher_layer(pdu);
+}
+
+// Lower Transport Layer
+void mesh_lower_transport_set_higher_layer_handler(void (*pdu_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu)){
+    higher_layer_handler = pdu_handler;
+}
+
+void mesh_lower_transport_message_processed_by_higher_layer(mesh_pdu_t * pdu){
+    UNUSED(pdu);
+    messages_processed++;
+}
+
+bool mesh_lower_transport_can_send_to_dest(uint16_t dest){
+    UNUSED(dest);
+    return true;
+}
+
+void mesh_lower_transport_reserve_slot(void){
+}
+
+void mesh_lower_transport_send_pdu(mesh_pdu_t * pdu){
+    UNUSED(pdu);
+}
+
+void mesh_lower_transport_dump_network_pdus(const char *name, btstack_linked_list_t *list){
+    UNUSED(name);
+    UNUSED(list);
+}
+
+void mesh_lower_transport_reset_network_pdus(btstack_linked_list_t *list){
+    UNUSED(list);
+}
+
+void mesh_segmented_pdu_free(mesh_segmented_pdu_t * message_pdu){
+    UNUSED(message_pdu);
+}
+
+// Access Layer, no outgoing messages
+uint16_t mesh_pdu_dst(mesh_pdu_t * pdu){
+    UNUSED(pdu);
+    return MESH_ADDRESS_UNSASSIGNED;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    mock_init();
+    btstack_memory_init();
+    btstack_crypto_init();
+    mesh_upper_transport_init();
+    mesh_upper_transport_register_access_message_handler(&access_message_handler);
+    node_init();
+
+#ifdef ENABLE_SOFTWARE_AES128
+    const char * aes128 = "software AES128";
+#else
+    const char * aes128 = "Controller AES128";
+#endif
+    printf("%u AppKeys with same AID, %u virtual addresses with same hash, %u messages per type, %s, key cache size %u\n",
+           NUM_APPKEYS, NUM_VIRTUAL_ADDRESSES, NUM_ITERATIONS, aes128, MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE);
+    printf("%-28s %12s %10s %10s\n", "", "messages/s", "per msg", "decrypted");
+
+    int errors = 0;
+    uint16_t i;
+    for (i = 0; i < NUM_MESSAGE_TEMPLATES; i++){
+        const message_template_t * message_template = &message_templates[i];
+        uint32_t duration_us = benchmark(message_template);
+        uint32_t expected_decrypted = message_template->valid ? NUM_ITERATIONS : 0;
+        printf("%-28s %12.0f %8.2fus %10u\n", message_template->name,
+               (double) NUM_ITERATIONS * 1000000.0 / (double) duration_us,
+               (double) duration_us / (double) NUM_ITERATIONS, (unsigned int) messages_decrypted);
+        if ((messages_processed != NUM_ITERATIONS) || (messages_decrypted != expected_decrypted)){
+            printf("-> expected %u decrypted messages, %u processed\n", (unsigned int) expected_decrypted, (unsigned int) messages_processed);
+            errors++;
+        }
+    }
+    return errors;
+}
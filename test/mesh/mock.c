@@ -22,6 +22,11 @@ static int report_aes128;
 static int report_random;
 
 static uint32_t lfsr_random;
+
+// timers sorted by timeout, fired by mock_run_loop_advance_time_ms
+static btstack_linked_list_t timers;
+static uint32_t time_ms;
+static uint32_t num_timeouts;
 // #define ENABLE_PACKET_LOGGER
 // #define ENABLE_AES128_LOGGER
 
@@ -30,6 +35,9 @@ static uint32_t lfsr_random;
 
 void mock_init(void){
     lfsr_random = 0x12345678;
+    timers = NULL;
+    time_ms = 0;
+    num_timeouts = 0;
 }
 
 uint8_t * mock_packet_buffer(void){
@@ -157,33 +165,65 @@ void hci_add_event_handler(btstack_packet_callback_registration_t * callback_han
     btstack_linked_list_add_tail(&event_packet_handlers, (btstack_linked_item_t*) callback_handler);
 }
 
+void hci_add_event_handler_for_events(btstack_packet_callback_registration_t * callback_handler,
+                                      const uint8_t * event_codes, uint16_t num_event_codes,
+                                      const uint8_t * le_subevent_codes, uint16_t num_le_subevent_codes){
+    UNUSED(event_codes);
+    UNUSED(num_event_codes);
+    UNUSED(le_subevent_codes);
+    UNUSED(num_le_subevent_codes);
+    hci_add_event_handler(callback_handler);
+}
+
 HCI_STATE hci_get_state(void){
 	return HCI_STATE_WORKING;
 }
 
 void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
-    UNUSED(ts);
+    btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) &timers; it->next != NULL ; it = it->next){
+        btstack_timer_source_t * next = (btstack_timer_source_t *) it->next;
+        if ((int32_t)(ts->timeout - next->timeout) < 0) break;
+    }
+    ts->item.next = it->next;
+    it->next = (btstack_linked_item_t *) ts;
 }
 int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
-    UNUSED(ts);
-	return 0;
+	return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
 }
 void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout){
-    UNUSED(ts);
-    UNUSED(timeout);
+    ts->timeout = time_ms + timeout;
 }
 void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*fn)(btstack_timer_source_t * ts)){
-    UNUSED(ts);
-    UNUSED(fn);
+    ts->process = fn;
+}
+uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+void mock_run_loop_advance_time_ms(uint32_t time_delta_ms){
+    uint32_t end_ms = time_ms + time_delta_ms;
+    while (timers != NULL){
+        btstack_timer_source_t * ts = (btstack_timer_source_t *) timers;
+        if ((int32_t)(ts->timeout - end_ms) > 0) break;
+        // fire timer at its timeout
+        if ((int32_t)(ts->timeout - time_ms) > 0){
+            time_ms = ts->timeout;
+        }
+        btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+        num_timeouts++;
+        (*ts->process)(ts);
+    }
+    time_ms = end_ms;
+}
+uint32_t mock_run_loop_get_num_timeouts(void){
+    return num_timeouts;
 }
-static void * timer_context;
 void btstack_run_loop_set_timer_context(btstack_timer_source_t * ts, void * context){
-    UNUSED(ts);
-	timer_context = context;
+	ts->context = context;
 }
 void * btstack_run_loop_get_timer_context(btstack_timer_source_t * ts){
-    UNUSED(ts);
-	return timer_context;
+	return ts->context;
 }
 void hci_halting_defer(void){
 }
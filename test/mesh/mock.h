@@ -52,6 +52,10 @@ void mock_simulate_hci_event(uint8_t * packet, uint16_t size);
 int mock_process_hci_cmd(void);
 void mock_simulate_hci_state_working(void);
 
+// virtual time: timers only fire when time is advanced
+void mock_run_loop_advance_time_ms(uint32_t time_ms);
+uint32_t mock_run_loop_get_num_timeouts(void);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// L2CAP channel mock with a limited number of ACL buffers, GAP and Run Loop stubs
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_debug.h"
+#include "btstack_util.h"
+#include "btstack_run_loop.h"
+#include "bluetooth.h"
+#include "gap.h"
+#include "l2cap.h"
+
+#include "mock_l2cap.h"
+
+static btstack_packet_handler_t l2cap_packet_handler;
+static void (*send_handler)(uint16_t cid, const uint8_t * packet, uint16_t size);
+static uint8_t  outgoing_buffer[HCI_ACL_PAYLOAD_SIZE];
+static uint16_t l2cap_mtu;
+static int      acl_buffers_free;
+static int      acl_buffers_total;
+static int      buffer_reserved;
+static int      can_send_now_requested;
+static int      num_packets_sent;
+static uint32_t time_ms;
+static bd_addr_t local_addr = { 0x00, 0x1b, 0xdc, 0x07, 0x32, 0xef };
+
+void mock_l2cap_init(int num_acl_buffers, uint16_t mtu){
+    l2cap_mtu = mtu;
+    acl_buffers_free = num_acl_buffers;
+    acl_buffers_total = num_acl_buffers;
+    buffer_reserved = 0;
+    can_send_now_requested = 0;
+    num_packets_sent = 0;
+    send_handler = NULL;
+    time_ms = 0;
+}
+
+void mock_l2cap_set_send_handler(void (*handler)(uint16_t cid, const uint8_t * packet, uint16_t size)){
+    send_handler = handler;
+}
+
+int mock_l2cap_num_packets_sent(void){
+    return num_packets_sent;
+}
+
+void mock_gap_local_bd_addr(bd_addr_t addr){
+    bd_addr_copy(addr, local_addr);
+}
+
+void mock_run_loop_set_time_ms(uint32_t new_time_ms){
+    time_ms = new_time_ms;
+}
+
+static void emit_can_send_now(void){
+    if (can_send_now_requested == 0) return;
+    if (acl_buffers_free == 0) return;
+    can_send_now_requested = 0;
+    uint8_t event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 0, 0};
+    little_endian_store_16(event, 2, MOCK_L2CAP_CID);
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void mock_l2cap_complete_packets(int num_packets){
+    acl_buffers_free += num_packets;
+    emit_can_send_now();
+}
+
+void mock_l2cap_complete_all_packets(void){
+    mock_l2cap_complete_packets(acl_buffers_total - acl_buffers_free);
+}
+
+void mock_l2cap_receive(uint16_t cid, uint8_t * packet, uint16_t size){
+    (*l2cap_packet_handler)(L2CAP_DATA_PACKET, cid, packet, size);
+}
+
+void mock_l2cap_open_channel(bd_addr_t remote_addr, uint16_t psm){
+    uint8_t incoming[16];
+    incoming[0] = L2CAP_EVENT_INCOMING_CONNECTION;
+    incoming[1] = sizeof(incoming) - 2;
+    reverse_bd_addr(remote_addr, &incoming[2]);
+    little_endian_store_16(incoming,  8, 0x0001);
+    little_endian_store_16(incoming, 10, psm);
+    little_endian_store_16(incoming, 12, MOCK_L2CAP_CID);
+    little_endian_store_16(incoming, 14, MOCK_L2CAP_CID);
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, 0, incoming, sizeof(incoming));
+
+    uint8_t opened[24];
+    memset(opened, 0, sizeof(opened));
+    opened[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    opened[1] = sizeof(opened) - 2;
+    reverse_bd_addr(remote_addr, &opened[3]);
+    little_endian_store_16(opened,  9, 0x0001);
+    little_endian_store_16(opened, 11, psm);
+    little_endian_store_16(opened, 13, MOCK_L2CAP_CID);
+    little_endian_store_16(opened, 15, MOCK_L2CAP_CID);
+    little_endian_store_16(opened, 17, l2cap_mtu);
+    little_endian_store_16(opened, 19, l2cap_mtu);
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, 0, opened, sizeof(opened));
+}
+
+void mock_l2cap_close_channel(uint16_t cid){
+    uint8_t closed[4];
+    closed[0] = L2CAP_EVENT_CHANNEL_CLOSED;
+    closed[1] = 2;
+    little_endian_store_16(closed, 2, cid);
+    (*l2cap_packet_handler)(HCI_EVENT_PACKET, 0, closed, sizeof(closed));
+}
+
+// L2CAP
+
+uint8_t l2cap_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, uint16_t mtu, gap_security_level_t security_level){
+    UNUSED(psm);
+    UNUSED(mtu);
+    UNUSED(security_level);
+    l2cap_packet_handler = packet_handler;
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t l2cap_unregister_service(uint16_t psm){
+    UNUSED(psm);
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t l2cap_create_channel(btstack_packet_handler_t packet_handler, bd_addr_t address, uint16_t psm, uint16_t mtu, uint16_t * out_local_cid){
+    (void) address;
+    UNUSED(psm);
+    UNUSED(mtu);
+    l2cap_packet_handler = packet_handler;
+    *out_local_cid = MOCK_L2CAP_CID;
+    return ERROR_CODE_SUCCESS;
+}
+void l2cap_accept_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+void l2cap_decline_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
+    UNUSED(local_cid);
+    UNUSED(reason);
+}
+uint16_t l2cap_max_mtu(void){
+    return l2cap_mtu;
+}
+int l2cap_can_send_packet_now(uint16_t local_cid){
+    UNUSED(local_cid);
+    return (acl_buffers_free > 0) && (buffer_reserved == 0);
+}
+int l2cap_can_send_prepared_packet_now(uint16_t local_cid){
+    UNUSED(local_cid);
+    return acl_buffers_free > 0;
+}
+void l2cap_request_can_send_now_event(uint16_t local_cid){
+    UNUSED(local_cid);
+    can_send_now_requested = 1;
+    emit_can_send_now();
+}
+int l2cap_reserve_packet_buffer(void){
+    buffer_reserved = 1;
+    return 1;
+}
+void l2cap_release_packet_buffer(void){
+    buffer_reserved = 0;
+}
+uint8_t * l2cap_get_outgoing_buffer(void){
+    return outgoing_buffer;
+}
+int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
+    buffer_reserved = 0;
+    if (acl_buffers_free == 0) return BTSTACK_ACL_BUFFERS_FULL;
+    acl_buffers_free--;
+    num_packets_sent++;
+    if (send_handler != NULL){
+        (*send_handler)(local_cid, outgoing_buffer, len);
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+// GAP
+
+gap_security_level_t gap_get_security_level(void){
+    return LEVEL_2;
+}
+void gap_local_bd_addr(bd_addr_t address){
+    mock_gap_local_bd_addr(address);
+}
+
+// Run Loop
+
+void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    UNUSED(timer);
+    UNUSED(timeout_in_ms);
+}
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+    timer->process = process;
+}
+void btstack_run_loop_set_timer_context(btstack_timer_source_t * timer, void * context){
+    timer->context = context;
+}
+void * btstack_run_loop_get_timer_context(btstack_timer_source_t * timer){
+    return timer->context;
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    return 1;
+}
+uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
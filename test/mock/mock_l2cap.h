@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+#ifndef MOCK_L2CAP_H
+#define MOCK_L2CAP_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define MOCK_L2CAP_CID 0x0041
+
+// reset l2cap mock with given number of ACL buffers and channel MTU
+void mock_l2cap_init(int num_acl_buffers, uint16_t mtu);
+
+// open l2cap channel MOCK_L2CAP_CID for psm from remote device, incoming connection needs to be accepted by packet handler
+void mock_l2cap_open_channel(bd_addr_t remote_addr, uint16_t psm);
+
+// close l2cap channel
+void mock_l2cap_close_channel(uint16_t cid);
+
+// mark ACL packets as completed, emits pending can send now events
+void mock_l2cap_complete_packets(int num_packets);
+
+// mark all ACL packets as completed, emits pending can send now events
+void mock_l2cap_complete_all_packets(void);
+
+// deliver sent l2cap packets to this handler
+void mock_l2cap_set_send_handler(void (*handler)(uint16_t cid, const uint8_t * packet, uint16_t size));
+
+// deliver l2cap packet to registered packet handler
+void mock_l2cap_receive(uint16_t cid, uint8_t * packet, uint16_t size);
+
+// number of l2cap packets sent
+int mock_l2cap_num_packets_sent(void);
+
+// local bd_addr
+void mock_gap_local_bd_addr(bd_addr_t addr);
+
+// run loop time
+void mock_run_loop_set_time_ms(uint32_t time_ms);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+//
+// btstack_config.h for PBAP Client unit test
+//
+
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+// BTstack features that can be enabled
+#define ENABLE_CLASSIC
+#define ENABLE_GOEP_L2CAP
+#define ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#define ENABLE_LOG_ERROR
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 1021
+#define HCI_INCOMING_PRE_BUFFER_SIZE 14
+#define MAX_NR_GOEP_CLIENT_CONNECTIONS 3
+#define MAX_NR_PBAP_CLIENT_CONNECTIONS 3
+
+#endif
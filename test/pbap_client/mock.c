@@ -0,0 +1,444 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "btstack_defines.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_linked_list.h"
+#include "btstack_util.h"
+#include "bluetooth_sdp.h"
+#include "l2cap.h"
+#include "classic/obex.h"
+#include "classic/rfcomm.h"
+#include "classic/sdp_client.h"
+#include "classic/sdp_util.h"
+
+#include "mock.h"
+
+#define MAX_CHANNELS        8
+#define MAX_PHONEBOOK_LEN   (256 * 1024)
+
+typedef enum {
+    PSE_IDLE = 0,
+    PSE_CONNECT,
+    PSE_DISCONNECT,
+    PSE_GET,
+    PSE_SUCCESS,
+} pse_response_t;
+
+typedef struct {
+    pse_response_t response;
+    uint16_t       max_packet_len;
+    uint32_t       offset;
+    int            get_active;
+    int            srm_enabled;
+    int            first_response;
+} pse_state_t;
+
+// SDP
+static btstack_linked_list_t    sdp_query_requests;
+static btstack_packet_handler_t sdp_query_handler;
+static int                      sdp_query_active;
+static int                      sdp_num_queries;
+
+// L2CAP
+static mock_l2cap_channel_t channels[MAX_CHANNELS];
+static pse_state_t          pse_states[MAX_CHANNELS];
+static int                  num_channels;
+static int                  num_disconnects;
+static l2cap_ertm_config_t  ertm_override_config;
+static uint32_t             ertm_override_size;
+static void (*send_handler)(uint16_t local_cid, const uint8_t * packet, uint16_t size);
+
+// PSE
+static uint8_t  phonebook[MAX_PHONEBOOK_LEN];
+static uint32_t phonebook_len;
+
+void mock_init(void){
+    sdp_query_requests = NULL;
+    sdp_query_handler = NULL;
+    sdp_query_active = 0;
+    sdp_num_queries = 0;
+    memset(channels, 0, sizeof(channels));
+    memset(pse_states, 0, sizeof(pse_states));
+    num_channels = 0;
+    num_disconnects = 0;
+    ertm_override_size = 0;
+    send_handler = NULL;
+    mock_pse_set_phonebook(10);
+}
+
+// SDP
+
+int mock_sdp_num_queries(void){
+    return sdp_num_queries;
+}
+
+int mock_sdp_query_active(void){
+    return sdp_query_active;
+}
+
+static void mock_sdp_emit_attribute(uint16_t attribute_id, const uint8_t * value, uint16_t value_len){
+    uint16_t i;
+    for (i=0;i<value_len;i++){
+        uint8_t event[11];
+        event[0] = SDP_EVENT_QUERY_ATTRIBUTE_VALUE;
+        event[1] = sizeof(event) - 2;
+        little_endian_store_16(event, 2, 0);
+        little_endian_store_16(event, 4, attribute_id);
+        little_endian_store_16(event, 6, value_len);
+        little_endian_store_16(event, 8, i);
+        event[10] = value[i];
+        (*sdp_query_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+}
+
+static void mock_sdp_notify_next(void){
+    if (sdp_query_active) return;
+    btstack_context_callback_registration_t * request = (btstack_context_callback_registration_t *) btstack_linked_list_pop(&sdp_query_requests);
+    if (request == NULL) return;
+    (*request->callback)(request->context);
+}
+
+void mock_sdp_complete_query(uint8_t status){
+    if (sdp_query_active == 0) return;
+    if (status == ERROR_CODE_SUCCESS){
+        const uint8_t psm[] = { DE_UINT << 3 | DE_SIZE_16, MOCK_PSE_L2CAP_PSM >> 8, MOCK_PSE_L2CAP_PSM & 0xff };
+        mock_sdp_emit_attribute(BLUETOOTH_ATTRIBUTE_GOEP_L2CAP_PSM, psm, sizeof(psm));
+        const uint8_t features[] = { DE_UINT << 3 | DE_SIZE_32, 0x00, 0x00, 0x03, 0xff };
+        mock_sdp_emit_attribute(BLUETOOTH_ATTRIBUTE_PBAP_SUPPORTED_FEATURES, features, sizeof(features));
+    }
+    uint8_t event[3];
+    event[0] = SDP_EVENT_QUERY_COMPLETE;
+    event[1] = 1;
+    event[2] = status;
+    sdp_query_active = 0;
+    (*sdp_query_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    mock_sdp_notify_next();
+}
+
+uint8_t sdp_client_register_query_callback(btstack_context_callback_registration_t * callback_registration){
+    bool added = btstack_linked_list_add_tail(&sdp_query_requests, (btstack_linked_item_t*) callback_registration);
+    if (!added) return ERROR_CODE_COMMAND_DISALLOWED;
+    mock_sdp_notify_next();
+    return ERROR_CODE_SUCCESS;
+}
+
+void sdp_client_unregister_query_callback(btstack_context_callback_registration_t * callback_registration){
+    (void) btstack_linked_list_remove(&sdp_query_requests, (btstack_linked_item_t*) callback_registration);
+}
+
+int mock_sdp_num_pending_requests(void){
+    return btstack_linked_list_count(&sdp_query_requests);
+}
+
+uint8_t sdp_client_query_uuid16(btstack_packet_handler_t callback, bd_addr_t remote, uint16_t uuid){
+    (void) remote;
+    UNUSED(uuid);
+    if (sdp_query_active) return SDP_QUERY_BUSY;
+    sdp_query_handler = callback;
+    sdp_query_active = 1;
+    sdp_num_queries++;
+    return ERROR_CODE_SUCCESS;
+}
+
+// L2CAP
+
+int mock_l2cap_num_channels(void){
+    return num_channels;
+}
+
+mock_l2cap_channel_t * mock_l2cap_get_channel(int index){
+    return &channels[index];
+}
+
+mock_l2cap_channel_t * mock_l2cap_channel_for_cid(uint16_t local_cid){
+    int i;
+    for (i=0;i<num_channels;i++){
+        if (channels[i].local_cid == local_cid) return &channels[i];
+    }
+    return NULL;
+}
+
+static pse_state_t * mock_pse_state_for_cid(uint16_t local_cid){
+    int i;
+    for (i=0;i<num_channels;i++){
+        if (channels[i].local_cid == local_cid) return &pse_states[i];
+    }
+    return NULL;
+}
+
+void mock_l2cap_set_ertm_override(const l2cap_ertm_config_t * ertm_config, uint32_t size){
+    ertm_override_config = *ertm_config;
+    ertm_override_size = size;
+}
+
+void mock_l2cap_set_send_handler(void (*handler)(uint16_t local_cid, const uint8_t * packet, uint16_t size)){
+    send_handler = handler;
+}
+
+int mock_l2cap_num_disconnects(void){
+    return num_disconnects;
+}
+
+void mock_l2cap_open_channel(uint16_t local_cid){
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    channel->open = 1;
+    uint8_t event[26];
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    reverse_bd_addr(channel->address, &event[3]);
+    little_endian_store_16(event,  9, 0x0001);
+    little_endian_store_16(event, 11, MOCK_PSE_L2CAP_PSM);
+    little_endian_store_16(event, 13, local_cid);
+    little_endian_store_16(event, 15, local_cid);
+    little_endian_store_16(event, 17, channel->ertm_config.local_mtu);
+    little_endian_store_16(event, 19, MOCK_PSE_L2CAP_MTU);
+    event[24] = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void mock_l2cap_receive(uint16_t local_cid, uint8_t * packet, uint16_t size){
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    if (channel->open == 0) return;
+    (*channel->packet_handler)(L2CAP_DATA_PACKET, local_cid, packet, size);
+}
+
+uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_addr_t address, uint16_t psm,
+    l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size, uint16_t * out_local_cid){
+    UNUSED(psm);
+    if (num_channels == MAX_CHANNELS) return BTSTACK_MEMORY_ALLOC_FAILED;
+    mock_l2cap_channel_t * channel = &channels[num_channels];
+    memset(channel, 0, sizeof(mock_l2cap_channel_t));
+    memset(&pse_states[num_channels], 0, sizeof(pse_state_t));
+    num_channels++;
+    channel->packet_handler = packet_handler;
+    bd_addr_copy(channel->address, address);
+    channel->local_cid = 0x40 + num_channels;
+    channel->ertm_config = *ertm_config;
+    channel->buffer = buffer;
+    channel->size = size;
+    if (ertm_override_size){
+        channel->ertm_config = ertm_override_config;
+        size = ertm_override_size;
+    }
+    // same layout as l2cap_ertm_configure_channel, worst case alignment
+    uint32_t pos = 16;
+    pos += channel->ertm_config.num_rx_buffers * sizeof(l2cap_ertm_rx_packet_state_t);
+    pos += channel->ertm_config.num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t);
+    pos += channel->ertm_config.local_mtu;
+    channel->local_mps = (size - pos) / (channel->ertm_config.num_rx_buffers + channel->ertm_config.num_tx_buffers);
+    *out_local_cid = channel->local_cid;
+    return ERROR_CODE_SUCCESS;
+}
+
+void l2cap_request_can_send_now_event(uint16_t local_cid){
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CAN_SEND_NOW;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, local_cid);
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+int l2cap_send(uint16_t local_cid, uint8_t *data, uint16_t len){
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    if (len > MOCK_PSE_L2CAP_MTU) return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
+    if (send_handler != NULL){
+        (*send_handler)(local_cid, data, len);
+    } else {
+        mock_pse_handle_request(local_cid, data, len);
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
+    UNUSED(reason);
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(local_cid);
+    if (channel == NULL) return;
+    num_disconnects++;
+    channel->open = 0;
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CHANNEL_CLOSED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, local_cid);
+    (*channel->packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+// RFCOMM - not used by PSE
+
+uint8_t rfcomm_create_channel(btstack_packet_handler_t packet_handler, bd_addr_t addr, uint8_t server_channel, uint16_t * out_cid){
+    UNUSED(packet_handler);
+    (void) addr;
+    UNUSED(server_channel);
+    UNUSED(out_cid);
+    return SDP_SERVICE_NOT_FOUND;
+}
+void rfcomm_disconnect(uint16_t rfcomm_cid){
+    UNUSED(rfcomm_cid);
+}
+uint16_t rfcomm_get_max_frame_size(uint16_t rfcomm_cid){
+    UNUSED(rfcomm_cid);
+    return 0;
+}
+uint8_t * rfcomm_get_outgoing_buffer(void){
+    return NULL;
+}
+int rfcomm_reserve_packet_buffer(void){
+    return 0;
+}
+void rfcomm_request_can_send_now_event(uint16_t rfcomm_cid){
+    UNUSED(rfcomm_cid);
+}
+int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
+    UNUSED(rfcomm_cid);
+    UNUSED(len);
+    return 0;
+}
+
+// PSE
+
+void mock_pse_set_phonebook(uint16_t num_vcards){
+    phonebook_len = 0;
+    uint16_t i;
+    for (i=0;i<num_vcards;i++){
+        char vcard[200];
+        int len = snprintf(vcard, sizeof(vcard),
+                           "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Contact %04u\r\nN:%04u;Contact\r\nTEL;TYPE=CELL:+49 170 %07u\r\nEMAIL:contact%04u@example.com\r\nEND:VCARD\r\n",
+                           i, i, i, i);
+        if ((phonebook_len + len) > MAX_PHONEBOOK_LEN) break;
+        memcpy(&phonebook[phonebook_len], vcard, len);
+        phonebook_len += len;
+    }
+}
+
+const uint8_t * mock_pse_get_phonebook(void){
+    return phonebook;
+}
+
+uint32_t mock_pse_get_phonebook_len(void){
+    return phonebook_len;
+}
+
+static int mock_pse_srm_requested(const uint8_t * packet, uint16_t size){
+    uint16_t pos = 3;
+    while (pos < size){
+        uint8_t hi = packet[pos];
+        switch (hi >> 6){
+            case 2:
+                if ((hi == OBEX_HEADER_SINGLE_RESPONSE_MODE) && (packet[pos+1] == OBEX_SRM_ENABLE)) return 1;
+                pos += 2;
+                break;
+            case 3:
+                pos += 5;
+                break;
+            default:
+                pos += big_endian_read_16(packet, pos + 1);
+                break;
+        }
+    }
+    return 0;
+}
+
+void mock_pse_handle_request(uint16_t local_cid, const uint8_t * packet, uint16_t size){
+    pse_state_t * pse = mock_pse_state_for_cid(local_cid);
+    if (pse == NULL) return;
+    switch (packet[0]){
+        case OBEX_OPCODE_CONNECT:
+            pse->max_packet_len = big_endian_read_16(packet, 5);
+            pse->response = PSE_CONNECT;
+            break;
+        case OBEX_OPCODE_DISCONNECT:
+            pse->response = PSE_DISCONNECT;
+            break;
+        case OBEX_OPCODE_GET | OBEX_OPCODE_FINAL_BIT_MASK:
+            if (pse->get_active == 0){
+                pse->get_active = 1;
+                pse->offset = 0;
+                pse->first_response = 1;
+                pse->srm_enabled = mock_pse_srm_requested(packet, size);
+            }
+            pse->response = PSE_GET;
+            break;
+        default:
+            pse->get_active = 0;
+            pse->response = PSE_SUCCESS;
+            break;
+    }
+}
+
+uint16_t mock_pse_get_response(uint16_t local_cid, uint8_t * buffer, uint16_t buffer_size){
+    pse_state_t * pse = mock_pse_state_for_cid(local_cid);
+    if (pse == NULL) return 0;
+    uint16_t pos = 3;
+    switch (pse->response){
+        case PSE_IDLE:
+            return 0;
+        case PSE_CONNECT:
+            buffer[0] = OBEX_RESP_SUCCESS;
+            buffer[pos++] = OBEX_VERSION;
+            buffer[pos++] = 0;
+            big_endian_store_16(buffer, pos, MOCK_PSE_L2CAP_MTU);
+            pos += 2;
+            buffer[pos++] = OBEX_HEADER_CONNECTION_ID;
+            big_endian_store_32(buffer, pos, 0x1234);
+            pos += 4;
+            pse->response = PSE_IDLE;
+            break;
+        case PSE_GET: {
+            buffer[0] = OBEX_RESP_CONTINUE;
+            if (pse->first_response && pse->srm_enabled){
+                buffer[pos++] = OBEX_HEADER_SINGLE_RESPONSE_MODE;
+                buffer[pos++] = OBEX_SRM_ENABLE;
+            }
+            pse->first_response = 0;
+            uint16_t max_packet_len = btstack_min(btstack_min(pse->max_packet_len, MOCK_PSE_L2CAP_MTU), buffer_size);
+            uint32_t body_len = btstack_min(phonebook_len - pse->offset, max_packet_len - pos - 3);
+            uint8_t hi = OBEX_HEADER_BODY;
+            if ((pse->offset + body_len) == phonebook_len){
+                buffer[0] = OBEX_RESP_SUCCESS;
+                hi = OBEX_HEADER_END_OF_BODY;
+                pse->get_active = 0;
+            }
+            buffer[pos++] = hi;
+            big_endian_store_16(buffer, pos, 3 + body_len);
+            pos += 2;
+            memcpy(&buffer[pos], &phonebook[pse->offset], body_len);
+            pos += body_len;
+            pse->offset += body_len;
+            // without SRM, next response is sent after next GET request
+            if ((buffer[0] == OBEX_RESP_SUCCESS) || (pse->srm_enabled == 0)){
+                pse->response = PSE_IDLE;
+            }
+            break;
+        }
+        default:
+            buffer[0] = OBEX_RESP_SUCCESS;
+            pse->response = PSE_IDLE;
+            break;
+    }
+    big_endian_store_16(buffer, 1, pos);
+    return pos;
+}
+
+void mock_run(void){
+    int delivered = 1;
+    while (delivered){
+        delivered = 0;
+        int i;
+        for (i=0;i<num_channels;i++){
+            uint8_t response[MOCK_PSE_L2CAP_MTU];
+            if (channels[i].open == 0) continue;
+            uint16_t len = mock_pse_get_response(channels[i].local_cid, response, btstack_min(sizeof(response), channels[i].ertm_config.local_mtu));
+            if (len == 0) continue;
+            mock_l2cap_receive(channels[i].local_cid, response, len);
+            delivered = 1;
+        }
+    }
+}
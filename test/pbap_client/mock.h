@@ -0,0 +1,79 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+#include "l2cap.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// PSE advertises GOEP L2CAP PSM in SDP record
+#define MOCK_PSE_L2CAP_PSM 0x1025
+#define MOCK_PSE_L2CAP_MTU 4096
+
+typedef struct {
+    btstack_packet_handler_t packet_handler;
+    bd_addr_t                address;
+    uint16_t                 local_cid;
+    // ERTM config and resulting MPS as calculated by l2cap_create_ertm_channel
+    l2cap_ertm_config_t      ertm_config;
+    uint16_t                 local_mps;
+    uint8_t *                buffer;
+    uint32_t                 size;
+    int                      open;
+} mock_l2cap_channel_t;
+
+// reset SDP, L2CAP and PSE mock
+void mock_init(void);
+
+// number of SDP queries started so far
+int mock_sdp_num_queries(void);
+
+// SDP query in progress
+int mock_sdp_query_active(void);
+
+// report PSE SDP record with GOEP L2CAP PSM or fail query with given status, starts next pending query
+void mock_sdp_complete_query(uint8_t status);
+int mock_sdp_num_pending_requests(void);
+
+// ERTM channels created by l2cap_create_ertm_channel
+int mock_l2cap_num_channels(void);
+mock_l2cap_channel_t * mock_l2cap_get_channel(int index);
+mock_l2cap_channel_t * mock_l2cap_channel_for_cid(uint16_t local_cid);
+
+// use given ERTM config and buffer size instead of the one provided by GOEP Client for local MTU and MPS
+void mock_l2cap_set_ertm_override(const l2cap_ertm_config_t * ertm_config, uint32_t size);
+
+// emit L2CAP_EVENT_CHANNEL_OPENED for channel
+void mock_l2cap_open_channel(uint16_t local_cid);
+
+// deliver L2CAP SDU to GOEP Client
+void mock_l2cap_receive(uint16_t local_cid, uint8_t * packet, uint16_t size);
+
+// number of l2cap_disconnect calls
+int mock_l2cap_num_disconnects(void);
+
+// PSE: phonebook with given number of vCards
+void mock_pse_set_phonebook(uint16_t num_vcards);
+const uint8_t * mock_pse_get_phonebook(void);
+uint32_t mock_pse_get_phonebook_len(void);
+
+// PSE: next OBEX response for channel, returns 0 if none pending
+uint16_t mock_pse_get_response(uint16_t local_cid, uint8_t * buffer, uint16_t buffer_size);
+
+// deliver OBEX requests sent by GOEP Client to this handler instead of the PSE, e.g. to simulate latency
+void mock_l2cap_set_send_handler(void (*handler)(uint16_t local_cid, const uint8_t * packet, uint16_t size));
+
+// PSE: process OBEX request
+void mock_pse_handle_request(uint16_t local_cid, const uint8_t * packet, uint16_t size);
+
+// deliver pending PSE responses on all channels until idle
+void mock_run(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// PBAP Client vCard pull performance test
+//
+// Pulls a phonebook from simulated PSEs over L2CAP ERTM links with limited
+// bandwidth and fixed latency in 1 ms steps. The PSE responds with SRM, so it
+// streams OBEX packets and is only limited by the ERTM TX window: it segments
+// each OBEX packet into I-Frames of the MPS configured by the GOEP Client and
+// sends a new I-Frame when the link has capacity and less than TX window
+// I-Frames are unacknowledged. Each received I-Frame is acknowledged after the
+// latency. All connections share the same link.
+//
+// - legacy:         single 1000 byte ERTM buffer, MTU 512, 2 RX buffers
+// - per connection: ERTM buffer and config provided by GOEP Client
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/goep_client.h"
+#include "classic/pbap_client.h"
+
+#include "mock.h"
+
+#define MAX_CONNECTIONS  3
+#define NUM_VCARDS       500
+#define LINK_KBPS        2100
+#define QUEUE_SIZE       4096
+#define SDU_QUEUE_SIZE   4
+#define TIMEOUT_MS       600000
+
+typedef enum {
+    LINK_I_FRAME = 0,
+    LINK_ACK,
+    LINK_REQUEST,
+} link_item_type_t;
+
+typedef struct {
+    uint32_t         arrival_ms;
+    link_item_type_t type;
+    uint16_t         local_cid;
+    // I-Frame: last segment of SDU, request: OBEX packet
+    int              end_of_sdu;
+    uint8_t          request[100];
+    uint16_t         request_len;
+} link_item_t;
+
+typedef struct {
+    link_item_t items[QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} link_queue_t;
+
+typedef struct {
+    uint16_t pbap_cid;
+    uint16_t local_cid;
+    int      connected;
+    int      completed;
+    uint32_t bytes_received;
+    // remote: SDUs in transit and segmentation of current SDU
+    uint8_t  sdus[SDU_QUEUE_SIZE][MOCK_PSE_L2CAP_MTU];
+    uint16_t sdu_len[SDU_QUEUE_SIZE];
+    uint32_t sdu_head;
+    uint32_t sdu_send;
+    uint32_t sdu_tail;
+    uint16_t sdu_offset;
+    int      unacked;
+} connection_t;
+
+static bd_addr_t remote_addrs[MAX_CONNECTIONS] = {
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x01 },
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x02 },
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x03 },
+};
+
+static const l2cap_ertm_config_t legacy_ertm_config = {
+    1,      // ertm mandatory
+    2,      // max transmit
+    2000,
+    12000,
+    512,    // l2cap ertm mtu
+    2,
+    2,
+    0,      // No FCS
+};
+
+static link_queue_t   to_local;
+static link_queue_t   to_remote;
+static uint32_t       now_ms;
+static uint32_t       capacity;
+static uint32_t       latency_ms;
+static connection_t   connections[MAX_CONNECTIONS];
+static int            num_connections;
+
+static link_item_t * queue_add(link_queue_t * queue, link_item_type_t type, uint16_t local_cid){
+    link_item_t * item = &queue->items[queue->tail % QUEUE_SIZE];
+    item->arrival_ms = now_ms + latency_ms;
+    item->type = type;
+    item->local_cid = local_cid;
+    item->end_of_sdu = 0;
+    queue->tail++;
+    return item;
+}
+
+static link_item_t * queue_get(link_queue_t * queue){
+    if (queue->head == queue->tail) return NULL;
+    link_item_t * item = &queue->items[queue->head % QUEUE_SIZE];
+    if (item->arrival_ms > now_ms) return NULL;
+    queue->head++;
+    return item;
+}
+
+static connection_t * connection_for_local_cid(uint16_t local_cid){
+    int i;
+    for (i=0;i<num_connections;i++){
+        if (connections[i].local_cid == local_cid) return &connections[i];
+    }
+    return NULL;
+}
+
+static connection_t * connection_for_pbap_cid(uint16_t pbap_cid){
+    int i;
+    for (i=0;i<num_connections;i++){
+        if (connections[i].pbap_cid == pbap_cid) return &connections[i];
+    }
+    return NULL;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    connection_t * connection = connection_for_pbap_cid(channel);
+    if (connection == NULL) return;
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) != HCI_EVENT_PBAP_META) break;
+            switch (hci_event_pbap_meta_get_subevent_code(packet)){
+                case PBAP_SUBEVENT_CONNECTION_OPENED:
+                    connection->connected = pbap_subevent_connection_opened_get_status(packet) == 0;
+                    break;
+                case PBAP_SUBEVENT_OPERATION_COMPLETED:
+                    connection->completed = 1;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case PBAP_DATA_PACKET:
+            connection->bytes_received += size;
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_handler(uint16_t local_cid, const uint8_t * packet, uint16_t size){
+    link_item_t * item = queue_add(&to_remote, LINK_REQUEST, local_cid);
+    item->request_len = btstack_min(size, sizeof(item->request));
+    memcpy(item->request, packet, item->request_len);
+}
+
+static void remote_send(connection_t * connection, uint32_t * capacity){
+    mock_l2cap_channel_t * channel = mock_l2cap_channel_for_cid(connection->local_cid);
+    if ((channel == NULL) || (channel->open == 0)) return;
+    while (connection->unacked < channel->ertm_config.num_rx_buffers){
+        // fetch next OBEX response
+        if (connection->sdu_send == connection->sdu_tail){
+            if ((connection->sdu_tail - connection->sdu_head) == SDU_QUEUE_SIZE) return;
+            uint32_t index = connection->sdu_tail % SDU_QUEUE_SIZE;
+            uint16_t len = mock_pse_get_response(connection->local_cid, connection->sdus[index], channel->ertm_config.local_mtu);
+            if (len == 0) return;
+            connection->sdu_len[index] = len;
+            connection->sdu_tail++;
+        }
+        uint32_t index = connection->sdu_send % SDU_QUEUE_SIZE;
+        uint16_t sdu_len = connection->sdu_len[index];
+        uint16_t frame_len = btstack_min(channel->local_mps, sdu_len - connection->sdu_offset);
+        // ACL header, L2CAP header, ERTM control, SDU length in start segment
+        uint32_t frame_bytes = 4 + 4 + 2 + frame_len + ((connection->sdu_offset == 0) && (frame_len < sdu_len) ? 2 : 0);
+        if (*capacity < frame_bytes) return;
+        *capacity -= frame_bytes;
+        connection->sdu_offset += frame_len;
+        connection->unacked++;
+        link_item_t * item = queue_add(&to_local, LINK_I_FRAME, connection->local_cid);
+        if (connection->sdu_offset == sdu_len){
+            item->end_of_sdu = 1;
+            connection->sdu_offset = 0;
+            connection->sdu_send++;
+        }
+    }
+}
+
+static void step(void){
+    link_item_t * item;
+    connection_t * connection;
+
+    // remote receives acknowledgements and requests
+    while ((item = queue_get(&to_remote)) != NULL){
+        connection = connection_for_local_cid(item->local_cid);
+        switch (item->type){
+            case LINK_ACK:
+                connection->unacked--;
+                break;
+            default:
+                mock_pse_handle_request(item->local_cid, item->request, item->request_len);
+                break;
+        }
+    }
+
+    // remote sends, connections share link capacity
+    capacity += (LINK_KBPS * 1000 / 8) / 1000;
+    int i;
+    for (i=0;i<num_connections;i++){
+        remote_send(&connections[(now_ms + i) % num_connections], &capacity);
+    }
+    if (capacity > MOCK_PSE_L2CAP_MTU){
+        capacity = MOCK_PSE_L2CAP_MTU;
+    }
+
+    // local receives I-Frames and acknowledges each one
+    while ((item = queue_get(&to_local)) != NULL){
+        connection = connection_for_local_cid(item->local_cid);
+        queue_add(&to_remote, LINK_ACK, item->local_cid);
+        if (item->end_of_sdu == 0) continue;
+        uint32_t index = connection->sdu_head % SDU_QUEUE_SIZE;
+        connection->sdu_head++;
+        mock_l2cap_receive(connection->local_cid, connection->sdus[index], connection->sdu_len[index]);
+    }
+    now_ms++;
+}
+
+static int all_connections(int completed){
+    int i;
+    for (i=0;i<num_connections;i++){
+        if ((completed ? connections[i].completed : connections[i].connected) == 0) return 0;
+    }
+    return 1;
+}
+
+static void simulate(const char * name, int legacy, int connections_count, uint32_t one_way_latency_ms){
+    memset(&to_local, 0, sizeof(to_local));
+    memset(&to_remote, 0, sizeof(to_remote));
+    memset(connections, 0, sizeof(connections));
+    num_connections = connections_count;
+    latency_ms = one_way_latency_ms;
+    now_ms = 0;
+    capacity = 0;
+
+    mock_init();
+    mock_pse_set_phonebook(NUM_VCARDS);
+    if (legacy){
+        mock_l2cap_set_ertm_override(&legacy_ertm_config, 1000);
+    }
+    mock_l2cap_set_send_handler(&send_handler);
+    goep_client_init();
+    pbap_client_init();
+
+    int i;
+    for (i=0;i<num_connections;i++){
+        pbap_connect(&packet_handler, remote_addrs[i], &connections[i].pbap_cid);
+    }
+    for (i=0;i<num_connections;i++){
+        mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+        connections[i].local_cid = mock_l2cap_get_channel(i)->local_cid;
+        mock_l2cap_open_channel(connections[i].local_cid);
+    }
+    while (!all_connections(0) && (now_ms < TIMEOUT_MS)){
+        step();
+    }
+
+    uint32_t start_ms = now_ms;
+    for (i=0;i<num_connections;i++){
+        pbap_pull_phonebook(connections[i].pbap_cid, "telecom/pb.vcf");
+    }
+    while (!all_connections(1) && (now_ms < TIMEOUT_MS)){
+        step();
+    }
+    uint32_t duration_ms = now_ms - start_ms;
+
+    uint32_t bytes = 0;
+    for (i=0;i<num_connections;i++){
+        bytes += connections[i].bytes_received;
+    }
+    mock_l2cap_channel_t * channel = mock_l2cap_get_channel(0);
+    printf("  %-14s %u x latency %2u ms: MTU %4u, MPS %4u, window %2u: %6u ms, %5u kbit/s (link %u)\n", name,
+           num_connections, (unsigned int) one_way_latency_ms,
+           channel->ertm_config.local_mtu, channel->local_mps, channel->ertm_config.num_rx_buffers,
+           (unsigned int) duration_ms, (unsigned int) ((uint64_t) bytes * 8 / duration_ms), LINK_KBPS);
+
+    pbap_client_deinit();
+    goep_client_deinit();
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    mock_init();
+    mock_pse_set_phonebook(NUM_VCARDS);
+    printf("Pull phonebook with %u vCards, %u bytes\n", NUM_VCARDS, (unsigned int) mock_pse_get_phonebook_len());
+    static const uint32_t latencies[] = { 5, 20, 50 };
+    unsigned int i;
+    for (i=0;i<sizeof(latencies)/sizeof(uint32_t);i++){
+        simulate("legacy",         1, 1, latencies[i]);
+        simulate("per connection", 0, 1, latencies[i]);
+        simulate("per connection", 0, 3, latencies[i]);
+    }
+    return 0;
+}
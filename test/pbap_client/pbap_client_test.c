@@ -0,0 +1,266 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "classic/goep_client.h"
+#include "classic/pbap_client.h"
+
+#include "mock.h"
+
+#define NUM_CONNECTIONS   3
+#define MAX_PHONEBOOK_LEN 20000
+
+typedef struct {
+    uint16_t pbap_cid;
+    int      opened;
+    uint8_t  open_status;
+    int      closed;
+    int      completed;
+    uint8_t  complete_status;
+    uint8_t  data[MAX_PHONEBOOK_LEN];
+    uint32_t data_len;
+} connection_t;
+
+static bd_addr_t remote_addrs[NUM_CONNECTIONS + 1] = {
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x01 },
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x02 },
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x03 },
+    { 0x11, 0x22, 0x33, 0x44, 0x55, 0x04 },
+};
+
+static connection_t connections[NUM_CONNECTIONS];
+
+static connection_t * connection_for_cid(uint16_t pbap_cid){
+    int i;
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        if (connections[i].pbap_cid == pbap_cid) return &connections[i];
+    }
+    return NULL;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    connection_t * connection = connection_for_cid(channel);
+    if (connection == NULL) return;
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) != HCI_EVENT_PBAP_META) break;
+            switch (hci_event_pbap_meta_get_subevent_code(packet)){
+                case PBAP_SUBEVENT_CONNECTION_OPENED:
+                    connection->opened++;
+                    connection->open_status = pbap_subevent_connection_opened_get_status(packet);
+                    break;
+                case PBAP_SUBEVENT_CONNECTION_CLOSED:
+                    connection->closed++;
+                    break;
+                case PBAP_SUBEVENT_OPERATION_COMPLETED:
+                    connection->completed++;
+                    connection->complete_status = pbap_subevent_operation_completed_get_status(packet);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case PBAP_DATA_PACKET:
+            if ((connection->data_len + size) > sizeof(connection->data)) break;
+            memcpy(&connection->data[connection->data_len], packet, size);
+            connection->data_len += size;
+            break;
+        default:
+            break;
+    }
+}
+
+static void connect(int index){
+    uint8_t status = pbap_connect(&packet_handler, remote_addrs[index], &connections[index].pbap_cid);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+}
+
+// complete SDP query, open L2CAP channel and exchange OBEX Connect
+static void establish(int index){
+    mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+    mock_l2cap_open_channel(mock_l2cap_get_channel(index)->local_cid);
+    mock_run();
+}
+
+TEST_GROUP(PBAP_CLIENT){
+    void setup(void){
+        memset(connections, 0, sizeof(connections));
+        mock_init();
+        goep_client_init();
+        pbap_client_init();
+    }
+    void teardown(void){
+        pbap_client_deinit();
+        goep_client_deinit();
+    }
+};
+
+TEST(PBAP_CLIENT, ConnectionsGetOwnCidAndChannel){
+    int i;
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        connect(i);
+    }
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        establish(i);
+    }
+    CHECK_EQUAL(NUM_CONNECTIONS, mock_l2cap_num_channels());
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        CHECK_EQUAL(1, connections[i].opened);
+        CHECK_EQUAL(0, connections[i].open_status);
+        CHECK(connections[i].pbap_cid != 0);
+        if (i > 0){
+            CHECK(connections[i].pbap_cid != connections[i-1].pbap_cid);
+        }
+        MEMCMP_EQUAL(remote_addrs[i], mock_l2cap_get_channel(i)->address, 6);
+    }
+}
+
+TEST(PBAP_CLIENT, SdpQueriesSerialized){
+    connect(0);
+    connect(1);
+    CHECK_EQUAL(1, mock_sdp_num_queries());
+    mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+    CHECK_EQUAL(2, mock_sdp_num_queries());
+    CHECK_EQUAL(1, mock_sdp_query_active());
+    CHECK_EQUAL(1, mock_l2cap_num_channels());
+    mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+    CHECK_EQUAL(2, mock_l2cap_num_channels());
+    CHECK_EQUAL(0, mock_sdp_query_active());
+}
+
+TEST(PBAP_CLIENT, SdpFailureOnlyAffectsOwnConnection){
+    connect(0);
+    connect(1);
+    mock_sdp_complete_query(SDP_QUERY_INCOMPLETE);
+    CHECK_EQUAL(1, connections[0].opened);
+    CHECK_EQUAL(SDP_QUERY_INCOMPLETE, connections[0].open_status);
+    CHECK_EQUAL(0, connections[1].opened);
+    mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+    mock_l2cap_open_channel(mock_l2cap_get_channel(0)->local_cid);
+    mock_run();
+    CHECK_EQUAL(1, connections[1].opened);
+    CHECK_EQUAL(0, connections[1].open_status);
+}
+
+TEST(PBAP_CLIENT, DeinitDropsPendingSdpRequests){
+    connect(0);
+    connect(1);
+    CHECK_EQUAL(1, mock_sdp_num_pending_requests());
+    pbap_client_deinit();
+    goep_client_deinit();
+    CHECK_EQUAL(0, mock_sdp_num_pending_requests());
+    // completion of active query is ignored
+    goep_client_init();
+    pbap_client_init();
+    mock_sdp_complete_query(ERROR_CODE_SUCCESS);
+    CHECK_EQUAL(0, mock_l2cap_num_channels());
+    CHECK_EQUAL(0, connections[0].opened);
+    CHECK_EQUAL(0, connections[1].opened);
+}
+
+TEST(PBAP_CLIENT, TooManyConnections){
+    int i;
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        connect(i);
+    }
+    uint16_t pbap_cid;
+    CHECK_EQUAL(BTSTACK_MEMORY_ALLOC_FAILED, pbap_connect(&packet_handler, remote_addrs[NUM_CONNECTIONS], &pbap_cid));
+}
+
+TEST(PBAP_CLIENT, ErtmBufferPerConnection){
+    connect(0);
+    connect(1);
+    establish(0);
+    establish(1);
+    mock_l2cap_channel_t * a = mock_l2cap_get_channel(0);
+    mock_l2cap_channel_t * b = mock_l2cap_get_channel(1);
+    CHECK(a->buffer != b->buffer);
+    CHECK((a->buffer + a->size <= b->buffer) || (b->buffer + b->size <= a->buffer));
+    // I-Frames fit into single ACL packet
+    CHECK(a->local_mps >= btstack_min(a->ertm_config.local_mtu, HCI_ACL_PAYLOAD_SIZE - 10));
+    CHECK(a->local_mps <= HCI_ACL_PAYLOAD_SIZE - 10);
+    // window covers two OBEX packets of MTU size
+    CHECK(a->ertm_config.num_rx_buffers * a->local_mps >= 2 * a->ertm_config.local_mtu);
+    CHECK(a->ertm_config.num_rx_buffers <= 63);
+    CHECK_EQUAL(a->ertm_config.local_mtu, b->ertm_config.local_mtu);
+}
+
+TEST(PBAP_CLIENT, ConcurrentPullPhonebook){
+    mock_pse_set_phonebook(100);
+    CHECK(mock_pse_get_phonebook_len() <= MAX_PHONEBOOK_LEN);
+    int i;
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        connect(i);
+        establish(i);
+    }
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, pbap_pull_phonebook(connections[i].pbap_cid, "telecom/pb.vcf"));
+    }
+    // second operation on same connection is rejected while first one is active
+    CHECK_EQUAL(BTSTACK_BUSY, pbap_pull_phonebook(connections[0].pbap_cid, "telecom/pb.vcf"));
+    mock_run();
+    for (i=0;i<NUM_CONNECTIONS;i++){
+        CHECK_EQUAL(1, connections[i].completed);
+        CHECK_EQUAL(0, connections[i].complete_status);
+        CHECK_EQUAL(mock_pse_get_phonebook_len(), connections[i].data_len);
+        MEMCMP_EQUAL(mock_pse_get_phonebook(), connections[i].data, connections[i].data_len);
+    }
+}
+
+TEST(PBAP_CLIENT, PullPhonebookWithFlowControl){
+    mock_pse_set_phonebook(30);
+    connect(0);
+    establish(0);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, pbap_set_flow_control_mode(connections[0].pbap_cid, 1));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, pbap_pull_phonebook(connections[0].pbap_cid, "telecom/pb.vcf"));
+    int packets = 0;
+    while (connections[0].completed == 0){
+        mock_run();
+        pbap_next_packet(connections[0].pbap_cid);
+        packets++;
+        if (packets > 100) break;
+    }
+    CHECK(packets > 1);
+    CHECK_EQUAL(0, connections[0].complete_status);
+    CHECK_EQUAL(mock_pse_get_phonebook_len(), connections[0].data_len);
+    MEMCMP_EQUAL(mock_pse_get_phonebook(), connections[0].data, connections[0].data_len);
+}
+
+TEST(PBAP_CLIENT, DisconnectClosesL2capChannel){
+    connect(0);
+    connect(1);
+    establish(0);
+    establish(1);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, pbap_disconnect(connections[0].pbap_cid));
+    mock_run();
+    CHECK_EQUAL(1, mock_l2cap_num_disconnects());
+    CHECK_EQUAL(1, connections[0].closed);
+    CHECK_EQUAL(0, connections[1].closed);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, pbap_pull_phonebook(connections[0].pbap_cid, "telecom/pb.vcf"));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, pbap_pull_phonebook(connections[1].pbap_cid, "telecom/pb.vcf"));
+    mock_run();
+    CHECK_EQUAL(1, connections[1].completed);
+
+    // slot can be reused
+    uint16_t old_cid = connections[0].pbap_cid;
+    connect(0);
+    CHECK(connections[0].pbap_cid != old_cid);
+}
+
+TEST(PBAP_CLIENT, UnknownCid){
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, pbap_pull_phonebook(0x1234, "telecom/pb.vcf"));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, pbap_disconnect(0x1234));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, goep_client_disconnect(0x1234));
+    CHECK_EQUAL(PBAP_FEATURES_NOT_PRESENT, goep_client_get_pbap_supported_features(0x1234));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Link Key DB FS performance test
+//
+// Stores N link keys and measures time for storing them and for startup
+// (open + iterate over all keys) with the record log based btstack_link_key_db_fs
+// compared to the previous format with one text file per link key and a
+// directory scan for iteration.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tinydir.h"
+
+#include "btstack_link_key_db_fs.h"
+#include "btstack_record_log_posix.h"
+#include "btstack_util.h"
+#include "perf_timer.h"
+
+extern "C" uint32_t btstack_run_loop_get_time_ms(void) { return 0; }
+
+static const uint32_t num_keys_list[] = { 100, 1000, 10000 };
+
+static bd_addr_t local_addr = { 0x00, 0x1b, 0xdc, 0x07, 0x32, 0xef };
+
+static void remote_addr(uint32_t i, bd_addr_t addr){
+    addr[0] = 0x11;
+    addr[1] = 0x22;
+    big_endian_store_32(addr, 2, i);
+}
+
+static void clear_directory(void){
+    tinydir_dir dir;
+    tinydir_open(&dir, LINK_KEY_PATH);
+    while (dir.has_next) {
+        tinydir_file file;
+        tinydir_readfile(&dir, &file);
+        tinydir_next(&dir);
+        if (file.is_dir) continue;
+        remove(file.path);
+    }
+    tinydir_close(&dir);
+}
+
+static void dash_str(char * buffer, bd_addr_t addr){
+    strcpy(buffer, bd_addr_to_str(addr));
+    char * p;
+    for (p = buffer; *p != 0; p++){
+        if (*p == ':') *p = '-';
+    }
+}
+
+// previous format: LINK_KEY_PATH/btstack_at_<local>_link_key_for_<remote>.txt with hex link key and type digit
+static void legacy_path(char * path, bd_addr_t addr){
+    char local_str[18];
+    char remote_str[18];
+    dash_str(local_str, local_addr);
+    dash_str(remote_str, addr);
+    sprintf(path, "%sbtstack_at_%s_link_key_for_%s.txt", LINK_KEY_PATH, local_str, remote_str);
+}
+
+static void legacy_put(bd_addr_t addr, link_key_t link_key, link_key_type_t type){
+    char path[200];
+    legacy_path(path, addr);
+    FILE * file = fopen(path, "w+");
+    if (file == NULL) return;
+    int i;
+    for (i=0;i<LINK_KEY_LEN;i++){
+        fprintf(file, "%02X", link_key[i]);
+    }
+    fprintf(file, "%d", (int) type);
+    fclose(file);
+}
+
+static uint32_t legacy_iterate(void){
+    char local_str[18];
+    char prefix[100];
+    dash_str(local_str, local_addr);
+    sprintf(prefix, "btstack_at_%s_link_key_for_", local_str);
+    uint32_t count = 0;
+    tinydir_dir dir;
+    tinydir_open(&dir, LINK_KEY_PATH);
+    while (dir.has_next) {
+        tinydir_file file;
+        tinydir_readfile(&dir, &file);
+        tinydir_next(&dir);
+        if (strncmp(prefix, file.name, strlen(prefix)) != 0) continue;
+        bd_addr_t addr;
+        sscanf_bd_addr(&file.name[strlen(prefix)], addr);
+        char buffer[LINK_KEY_STR_LEN + 2];
+        FILE * rFile = fopen(file.path, "r");
+        if (rFile == NULL) continue;
+        if (fread(buffer, 1, LINK_KEY_STR_LEN + 1, rFile) == (LINK_KEY_STR_LEN + 1)){
+            count++;
+        }
+        fclose(rFile);
+    }
+    tinydir_close(&dir);
+    return count;
+}
+
+static uint32_t record_log_iterate(const btstack_link_key_db_t * db){
+    db->open();
+    db->set_local_bd_addr(local_addr);
+    btstack_link_key_iterator_t it;
+    bd_addr_t addr;
+    link_key_t link_key;
+    link_key_type_t type;
+    uint32_t count = 0;
+    db->iterator_init(&it);
+    while (db->iterator_get_next(&it, addr, link_key, &type)){
+        count++;
+    }
+    db->iterator_done(&it);
+    return count;
+}
+
+static void measure(uint32_t num_keys){
+    const btstack_link_key_db_t * db = btstack_link_key_db_fs_instance();
+    link_key_t link_key;
+    memset(link_key, 0x55, sizeof(link_key));
+    bd_addr_t addr;
+    uint32_t i;
+
+    // legacy: one file per key
+    clear_directory();
+    uint32_t start_us = perf_timer_get_time_us();
+    for (i=0;i<num_keys;i++){
+        remote_addr(i, addr);
+        legacy_put(addr, link_key, COMBINATION_KEY);
+    }
+    double legacy_put_us = (double) (perf_timer_get_time_us() - start_us);
+    start_us = perf_timer_get_time_us();
+    uint32_t legacy_count = legacy_iterate();
+    double legacy_startup_us = (double) (perf_timer_get_time_us() - start_us);
+
+    // record log
+    clear_directory();
+    db->open();
+    db->set_local_bd_addr(local_addr);
+    start_us = perf_timer_get_time_us();
+    for (i=0;i<num_keys;i++){
+        remote_addr(i, addr);
+        db->put_link_key(addr, link_key, COMBINATION_KEY);
+    }
+    db->close();
+    double log_put_us = (double) (perf_timer_get_time_us() - start_us);
+    start_us = perf_timer_get_time_us();
+    uint32_t log_count = record_log_iterate(db);
+    double log_startup_us = (double) (perf_timer_get_time_us() - start_us);
+    db->close();
+
+    printf("%5u keys\n", num_keys);
+    printf("  %-10s: put %7.2f us/key, startup %9.0f us (%u keys)\n", "file/key", legacy_put_us / num_keys, legacy_startup_us, legacy_count);
+    printf("  %-10s: put %7.2f us/key, startup %9.0f us (%u keys)\n", "record log", log_put_us / num_keys, log_startup_us, log_count);
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    mkdir(LINK_KEY_PATH, 0777);
+    printf("link key db in %s, fsync every %u records\n", LINK_KEY_PATH, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL);
+
+    unsigned int j;
+    for (j=0;j<sizeof(num_keys_list)/sizeof(uint32_t);j++){
+        measure(num_keys_list[j]);
+    }
+    clear_directory();
+    return 0;
+}
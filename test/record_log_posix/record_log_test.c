@@ -0,0 +1,393 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_record_log_posix.h"
+#include "ble/le_device_db.h"
+#include "btstack_util.h"
+#include "btstack_config.h"
+#include "btstack_debug.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TEST_LOG "/tmp/test_record_log.db"
+
+extern "C" uint32_t btstack_run_loop_get_time_ms(void) { return 0; }
+
+static long file_size(const char * path){
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    return (long) st.st_size;
+}
+
+TEST_GROUP(RecordLog){
+    btstack_record_log_posix_t log;
+    void setup(void){
+        unlink(TEST_LOG);
+        CHECK_EQUAL(0, btstack_record_log_posix_open(&log, TEST_LOG, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL));
+    }
+    void reopen(void){
+        btstack_record_log_posix_close(&log);
+        CHECK_EQUAL(0, btstack_record_log_posix_open(&log, TEST_LOG, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL));
+    }
+    void put_u32(uint32_t key, uint32_t value){
+        uint8_t key_buffer[4];
+        uint8_t value_buffer[4];
+        little_endian_store_32(key_buffer, 0, key);
+        little_endian_store_32(value_buffer, 0, value);
+        CHECK_EQUAL(0, btstack_record_log_posix_put(&log, key_buffer, 4, value_buffer, 4));
+    }
+    int get_u32(uint32_t key, uint32_t * value){
+        uint8_t key_buffer[4];
+        little_endian_store_32(key_buffer, 0, key);
+        const uint8_t * value_buffer;
+        uint16_t value_len;
+        if (btstack_record_log_posix_get(&log, key_buffer, 4, &value_buffer, &value_len) == 0) return 0;
+        if (value_len != 4) return 0;
+        *value = little_endian_read_32(value_buffer, 0);
+        return 1;
+    }
+    void delete_u32(uint32_t key){
+        uint8_t key_buffer[4];
+        little_endian_store_32(key_buffer, 0, key);
+        btstack_record_log_posix_delete(&log, key_buffer, 4);
+    }
+    void teardown(void){
+        btstack_record_log_posix_close(&log);
+    }
+};
+
+TEST(RecordLog, Missing){
+    uint32_t value;
+    CHECK_EQUAL(0, get_u32(1, &value));
+    CHECK_EQUAL(0, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, PutGet){
+    uint32_t value = 0;
+    put_u32(1, 0x11223344);
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(0x11223344, value);
+    CHECK_EQUAL(1, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, Overwrite){
+    uint32_t value = 0;
+    put_u32(1, 1);
+    put_u32(1, 2);
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(2, value);
+    CHECK_EQUAL(1, btstack_record_log_posix_count(&log));
+    reopen();
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(2, value);
+}
+
+TEST(RecordLog, UnchangedValueNotAppended){
+    put_u32(1, 1);
+    btstack_record_log_posix_sync(&log);
+    long size = file_size(TEST_LOG);
+    put_u32(1, 1);
+    btstack_record_log_posix_sync(&log);
+    CHECK_EQUAL(size, file_size(TEST_LOG));
+}
+
+TEST(RecordLog, Delete){
+    uint32_t value = 0;
+    put_u32(1, 1);
+    put_u32(2, 2);
+    delete_u32(1);
+    CHECK_EQUAL(0, get_u32(1, &value));
+    CHECK_EQUAL(1, btstack_record_log_posix_count(&log));
+    reopen();
+    CHECK_EQUAL(0, get_u32(1, &value));
+    CHECK_EQUAL(1, get_u32(2, &value));
+    CHECK_EQUAL(2, value);
+}
+
+TEST(RecordLog, ManyKeysReopen){
+    uint32_t i;
+    for (i=0;i<1000;i++){
+        put_u32(i, i * 3);
+    }
+    reopen();
+    CHECK_EQUAL(1000, btstack_record_log_posix_count(&log));
+    for (i=0;i<1000;i++){
+        uint32_t value = 0;
+        CHECK_EQUAL(1, get_u32(i, &value));
+        CHECK_EQUAL(i * 3, value);
+    }
+}
+
+TEST(RecordLog, TruncatedTail){
+    uint32_t value = 0;
+    put_u32(1, 1);
+    put_u32(2, 2);
+    btstack_record_log_posix_close(&log);
+    // simulate power loss while writing last record
+    long size = file_size(TEST_LOG);
+    CHECK_EQUAL(0, truncate(TEST_LOG, size - 3));
+    CHECK_EQUAL(0, btstack_record_log_posix_open(&log, TEST_LOG, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL));
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(0, get_u32(2, &value));
+    // appending after truncated record works
+    put_u32(3, 3);
+    reopen();
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(1, get_u32(3, &value));
+    CHECK_EQUAL(3, value);
+    CHECK_EQUAL(2, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, InvalidHeader){
+    uint32_t value = 0;
+    btstack_record_log_posix_close(&log);
+    FILE * file = fopen(TEST_LOG, "wb");
+    fputs("# text file", file);
+    fclose(file);
+    CHECK_EQUAL(0, btstack_record_log_posix_open(&log, TEST_LOG, BTSTACK_RECORD_LOG_POSIX_SYNC_INTERVAL));
+    CHECK_EQUAL(0, btstack_record_log_posix_count(&log));
+    put_u32(1, 1);
+    reopen();
+    CHECK_EQUAL(1, get_u32(1, &value));
+}
+
+TEST(RecordLog, Compaction){
+    uint32_t value = 0;
+    uint32_t i;
+    put_u32(1, 1);
+    for (i=0;i<1000;i++){
+        put_u32(2, i);
+    }
+    // log has been compacted automatically
+    CHECK(log.num_records < 100);
+    CHECK(file_size(TEST_LOG) < 1000);
+    reopen();
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(1, value);
+    CHECK_EQUAL(1, get_u32(2, &value));
+    CHECK_EQUAL(999, value);
+    CHECK_EQUAL(0, btstack_record_log_posix_compact(&log));
+    CHECK_EQUAL(2, log.num_records);
+    put_u32(3, 3);
+    reopen();
+    CHECK_EQUAL(3, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, IterateAndDelete){
+    uint32_t i;
+    for (i=0;i<200;i++){
+        put_u32(i, i);
+    }
+    btstack_record_log_posix_iterator_t it;
+    const uint8_t * key;
+    uint8_t key_len;
+    const uint8_t * value;
+    uint16_t value_len;
+    uint32_t found = 0;
+    btstack_record_log_posix_iterator_init(&it, &log);
+    while (btstack_record_log_posix_iterator_next(&it, &key, &key_len, &value, &value_len)){
+        CHECK_EQUAL(4, key_len);
+        CHECK_EQUAL(4, value_len);
+        CHECK_EQUAL(little_endian_read_32(key, 0), little_endian_read_32(value, 0));
+        found++;
+        btstack_record_log_posix_delete(&log, key, key_len);
+    }
+    btstack_record_log_posix_iterator_done(&it);
+    CHECK_EQUAL(200, found);
+    CHECK_EQUAL(0, btstack_record_log_posix_count(&log));
+    reopen();
+    CHECK_EQUAL(0, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, IterateAndDeleteOthers){
+    uint32_t i;
+    for (i=0;i<200;i++){
+        put_u32(i, i);
+    }
+    btstack_record_log_posix_iterator_t it;
+    const uint8_t * key;
+    uint8_t key_len;
+    uint32_t found = 0;
+    btstack_record_log_posix_iterator_init(&it, &log);
+    while (btstack_record_log_posix_iterator_next(&it, &key, &key_len, NULL, NULL)){
+        found++;
+        // delete partner entry, which might be the next one
+        uint32_t partner = little_endian_read_32(key, 0) ^ 1u;
+        delete_u32(partner);
+        // update all other entries, new entries replace the old ones in the index
+        uint32_t j;
+        for (j=0;j<200;j++){
+            if (j == partner) continue;
+            uint32_t value;
+            if (get_u32(j, &value) == 0) continue;
+            put_u32(j, value + 1000);
+        }
+    }
+    btstack_record_log_posix_iterator_done(&it);
+    CHECK_EQUAL(100, found);
+    CHECK_EQUAL(100, btstack_record_log_posix_count(&log));
+}
+
+TEST(RecordLog, IterateAndAdd){
+    uint32_t i;
+    for (i=0;i<64;i++){
+        put_u32(i, i);
+    }
+    btstack_record_log_posix_iterator_t it;
+    uint32_t found = 0;
+    btstack_record_log_posix_iterator_init(&it, &log);
+    while (btstack_record_log_posix_iterator_next(&it, NULL, NULL, NULL, NULL)){
+        found++;
+        // index not rehashed while iterating
+        put_u32(1000 + found, found);
+    }
+    btstack_record_log_posix_iterator_done(&it);
+    CHECK(found >= 64);
+    uint32_t value = 0;
+    CHECK_EQUAL(1, get_u32(1000 + found, &value));
+    put_u32(2000, 2000);
+    CHECK(log.num_buckets > 64);
+    for (i=0;i<64;i++){
+        CHECK_EQUAL(1, get_u32(i, &value));
+        CHECK_EQUAL(i, value);
+    }
+}
+
+TEST(RecordLog, FailedAppendKeepsIndex){
+    uint32_t value = 0;
+    uint8_t key_buffer[4];
+    uint8_t value_buffer[4];
+    put_u32(1, 1);
+    // writes to read-only file fail
+    log.file = freopen(TEST_LOG, "rb", log.file);
+    CHECK(log.file != NULL);
+    little_endian_store_32(key_buffer, 0, 1);
+    little_endian_store_32(value_buffer, 0, 2);
+    CHECK(btstack_record_log_posix_put(&log, key_buffer, 4, value_buffer, 4) != 0);
+    little_endian_store_32(key_buffer, 0, 2);
+    CHECK(btstack_record_log_posix_put(&log, key_buffer, 4, value_buffer, 4) != 0);
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(1, value);
+    CHECK_EQUAL(0, get_u32(2, &value));
+    CHECK_EQUAL(1, btstack_record_log_posix_count(&log));
+    reopen();
+    CHECK_EQUAL(1, get_u32(1, &value));
+    CHECK_EQUAL(1, value);
+    CHECK_EQUAL(1, btstack_record_log_posix_count(&log));
+}
+
+// le_device_db_fs on top of record log
+TEST_GROUP(LeDeviceDbFs){
+    bd_addr_t local_addr;
+    bd_addr_t addr;
+    sm_key_t irk;
+    void setup(void){
+        bd_addr_t local = { 0x00, 0x1b, 0xdc, 0x07, 0x32, 0xef };
+        bd_addr_t remote = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+        memcpy(local_addr, local, 6);
+        memcpy(addr, remote, 6);
+        memset(irk, 0x42, 16);
+        unlink("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.db");
+        unlink("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.txt");
+        le_device_db_init();
+        le_device_db_set_local_bd_addr(local_addr);
+    }
+};
+
+TEST(LeDeviceDbFs, Persistence){
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, irk);
+    CHECK(index >= 0);
+    uint8_t rand[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    sm_key_t ltk;
+    memset(ltk, 0x33, 16);
+    le_device_db_encryption_set(index, 0x1234, rand, ltk, 16, 1, 0, 1);
+    sm_key_t csrk;
+    memset(csrk, 0x55, 16);
+    le_device_db_remote_csrk_set(index, csrk);
+    le_device_db_local_counter_set(index, 0x12345678);
+
+    // reload
+    le_device_db_init();
+    CHECK_EQUAL(0, le_device_db_count());
+    le_device_db_set_local_bd_addr(local_addr);
+    CHECK_EQUAL(1, le_device_db_count());
+
+    int addr_type;
+    bd_addr_t stored_addr;
+    sm_key_t stored_irk;
+    le_device_db_info(index, &addr_type, stored_addr, stored_irk);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, addr_type);
+    MEMCMP_EQUAL(addr, stored_addr, 6);
+    MEMCMP_EQUAL(irk, stored_irk, 16);
+
+    uint16_t ediv;
+    uint8_t stored_rand[8];
+    sm_key_t stored_ltk;
+    int key_size, authenticated, authorized, secure_connection;
+    le_device_db_encryption_get(index, &ediv, stored_rand, stored_ltk, &key_size, &authenticated, &authorized, &secure_connection);
+    CHECK_EQUAL(0x1234, ediv);
+    MEMCMP_EQUAL(rand, stored_rand, 8);
+    MEMCMP_EQUAL(ltk, stored_ltk, 16);
+    CHECK_EQUAL(16, key_size);
+    CHECK_EQUAL(1, authenticated);
+    CHECK_EQUAL(0, authorized);
+    CHECK_EQUAL(1, secure_connection);
+
+    sm_key_t stored_csrk;
+    le_device_db_remote_csrk_get(index, stored_csrk);
+    MEMCMP_EQUAL(csrk, stored_csrk, 16);
+    CHECK_EQUAL(0x12345678, le_device_db_local_counter_get(index));
+
+    // remove
+    le_device_db_remove(index);
+    le_device_db_init();
+    le_device_db_set_local_bd_addr(local_addr);
+    CHECK_EQUAL(0, le_device_db_count());
+}
+
+TEST(LeDeviceDbFs, ImportLegacyFormat){
+    // written by previous le_device_db_fs with ENABLE_LE_SIGNED_WRITE
+    FILE * file = fopen("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.txt", "w");
+    fputs("# addr_type, addr, irk, ltk, ediv, rand[8], key_size, authenticated, authorized, remote_csrk, remote_counter, local_csrk, local_counter, secure_connection\n", file);
+    fputs("00,11:22:33:44:55:66,42424242424242424242424242424242,33333333333333333333333333333333,1234,0102030405060708,10,01,00,"
+          "55555555555555555555555555555555,0007,00000000000000000000000000000000,0009,01,\n", file);
+    fclose(file);
+    unlink("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.db");
+
+    le_device_db_init();
+    le_device_db_set_local_bd_addr(local_addr);
+    CHECK_EQUAL(1, le_device_db_count());
+    CHECK_EQUAL(1, btstack_record_log_posix_exists("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.db"));
+
+    int addr_type;
+    bd_addr_t stored_addr;
+    sm_key_t stored_irk;
+    le_device_db_info(0, &addr_type, stored_addr, stored_irk);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, addr_type);
+    MEMCMP_EQUAL(addr, stored_addr, 6);
+    MEMCMP_EQUAL(irk, stored_irk, 16);
+    uint16_t ediv;
+    int key_size, authenticated, authorized, secure_connection;
+    le_device_db_encryption_get(0, &ediv, NULL, NULL, &key_size, &authenticated, &authorized, &secure_connection);
+    CHECK_EQUAL(0x1234, ediv);
+    CHECK_EQUAL(16, key_size);
+    CHECK_EQUAL(1, authenticated);
+    CHECK_EQUAL(0, authorized);
+    CHECK_EQUAL(1, secure_connection);
+    CHECK_EQUAL(7, le_device_db_remote_counter_get(0));
+    CHECK_EQUAL(9, le_device_db_local_counter_get(0));
+
+    // imported devices are stored in record log, legacy file is not read again
+    le_device_db_remove(0);
+    le_device_db_init();
+    le_device_db_set_local_bd_addr(local_addr);
+    CHECK_EQUAL(0, le_device_db_count());
+    unlink("/tmp/btstack_at_00-1B-DC-07-32-EF_le_device_db.txt");
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// Resampler performance test
+//
+// Converts ten seconds of a stereo test tone with the linear and the polyphase
+// resampler and reports CPU time per second of audio and the signal-to-noise
+// ratio against the ideal output.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "btstack_resample.h"
+#include "btstack_resample_polyphase.h"
+#include "perf_timer.h"
+
+#define NUM_CHANNELS    2
+#define NUM_SECONDS     10
+#define BLOCK_FRAMES    128
+#define TONE_HZ         1000.0
+#define AMPLITUDE       16000.0
+#define MAX_INPUT_RATE  48000
+#define MAX_OUTPUT_RATE 48000
+
+static int16_t input_samples[MAX_INPUT_RATE * NUM_SECONDS * NUM_CHANNELS];
+static int16_t output_samples[(MAX_OUTPUT_RATE * NUM_SECONDS + BLOCK_FRAMES) * NUM_CHANNELS];
+
+// compare first channel with ideal tone, position of output frame i in input frames is i * step - delay
+static double snr(uint32_t num_frames, uint32_t input_rate, uint32_t step, double delay){
+    double signal = 0;
+    double noise  = 0;
+    uint32_t i;
+    for (i = 0; i < num_frames; i++){
+        double input_pos = ((double) i * step / 65536.0) - delay;
+        if (input_pos < BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS) continue;
+        double expected = AMPLITUDE * sin(2.0 * M_PI * TONE_HZ * input_pos / input_rate);
+        double error = output_samples[i * NUM_CHANNELS] - expected;
+        signal += expected * expected;
+        noise  += error * error;
+    }
+    return 10.0 * log10(signal / noise);
+}
+
+static void test_rates(uint32_t input_rate, uint32_t output_rate){
+    uint32_t num_frames = (input_rate * NUM_SECONDS) / BLOCK_FRAMES * BLOCK_FRAMES;
+    uint32_t i;
+    for (i = 0; i < num_frames; i++){
+        int16_t sample = (int16_t) (AMPLITUDE * sin(2.0 * M_PI * TONE_HZ * i / input_rate));
+        input_samples[i * NUM_CHANNELS]     = sample;
+        input_samples[i * NUM_CHANNELS + 1] = sample;
+    }
+
+    // linear resampler
+    btstack_resample_t linear;
+    btstack_resample_init(&linear, NUM_CHANNELS);
+    uint32_t step = (uint32_t) (((uint64_t) input_rate << 16) / output_rate);
+    btstack_resample_set_factor(&linear, step);
+    uint32_t linear_start = perf_timer_get_time_us();
+    uint32_t linear_frames = 0;
+    for (i = 0; i < num_frames; i += BLOCK_FRAMES){
+        linear_frames += btstack_resample_block(&linear, &input_samples[i * NUM_CHANNELS], BLOCK_FRAMES, &output_samples[linear_frames * NUM_CHANNELS]);
+    }
+    uint32_t linear_us = perf_timer_get_time_us() - linear_start;
+    double linear_snr = snr(linear_frames, input_rate, step, 0.0);
+
+    // polyphase resampler
+    btstack_resample_polyphase_t polyphase;
+    btstack_resample_polyphase_init(&polyphase, NUM_CHANNELS);
+    btstack_resample_polyphase_set_sample_rates(&polyphase, input_rate, output_rate);
+    uint32_t polyphase_start = perf_timer_get_time_us();
+    uint32_t polyphase_frames = 0;
+    for (i = 0; i < num_frames; i += BLOCK_FRAMES){
+        polyphase_frames += btstack_resample_polyphase_block(&polyphase, &input_samples[i * NUM_CHANNELS], BLOCK_FRAMES, &output_samples[polyphase_frames * NUM_CHANNELS]);
+    }
+    uint32_t polyphase_us = perf_timer_get_time_us() - polyphase_start;
+    double polyphase_snr = snr(polyphase_frames, input_rate, step, BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS / 2);
+
+    printf("%5u -> %5u Hz: linear %6.1f us/s, SNR %5.1f dB - polyphase %6.1f us/s, SNR %5.1f dB\n",
+           input_rate, output_rate,
+           (double) linear_us / NUM_SECONDS, linear_snr,
+           (double) polyphase_us / NUM_SECONDS, polyphase_snr);
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+    printf("%u channels, %u taps, %u phases, %u frames per block\n",
+           NUM_CHANNELS, BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS, BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES, BLOCK_FRAMES);
+    test_rates(44100, 48000);
+    test_rates(48000, 44100);
+    test_rates(48000, 16000);
+    test_rates(16000, 48000);
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_resample.h"
+#include "btstack_resample_polyphase.h"
+
+#define MAX_FRAMES 20000
+#define DELAY_FRAMES (BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS / 2)
+
+static int16_t input_samples[MAX_FRAMES * 2];
+static int16_t output_samples[MAX_FRAMES * 4];
+static int16_t reference_samples[MAX_FRAMES * 4];
+
+static void create_sine(int16_t * buffer, int num_frames, int num_channels, float frequency, uint32_t sample_rate, float amplitude){
+    int i;
+    for (i = 0; i < num_frames; i++){
+        int channel;
+        for (channel = 0; channel < num_channels; channel++){
+            // second channel with phase shift
+            float phase = (2.0f * (float) M_PI * frequency * (float) i / (float) sample_rate) + (float) channel;
+            buffer[i * num_channels + channel] = (int16_t) (amplitude * sinf(phase));
+        }
+    }
+}
+
+// SNR of output against ideal sine
+static float sine_snr(const int16_t * buffer, int num_frames, int num_channels, int channel, float frequency, uint32_t input_rate, uint32_t step, float amplitude){
+    double signal = 0;
+    double noise  = 0;
+    int i;
+    for (i = 0; i < num_frames; i++){
+        double input_pos = ((double) i * (double) step / 65536.0) - DELAY_FRAMES;
+        // skip filter settle time
+        if (input_pos < DELAY_FRAMES) continue;
+        double expected  = amplitude * sin((2.0 * M_PI * frequency * input_pos / input_rate) + channel);
+        double error = buffer[i * num_channels + channel] - expected;
+        signal += expected * expected;
+        noise  += error * error;
+    }
+    return (float) (10.0 * log10(signal / noise));
+}
+
+// energy of output relative to full-scale sine
+static float relative_level(const int16_t * buffer, int num_frames, float amplitude){
+    double energy = 0;
+    int i;
+    for (i = 2 * DELAY_FRAMES; i < num_frames; i++){
+        energy += (double) buffer[i] * buffer[i];
+    }
+    energy /= (num_frames - 2 * DELAY_FRAMES);
+    return (float) (10.0 * log10(energy / (amplitude * amplitude * 0.5)));
+}
+
+TEST_GROUP(ResamplePolyphase){
+    btstack_resample_polyphase_t resample;
+
+    void setup(void){
+        btstack_resample_polyphase_init(&resample, 1);
+    }
+};
+
+TEST(ResamplePolyphase, IdentityFactor){
+    create_sine(input_samples, 4800, 1, 1000, 48000, 16000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 4800, output_samples);
+    CHECK_EQUAL(4800, frames);
+    CHECK(sine_snr(output_samples, frames, 1, 0, 1000, 48000, 0x10000, 16000) > 70.0f);
+}
+
+// fixed point filter design against Blackman windowed sinc calculated with libm
+TEST(ResamplePolyphase, FilterMatchesWindowedSinc){
+    btstack_resample_polyphase_set_sample_rates(&resample, 48000, 16000);
+    const int num_taps = BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS;
+    const double half_length = num_taps / 2;
+    const double cutoff = 0.9 * 16000.0 / 48000.0;
+    int phase;
+    for (phase = 0; phase <= BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES; phase++){
+        const int16_t * row = &resample.filter[phase * num_taps];
+        double expected[BTSTACK_RESAMPLE_POLYPHASE_NUM_TAPS];
+        double sum = 0;
+        int32_t row_sum = 0;
+        int tap;
+        for (tap = 0; tap < num_taps; tap++){
+            double x = (num_taps / 2 - 1) + ((double) phase / BTSTACK_RESAMPLE_POLYPHASE_NUM_PHASES) - tap;
+            double window = 0.42 + 0.5 * cos(M_PI * x / half_length) + 0.08 * cos(2.0 * M_PI * x / half_length);
+            double sinc = (x == 0.0) ? 1.0 : (sin(M_PI * cutoff * x) / (M_PI * cutoff * x));
+            expected[tap] = (fabs(x) >= half_length) ? 0.0 : (sinc * window);
+            sum += expected[tap];
+        }
+        for (tap = 0; tap < num_taps; tap++){
+            // rounding error of the row is added to the center tap
+            CHECK(fabs(row[tap] - (expected[tap] * 32768.0 / sum)) < 6.0);
+            row_sum += row[tap];
+        }
+        CHECK_EQUAL(32768, row_sum);
+    }
+}
+
+TEST(ResamplePolyphase, Upsample441To48){
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 48000);
+    uint32_t step = btstack_resample_polyphase_get_factor(&resample);
+    CHECK_EQUAL((44100u << 16) / 48000u, step);
+    create_sine(input_samples, 4410, 1, 1000, 44100, 16000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 4410, output_samples);
+    CHECK(abs(frames - 4800) <= 1);
+    CHECK(sine_snr(output_samples, frames, 1, 0, 1000, 44100, step, 16000) > 70.0f);
+}
+
+TEST(ResamplePolyphase, Downsample48To16){
+    btstack_resample_polyphase_set_sample_rates(&resample, 48000, 16000);
+    uint32_t step = btstack_resample_polyphase_get_factor(&resample);
+    CHECK_EQUAL(3 << 16, step);
+    create_sine(input_samples, 4800, 1, 1000, 48000, 16000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 4800, output_samples);
+    CHECK_EQUAL(1600, frames);
+    CHECK(sine_snr(output_samples, frames, 1, 0, 1000, 48000, step, 16000) > 60.0f);
+}
+
+TEST(ResamplePolyphase, DownsampleRejectsAlias){
+    btstack_resample_polyphase_set_sample_rates(&resample, 48000, 16000);
+    // 12 kHz is above output Nyquist frequency and would alias to 4 kHz
+    create_sine(input_samples, 4800, 1, 12000, 48000, 16000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 4800, output_samples);
+    CHECK(relative_level(output_samples, frames, 16000) < -40.0f);
+}
+
+TEST(ResamplePolyphase, BlockSizeInvariance){
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 48000);
+    create_sine(input_samples, 4410, 1, 3000, 44100, 20000);
+    uint16_t reference_frames = btstack_resample_polyphase_block(&resample, input_samples, 4410, reference_samples);
+
+    btstack_resample_polyphase_init(&resample, 1);
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 48000);
+    uint32_t input_pos  = 0;
+    uint32_t output_pos = 0;
+    uint32_t block_size = 1;
+    while (input_pos < 4410){
+        uint32_t num_frames = (4410 - input_pos) < block_size ? (4410 - input_pos) : block_size;
+        output_pos += btstack_resample_polyphase_block(&resample, &input_samples[input_pos], num_frames, &output_samples[output_pos]);
+        input_pos  += num_frames;
+        block_size = (block_size * 7 + 3) % 200 + 1;
+    }
+    CHECK_EQUAL(reference_frames, output_pos);
+    MEMCMP_EQUAL(reference_samples, output_samples, reference_frames * sizeof(int16_t));
+}
+
+TEST(ResamplePolyphase, Stereo){
+    btstack_resample_polyphase_init(&resample, 2);
+    btstack_resample_polyphase_set_sample_rates(&resample, 16000, 48000);
+    uint32_t step = btstack_resample_polyphase_get_factor(&resample);
+    create_sine(input_samples, 1600, 2, 500, 16000, 16000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 1600, output_samples);
+    CHECK(abs(frames - 4800) <= 1);
+    CHECK(sine_snr(output_samples, frames, 2, 0, 500, 16000, step, 16000) > 70.0f);
+    CHECK(sine_snr(output_samples, frames, 2, 1, 500, 16000, step, 16000) > 70.0f);
+}
+
+TEST(ResamplePolyphase, FullScaleSaturates){
+    int i;
+    for (i = 0; i < 1000; i++){
+        input_samples[i] = (i & 1) ? 32767 : -32768;
+    }
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 48000);
+    uint16_t frames = btstack_resample_polyphase_block(&resample, input_samples, 1000, output_samples);
+    CHECK(frames > 1000);
+}
+
+TEST(ResamplePolyphase, TrackBufferLevel){
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 44100);
+    CHECK_EQUAL(0x10000, btstack_resample_polyphase_get_factor(&resample));
+
+    // buffer at target
+    btstack_resample_polyphase_track_buffer_level(&resample, 1000, 1000);
+    CHECK_EQUAL(0x10000, btstack_resample_polyphase_get_factor(&resample));
+
+    // buffer too full -> consume faster
+    btstack_resample_polyphase_track_buffer_level(&resample, 1010, 1000);
+    uint32_t factor_full = btstack_resample_polyphase_get_factor(&resample);
+    CHECK(factor_full > 0x10000);
+
+    // integral keeps increasing factor while error persists
+    int i;
+    for (i = 0; i < 200; i++){
+        btstack_resample_polyphase_track_buffer_level(&resample, 1010, 1000);
+    }
+    CHECK(btstack_resample_polyphase_get_factor(&resample) > factor_full);
+
+    // correction is limited
+    for (i = 0; i < 100000; i++){
+        btstack_resample_polyphase_track_buffer_level(&resample, 100000, 0);
+    }
+    CHECK(btstack_resample_polyphase_get_factor(&resample) < 0x10000 + 0x100);
+
+    // buffer running empty -> stretch
+    btstack_resample_polyphase_set_sample_rates(&resample, 44100, 44100);
+    btstack_resample_polyphase_track_buffer_level(&resample, 800, 1000);
+    CHECK(btstack_resample_polyphase_get_factor(&resample) < 0x10000);
+}
+
+TEST(ResamplePolyphase, TrackDrift){
+    // source clock 100 ppm faster than sink clock: buffer level stays bounded
+    btstack_resample_polyphase_set_sample_rates(&resample, 48000, 48000);
+    double   buffer_level = 2000;
+    int i;
+    for (i = 0; i < 3000; i++){
+        // 10 ms packet: 480.048 frames produced, factor determines consumption
+        buffer_level += 480.048;
+        double factor = btstack_resample_polyphase_get_factor(&resample) / 65536.0;
+        buffer_level -= 480.0 * factor;
+        btstack_resample_polyphase_track_buffer_level(&resample, (uint32_t) buffer_level, 2000);
+    }
+    CHECK(fabs(buffer_level - 2000) < 10);
+    double factor = btstack_resample_polyphase_get_factor(&resample) / 65536.0;
+    CHECK(fabs(factor - 1.0001) < 0.00005);
+}
+
+TEST_GROUP(Resample){
+    btstack_resample_t resample;
+
+    void setup(void){
+        btstack_resample_init(&resample, 1);
+    }
+};
+
+TEST(Resample, IdentityFactor){
+    create_sine(input_samples, 1000, 1, 1000, 48000, 16000);
+    uint16_t frames = btstack_resample_block(&resample, input_samples, 1000, output_samples);
+    CHECK_EQUAL(999, frames);
+    MEMCMP_EQUAL(input_samples, output_samples, frames * sizeof(int16_t));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
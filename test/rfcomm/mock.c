@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "bluetooth_sdp.h"
+#include "hci.h"
+
+#include "mock.h"
+
+#define RFCOMM_FRAME_HEADER 5
+
+static uint8_t  incoming_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_PAYLOAD_SIZE];
+
+// frame from remote (initiator): C/R bit set for commands
+static void mock_rfcomm_receive_frame(uint8_t dlci, uint8_t control, const uint8_t * data, uint16_t len){
+    uint8_t * frame = &incoming_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
+    uint16_t pos = 0;
+    frame[pos++] = (dlci << 2) | 0x03;
+    frame[pos++] = control;
+    if (len < 128){
+        frame[pos++] = (len << 1) | 1;
+    } else {
+        frame[pos++] = (len & 0x7f) << 1;
+        frame[pos++] = len >> 7;
+    }
+    memcpy(&frame[pos], data, len);
+    pos += len;
+    frame[pos] = btstack_crc8_calc(frame, 2);
+    pos++;
+    mock_l2cap_receive(MOCK_L2CAP_CID, frame, pos);
+}
+
+void mock_rfcomm_receive_data(uint8_t server_channel, const uint8_t * data, uint16_t len){
+    mock_rfcomm_receive_frame(server_channel << 1, 0xef, data, len);
+}
+
+void mock_rfcomm_receive_credits(uint8_t server_channel, uint8_t credits){
+    uint8_t * frame = &incoming_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
+    frame[0] = (server_channel << 3) | 0x03;
+    frame[1] = 0xff;
+    frame[2] = 1;
+    frame[3] = credits;
+    frame[4] = btstack_crc8_calc(frame, 2);
+    mock_l2cap_receive(MOCK_L2CAP_CID, frame, 5);
+}
+
+void mock_rfcomm_receive_test_response(void){
+    uint8_t test_rsp[] = { 0x21, (1 << 1) | 1, 0x55 };
+    mock_rfcomm_receive_frame(0, 0xef, test_rsp, sizeof(test_rsp));
+}
+
+void mock_rfcomm_open_channel(bd_addr_t remote_addr, uint8_t server_channel){
+    mock_l2cap_open_channel(remote_addr, BLUETOOTH_PROTOCOL_RFCOMM);
+
+    uint8_t dlci = server_channel << 1;
+    uint16_t max_frame_size = MOCK_L2CAP_MTU - RFCOMM_FRAME_HEADER;
+
+    // SABM #0
+    mock_rfcomm_receive_frame(0, 0x3f, NULL, 0);
+
+    // PN CMD with credit based flow control, 0 initial credits for local device
+    uint8_t pn[] = { 0x83, (8 << 1) | 1, dlci, 0xf0, 0, 0, 0, 0, 0, 0 };
+    little_endian_store_16(pn, 6, max_frame_size);
+    mock_rfcomm_receive_frame(0, 0xef, pn, sizeof(pn));
+
+    // SABM #dlci
+    mock_rfcomm_receive_frame(dlci, 0x3f, NULL, 0);
+
+    // MSC CMD + MSC RSP
+    uint8_t msc_cmd[] = { 0xe3, (2 << 1) | 1, (uint8_t) ((dlci << 2) | 0x03), 0x8d };
+    mock_rfcomm_receive_frame(0, 0xef, msc_cmd, sizeof(msc_cmd));
+    uint8_t msc_rsp[] = { 0xe1, (2 << 1) | 1, (uint8_t) ((dlci << 2) | 0x03), 0x8d };
+    mock_rfcomm_receive_frame(0, 0xef, msc_rsp, sizeof(msc_rsp));
+}
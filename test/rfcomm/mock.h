@@ -0,0 +1,31 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+#include "bluetooth.h"
+
+#include "mock_l2cap.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define MOCK_L2CAP_MTU 1017
+
+// open RFCOMM multiplexer and channel from remote device, incoming connection needs to be accepted by packet handler
+void mock_rfcomm_open_channel(bd_addr_t remote_addr, uint8_t server_channel);
+
+// send RFCOMM UIH data frame from remote to channel
+void mock_rfcomm_receive_data(uint8_t server_channel, const uint8_t * data, uint16_t len);
+
+// send RFCOMM credits from remote to channel
+void mock_rfcomm_receive_credits(uint8_t server_channel, uint8_t credits);
+
+// send RFCOMM TEST response from remote
+void mock_rfcomm_receive_test_response(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// RFCOMM credit performance test
+//
+// Simulates an SPP stream similar to example/spp_streamer.c from a remote device
+// over a link with limited bandwidth and fixed latency in 1 ms steps. The remote
+// sends a frame whenever the link has capacity and it has RFCOMM credits.
+// Credits and TEST commands sent by RFCOMM reach the remote after the latency.
+//
+// Build with -DRFCOMM_CREDITS_MAX=10 for a fixed credit window as reference.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "classic/rfcomm.h"
+
+#include "mock.h"
+
+#define SERVER_CHANNEL   1
+#define FRAME_LEN        1000
+#define LINK_KBPS        2100
+#define DURATION_MS      10000
+#define QUEUE_SIZE       4096
+
+typedef enum {
+    PACKET_DATA = 0,
+    PACKET_CREDITS,
+    PACKET_TEST,
+} packet_type_t;
+
+typedef struct {
+    uint32_t      arrival_ms;
+    packet_type_t type;
+    uint8_t       credits;
+} link_packet_t;
+
+typedef struct {
+    link_packet_t packets[QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} link_queue_t;
+
+static bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static link_queue_t to_local;
+static link_queue_t to_remote;
+static uint32_t now_ms;
+static uint32_t latency_ms;
+
+static uint16_t rfcomm_cid;
+static int      local_streaming;
+static uint8_t  local_data[FRAME_LEN];
+
+static uint32_t frames_received;
+static uint32_t credit_frames;
+static uint32_t piggyback_frames;
+static int      remote_credits;
+static int      remote_credits_for_local;
+
+static void queue_add(link_queue_t * queue, packet_type_t type, uint8_t credits){
+    link_packet_t * packet = &queue->packets[queue->tail % QUEUE_SIZE];
+    packet->arrival_ms = now_ms + latency_ms;
+    packet->type = type;
+    packet->credits = credits;
+    queue->tail++;
+}
+
+static link_packet_t * queue_get(link_queue_t * queue){
+    if (queue->head == queue->tail) return NULL;
+    link_packet_t * packet = &queue->packets[queue->head % QUEUE_SIZE];
+    if (packet->arrival_ms > now_ms) return NULL;
+    queue->head++;
+    return packet;
+}
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case RFCOMM_EVENT_INCOMING_CONNECTION:
+                    rfcomm_accept_connection(rfcomm_event_incoming_connection_get_rfcomm_cid(packet));
+                    break;
+                case RFCOMM_EVENT_CHANNEL_OPENED:
+                    rfcomm_cid = rfcomm_event_channel_opened_get_rfcomm_cid(packet);
+                    break;
+                case RFCOMM_EVENT_CAN_SEND_NOW:
+                    if (!local_streaming) break;
+                    rfcomm_send(rfcomm_cid, local_data, sizeof(local_data) / 4);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case RFCOMM_DATA_PACKET:
+            frames_received++;
+            // respond to each frame
+            if (local_streaming){
+                rfcomm_request_can_send_now_event(rfcomm_cid);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_handler(uint16_t cid, const uint8_t * packet, uint16_t size){
+    UNUSED(cid);
+    UNUSED(size);
+    uint8_t dlci = packet[0] >> 2;
+    uint8_t length_offset = (packet[2] & 1) ^ 1;
+    uint16_t len = packet[2] >> 1;
+    if (length_offset){
+        len |= packet[3] << 7;
+    }
+    uint8_t pos = 3 + length_offset;
+    if (dlci == 0){
+        if ((packet[1] == 0xef) && (packet[pos] == 0x23)){
+            queue_add(&to_remote, PACKET_TEST, 0);
+        }
+        return;
+    }
+    if (len > 0){
+        queue_add(&to_remote, PACKET_DATA, 0);
+    }
+    if (packet[1] != 0xff) return;
+    if (len == 0){
+        credit_frames++;
+    } else {
+        piggyback_frames++;
+    }
+    queue_add(&to_remote, PACKET_CREDITS, packet[pos]);
+}
+
+static void simulate(const char * name, uint32_t one_way_latency_ms, int bidirectional){
+    memset(&to_local, 0, sizeof(to_local));
+    memset(&to_remote, 0, sizeof(to_remote));
+    now_ms = 0;
+    latency_ms = one_way_latency_ms;
+    frames_received = 0;
+    credit_frames = 0;
+    piggyback_frames = 0;
+    remote_credits = 0;
+    remote_credits_for_local = 0;
+    local_streaming = bidirectional;
+
+    btstack_memory_init();
+    mock_l2cap_init(8, MOCK_L2CAP_MTU);
+    rfcomm_init();
+    rfcomm_register_service(&packet_handler, SERVER_CHANNEL, 0xffff);
+    mock_l2cap_set_send_handler(&send_handler);
+    mock_rfcomm_open_channel(remote_addr, SERVER_CHANNEL);
+    mock_l2cap_complete_all_packets();
+    if (bidirectional){
+        mock_rfcomm_receive_credits(SERVER_CHANNEL, 20);
+    }
+
+    // link capacity in bytes per ms, with RFCOMM + L2CAP + ACL header
+    const uint32_t frame_bytes = FRAME_LEN + 5 + 4 + 4;
+    uint32_t capacity = 0;
+    uint32_t frames_at_start = 0;
+
+    for (now_ms = 0; now_ms < DURATION_MS; now_ms++){
+        mock_run_loop_set_time_ms(now_ms);
+
+        // remote receives
+        link_packet_t * packet;
+        while ((packet = queue_get(&to_remote)) != NULL){
+            switch (packet->type){
+                case PACKET_CREDITS:
+                    remote_credits += packet->credits;
+                    break;
+                case PACKET_TEST:
+                    queue_add(&to_local, PACKET_TEST, 0);
+                    break;
+                default:
+                    // remote provides credits in batches of 10
+                    remote_credits_for_local++;
+                    if (remote_credits_for_local == 10){
+                        queue_add(&to_local, PACKET_CREDITS, 10);
+                        remote_credits_for_local = 0;
+                    }
+                    break;
+            }
+        }
+
+        // remote sends
+        capacity += (LINK_KBPS * 1000 / 8) / 1000;
+        while ((capacity >= frame_bytes) && (remote_credits > 0)){
+            capacity -= frame_bytes;
+            remote_credits--;
+            queue_add(&to_local, PACKET_DATA, 0);
+        }
+        if (capacity > frame_bytes){
+            capacity = frame_bytes;
+        }
+
+        // local receives
+        uint8_t frame[FRAME_LEN];
+        memset(frame, 0x55, sizeof(frame));
+        while ((packet = queue_get(&to_local)) != NULL){
+            switch (packet->type){
+                case PACKET_DATA:
+                    mock_rfcomm_receive_data(SERVER_CHANNEL, frame, sizeof(frame));
+                    break;
+                case PACKET_CREDITS:
+                    mock_rfcomm_receive_credits(SERVER_CHANNEL, packet->credits);
+                    break;
+                default:
+                    mock_rfcomm_receive_test_response();
+                    break;
+            }
+        }
+        mock_l2cap_complete_all_packets();
+
+        // skip first second
+        if (now_ms == 1000){
+            frames_at_start = frames_received;
+        }
+    }
+
+    uint32_t frames = frames_received - frames_at_start;
+    uint32_t kbps = (frames * FRAME_LEN * 8) / (DURATION_MS - 1000);
+    printf("  %-16s latency %3u ms: %5u kbit/s (link %u), %4u credit frames, %4u piggybacked\n", name,
+           (unsigned int) one_way_latency_ms, (unsigned int) kbps, LINK_KBPS, (unsigned int) credit_frames, (unsigned int) piggyback_frames);
+
+    mock_l2cap_close_channel(MOCK_L2CAP_CID);
+    rfcomm_unregister_service(SERVER_CHANNEL);
+    btstack_memory_deinit();
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+#ifdef RFCOMM_CREDITS_MAX
+    printf("RFCOMM credit window: fixed, max %u credits\n", RFCOMM_CREDITS_MAX);
+#else
+    printf("RFCOMM credit window: adaptive\n");
+#endif
+    static const uint32_t latencies[] = { 5, 20, 50 };
+    unsigned int i;
+    for (i=0;i<sizeof(latencies)/sizeof(uint32_t);i++){
+        simulate("stream", latencies[i], 0);
+    }
+    for (i=0;i<sizeof(latencies)/sizeof(uint32_t);i++){
+        simulate("bidirectional", latencies[i], 1);
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_defines.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "classic/rfcomm.h"
+
+#include "mock.h"
+
+#define SERVER_CHANNEL 1
+#define FRAME_LEN      100
+
+static bd_addr_t remote_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static uint16_t rfcomm_cid;
+static int      channel_opened;
+static int      frames_received;
+static uint16_t app_send_len;
+static uint8_t  app_data[1100];
+
+// remote device state
+static int remote_credits;
+static int remote_credit_frames;
+static int remote_piggyback_frames;
+static int remote_data_frames;
+static int remote_test_commands;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case RFCOMM_EVENT_INCOMING_CONNECTION:
+                    rfcomm_accept_connection(rfcomm_event_incoming_connection_get_rfcomm_cid(packet));
+                    break;
+                case RFCOMM_EVENT_CHANNEL_OPENED:
+                    if (rfcomm_event_channel_opened_get_status(packet) != ERROR_CODE_SUCCESS) break;
+                    rfcomm_cid = rfcomm_event_channel_opened_get_rfcomm_cid(packet);
+                    channel_opened = 1;
+                    break;
+                case RFCOMM_EVENT_CAN_SEND_NOW:
+                    if (app_send_len == 0) break;
+                    rfcomm_send(rfcomm_cid, app_data, app_send_len);
+                    rfcomm_request_can_send_now_event(rfcomm_cid);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case RFCOMM_DATA_PACKET:
+            frames_received++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_handler(uint16_t cid, const uint8_t * packet, uint16_t size){
+    UNUSED(cid);
+    UNUSED(size);
+    uint8_t dlci = packet[0] >> 2;
+    uint8_t control = packet[1];
+    uint8_t length_offset = (packet[2] & 1) ^ 1;
+    uint16_t len = packet[2] >> 1;
+    if (length_offset){
+        len |= packet[3] << 7;
+    }
+    uint8_t pos = 3 + length_offset;
+    if (dlci == 0){
+        if ((control == 0xef) && (packet[pos] == 0x23)){
+            remote_test_commands++;
+        }
+        return;
+    }
+    if (control == 0xff){
+        remote_credits += packet[pos];
+        if (len == 0){
+            remote_credit_frames++;
+        } else {
+            remote_piggyback_frames++;
+        }
+    }
+    if (len > 0){
+        remote_data_frames++;
+    }
+}
+
+static void remote_send(int num_frames){
+    uint8_t frame[FRAME_LEN];
+    memset(frame, 0x55, sizeof(frame));
+    int i;
+    for (i=0;i<num_frames;i++){
+        if (remote_credits == 0) break;
+        remote_credits--;
+        mock_rfcomm_receive_data(SERVER_CHANNEL, frame, sizeof(frame));
+        mock_l2cap_complete_all_packets();
+    }
+}
+
+TEST_GROUP(RFCOMM){
+    void setup(void){
+        rfcomm_cid = 0;
+        channel_opened = 0;
+        frames_received = 0;
+        app_send_len = 0;
+        remote_credits = 0;
+        remote_credit_frames = 0;
+        remote_piggyback_frames = 0;
+        remote_data_frames = 0;
+        remote_test_commands = 0;
+        btstack_memory_init();
+        mock_l2cap_init(4, MOCK_L2CAP_MTU);
+        mock_l2cap_set_send_handler(&send_handler);
+        rfcomm_init();
+        rfcomm_register_service(&packet_handler, SERVER_CHANNEL, 0xffff);
+        mock_rfcomm_open_channel(remote_addr, SERVER_CHANNEL);
+        mock_l2cap_complete_all_packets();
+    }
+    void teardown(void){
+        mock_l2cap_close_channel(MOCK_L2CAP_CID);
+        rfcomm_unregister_service(SERVER_CHANNEL);
+        btstack_memory_deinit();
+    }
+    void receive_test_response_at(uint32_t time_ms){
+        mock_run_loop_set_time_ms(time_ms);
+        mock_rfcomm_receive_test_response();
+    }
+};
+
+TEST(RFCOMM, OpenGrantsInitialCredits){
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(10, remote_credits);
+}
+
+TEST(RFCOMM, GrantAtHalfWindow){
+    remote_send(4);
+    CHECK_EQUAL(4, frames_received);
+    CHECK_EQUAL(1, remote_credit_frames);
+    CHECK_EQUAL(6, remote_credits);
+    remote_send(1);
+    CHECK_EQUAL(2, remote_credit_frames);
+    CHECK_EQUAL(10, remote_credits);
+}
+
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+TEST(RFCOMM, RoundTripMeasuredWithTestCommand){
+    remote_send(1);
+    CHECK_EQUAL(1, remote_test_commands);
+    remote_send(1);
+    CHECK_EQUAL(1, remote_test_commands);
+    receive_test_response_at(40);
+    // next measurement after interval
+    mock_run_loop_set_time_ms(500);
+    remote_send(1);
+    CHECK_EQUAL(1, remote_test_commands);
+    mock_run_loop_set_time_ms(1100);
+    remote_send(1);
+    CHECK_EQUAL(2, remote_test_commands);
+}
+#else
+TEST(RFCOMM, NoTestCommandWithoutProbing){
+    uint32_t time_ms;
+    for (time_ms = 0; time_ms < 3000; time_ms += 100){
+        mock_run_loop_set_time_ms(time_ms);
+        remote_send(1);
+    }
+    CHECK_EQUAL(0, remote_test_commands);
+}
+#endif
+
+TEST(RFCOMM, WindowFollowsRateAndRoundTrip){
+    remote_send(1);
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+    receive_test_response_at(40);
+#endif
+    // remote delivers one frame per ms, bandwidth delay product: 40 frames
+    uint32_t time_ms;
+    for (time_ms = 41; time_ms < 300; time_ms++){
+        mock_run_loop_set_time_ms(time_ms);
+        remote_send(1);
+    }
+    CHECK_TRUE(remote_credits > 40);
+    CHECK_TRUE(remote_credits <= 128);
+}
+
+TEST(RFCOMM, WindowLimitedByCreditsMax){
+    remote_send(1);
+#ifdef ENABLE_RFCOMM_RTT_PROBING
+    receive_test_response_at(200);
+#endif
+    // 10 frames per ms
+    uint32_t time_ms;
+    for (time_ms = 201; time_ms < 1000; time_ms++){
+        mock_run_loop_set_time_ms(time_ms);
+        remote_send(10);
+    }
+    CHECK_TRUE(remote_credits >= 64);
+    CHECK_TRUE(remote_credits <= 128);
+}
+
+TEST(RFCOMM, CreditsPiggybackedOnData){
+    int credit_frames = remote_credit_frames;
+    app_send_len = 50;
+    mock_rfcomm_receive_credits(SERVER_CHANNEL, 200);
+    rfcomm_request_can_send_now_event(rfcomm_cid);
+    int i;
+    for (i=0;i<20;i++){
+        remote_send(1);
+    }
+    CHECK_EQUAL(20, frames_received);
+    CHECK_TRUE(remote_piggyback_frames > 0);
+    CHECK_EQUAL(credit_frames, remote_credit_frames);
+}
+
+TEST(RFCOMM, MaxSizeFrameNotPiggybacked){
+    int credit_frames = remote_credit_frames;
+    app_send_len = rfcomm_get_max_frame_size(rfcomm_cid);
+    mock_rfcomm_receive_credits(SERVER_CHANNEL, 200);
+    rfcomm_request_can_send_now_event(rfcomm_cid);
+    int i;
+    for (i=0;i<20;i++){
+        remote_send(1);
+    }
+    CHECK_EQUAL(20, frames_received);
+    CHECK_EQUAL(0, remote_piggyback_frames);
+    CHECK_TRUE(remote_credit_frames > credit_frames);
+    CHECK_TRUE(remote_credits > 0);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
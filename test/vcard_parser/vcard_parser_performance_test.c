@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2021 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+// *****************************************************************************
+//
+// vCard Parser performance test
+//
+// Parses a generated phonebook with 10000 contacts as received in PBAP_DATA_PACKETs
+// of different sizes and compares against buffering the complete phonebook and
+// parsing it line by line afterwards.
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_util.h"
+#include "classic/vcard_parser.h"
+#include "perf_timer.h"
+
+#define NUM_CONTACTS     10000
+#define NUM_ITERATIONS   10
+// every 20th contact has a photo
+#define PHOTO_INTERVAL   20
+#define PHOTO_SIZE       3000
+#define LINE_BUFFER_SIZE 8192
+
+typedef struct {
+    uint32_t cards;
+    uint32_t fn_bytes;
+    uint32_t tel;
+    uint32_t tel_cell;
+    uint32_t email;
+    uint32_t photo_bytes;
+    uint32_t checksum;
+} phonebook_stats_t;
+
+static char *   phonebook;
+static uint32_t phonebook_len;
+static uint32_t phonebook_max_card_len;
+
+static void phonebook_append(const char * text){
+    uint32_t len = (uint32_t) strlen(text);
+    memcpy(&phonebook[phonebook_len], text, len);
+    phonebook_len += len;
+}
+
+// vCard 3.0 as sent by phones, long lines folded at 75 characters
+static void phonebook_generate(void){
+    static const char * first_names[] = { "Anna", "Ben", "Clara", "David", "Eva", "Felix", "Greta", "Hannes" };
+    static const char * last_names[]  = { "Schmidt", "Mueller", "Weber", "Wagner", "Becker", "Hoffmann", "Schulz" };
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char line[200];
+    phonebook = (char *) malloc(NUM_CONTACTS * 600 + (NUM_CONTACTS / PHOTO_INTERVAL) * (PHOTO_SIZE * 2));
+    phonebook_len = 0;
+    phonebook_max_card_len = 0;
+    srand(42);
+    int i;
+    for (i = 0; i < NUM_CONTACTS; i++){
+        uint32_t card_start = phonebook_len;
+        const char * first_name = first_names[i % 8];
+        const char * last_name  = last_names[(i / 8) % 7];
+        phonebook_append("BEGIN:VCARD\r\nVERSION:3.0\r\n");
+        snprintf(line, sizeof(line), "FN:%s %s %05u\r\nN:%s;%s;;;\r\n", first_name, last_name, i, last_name, first_name);
+        phonebook_append(line);
+        snprintf(line, sizeof(line), "TEL;TYPE=CELL:+49 170 %07u\r\n", (unsigned int) rand() % 10000000);
+        phonebook_append(line);
+        if (i & 1){
+            snprintf(line, sizeof(line), "TEL;TYPE=HOME,VOICE:+49 30 %07u\r\n", (unsigned int) rand() % 10000000);
+            phonebook_append(line);
+        }
+        snprintf(line, sizeof(line), "EMAIL;TYPE=INTERNET:%s.%s%u@example.com\r\n", first_name, last_name, i);
+        phonebook_append(line);
+        if ((i % 3) == 0){
+            phonebook_append("ADR;TYPE=HOME:;;Musterstrasse 12;Berlin;;10115;Germany\r\n");
+            phonebook_append("NOTE:Met at the conference in the hall next to the entrance on the second d\r\n ay, talked about Bluetooth\r\n");
+        }
+        if ((i % PHOTO_INTERVAL) == 0){
+            phonebook_append("PHOTO;ENCODING=b;TYPE=JPEG:");
+            int j;
+            int column = 27;
+            for (j = 0; j < PHOTO_SIZE; j++){
+                if (column == 75){
+                    phonebook_append("\r\n ");
+                    column = 1;
+                }
+                phonebook[phonebook_len++] = base64[rand() & 63];
+                column++;
+            }
+            phonebook_append("\r\n");
+        }
+        phonebook_append("END:VCARD\r\n");
+        phonebook_max_card_len = btstack_max(phonebook_max_card_len, phonebook_len - card_start);
+    }
+}
+
+static void stats_add_value(phonebook_stats_t * stats, const uint8_t * data, uint32_t len){
+    uint32_t i;
+    for (i = 0; i < len; i++){
+        stats->checksum = (stats->checksum * 31u) + data[i];
+    }
+}
+
+// vCard Parser
+static phonebook_stats_t parser_stats;
+
+static void parser_callback(vcard_parser_t * parser, vcard_parser_event_t event, const uint8_t * data, uint16_t len){
+    switch (event){
+        case VCARD_PARSER_EVENT_CARD_END:
+            parser_stats.cards++;
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_BEGIN:
+            switch (vcard_parser_get_property(parser)){
+                case VCARD_PROPERTY_TEL:
+                    parser_stats.tel++;
+                    if (vcard_parser_has_parameter(parser, "CELL")){
+                        parser_stats.tel_cell++;
+                    }
+                    break;
+                case VCARD_PROPERTY_EMAIL:
+                    parser_stats.email++;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_VALUE:
+            switch (vcard_parser_get_property(parser)){
+                case VCARD_PROPERTY_FN:
+                    parser_stats.fn_bytes += len;
+                    stats_add_value(&parser_stats, data, len);
+                    break;
+                case VCARD_PROPERTY_TEL:
+                case VCARD_PROPERTY_EMAIL:
+                    stats_add_value(&parser_stats, data, len);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_END:
+            if (vcard_parser_get_property(parser) == VCARD_PROPERTY_PHOTO){
+                parser_stats.photo_bytes += vcard_parser_get_value_len(parser);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t run_parser(uint16_t packet_size){
+    uint32_t start = perf_timer_get_time_us();
+    int iteration;
+    for (iteration = 0; iteration < NUM_ITERATIONS; iteration++){
+        vcard_parser_t parser;
+        memset(&parser_stats, 0, sizeof(parser_stats));
+        vcard_parser_init(&parser, &parser_callback, NULL);
+        uint32_t pos = 0;
+        while (pos < phonebook_len){
+            uint16_t len = (uint16_t) btstack_min(packet_size, phonebook_len - pos);
+            vcard_parser_process(&parser, (const uint8_t *) &phonebook[pos], len);
+            pos += len;
+        }
+    }
+    return (perf_timer_get_time_us() - start) / NUM_ITERATIONS;
+}
+
+// Baseline: collect complete phonebook, then unfold and split each line
+static phonebook_stats_t baseline_stats;
+
+static void baseline_parse(const char * data, uint32_t len){
+    static char line[LINE_BUFFER_SIZE];
+    uint32_t pos = 0;
+    while (pos < len){
+        // unfold line
+        uint16_t line_len = 0;
+        while (pos < len){
+            if ((data[pos] == '\r') && ((pos + 2) < len) && (data[pos + 1] == '\n') && (data[pos + 2] == ' ')){
+                pos += 3;
+                continue;
+            }
+            if (data[pos] == '\r'){
+                pos += 2;
+                break;
+            }
+            if (line_len < (LINE_BUFFER_SIZE - 1)){
+                line[line_len++] = data[pos];
+            }
+            pos++;
+        }
+        line[line_len] = 0;
+        char * colon = strchr(line, ':');
+        if (colon == NULL) continue;
+        *colon = 0;
+        const char * value = colon + 1;
+        uint32_t value_len = (uint32_t) (line_len - (value - line));
+        char * params = strchr(line, ';');
+        if (params != NULL){
+            *params++ = 0;
+        }
+        if (strcmp(line, "END") == 0){
+            baseline_stats.cards++;
+        } else if (strcmp(line, "FN") == 0){
+            baseline_stats.fn_bytes += value_len;
+            stats_add_value(&baseline_stats, (const uint8_t *) value, value_len);
+        } else if (strcmp(line, "TEL") == 0){
+            baseline_stats.tel++;
+            if ((params != NULL) && (strstr(params, "CELL") != NULL)){
+                baseline_stats.tel_cell++;
+            }
+            stats_add_value(&baseline_stats, (const uint8_t *) value, value_len);
+        } else if (strcmp(line, "EMAIL") == 0){
+            baseline_stats.email++;
+            stats_add_value(&baseline_stats, (const uint8_t *) value, value_len);
+        } else if (strcmp(line, "PHOTO") == 0){
+            baseline_stats.photo_bytes += value_len;
+        }
+    }
+}
+
+static uint32_t run_baseline(uint16_t packet_size){
+    char * buffer = (char *) malloc(phonebook_len);
+    uint32_t start = perf_timer_get_time_us();
+    int iteration;
+    for (iteration = 0; iteration < NUM_ITERATIONS; iteration++){
+        memset(&baseline_stats, 0, sizeof(baseline_stats));
+        uint32_t pos = 0;
+        while (pos < phonebook_len){
+            uint16_t len = (uint16_t) btstack_min(packet_size, phonebook_len - pos);
+            memcpy(&buffer[pos], &phonebook[pos], len);
+            pos += len;
+        }
+        baseline_parse(buffer, phonebook_len);
+    }
+    uint32_t duration_us = (perf_timer_get_time_us() - start) / NUM_ITERATIONS;
+    free(buffer);
+    return duration_us;
+}
+
+static void print_result(const char * name, uint16_t packet_size, uint32_t duration_us, uint32_t memory){
+    printf("%-16s %5u byte packets: %7u us, %7.1f MB/s, %8u bytes buffered\n", name, packet_size, duration_us,
+           (double) phonebook_len / (double) duration_us, memory);
+}
+
+static int check_stats(void){
+    if (memcmp(&parser_stats, &baseline_stats, sizeof(phonebook_stats_t)) == 0) return 0;
+    printf("Mismatch: vCard Parser %u cards, %u tel, checksum %08x - Baseline %u cards, %u tel, checksum %08x\n",
+           parser_stats.cards, parser_stats.tel, parser_stats.checksum, baseline_stats.cards, baseline_stats.tel, baseline_stats.checksum);
+    return 1;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    (void) argv;
+
+    phonebook_generate();
+    printf("Phonebook: %u contacts, %u bytes, largest vCard %u bytes\n", NUM_CONTACTS, phonebook_len, phonebook_max_card_len);
+
+    static const uint16_t packet_sizes[] = { 64, 1000, 8192 };
+    int failed = 0;
+    unsigned int i;
+    for (i = 0; i < sizeof(packet_sizes) / sizeof(packet_sizes[0]); i++){
+        uint16_t packet_size = packet_sizes[i];
+        uint32_t parser_us   = run_parser(packet_size);
+        uint32_t baseline_us = run_baseline(packet_size);
+        print_result("vCard Parser", packet_size, parser_us, (uint32_t) sizeof(vcard_parser_t));
+        print_result("Buffer + lines", packet_size, baseline_us, phonebook_len + LINE_BUFFER_SIZE);
+        failed |= check_stats();
+    }
+    printf("%u cards, %u FN bytes, %u TEL (%u CELL), %u EMAIL, %u PHOTO bytes\n", parser_stats.cards, parser_stats.fn_bytes,
+           parser_stats.tel, parser_stats.tel_cell, parser_stats.email, parser_stats.photo_bytes);
+    free(phonebook);
+    return failed;
+}
@@ -0,0 +1,264 @@
+// *****************************************************************************
+//
+// vCard Parser Test
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_util.h"
+#include "classic/vcard_parser.h"
+
+// events are logged as text, consecutive value slices are merged to make the log independent of the chunk size
+static char     parser_log[2000];
+static uint16_t parser_log_len;
+static char     value[600];
+static uint16_t value_len;
+static uint16_t num_value_events;
+
+static void log_append(const char * text){
+    uint16_t len = (uint16_t) strlen(text);
+    if ((parser_log_len + len) >= sizeof(parser_log)) return;
+    memcpy(&parser_log[parser_log_len], text, len);
+    parser_log_len += len;
+    parser_log[parser_log_len] = 0;
+}
+
+static void parser_callback(vcard_parser_t * parser, vcard_parser_event_t event, const uint8_t * data, uint16_t len){
+    char buffer[800];
+    switch (event){
+        case VCARD_PARSER_EVENT_CARD_BEGIN:
+            log_append("<");
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_BEGIN:
+            value_len = 0;
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_VALUE:
+            num_value_events++;
+            if ((value_len + len) < sizeof(value)){
+                memcpy(&value[value_len], data, len);
+                value_len += len;
+            }
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY_END:
+            snprintf(buffer, sizeof(buffer), "%u:%s;%s=%.*s(%u)|", vcard_parser_get_property(parser),
+                     vcard_parser_get_property_name(parser), vcard_parser_get_parameters(parser),
+                     value_len, value, (unsigned int) vcard_parser_get_value_len(parser));
+            log_append(buffer);
+            break;
+        case VCARD_PARSER_EVENT_CARD_END:
+            log_append(">");
+            break;
+        default:
+            break;
+    }
+}
+
+static vcard_parser_t parser;
+
+static void parse(const char * text, uint16_t chunk_size){
+    uint16_t len = (uint16_t) strlen(text);
+    uint16_t pos = 0;
+    while (pos < len){
+        uint16_t chunk_len = btstack_min(chunk_size, len - pos);
+        vcard_parser_process(&parser, (const uint8_t *) &text[pos], chunk_len);
+        pos += chunk_len;
+    }
+}
+
+static const char * vcard_30 =
+    "BEGIN:VCARD\r\n"
+    "VERSION:3.0\r\n"
+    "FN:Jane Doe\r\n"
+    "N:Doe;Jane;;;\r\n"
+    "TEL;TYPE=CELL:+49 170 1234567\r\n"
+    "TEL;TYPE=HOME,VOICE:+49 30 765432\r\n"
+    "EMAIL;TYPE=INTERNET:jane@example.com\r\n"
+    "END:VCARD\r\n";
+
+static const char * vcard_30_log =
+    "<1:VERSION;=3.0(3)|2:FN;=Jane Doe(8)|3:N;=Doe;Jane;;;(11)|4:TEL;TYPE=CELL=+49 170 1234567(15)|"
+    "4:TEL;TYPE=HOME,VOICE=+49 30 765432(13)|5:EMAIL;TYPE=INTERNET=jane@example.com(16)|>";
+
+TEST_GROUP(VCardParser){
+    void setup(void){
+        parser_log_len = 0;
+        parser_log[0] = 0;
+        value_len = 0;
+        num_value_events = 0;
+        vcard_parser_init(&parser, &parser_callback, NULL);
+    }
+};
+
+TEST(VCardParser, Basic){
+    parse(vcard_30, 1000);
+    STRCMP_EQUAL(vcard_30_log, parser_log);
+}
+
+TEST(VCardParser, Context){
+    int context;
+    vcard_parser_init(&parser, &parser_callback, &context);
+    POINTERS_EQUAL(&context, vcard_parser_get_context(&parser));
+}
+
+TEST(VCardParser, AllChunkSizes){
+    uint16_t chunk_size;
+    for (chunk_size = 1; chunk_size <= strlen(vcard_30); chunk_size++){
+        setup();
+        parse(vcard_30, chunk_size);
+        STRCMP_EQUAL(vcard_30_log, parser_log);
+    }
+}
+
+TEST(VCardParser, AllSplitPositions){
+    // folded lines, quoted-printable and photo with split between any two characters
+    const char * text =
+        "BEGIN:VCARD\r\n"
+        "VERSION:2.1\r\n"
+        "FN;ENCODING=QUOTED-PRINTABLE;CHARSET=UTF-8:J=C3=B6rg =\r\n"
+        "M=C3=BCller\r\n"
+        "NOTE:a long\r\n"
+        "  note\r\n"
+        "PHOTO;ENCODING=BASE64;JPEG:\r\n"
+        " AAAA\r\n"
+        " BBBB\r\n"
+        "\r\n"
+        "END:VCARD\r\n";
+    parse(text, 1000);
+    char expected[sizeof(parser_log)];
+    strcpy(expected, parser_log);
+    STRCMP_EQUAL("<1:VERSION;=2.1(3)|2:FN;ENCODING=QUOTED-PRINTABLE;CHARSET=UTF-8=J=C3=B6rg M=C3=BCller(21)|"
+                 "0:NOTE;=a long note(11)|8:PHOTO;ENCODING=BASE64;JPEG=(8)|>", expected);
+    uint16_t split;
+    for (split = 1; split < strlen(text); split++){
+        setup();
+        vcard_parser_process(&parser, (const uint8_t *) text, split);
+        vcard_parser_process(&parser, (const uint8_t *) &text[split], (uint16_t) (strlen(text) - split));
+        STRCMP_EQUAL(expected, parser_log);
+    }
+}
+
+TEST(VCardParser, FoldedLine){
+    parse("BEGIN:VCARD\r\nFN:Jane\r\n  Doe\r\n\tJunior\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<2:FN;=Jane DoeJunior(14)|>", parser_log);
+}
+
+TEST(VCardParser, ZeroCopy){
+    const char * text = "BEGIN:VCARD\r\nFN:Jane Doe\r\nEND:VCARD\r\n";
+    parse(text, 1000);
+    // single value slice pointing into input
+    CHECK_EQUAL(1, num_value_events);
+}
+
+TEST(VCardParser, QuotedPrintableEqualSign){
+    parse("BEGIN:VCARD\r\nNOTE;QUOTED-PRINTABLE:a=3Db=\r\n=3D\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<0:NOTE;QUOTED-PRINTABLE=a=3Db=3D(8)|>", parser_log);
+}
+
+TEST(VCardParser, QuotedPrintableTruncatedParameters){
+    // QUOTED-PRINTABLE beyond VCARD_PARSER_MAX_PARAMS_LEN
+    parse("BEGIN:VCARD\r\nADR;TYPE=HOME;CHARSET=UTF-8;ENCODING=QUOTED-PRINTABLE:;;=E5=8C=97=\r\n=E4=BA=AC;;;;\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<6:ADR;TYPE=HOME;CHARSET=UTF-8;ENCODING=QUOTED-PRINTABL=;;=E5=8C=97=E4=BA=AC;;;;(24)|>", parser_log);
+}
+
+TEST(VCardParser, QuotedPrintableOnlyAsParameterToken){
+    parse("BEGIN:VCARD\r\nNOTE;X-QUOTED-PRINTABLE;X=QUOTED-PRINTABLEX:a=\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<0:NOTE;X-QUOTED-PRINTABLE;X=QUOTED-PRINTABLEX=a=(2)|>", parser_log);
+}
+
+TEST(VCardParser, NoQuotedPrintable){
+    // soft line break only with quoted-printable encoding
+    parse("BEGIN:VCARD\r\nNOTE:a=\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<0:NOTE;=a=(2)|>", parser_log);
+}
+
+TEST(VCardParser, Photo){
+    parse("BEGIN:VCARD\r\nPHOTO;ENCODING=b;TYPE=JPEG:AAAABBBB\r\n CCCC\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<8:PHOTO;ENCODING=b;TYPE=JPEG=(12)|>", parser_log);
+    CHECK_EQUAL(0, num_value_events);
+}
+
+TEST(VCardParser, PhotoData){
+    vcard_parser_set_report_photo_data(&parser, true);
+    parse("BEGIN:VCARD\r\nPHOTO;ENCODING=b;TYPE=JPEG:AAAABBBB\r\n CCCC\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<8:PHOTO;ENCODING=b;TYPE=JPEG=AAAABBBBCCCC(12)|>", parser_log);
+}
+
+TEST(VCardParser, GroupAndCase){
+    parse("begin:vcard\r\nitem1.email;type=pref:a@b.c\r\nEnd:VCard\r\n", 1000);
+    STRCMP_EQUAL("<5:EMAIL;type=pref=a@b.c(5)|>", parser_log);
+}
+
+TEST(VCardParser, LineFeedOnly){
+    parse("BEGIN:VCARD\nFN:Jane\n Doe\nTEL:123\nEND:VCARD\n", 1000);
+    STRCMP_EQUAL("<2:FN;=JaneDoe(7)|4:TEL;=123(3)|>", parser_log);
+}
+
+TEST(VCardParser, CarriageReturnOnly){
+    parse("BEGIN:VCARD\rFN:Jane\rTEL:123\rEND:VCARD\r", 1000);
+    STRCMP_EQUAL("<2:FN;=Jane(4)|4:TEL;=123(3)|>", parser_log);
+}
+
+TEST(VCardParser, QuotedParameter){
+    parse("BEGIN:VCARD\r\nTEL;TYPE=\"cell,voice\";X-LABEL=\"a:b\":123\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<4:TEL;TYPE=\"cell,voice\";X-LABEL=\"a:b\"=123(3)|>", parser_log);
+}
+
+static bool has_cell;
+static bool has_work;
+static bool has_cel;
+
+static void parameter_callback(vcard_parser_t * parser, vcard_parser_event_t event, const uint8_t * data, uint16_t len){
+    (void) data;
+    (void) len;
+    if (event != VCARD_PARSER_EVENT_PROPERTY_BEGIN) return;
+    has_cell = vcard_parser_has_parameter(parser, "CELL");
+    has_work = vcard_parser_has_parameter(parser, "work");
+    has_cel  = vcard_parser_has_parameter(parser, "CEL");
+}
+
+TEST(VCardParser, HasParameter){
+    vcard_parser_init(&parser, &parameter_callback, NULL);
+    parse("TEL;TYPE=cell,WORK:123\r\n", 1000);
+    CHECK_TRUE(has_cell);
+    CHECK_TRUE(has_work);
+    CHECK_FALSE(has_cel);
+    parse("TEL;CELL;VOICE:123\r\n", 1000);
+    CHECK_TRUE(has_cell);
+    CHECK_FALSE(has_work);
+    parse("TEL:123\r\n", 1000);
+    CHECK_FALSE(has_cell);
+}
+
+TEST(VCardParser, LongNameAndParameters){
+    parse("BEGIN:VCARD\r\n"
+          "X-VERY-LONG-PROPERTY-NAME-TEL:1\r\n"
+          "TEL;TYPE=CELL;X-A=0123456789;X-B=0123456789;X-C=0123456789:2\r\n"
+          "END:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<0:X-VERY-LONG-PROPERTY-NAM;=1(1)|"
+                 "4:TEL;TYPE=CELL;X-A=0123456789;X-B=0123456789;X-C=0123=2(1)|>", parser_log);
+}
+
+TEST(VCardParser, Malformed){
+    // lines without value and continuation lines outside of a property are ignored
+    parse(" orphan\r\nBEGIN:VCARD\r\nNOVALUE\r\nTEL;TYPE=CELL\r\nFN:Jane\r\nEND:VCARD\r\n", 1000);
+    STRCMP_EQUAL("<2:FN;=Jane(4)|>", parser_log);
+}
+
+TEST(VCardParser, MultipleCards){
+    parse(vcard_30, 1000);
+    parse(vcard_30, 7);
+    char expected[sizeof(parser_log)];
+    snprintf(expected, sizeof(expected), "%s%s", vcard_30_log, vcard_30_log);
+    STRCMP_EQUAL(expected, parser_log);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+# BlueKitchen GmbH (c) 2021
+
+# export/import link keys and LE devices stored by btstack_link_key_db_fs and le_device_db_fs
+#
+# .db files are binary append-only record logs (see platform/posix/btstack_record_log_posix.c):
+# - header: 'BTrlog' 0x01 0x00
+# - record: type (1 = put, 2 = delete), key len (8 bit), value len (16 bit little endian), key, value
+#
+# CSV format, one line per entry:
+# - link_key,<remote addr>,<link key>,<link key type>
+# - le_device,<index>,<addr type>,<addr>,<irk>,<ltk>,<ediv>,<rand>,<key size>,<authenticated>,<authorized>,
+#   <secure connection>,<remote csrk>,<remote counter>,<local csrk>,<local counter>
+
+import os
+import struct
+import sys
+
+RECORD_LOG_HEADER = b'BTrlog\x01\x00'
+RECORD_TYPE_PUT    = 1
+RECORD_TYPE_DELETE = 2
+
+LINK_KEY_RECORD_LEN  = 17
+LE_DEVICE_RECORD_LEN = 93
+
+def read_record_log(path):
+    records = {}
+    with open(path, 'rb') as fin:
+        if fin.read(8) != RECORD_LOG_HEADER:
+            raise ValueError('%s is not a valid record log' % path)
+        while True:
+            header = fin.read(4)
+            if len(header) < 4:
+                break
+            (record_type, key_len, value_len) = struct.unpack('<BBH', header)
+            data = fin.read(key_len + value_len)
+            if len(data) < key_len + value_len:
+                # incomplete record at the end
+                break
+            key = data[:key_len]
+            if record_type == RECORD_TYPE_PUT:
+                records[key] = data[key_len:]
+            elif record_type == RECORD_TYPE_DELETE:
+                records.pop(key, None)
+            else:
+                break
+    return records
+
+def write_record_log(path, records):
+    with open(path, 'wb') as fout:
+        fout.write(RECORD_LOG_HEADER)
+        for key, value in records.items():
+            fout.write(struct.pack('<BBH', RECORD_TYPE_PUT, len(key), len(value)))
+            fout.write(key)
+            fout.write(value)
+
+def addr_to_str(addr):
+    return ':'.join('%02X' % b for b in addr)
+
+def str_to_addr(addr_str):
+    return bytes.fromhex(addr_str.replace(':', '').replace('-', ''))
+
+def export_csv(path, fout):
+    records = read_record_log(path)
+    for key in sorted(records):
+        value = records[key]
+        if len(key) == 6 and len(value) == LINK_KEY_RECORD_LEN:
+            fout.write('link_key,%s,%s,%u\n' % (addr_to_str(key), value[0:16].hex().upper(), value[16]))
+        elif len(key) == 2 and len(value) == LE_DEVICE_RECORD_LEN:
+            index = struct.unpack('<H', key)[0]
+            (ediv,) = struct.unpack_from('<H', value, 39)
+            (remote_counter,) = struct.unpack_from('<I', value, 69)
+            (local_counter,) = struct.unpack_from('<I', value, 89)
+            fields = ['le_device', str(index), str(value[0]), addr_to_str(value[1:7]),
+                      value[7:23].hex().upper(), value[23:39].hex().upper(), str(ediv), value[41:49].hex().upper(),
+                      str(value[49]), str(value[50]), str(value[51]), str(value[52]),
+                      value[53:69].hex().upper(), str(remote_counter), value[73:89].hex().upper(), str(local_counter)]
+            fout.write(','.join(fields) + '\n')
+        else:
+            print('Skipping unknown record with key %s' % key.hex(), file=sys.stderr)
+
+def pack_le_device(fields):
+    (index, addr_type, addr, irk, ltk, ediv, rand, key_size, authenticated, authorized, secure_connection,
+     remote_csrk, remote_counter, local_csrk, local_counter) = fields
+    value = bytes([int(addr_type)]) + str_to_addr(addr) + bytes.fromhex(irk) + bytes.fromhex(ltk)
+    value += struct.pack('<H', int(ediv)) + bytes.fromhex(rand)
+    value += bytes([int(key_size), int(authenticated), int(authorized), int(secure_connection)])
+    value += bytes.fromhex(remote_csrk) + struct.pack('<I', int(remote_counter))
+    value += bytes.fromhex(local_csrk) + struct.pack('<I', int(local_counter))
+    return (struct.pack('<H', int(index)), value)
+
+def import_csv(path, fin):
+    records = read_record_log(path) if os.path.exists(path) else {}
+    for line in fin:
+        line = line.strip()
+        if len(line) == 0 or line.startswith('#'):
+            continue
+        fields = line.split(',')
+        if fields[0] == 'link_key':
+            records[str_to_addr(fields[1])] = bytes.fromhex(fields[2]) + bytes([int(fields[3])])
+        elif fields[0] == 'le_device':
+            (key, value) = pack_le_device(fields[1:])
+            records[key] = value
+        else:
+            raise ValueError('unknown entry: %s' % line)
+    write_record_log(path, records)
+    return len(records)
+
+def import_legacy_link_keys(directory, local_addr):
+    prefix = 'btstack_at_%s_link_key_for_' % local_addr
+    records = {}
+    for name in sorted(os.listdir(directory)):
+        if not name.startswith(prefix) or not name.endswith('.txt'):
+            continue
+        with open(os.path.join(directory, name), 'r') as fin:
+            content = fin.read().strip()
+        if len(content) < 33:
+            print('Skipping invalid link key file %s' % name, file=sys.stderr)
+            continue
+        addr = str_to_addr(name[len(prefix):-len('.txt')])
+        records[addr] = bytes.fromhex(content[0:32]) + bytes([int(content[32:])])
+    return records
+
+def import_legacy_le_devices(path):
+    records = {}
+    with open(path, 'r') as fin:
+        header = fin.readline()
+        signed_write = 'remote_csrk' in header
+        index = 0
+        for line in fin:
+            fields = [field for field in line.strip().split(',')]
+            if len(fields) < 9:
+                continue
+            addr_type = int(fields[0], 16)
+            addr = fields[1]
+            irk = fields[2]
+            ltk = fields[3]
+            ediv = int(fields[4], 16)
+            rand = fields[5]
+            key_size = int(fields[6], 16)
+            authenticated = int(fields[7], 16)
+            authorized = int(fields[8], 16)
+            remote_csrk = local_csrk = '00' * 16
+            remote_counter = local_counter = 0
+            pos = 9
+            if signed_write:
+                remote_csrk = fields[9]
+                remote_counter = int(fields[10], 16)
+                local_csrk = fields[11]
+                local_counter = int(fields[12], 16)
+                pos = 13
+            secure_connection = int(fields[pos], 16) if len(fields) > pos and len(fields[pos]) > 0 else 0
+            (key, value) = pack_le_device([index, addr_type, addr, irk, ltk, ediv, rand, key_size, authenticated,
+                                           authorized, secure_connection, remote_csrk, remote_counter, local_csrk, local_counter])
+            records[key] = value
+            index += 1
+    return records
+
+def import_legacy(directory, local_addr):
+    local_addr = local_addr.replace(':', '-').upper()
+    link_keys = import_legacy_link_keys(directory, local_addr)
+    if len(link_keys) > 0:
+        path = os.path.join(directory, 'btstack_at_%s_link_keys.db' % local_addr)
+        write_record_log(path, link_keys)
+        print('%u link keys written to %s' % (len(link_keys), path))
+    le_device_db_txt = os.path.join(directory, 'btstack_at_%s_le_device_db.txt' % local_addr)
+    if os.path.exists(le_device_db_txt):
+        le_devices = import_legacy_le_devices(le_device_db_txt)
+        path = os.path.join(directory, 'btstack_at_%s_le_device_db.db' % local_addr)
+        write_record_log(path, le_devices)
+        print('%u LE devices written to %s' % (len(le_devices), path))
+
+def usage():
+    print ('Export/import BTstack POSIX bonding databases')
+    print ('Copyright 2021, BlueKitchen GmbH')
+    print ('')
+    print ('Usage: ', sys.argv[0], 'export file.db [file.csv]')
+    print ('       ', sys.argv[0], 'import file.db file.csv')
+    print ('       ', sys.argv[0], 'import-legacy directory local-addr')
+    exit(0)
+
+if len(sys.argv) < 3:
+    usage()
+
+command = sys.argv[1]
+if command == 'export':
+    if len(sys.argv) > 3:
+        with open(sys.argv[3], 'w') as fout:
+            export_csv(sys.argv[2], fout)
+    else:
+        export_csv(sys.argv[2], sys.stdout)
+elif command == 'import' and len(sys.argv) == 4:
+    with open(sys.argv[3], 'r') as fin:
+        num_records = import_csv(sys.argv[2], fin)
+    print('%s contains %u entries' % (sys.argv[2], num_records))
+elif command == 'import-legacy' and len(sys.argv) == 4:
+    import_legacy(sys.argv[2], sys.argv[3])
+else:
+    usage()